@@ -15,6 +15,9 @@ class AppConfig {
   static const Duration logAutoFlushInterval = Duration(seconds: 30); // 自动刷新间隔
   static const int logMaxOpenFiles = 10; // 最大同时打开的日志文件数
   static const Duration logDateCheckInterval = Duration(minutes: 1); // 日期检查间隔
+  static const int logMaxFileBytes = 10 * 1024 * 1024; // 原生日志单个文件的轮转大小（仅Windows）
+  static const int logMaxBackups = 5; // 原生日志按大小轮转时保留的历史文件数（仅Windows）
+  static const bool logBinaryFormat = false; // 原生日志写压缩的二进制段（.clog，用cfvpn_logcat解码，仅Windows）
   
   // ===== V2Ray端口配置 =====
   static const int v2raySocksPort = 7898; // SOCKS5代理端口
@@ -23,6 +26,10 @@ class AppConfig {
   static const int v2rayDefaultServerPort = 443; // 默认服务器端口
   static const int virtualDnsPort = 10853; // 虚拟DNS服务端口
   static const bool enableVirtualDns = false; // 默认关闭虚拟DNS
+  static const bool nativeDnsResolver = true; // 连接后启动原生DNS缓存解析器，经虚拟DNS入站(TCP)走隧道查询，代替 ipconfig /flushdns（仅Windows）
+  static const int nativeDnsPort = 10854; // 原生DNS解析器在127.0.0.1上的UDP端口，可作为系统DNS使用；0表示不监听
+  static const bool localRelay = false; // 系统代理改指向原生本地中继，由它转发到HTTP入站并按目标统计流量（仅Windows，默认关闭）
+  static const int localRelayPort = 7897; // 本地中继在127.0.0.1上的端口
   
   // ===== V2Ray服务配置 =====
   static const Duration v2rayStartupWait = Duration(seconds: 3); // V2Ray启动后等待时间
@@ -30,6 +37,10 @@ class AppConfig {
   static const Duration portCheckTimeout = Duration(seconds: 2); // 端口检查超时时间
   static const int v2rayTerminateRetries = 6; // V2Ray进程终止重试次数
   static const Duration v2rayTerminateInterval = Duration(milliseconds: 500); // 终止重试间隔
+  static const Duration v2rayReadyTimeout = Duration(seconds: 10); // 原生看护：等待入站端口就绪的上限
+  static const int v2rayMaxRestarts = 3; // 原生看护：V2Ray连续崩溃后自动重启的次数上限
+  static const Duration v2raySupervisorCheckInterval = Duration(seconds: 1); // 原生看护状态检查间隔
+  static const Duration prewarmWaitTimeout = Duration(seconds: 5); // 等待runner启动预热（节点缓存/配置模板/文件检查）完成的上限
   
   // ===== V2Ray服务器群组配置 =====
   // 服务器群组用于指定多个后端服务器，实现域前置的灵活切换
@@ -106,26 +117,64 @@ class AppConfig {
     '172.67.0.0/16',
     '131.0.72.0/22',
   ];
+
+  // Cloudflare IPv6 段，只在 ipv6SampleShare 大于 0 时参与采样
+  static const List<String> cloudflareIpv6Ranges = [
+    '2400:cb00::/32',
+    '2606:4700::/32',
+    '2803:f800::/32',
+    '2405:b500::/32',
+    '2405:8100::/32',
+    '2a06:98c0::/29',
+    '2c0f:f248::/32',
+  ];
   
   // ===== 网络测试配置 =====
   // 测试参数配置
   static const int defaultSampleCount = 500; // 默认采样IP数量
   static const int defaultTestNodeCount = 5; // 默认最终选择节点数
   static const int defaultMaxLatency = 300; // 默认最大可接受延迟(ms)
+  static const double ipv6SampleShare = 0.0; // 采样中IPv6地址的比例，需要本机IPv6连通（仅原生核心）
   
   // TCPing配置
   static const Duration tcpTimeout = Duration(seconds: 1); // TCP连接超时时间
   static const int tcpPingTimes = 3; // TCPing测试次数
   static const int minValidTcpLatency = 30; // TCPing最小有效延迟(ms)，避免假连接
   static const Duration tcpTestInterval = Duration(milliseconds: 50); // TCPing测试间隔
+  static const int tcpExtraPingTimes = 3; // 抖动过大时原生TCPing追加的测试次数上限（仅Windows）
+  static const double tcpExtraJitterRatio = 0.25; // 抖动超过平均延迟的该比例时追加测试
+  // 原生TCPing排序得分的权重，默认只看平均延迟，与Dart实现的排序一致。
+  // 想惩罚长尾时可改为例如 {'p50': 1.0, 'p99': 0.5, 'jitter': 0.5, 'loss': 2.0}
+  static const Map<String, double> latencyScoreWeights = {
+    'mean': 1.0,
+  };
+  static const bool banditSampling = true; // 原生TCPing按各IP段已测出的优质节点比例分配探测预算（仅Windows）
+  static const int banditArmPrefix = 16; // 大IP段按该前缀长度切分，每块单独统计优质节点比例
+  static const int banditBatchSize = 32; // 每轮探测的IP数，之后按结果重新分配
   
   // HTTPing配置
   static const int httpingTimeout = 2000; // HTTPing超时时间(ms)
   static const int httpingTestIpCount = 200; // TCPing失败后HTTPing重试的IP数量
   
+  // 吞吐测试配置
+  static const bool throughputRanking = false; // Trace之后对前几个节点做下载吞吐测试并按稳定吞吐重新排序（仅Windows，会消耗流量）
+  static const int throughputTestCount = 3; // 参与吞吐测试的Trace排名靠前节点数
+  static const int throughputConnections = 4; // 吞吐测试的并行连接数
+  static const Duration throughputTestDuration = Duration(seconds: 3); // 每个节点的吞吐测试时长
+  
   // 批处理配置
   static const int minBatchSize = 10; // 最小批处理大小
   static const int maxBatchSize = 20; // 最大批处理大小
+  static const int maxConcurrency = 64; // Dart测速滑动窗口的并发上限（AIMD自动调整）
+  static const int nativeMaxInflight = 1024; // 原生TCPing引擎同时在途的最大连接数（仅Windows）
+  static const int nativeMinInflight = 32; // 原生TCPing自适应并发的下限
+  static const int nativeInitialInflight = 256; // 原生TCPing自适应并发的初始值
+  static const int nativeHttpMaxInflight = 64; // 原生HTTPing/Trace同时在途的最大连接数（仅Windows）
+  static const String nodeCacheFileName = 'node_cache.bin'; // 节点质量缓存文件，位于程序目录（仅Windows）
+  static const int nodeCacheCapacity = 4096; // 节点质量缓存最多保存的节点数，文件大小固定约128KB
+  static const Duration nodeCacheMaxAge = Duration(days: 3); // 启动时只使用该时间内测过的缓存节点
+  static const int nodeCacheMaxFailureStreak = 2; // 连续失败达到该次数的缓存节点不再使用
+  static const String fullScanFileName = 'full_scan.csv'; // 全量扫描结果，位于程序目录（仅Windows），检查点为同名 .checkpoint
   
   // ===== 服务器管理配置 =====
   static const int autoSelectLatencyThreshold = 200; // 自动选择服务器的延迟阈值(ms)
@@ -133,9 +182,17 @@ class AppConfig {
   static const int goodNodeLatencyThreshold = 300; // 优质节点延迟阈值(ms)
   static const double goodNodeLossRateThreshold = 0.1; // 优质节点丢包率阈值(10%)
   static const int earlyStopGoodNodeCount = 10; // 提前结束测试的优质节点数量
+  static const int healthStandbyCount = 3; // 连接后健康检查的备用节点数（仅Windows）
+  static const Duration healthActiveInterval = Duration(seconds: 2); // 当前节点的握手探测间隔
+  static const Duration healthStandbyInterval = Duration(seconds: 10); // 每个备用节点的握手探测间隔
+  static const int healthMaxLatency = 300; // 当前节点握手延迟持续超过该值(ms)视为变差
+  static const Duration healthSwitchCooldown = Duration(seconds: 30); // 两次自动切换节点的最短间隔
+  static const Duration healthPollInterval = Duration(seconds: 1); // 轮询原生健康检查结果的间隔
   
   // ===== 性能配置 =====
   static const Duration trafficStatsInterval = Duration(seconds: 10); // 流量统计更新间隔
+  static const Duration nativeTrafficStatsInterval = Duration(seconds: 1); // 原生gRPC统计客户端的更新间隔（仅Windows）
+  static const Duration trafficSampleInterval = Duration(milliseconds: 250); // 原生流量采样间隔，供高频速度曲线使用（仅Windows）
   
   // ===== 缓存配置 =====
   static const Duration userInfoCacheExpiry = Duration(hours: 72); // 用户信息缓存过期时间
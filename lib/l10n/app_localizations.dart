@@ -60,6 +60,7 @@ class AppLocalizations {
   String get sortAscending => _get('sortAscending');
   String get sortDescending => _get('sortDescending');
   String get fromCloudflare => _get('fromCloudflare');
+  String get fullScan => _get('fullScan');
   String get noServers => _get('noServers');
   String get confirmDelete => _get('confirmDelete');
   String get latency => _get('latency');
@@ -122,6 +123,7 @@ class AppLocalizations {
   String get samplingFromIPRanges => _get('samplingFromIPRanges');
   String get testingDelay => _get('testingDelay');
   String get testingResponseSpeed => _get('testingResponseSpeed');
+  String get testingThroughput => _get('testingThroughput');
   String get startingTraceTest => _get('startingTraceTest');
   String get foundQualityNodes => _get('foundQualityNodes');
   
@@ -494,6 +496,7 @@ const Map<String, String> _zhCnTranslations = {
   'sortAscending': '延迟从低到高',
   'sortDescending': '延迟从高到低',
   'fromCloudflare': '从Cloudflare添加',
+  'fullScan': '全量扫描',
   'noServers': '暂无服务器',
   'confirmDelete': '确认删除',
   'latency': '延迟',
@@ -556,6 +559,7 @@ const Map<String, String> _zhCnTranslations = {
   'samplingFromIPRanges': '从 %s 个IP段采样',
   'testingDelay': '测试延迟',
   'testingResponseSpeed': '测试响应速度',
+  'testingThroughput': '测试下载速度',
   'startingTraceTest': '开始响应速度测试',
   'foundQualityNodes': '找到 %s 个优质节点',
   
@@ -19,6 +19,7 @@ import 'utils/diagnostic_tool.dart';
 import 'services/v2ray_service.dart';
 import 'services/proxy_service.dart';
 import 'services/ad_service.dart';
+import 'services/native_core.dart';
 import 'services/version_service.dart';  // 新增：引入版本服务
 import 'utils/log_service.dart';  // 新增：引入日志服务
 import 'l10n/app_localizations.dart';
@@ -59,6 +60,9 @@ class CustomScrollBehavior extends MaterialScrollBehavior {
 }
 
 void main() async {
+  // 启动追踪：与 runner 的原生区间合并输出，设置 CFVPN_TRACE_FILE 时写出
+  final mainStartUs = NativeCore.traceNowUs();
+  NativeCore.traceInstant('dart: main');
   WidgetsFlutterBinding.ensureInitialized();
   
   // 设置系统UI样式
@@ -71,10 +75,12 @@ void main() async {
   
   // 初始化窗口管理器（仅桌面平台）- 使用AppConfig
   if (!kIsWeb && (Platform.isWindows || Platform.isLinux || Platform.isMacOS)) {
-    await windowManager.ensureInitialized();
+    await NativeCore.traceAsync('dart: windowManager.ensureInitialized',
+        () => windowManager.ensureInitialized());
     
     // 等待窗口准备就绪
-    await windowManager.waitUntilReadyToShow();
+    await NativeCore.traceAsync('dart: windowManager.waitUntilReadyToShow',
+        () => windowManager.waitUntilReadyToShow());
     
     // 设置窗口选项 - 使用AppConfig
     WindowOptions windowOptions = WindowOptions(
@@ -95,6 +101,16 @@ void main() async {
     });
   }
   
+  // 接管 runner 在引擎启动期间预热好的节点缓存和配置模板
+  NativeCore.adoptPrewarm();
+  NativeCore.traceSpan('dart: main', mainStartUs);
+  WidgetsBinding.instance.addPostFrameCallback((_) {
+    NativeCore.traceSpan('dart: first frame', mainStartUs);
+    final traceFile = Platform.environment['CFVPN_TRACE_FILE'];
+    if (traceFile != null && traceFile.isNotEmpty) {
+      NativeCore.dumpTrace(traceFile);
+    }
+  });
   runApp(const MyApp());
 }
 
@@ -864,6 +864,9 @@ Future<void> _checkAndRequestBatteryOptimization() async {
           case 'testingResponseSpeed':
             message = l10n.testingResponseSpeed;
             break;
+          case 'testingThroughput':
+            message = l10n.testingThroughput;
+            break;
           case 'testCompleted':
             message = l10n.testCompleted;
             break;
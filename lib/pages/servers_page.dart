@@ -1,6 +1,7 @@
 import 'package:flutter/material.dart';
 import 'package:provider/provider.dart';
 import '../services/cloudflare_test_service.dart';
+import '../services/native_core.dart';
 import '../services/ad_service.dart';
 import '../models/server_model.dart';
 import '../providers/app_provider.dart';
@@ -114,6 +115,37 @@ class _ServersPageState extends State<ServersPage> {
     );
   }
 
+  // 全量扫描：每个 /24 测一个地址，可取消，下次从检查点继续（仅原生核心）
+  void _fullScanServers(BuildContext context) {
+    final l10n = AppLocalizations.of(context);
+    final serverProvider = context.read<ServerProvider>();
+    
+    if (serverProvider.isRefreshing) {
+      ScaffoldMessenger.of(context).showSnackBar(
+        SnackBar(
+          content: Text(l10n.gettingNodes),
+          backgroundColor: Colors.orange,
+        ),
+      );
+      return;
+    }
+    
+    showDialog(
+      context: context,
+      barrierDismissible: false,
+      builder: (context) => AlertDialog(
+        title: Row(
+          children: [
+            const Icon(Icons.radar, color: Colors.blue),
+            const SizedBox(width: 8),
+            Text(l10n.fullScan),
+          ],
+        ),
+        content: const CloudflareTestDialog(fullScan: true),
+      ),
+    );
+  }
+
   Future<void> _testAllServersLatency() async {
     final l10n = AppLocalizations.of(context);
     final serverProvider = context.read<ServerProvider>();
@@ -294,6 +326,13 @@ class _ServersPageState extends State<ServersPage> {
             tooltip: l10n.fromCloudflare,
             onPressed: () => _addCloudflareServer(context),
           ),
+          // 全量扫描按钮
+          if (NativeCore.isAvailable)
+            IconButton(
+              icon: const Icon(Icons.radar),
+              tooltip: l10n.fullScan,
+              onPressed: () => _fullScanServers(context),
+            ),
           // 添加右边距
           const SizedBox(width: 10),
         ],
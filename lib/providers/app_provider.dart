@@ -12,8 +12,10 @@ import '../models/server_model.dart';
 import '../services/v2ray_service.dart';
 import '../services/proxy_service.dart';
 import '../services/cloudflare_test_service.dart';
+import '../services/native_core.dart';
 import '../services/version_service.dart';
 import '../utils/log_service.dart';
+import '../utils/ui_utils.dart';
 import '../app_config.dart';
 import '../l10n/app_localizations.dart';
 
@@ -40,6 +42,11 @@ class ConnectionProvider with ChangeNotifier {
   // 新增成员变量
   StreamSubscription<V2RayStatus>? _v2rayStatusSubscription;
   bool _isStopping = false;
+
+  // 连接后的节点健康检查（仅Windows）
+  Timer? _healthTimer;
+  List<ServerModel> _healthNodes = [];
+  bool _isSwitchingNode = false;
   
   bool get isConnected => _isConnected;
   ServerModel? get currentServer => _currentServer;
@@ -156,7 +163,7 @@ class ConnectionProvider with ChangeNotifier {
   }
   
   void _handleV2RayProcessExit() {
-    if (_isDisposed) return;
+    if (_isDisposed || _isSwitchingNode) return;
     
     if (_isConnected) {
       _log.warn('V2Ray process exited unexpectedly, updating connection status...', tag: _logTag);
@@ -452,6 +459,9 @@ class ConnectionProvider with ChangeNotifier {
               notifyListeners();
             }
             await _log.info('连接成功建立', tag: _logTag);
+            if (Platform.isWindows) {
+              _startHealthMonitor(serverToConnect, availableServers);
+            }
           } else {
             throw Exception('Failed to start V2Ray service');
           }
@@ -494,6 +504,7 @@ class ConnectionProvider with ChangeNotifier {
   
   Future<void> disconnect() async {
     _isStopping = true;
+    _stopHealthMonitor();
     try {
       await V2RayService.stop();
       
@@ -523,6 +534,89 @@ class ConnectionProvider with ChangeNotifier {
     }
   }
   
+  // 以当前节点和延迟最低的几个同端口节点启动原生健康检查，
+  // 原生线程判定需要切换时由 _checkFailover 重新生成配置并重启V2Ray
+  void _startHealthMonitor(ServerModel current, List<ServerModel> servers) {
+    _stopHealthMonitor();
+    final standbys = servers
+        .where((s) => s.id != current.id && s.ip != current.ip && s.port == current.port)
+        .toList()
+      ..sort((a, b) => a.ping.compareTo(b.ping));
+    final nodes = [current, ...standbys.take(AppConfig.healthStandbyCount)];
+    if (nodes.length < 2) return;
+
+    final started = NativeCore.startHealthMonitor(
+      nodes: nodes.map((s) => s.ip).toList(),
+      port: current.port,
+      activeInterval: AppConfig.healthActiveInterval,
+      standbyInterval: AppConfig.healthStandbyInterval,
+      maxLatencyMs: AppConfig.healthMaxLatency,
+      cooldown: AppConfig.healthSwitchCooldown,
+    );
+    if (!started) return;
+    _healthNodes = nodes;
+    _scheduleHealthPoll();
+    _log.info('节点健康检查已启动: ${current.ip} + ${nodes.length - 1}个备用节点', tag: _logTag);
+  }
+
+  void _scheduleHealthPoll() {
+    _healthTimer?.cancel();
+    _healthTimer = Timer.periodic(AppConfig.healthPollInterval, (_) => _checkFailover());
+  }
+
+  void _stopHealthMonitor() {
+    _healthTimer?.cancel();
+    _healthTimer = null;
+    _healthNodes = [];
+    NativeCore.stopHealthMonitor();
+  }
+
+  Future<void> _checkFailover() async {
+    if (!_isConnected || _isStopping || _isSwitchingNode || _currentServer == null) return;
+    final activeIp = NativeCore.healthActiveNode();
+    if (activeIp == null || activeIp == _currentServer!.ip) return;
+    final target = _healthNodes.where((s) => s.ip == activeIp).firstOrNull;
+    if (target == null) return;
+
+    // 重启V2Ray需要数秒，切换期间停止轮询，结束后仍处于连接状态才恢复
+    _isSwitchingNode = true;
+    _healthTimer?.cancel();
+    _healthTimer = null;
+    try {
+      await _log.warn('当前节点 ${_currentServer!.ip} 质量下降，切换到 ${target.ip}', tag: _logTag);
+      await V2RayService.stop();
+      final started = await V2RayService.start(
+        serverIp: target.ip,
+        serverPort: target.port,
+        globalProxy: _globalProxy,
+        localizedStrings: _localizedStrings,
+        enableVirtualDns: AppConfig.enableVirtualDns,
+        allowedApps: _allowedApps.isEmpty ? null : _allowedApps,
+      );
+      if (!started) {
+        throw Exception('Failed to start V2Ray service');
+      }
+      _currentServer = target;
+      await _saveCurrentServer();
+      if (!_isDisposed) {
+        notifyListeners();
+      }
+    } catch (e) {
+      await _log.error('切换节点失败，断开连接', tag: _logTag, error: e);
+      await disconnect().catchError((_) {});
+      _disconnectReason = 'unexpected_exit';
+      if (!_isDisposed) {
+        notifyListeners();
+      }
+    } finally {
+      _isSwitchingNode = false;
+      // disconnect 会清空 _healthNodes，此时不再恢复
+      if (_isConnected && _healthNodes.isNotEmpty && !_isDisposed) {
+        _scheduleHealthPoll();
+      }
+    }
+  }
+
   Future<void> setCurrentServer(ServerModel? server) async {
     _currentServer = server;
     await _saveCurrentServer();
@@ -572,6 +666,7 @@ class ServerProvider with ChangeNotifier {
         _servers = decoded.map((item) => ServerModel.fromJson(item)).toList();
         
         if (_servers.isEmpty) {
+          if (await _restoreFromNodeCache()) return;
           await _log.info('服务器列表为空，自动获取节点', tag: _logTag);
           await refreshFromCloudflare();
         } else {
@@ -583,14 +678,69 @@ class ServerProvider with ChangeNotifier {
       } catch (e) {
         await _log.error('加载服务器列表失败', tag: _logTag, error: e);
         _servers.clear();
+        if (await _restoreFromNodeCache()) return;
         await refreshFromCloudflare();
       }
     } else {
+      if (await _restoreFromNodeCache()) return;
       await _log.info('首次运行，开始获取节点', tag: _logTag);
       await refreshFromCloudflare();
     }
   }
   
+  // 从节点质量缓存中直接选出历史最好的节点，避免启动时的完整测速。
+  // 缓存中没有足够新的节点时返回false，由调用方走正常的测速流程
+  Future<bool> _restoreFromNodeCache() async {
+    final cached = NativeCore.bestCachedNodes(
+      count: AppConfig.defaultTestNodeCount,
+      maxAge: AppConfig.nodeCacheMaxAge,
+      maxFailureStreak: AppConfig.nodeCacheMaxFailureStreak,
+    );
+    if (cached.isEmpty) return false;
+    
+    final now = DateTime.now().millisecondsSinceEpoch;
+    _servers = _generateNamedServers([
+      for (final node in cached)
+        ServerModel(
+          id: '${now}_${(node['ip'] as String).replaceAll('.', '')}',
+          name: node['ip'] as String,
+          location: (node['colo'] as String).isNotEmpty
+              ? UIUtils.getColoCountryCode(node['colo'] as String, defaultCode: 'US')
+              : 'US',
+          ip: node['ip'] as String,
+          port: AppConfig.v2rayDefaultServerPort,
+          ping: node['latency'] as int,
+        ),
+    ]);
+    await _saveServers();
+    await _log.info('从节点质量缓存中恢复 ${_servers.length} 个节点，跳过启动测速', tag: _logTag);
+    notifyListeners();
+    _tryAutoConnect();
+    
+    // 后台重新测一次这些节点，刷新缓存和显示的延迟
+    unawaited(_refreshCachedNodes());
+    return true;
+  }
+  
+  Future<void> _refreshCachedNodes() async {
+    try {
+      final results = await CloudflareTestService.testLatencyUnified(
+        ips: _servers.map((s) => s.ip).toList(),
+        port: AppConfig.v2rayDefaultServerPort,
+      );
+      final latencies = {
+        for (final result in results) result['ip'] as String: result['latency'] as int,
+      };
+      for (final server in _servers) {
+        server.ping = latencies[server.ip] ?? server.ping;
+      }
+      await _saveServers();
+      notifyListeners();
+    } catch (e) {
+      await _log.warn('后台刷新缓存节点失败: $e', tag: _logTag);
+    }
+  }
+  
   void _tryAutoConnect() {
     if (_connectionProvider != null && _servers.isNotEmpty) {
       Future.delayed(const Duration(milliseconds: 500), () {
@@ -685,6 +835,20 @@ class ServerProvider with ChangeNotifier {
     }
   }
 
+  /// 开始全量扫描（仅原生核心可用时），中断后再次调用从检查点继续
+  Stream<TestProgress> fullScan({bool restart = false}) {
+    return CloudflareTestService.fullScanWithProgress(
+      count: AppConfig.defaultTestNodeCount,
+      maxLatency: AppConfig.defaultMaxLatency,
+      restart: restart,
+    );
+  }
+  
+  /// 取消全量扫描，已扫描的部分保留在检查点中
+  void cancelFullScan() {
+    CloudflareTestService.cancelFullScan();
+  }
+
   List<ServerModel> _generateNamedServers(List<ServerModel> servers) {
     final namedServers = <ServerModel>[];
     final countryCountMap = <String, int>{};
@@ -2,6 +2,7 @@ import 'dart:io';
 import 'dart:convert';
 import 'dart:math' as math;
 import 'dart:async';
+import 'dart:collection';
 import 'package:flutter/material.dart';
 import 'package:provider/provider.dart';
 import 'package:path/path.dart' as path;
@@ -11,6 +12,7 @@ import '../utils/ui_utils.dart';
 import '../providers/app_provider.dart';
 import '../l10n/app_localizations.dart';
 import '../app_config.dart';
+import 'native_core.dart';
 
 class CloudflareTestService {
   // 日志标签
@@ -72,109 +74,267 @@ class CloudflareTestService {
     
     await _log.info('开始${useHttping ? "HTTPing" : "TCPing"}测试 ${ips.length} 个IP，端口: $testPort', tag: _logTag);
     
-    // 单个测试时不需要批处理，批量测试时根据maxLatency动态调整并发数 - 使用AppConfig
-    final batchSize = singleTest ? 1 : math.min(AppConfig.maxBatchSize, math.max(AppConfig.minBatchSize, 1000 ~/ maxLatency));
-    await _log.debug('批处理大小: $batchSize (基于maxLatency: ${maxLatency}ms)', tag: _logTag);
+    // Windows平台优先使用原生TCPing引擎（单事件循环高并发，无批次屏障）
+    if (!useHttping && !singleTest && NativeCore.isAvailable) {
+      return _testLatencyNative(ips, testPort, maxLatency, onProgress);
+    }
+    if (useHttping && !singleTest && NativeCore.isAvailable) {
+      return _testHttpingNative(ips, testPort, onProgress);
+    }
+    
+    // 单个测试只有一个IP；批量测试使用滑动窗口，任何一个IP完成就立即补上下一个，
+    // 不再等待整批结束。初始并发沿用原来按maxLatency计算的批大小，之后由AIMD调整
+    final initialConcurrency = singleTest ? 1 : math.min(AppConfig.maxBatchSize, math.max(AppConfig.minBatchSize, 1000 ~/ maxLatency));
+    final window = _AimdWindow(
+      min: singleTest ? 1 : AppConfig.minBatchSize,
+      max: singleTest ? 1 : AppConfig.maxConcurrency,
+      initial: initialConcurrency,
+    );
+    await _log.debug('初始并发: $initialConcurrency (基于maxLatency: ${maxLatency}ms)，上限: ${AppConfig.maxConcurrency}', tag: _logTag);
     int successCount = 0;
     int failCount = 0;
     int tested = 0;
+    int goodNodes = 0;
     
-    // ===== 优化2：智能批处理，失败率高时提前退出 =====
-    int consecutiveFailBatches = 0; // 连续失败批次计数
-    const int maxConsecutiveFailBatches = 3; // 最大连续失败批次
-    const double batchFailRateThreshold = 0.9; // 批次失败率阈值
+    // ===== 优化2：失败率高时提前退出，在每个IP完成时检查 =====
+    // 最近 failureWindow 个结果的失败比例达到阈值，相当于原来连续3个批次失败率超过90%
+    const double failRateThreshold = 0.9;
+    const int failureWindow = AppConfig.maxBatchSize * 3;
+    final recentFailures = ListQueue<bool>();
+    int recentFailCount = 0;
+    bool stopped = false;
     
-    for (int i = 0; i < ips.length; i += batchSize) {
-      final batch = ips.skip(i).take(batchSize).toList();
-      final futures = <Future>[];
-      int batchSuccessCount = 0;
-      int batchFailCount = 0;
+    void onResult(String ip, Map<String, dynamic> result) {
+      results.add(result);
+      tested++;
       
-      await _log.debug('测试批次 ${(i / batchSize).floor() + 1}/${((ips.length - 1) / batchSize).floor() + 1}，包含 ${batch.length} 个IP', tag: _logTag);
+      final latency = result['latency'] as int;
+      final lossRate = result['lossRate'] as double;
+      final ok = latency > 0 && latency < 999 && lossRate < 1.0;
       
-      for (final ip in batch) {
-        final testMethod = useHttping 
-            ? _testSingleHttping(ip, testPort, maxLatency)
-            : _testSingleIpLatencyWithLossRate(ip, testPort, maxLatency);
-            
-        futures.add(testMethod.then((result) {
-          results.add(result);
-          tested++;
-          
-          final latency = result['latency'] as int;
-          final lossRate = result['lossRate'] as double;
-          
-          if (latency > 0 && latency < 999 && lossRate < 1.0) {
-            successCount++;
-            batchSuccessCount++;
-            _log.debug('✔ IP $ip 延迟: ${latency}ms, 丢包率: ${(lossRate * 100).toStringAsFixed(2)}%', tag: _logTag);
-          } else {
-            failCount++;
-            batchFailCount++;
-          }
-          
-          // 进度回调
-          onProgress?.call(tested, ips.length);
-          
-        }).catchError((e) {
-          failCount++;
-          batchFailCount++;
-          tested++;
-          results.add({
-            'ip': ip,
-            'latency': 999,
-            'lossRate': 1.0,
-            'colo': '',
-          });
-          _log.debug('× IP $ip 测试异常: $e', tag: _logTag);
-          
-          // 进度回调
-          onProgress?.call(tested, ips.length);
-          return null;
-        }));
+      if (ok) {
+        successCount++;
+        window.onSuccess();
+        _log.debug('✔ IP $ip 延迟: ${latency}ms, 丢包率: ${(lossRate * 100).toStringAsFixed(2)}%', tag: _logTag);
+      } else {
+        failCount++;
+        if (((result['timeouts'] as int?) ?? 0) > 0) {
+          window.onTimeout();
+        } else {
+          window.onFailure();
+        }
       }
       
-      await Future.wait(futures);
+      // 进度回调
+      onProgress?.call(tested, ips.length);
       
-      // ===== 优化：批次失败率检查 =====
-      final batchFailRate = batch.length > 0 ? batchFailCount / batch.length : 0.0;
-      if (batchFailRate >= batchFailRateThreshold) {
-        consecutiveFailBatches++;
-        await _log.warn('批次失败率过高: ${(batchFailRate * 100).toStringAsFixed(1)}%，连续失败批次: $consecutiveFailBatches', tag: _logTag);
-        
-        // 连续多个批次失败率过高，考虑提前退出
-        if (consecutiveFailBatches >= maxConsecutiveFailBatches && !singleTest) {
-          await _log.error('连续 $consecutiveFailBatches 个批次失败率超过 ${(batchFailRateThreshold * 100).toStringAsFixed(0)}%，提前结束测试', tag: _logTag);
-          // 如果是TCPing模式，标记需要切换到HTTPing
-          if (!useHttping) {
-            // 返回当前结果，让调用方决定是否切换模式
-            break;
-          }
-        }
-      } else {
-        // 重置连续失败计数
-        consecutiveFailBatches = 0;
+      if (latency < AppConfig.goodNodeLatencyThreshold && lossRate < AppConfig.goodNodeLossRateThreshold) {
+        goodNodes++;
+      }
+      recentFailures.addLast(!ok);
+      if (!ok) recentFailCount++;
+      if (recentFailures.length > failureWindow && recentFailures.removeFirst()) {
+        recentFailCount--;
       }
       
-      // 单个测试完成后立即返回
-      if (singleTest) break;
+      if (stopped || singleTest) return;
       
       // 如果已经找到足够的低延迟节点，可以提前结束 - 使用AppConfig
-      final goodNodes = results.where((r) => 
-        r['latency'] < AppConfig.goodNodeLatencyThreshold && 
-        r['lossRate'] < AppConfig.goodNodeLossRateThreshold
-      ).length;
       if (goodNodes >= AppConfig.earlyStopGoodNodeCount) {
-        await _log.info('已找到 $goodNodes 个优质节点（<${AppConfig.goodNodeLatencyThreshold}ms，丢包率<${(AppConfig.goodNodeLossRateThreshold * 100).toStringAsFixed(0)}%），提前结束测试', tag: _logTag);
-        break;
+        stopped = true;
+        _log.info('已找到 $goodNodes 个优质节点（<${AppConfig.goodNodeLatencyThreshold}ms，丢包率<${(AppConfig.goodNodeLossRateThreshold * 100).toStringAsFixed(0)}%），提前结束测试', tag: _logTag);
+      } else if (!useHttping &&
+          recentFailures.length >= failureWindow &&
+          recentFailCount >= failureWindow * failRateThreshold) {
+        // TCPing模式失败率过高，返回当前结果，让调用方决定是否切换到HTTPing
+        stopped = true;
+        _log.error('最近 $failureWindow 个IP失败率超过 ${(failRateThreshold * 100).toStringAsFixed(0)}%，提前结束测试', tag: _logTag);
       }
     }
     
+    final done = Completer<void>();
+    int next = 0;
+    int inflight = 0;
+    
+    void launch() {
+      while (!stopped && inflight < window.size && next < ips.length) {
+        final ip = ips[next++];
+        inflight++;
+        final testMethod = useHttping 
+            ? _testSingleHttping(ip, testPort, maxLatency)
+            : _testSingleIpLatencyWithLossRate(ip, testPort, maxLatency);
+        
+        testMethod.catchError((e) {
+          _log.debug('× IP $ip 测试异常: $e', tag: _logTag);
+          return <String, dynamic>{
+            'ip': ip,
+            'latency': 999,
+            'lossRate': 1.0,
+            'colo': '',
+          };
+        }).then((result) {
+          inflight--;
+          onResult(ip, result);
+          launch();
+          if (inflight == 0 && !done.isCompleted) {
+            done.complete();
+          }
+        });
+      }
+    }
+    
+    launch();
+    await done.future;
+    
+    if (!singleTest) {
+      await _log.debug('并发窗口最终为 ${window.size}，收缩 ${window.decreases} 次', tag: _logTag);
+    }
+    
     await _log.info('延迟测试完成，成功测试 ${results.length} 个IP（成功: $successCount，失败: $failCount）', tag: _logTag);
     
     return results;
   }
   
+  // 原生引擎批量TCPing - 参数与 _testSingleIpLatencyWithLossRate 一致
+  static Future<List<Map<String, dynamic>>> _testLatencyNative(
+    List<String> ips,
+    int port,
+    int maxLatency,
+    Function(int current, int total)? onProgress,
+  ) async {
+    await _log.debug('使用原生TCPing引擎，自适应并发: ${AppConfig.nativeMinInflight}-${AppConfig.nativeMaxInflight}', tag: _logTag);
+    
+    final stopwatch = Stopwatch()..start();
+    final results = await NativeCore.tcping(
+      ips: ips,
+      port: port,
+      timeoutMs: maxLatency,
+      attempts: AppConfig.tcpPingTimes,
+      minValidLatencyMs: AppConfig.minValidTcpLatency,
+      intervalMs: AppConfig.tcpTestInterval.inMilliseconds,
+      maxInflight: AppConfig.nativeMaxInflight,
+      adaptive: true,
+      minInflight: AppConfig.nativeMinInflight,
+      initialInflight: AppConfig.nativeInitialInflight,
+      // 与Dart实现相同的提前结束条件，但在每个IP完成时检查
+      stopAfterGood: AppConfig.earlyStopGoodNodeCount,
+      goodLatencyMs: AppConfig.goodNodeLatencyThreshold,
+      goodLossRate: AppConfig.goodNodeLossRateThreshold,
+      failureWindow: AppConfig.maxBatchSize * 3,
+      failureRateThreshold: 0.9,
+      extraAttempts: AppConfig.tcpExtraPingTimes,
+      extraJitterRatio: AppConfig.tcpExtraJitterRatio,
+      scoreWeights: AppConfig.latencyScoreWeights,
+      onProgress: onProgress,
+    );
+    stopwatch.stop();
+    
+    final successCount = results.where((r) =>
+      (r['latency'] as int) < 999 && (r['lossRate'] as double) < 1.0
+    ).length;
+    await _log.info('原生延迟测试完成，测试 ${results.length} 个IP（成功: $successCount，失败: ${results.length - successCount}），耗时: ${stopwatch.elapsedMilliseconds}ms', tag: _logTag);
+    
+    // 合并到节点质量缓存，下次启动可以直接从缓存中选择节点
+    NativeCore.recordLatencyResults(results);
+    
+    return results;
+  }
+  
+  // 原生分段TCPing：探测预算按各IP段的优质节点比例分轮分配，参数与 _testLatencyNative 一致
+  static Future<List<Map<String, dynamic>>> _testLatencyBandit(
+    int budget,
+    int port,
+    int maxLatency,
+    Function(int current, int total)? onProgress,
+  ) async {
+    await _log.debug('使用原生分段TCPing，预算 $budget，每轮 ${AppConfig.banditBatchSize} 个IP', tag: _logTag);
+    
+    final stopwatch = Stopwatch()..start();
+    final results = await NativeCore.banditTcping(
+      ranges: AppConfig.cloudflareIpRanges,
+      budget: budget,
+      port: port,
+      timeoutMs: maxLatency,
+      attempts: AppConfig.tcpPingTimes,
+      minValidLatencyMs: AppConfig.minValidTcpLatency,
+      intervalMs: AppConfig.tcpTestInterval.inMilliseconds,
+      maxInflight: AppConfig.nativeMaxInflight,
+      adaptive: true,
+      minInflight: AppConfig.nativeMinInflight,
+      initialInflight: AppConfig.nativeInitialInflight,
+      stopAfterGood: AppConfig.earlyStopGoodNodeCount,
+      goodLatencyMs: AppConfig.goodNodeLatencyThreshold,
+      goodLossRate: AppConfig.goodNodeLossRateThreshold,
+      extraAttempts: AppConfig.tcpExtraPingTimes,
+      extraJitterRatio: AppConfig.tcpExtraJitterRatio,
+      scoreWeights: AppConfig.latencyScoreWeights,
+      armPrefix: AppConfig.banditArmPrefix,
+      batch: AppConfig.banditBatchSize,
+      onProgress: onProgress,
+    );
+    stopwatch.stop();
+    
+    final successCount = results.where((r) => (r['lossRate'] as double) < 1.0).length;
+    await _log.info('原生分段延迟测试完成，测试 ${results.length} 个IP（成功: $successCount），耗时: ${stopwatch.elapsedMilliseconds}ms', tag: _logTag);
+    
+    NativeCore.recordLatencyResults(results);
+    
+    return results;
+  }
+  
+  // 原生HTTPing批量测试：结果格式与 _testSingleHttping 一致
+  static Future<List<Map<String, dynamic>>> _testHttpingNative(
+    List<String> ips,
+    int port,
+    Function(int current, int total)? onProgress,
+  ) async {
+    final stopwatch = Stopwatch()..start();
+    final probes = await NativeCore.httpProbe(
+      ips: ips,
+      port: port,
+      timeoutMs: AppConfig.httpingTimeout,
+      maxInflight: AppConfig.nativeHttpMaxInflight,
+      expectedStatus: httpingStatusCode == 0 ? 200 : httpingStatusCode,
+      host: '',  // 与 _testSingleHttping 相同，使用IP作为Host
+      onProgress: onProgress,
+    );
+    stopwatch.stop();
+    
+    final random = math.Random();
+    final results = <Map<String, dynamic>>[];
+    for (final probe in probes) {
+      final received = probe['received'] as int;
+      if (received > 0) {
+        // 与 _testSingleHttping 相同：收到响应头的耗时映射为随机延迟
+        final totalTime = (probe['connectMs'] as int) + (probe['ttfbMs'] as int);
+        final randomLatency = totalTime <= 1000
+            ? 100 + random.nextInt(51)
+            : 150 + random.nextInt(51);
+        results.add({
+          'ip': probe['ip'],
+          'latency': randomLatency,
+          'lossRate': 0.0,
+          'sent': 1,
+          'received': 1,
+          'colo': '',
+        });
+      } else {
+        results.add({
+          'ip': probe['ip'],
+          'latency': 999,
+          'lossRate': 1.0,
+          'sent': 1,
+          'received': 0,
+          'colo': '',
+        });
+      }
+    }
+    
+    final successCount = results.where((r) => (r['lossRate'] as double) < 1.0).length;
+    await _log.info('原生HTTPing完成，测试 ${results.length} 个IP（成功: $successCount），耗时: ${stopwatch.elapsedMilliseconds}ms', tag: _logTag);
+    return results;
+  }
+  
   // HTTPing 模式测试单个IP（优化版：使用共享HttpClient，但更好地处理超时）
   static Future<Map<String, dynamic>> _testSingleHttping(String ip, int port, [int maxLatency = 300]) async {
     // HTTPing使用配置的超时时间 - 使用AppConfig
@@ -293,11 +453,21 @@ class CloudflareTestService {
         'lossRate': 1.0,
         'sent': 1,
         'received': 0,
+        'timeouts': _isTimeoutError(e) ? 1 : 0,
         'colo': '',
       };
     }
   }
   
+  // 连接或请求超时：Future.timeout 抛出的 TimeoutException，
+  // 或 Socket.connect 超时 / 系统 ETIMEDOUT 对应的 SocketException
+  static bool _isTimeoutError(Object e) {
+    if (e is TimeoutException) return true;
+    if (e is! SocketException) return false;
+    final code = e.osError?.errorCode;
+    return code == 110 || code == 60 || code == 10060 || e.message.contains('timed out');
+  }
+  
   // 保持原有的公共接口以兼容旧代码
   static Future<Map<String, int>> testLatency(List<String> ips, [int? port, int maxLatency = 300]) async {
     // 根据当前是否启用 HTTPing 来决定使用的端口
@@ -343,6 +513,93 @@ class CloudflareTestService {
     return controller.stream;
   }
   
+  // 全量扫描的取消标志，由 cancelFullScan 设置
+  static bool _fullScanCancelRequested = false;
+
+  /// 对每个 /24 各测一个地址的全量扫描（仅原生核心可用时）
+  ///
+  /// 结果和检查点保存在程序目录，中断后再次调用会从上次的位置继续，
+  /// [restart] 为 true 时从头开始。完成后返回延迟最低的 [count] 个节点。
+  static Stream<TestProgress> fullScanWithProgress({
+    required int count,
+    required int maxLatency,
+    bool restart = false,
+  }) {
+    final controller = StreamController<TestProgress>();
+    _executeFullScan(controller, count, maxLatency, restart);
+    return controller.stream;
+  }
+
+  /// 请求取消正在进行的全量扫描，已完成的批次保留在检查点中
+  static void cancelFullScan() {
+    _fullScanCancelRequested = true;
+  }
+
+  static Future<void> _executeFullScan(
+    StreamController<TestProgress> controller,
+    int count,
+    int maxLatency,
+    bool restart,
+  ) async {
+    const totalSteps = 2;
+    try {
+      if (!NativeCore.isAvailable) {
+        throw TestException(messageKey: 'testFailed', detailKey: 'checkNetworkOrRequirements');
+      }
+      _fullScanCancelRequested = false;
+      final outputPath = path.join(File(Platform.resolvedExecutable).parent.path, AppConfig.fullScanFileName);
+      await _log.info('开始全量扫描，结果文件: $outputPath', tag: _logTag);
+      controller.add(TestProgress(
+        step: 1,
+        totalSteps: totalSteps,
+        messageKey: 'testingDelay',
+        detailKey: 'nodeProgress',
+        detailParams: {'current': 0, 'total': 0},
+        progress: 0.0,
+        subProgress: 0.0,
+      ));
+
+      final result = await NativeCore.fullScan(
+        outputPath: outputPath,
+        checkpointPath: '$outputPath.checkpoint',
+        ranges: AppConfig.cloudflareIpRanges,
+        port: _defaultPort,
+        maxLatencyMs: maxLatency,
+        maxInflight: AppConfig.nativeMaxInflight,
+        keepBest: count,
+        restart: restart,
+        shouldCancel: () => _fullScanCancelRequested,
+        onProgress: (done, total) {
+          if (total == 0) return;
+          controller.add(TestProgress(
+            step: 1,
+            totalSteps: totalSteps,
+            messageKey: 'testingDelay',
+            detailKey: 'nodeProgress',
+            detailParams: {'current': done, 'total': total},
+            progress: done / total,
+            subProgress: done / total,
+          ));
+        },
+      );
+      if (result == null || result.state == FullScanState.failed) {
+        throw TestException(messageKey: 'testFailed', detailKey: result?.error ?? 'noQualifiedNodes');
+      }
+
+      NativeCore.recordLatencyResults(result.best);
+      final servers = _filterValidServers(result.best, maxLatency, _defaultPort);
+      if (servers.isEmpty && result.state == FullScanState.completed) {
+        throw TestException(messageKey: 'noQualifiedNodes', detailKey: 'checkNetworkOrRequirements');
+      }
+      await _logTopNodes(servers, result.reachable);
+      _reportCompletion(controller, totalSteps, servers);
+    } catch (e, stackTrace) {
+      _handleTestError(controller, e, stackTrace);
+    } finally {
+      await controller.close();
+    }
+  }
+
   // ===== 优化3：拆分长方法，提高可维护性 =====
   
   // 执行测试的主方法（拆分为多个子方法）
@@ -374,11 +631,13 @@ class CloudflareTestService {
       // 步骤1：准备阶段
       currentStep = await _reportPreparationStep(controller, currentStep, totalSteps);
       
-      // 步骤2：IP采样
-      final sampleIps = await _performIpSampling(controller, currentStep, totalSteps, testCount);
+      // 步骤2：IP采样（分段TCPing在测速时自行按IP段采样，跳过这一步）
+      final sampleIps = _useBanditSampling
+          ? const <String>[]
+          : await _performIpSampling(controller, currentStep, totalSteps, testCount);
       currentStep++;
       
-      if (sampleIps.isEmpty) {
+      if (!_useBanditSampling && sampleIps.isEmpty) {
         throw TestException(
           messageKey: 'testFailed',
           detailKey: 'noQualifiedNodes',
@@ -392,6 +651,7 @@ class CloudflareTestService {
         currentStep, 
         totalSteps, 
         sampleIps, 
+        testCount,
         testPort, 
         maxLatency
       );
@@ -409,12 +669,16 @@ class CloudflareTestService {
         );
       }
       
-      // 按延迟排序
-      validServers.sort((a, b) => a.ping.compareTo(b.ping));
+      // 按得分排序：原生引擎按 AppConfig.latencyScoreWeights 计算得分，Dart实现没有得分时按平均延迟
+      final scores = <String, double>{
+        for (final r in pingResults)
+          r['ip'] as String: ((r['score'] ?? r['latency']) as num).toDouble(),
+      };
+      validServers.sort((a, b) => scores[a.ip]!.compareTo(scores[b.ip]!));
       
       // 步骤4：Trace响应速度测试
       currentStep++;
-      final finalServers = await _performTraceTest(
+      var finalServers = await _performTraceTest(
         controller,
         currentStep,
         totalSteps,
@@ -422,6 +686,11 @@ class CloudflareTestService {
         count
       );
       
+      // 可选：对Trace排名靠前的节点做下载吞吐测试，按稳定吞吐重新排序
+      if (AppConfig.throughputRanking && NativeCore.isAvailable) {
+        finalServers = await _rankByThroughput(controller, currentStep, totalSteps, finalServers);
+      }
+      
       // 记录最优节点
       await _logTopNodes(finalServers, validServers.length);
       
@@ -500,68 +769,71 @@ class CloudflareTestService {
     return sampleIps;
   }
   
-  // 执行延迟测试
+  // 原生核心可用时按各IP段的优质节点比例分配探测预算，不预先采样
+  static bool get _useBanditSampling =>
+      !httping && NativeCore.isAvailable && AppConfig.banditSampling && AppConfig.ipv6SampleShare <= 0;
+  
+  // 执行延迟测试，分段TCPing时 sampleIps 为空，按 testCount 分配预算
   static Future<List<Map<String, dynamic>>> _performLatencyTest(
     StreamController<TestProgress> controller,
     int currentStep,
     int totalSteps,
     List<String> sampleIps,
+    int testCount,
     int testPort,
     int maxLatency
   ) async {
+    final useBandit = _useBanditSampling;
     controller.add(TestProgress(
       step: currentStep,
       totalSteps: totalSteps,
       messageKey: 'testingDelay',
       detailKey: 'nodeProgress',
-      detailParams: {'current': 0, 'total': sampleIps.length},
+      detailParams: {'current': 0, 'total': useBandit ? testCount : sampleIps.length},
       progress: currentStep / totalSteps,
       subProgress: 0.0,
     ));
     
     await _log.info('开始${httping ? "HTTPing" : "TCPing"}延迟测速...', tag: _logTag);
     
-    var pingResults = await testLatencyUnified(
-      ips: sampleIps,
-      port: testPort,
-      useHttping: httping,
-      maxLatency: maxLatency,
-      onProgress: (current, total) {
-        controller.add(TestProgress(
-          step: currentStep,
-          totalSteps: totalSteps,
-          messageKey: 'testingDelay',
-          detailKey: 'nodeProgress',
-          detailParams: {'current': current, 'total': total},
-          progress: (currentStep - 1 + current / total) / totalSteps,
-          subProgress: current / total,
-        ));
-      },
-    );
+    void reportProgress(int current, int total) {
+      controller.add(TestProgress(
+        step: currentStep,
+        totalSteps: totalSteps,
+        messageKey: 'testingDelay',
+        detailKey: 'nodeProgress',
+        detailParams: {'current': current, 'total': total},
+        progress: (currentStep - 1 + current / total) / totalSteps,
+        subProgress: current / total,
+      ));
+    }
+    
+    var pingResults = useBandit
+        ? await _testLatencyBandit(testCount, testPort, maxLatency, reportProgress)
+        : await testLatencyUnified(
+            ips: sampleIps,
+            port: testPort,
+            useHttping: httping,
+            maxLatency: maxLatency,
+            onProgress: reportProgress,
+          );
     
     // 如果是TCPing模式且没有找到有效节点，自动切换到HTTPing重试
     if (!httping && pingResults.where((r) => r['lossRate'] as double < 1.0).isEmpty) {
       await _log.warn('TCPing测试全部失败，自动切换到HTTPing重试...', tag: _logTag);
       
-      final httpingTestIps = sampleIps.take(AppConfig.httpingTestIpCount).toList();
-      await _log.info('HTTPing模式将测试 ${httpingTestIps.length} 个IP（原计划: ${sampleIps.length}个）', tag: _logTag);
+      // 分段TCPing没有预先采样，只在需要重试时采样
+      final httpingTestIps = useBandit
+          ? await _sampleIpsFromRanges(AppConfig.httpingTestIpCount)
+          : sampleIps.take(AppConfig.httpingTestIpCount).toList();
+      await _log.info('HTTPing模式将测试 ${httpingTestIps.length} 个IP（原计划: ${useBandit ? testCount : sampleIps.length}个）', tag: _logTag);
       
       pingResults = await testLatencyUnified(
         ips: httpingTestIps,
         port: _httpPort,
         useHttping: true,
         maxLatency: maxLatency,
-        onProgress: (current, total) {
-          controller.add(TestProgress(
-            step: currentStep,
-            totalSteps: totalSteps,
-            messageKey: 'testingDelay',
-            detailKey: 'nodeProgress',
-            detailParams: {'current': current, 'total': total},
-            progress: (currentStep - 1 + current / total) / totalSteps,
-            subProgress: current / total,
-          ));
-        },
+        onProgress: reportProgress,
       );
     }
     
@@ -650,6 +922,11 @@ class CloudflareTestService {
       progress: currentStep / totalSteps,
     ));
     
+    // 原生核心可用时对全部低延迟节点并发进行Trace测试
+    if (NativeCore.isAvailable) {
+      return _performTraceTestNative(controller, currentStep, totalSteps, validServers, count);
+    }
+    
     final finalServers = <ServerModel>[];
     
     if (validServers.length <= count) {
@@ -735,6 +1012,123 @@ class CloudflareTestService {
     return finalServers;
   }
   
+  // 原生Trace测试：并发测试全部节点，按访问时间排序后取前 count 个
+  static Future<List<ServerModel>> _performTraceTestNative(
+    StreamController<TestProgress> controller,
+    int currentStep,
+    int totalSteps,
+    List<ServerModel> validServers,
+    int count
+  ) async {
+    await _log.info('开始原生Trace测速，测试全部 ${validServers.length} 个低延迟节点', tag: _logTag);
+    
+    final stopwatch = Stopwatch()..start();
+    final probes = await NativeCore.httpProbe(
+      ips: validServers.map((s) => s.ip).toList(),
+      port: 80,  // 与 _testTraceSpeed 相同，始终使用80端口
+      timeoutMs: 5000,
+      maxInflight: AppConfig.nativeHttpMaxInflight,
+      onProgress: (current, total) {
+        controller.add(TestProgress(
+          step: currentStep,
+          totalSteps: totalSteps,
+          messageKey: 'testingResponseSpeed',
+          detailKey: 'nodeProgress',
+          detailParams: {'current': current, 'total': total},
+          progress: (currentStep - 1 + current / total) / totalSteps,
+          subProgress: current / total,
+        ));
+      },
+    );
+    stopwatch.stop();
+    
+    final testedServers = <ServerModel>[];
+    for (var i = 0; i < validServers.length && i < probes.length; i++) {
+      final server = validServers[i];
+      final probe = probes[i];
+      final colo = probe['colo'] as String;
+      final totalMs = probe['totalMs'] as int;
+      // 失败时与 _testTraceSpeed 一致：速度9999，位置US
+      final traceSpeed = (probe['received'] as int) > 0 ? totalMs.toDouble() : 9999.0;
+      final location = colo.isNotEmpty ? UIUtils.getColoCountryCode(colo, defaultCode: 'US') : 'US';
+      
+      await _log.debug('节点 ${server.ip} - 延迟: ${server.ping}ms, Trace时间: ${traceSpeed.toStringAsFixed(0)}ms, 位置: $location, 数据中心: $colo', tag: _logTag);
+      
+      testedServers.add(ServerModel(
+        id: server.id,
+        name: server.name,
+        location: location,
+        ip: server.ip,
+        port: server.port,
+        ping: server.ping,
+        downloadSpeed: traceSpeed,
+      ));
+    }
+    
+    await _log.info('原生Trace测速完成，耗时: ${stopwatch.elapsedMilliseconds}ms', tag: _logTag);
+    NativeCore.recordColos({
+      for (final probe in probes)
+        if ((probe['colo'] as String).isNotEmpty) probe['ip'] as String: probe['colo'] as String,
+    });
+    
+    // 节点不足时保持原有顺序，否则按Trace访问速度重新排序
+    if (testedServers.length > count) {
+      testedServers.sort((a, b) => a.downloadSpeed.compareTo(b.downloadSpeed));
+    }
+    return testedServers.take(count).toList();
+  }
+  
+  // 吞吐排序：对前 AppConfig.throughputTestCount 个节点逐个测下载吞吐，按稳定吞吐从高到低排列，
+  // 其余节点保持Trace顺序排在后面。逐个测试避免多个节点互相抢占带宽
+  static Future<List<ServerModel>> _rankByThroughput(
+    StreamController<TestProgress> controller,
+    int currentStep,
+    int totalSteps,
+    List<ServerModel> servers
+  ) async {
+    final candidates = servers.take(AppConfig.throughputTestCount).toList();
+    if (candidates.length < 2) return servers;
+    
+    await _log.info('开始吞吐测试，测试前 ${candidates.length} 个节点', tag: _logTag);
+    final mbps = <String, double>{};
+    for (var i = 0; i < candidates.length; i++) {
+      controller.add(TestProgress(
+        step: currentStep,
+        totalSteps: totalSteps,
+        messageKey: 'testingThroughput',
+        detailKey: 'nodeProgress',
+        detailParams: {'current': i + 1, 'total': candidates.length},
+        progress: currentStep / totalSteps,
+        subProgress: (i + 1) / candidates.length,
+      ));
+      
+      final server = candidates[i];
+      final result = await NativeCore.throughput(
+        ip: server.ip,
+        port: 80,  // 与Trace测试相同，使用明文HTTP
+        connections: AppConfig.throughputConnections,
+        duration: AppConfig.throughputTestDuration,
+      );
+      mbps[server.ip] = (result?['mbps'] as double?) ?? 0.0;
+      if (result != null) {
+        await _log.debug('节点 ${server.ip} - 稳定吞吐: ${(result['mbps'] as double).toStringAsFixed(1)}Mbps, '
+            '峰值: ${(result['peakMbps'] as double).toStringAsFixed(1)}Mbps, 爬升: ${result['rampUpMs']}ms, '
+            '首字节: ${result['ttfbMs']}ms, 连接: ${result['connected']}/${result['failed']}失败', tag: _logTag);
+      }
+    }
+    
+    // 稳定排序：吞吐相同（例如都失败）时保持Trace顺序
+    final order = {for (var i = 0; i < candidates.length; i++) candidates[i].ip: i};
+    candidates.sort((a, b) {
+      final byMbps = mbps[b.ip]!.compareTo(mbps[a.ip]!);
+      return byMbps != 0 ? byMbps : order[a.ip]!.compareTo(order[b.ip]!);
+    });
+    for (final node in candidates) {
+      await _log.info('吞吐排序: ${node.ip} - ${mbps[node.ip]!.toStringAsFixed(1)}Mbps', tag: _logTag);
+    }
+    return [...candidates, ...servers.skip(candidates.length)];
+  }
+  
   // 记录最优节点
   static Future<void> _logTopNodes(List<ServerModel> finalServers, int totalValidCount) async {
     await _log.info('找到 ${finalServers.length} 个节点（从 $totalValidCount 个低延迟节点中选出）', tag: _logTag);
@@ -995,12 +1389,30 @@ class CloudflareTestService {
   
   // 从 IP 段中采样 - 简化版本
   static Future<List<String>> _sampleIpsFromRanges(int targetCount) async {
-    final ips = <String>[];
-    
     // 使用内置的 Cloudflare IP 段常量
     final cloudflareIpRanges = AppConfig.cloudflareIpRanges;
     await _log.debug('使用 ${cloudflareIpRanges.length} 个内置IP段', tag: _logTag);
     
+    // 原生核心可用时在原生侧以整数采样，只在需要时才生成字符串
+    if (NativeCore.isAvailable) {
+      final stopwatch = Stopwatch()..start();
+      final ipv6Count = (targetCount * AppConfig.ipv6SampleShare).round();
+      final ips = NativeCore.sampleIps(cloudflareIpRanges, targetCount - ipv6Count);
+      if (ipv6Count <= 0) {
+        await _log.info('原生采样了 ${ips.length} 个IP，耗时: ${stopwatch.elapsedMicroseconds}μs', tag: _logTag);
+        return ips;
+      }
+      // IPv6 段无法按 /24 分散采样，改用原生排列采样后与 IPv4 混合打乱
+      final mixed = [...ips, ...NativeCore.sampleAddresses(AppConfig.cloudflareIpv6Ranges, ipv6Count)]
+        ..shuffle();
+      await _log.info('原生采样了 ${mixed.length} 个IP（IPv6 ${mixed.length - ips.length} 个），耗时: ${stopwatch.elapsedMicroseconds}μs', tag: _logTag);
+      return mixed;
+    }
+    
+    final ips = <String>[];
+    // 用于补充采样时的去重，避免 List.contains 的线性查找
+    final seen = <String>{};
+    
     // 计算每个IP段需要采样的数量
     final samplesPerRange = (targetCount / cloudflareIpRanges.length).ceil();
     
@@ -1008,6 +1420,7 @@ class CloudflareTestService {
     for (final range in cloudflareIpRanges) {
       final rangeIps = _sampleFromCidr(range, samplesPerRange);
       ips.addAll(rangeIps);
+      seen.addAll(rangeIps);
       
       if (ips.length >= targetCount) {
         break;
@@ -1032,7 +1445,7 @@ class CloudflareTestService {
       for (int i = 0; i < additionalNeeded && ips.length < targetCount; i++) {
         final range = largeRanges[random.nextInt(largeRanges.length)];
         final rangeIps = _sampleFromCidr(range, 1);
-        if (rangeIps.isNotEmpty && !ips.contains(rangeIps.first)) {
+        if (rangeIps.isNotEmpty && seen.add(rangeIps.first)) {
           ips.add(rangeIps.first);
         }
       }
@@ -1051,6 +1464,7 @@ class CloudflareTestService {
     List<int> latencies = [];
     int successCount = 0;
     int actualAttempts = 0; // 实际尝试次数
+    int timeouts = 0; // 超时次数，供并发窗口区分拥塞和普通失败
     
     await _log.debug('[TCPing] 开始测试 $ip:$port (超时: ${maxLatency}ms)', tag: _logTag);
     
@@ -1094,6 +1508,7 @@ class CloudflareTestService {
         }
         
       } catch (e) {
+        if (_isTimeoutError(e)) timeouts++;
         // 统一的错误日志处理
         String errorDetail = '';
         if (e is SocketException) {
@@ -1139,6 +1554,7 @@ class CloudflareTestService {
       'lossRate': lossRate,
       'sent': actualAttempts,
       'received': successCount,
+      'timeouts': timeouts,
       'colo': '', // TCPing模式无法获取地区信息
     };
   }
@@ -1182,6 +1598,62 @@ class TestProgress {
   bool get isCompleted => step == totalSteps;
 }
 
+// 测速并发窗口（AIMD）
+//
+// 慢启动阶段每个成功的IP让窗口加一；之后每一轮（完成一个窗口的IP）加一。
+// 一轮中超时比例过高时按比例收缩，避免大量超时连接占满家用路由器的NAT表；
+// 被拒绝等其他失败不触发收缩，每个窗口最多收缩一次。与原生核心的
+// AimdController 一致，只是没有本机资源错误的处理。
+class _AimdWindow {
+  static const double _decreaseFactor = 0.75;
+  static const double _timeoutRatioThreshold = 0.5;
+  
+  final int min;
+  final int max;
+  double _size;
+  bool _slowStart = true;
+  int _roundCompletions = 0;
+  int _roundTimeouts = 0;
+  int _sinceDecrease = 0;  // 上次收缩后完成的IP数
+  int decreases = 0;
+  
+  _AimdWindow({required this.min, required this.max, required int initial})
+      : _size = initial.clamp(min, max).toDouble();
+  
+  int get size => _size.toInt();
+  
+  void onSuccess() {
+    _size = math.min(max.toDouble(), _size + (_slowStart ? 1.0 : 1.0 / _size));
+    _completeOne();
+  }
+  
+  // 超时是拥塞的信号，计入收缩比例
+  void onTimeout() {
+    _roundTimeouts++;
+    _completeOne();
+  }
+  
+  // 被拒绝、重置等与拥塞无关的失败，只算一次完成
+  void onFailure() {
+    _completeOne();
+  }
+  
+  void _completeOne() {
+    _sinceDecrease++;
+    if (++_roundCompletions < size) return;
+    final ratio = _roundTimeouts / _roundCompletions;
+    _roundCompletions = 0;
+    _roundTimeouts = 0;
+    // 每个窗口最多收缩一次，避免同一波拥塞把窗口一路压到最小值
+    if (ratio > _timeoutRatioThreshold && (_sinceDecrease >= size || decreases == 0)) {
+      _size = math.max(min.toDouble(), _size * _decreaseFactor);
+      _slowStart = false;
+      decreases++;
+      _sinceDecrease = 0;
+    }
+  }
+}
+
 // 自定义测试异常类
 class TestException implements Exception {
   final String messageKey;
@@ -1200,11 +1672,13 @@ class TestException implements Exception {
 class CloudflareTestDialog extends StatefulWidget {
   final VoidCallback? onComplete;
   final VoidCallback? onError;
+  final bool fullScan;  // 为true时执行可取消、可续扫的全量扫描
   
   const CloudflareTestDialog({
     super.key,
     this.onComplete,
     this.onError,
+    this.fullScan = false,
   });
 
   @override
@@ -1215,6 +1689,7 @@ class _CloudflareTestDialogState extends State<CloudflareTestDialog> {
   StreamSubscription<TestProgress>? _progressSubscription;
   TestProgress? _currentProgress;
   bool _isCompleted = false;
+  bool _isCancelling = false;
 
   @override
   void initState() {
@@ -1245,13 +1720,15 @@ class _CloudflareTestDialogState extends State<CloudflareTestDialog> {
     }
 
     // 使用新的带进度的测试方法
-    final stream = CloudflareTestService.testServersWithProgress(
-      count: AppConfig.defaultTestNodeCount,
-      maxLatency: AppConfig.defaultMaxLatency,
-      testCount: AppConfig.defaultSampleCount,
-      location: 'AUTO',
-      useHttping: false, // 使用TCPing
-    );
+    final stream = widget.fullScan
+        ? context.read<ServerProvider>().fullScan()
+        : CloudflareTestService.testServersWithProgress(
+            count: AppConfig.defaultTestNodeCount,
+            maxLatency: AppConfig.defaultMaxLatency,
+            testCount: AppConfig.defaultSampleCount,
+            location: 'AUTO',
+            useHttping: false, // 使用TCPing
+          );
     
     _progressSubscription = stream.listen(
       (progress) {
@@ -1305,6 +1782,8 @@ class _CloudflareTestDialogState extends State<CloudflareTestDialog> {
         return l10n.testingDelay;
       case 'testingResponseSpeed':
         return l10n.testingResponseSpeed;
+      case 'testingThroughput':
+        return l10n.testingThroughput;
       case 'testCompleted':
         return l10n.testCompleted;
       case 'disconnecting':
@@ -1362,6 +1841,12 @@ class _CloudflareTestDialogState extends State<CloudflareTestDialog> {
     final l10n = AppLocalizations.of(context);
     final serverProvider = context.read<ServerProvider>();
     
+    // 全量扫描在还没有结果时被取消，保留原有节点
+    if (servers.isEmpty) {
+      Navigator.of(context).pop();
+      return;
+    }
+    
     // 先清空所有旧节点
     await serverProvider.clearAllServers();
     
@@ -1482,6 +1967,17 @@ class _CloudflareTestDialogState extends State<CloudflareTestDialog> {
             size: 48,
             color: Colors.green[400],
           ),
+        // 全量扫描进行中显示取消按钮，取消后扫描结束时按已有结果保存
+        if (widget.fullScan && !_isCompleted && _currentProgress?.hasError != true)
+          TextButton(
+            onPressed: _isCancelling ? null : () {
+              context.read<ServerProvider>().cancelFullScan();
+              setState(() {
+                _isCancelling = true;
+              });
+            },
+            child: Text(l10n.cancel),
+          ),
         // 修改：错误状态时显示关闭按钮
         if (_currentProgress?.hasError == true) ...[
           const SizedBox(height: 8), // 减少间距
@@ -0,0 +1,2672 @@
+import 'dart:collection';
+import 'dart:convert';
+import 'dart:io';
+import 'dart:ffi';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import '../app_config.dart';
+import '../models/server_model.dart';
+import '../utils/log_service.dart';
+
+// ============ 原生核心 FFI 结构体（与 windows/native/core/native_api.h 保持一致）============
+
+/// TCPing参数
+final class CfvpnTcpingOptions extends Struct {
+  @Int32()
+  external int attempts;
+  @Int32()
+  external int timeoutMs;
+  @Int32()
+  external int minValidLatencyMs;
+  @Int32()
+  external int intervalMs;
+  @Int32()
+  external int maxInflight;
+  @Int32()
+  external int adaptiveInflight;
+  @Int32()
+  external int minInflight;
+  @Int32()
+  external int initialInflight;
+  @Int32()
+  external int stopAfterGood;
+  @Int32()
+  external int goodLatencyMs;
+  @Float()
+  external double goodLossRate;
+  @Int32()
+  external int failureWindow;
+  @Float()
+  external double failureRateThreshold;
+  @Int32()
+  external int extraAttempts;
+  @Float()
+  external double extraJitterRatio;
+  @Float()
+  external double scoreMean;
+  @Float()
+  external double scoreP50;
+  @Float()
+  external double scoreP90;
+  @Float()
+  external double scoreP99;
+  @Float()
+  external double scoreJitter;
+  @Float()
+  external double scoreLoss;
+}
+
+/// 单个IP的探测结果
+final class CfvpnProbeResult extends Struct {
+  @Uint32()
+  external int ip;
+  @Uint16()
+  external int port;
+  @Uint16()
+  external int reserved;
+  @Int32()
+  external int latencyMs;
+  @Int32()
+  external int sent;
+  @Int32()
+  external int received;
+  @Float()
+  external double lossRate;
+  @Int32()
+  external int p50Ms;
+  @Int32()
+  external int p90Ms;
+  @Int32()
+  external int p99Ms;
+  @Float()
+  external double jitterMs;
+  @Float()
+  external double score;
+}
+
+/// 原生TCPing任务句柄
+final class CfvpnTcpingJob extends Opaque {}
+
+/// HTTPing / Trace 参数
+final class CfvpnHttpProbeOptions extends Struct {
+  @Int32()
+  external int requests;
+  @Int32()
+  external int timeoutMs;
+  @Int32()
+  external int maxInflight;
+  @Int32()
+  external int expectedStatus;
+  external Pointer<Utf8> host;
+  external Pointer<Utf8> path;
+}
+
+/// 单个IP的HTTP探测结果
+final class CfvpnHttpProbeResult extends Struct {
+  @Uint32()
+  external int ip;
+  @Uint16()
+  external int port;
+  @Uint16()
+  external int status;
+  @Int32()
+  external int connectMs;
+  @Int32()
+  external int ttfbMs;
+  @Int32()
+  external int totalMs;
+  @Int32()
+  external int sent;
+  @Int32()
+  external int received;
+  @Array(8)
+  external Array<Uint8> colo;
+  @Array(4)
+  external Array<Uint8> loc;
+}
+
+/// 原生HTTP探测任务句柄
+final class CfvpnHttpProbeJob extends Opaque {}
+
+/// 下载吞吐测试参数（0 表示默认值）
+final class CfvpnThroughputOptions extends Struct {
+  @Int32()
+  external int connections;
+  @Int32()
+  external int durationMs;
+  @Int32()
+  external int connectTimeoutMs;
+  @Int32()
+  external int sampleIntervalMs;
+  external Pointer<Utf8> host;
+  external Pointer<Utf8> path;
+}
+
+/// 下载吞吐测试结果
+final class CfvpnThroughputResult extends Struct {
+  @Int64()
+  external int bytes;
+  @Double()
+  external double sustainedMbps;
+  @Double()
+  external double peakMbps;
+  @Int32()
+  external int connected;
+  @Int32()
+  external int failed;
+  @Int32()
+  external int connectMs;
+  @Int32()
+  external int ttfbMs;
+  @Int32()
+  external int rampUpMs;
+  @Int32()
+  external int elapsedMs;
+  @Uint16()
+  external int status;
+  @Uint16()
+  external int reserved;
+  @Int32()
+  external int sampleCount;
+}
+
+/// 原生吞吐测试任务句柄
+final class CfvpnThroughputJob extends Opaque {}
+
+/// 原生CIDR索引句柄
+final class CfvpnCidrIndex extends Opaque {}
+
+/// IPv4/IPv6地址，bytes为网络字节序，IPv4只使用前4字节
+final class CfvpnIpAddress extends Struct {
+  @Uint8()
+  external int family;
+  @Array(3)
+  external Array<Uint8> reserved;
+  @Array(16)
+  external Array<Uint8> bytes;
+}
+
+/// 原生IPv4/IPv6排列采样器句柄
+final class CfvpnAddressSampler extends Opaque {}
+
+/// 全量扫描参数
+final class CfvpnFullScanOptions extends Struct {
+  external Pointer<Utf8> ranges;
+  external Pointer<Utf8> outputPath;
+  external Pointer<Utf8> checkpointPath;
+  @Uint64()
+  external int seed;
+  @Uint16()
+  external int port;
+  @Uint16()
+  external int reserved;
+  @Int32()
+  external int minValidLatencyMs;
+  @Int32()
+  external int maxLatencyMs;
+  @Int32()
+  external int attempts;
+  @Int32()
+  external int maxInflight;
+  @Int32()
+  external int chunkBlocks;
+  @Int32()
+  external int keepBest;
+  @Int32()
+  external int writeFailures;
+  @Int32()
+  external int restart;
+}
+
+/// 全量扫描进度
+final class CfvpnFullScanStatus extends Struct {
+  @Int64()
+  external int totalBlocks;
+  @Int64()
+  external int doneBlocks;
+  @Int64()
+  external int resumedFrom;
+  @Int64()
+  external int reachable;
+  @Int32()
+  external int state;
+  @Int32()
+  external int reserved;
+}
+
+/// 原生全量扫描任务句柄
+final class CfvpnFullScanJob extends Opaque {}
+
+/// 写入节点质量缓存的一次探测结果
+final class CfvpnNodeSample extends Struct {
+  @Uint32()
+  external int ip;
+  @Int32()
+  external int latencyMs;
+  @Float()
+  external double lossRate;
+  @Array(4)
+  external Array<Uint8> colo;
+}
+
+/// 节点质量缓存中的一条记录
+final class CfvpnNodeQuality extends Struct {
+  @Uint32()
+  external int ip;
+  @Float()
+  external double latencyMs;
+  @Float()
+  external double lossRate;
+  @Float()
+  external double score;
+  @Int64()
+  external int lastSeen;
+  @Int32()
+  external int samples;
+  @Int32()
+  external int failureStreak;
+  @Array(4)
+  external Array<Uint8> colo;
+  @Int32()
+  external int reserved;
+}
+
+/// 原生节点质量缓存句柄
+final class CfvpnNodeCache extends Opaque {}
+
+/// 按段分配预算的TCPing参数，为 0 的字段使用原生默认值
+final class CfvpnBanditOptions extends Struct {
+  @Int32()
+  external int policy;
+  @Int32()
+  external int armPrefix;
+  @Int32()
+  external int batch;
+  @Float()
+  external double priorWeight;
+  @Float()
+  external double maxPrior;
+  @Int32()
+  external int historyMaxAgeSec;
+  external Pointer<CfvpnNodeCache> history;
+  @Uint64()
+  external int seed;
+}
+
+/// 流量环形缓冲区的一个分辨率层级，与 core/traffic_ring.h 的 TrafficTierHeader 一致
+final class CfvpnTrafficTier extends Struct {
+  @Int64()
+  external int writeCount;
+  @Int32()
+  external int capacity;
+  @Int32()
+  external int intervalMs;
+  @Int64()
+  external int samplesOffset;
+  @Int64()
+  external int reserved;
+}
+
+/// 流量环形缓冲区头部，与 core/traffic_ring.h 的 TrafficRingHeader 一致
+final class CfvpnTrafficRingHeader extends Struct {
+  @Uint32()
+  external int magic;
+  @Int32()
+  external int tierCount;
+  @Array(3)
+  external Array<CfvpnTrafficTier> tiers;
+}
+
+/// 原生流量采样器句柄
+final class CfvpnTrafficSampler extends Opaque {}
+
+/// 原生异步日志句柄
+final class CfvpnLogger extends Opaque {}
+
+/// v2ray配置生成参数
+final class CfvpnV2rayConfigParams extends Struct {
+  external Pointer<Utf8> serverIp;
+  external Pointer<Utf8> serverName;
+  external Pointer<Utf8> userId;
+  @Int32()
+  external int serverPort;
+  @Int32()
+  external int socksPort;
+  @Int32()
+  external int httpPort;
+  @Int32()
+  external int globalProxy;
+}
+
+/// 缓存了已解析配置模板的原生配置生成器句柄
+final class CfvpnConfigBuilder extends Opaque {}
+
+/// 字符串池中的一段UTF-8（不以NUL结尾）
+final class CfvpnStringRef extends Struct {
+  @Int32()
+  external int offset;
+  @Int32()
+  external int length;
+}
+
+/// 一条解析后的分享链接，字符串字段指向批次的字符串池
+final class CfvpnShareLink extends Struct {
+  @Int32()
+  external int protocol;
+  @Int32()
+  external int port;
+  @Int32()
+  external int line;
+  @Int32()
+  external int reserved;
+  external CfvpnStringRef name;
+  external CfvpnStringRef address;
+  external CfvpnStringRef userId;
+  external CfvpnStringRef method;
+  external CfvpnStringRef network;
+  external CfvpnStringRef security;
+  external CfvpnStringRef host;
+  external CfvpnStringRef path;
+  external CfvpnStringRef sni;
+}
+
+/// 订阅中无法解析的一行
+final class CfvpnLinkError extends Struct {
+  @Int32()
+  external int line;
+  external CfvpnStringRef message;
+}
+
+/// 一次订阅解析的结果批次
+final class CfvpnLinkBatch extends Opaque {}
+
+/// v2ray进程看护参数
+final class CfvpnSupervisorOptions extends Struct {
+  external Pointer<Utf8> executable;
+  external Pointer<Utf8> workingDirectory;
+  external Pointer<Pointer<Utf8>> arguments;
+  @Int32()
+  external int argumentCount;
+  @Int32()
+  external int readyPortCount;
+  external Pointer<Uint16> readyPorts;
+  @Int32()
+  external int readyTimeoutMs;
+  @Int32()
+  external int maxRestarts;
+  @Int32()
+  external int backoffInitialMs;
+  @Int32()
+  external int backoffMaxMs;
+  @Int32()
+  external int stopGraceMs;
+}
+
+/// v2ray进程看护状态
+final class CfvpnSupervisorStatus extends Struct {
+  @Int32()
+  external int state;
+  @Int32()
+  external int restarts;
+  @Int32()
+  external int lastExitCode;
+  @Int32()
+  external int reserved;
+  @Int64()
+  external int pid;
+  @Int64()
+  external int readyLatencyUs;
+  @Array(256)
+  external Array<Uint8> lastError;
+}
+
+/// 原生v2ray进程看护句柄
+final class CfvpnSupervisor extends Opaque {}
+
+/// 节点健康检查参数，0 表示默认值
+final class CfvpnHealthOptions extends Struct {
+  @Int32()
+  external int activeIntervalMs;
+  @Int32()
+  external int standbyIntervalMs;
+  @Int32()
+  external int timeoutMs;
+  @Int32()
+  external int maxLatencyMs;
+  @Int32()
+  external int maxJitterMs;
+  @Float()
+  external double maxLossRate;
+  @Int32()
+  external int degradedChecks;
+  @Int32()
+  external int cooldownMs;
+}
+
+/// 单个节点的健康统计
+final class CfvpnNodeHealth extends Struct {
+  @Float()
+  external double latencyMs;
+  @Float()
+  external double jitterMs;
+  @Float()
+  external double lossRate;
+  @Int32()
+  external int samples;
+  @Int32()
+  external int failureStreak;
+  @Uint8()
+  external int degraded;
+  @Uint8()
+  external int active;
+  @Array(2)
+  external Array<Uint8> reserved;
+}
+
+/// 节点健康检查句柄
+final class CfvpnHealthMonitor extends Opaque {}
+
+/// 进程内DNS解析器参数，数值字段为0时使用默认值
+final class CfvpnDnsOptions extends Struct {
+  external Pointer<Utf8> upstreams;
+  @Int32()
+  external int timeoutMs;
+  @Int32()
+  external int cacheCapacity;
+  @Int32()
+  external int minTtlSec;
+  @Int32()
+  external int maxTtlSec;
+  @Int32()
+  external int negativeTtlSec;
+  @Int32()
+  external int prefetchHits;
+  @Float()
+  external double prefetchRatio;
+  @Int32()
+  external int disableIpv6;
+  @Int32()
+  external int listenPort;
+}
+
+/// 一次解析的结果
+final class CfvpnDnsAnswer extends Struct {
+  @Int32()
+  external int status;
+  @Int32()
+  external int ttlSec;
+  @Int32()
+  external int fromCache;
+  @Int32()
+  external int addressCount;
+}
+
+/// DNS解析器句柄
+final class CfvpnDnsResolver extends Opaque {}
+
+/// 进行中的解析
+final class CfvpnDnsQuery extends Opaque {}
+
+/// 本地中继参数，数值字段为0时使用默认值
+final class CfvpnRelayOptions extends Struct {
+  @Int32()
+  external int listenPort;
+  @Int32()
+  external int upstreamPort;
+  @Int32()
+  external int maxConnections;
+  @Int32()
+  external int maxDestinations;
+  @Int32()
+  external int bufferBytes;
+  @Int32()
+  external int disableZeroCopy;
+}
+
+/// 按目标汇总的中继流量
+final class CfvpnRelayTalker extends Struct {
+  @Array(128)
+  external Array<Uint8> destination;
+  @Int64()
+  external int bytesUp;
+  @Int64()
+  external int bytesDown;
+  @Int64()
+  external int connections;
+  @Int32()
+  external int active;
+  @Int32()
+  external int reserved;
+}
+
+/// 本地中继句柄
+final class CfvpnRelay extends Opaque {}
+
+/// runner 启动预热的结果
+final class CfvpnPrewarmStatus extends Struct {
+  @Int32()
+  external int state;
+  @Int32()
+  external int nodeCacheSize;
+  @Int32()
+  external int templateLoaded;
+  @Int32()
+  external int v2rayFound;
+  @Int32()
+  external int geoMissing;
+  @Int32()
+  external int reserved;
+  @Int64()
+  external int v2raySize;
+  @Int64()
+  external int startedUs;
+  @Int64()
+  external int totalUs;
+  @Int64()
+  external int nodeCacheUs;
+  @Int64()
+  external int templateUs;
+  @Int64()
+  external int filesUs;
+  @Int64()
+  external int prefetchedBytes;
+  @Array(256)
+  external Array<Uint8> message;
+}
+
+/// 原生看护的v2ray进程状态（与 CFVPN_SUPERVISOR_* 一致）
+enum V2raySupervisorState { stopped, starting, ready, backoff, failed }
+
+class V2raySupervisorStatus {
+  final V2raySupervisorState state;
+  final int restarts;
+  final int lastExitCode;
+  final int pid;
+  final Duration readyLatency;
+  final String lastError;
+
+  const V2raySupervisorStatus({
+    required this.state,
+    required this.restarts,
+    required this.lastExitCode,
+    required this.pid,
+    required this.readyLatency,
+    required this.lastError,
+  });
+}
+
+/// 健康检查中一个节点的统计
+class NodeHealthStatus {
+  final String ip;
+  /// 握手耗时的 EWMA，没有成功样本时为 -1
+  final double latencyMs;
+  final double jitterMs;
+  final double lossRate;
+  final int samples;
+  final int failureStreak;
+  final bool degraded;
+  final bool active;
+
+  const NodeHealthStatus({
+    required this.ip,
+    required this.latencyMs,
+    required this.jitterMs,
+    required this.lossRate,
+    required this.samples,
+    required this.failureStreak,
+    required this.degraded,
+    required this.active,
+  });
+}
+
+/// 本地中继按目标（"host:port"）统计的流量
+class RelayTalker {
+  final String destination;
+  final int bytesUp;
+  final int bytesDown;
+  final int connections;
+  final int active;
+
+  const RelayTalker({
+    required this.destination,
+    required this.bytesUp,
+    required this.bytesDown,
+    required this.connections,
+    required this.active,
+  });
+
+  int get totalBytes => bytesUp + bytesDown;
+}
+
+/// 全量扫描的结束状态（与 CFVPN_FULL_SCAN_* 一致）
+enum FullScanState { running, completed, cancelled, failed }
+
+class FullScanResult {
+  final FullScanState state;
+  final int totalBlocks;
+  final int doneBlocks;
+  final int resumedFrom;
+  final int reachable;
+  /// 延迟最低的节点，结构与 [NativeCore.tcping] 的结果相同
+  final List<Map<String, dynamic>> best;
+  final String error;
+
+  const FullScanResult({
+    required this.state,
+    required this.totalBlocks,
+    required this.doneBlocks,
+    required this.resumedFrom,
+    required this.reachable,
+    required this.best,
+    required this.error,
+  });
+}
+
+/// 原生解析出的一条分享链接
+class ShareLinkRecord {
+  static const protocolNames = {1: 'vmess', 2: 'vless', 3: 'trojan', 4: 'ss'};
+
+  final String protocol;
+  final int port;
+  final int line;
+  final String name;
+  final String address;
+  final String userId;
+  final String method;
+  final String network;
+  final String security;
+  final String host;
+  final String path;
+  final String sni;
+
+  const ShareLinkRecord({
+    required this.protocol,
+    required this.port,
+    required this.line,
+    required this.name,
+    required this.address,
+    required this.userId,
+    required this.method,
+    required this.network,
+    required this.security,
+    required this.host,
+    required this.path,
+    required this.sni,
+  });
+
+  ServerModel toServerModel() {
+    return ServerModel(
+      id: '$protocol-$address-$port',
+      name: name.isEmpty ? '$address:$port' : name,
+      location: '',
+      ip: address,
+      port: port,
+    );
+  }
+}
+
+/// 订阅解析结果：成功的链接和按行号记录的错误（行号0表示整份订阅无法解码）
+class SubscriptionParseResult {
+  final List<ShareLinkRecord> links;
+  final Map<int, String> errors;
+
+  const SubscriptionParseResult(this.links, this.errors);
+}
+
+/// 一个流量样本，上/下行为采样开始以来的累计字节数
+class TrafficPoint {
+  final int timeMs;
+  final int upBytes;
+  final int downBytes;
+
+  const TrafficPoint(this.timeMs, this.upBytes, this.downBytes);
+}
+
+/// 原生采样线程写入的分层流量环形缓冲区的只读视图
+///
+/// 直接映射原生内存，不复制整个缓冲区：层级0为全分辨率（默认250ms，保留1小时），
+/// 层级1、2为降采样（5秒保留1天、1分钟保留7天）。
+/// 读取协议见 core/traffic_ring.h：先读写入计数，复制样本，再读一次计数并
+/// 丢弃期间可能被覆盖的样本。x64上对齐的64位读取是原子的，
+/// 且写入顺序对读者可见，所以这里不需要额外的屏障。
+class TrafficRingView {
+  static const int _sampleWords = 3;  // 每个样本 3 个 int64
+
+  final Pointer<CfvpnTrafficRingHeader> _header;
+  final Int64List _words;
+
+  TrafficRingView._(this._header, this._words);
+
+  int get tierCount => _header.ref.tierCount;
+
+  /// 层级 [tier] 相邻样本的间隔
+  Duration interval(int tier) =>
+      Duration(milliseconds: _header.ref.tiers[tier].intervalMs);
+
+  /// 层级 [tier] 能保留的时长
+  Duration retention(int tier) {
+    final info = _header.ref.tiers[tier];
+    return Duration(milliseconds: info.intervalMs * info.capacity);
+  }
+
+  /// 最新的全分辨率样本，还没有样本时返回null
+  TrafficPoint? get latest {
+    final info = _header.ref.tiers[0];
+    final count = info.writeCount;
+    if (count == 0) return null;
+    return _sampleAt(info, count - 1);
+  }
+
+  /// 读取层级 [tier] 中时间不早于 [sinceMs] 的样本，按时间升序返回
+  List<TrafficPoint> read(int tier, {int sinceMs = 0}) {
+    final info = _header.ref.tiers[tier];
+    final end = info.writeCount;
+    final begin = end - info.capacity > 0 ? end - info.capacity : 0;
+
+    final newestFirst = <TrafficPoint>[];
+    var index = end - 1;
+    for (; index >= begin; index--) {
+      final point = _sampleAt(info, index);
+      if (point.timeMs < sinceMs) break;
+      newestFirst.add(point);
+    }
+
+    // 丢弃复制期间可能已被覆盖的最旧样本
+    final validFrom = info.writeCount - info.capacity + 1;
+    final torn = validFrom - (index + 1);
+    if (torn > 0) {
+      newestFirst.removeRange(
+          newestFirst.length - (torn < newestFirst.length ? torn : newestFirst.length),
+          newestFirst.length);
+    }
+    return newestFirst.reversed.toList();
+  }
+
+  TrafficPoint _sampleAt(CfvpnTrafficTier info, int index) {
+    final base = info.samplesOffset ~/ 8 + (index % info.capacity) * _sampleWords;
+    return TrafficPoint(_words[base], _words[base + 1], _words[base + 2]);
+  }
+}
+
+/// 以主机字节序整数保存的IPv4列表
+///
+/// 只在访问元素时才生成点分十进制字符串。采样得到的大量候选IP
+/// 通常只有少数会被展示或保存，没必要一次性全部转换。
+/// [NativeCore.tcping] 识别该类型并直接使用底层的 [packed] 数组。
+class Ipv4List extends ListBase<String> {
+  final Uint32List packed;
+
+  Ipv4List(this.packed);
+
+  @override
+  int get length => packed.length;
+
+  @override
+  set length(int newLength) => throw UnsupportedError('Ipv4List是只读的');
+
+  @override
+  String operator [](int index) => NativeCore.formatIpv4(packed[index]);
+
+  @override
+  void operator []=(int index, String value) => throw UnsupportedError('Ipv4List是只读的');
+}
+
+/// 原生核心服务 - 封装runner可执行文件导出的C接口
+///
+/// 仅Windows桌面端可用（原生核心链接在runner中），其他平台
+/// [isAvailable] 返回false，调用方应回退到Dart实现。
+class NativeCore {
+  static const String _logTag = 'NativeCore';
+  static final LogService _log = LogService.instance;
+
+  // 轮询后台任务进度的间隔
+  static const Duration _pollInterval = Duration(milliseconds: 50);
+
+  // 与 native_api.h 中 cfvpn_tcping_stop_reason 的返回值一致
+  static const int _stopCompleted = 0;
+  static const int _stopEnoughGood = 1;
+  static const int _stopTooManyFailures = 2;
+
+  // 与 native_api.h 中 CFVPN_FULL_SCAN_* 一致
+  static const int _fullScanRunning = 0;
+  static const int _fullScanFailed = 3;
+
+  static String _stopReasonText(int reason) {
+    switch (reason) {
+      case _stopEnoughGood:
+        return '已找到足够的优质节点';
+      case _stopTooManyFailures:
+        return '最近失败率过高';
+      default:
+        return '已取消';
+    }
+  }
+
+  static DynamicLibrary? _library;
+  static bool _resolved = false;
+
+  /// 加载runner导出的符号，失败时返回null
+  static DynamicLibrary? get _lib {
+    if (!_resolved) {
+      _resolved = true;
+      if (Platform.isWindows) {
+        try {
+          final library = DynamicLibrary.executable();
+          // 检查一个必需的符号，旧版runner没有导出时回退到Dart实现
+          library.lookup('cfvpn_tcping_start');
+          _library = library;
+        } catch (e) {
+          _log.warn('原生核心不可用，使用Dart实现: $e', tag: _logTag);
+          _library = null;
+        }
+      }
+    }
+    return _library;
+  }
+
+  /// 原生核心是否可用
+  static bool get isAvailable => _lib != null;
+
+  // ============ TCPing ============
+
+  static late final _tcpingStart = _lib!.lookupFunction<
+      Pointer<CfvpnTcpingJob> Function(Pointer<Uint32>, Int32, Uint16, Pointer<CfvpnTcpingOptions>),
+      Pointer<CfvpnTcpingJob> Function(Pointer<Uint32>, int, int, Pointer<CfvpnTcpingOptions>)>('cfvpn_tcping_start');
+  static late final _tcpingStartAddresses = _lib!.lookupFunction<
+      Pointer<CfvpnTcpingJob> Function(Pointer<CfvpnIpAddress>, Int32, Uint16, Pointer<CfvpnTcpingOptions>),
+      Pointer<CfvpnTcpingJob> Function(Pointer<CfvpnIpAddress>, int, int, Pointer<CfvpnTcpingOptions>)>('cfvpn_tcping_start_addresses');
+  static late final _tcpingCompleted = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnTcpingJob>),
+      int Function(Pointer<CfvpnTcpingJob>)>('cfvpn_tcping_completed');
+  static late final _tcpingIsDone = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnTcpingJob>),
+      int Function(Pointer<CfvpnTcpingJob>)>('cfvpn_tcping_is_done');
+  static late final _tcpingResults = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnTcpingJob>, Pointer<CfvpnProbeResult>, Int32),
+      int Function(Pointer<CfvpnTcpingJob>, Pointer<CfvpnProbeResult>, int)>('cfvpn_tcping_results');
+  static late final _tcpingStopReason = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnTcpingJob>),
+      int Function(Pointer<CfvpnTcpingJob>)>('cfvpn_tcping_stop_reason');
+  static late final _tcpingInflightLimit = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnTcpingJob>),
+      int Function(Pointer<CfvpnTcpingJob>)>('cfvpn_tcping_inflight_limit');
+  static late final _tcpingFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnTcpingJob>),
+      void Function(Pointer<CfvpnTcpingJob>)>('cfvpn_tcping_free');
+
+  // ============ CIDR采样 ============
+
+  static late final _cidrIndexCreate = _lib!.lookupFunction<
+      Pointer<CfvpnCidrIndex> Function(Pointer<Utf8>, Pointer<Int32>),
+      Pointer<CfvpnCidrIndex> Function(Pointer<Utf8>, Pointer<Int32>)>('cfvpn_cidr_index_create');
+  static late final _cidrIndexRangeCount = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnCidrIndex>),
+      int Function(Pointer<CfvpnCidrIndex>)>('cfvpn_cidr_index_range_count');
+  static late final _cidrSample = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnCidrIndex>, Pointer<Uint32>, Int32, Uint64),
+      int Function(Pointer<CfvpnCidrIndex>, Pointer<Uint32>, int, int)>('cfvpn_cidr_sample');
+  static late final _cidrIndexFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnCidrIndex>),
+      void Function(Pointer<CfvpnCidrIndex>)>('cfvpn_cidr_index_free');
+
+  // 最近一次使用的IP段及其索引。IP段通常是 AppConfig.cloudflareIpRanges 常量，
+  // 只需解析一次
+  static List<String>? _indexedRanges;
+  static Pointer<CfvpnCidrIndex> _cidrIndex = nullptr;
+
+  static Pointer<CfvpnCidrIndex> _indexFor(List<String> ranges) {
+    if (_cidrIndex != nullptr && identical(ranges, _indexedRanges)) {
+      return _cidrIndex;
+    }
+    if (_cidrIndex != nullptr) {
+      _cidrIndexFree(_cidrIndex);
+      _cidrIndex = nullptr;
+    }
+
+    final text = ranges.join('\n').toNativeUtf8();
+    final invalid = calloc<Int32>();
+    try {
+      _cidrIndex = _cidrIndexCreate(text, invalid);
+      if (invalid.value > 0) {
+        _log.warn('忽略 ${invalid.value} 个无效的CIDR', tag: _logTag);
+      }
+      if (_cidrIndex != nullptr) {
+        _indexedRanges = ranges;
+        _log.debug('已建立CIDR索引，共 ${_cidrIndexRangeCount(_cidrIndex)} 个IP段', tag: _logTag);
+      }
+    } finally {
+      calloc.free(text);
+      calloc.free(invalid);
+    }
+    return _cidrIndex;
+  }
+
+  /// 从IP段中采样最多 [count] 个不重复的IP
+  ///
+  /// 采样策略与 CloudflareTestService._sampleIpsFromRanges 相同（按 /24 子段分散、
+  /// 避开 .0/.255、结果打乱），但全部在原生侧以整数完成。
+  /// 返回的 [Ipv4List] 按需生成字符串。[seed] 相同时结果相同。
+  static Ipv4List sampleIps(List<String> ranges, int count, {int? seed}) {
+    final index = _indexFor(ranges);
+    if (index == nullptr || count <= 0) return Ipv4List(Uint32List(0));
+
+    final buffer = calloc<Uint32>(count);
+    try {
+      final sampled = _cidrSample(index, buffer, count, seed ?? DateTime.now().microsecondsSinceEpoch);
+      return Ipv4List(Uint32List.fromList(buffer.asTypedList(sampled)));
+    } finally {
+      calloc.free(buffer);
+    }
+  }
+
+  static late final _addressSamplerCreate = _lib!.lookupFunction<
+      Pointer<CfvpnAddressSampler> Function(Pointer<Utf8>, Uint64, Pointer<Int32>),
+      Pointer<CfvpnAddressSampler> Function(Pointer<Utf8>, int, Pointer<Int32>)>('cfvpn_address_sampler_create');
+  static late final _addressSamplerNext = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnAddressSampler>, Pointer<CfvpnIpAddress>, Int32),
+      int Function(Pointer<CfvpnAddressSampler>, Pointer<CfvpnIpAddress>, int)>('cfvpn_address_sampler_next');
+  static late final _addressSamplerFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnAddressSampler>),
+      void Function(Pointer<CfvpnAddressSampler>)>('cfvpn_address_sampler_free');
+
+  /// 从IPv4/IPv6前缀中采样最多 [count] 个不重复的地址
+  ///
+  /// 原生侧用带密钥的Feistel排列遍历整个地址空间，不需要去重集合，
+  /// 适用于 /32 这类无法枚举的IPv6段。[seed] 相同时结果相同。
+  static List<String> sampleAddresses(List<String> prefixes, int count, {int? seed}) {
+    if (count <= 0) return const [];
+    final text = prefixes.join('\n').toNativeUtf8();
+    final invalid = calloc<Int32>();
+    final buffer = calloc<CfvpnIpAddress>(count);
+    Pointer<CfvpnAddressSampler> sampler = nullptr;
+    try {
+      sampler = _addressSamplerCreate(text, seed ?? DateTime.now().microsecondsSinceEpoch, invalid);
+      if (invalid.value > 0) {
+        _log.warn('忽略 ${invalid.value} 个无效的地址前缀', tag: _logTag);
+      }
+      if (sampler == nullptr) return const [];
+      final sampled = _addressSamplerNext(sampler, buffer, count);
+      return [for (var i = 0; i < sampled; i++) _formatAddress(buffer[i])];
+    } finally {
+      if (sampler != nullptr) _addressSamplerFree(sampler);
+      calloc.free(text);
+      calloc.free(invalid);
+      calloc.free(buffer);
+    }
+  }
+
+  /// 批量TCPing测试
+  ///
+  /// 返回结构与 CloudflareTestService._testSingleIpLatencyWithLossRate 相同：
+  /// {'ip', 'latency', 'lossRate', 'sent', 'received', 'colo'}。
+  /// 探测在原生后台线程中进行，这里只按 [_pollInterval] 轮询进度，不阻塞UI。
+  /// [ips] 为 [Ipv4List] 时直接使用其整数数组，不再逐个解析字符串。
+  /// [ips] 中含IPv6地址时整批改用地址接口，结果中的 'ip' 保持输入的写法。
+  ///
+  /// [adaptive] 为 true 时并发数在 [minInflight]..[maxInflight] 之间按 AIMD 调整。
+  /// [stopAfterGood] 大于 0 时找到这么多延迟低于 [goodLatencyMs]、丢包率低于
+  /// [goodLossRate] 的IP后立即停止；[failureWindow] 大于 0 时最近这么多个IP的
+  /// 失败比例达到 [failureRateThreshold] 也会停止。提前停止时未探测的IP不会出现在结果中。
+  ///
+  /// 每个IP的样本记入原生直方图，结果额外带有 'p50'、'p90'、'p99'、'jitter'
+  /// 和 'score'（越小越好）。[extraAttempts] 大于 0 时抖动超过平均延迟的
+  /// [extraJitterRatio] 的IP最多追加这么多次测试；[scoreWeights] 为
+  /// {'mean','p50','p90','p99','jitter','loss'} 的权重，为空时得分等于平均延迟。
+  static Future<List<Map<String, dynamic>>> tcping({
+    required List<String> ips,
+    required int port,
+    required int timeoutMs,
+    required int attempts,
+    required int minValidLatencyMs,
+    required int intervalMs,
+    required int maxInflight,
+    bool adaptive = false,
+    int minInflight = 0,
+    int initialInflight = 0,
+    int stopAfterGood = 0,
+    int goodLatencyMs = 0,
+    double goodLossRate = 0,
+    int failureWindow = 0,
+    double failureRateThreshold = 0,
+    int extraAttempts = 0,
+    double extraJitterRatio = 0,
+    Map<String, double> scoreWeights = const {},
+    Function(int current, int total)? onProgress,
+  }) async {
+    // 解析IP，无效的直接记为失败
+    final List<int> targets;
+    final invalid = <String>[];
+    // 含IPv6地址时改用地址接口，结果按下标对应回 addressTargets
+    List<String>? addressTargets;
+    if (ips is Ipv4List) {
+      targets = ips.packed;
+    } else if (_hasIpv6(ips)) {
+      targets = const [];
+      addressTargets = _splitAddresses(ips, invalid);
+    } else {
+      targets = <int>[];
+      for (final ip in ips) {
+        final value = parseIpv4(ip);
+        if (value == null) {
+          invalid.add(ip);
+        } else {
+          targets.add(value);
+        }
+      }
+    }
+
+    final results = <Map<String, dynamic>>[
+      for (final ip in invalid) _failedResult(ip),
+    ];
+    final targetCount = addressTargets?.length ?? targets.length;
+    if (targetCount == 0) return results;
+
+    final ipBuffer = calloc<Uint32>(targetCount);
+    final addressBuffer = calloc<CfvpnIpAddress>(addressTargets == null ? 1 : targetCount);
+    final options = calloc<CfvpnTcpingOptions>();
+    final resultBuffer = calloc<CfvpnProbeResult>(targetCount);
+    Pointer<CfvpnTcpingJob> job = nullptr;
+
+    try {
+      if (addressTargets != null) {
+        _fillAddresses(addressBuffer, addressTargets);
+      } else {
+        ipBuffer.asTypedList(targetCount).setAll(0, targets);
+      }
+      options.ref
+        ..attempts = attempts
+        ..timeoutMs = timeoutMs
+        ..minValidLatencyMs = minValidLatencyMs
+        ..intervalMs = intervalMs
+        ..maxInflight = maxInflight
+        ..adaptiveInflight = adaptive ? 1 : 0
+        ..minInflight = minInflight
+        ..initialInflight = initialInflight
+        ..stopAfterGood = stopAfterGood
+        ..goodLatencyMs = goodLatencyMs
+        ..goodLossRate = goodLossRate
+        ..failureWindow = failureWindow
+        ..failureRateThreshold = failureRateThreshold
+        ..extraAttempts = extraAttempts
+        ..extraJitterRatio = extraJitterRatio
+        ..scoreMean = scoreWeights['mean'] ?? 0
+        ..scoreP50 = scoreWeights['p50'] ?? 0
+        ..scoreP90 = scoreWeights['p90'] ?? 0
+        ..scoreP99 = scoreWeights['p99'] ?? 0
+        ..scoreJitter = scoreWeights['jitter'] ?? 0
+        ..scoreLoss = scoreWeights['loss'] ?? 0;
+
+      job = addressTargets != null
+          ? _tcpingStartAddresses(addressBuffer, targetCount, port, options)
+          : _tcpingStart(ipBuffer, targetCount, port, options);
+      final started = job;
+      await _waitForJob(
+        isDone: () => _tcpingIsDone(started) != 0,
+        completed: () => _tcpingCompleted(started),
+        onProgress: (completed) => onProgress?.call(completed + invalid.length, ips.length),
+      );
+
+      final stopReason = _tcpingStopReason(job);
+      if (stopReason != _stopCompleted) {
+        await _log.info('原生TCPing提前结束: ${_stopReasonText(stopReason)}，完成 ${_tcpingCompleted(job)}/$targetCount，最终并发 ${_tcpingInflightLimit(job)}', tag: _logTag);
+      } else if (adaptive) {
+        await _log.debug('原生TCPing最终并发 ${_tcpingInflightLimit(job)}', tag: _logTag);
+      }
+
+      final count = _tcpingResults(job, resultBuffer, targetCount);
+      for (var i = 0; i < count; i++) {
+        final result = resultBuffer[i];
+        // 提前结束时未探测的IP直接丢弃
+        if (result.sent == 0 && stopReason != _stopCompleted) continue;
+        results.add(_probeResultMap(result, addressTargets?[i] ?? formatIpv4(result.ip)));
+      }
+      onProgress?.call(ips.length, ips.length);
+    } finally {
+      if (job != nullptr) _tcpingFree(job);
+      calloc.free(ipBuffer);
+      calloc.free(addressBuffer);
+      calloc.free(options);
+      calloc.free(resultBuffer);
+    }
+
+    return results;
+  }
+
+  static Map<String, dynamic> _probeResultMap(CfvpnProbeResult result, String ip) => {
+        'ip': ip,
+        'latency': result.latencyMs,
+        'lossRate': result.lossRate,
+        'sent': result.sent,
+        'received': result.received,
+        'p50': result.p50Ms,
+        'p90': result.p90Ms,
+        'p99': result.p99Ms,
+        'jitter': result.jitterMs,
+        'score': result.score,
+        'colo': '', // TCPing模式无法获取地区信息
+      };
+
+  // ============ HTTPing / Trace ============
+
+  static late final _httpProbeStart = _lib!.lookupFunction<
+      Pointer<CfvpnHttpProbeJob> Function(Pointer<Uint32>, Int32, Uint16, Pointer<CfvpnHttpProbeOptions>),
+      Pointer<CfvpnHttpProbeJob> Function(Pointer<Uint32>, int, int, Pointer<CfvpnHttpProbeOptions>)>('cfvpn_http_probe_start');
+  static late final _httpProbeStartAddresses = _lib!.lookupFunction<
+      Pointer<CfvpnHttpProbeJob> Function(Pointer<CfvpnIpAddress>, Int32, Uint16, Pointer<CfvpnHttpProbeOptions>),
+      Pointer<CfvpnHttpProbeJob> Function(Pointer<CfvpnIpAddress>, int, int, Pointer<CfvpnHttpProbeOptions>)>('cfvpn_http_probe_start_addresses');
+  static late final _httpProbeCompleted = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnHttpProbeJob>),
+      int Function(Pointer<CfvpnHttpProbeJob>)>('cfvpn_http_probe_completed');
+  static late final _httpProbeIsDone = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnHttpProbeJob>),
+      int Function(Pointer<CfvpnHttpProbeJob>)>('cfvpn_http_probe_is_done');
+  static late final _httpProbeResults = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnHttpProbeJob>, Pointer<CfvpnHttpProbeResult>, Int32),
+      int Function(Pointer<CfvpnHttpProbeJob>, Pointer<CfvpnHttpProbeResult>, int)>('cfvpn_http_probe_results');
+  static late final _httpProbeFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnHttpProbeJob>),
+      void Function(Pointer<CfvpnHttpProbeJob>)>('cfvpn_http_probe_free');
+
+  /// 批量HTTP探测（默认请求 /cdn-cgi/trace）
+  ///
+  /// 每个IP使用一条keep-alive连接发送 [requests] 个请求，响应在原生侧原地解析。
+  /// 返回 {'ip', 'status', 'connectMs', 'ttfbMs', 'totalMs', 'sent', 'received',
+  /// 'colo', 'loc'}，耗时没有样本时为 -1。[host] 为空串时使用目标IP作为Host。
+  static Future<List<Map<String, dynamic>>> httpProbe({
+    required List<String> ips,
+    required int port,
+    required int timeoutMs,
+    int requests = 1,
+    int maxInflight = 64,
+    int expectedStatus = 200,
+    String host = 'cloudflare.com',
+    String path = '/cdn-cgi/trace',
+    Function(int current, int total)? onProgress,
+  }) async {
+    final targets = <int>[];
+    final results = <Map<String, dynamic>>[];
+    // 含IPv6地址时改用地址接口，结果按下标对应回 addressTargets
+    List<String>? addressTargets;
+    if (_hasIpv6(ips)) {
+      final invalid = <String>[];
+      addressTargets = _splitAddresses(ips, invalid);
+      results.addAll(invalid.map(_failedHttpResult));
+    } else {
+      for (final ip in ips) {
+        final value = parseIpv4(ip);
+        if (value == null) {
+          results.add(_failedHttpResult(ip));
+        } else {
+          targets.add(value);
+        }
+      }
+    }
+    final targetCount = addressTargets?.length ?? targets.length;
+    if (targetCount == 0) return results;
+    final invalidCount = results.length;
+
+    final ipBuffer = calloc<Uint32>(targetCount);
+    final addressBuffer = calloc<CfvpnIpAddress>(addressTargets == null ? 1 : targetCount);
+    final options = calloc<CfvpnHttpProbeOptions>();
+    final resultBuffer = calloc<CfvpnHttpProbeResult>(targetCount);
+    final hostText = host.toNativeUtf8();
+    final pathText = path.toNativeUtf8();
+    Pointer<CfvpnHttpProbeJob> job = nullptr;
+
+    try {
+      if (addressTargets != null) {
+        _fillAddresses(addressBuffer, addressTargets);
+      } else {
+        ipBuffer.asTypedList(targetCount).setAll(0, targets);
+      }
+      options.ref
+        ..requests = requests
+        ..timeoutMs = timeoutMs
+        ..maxInflight = maxInflight
+        ..expectedStatus = expectedStatus
+        ..host = hostText
+        ..path = pathText;
+
+      job = addressTargets != null
+          ? _httpProbeStartAddresses(addressBuffer, targetCount, port, options)
+          : _httpProbeStart(ipBuffer, targetCount, port, options);
+      final started = job;
+      await _waitForJob(
+        isDone: () => _httpProbeIsDone(started) != 0,
+        completed: () => _httpProbeCompleted(started),
+        onProgress: (completed) => onProgress?.call(completed + invalidCount, ips.length),
+      );
+
+      final count = _httpProbeResults(job, resultBuffer, targetCount);
+      for (var i = 0; i < count; i++) {
+        final result = resultBuffer[i];
+        results.add({
+          'ip': addressTargets?[i] ?? formatIpv4(result.ip),
+          'status': result.status,
+          'connectMs': result.connectMs,
+          'ttfbMs': result.ttfbMs,
+          'totalMs': result.totalMs,
+          'sent': result.sent,
+          'received': result.received,
+          'colo': _readCString(result.colo, 8),
+          'loc': _readCString(result.loc, 4),
+        });
+      }
+      onProgress?.call(ips.length, ips.length);
+    } finally {
+      if (job != nullptr) _httpProbeFree(job);
+      calloc.free(ipBuffer);
+      calloc.free(addressBuffer);
+      calloc.free(options);
+      calloc.free(resultBuffer);
+      calloc.free(hostText);
+      calloc.free(pathText);
+    }
+
+    return results;
+  }
+
+  static Map<String, dynamic> _failedHttpResult(String ip) => {
+    'ip': ip,
+    'status': 0,
+    'connectMs': -1,
+    'ttfbMs': -1,
+    'totalMs': -1,
+    'sent': 0,
+    'received': 0,
+    'colo': '',
+    'loc': '',
+  };
+
+  // ============ 下载吞吐测试 ============
+
+  static late final _throughputStart = _lib!.lookupFunction<
+      Pointer<CfvpnThroughputJob> Function(Pointer<CfvpnIpAddress>, Uint16, Pointer<CfvpnThroughputOptions>),
+      Pointer<CfvpnThroughputJob> Function(Pointer<CfvpnIpAddress>, int, Pointer<CfvpnThroughputOptions>)>('cfvpn_throughput_start');
+  static late final _throughputBytes = _lib!.lookupFunction<
+      Int64 Function(Pointer<CfvpnThroughputJob>),
+      int Function(Pointer<CfvpnThroughputJob>)>('cfvpn_throughput_bytes');
+  static late final _throughputIsDone = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnThroughputJob>),
+      int Function(Pointer<CfvpnThroughputJob>)>('cfvpn_throughput_is_done');
+  static late final _throughputResult = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnThroughputJob>, Pointer<CfvpnThroughputResult>),
+      int Function(Pointer<CfvpnThroughputJob>, Pointer<CfvpnThroughputResult>)>('cfvpn_throughput_result');
+  static late final _throughputCancel = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnThroughputJob>),
+      void Function(Pointer<CfvpnThroughputJob>)>('cfvpn_throughput_cancel');
+  static late final _throughputFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnThroughputJob>),
+      void Function(Pointer<CfvpnThroughputJob>)>('cfvpn_throughput_free');
+
+  /// 对一个节点做多连接下载吞吐测试
+  ///
+  /// 并行打开 [connections] 条连接请求 [path]，最长 [duration] 后结束；
+  /// 响应体在原生侧直接丢弃，只统计字节数。返回
+  /// {'ip', 'mbps', 'peakMbps', 'rampUpMs', 'ttfbMs', 'connectMs', 'bytes',
+  /// 'connected', 'failed', 'status'}，耗时没有样本时为 -1。
+  /// [shouldCancel] 返回 true 时提前结束，已收到的数据仍计入结果。
+  /// [onProgress] 报告已收到的字节数。IP 无效时返回null。
+  static Future<Map<String, dynamic>?> throughput({
+    required String ip,
+    required int port,
+    int connections = 4,
+    Duration duration = const Duration(seconds: 10),
+    String host = 'speed.cloudflare.com',
+    String path = '',
+    bool Function()? shouldCancel,
+    Function(int bytes)? onProgress,
+  }) async {
+    if (InternetAddress.tryParse(ip) == null) return null;
+    final address = calloc<CfvpnIpAddress>();
+    final options = calloc<CfvpnThroughputOptions>();
+    final result = calloc<CfvpnThroughputResult>();
+    final hostText = host.toNativeUtf8();
+    final pathText = path.toNativeUtf8();
+    Pointer<CfvpnThroughputJob> job = nullptr;
+
+    try {
+      _fillAddresses(address, [ip]);
+      options.ref
+        ..connections = connections
+        ..durationMs = duration.inMilliseconds
+        ..host = hostText
+        ..path = pathText;
+      job = _throughputStart(address, port, options);
+      final started = job;
+      var cancelRequested = false;
+      await _waitForJob(
+        isDone: () {
+          if (!cancelRequested && (shouldCancel?.call() ?? false)) {
+            cancelRequested = true;
+            _throughputCancel(started);
+          }
+          return _throughputIsDone(started) != 0;
+        },
+        completed: () => _throughputBytes(started),
+        onProgress: (bytes) => onProgress?.call(bytes),
+      );
+
+      _throughputResult(job, result);
+      final r = result.ref;
+      return {
+        'ip': ip,
+        'mbps': r.sustainedMbps,
+        'peakMbps': r.peakMbps,
+        'rampUpMs': r.rampUpMs,
+        'ttfbMs': r.ttfbMs,
+        'connectMs': r.connectMs,
+        'bytes': r.bytes,
+        'connected': r.connected,
+        'failed': r.failed,
+        'status': r.status,
+      };
+    } finally {
+      if (job != nullptr) _throughputFree(job);
+      calloc.free(address);
+      calloc.free(options);
+      calloc.free(result);
+      calloc.free(hostText);
+      calloc.free(pathText);
+    }
+  }
+
+  // ============ 全量扫描 ============
+
+  static late final _fullScanStart = _lib!.lookupFunction<
+      Pointer<CfvpnFullScanJob> Function(Pointer<CfvpnFullScanOptions>),
+      Pointer<CfvpnFullScanJob> Function(Pointer<CfvpnFullScanOptions>)>('cfvpn_full_scan_start');
+  static late final _fullScanStatus = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnFullScanJob>, Pointer<CfvpnFullScanStatus>),
+      void Function(Pointer<CfvpnFullScanJob>, Pointer<CfvpnFullScanStatus>)>('cfvpn_full_scan_status');
+  static late final _fullScanBest = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnFullScanJob>, Pointer<CfvpnProbeResult>, Int32),
+      int Function(Pointer<CfvpnFullScanJob>, Pointer<CfvpnProbeResult>, int)>('cfvpn_full_scan_best');
+  static late final _fullScanError = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnFullScanJob>, Pointer<Utf8>, Int32),
+      int Function(Pointer<CfvpnFullScanJob>, Pointer<Utf8>, int)>('cfvpn_full_scan_error');
+  static late final _fullScanCancel = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnFullScanJob>),
+      void Function(Pointer<CfvpnFullScanJob>)>('cfvpn_full_scan_cancel');
+  static late final _fullScanFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnFullScanJob>),
+      void Function(Pointer<CfvpnFullScanJob>)>('cfvpn_full_scan_free');
+
+  /// 对 [ranges] 中每个 /24 各测一个地址的全量扫描
+  ///
+  /// 结果流式追加到 [outputPath]（CSV），每 [chunkBlocks] 个 /24 保存一次
+  /// [checkpointPath]；用相同的 [ranges]、[seed]、[port] 再次调用时从检查点
+  /// 继续，[restart] 为 true 时从头开始。[shouldCancel] 返回 true 时取消，
+  /// 当前一批不写入，下次续扫时重测。[onProgress] 报告已完成/总共的 /24 数。
+  /// 参数为 0 时使用原生默认值。参数无效时返回null。
+  static Future<FullScanResult?> fullScan({
+    required String outputPath,
+    String? checkpointPath,
+    List<String>? ranges,
+    int seed = 1,
+    int port = 443,
+    int maxLatencyMs = 0,
+    int minValidLatencyMs = -1,
+    int attempts = 0,
+    int maxInflight = 0,
+    int chunkBlocks = 0,
+    int keepBest = 0,
+    bool restart = false,
+    bool Function()? shouldCancel,
+    Function(int done, int total)? onProgress,
+  }) async {
+    final options = calloc<CfvpnFullScanOptions>();
+    final status = calloc<CfvpnFullScanStatus>();
+    final rangesText = (ranges ?? const <String>[]).join('\n').toNativeUtf8();
+    final outputText = outputPath.toNativeUtf8();
+    final checkpointText = (checkpointPath ?? '').toNativeUtf8();
+    Pointer<CfvpnFullScanJob> job = nullptr;
+
+    try {
+      options.ref
+        ..ranges = rangesText
+        ..outputPath = outputText
+        ..checkpointPath = checkpointText
+        ..seed = seed
+        ..port = port
+        ..minValidLatencyMs = minValidLatencyMs
+        ..maxLatencyMs = maxLatencyMs
+        ..attempts = attempts
+        ..maxInflight = maxInflight
+        ..chunkBlocks = chunkBlocks
+        ..keepBest = keepBest
+        ..restart = restart ? 1 : 0;
+      job = _fullScanStart(options);
+      if (job == nullptr) {
+        await _log.warn('原生全量扫描参数无效: $outputPath', tag: _logTag);
+        return null;
+      }
+
+      final started = job;
+      var cancelRequested = false;
+      await _waitForJob(
+        isDone: () {
+          if (!cancelRequested && (shouldCancel?.call() ?? false)) {
+            cancelRequested = true;
+            _fullScanCancel(started);
+          }
+          _fullScanStatus(started, status);
+          return status.ref.state != _fullScanRunning;
+        },
+        completed: () {
+          _fullScanStatus(started, status);
+          return status.ref.doneBlocks;
+        },
+        onProgress: (done) => onProgress?.call(done, status.ref.totalBlocks),
+      );
+
+      _fullScanStatus(job, status);
+      final s = status.ref;
+      final capacity = keepBest > 0 ? keepBest : 5;
+      final bestBuffer = calloc<CfvpnProbeResult>(capacity);
+      final best = <Map<String, dynamic>>[];
+      try {
+        final count = _fullScanBest(job, bestBuffer, capacity);
+        for (var i = 0; i < count; i++) {
+          final result = bestBuffer[i];
+          best.add({
+            'ip': formatIpv4(result.ip),
+            'latency': result.latencyMs,
+            'lossRate': result.lossRate,
+            'sent': result.sent,
+            'received': result.received,
+            'colo': '',
+          });
+        }
+      } finally {
+        calloc.free(bestBuffer);
+      }
+
+      var error = '';
+      if (s.state == _fullScanFailed) {
+        final buffer = calloc<Uint8>(256);
+        _fullScanError(job, buffer.cast(), 256);
+        error = buffer.cast<Utf8>().toDartString();
+        calloc.free(buffer);
+        await _log.warn('原生全量扫描失败: $error', tag: _logTag);
+      } else {
+        await _log.info('原生全量扫描结束: /24 ${s.doneBlocks}/${s.totalBlocks}（从 ${s.resumedFrom} 续扫），可用 ${s.reachable}', tag: _logTag);
+      }
+      return FullScanResult(
+        state: FullScanState.values[s.state],
+        totalBlocks: s.totalBlocks,
+        doneBlocks: s.doneBlocks,
+        resumedFrom: s.resumedFrom,
+        reachable: s.reachable,
+        best: best,
+        error: error,
+      );
+    } finally {
+      if (job != nullptr) _fullScanFree(job);
+      calloc.free(options);
+      calloc.free(status);
+      calloc.free(rangesText);
+      calloc.free(outputText);
+      calloc.free(checkpointText);
+    }
+  }
+
+  // ============ 节点质量缓存 ============
+
+  static late final _nodeCacheOpen = _lib!.lookupFunction<
+      Pointer<CfvpnNodeCache> Function(Pointer<Utf8>, Int32),
+      Pointer<CfvpnNodeCache> Function(Pointer<Utf8>, int)>('cfvpn_node_cache_open');
+  static late final _nodeCacheSize = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnNodeCache>),
+      int Function(Pointer<CfvpnNodeCache>)>('cfvpn_node_cache_size');
+  static late final _nodeCacheUpdate = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnNodeCache>, Pointer<CfvpnNodeSample>, Int32, Int64),
+      void Function(Pointer<CfvpnNodeCache>, Pointer<CfvpnNodeSample>, int, int)>('cfvpn_node_cache_update');
+  static late final _nodeCacheBest = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnNodeCache>, Pointer<CfvpnNodeQuality>, Int32, Int64, Int32, Int32),
+      int Function(Pointer<CfvpnNodeCache>, Pointer<CfvpnNodeQuality>, int, int, int, int)>('cfvpn_node_cache_best');
+
+  // 缓存文件在进程生命周期内保持映射，由系统在退出时写回
+  static Pointer<CfvpnNodeCache>? _nodeCacheHandle;
+
+  static Pointer<CfvpnNodeCache> get _nodeCache {
+    if (_nodeCacheHandle != null) return _nodeCacheHandle!;
+    if (!isAvailable) return _nodeCacheHandle = nullptr;
+
+    // runner 启动时已在预热线程中打开的缓存直接接管
+    final prewarmed = _prewarmTakeNodeCache();
+    if (prewarmed != nullptr) {
+      _log.debug('使用预热打开的节点质量缓存，共 ${_nodeCacheSize(prewarmed)} 个节点', tag: _logTag);
+      return _nodeCacheHandle = prewarmed;
+    }
+
+    final path = '${File(Platform.resolvedExecutable).parent.path}${Platform.pathSeparator}${AppConfig.nodeCacheFileName}';
+    final nativePath = path.toNativeUtf8();
+    try {
+      final cache = _nodeCacheOpen(nativePath, AppConfig.nodeCacheCapacity);
+      if (cache == nullptr) {
+        _log.warn('无法打开节点质量缓存: $path', tag: _logTag);
+      } else {
+        _log.debug('已打开节点质量缓存，共 ${_nodeCacheSize(cache)} 个节点', tag: _logTag);
+      }
+      return _nodeCacheHandle = cache;
+    } finally {
+      calloc.free(nativePath);
+    }
+  }
+
+  static int get _nowSeconds => DateTime.now().millisecondsSinceEpoch ~/ 1000;
+
+  /// 把延迟测试结果合并到节点质量缓存
+  ///
+  /// [results] 与 [tcping] 的返回结构相同。从未成功过的IP不会进入缓存。
+  static void recordLatencyResults(List<Map<String, dynamic>> results) {
+    final cache = _nodeCache;
+    if (cache == nullptr || results.isEmpty) return;
+
+    final samples = calloc<CfvpnNodeSample>(results.length);
+    try {
+      var count = 0;
+      for (final result in results) {
+        final ip = parseIpv4(result['ip'] as String);
+        if (ip == null) continue;
+        final latency = result['latency'] as int;
+        final lossRate = result['lossRate'] as double;
+        samples[count]
+          ..ip = ip
+          ..latencyMs = latency > 0 && latency < 999 ? latency : -1
+          ..lossRate = lossRate;
+        count++;
+      }
+      _nodeCacheUpdate(cache, samples, count, _nowSeconds);
+    } finally {
+      calloc.free(samples);
+    }
+  }
+
+  /// 把Trace测试得到的数据中心代码写入节点质量缓存，不影响延迟统计
+  static void recordColos(Map<String, String> colos) {
+    final cache = _nodeCache;
+    if (cache == nullptr || colos.isEmpty) return;
+
+    final samples = calloc<CfvpnNodeSample>(colos.length);
+    try {
+      var count = 0;
+      colos.forEach((ipText, colo) {
+        final ip = parseIpv4(ipText);
+        if (ip == null || colo.isEmpty) return;
+        final sample = samples[count++]
+          ..ip = ip
+          ..latencyMs = -1
+          ..lossRate = -1;
+        final units = colo.codeUnits;
+        for (var i = 0; i < 3 && i < units.length; i++) {
+          sample.colo[i] = units[i];
+        }
+      });
+      _nodeCacheUpdate(cache, samples, count, _nowSeconds);
+    } finally {
+      calloc.free(samples);
+    }
+  }
+
+  /// 从节点质量缓存中选出最多 [count] 个历史表现最好的节点
+  ///
+  /// 只考虑 [maxAge] 内探测过、连续失败少于 [maxFailureStreak] 次的节点，
+  /// 按平滑延迟加丢包惩罚排序。返回 {'ip', 'latency', 'lossRate', 'colo', 'lastSeen'}。
+  /// 只读取内存映射中的数据，不做任何网络操作。
+  static List<Map<String, dynamic>> bestCachedNodes({
+    required int count,
+    required Duration maxAge,
+    required int maxFailureStreak,
+  }) {
+    final cache = _nodeCache;
+    if (cache == nullptr || count <= 0) return const [];
+
+    final buffer = calloc<CfvpnNodeQuality>(count);
+    try {
+      final found = _nodeCacheBest(cache, buffer, count, _nowSeconds, maxAge.inSeconds, maxFailureStreak);
+      return [
+        for (var i = 0; i < found; i++)
+          {
+            'ip': formatIpv4(buffer[i].ip),
+            'latency': buffer[i].latencyMs.round(),
+            'lossRate': buffer[i].lossRate,
+            'colo': _readCString(buffer[i].colo, 4),
+            'lastSeen': DateTime.fromMillisecondsSinceEpoch(buffer[i].lastSeen * 1000),
+          },
+      ];
+    } finally {
+      calloc.free(buffer);
+    }
+  }
+
+  // ============ 按段分配预算的TCPing ============
+
+  static late final _banditTcpingStart = _lib!.lookupFunction<
+      Pointer<CfvpnTcpingJob> Function(Pointer<Utf8>, Int32, Uint16, Pointer<CfvpnTcpingOptions>, Pointer<CfvpnBanditOptions>),
+      Pointer<CfvpnTcpingJob> Function(Pointer<Utf8>, int, int, Pointer<CfvpnTcpingOptions>, Pointer<CfvpnBanditOptions>)>('cfvpn_bandit_tcping_start');
+
+  /// 在 [ranges] 中按各段的优质节点比例分轮分配最多 [budget] 个IP做TCPing
+  ///
+  /// 每个段（大段按 [armPrefix] 切开）是一个臂，每轮探测 [batch] 个IP后按
+  /// 本次的优质节点比例和节点质量缓存中的历史，用 Thompson 采样（[ucb] 为
+  /// true 时用 UCB）决定下一轮的IP，找到 [stopAfterGood] 个优质节点后结束。
+  /// 其余参数和返回结构与 [tcping] 相同，只返回实际探测过的IP。
+  static Future<List<Map<String, dynamic>>> banditTcping({
+    required List<String> ranges,
+    required int budget,
+    required int port,
+    required int timeoutMs,
+    required int attempts,
+    required int minValidLatencyMs,
+    required int intervalMs,
+    required int maxInflight,
+    bool adaptive = false,
+    int minInflight = 0,
+    int initialInflight = 0,
+    int stopAfterGood = 0,
+    int goodLatencyMs = 0,
+    double goodLossRate = 0,
+    int extraAttempts = 0,
+    double extraJitterRatio = 0,
+    Map<String, double> scoreWeights = const {},
+    bool ucb = false,
+    int armPrefix = 0,
+    int batch = 0,
+    Function(int current, int total)? onProgress,
+  }) async {
+    if (ranges.isEmpty || budget <= 0) return [];
+
+    final cidrList = ranges.join(',').toNativeUtf8();
+    final options = calloc<CfvpnTcpingOptions>();
+    final banditOptions = calloc<CfvpnBanditOptions>();
+    final resultBuffer = calloc<CfvpnProbeResult>(budget);
+    Pointer<CfvpnTcpingJob> job = nullptr;
+    final results = <Map<String, dynamic>>[];
+
+    try {
+      options.ref
+        ..attempts = attempts
+        ..timeoutMs = timeoutMs
+        ..minValidLatencyMs = minValidLatencyMs
+        ..intervalMs = intervalMs
+        ..maxInflight = maxInflight
+        ..adaptiveInflight = adaptive ? 1 : 0
+        ..minInflight = minInflight
+        ..initialInflight = initialInflight
+        ..stopAfterGood = stopAfterGood
+        ..goodLatencyMs = goodLatencyMs
+        ..goodLossRate = goodLossRate
+        ..extraAttempts = extraAttempts
+        ..extraJitterRatio = extraJitterRatio
+        ..scoreMean = scoreWeights['mean'] ?? 0
+        ..scoreP50 = scoreWeights['p50'] ?? 0
+        ..scoreP90 = scoreWeights['p90'] ?? 0
+        ..scoreP99 = scoreWeights['p99'] ?? 0
+        ..scoreJitter = scoreWeights['jitter'] ?? 0
+        ..scoreLoss = scoreWeights['loss'] ?? 0;
+      banditOptions.ref
+        ..policy = ucb ? 1 : 0
+        ..armPrefix = armPrefix
+        ..batch = batch
+        ..history = _nodeCache;
+
+      job = _banditTcpingStart(cidrList, budget, port, options, banditOptions);
+      if (job == nullptr) {
+        await _log.warn('原生分段TCPing启动失败，IP段无效', tag: _logTag);
+        return results;
+      }
+      final started = job;
+      await _waitForJob(
+        isDone: () => _tcpingIsDone(started) != 0,
+        completed: () => _tcpingCompleted(started),
+        onProgress: (completed) => onProgress?.call(completed, budget),
+      );
+
+      final stopReason = _tcpingStopReason(job);
+      final count = _tcpingResults(job, resultBuffer, budget);
+      for (var i = 0; i < count; i++) {
+        final result = resultBuffer[i];
+        // 最后一轮提前结束时已分配但未探测的IP直接丢弃
+        if (result.sent == 0) continue;
+        results.add(_probeResultMap(result, formatIpv4(result.ip)));
+      }
+      final reason = stopReason == _stopCompleted ? '预算已用完' : _stopReasonText(stopReason);
+      await _log.info('原生分段TCPing结束: $reason，探测 ${results.length}/$budget', tag: _logTag);
+      onProgress?.call(budget, budget);
+    } finally {
+      if (job != nullptr) _tcpingFree(job);
+      calloc.free(cidrList);
+      calloc.free(options);
+      calloc.free(banditOptions);
+      calloc.free(resultBuffer);
+    }
+
+    return results;
+  }
+
+  // ============ 流量采样环 ============
+
+  static late final _trafficSamplerStart = _lib!.lookupFunction<
+      Pointer<CfvpnTrafficSampler> Function(Uint16, Int32, Pointer<Utf8>),
+      Pointer<CfvpnTrafficSampler> Function(int, int, Pointer<Utf8>)>('cfvpn_traffic_sampler_start');
+  static late final _trafficSamplerRing = _lib!.lookupFunction<
+      Pointer<CfvpnTrafficRingHeader> Function(Pointer<CfvpnTrafficSampler>),
+      Pointer<CfvpnTrafficRingHeader> Function(Pointer<CfvpnTrafficSampler>)>('cfvpn_traffic_sampler_ring');
+  static late final _trafficSamplerRingSize = _lib!.lookupFunction<
+      Int64 Function(Pointer<CfvpnTrafficSampler>),
+      int Function(Pointer<CfvpnTrafficSampler>)>('cfvpn_traffic_sampler_ring_size');
+  static late final _trafficSamplerFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnTrafficSampler>),
+      void Function(Pointer<CfvpnTrafficSampler>)>('cfvpn_traffic_sampler_free');
+
+  static Pointer<CfvpnTrafficSampler> _trafficSampler = nullptr;
+  static TrafficRingView? _trafficRing;
+
+  /// 当前采样器的流量环形缓冲区，未启动时为null
+  static TrafficRingView? get trafficRing => _trafficRing;
+
+  /// 启动原生流量采样线程，每 [interval] 通过v2ray api查询名称包含 [pattern] 的
+  /// uplink/downlink计数器并写入环形缓冲区
+  ///
+  /// 采样在原生线程中进行，与界面是否可见无关，Dart端只在需要时读取缓冲区。
+  static TrafficRingView? startTrafficSampler({
+    required int port,
+    required Duration interval,
+    String pattern = '',
+  }) {
+    if (!isAvailable) return null;
+    stopTrafficSampler();
+    final nativePattern = pattern.toNativeUtf8();
+    try {
+      _trafficSampler = _trafficSamplerStart(port, interval.inMilliseconds, nativePattern);
+    } finally {
+      calloc.free(nativePattern);
+    }
+    final header = _trafficSamplerRing(_trafficSampler);
+    final words = header.cast<Int64>().asTypedList(_trafficSamplerRingSize(_trafficSampler) ~/ 8);
+    _trafficRing = TrafficRingView._(header, words);
+    return _trafficRing;
+  }
+
+  /// 停止采样线程并释放缓冲区，之前返回的 [TrafficRingView] 随之失效
+  static void stopTrafficSampler() {
+    _trafficRing = null;
+    if (_trafficSampler != nullptr) {
+      _trafficSamplerFree(_trafficSampler);
+      _trafficSampler = nullptr;
+    }
+  }
+
+  // ============ 异步日志 ============
+
+  // 写入是一次无锁入队，标记为leaf调用以省去线程状态切换
+  static late final _logOpen = _lib!.lookupFunction<
+      Pointer<CfvpnLogger> Function(Pointer<Utf8>, Int64, Int32, Int32, Int32),
+      Pointer<CfvpnLogger> Function(Pointer<Utf8>, int, int, int, int)>('cfvpn_log_open');
+  static late final _logWrite = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnLogger>, Int32, Pointer<Uint8>, Int32, Pointer<Uint8>, Int32),
+      int Function(Pointer<CfvpnLogger>, int, Pointer<Uint8>, int, Pointer<Uint8>, int)>(
+      'cfvpn_log_write', isLeaf: true);
+  static late final _logFlush = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnLogger>),
+      void Function(Pointer<CfvpnLogger>)>('cfvpn_log_flush');
+  static late final _logCloseFiles = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnLogger>),
+      void Function(Pointer<CfvpnLogger>)>('cfvpn_log_close_files');
+  static late final _logClose = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnLogger>),
+      void Function(Pointer<CfvpnLogger>)>('cfvpn_log_close');
+
+  // 与 native_api.h 中的 CFVPN_LOG_* 一致
+  static const Map<String, int> _logLevels = {'DEBUG': 0, 'INFO': 1, 'WARN': 2, 'ERROR': 3};
+
+  // 超过原生单条日志上限（64条记录 × 200字节）的部分会被截断
+  static const int _logMessageCapacity = 12800;
+  static const int _logTagCapacity = 32;
+
+  static Pointer<CfvpnLogger> _logger = nullptr;
+  static Pointer<Uint8> _logMessageBuffer = nullptr;
+  static Pointer<Uint8> _logTagBuffer = nullptr;
+  static late Uint8List _logMessageBytes;
+  static late Uint8List _logTagBytes;
+
+  /// 原生日志是否已打开
+  static bool get isLogOpen => _logger != nullptr;
+
+  /// 在 [directory] 下打开原生异步日志，成功后由原生写线程负责落盘和轮转
+  static bool openLog(String directory) {
+    if (!isAvailable) return false;
+    if (_logger != nullptr) return true;
+    final nativeDir = directory.toNativeUtf8();
+    try {
+      _logger = _logOpen(nativeDir, AppConfig.logMaxFileBytes, AppConfig.logMaxBackups,
+          AppConfig.logMaxOpenFiles, AppConfig.logBinaryFormat ? 1 : 0);
+    } finally {
+      calloc.free(nativeDir);
+    }
+    if (_logger == nullptr) return false;
+    // 复用固定的缓冲区，写日志时不再分配原生内存
+    _logMessageBuffer = calloc<Uint8>(_logMessageCapacity);
+    _logTagBuffer = calloc<Uint8>(_logTagCapacity);
+    _logMessageBytes = _logMessageBuffer.asTypedList(_logMessageCapacity);
+    _logTagBytes = _logTagBuffer.asTypedList(_logTagCapacity);
+    return true;
+  }
+
+  /// 写入一条日志，只复制进原生队列，不等待落盘
+  static void writeLog(String level, String tag, String message) {
+    if (_logger == nullptr) return;
+    final tagBytes = utf8.encode(tag);
+    final tagLength = tagBytes.length < _logTagCapacity ? tagBytes.length : _logTagCapacity;
+    _logTagBytes.setRange(0, tagLength, tagBytes);
+    final messageBytes = utf8.encode(message);
+    var messageLength = messageBytes.length;
+    if (messageLength > _logMessageCapacity) {
+      // 截断时不拆开UTF-8多字节字符
+      messageLength = _logMessageCapacity;
+      while (messageLength > 0 && (messageBytes[messageLength] & 0xC0) == 0x80) {
+        messageLength--;
+      }
+    }
+    _logMessageBytes.setRange(0, messageLength, messageBytes);
+    _logWrite(_logger, _logLevels[level] ?? 1, _logTagBuffer, tagLength, _logMessageBuffer, messageLength);
+  }
+
+  /// 阻塞直到已写入的日志全部落盘
+  static void flushLog() {
+    if (_logger != nullptr) _logFlush(_logger);
+  }
+
+  /// 落盘并关闭所有日志文件（删除日志文件前调用）
+  static void closeLogFiles() {
+    if (_logger != nullptr) _logCloseFiles(_logger);
+  }
+
+  /// 写出剩余日志并关闭原生日志
+  static void closeLog() {
+    if (_logger == nullptr) return;
+    _logClose(_logger);
+    _logger = nullptr;
+    calloc.free(_logMessageBuffer);
+    calloc.free(_logTagBuffer);
+    _logMessageBuffer = nullptr;
+    _logTagBuffer = nullptr;
+  }
+
+  // ============ v2ray配置生成 ============
+
+  static late final _configBuilderCreate = _lib!.lookupFunction<
+      Pointer<CfvpnConfigBuilder> Function(Pointer<Uint8>, Int32),
+      Pointer<CfvpnConfigBuilder> Function(Pointer<Uint8>, int)>('cfvpn_config_builder_create');
+  static late final _configBuilderWrite = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnConfigBuilder>, Pointer<CfvpnV2rayConfigParams>, Pointer<Utf8>),
+      int Function(Pointer<CfvpnConfigBuilder>, Pointer<CfvpnV2rayConfigParams>, Pointer<Utf8>)>(
+      'cfvpn_config_builder_write');
+  static late final _configBuilderFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnConfigBuilder>),
+      void Function(Pointer<CfvpnConfigBuilder>)>('cfvpn_config_builder_free');
+
+  static Pointer<CfvpnConfigBuilder> _configBuilder = nullptr;
+
+  /// 配置模板是否已由原生代码解析并缓存
+  static bool get hasConfigTemplate => _configBuilder != nullptr;
+
+  /// 解析并缓存v2ray配置模板（允许注释），之后每次生成只替换变化的字段
+  static bool loadConfigTemplate(String templateJson) {
+    if (!isAvailable) return false;
+    final bytes = utf8.encode(templateJson);
+    final buffer = calloc<Uint8>(bytes.length);
+    try {
+      buffer.asTypedList(bytes.length).setAll(0, bytes);
+      final builder = _configBuilderCreate(buffer, bytes.length);
+      if (builder == nullptr) {
+        _log.warn('原生代码无法解析v2ray配置模板', tag: _logTag);
+        return false;
+      }
+      if (_configBuilder != nullptr) _configBuilderFree(_configBuilder);
+      _configBuilder = builder;
+      return true;
+    } finally {
+      calloc.free(buffer);
+    }
+  }
+
+  /// 由缓存的模板生成配置并写入 [path]，返回写入的字节数，失败时返回-1。
+  /// [serverName]、[userId] 为空时使用模板中的值。
+  static int writeV2rayConfig(
+    String path, {
+    required String serverIp,
+    required int serverPort,
+    String? serverName,
+    String? userId,
+    required int socksPort,
+    required int httpPort,
+    required bool globalProxy,
+  }) {
+    if (_configBuilder == nullptr) return -1;
+    final params = calloc<CfvpnV2rayConfigParams>();
+    final nativePath = path.toNativeUtf8();
+    final ipText = serverIp.toNativeUtf8();
+    final nameText = (serverName ?? '').toNativeUtf8();
+    final userText = (userId ?? '').toNativeUtf8();
+    try {
+      params.ref
+        ..serverIp = ipText
+        ..serverName = nameText
+        ..userId = userText
+        ..serverPort = serverPort
+        ..socksPort = socksPort
+        ..httpPort = httpPort
+        ..globalProxy = globalProxy ? 1 : 0;
+      return _configBuilderWrite(_configBuilder, params, nativePath);
+    } finally {
+      calloc.free(params);
+      calloc.free(nativePath);
+      calloc.free(ipText);
+      calloc.free(nameText);
+      calloc.free(userText);
+    }
+  }
+
+  // ============ 分享链接解析 ============
+
+  static late final _linksParse = _lib!.lookupFunction<
+      Pointer<CfvpnLinkBatch> Function(Pointer<Uint8>, Int32),
+      Pointer<CfvpnLinkBatch> Function(Pointer<Uint8>, int)>('cfvpn_links_parse');
+  static late final _linksCount = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnLinkBatch>),
+      int Function(Pointer<CfvpnLinkBatch>)>('cfvpn_links_count');
+  static late final _linksRecords = _lib!.lookupFunction<
+      Pointer<CfvpnShareLink> Function(Pointer<CfvpnLinkBatch>),
+      Pointer<CfvpnShareLink> Function(Pointer<CfvpnLinkBatch>)>('cfvpn_links_records');
+  static late final _linksErrorCount = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnLinkBatch>),
+      int Function(Pointer<CfvpnLinkBatch>)>('cfvpn_links_error_count');
+  static late final _linksErrors = _lib!.lookupFunction<
+      Pointer<CfvpnLinkError> Function(Pointer<CfvpnLinkBatch>),
+      Pointer<CfvpnLinkError> Function(Pointer<CfvpnLinkBatch>)>('cfvpn_links_errors');
+  static late final _linksStrings = _lib!.lookupFunction<
+      Pointer<Uint8> Function(Pointer<CfvpnLinkBatch>),
+      Pointer<Uint8> Function(Pointer<CfvpnLinkBatch>)>('cfvpn_links_strings');
+  static late final _linksStringsSize = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnLinkBatch>),
+      int Function(Pointer<CfvpnLinkBatch>)>('cfvpn_links_strings_size');
+  static late final _linksFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnLinkBatch>),
+      void Function(Pointer<CfvpnLinkBatch>)>('cfvpn_links_free');
+
+  /// 批量解析订阅内容（整体base64或逐行的 vmess/vless/trojan/ss 链接）。
+  /// 原生库不可用时返回null，由调用方回退到 Dart 解析。
+  static SubscriptionParseResult? parseSubscription(String data) {
+    if (!isAvailable) return null;
+    final bytes = utf8.encode(data);
+    final buffer = calloc<Uint8>(bytes.isEmpty ? 1 : bytes.length);
+    Pointer<CfvpnLinkBatch> batch = nullptr;
+    try {
+      buffer.asTypedList(bytes.length).setAll(0, bytes);
+      batch = _linksParse(buffer, bytes.length);
+      if (batch == nullptr) return null;
+
+      // 字符串池整体复制一次，各字段按偏移解码
+      final pool = Uint8List.fromList(
+          _linksStrings(batch).asTypedList(_linksStringsSize(batch)));
+      String text(CfvpnStringRef ref) => ref.length == 0
+          ? ''
+          : utf8.decode(Uint8List.sublistView(pool, ref.offset, ref.offset + ref.length),
+              allowMalformed: true);
+
+      final links = <ShareLinkRecord>[];
+      final records = _linksRecords(batch);
+      for (var i = 0; i < _linksCount(batch); i++) {
+        final r = records[i];
+        links.add(ShareLinkRecord(
+          protocol: ShareLinkRecord.protocolNames[r.protocol] ?? 'unknown',
+          port: r.port,
+          line: r.line,
+          name: text(r.name),
+          address: text(r.address),
+          userId: text(r.userId),
+          method: text(r.method),
+          network: text(r.network),
+          security: text(r.security),
+          host: text(r.host),
+          path: text(r.path),
+          sni: text(r.sni),
+        ));
+      }
+      final errors = <int, String>{};
+      final errorRecords = _linksErrors(batch);
+      for (var i = 0; i < _linksErrorCount(batch); i++) {
+        errors[errorRecords[i].line] = text(errorRecords[i].message);
+      }
+      if (errors.isNotEmpty) {
+        _log.debug('订阅中 ${errors.length} 行无法解析', tag: _logTag);
+      }
+      return SubscriptionParseResult(links, errors);
+    } finally {
+      if (batch != nullptr) _linksFree(batch);
+      calloc.free(buffer);
+    }
+  }
+
+  // ============ v2ray进程看护 ============
+
+  static late final _supervisorStart = _lib!.lookupFunction<
+      Pointer<CfvpnSupervisor> Function(Pointer<CfvpnSupervisorOptions>),
+      Pointer<CfvpnSupervisor> Function(Pointer<CfvpnSupervisorOptions>)>('cfvpn_supervisor_start');
+  static late final _supervisorStatus = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnSupervisor>, Pointer<CfvpnSupervisorStatus>),
+      void Function(Pointer<CfvpnSupervisor>, Pointer<CfvpnSupervisorStatus>)>('cfvpn_supervisor_status');
+  static late final _supervisorStop = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnSupervisor>),
+      void Function(Pointer<CfvpnSupervisor>)>('cfvpn_supervisor_stop');
+  static late final _supervisorFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnSupervisor>),
+      void Function(Pointer<CfvpnSupervisor>)>('cfvpn_supervisor_free');
+
+  static Pointer<CfvpnSupervisor> _supervisor = nullptr;
+
+  /// 是否有原生看护的v2ray进程（包括崩溃后等待重启的）
+  static bool get hasV2raySupervisor => _supervisor != nullptr;
+
+  /// 在原生看护线程中启动v2ray。就绪由v2ray输出的 "started" 行触发并
+  /// 确认 [readyPorts] 可连接，意外退出时按指数退避自动重启。
+  static bool startV2raySupervisor({
+    required String executable,
+    required List<String> arguments,
+    String? workingDirectory,
+    required List<int> readyPorts,
+    required Duration readyTimeout,
+    required int maxRestarts,
+  }) {
+    if (!isAvailable) return false;
+    if (_supervisor != nullptr) _supervisorFree(_supervisor);
+    _supervisor = nullptr;
+
+    final options = calloc<CfvpnSupervisorOptions>();
+    final nativeExecutable = executable.toNativeUtf8();
+    final nativeDirectory = (workingDirectory ?? '').toNativeUtf8();
+    final nativeArguments = calloc<Pointer<Utf8>>(arguments.isEmpty ? 1 : arguments.length);
+    final ports = calloc<Uint16>(readyPorts.isEmpty ? 1 : readyPorts.length);
+    try {
+      for (var i = 0; i < arguments.length; i++) {
+        nativeArguments[i] = arguments[i].toNativeUtf8();
+      }
+      for (var i = 0; i < readyPorts.length; i++) {
+        ports[i] = readyPorts[i];
+      }
+      options.ref
+        ..executable = nativeExecutable
+        ..workingDirectory = nativeDirectory
+        ..arguments = nativeArguments
+        ..argumentCount = arguments.length
+        ..readyPorts = ports
+        ..readyPortCount = readyPorts.length
+        ..readyTimeoutMs = readyTimeout.inMilliseconds
+        ..maxRestarts = maxRestarts > 0 ? maxRestarts : -1;
+      _supervisor = _supervisorStart(options);
+      return _supervisor != nullptr;
+    } finally {
+      for (var i = 0; i < arguments.length; i++) {
+        calloc.free(nativeArguments[i]);
+      }
+      calloc.free(nativeArguments);
+      calloc.free(ports);
+      calloc.free(nativeExecutable);
+      calloc.free(nativeDirectory);
+      calloc.free(options);
+    }
+  }
+
+  /// 当前看护状态，没有看护的进程时返回null
+  static V2raySupervisorStatus? v2raySupervisorStatus() {
+    if (_supervisor == nullptr) return null;
+    final status = calloc<CfvpnSupervisorStatus>();
+    try {
+      _supervisorStatus(_supervisor, status);
+      final s = status.ref;
+      final codes = <int>[];
+      for (var i = 0; i < 256 && s.lastError[i] != 0; i++) {
+        codes.add(s.lastError[i]);
+      }
+      return V2raySupervisorStatus(
+        state: V2raySupervisorState.values[s.state.clamp(0, V2raySupervisorState.values.length - 1)],
+        restarts: s.restarts,
+        lastExitCode: s.lastExitCode,
+        pid: s.pid,
+        readyLatency: Duration(microseconds: s.readyLatencyUs),
+        lastError: utf8.decode(codes, allowMalformed: true),
+      );
+    } finally {
+      calloc.free(status);
+    }
+  }
+
+  /// 按 [_pollInterval] 轮询直到就绪，失败、停止或超时返回false
+  static Future<bool> waitV2rayReady(Duration timeout) async {
+    final deadline = DateTime.now().add(timeout);
+    while (DateTime.now().isBefore(deadline)) {
+      final status = v2raySupervisorStatus();
+      if (status == null) return false;
+      switch (status.state) {
+        case V2raySupervisorState.ready:
+          return true;
+        case V2raySupervisorState.failed:
+        case V2raySupervisorState.stopped:
+          return false;
+        case V2raySupervisorState.starting:
+        case V2raySupervisorState.backoff:
+          await Future.delayed(_pollInterval);
+      }
+    }
+    return false;
+  }
+
+  /// 停止看护的v2ray：请求退出后轮询到进程被回收再释放句柄，不阻塞UI。
+  /// 超过 [timeout] 时由释放操作强制结束。
+  static Future<void> stopV2raySupervisor(Duration timeout) async {
+    if (_supervisor == nullptr) return;
+    final supervisor = _supervisor;
+    _supervisor = nullptr;
+    _supervisorStop(supervisor);
+    final status = calloc<CfvpnSupervisorStatus>();
+    try {
+      final deadline = DateTime.now().add(timeout);
+      while (DateTime.now().isBefore(deadline)) {
+        _supervisorStatus(supervisor, status);
+        if (status.ref.state == V2raySupervisorState.stopped.index ||
+            status.ref.state == V2raySupervisorState.failed.index) {
+          break;
+        }
+        await Future.delayed(_pollInterval);
+      }
+    } finally {
+      calloc.free(status);
+      _supervisorFree(supervisor);
+    }
+  }
+
+  static String _readCString(Array<Uint8> chars, int capacity) {
+    final codes = <int>[];
+    for (var i = 0; i < capacity && chars[i] != 0; i++) {
+      codes.add(chars[i]);
+    }
+    return String.fromCharCodes(codes);
+  }
+
+  // ============ 节点健康检查 ============
+
+  static late final _healthStart = _lib!.lookupFunction<
+      Pointer<CfvpnHealthMonitor> Function(Pointer<CfvpnIpAddress>, Int32, Uint16, Pointer<CfvpnHealthOptions>),
+      Pointer<CfvpnHealthMonitor> Function(Pointer<CfvpnIpAddress>, int, int, Pointer<CfvpnHealthOptions>)>('cfvpn_health_monitor_start');
+  static late final _healthActive = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnHealthMonitor>),
+      int Function(Pointer<CfvpnHealthMonitor>)>('cfvpn_health_monitor_active');
+  static late final _healthSnapshot = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnHealthMonitor>, Pointer<CfvpnNodeHealth>, Int32),
+      int Function(Pointer<CfvpnHealthMonitor>, Pointer<CfvpnNodeHealth>, int)>('cfvpn_health_monitor_snapshot');
+  static late final _healthFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnHealthMonitor>),
+      void Function(Pointer<CfvpnHealthMonitor>)>('cfvpn_health_monitor_free');
+
+  static Pointer<CfvpnHealthMonitor> _healthMonitor = nullptr;
+  static List<String> _healthNodes = const [];
+
+  /// 对已连接节点（[nodes] 的第一个）和备用节点做后台健康检查。
+  /// 当前节点持续变差时原生线程自动选出更好的备用节点，
+  /// 通过 [healthActiveNode] 轮询得知。
+  static bool startHealthMonitor({
+    required List<String> nodes,
+    required int port,
+    required Duration activeInterval,
+    required Duration standbyInterval,
+    required int maxLatencyMs,
+    required Duration cooldown,
+  }) {
+    stopHealthMonitor();
+    if (!isAvailable) return false;
+    final invalid = <String>[];
+    final valid = _splitAddresses(nodes, invalid);
+    if (valid.isEmpty || invalid.contains(nodes.first)) return false;
+
+    final addresses = calloc<CfvpnIpAddress>(valid.length);
+    final options = calloc<CfvpnHealthOptions>();
+    try {
+      _fillAddresses(addresses, valid);
+      options.ref
+        ..activeIntervalMs = activeInterval.inMilliseconds
+        ..standbyIntervalMs = standbyInterval.inMilliseconds
+        ..maxLatencyMs = maxLatencyMs
+        ..cooldownMs = cooldown.inMilliseconds;
+      _healthMonitor = _healthStart(addresses, valid.length, port, options);
+      if (_healthMonitor == nullptr) return false;
+      _healthNodes = valid;
+      return true;
+    } finally {
+      calloc.free(addresses);
+      calloc.free(options);
+    }
+  }
+
+  /// 健康检查认定的当前节点，未启动时返回null
+  static String? healthActiveNode() {
+    if (_healthMonitor == nullptr) return null;
+    return _healthNodes[_healthActive(_healthMonitor)];
+  }
+
+  /// 所有节点的健康统计，顺序与启动时一致
+  static List<NodeHealthStatus> healthSnapshot() {
+    if (_healthMonitor == nullptr) return const [];
+    final buffer = calloc<CfvpnNodeHealth>(_healthNodes.length);
+    try {
+      final count = _healthSnapshot(_healthMonitor, buffer, _healthNodes.length);
+      return [
+        for (var i = 0; i < count; i++)
+          NodeHealthStatus(
+            ip: _healthNodes[i],
+            latencyMs: buffer[i].latencyMs,
+            jitterMs: buffer[i].jitterMs,
+            lossRate: buffer[i].lossRate,
+            samples: buffer[i].samples,
+            failureStreak: buffer[i].failureStreak,
+            degraded: buffer[i].degraded != 0,
+            active: buffer[i].active != 0,
+          ),
+      ];
+    } finally {
+      calloc.free(buffer);
+    }
+  }
+
+  static void stopHealthMonitor() {
+    if (_healthMonitor == nullptr) return;
+    _healthFree(_healthMonitor);
+    _healthMonitor = nullptr;
+    _healthNodes = const [];
+  }
+
+  // ============ DNS解析 ============
+
+  // 与 native_api.h 中的 CFVPN_DNS_* 一致
+  static const int _dnsOk = 0;
+
+  static late final _dnsCreate = _lib!.lookupFunction<
+      Pointer<CfvpnDnsResolver> Function(Pointer<CfvpnDnsOptions>, Pointer<Utf8>, Int32),
+      Pointer<CfvpnDnsResolver> Function(Pointer<CfvpnDnsOptions>, Pointer<Utf8>, int)>('cfvpn_dns_resolver_create');
+  static late final _dnsClear = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnDnsResolver>),
+      void Function(Pointer<CfvpnDnsResolver>)>('cfvpn_dns_resolver_clear');
+  static late final _dnsFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnDnsResolver>),
+      void Function(Pointer<CfvpnDnsResolver>)>('cfvpn_dns_resolver_free');
+  static late final _dnsResolveStart = _lib!.lookupFunction<
+      Pointer<CfvpnDnsQuery> Function(Pointer<CfvpnDnsResolver>, Pointer<Utf8>),
+      Pointer<CfvpnDnsQuery> Function(Pointer<CfvpnDnsResolver>, Pointer<Utf8>)>('cfvpn_dns_resolve_start');
+  static late final _dnsResolveIsDone = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnDnsQuery>),
+      int Function(Pointer<CfvpnDnsQuery>)>('cfvpn_dns_resolve_is_done');
+  static late final _dnsResolveResult = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnDnsQuery>, Pointer<CfvpnDnsAnswer>, Pointer<CfvpnIpAddress>, Int32),
+      int Function(Pointer<CfvpnDnsQuery>, Pointer<CfvpnDnsAnswer>, Pointer<CfvpnIpAddress>, int)>('cfvpn_dns_resolve_result');
+  static late final _dnsResolveFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnDnsQuery>),
+      void Function(Pointer<CfvpnDnsQuery>)>('cfvpn_dns_resolve_free');
+
+  static Pointer<CfvpnDnsResolver> _dnsResolver = nullptr;
+
+  /// 启动进程内DNS解析器：TTL缓存、A/AAAA并行查询、热门名称过期前预取。
+  /// [upstreams] 为 "ip[:port]" 形式，"tcp://" 前缀表示只用TCP；
+  /// [listenPort] 非0时同时在 127.0.0.1 上提供UDP DNS服务。
+  static bool startDnsResolver({
+    required List<String> upstreams,
+    int listenPort = 0,
+  }) {
+    stopDnsResolver();
+    if (!isAvailable || upstreams.isEmpty) return false;
+    final options = calloc<CfvpnDnsOptions>();
+    final text = upstreams.join(',').toNativeUtf8();
+    final error = calloc<Uint8>(256);
+    try {
+      options.ref
+        ..upstreams = text
+        ..listenPort = listenPort;
+      _dnsResolver = _dnsCreate(options, error.cast<Utf8>(), 256);
+      if (_dnsResolver == nullptr) {
+        _log.warn('原生DNS解析器启动失败: ${error.cast<Utf8>().toDartString()}', tag: _logTag);
+        return false;
+      }
+      return true;
+    } finally {
+      calloc.free(options);
+      calloc.free(text);
+      calloc.free(error);
+    }
+  }
+
+  static bool get hasDnsResolver => _dnsResolver != nullptr;
+
+  /// 清空原生DNS缓存，解析器未启动时返回false
+  static bool clearDnsCache() {
+    if (_dnsResolver == nullptr) return false;
+    _dnsClear(_dnsResolver);
+    return true;
+  }
+
+  /// 通过原生解析器解析 [name]，失败或解析器未启动时返回null
+  static Future<List<String>?> resolveHost(String name) async {
+    if (_dnsResolver == nullptr) return null;
+    final text = name.toNativeUtf8();
+    final query = _dnsResolveStart(_dnsResolver, text);
+    calloc.free(text);
+    const capacity = 16;
+    final answer = calloc<CfvpnDnsAnswer>();
+    final addresses = calloc<CfvpnIpAddress>(capacity);
+    try {
+      await _waitForJob(
+        isDone: () => _dnsResolveIsDone(query) != 0,
+        completed: () => 0,
+        onProgress: (_) {},
+      );
+      final count = _dnsResolveResult(query, answer, addresses, capacity);
+      if (answer.ref.status != _dnsOk) return null;
+      return [for (var i = 0; i < count; i++) _formatAddress(addresses[i])];
+    } finally {
+      _dnsResolveFree(query);
+      calloc.free(answer);
+      calloc.free(addresses);
+    }
+  }
+
+  static void stopDnsResolver() {
+    if (_dnsResolver == nullptr) return;
+    _dnsFree(_dnsResolver);
+    _dnsResolver = nullptr;
+  }
+
+  // ============ 本地中继 ============
+
+  static late final _relayStart = _lib!.lookupFunction<
+      Pointer<CfvpnRelay> Function(Pointer<CfvpnRelayOptions>, Pointer<Utf8>, Int32),
+      Pointer<CfvpnRelay> Function(Pointer<CfvpnRelayOptions>, Pointer<Utf8>, int)>('cfvpn_relay_start');
+  static late final _relayTopTalkers = _lib!.lookupFunction<
+      Int32 Function(Pointer<CfvpnRelay>, Pointer<CfvpnRelayTalker>, Int32),
+      int Function(Pointer<CfvpnRelay>, Pointer<CfvpnRelayTalker>, int)>('cfvpn_relay_top_talkers');
+  static late final _relayFree = _lib!.lookupFunction<
+      Void Function(Pointer<CfvpnRelay>),
+      void Function(Pointer<CfvpnRelay>)>('cfvpn_relay_free');
+
+  static Pointer<CfvpnRelay> _relay = nullptr;
+
+  /// 在 127.0.0.1:[listenPort] 上启动转发到 [upstreamPort]（v2ray HTTP入站）
+  /// 的中继，按连接和目标统计流量。系统代理指向中继端口后，
+  /// [relayTopTalkers] 即可给出各目标的流量，无需开启v2ray访问日志。
+  static bool startRelay({required int listenPort, required int upstreamPort}) {
+    stopRelay();
+    if (!isAvailable) return false;
+    final options = calloc<CfvpnRelayOptions>();
+    final error = calloc<Uint8>(256);
+    try {
+      options.ref
+        ..listenPort = listenPort
+        ..upstreamPort = upstreamPort;
+      _relay = _relayStart(options, error.cast<Utf8>(), 256);
+      if (_relay == nullptr) {
+        _log.warn('本地中继启动失败: ${error.cast<Utf8>().toDartString()}', tag: _logTag);
+        return false;
+      }
+      return true;
+    } finally {
+      calloc.free(options);
+      calloc.free(error);
+    }
+  }
+
+  static bool get hasRelay => _relay != nullptr;
+
+  /// 流量最大的 [limit] 个目标，按上下行总字节从大到小排列
+  static List<RelayTalker> relayTopTalkers({int limit = 20}) {
+    if (_relay == nullptr || limit <= 0) return const [];
+    final buffer = calloc<CfvpnRelayTalker>(limit);
+    try {
+      final count = _relayTopTalkers(_relay, buffer, limit);
+      return [
+        for (var i = 0; i < count; i++)
+          RelayTalker(
+            destination: _readCString(buffer[i].destination, 128),
+            bytesUp: buffer[i].bytesUp,
+            bytesDown: buffer[i].bytesDown,
+            connections: buffer[i].connections,
+            active: buffer[i].active,
+          ),
+      ];
+    } finally {
+      calloc.free(buffer);
+    }
+  }
+
+  static void stopRelay() {
+    if (_relay == nullptr) return;
+    _relayFree(_relay);
+    _relay = nullptr;
+  }
+
+  // ============ 启动预热 ============
+
+  // 与 native_api.h 中的 CFVPN_PREWARM_* 一致
+  static const int _prewarmNotStarted = 0;
+  static const int _prewarmRunning = 1;
+
+  static late final _prewarmStatus = _lib!.lookupFunction<
+      Int32 Function(Int32, Pointer<CfvpnPrewarmStatus>),
+      int Function(int, Pointer<CfvpnPrewarmStatus>)>('cfvpn_prewarm_status');
+  static late final _prewarmTakeNodeCache = _lib!.lookupFunction<
+      Pointer<CfvpnNodeCache> Function(),
+      Pointer<CfvpnNodeCache> Function()>('cfvpn_prewarm_take_node_cache');
+  static late final _prewarmTakeConfigBuilder = _lib!.lookupFunction<
+      Pointer<CfvpnConfigBuilder> Function(),
+      Pointer<CfvpnConfigBuilder> Function()>('cfvpn_prewarm_take_config_builder');
+
+  static Future<void>? _prewarmAdoption;
+  static bool _prewarmedV2rayFound = false;
+
+  /// runner 预热时确认过v2ray可执行文件存在且有效
+  static bool get prewarmedV2rayFound => _prewarmedV2rayFound;
+
+  /// 等待 runner 在引擎启动期间完成的预热，接管打开的节点缓存和解析好的
+  /// 配置模板，并记录v2ray/geo文件的检查结果。可重复调用，只执行一次。
+  static Future<void> adoptPrewarm() => _prewarmAdoption ??= _adoptPrewarm();
+
+  static Future<void> _adoptPrewarm() async {
+    if (!isAvailable) return;
+    final startUs = traceNowUs();
+    final status = calloc<CfvpnPrewarmStatus>();
+    try {
+      final deadline = DateTime.now().add(AppConfig.prewarmWaitTimeout);
+      var state = _prewarmStatus(0, status);
+      while (state == _prewarmRunning && DateTime.now().isBefore(deadline)) {
+        await Future.delayed(_pollInterval);
+        state = _prewarmStatus(0, status);
+      }
+      if (state == _prewarmNotStarted) return;
+      if (state == _prewarmRunning) {
+        _log.warn('启动预热未在 ${AppConfig.prewarmWaitTimeout.inSeconds} 秒内完成', tag: _logTag);
+        return;
+      }
+
+      final s = status.ref;
+      if (_configBuilder == nullptr) {
+        _configBuilder = _prewarmTakeConfigBuilder();
+      }
+      // 节点缓存的 getter 优先接管预热打开的缓存
+      final cacheOpened = _nodeCache != nullptr;
+      _prewarmedV2rayFound = s.v2rayFound == 1;
+
+      _log.info(
+        '启动预热完成: ${s.totalUs ~/ 1000}ms（缓存 ${s.nodeCacheUs ~/ 1000}ms / '
+        '模板 ${s.templateUs ~/ 1000}ms / 文件 ${s.filesUs ~/ 1000}ms），'
+        '缓存${cacheOpened ? '节点 ${s.nodeCacheSize}' : '未打开'}，模板${s.templateLoaded == 1 ? '已解析' : '未解析'}，'
+        'v2ray${_prewarmedV2rayFound ? '已就绪' : '缺失'}',
+        tag: _logTag,
+      );
+      final codes = <int>[];
+      for (var i = 0; i < 256 && s.message[i] != 0; i++) {
+        codes.add(s.message[i]);
+      }
+      final message = utf8.decode(codes, allowMalformed: true);
+      if (message.isNotEmpty || s.geoMissing > 0) {
+        _log.warn('启动预热发现问题: $message（缺少 ${s.geoMissing} 个geo文件）', tag: _logTag);
+      }
+    } finally {
+      calloc.free(status);
+      traceSpan('dart: adopt prewarm', startUs);
+    }
+  }
+
+  // ============ 启动追踪 ============
+
+  static late final _traceNowUs = _lib!.lookupFunction<
+      Int64 Function(), int Function()>('cfvpn_trace_now_us', isLeaf: true);
+  static late final _traceAddSpan = _lib!.lookupFunction<
+      Void Function(Pointer<Utf8>, Pointer<Utf8>, Int64, Int64),
+      void Function(Pointer<Utf8>, Pointer<Utf8>, int, int)>('cfvpn_trace_add_span');
+  static late final _traceInstant = _lib!.lookupFunction<
+      Void Function(Pointer<Utf8>, Pointer<Utf8>),
+      void Function(Pointer<Utf8>, Pointer<Utf8>)>('cfvpn_trace_instant');
+  static late final _traceDump = _lib!.lookupFunction<
+      Int32 Function(Pointer<Utf8>), int Function(Pointer<Utf8>)>('cfvpn_trace_dump');
+
+  /// 原生追踪时钟（微秒），与 runner 中 wWinMain 等区间同一起点；原生库不可用时返回0
+  static int traceNowUs() => isAvailable ? _traceNowUs() : 0;
+
+  /// 记录一个从 [startUs]（取自 [traceNowUs]）到现在的区间
+  static void traceSpan(String name, int startUs, {String category = 'dart'}) {
+    if (!isAvailable) return;
+    final nativeName = name.toNativeUtf8();
+    final nativeCategory = category.toNativeUtf8();
+    try {
+      _traceAddSpan(nativeName, nativeCategory, startUs, _traceNowUs() - startUs);
+    } finally {
+      calloc.free(nativeName);
+      calloc.free(nativeCategory);
+    }
+  }
+
+  /// 记录异步操作 [body] 的耗时
+  static Future<T> traceAsync<T>(String name, Future<T> Function() body) async {
+    final startUs = traceNowUs();
+    try {
+      return await body();
+    } finally {
+      traceSpan(name, startUs);
+    }
+  }
+
+  /// 记录一个瞬时事件
+  static void traceInstant(String name, {String category = 'dart'}) {
+    if (!isAvailable) return;
+    final nativeName = name.toNativeUtf8();
+    final nativeCategory = category.toNativeUtf8();
+    try {
+      _traceInstant(nativeName, nativeCategory);
+    } finally {
+      calloc.free(nativeName);
+      calloc.free(nativeCategory);
+    }
+  }
+
+  /// 把目前的启动追踪写成 Chrome trace JSON，返回事件数，失败返回-1
+  static int dumpTrace(String path) {
+    if (!isAvailable) return -1;
+    final nativePath = path.toNativeUtf8();
+    try {
+      return _traceDump(nativePath);
+    } finally {
+      calloc.free(nativePath);
+    }
+  }
+
+  // ============ 任务轮询 ============
+
+  /// 按 [_pollInterval] 轮询后台任务直到结束，完成数变化时回调
+  static Future<void> _waitForJob({
+    required bool Function() isDone,
+    required int Function() completed,
+    required void Function(int completed) onProgress,
+  }) async {
+    var lastReported = -1;
+    while (!isDone()) {
+      await Future.delayed(_pollInterval);
+      final current = completed();
+      if (current != lastReported) {
+        lastReported = current;
+        onProgress(current);
+      }
+    }
+  }
+
+  static Map<String, dynamic> _failedResult(String ip) => {
+    'ip': ip,
+    'latency': 999,
+    'lossRate': 1.0,
+    'sent': 0,
+    'received': 0,
+    'colo': '',
+  };
+
+  // ============ 工具方法 ============
+
+  /// 点分十进制IPv4转为主机字节序整数，无效时返回null
+  static int? parseIpv4(String ip) {
+    final parts = ip.split('.');
+    if (parts.length != 4) return null;
+    var value = 0;
+    for (final part in parts) {
+      final n = int.tryParse(part);
+      if (n == null || n < 0 || n > 255) return null;
+      value = (value << 8) | n;
+    }
+    return value;
+  }
+
+  /// 主机字节序整数转为点分十进制IPv4
+  static String formatIpv4(int ip) {
+    return '${(ip >> 24) & 0xFF}.${(ip >> 16) & 0xFF}.${(ip >> 8) & 0xFF}.${ip & 0xFF}';
+  }
+
+  static bool _hasIpv6(List<String> ips) => ips.any((ip) => ip.contains(':'));
+
+  /// 解析IPv4/IPv6地址，返回有效地址并把无效的追加到 [invalid]
+  static List<String> _splitAddresses(List<String> ips, List<String> invalid) {
+    final valid = <String>[];
+    for (final ip in ips) {
+      if (InternetAddress.tryParse(ip) == null) {
+        invalid.add(ip);
+      } else {
+        valid.add(ip);
+      }
+    }
+    return valid;
+  }
+
+  static void _fillAddresses(Pointer<CfvpnIpAddress> buffer, List<String> ips) {
+    for (var i = 0; i < ips.length; i++) {
+      final raw = InternetAddress(ips[i]).rawAddress;
+      final item = buffer[i];
+      item.family = raw.length == 16 ? 6 : 4;
+      for (var j = 0; j < raw.length; j++) {
+        item.bytes[j] = raw[j];
+      }
+    }
+  }
+
+  static String _formatAddress(CfvpnIpAddress item) {
+    final length = item.family == 6 ? 16 : 4;
+    final raw = Uint8List(length);
+    for (var i = 0; i < length; i++) {
+      raw[i] = item.bytes[i];
+    }
+    return InternetAddress.fromRawAddress(raw).address;
+  }
+}
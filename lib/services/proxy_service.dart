@@ -4,14 +4,17 @@ import 'package:ffi/ffi.dart';
 import 'package:win32/win32.dart';
 import '../utils/log_service.dart';
 import '../app_config.dart';
+import 'native_core.dart';
 
 class ProxyService {
   static const String _logTag = 'ProxyService';  // 日志标签
   static final LogService _log = LogService.instance;  // 日志服务实例
   
   static const _registryPath = r'Software\Microsoft\Windows\CurrentVersion\Internet Settings';
-  // 修改：使用AppConfig构建代理服务器地址
-  static String get _proxyServer => '127.0.0.1:${AppConfig.v2rayHttpPort}';
+  // 修改：使用AppConfig构建代理服务器地址；本地中继运行时指向中继
+  static String get _proxyServer => NativeCore.hasRelay
+      ? '127.0.0.1:${AppConfig.localRelayPort}'
+      : '127.0.0.1:${AppConfig.v2rayHttpPort}';
 
   // ============ 从win32_registry复制的核心代码 ============
   // 只在Windows平台编译和执行，移动端会跳过
@@ -345,6 +348,15 @@ class ProxyService {
       return;
     }
 
+    // 本地中继与系统代理同生命周期：它只在有连接时才连接HTTP入站，
+    // 可以先于v2ray启动；启动失败时系统代理直接指向HTTP入站
+    if (AppConfig.localRelay && NativeCore.isAvailable) {
+      NativeCore.startRelay(
+        listenPort: AppConfig.localRelayPort,
+        upstreamPort: AppConfig.v2rayHttpPort,
+      );
+    }
+
     int? hkey;
     try {
       await _log.info('正在启用系统代理...', tag: _logTag);
@@ -394,6 +406,7 @@ class ProxyService {
       if (hkey != null) {
         _closeRegistryKey(hkey);
       }
+      NativeCore.stopRelay();
       throw '无法设置系统代理: $e';
     }
   }
@@ -426,6 +439,7 @@ class ProxyService {
 
       // 通知系统代理设置已更改
       await _refreshSystemProxy();
+      NativeCore.stopRelay();
       
       await _log.info('系统代理禁用成功', tag: _logTag);
     } catch (e) {
@@ -433,6 +447,7 @@ class ProxyService {
       if (hkey != null) {
         _closeRegistryKey(hkey);
       }
+      NativeCore.stopRelay();
       throw '无法禁用系统代理: $e';
     }
   }
@@ -445,13 +460,17 @@ class ProxyService {
     try {
       // 重要修复：使用与版本1完全相同的刷新方法
       
-      // 1. 刷新DNS缓存
+      // 1. 刷新DNS缓存（原生核心可用时只清空进程内缓存）
       await _log.debug('刷新DNS缓存', tag: _logTag);
-      final flushDnsResult = await Process.run('ipconfig', ['/flushdns']);
-      if (flushDnsResult.exitCode == 0) {
-        await _log.debug('DNS缓存已刷新', tag: _logTag);
+      if (NativeCore.isAvailable) {
+        NativeCore.clearDnsCache();
       } else {
-        await _log.debug('DNS缓存刷新失败: ${flushDnsResult.stderr}', tag: _logTag);
+        final flushDnsResult = await Process.run('ipconfig', ['/flushdns']);
+        if (flushDnsResult.exitCode == 0) {
+          await _log.debug('DNS缓存已刷新', tag: _logTag);
+        } else {
+          await _log.debug('DNS缓存刷新失败: ${flushDnsResult.stderr}', tag: _logTag);
+        }
       }
       
       // 2. 使用 netsh 命令导入IE代理设置到WinHTTP
@@ -5,6 +5,7 @@ import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 import 'package:path/path.dart' as path;
 import '../utils/ui_utils.dart';
+import 'native_core.dart';
 import '../utils/log_service.dart';
 import '../app_config.dart';
 
@@ -76,6 +77,10 @@ class V2RayService {
   // Windows平台进程管理
   static Process? _v2rayProcess;
   
+  // 原生看护（NativeCore可用时）：崩溃由原生线程自动重启，这里定时同步状态
+  static Timer? _supervisorTimer;
+  static int _supervisorRestarts = 0;
+  
   // 回调函数
   static Function? _onProcessExit;
   
@@ -769,6 +774,18 @@ static Future<Map<String, dynamic>> _generateConfigMap({
     final configPath = path.join(path.dirname(v2rayPath), 'config.json');
     
     try {
+      if (await _writeConfigFileNative(
+        configPath: configPath,
+        serverIp: serverIp,
+        serverPort: serverPort,
+        serverName: serverName,
+        localPort: localPort,
+        httpPort: httpPort,
+        globalProxy: globalProxy,
+      )) {
+        return;
+      }
+      
       final config = await _generateConfigMap(
         serverIp: serverIp,
         serverPort: serverPort,
@@ -786,6 +803,58 @@ static Future<Map<String, dynamic>> _generateConfigMap({
     }
   }
   
+  // 原生生成配置文件：模板只在第一次解析并缓存，之后切换节点只替换变化的字段。
+  // 原生核心不可用或失败时返回false，由调用方走Dart实现。
+  static Future<bool> _writeConfigFileNative({
+    required String configPath,
+    required String serverIp,
+    required int serverPort,
+    String? serverName,
+    required int localPort,
+    required int httpPort,
+    required bool globalProxy,
+  }) async {
+    if (!NativeCore.isAvailable) return false;
+    if (!NativeCore.hasConfigTemplate) {
+      // 优先使用 runner 启动时预解析好的模板
+      await NativeCore.adoptPrewarm();
+    }
+    if (!NativeCore.hasConfigTemplate) {
+      final template = await rootBundle.loadString(CONFIG_PATH);
+      if (!NativeCore.loadConfigTemplate(template)) return false;
+    }
+    
+    // 服务器群组配置覆盖serverName和UUID，与_generateConfigMap一致
+    String? userId;
+    final groupServer = AppConfig.getRandomServer();
+    if (groupServer != null) {
+      if (groupServer['serverName'] != null) {
+        serverName = groupServer['serverName'];
+      }
+      userId = groupServer['uuid'];
+    }
+    
+    final bytes = NativeCore.writeV2rayConfig(
+      configPath,
+      serverIp: serverIp,
+      serverPort: serverPort,
+      serverName: serverName,
+      userId: userId,
+      socksPort: localPort,
+      httpPort: httpPort,
+      globalProxy: globalProxy,
+    );
+    if (bytes < 0) {
+      await _log.warn('原生生成配置失败，改用Dart实现', tag: _logTag);
+      return false;
+    }
+    await _log.info(
+      '配置文件已生成: $configPath（CDN=$serverIp, ${globalProxy ? "全局代理" : "智能分流"}, $bytes 字节）',
+      tag: _logTag,
+    );
+    return true;
+  }
+  
   // 计算连接时长
   static String _calculateDuration() {
     if (_connectionStartTime == null) return "00:00:00";
@@ -822,7 +891,13 @@ static Future<Map<String, dynamic>> _generateConfigMap({
   // 清理DNS缓存（可选功能）
   static Future<void> clearDnsCache() async {
     try {
-      if (Platform.isWindows) {
+      if (Platform.isWindows && NativeCore.isAvailable) {
+        // 原生核心可用时解析走进程内缓存，清空它即可，不再启动 ipconfig 进程
+        if (NativeCore.clearDnsCache()) {
+          await _log.info('原生DNS缓存已清理', tag: _logTag);
+        }
+      }
+      else if (Platform.isWindows) {
         // Windows: 使用 ipconfig /flushdns
         final result = await Process.run('ipconfig', ['/flushdns'], runInShell: true);
         if (result.exitCode == 0) {
@@ -1221,7 +1296,8 @@ static Future<Map<String, dynamic>> _generateConfigMap({
     
     // 启动进程
     final v2rayPath = await _getV2RayPath();
-    if (!await File(v2rayPath).exists()) {
+    // runner 启动预热已检查过可执行文件时不再访问磁盘
+    if (!NativeCore.prewarmedV2rayFound && !await File(v2rayPath).exists()) {
       await _log.error('V2Ray可执行文件未找到: $v2rayPath', tag: _logTag);
       _updateStatus(V2RayStatus(state: V2RayConnectionState.error));
       throw 'V2Ray executable not found';
@@ -1229,6 +1305,70 @@ static Future<Map<String, dynamic>> _generateConfigMap({
     
     await _log.info('启动V2Ray进程: $v2rayPath', tag: _logTag);
     
+    if (NativeCore.isAvailable) {
+      if (!await _startSupervisedV2ray(v2rayPath)) {
+        _updateStatus(V2RayStatus(state: V2RayConnectionState.error));
+        await stop();
+        return false;
+      }
+    } else if (!await _startV2rayProcess(v2rayPath)) {
+      return false;
+    }
+    
+    await _log.info('V2Ray端口已监听，测试远程连接...', tag: _logTag);
+    
+    // 测试远程连接（与Android端逻辑一致）
+    await Future.delayed(const Duration(milliseconds: 500)); // 等待服务稳定
+    
+    bool connectionTestSuccess = await _testRemoteConnection();
+    
+    if (!connectionTestSuccess) {
+      // 重试一次（与Android端一致）
+      await _log.info('连接测试失败，2秒后重试', tag: _logTag);
+      await Future.delayed(const Duration(seconds: 2));
+      connectionTestSuccess = await _testRemoteConnection();
+    }
+    
+    if (!connectionTestSuccess) {
+      await _log.error('Unable to connect to remote server', tag: _logTag);  // 与Android端保持一致的错误消息
+      _updateStatus(V2RayStatus(state: V2RayConnectionState.error));
+      await stop();
+      return false;
+    }
+    
+    // 测试通过，设置状态
+    await _log.info('✅ V2Ray服务完全就绪', tag: _logTag);
+    
+    _isRunning = true;
+    _uploadTotal = 0;
+    _downloadTotal = 0;
+    _lastUpdateTime = 0;
+    _lastUploadBytes = 0;
+    _lastDownloadBytes = 0;
+    
+    _updateStatus(V2RayStatus(state: V2RayConnectionState.connected));
+    _startStatsTimer();
+    _startDurationTimer();
+    _startDnsResolver();
+    
+    return true;
+  }
+  
+  // 原生DNS解析器：经虚拟DNS入站（dokodemo-door，TCP）在隧道内查询，
+  // 结果按TTL缓存，热门名称过期前自动刷新
+  static void _startDnsResolver() {
+    if (!NativeCore.isAvailable || !AppConfig.nativeDnsResolver) return;
+    final started = NativeCore.startDnsResolver(
+      upstreams: ['tcp://127.0.0.1:${AppConfig.virtualDnsPort}'],
+      listenPort: AppConfig.nativeDnsPort,
+    );
+    if (started) {
+      _log.info('原生DNS解析器已启动，本地端口: ${AppConfig.nativeDnsPort}', tag: _logTag);
+    }
+  }
+  
+  // 通过 Process.start 启动V2Ray（原生核心不可用时），固定等待后轮询端口
+  static Future<bool> _startV2rayProcess(String v2rayPath) async {
     _v2rayProcess = await Process.start(
       v2rayPath,
       ['run'],
@@ -1251,24 +1391,7 @@ static Future<Map<String, dynamic>> _generateConfigMap({
       }
     });
     
-    _v2rayProcess!.exitCode.then((code) {
-      _log.info('V2Ray进程退出，退出码: $code', tag: _logTag);
-      _isRunning = false;
-      
-      // 重置流量统计（防止进程异常退出时资源未清理）
-      _uploadTotal = 0;
-      _downloadTotal = 0;
-      _lastUploadBytes = 0;
-      _lastDownloadBytes = 0;
-      _lastUpdateTime = 0;
-      
-      _stopStatsTimer();
-      _stopDurationTimer();
-      _updateStatus(V2RayStatus(state: V2RayConnectionState.disconnected));
-      if (_onProcessExit != null) {
-        _onProcessExit!();
-      }
-    });
+    _v2rayProcess!.exitCode.then(_handleV2rayExit);
     
     // 等待V2Ray启动
     await Future.delayed(AppConfig.v2rayStartupWait);
@@ -1288,42 +1411,82 @@ static Future<Map<String, dynamic>> _generateConfigMap({
       return false;
     }
     
-    await _log.info('V2Ray端口已监听，测试远程连接...', tag: _logTag);
-    
-    // 测试远程连接（与Android端逻辑一致）
-    await Future.delayed(const Duration(milliseconds: 500)); // 等待服务稳定
-    
-    bool connectionTestSuccess = await _testRemoteConnection();
-    
-    if (!connectionTestSuccess) {
-      // 重试一次（与Android端一致）
-      await _log.info('连接测试失败，2秒后重试', tag: _logTag);
-      await Future.delayed(const Duration(seconds: 2));
-      connectionTestSuccess = await _testRemoteConnection();
+    return true;
+  }
+  
+  // 原生看护启动：以V2Ray输出的 "started" 行并确认入站端口可连接作为就绪信号，
+  // 不再固定等待 v2rayStartupWait 后轮询端口
+  static Future<bool> _startSupervisedV2ray(String v2rayPath) async {
+    final started = NativeCore.startV2raySupervisor(
+      executable: v2rayPath,
+      arguments: const ['run'],
+      workingDirectory: path.dirname(v2rayPath),
+      readyPorts: const [AppConfig.v2raySocksPort, AppConfig.v2rayHttpPort],
+      readyTimeout: AppConfig.v2rayReadyTimeout,
+      maxRestarts: AppConfig.v2rayMaxRestarts,
+    );
+    if (!started) {
+      await _log.error('原生看护无法启动V2Ray', tag: _logTag);
+      return false;
     }
     
-    if (!connectionTestSuccess) {
-      await _log.error('Unable to connect to remote server', tag: _logTag);  // 与Android端保持一致的错误消息
-      _updateStatus(V2RayStatus(state: V2RayConnectionState.error));
-      await stop();
+    final ready = await NativeCore.waitV2rayReady(AppConfig.v2rayReadyTimeout);
+    final status = NativeCore.v2raySupervisorStatus();
+    if (!ready || status == null) {
+      await _log.error('V2Ray未能就绪: ${status?.lastError ?? '未知错误'}', tag: _logTag);
       return false;
     }
+    _supervisorRestarts = status.restarts;
+    await _log.info('V2Ray启动成功，就绪耗时 ${status.readyLatency.inMilliseconds}ms', tag: _logTag);
+    _startSupervisorWatch();
+    return true;
+  }
+  
+  static void _startSupervisorWatch() {
+    _stopSupervisorWatch();
+    _supervisorTimer = Timer.periodic(AppConfig.v2raySupervisorCheckInterval, (_) {
+      final status = NativeCore.v2raySupervisorStatus();
+      if (status == null) {
+        _stopSupervisorWatch();
+        return;
+      }
+      if (status.restarts != _supervisorRestarts) {
+        _supervisorRestarts = status.restarts;
+        _log.warn('V2Ray进程意外退出（${status.lastError}），已自动重启 ${status.restarts} 次', tag: _logTag);
+      }
+      if (status.state == V2raySupervisorState.failed) {
+        _stopSupervisorWatch();
+        _log.error('V2Ray连续崩溃，停止重启: ${status.lastError}', tag: _logTag);
+        NativeCore.stopV2raySupervisor(Duration.zero);
+        _handleV2rayExit(status.lastExitCode);
+      }
+    });
+  }
+  
+  static void _stopSupervisorWatch() {
+    _supervisorTimer?.cancel();
+    _supervisorTimer = null;
+  }
+  
+  // V2Ray进程退出（原生看护放弃重启时同样调用）
+  static void _handleV2rayExit(int code) {
+    _log.info('V2Ray进程退出，退出码: $code', tag: _logTag);
+    _isRunning = false;
     
-    // 测试通过，设置状态
-    await _log.info('✅ V2Ray服务完全就绪', tag: _logTag);
-    
-    _isRunning = true;
+    // 重置流量统计（防止进程异常退出时资源未清理）
     _uploadTotal = 0;
     _downloadTotal = 0;
-    _lastUpdateTime = 0;
     _lastUploadBytes = 0;
     _lastDownloadBytes = 0;
+    _lastUpdateTime = 0;
     
-    _updateStatus(V2RayStatus(state: V2RayConnectionState.connected));
-    _startStatsTimer();
-    _startDurationTimer();
-    
-    return true;
+    _stopStatsTimer();
+    _stopDurationTimer();
+    NativeCore.stopDnsResolver();
+    _updateStatus(V2RayStatus(state: V2RayConnectionState.disconnected));
+    if (_onProcessExit != null) {
+      _onProcessExit!();
+    }
   }
   
   // 停止V2Ray服务 - 修复：添加资源清理
@@ -1375,6 +1538,17 @@ static Future<Map<String, dynamic>> _generateConfigMap({
         // 停止计时器（仅Windows使用）
         _stopStatsTimer();
         _stopDurationTimer();
+        _stopSupervisorWatch();
+        NativeCore.stopDnsResolver();
+        
+        // 原生看护：请求退出后等待进程被回收，超时由原生代码强制结束；
+        // 子进程在作业对象中，不会留下残留进程
+        final supervised = NativeCore.hasV2raySupervisor;
+        if (supervised) {
+          await NativeCore.stopV2raySupervisor(
+            AppConfig.v2rayTerminateInterval * AppConfig.v2rayTerminateRetries);
+          await _log.info('V2Ray进程已退出', tag: _logTag);
+        }
         
         if (_v2rayProcess != null) {
           try {
@@ -1411,11 +1585,13 @@ static Future<Map<String, dynamic>> _generateConfigMap({
         }
         
         // 清理残留进程（Windows）
-        try {
-          await Process.run('taskkill', ['/F', '/IM', _v2rayExecutableName], 
-            runInShell: true);
-        } catch (e) {
-          // 忽略错误
+        if (!supervised) {
+          try {
+            await Process.run('taskkill', ['/F', '/IM', _v2rayExecutableName], 
+              runInShell: true);
+          } catch (e) {
+            // 忽略错误
+          }
         }
       }
       // ============ 其他平台 ============
@@ -1436,13 +1612,26 @@ static Future<Map<String, dynamic>> _generateConfigMap({
     
     _stopStatsTimer();
     
+    // 原生采样线程立即开始按 trafficSampleInterval 采样，api尚未就绪时的失败会被跳过
+    if (NativeCore.isAvailable) {
+      NativeCore.startTrafficSampler(
+        port: AppConfig.v2rayApiPort,
+        interval: AppConfig.trafficSampleInterval,
+        pattern: _proxyTrafficPattern,
+      );
+    }
+    
     Future.delayed(const Duration(seconds: 5), () {
       if (_isRunning) {
         _log.info('开始流量统计监控', tag: _logTag);
         
         _updateTrafficStatsFromAPI();
         
-        _statsTimer = Timer.periodic(AppConfig.trafficStatsInterval, (_) {
+        // 原生采样时只读取共享缓冲区，可以按更短的间隔刷新速度
+        final interval = NativeCore.isAvailable
+            ? AppConfig.nativeTrafficStatsInterval
+            : AppConfig.trafficStatsInterval;
+        _statsTimer = Timer.periodic(interval, (_) {
           if (_isRunning) {
             _updateTrafficStatsFromAPI();
           }
@@ -1454,12 +1643,20 @@ static Future<Map<String, dynamic>> _generateConfigMap({
   static void _stopStatsTimer() {
     _statsTimer?.cancel();
     _statsTimer = null;
+    _nativeStatsFailing = false;
+    NativeCore.stopTrafficSampler();
   }
   
   // Windows平台流量统计API调用
   static Future<void> _updateTrafficStatsFromAPI() async {
     if (!_isRunning || !Platform.isWindows) return;
     
+    // 原生核心可用时由采样线程通过常驻的gRPC连接查询，这里只读取采样结果
+    if (NativeCore.isAvailable) {
+      _updateTrafficStatsNative();
+      return;
+    }
+    
     try {
       final v2rayPath = await _getV2RayPath();
       final v2rayDir = path.dirname(v2rayPath);
@@ -1537,6 +1734,44 @@ static Future<Map<String, dynamic>> _generateConfigMap({
     }
   }
   
+  // 只查询proxy出站的计数器（名称包含该子串），不包含proxy3等其他出站
+  static const String _proxyTrafficPattern = 'outbound>>>proxy>>>traffic>>>';
+  static bool _nativeStatsFailing = false;
+  
+  // 超过该时长没有新样本视为采样失败
+  static const int _trafficSampleStaleMs = 3000;
+  
+  static void _updateTrafficStatsNative() {
+    final latest = NativeCore.trafficRing?.latest;
+    final now = DateTime.now().millisecondsSinceEpoch;
+    if (latest == null || now - latest.timeMs > _trafficSampleStaleMs) {
+      // v2ray刚启动时api可能尚未就绪，只在状态变化时记录一次
+      if (!_nativeStatsFailing) {
+        _nativeStatsFailing = true;
+        _log.warn('流量采样未更新，v2ray api可能尚未就绪', tag: _logTag);
+      }
+      return;
+    }
+    _nativeStatsFailing = false;
+    // 速度按样本自身的时间戳计算，不受定时器抖动影响
+    _applyProxyTraffic(latest.upBytes, latest.downBytes, sampleTimeMs: latest.timeMs);
+  }
+  
+  /// 最近 [window] 内的代理流量样本（累计字节数，按时间升序），用于绘制速度曲线
+  ///
+  /// 1小时以内使用全分辨率样本，更长的窗口自动使用降采样层级。
+  /// 原生采样未运行时返回空列表。
+  static List<TrafficPoint> trafficHistory(Duration window) {
+    final ring = NativeCore.trafficRing;
+    if (ring == null) return const [];
+    var tier = 0;
+    while (tier < ring.tierCount - 1 && ring.retention(tier) < window) {
+      tier++;
+    }
+    final since = DateTime.now().millisecondsSinceEpoch - window.inMilliseconds;
+    return ring.read(tier, sinceMs: since);
+  }
+  
   // 记录上次的流量值
   static int _lastLoggedUpload = -1;
   static int _lastLoggedDownload = -1;
@@ -1573,12 +1808,21 @@ static Future<Map<String, dynamic>> _generateConfigMap({
         }
       }
       
+      _applyProxyTraffic(proxyUplink, proxyDownlink);
+    } catch (e, stackTrace) {
+      _log.error('解析流量统计失败', tag: _logTag, error: e, stackTrace: stackTrace);
+    }
+  }
+  
+  // 更新代理流量总量，计算速度并刷新状态
+  static void _applyProxyTraffic(int proxyUplink, int proxyDownlink, {int? sampleTimeMs}) {
+    try {
       // 更新流量值（只包含代理流量）
       _uploadTotal = proxyUplink;
       _downloadTotal = proxyDownlink;
       
       // 计算速度
-      final now = DateTime.now().millisecondsSinceEpoch;
+      final now = sampleTimeMs ?? DateTime.now().millisecondsSinceEpoch;
       int uploadSpeed = 0;
       int downloadSpeed = 0;
       
@@ -1634,7 +1878,7 @@ static Future<Map<String, dynamic>> _generateConfigMap({
       }
       
     } catch (e, stackTrace) {
-      _log.error('解析流量统计失败', tag: _logTag, error: e, stackTrace: stackTrace);
+      _log.error('更新流量统计失败', tag: _logTag, error: e, stackTrace: stackTrace);
     }
   }
   
@@ -3,6 +3,7 @@ import 'dart:async';
 import 'package:path/path.dart' as path;
 import 'package:path_provider/path_provider.dart';  // 新增：用于获取应用目录
 import '../app_config.dart';  // 导入配置文件
+import '../services/native_core.dart';
 
 /// 日志上下文（包含文件、流和日期信息）
 class _LogContext {
@@ -68,7 +69,40 @@ class LogService {
   Timer? _dateCheckTimer;
   Timer? _autoFlushTimer;
   
-  LogService._() {
+  // Windows上由原生异步日志负责写文件：每条日志只是一次无锁入队，
+  // 格式化、批量落盘和按日期/大小轮转都在原生写线程中完成，
+  // 不需要下面的日期检查和自动刷新计时器。null 表示尚未确定。
+  bool? _nativeMode;
+  
+  LogService._();
+  
+  /// 首次写日志时确定使用原生日志还是Dart实现
+  bool get _useNative {
+    final mode = _nativeMode;
+    if (mode != null) return mode;
+    // 确定期间产生的日志（如原生核心加载失败的警告）走Dart实现
+    _nativeMode = false;
+    var useNative = false;
+    if (Platform.isWindows && NativeCore.isAvailable) {
+      try {
+        final logDir = _windowsLogDir();
+        if (!logDir.existsSync()) {
+          logDir.createSync(recursive: true);
+        }
+        _logDir = logDir.path;
+        useNative = NativeCore.openLog(logDir.path);
+      } catch (e) {
+        useNative = false;
+      }
+    }
+    _nativeMode = useNative;
+    if (!useNative) {
+      _startTimers();
+    }
+    return useNative;
+  }
+  
+  void _startTimers() {
     // 启动定期检查日期变更的计时器（从配置读取间隔）
     _dateCheckTimer = Timer.periodic(AppConfig.logDateCheckInterval, (_) {
       _checkAndRotateLogs();
@@ -80,6 +114,15 @@ class LogService {
     }
   }
   
+  // Windows平台直接使用exe目录下的logs
+  static Directory _windowsLogDir() {
+    final exeDir = File(Platform.resolvedExecutable).parent.path;
+    return Directory(path.join(exeDir, 'logs'));
+  }
+  
+  static String _dateString(DateTime date) =>
+      '${date.year}${date.month.toString().padLeft(2, '0')}${date.day.toString().padLeft(2, '0')}';
+  
   /// 获取操作锁，防止并发冲突
   Future<void> _acquireLock(String tag) async {
     final safeTag = tag.replaceAll(RegExp(r'[^\w\-]'), '_');
@@ -183,9 +226,7 @@ class LogService {
         // 区分平台获取日志目录
         if (Platform.isWindows) {
           // Windows平台直接使用exe目录（保持原有逻辑）
-          final exePath = Platform.resolvedExecutable;
-          final exeDir = File(exePath).parent.path;
-          logDir = Directory(path.join(exeDir, 'logs'));
+          logDir = _windowsLogDir();
         } else if (Platform.isAndroid || Platform.isIOS) {
           // 移动平台使用应用支持目录（修复：统一使用files目录）
           // getApplicationSupportDirectory 在Android上返回 /data/data/packageName/files
@@ -214,7 +255,7 @@ class LogService {
       
       // 创建日志文件 - 基于tag和日期命名
       final date = DateTime.now();
-      final dateStr = '${date.year}${date.month.toString().padLeft(2, '0')}${date.day.toString().padLeft(2, '0')}';
+      final dateStr = _dateString(date);
       final fileName = '${safeTag}_$dateStr.log';
       
       final logFile = File(path.join(_logDir!, fileName));
@@ -278,6 +319,12 @@ class LogService {
     // 使用提供的tag或默认tag
     final effectiveTag = tag ?? _defaultTag;
     
+    if (_useNative) {
+      // 原生写线程批量落盘，ERROR会立即唤醒写线程
+      NativeCore.writeLog(level, effectiveTag, message);
+      return;
+    }
+    
     try {
       // 获取或创建对应的日志上下文
       final context = await _getOrCreateLogContext(effectiveTag);
@@ -304,6 +351,12 @@ class LogService {
   Future<void> flush({String? tag}) async {
     if (!enabled) return;
     
+    if (_nativeMode == true) {
+      // 原生日志只能整体刷新
+      NativeCore.flushLog();
+      return;
+    }
+    
     try {
       if (tag != null) {
         // 刷新指定tag的日志
@@ -356,6 +409,9 @@ class LogService {
   /// 获取指定tag的日志文件路径（当前日期的）
   String? getLogFile(String tag) {
     final safeTag = tag.replaceAll(RegExp(r'[^\w\-]'), '_');
+    if (_nativeMode == true && _logDir != null) {
+      return path.join(_logDir!, '${safeTag}_${_dateString(DateTime.now())}.log');
+    }
     return _logContexts[safeTag]?.file.path;
   }
   
@@ -369,8 +425,8 @@ class LogService {
     try {
       final dir = Directory(_logDir!);
       if (dir.existsSync()) {
-        // 查找所有匹配的日志文件（tag_*.log）
-        final pattern = RegExp('^${RegExp.escape(safeTag)}_\\d{8}\\.log\$');
+        // 查找所有匹配的日志文件（tag_YYYYMMDD.log 及按大小轮转的 tag_YYYYMMDD.N.log）
+        final pattern = RegExp('^${RegExp.escape(safeTag)}_\\d{8}(\\.\\d+)?\\.log\$');
         final entities = dir.listSync();
         
         for (final entity in entities) {
@@ -398,8 +454,8 @@ class LogService {
     try {
       final dir = Directory(_logDir!);
       if (dir.existsSync()) {
-        // 匹配所有日志文件（*_YYYYMMDD.log）
-        final pattern = RegExp(r'^(.+?)_(\d{8})\.log$');
+        // 匹配所有日志文件（*_YYYYMMDD.log 及 *_YYYYMMDD.N.log）
+        final pattern = RegExp(r'^(.+?)_(\d{8})(?:\.\d+)?\.log$');
         final entities = dir.listSync();
         
         for (final entity in entities) {
@@ -428,6 +484,11 @@ class LogService {
       // 获取锁，防止并发操作
       await _acquireLock(safeTag);
       
+      // 原生日志先落盘并关闭文件，否则Windows上无法删除
+      if (_nativeMode == true) {
+        NativeCore.closeLogFiles();
+      }
+      
       // 1. 先关闭并移除当前的上下文
       final context = _logContexts.remove(safeTag);
       if (context != null) {
@@ -449,8 +510,8 @@ class LogService {
       if (_logDir != null) {
         final dir = Directory(_logDir!);
         if (dir.existsSync()) {
-          // 构建文件名匹配模式：tag_YYYYMMDD.log
-          final pattern = RegExp('^${RegExp.escape(safeTag)}_\\d{8}\\.log\$');
+          // 构建文件名匹配模式：tag_YYYYMMDD.log 和 tag_YYYYMMDD.N.log
+          final pattern = RegExp('^${RegExp.escape(safeTag)}_\\d{8}(\\.\\d+)?\\.log\$');
           final entities = dir.listSync();
           
           for (final entity in entities) {
@@ -484,6 +545,10 @@ class LogService {
   /// 清空所有日志文件
   Future<void> clearAllLogs() async {
     try {
+      if (_nativeMode == true) {
+        NativeCore.closeLogFiles();
+      }
+      
       // 1. 获取所有tag
       final tags = _logContexts.keys.toList();
       final pendingTags = _pendingCreations.keys.toList();
@@ -501,7 +566,7 @@ class LogService {
           final entities = dir.listSync();
           for (final entity in entities) {
             try {
-              if (entity is File && entity.path.endsWith('.log')) {
+              if (entity is File && (entity.path.endsWith('.log') || entity.path.endsWith('.clog'))) {
                 await entity.delete();
               }
             } catch (e) {
@@ -536,6 +601,11 @@ class LogService {
       _autoFlushTimer?.cancel();
       _autoFlushTimer = null;
       
+      if (_nativeMode == true) {
+        NativeCore.closeLog();
+        _nativeMode = null;
+      }
+      
       // 等待所有锁释放
       final locks = _operationLocks.values.toList();
       for (final lock in locks) {
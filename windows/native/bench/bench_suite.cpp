@@ -0,0 +1,644 @@
+// 原生核心热点路径的回归基准。
+//
+//   cfvpn_bench [选项]
+//     --filter TEXT      只运行名称包含 TEXT 的用例
+//     --min-time MS      每个用例至少运行的时间，默认 300
+//     --json PATH        把结果写成 JSON（- 表示 stdout）
+//     --baseline PATH    与之前 --json 保存的结果比较，出现回归时退出码为 1
+//     --threshold PCT    ns/op 超过基线多少百分比算回归，默认 10
+//
+// 每个用例反复运行一批操作（一个样本），直到达到 --min-time 且至少有
+// 20 个样本。ns/op 是总耗时除以总次数，p50/p90/p99 是样本内平均每次
+// 耗时的分位数。allocs/op 和 B/op 统计基准线程中的 operator new，不含
+// 日志写线程、回环服务线程等后台线程的分配。
+//
+// 探测引擎用例连接本机回环监听，不访问外网，可在普通 Linux 机器上运行。
+
+#include <poll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/async_logger.h"
+#include "core/cidr_sampler.h"
+#include "core/http_probe_engine.h"
+#include "core/json.h"
+#include "core/latency_histogram.h"
+#include "core/node_scanner.h"
+#include "core/share_link.h"
+#include "core/socket_util.h"
+#include "core/tcping_engine.h"
+#include "core/v2ray_config.h"
+
+// ===== 分配计数 =====
+
+namespace {
+
+thread_local uint64_t t_allocs = 0;
+thread_local uint64_t t_alloc_bytes = 0;
+
+void* CountedAlloc(size_t size) {
+  ++t_allocs;
+  t_alloc_bytes += size;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++t_allocs;
+  t_alloc_bytes += size;
+  return std::malloc(size == 0 ? 1 : size);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// ===== 计时框架 =====
+
+// 一个用例。run(n) 执行约 n 次操作并返回实际次数；fixed_batch 非 0 时
+// 每个样本固定执行这么多次（探测引擎一次 Run 的目标数）。after_sample
+// 在每个样本之后调用，不计入耗时（例如等待日志写线程清空队列）。
+struct Case {
+  Case(std::string name, std::function<size_t(size_t)> run,
+       size_t fixed_batch = 0)
+      : name(std::move(name)), run(std::move(run)), fixed_batch(fixed_batch) {}
+
+  std::string name;
+  std::function<size_t(size_t)> run;
+  size_t fixed_batch = 0;
+  std::function<void()> after_sample;
+};
+
+struct Result {
+  std::string name;
+  uint64_t ops = 0;
+  size_t samples = 0;
+  double ns_per_op = 0;
+  double p50_ns = 0;
+  double p90_ns = 0;
+  double p99_ns = 0;
+  double allocs_per_op = 0;
+  double bytes_per_op = 0;
+};
+
+double Percentile(const std::vector<double>& sorted, double p) {
+  const size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+Result Measure(const Case& bench, std::chrono::milliseconds min_time) {
+  constexpr size_t kMinSamples = 20;
+  // 自动批量：让每个样本约 50 µs，计时开销可以忽略
+  constexpr double kSampleTargetNs = 50000;
+
+  size_t batch = bench.fixed_batch != 0 ? bench.fixed_batch : 1;
+  // 预热，同时估计批量
+  for (int i = 0; i < 3; ++i) {
+    const auto start = Clock::now();
+    const size_t done = bench.run(batch);
+    const double ns =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (bench.after_sample) bench.after_sample();
+    if (bench.fixed_batch == 0 && done > 0) {
+      const double per_op = std::max(ns / done, 1.0);
+      batch = std::max<size_t>(
+          1, std::min<size_t>(1 << 20, static_cast<size_t>(
+                                            kSampleTargetNs / per_op)));
+    }
+  }
+
+  Result result;
+  result.name = bench.name;
+  std::vector<double> per_op;
+  double total_ns = 0;
+  uint64_t allocs = 0;
+  uint64_t bytes = 0;
+  const auto deadline = Clock::now() + min_time;
+  while (per_op.size() < kMinSamples || Clock::now() < deadline) {
+    const uint64_t allocs_before = t_allocs;
+    const uint64_t bytes_before = t_alloc_bytes;
+    const auto start = Clock::now();
+    const size_t done = bench.run(batch);
+    const double ns =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    allocs += t_allocs - allocs_before;
+    bytes += t_alloc_bytes - bytes_before;
+    if (bench.after_sample) bench.after_sample();
+    if (done == 0) break;
+    result.ops += done;
+    total_ns += ns;
+    per_op.push_back(ns / done);
+  }
+  if (result.ops == 0) return result;
+
+  std::sort(per_op.begin(), per_op.end());
+  result.samples = per_op.size();
+  result.ns_per_op = total_ns / result.ops;
+  result.p50_ns = Percentile(per_op, 0.50);
+  result.p90_ns = Percentile(per_op, 0.90);
+  result.p99_ns = Percentile(per_op, 0.99);
+  result.allocs_per_op = static_cast<double>(allocs) / result.ops;
+  result.bytes_per_op = static_cast<double>(bytes) / result.ops;
+  return result;
+}
+
+std::string ToJson(const std::vector<Result>& results) {
+  std::string out = "{\"schema\":1,\"benchmarks\":[";
+  char line[320];
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    out += i == 0 ? "\n  {\"name\":" : ",\n  {\"name\":";
+    cfvpn::AppendJsonString(r.name, &out);
+    std::snprintf(line, sizeof(line),
+                  ",\"ops\":%llu,\"samples\":%zu,\"ns_per_op\":%.2f,"
+                  "\"p50_ns\":%.2f,\"p90_ns\":%.2f,\"p99_ns\":%.2f,"
+                  "\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}",
+                  static_cast<unsigned long long>(r.ops), r.samples,
+                  r.ns_per_op, r.p50_ns, r.p90_ns, r.p99_ns, r.allocs_per_op,
+                  r.bytes_per_op);
+    out += line;
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+struct BaselineEntry {
+  double ns_per_op = 0;
+  double allocs_per_op = 0;
+};
+
+bool LoadBaseline(const std::string& path,
+                  std::map<std::string, BaselineEntry>* out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::ostringstream text;
+  text << file.rdbuf();
+  cfvpn::JsonValue root;
+  std::string error;
+  if (!cfvpn::ParseJson(text.str(), &root, &error)) {
+    std::fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+    return false;
+  }
+  const cfvpn::JsonValue* list = root.Find("benchmarks");
+  if (list == nullptr || !list->is_array()) return false;
+  for (const cfvpn::JsonValue& item : list->items) {
+    const cfvpn::JsonValue* name = item.Find("name");
+    const cfvpn::JsonValue* ns = item.Find("ns_per_op");
+    const cfvpn::JsonValue* allocs = item.Find("allocs_per_op");
+    if (name == nullptr || ns == nullptr || !name->is_string()) continue;
+    BaselineEntry& entry = (*out)[name->text];
+    entry.ns_per_op = std::strtod(ns->text.c_str(), nullptr);
+    if (allocs != nullptr) {
+      entry.allocs_per_op = std::strtod(allocs->text.c_str(), nullptr);
+    }
+  }
+  return true;
+}
+
+// 打印与基线的对比，返回回归的用例数。分配次数是确定的，
+// 每次操作多出半次以上就算回归。
+int CompareWithBaseline(const std::vector<Result>& results,
+                        const std::map<std::string, BaselineEntry>& baseline,
+                        double threshold_pct) {
+  int regressions = 0;
+  std::printf("\n%-28s %12s %12s %8s %10s %10s\n", "vs baseline", "base ns",
+              "now ns", "delta", "base alloc", "now alloc");
+  for (const Result& r : results) {
+    const auto it = baseline.find(r.name);
+    if (it == baseline.end() || it->second.ns_per_op <= 0) {
+      std::printf("%-28s %12s\n", r.name.c_str(), "(new)");
+      continue;
+    }
+    const BaselineEntry& base = it->second;
+    const double delta = 100.0 * (r.ns_per_op - base.ns_per_op) /
+                         base.ns_per_op;
+    const bool slower = delta > threshold_pct;
+    const bool more_allocs = r.allocs_per_op > base.allocs_per_op + 0.5;
+    if (slower || more_allocs) ++regressions;
+    std::printf("%-28s %12.1f %12.1f %+7.1f%% %10.2f %10.2f%s\n",
+                r.name.c_str(), base.ns_per_op, r.ns_per_op, delta,
+                base.allocs_per_op, r.allocs_per_op,
+                slower || more_allocs ? "  REGRESSION" : "");
+  }
+  return regressions;
+}
+
+// ===== 回环服务 =====
+
+// 若干线程共享一个监听套接字，逐个 accept。reply 为空时接受后立即关闭
+// （TCPing 只需要握手完成），否则读完请求头后回复 reply 再关闭。
+class LoopbackResponder {
+ public:
+  LoopbackResponder(std::string reply, int workers) : reply_(std::move(reply)) {
+    listener_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener_ == cfvpn::kInvalidSocket) return;
+    int reuse = 1;
+    ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = cfvpn::MakeSockaddrV4(kLoopbackIp, 0);
+    socklen_t length = sizeof(address);
+    if (::bind(listener_, reinterpret_cast<sockaddr*>(&address),
+               sizeof(address)) != 0 ||
+        ::getsockname(listener_, reinterpret_cast<sockaddr*>(&address),
+                      &length) != 0 ||
+        ::listen(listener_, 4096) != 0) {
+      cfvpn::CloseSocket(listener_);
+      listener_ = cfvpn::kInvalidSocket;
+      return;
+    }
+    port_ = ntohs(address.sin_port);
+    for (int i = 0; i < workers; ++i) {
+      workers_.emplace_back(&LoopbackResponder::Serve, this);
+    }
+  }
+
+  ~LoopbackResponder() {
+    stopping_.store(true);
+    for (std::thread& worker : workers_) worker.join();
+    cfvpn::CloseSocket(listener_);
+  }
+
+  bool ok() const { return listener_ != cfvpn::kInvalidSocket; }
+  uint16_t port() const { return port_; }
+
+  static constexpr uint32_t kLoopbackIp = 0x7F000001;
+
+ private:
+  void Serve() {
+    char buffer[2048];
+    while (!stopping_.load()) {
+      pollfd entry = {listener_, POLLIN, 0};
+      if (::poll(&entry, 1, 20) <= 0) continue;
+      cfvpn::NativeSocket client = ::accept(listener_, nullptr, nullptr);
+      if (client == cfvpn::kInvalidSocket) continue;
+      if (!reply_.empty()) {
+        std::string request;
+        while (request.find("\r\n\r\n") == std::string::npos) {
+          const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+          if (n <= 0) break;
+          request.append(buffer, static_cast<size_t>(n));
+        }
+        ::send(client, reply_.data(), reply_.size(), MSG_NOSIGNAL);
+      }
+      cfvpn::CloseSocket(client);
+    }
+  }
+
+  std::string reply_;
+  cfvpn::NativeSocket listener_ = cfvpn::kInvalidSocket;
+  uint16_t port_ = 0;
+  std::atomic<bool> stopping_{false};
+  std::vector<std::thread> workers_;
+};
+
+// ===== 用例 =====
+
+// 与 cfvpn_link_bench 相同组成的订阅：vmess/vless/trojan/ss 各占四分之一
+std::string VlessLink(int i) {
+  return "vless://b831381d-6324-4d53-ad4f-" + std::to_string(100000000000 + i) +
+         "@104.16." + std::to_string(i / 256 % 256) + "." +
+         std::to_string(i % 256) +
+         ":443?encryption=none&security=tls&sni=edge.example.com"
+         "&type=ws&host=edge.example.com&path=%2F%3Fed%3D2048#node-" +
+         std::to_string(i);
+}
+
+std::string MakeSubscription(int count) {
+  std::string out;
+  for (int i = 0; i < count; ++i) {
+    switch (i % 3) {
+      case 0:
+        out += VlessLink(i);
+        break;
+      case 1:
+        out += "trojan://password" + std::to_string(i) + "@104.17.0." +
+               std::to_string(i % 256) +
+               ":8443?security=tls&type=grpc&serviceName=grpc#t" +
+               std::to_string(i);
+        break;
+      default:
+        // aes-256-gcm:secret
+        out += "ss://YWVzLTI1Ni1nY206c2VjcmV0@104.18.0." +
+               std::to_string(i % 256) + ":8388#ss-" + std::to_string(i);
+        break;
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+// 用例需要的长期状态，在 main 中构造一次
+struct Fixtures {
+  Fixtures()
+      : index([] {
+          std::vector<cfvpn::Ipv4Range> ranges;
+          cfvpn::ParseCidrList(cfvpn::kCloudflareIpRanges, &ranges);
+          return ranges;
+        }()),
+        sampler(index),
+        sample_out(500),
+        histograms(50000),
+        vless(VlessLink(7)),
+        subscription(MakeSubscription(1000)),
+        tcp_server(std::string(), 4),
+        http_server(
+            "HTTP/1.1 200 OK\r\nContent-Length: 41\r\nConnection: close\r\n"
+            "\r\nfl=1\nip=127.0.0.1\nts=1.0\ncolo=NRT\nloc=JP\n",
+            8) {}
+
+  cfvpn::Ipv4RangeIndex index;
+  cfvpn::CidrSampler sampler;
+  std::vector<uint32_t> sample_out;
+  uint64_t seed = 1;
+
+  // 全量扫描规模的每目标直方图
+  std::vector<cfvpn::LatencyHistogram> histograms;
+
+  std::string vless;
+  std::string subscription;
+  std::vector<cfvpn::ShareLink> links;
+  std::vector<cfvpn::LinkError> link_errors;
+
+  std::string config_template;
+  cfvpn::V2rayConfigBuilder builder;
+  cfvpn::V2rayConfigParams params;
+
+  std::unique_ptr<cfvpn::AsyncLogger> logger;
+  fs::path log_dir;
+
+  LoopbackResponder tcp_server;
+  LoopbackResponder http_server;
+};
+
+std::vector<Case> MakeCases(Fixtures* f) {
+  std::vector<Case> cases;
+
+  // CloudflareTestService 每次测试的采样（默认 500 个 IP）
+  cases.push_back({"cidr/sample_500", [f](size_t n) {
+                     for (size_t i = 0; i < n; ++i) {
+                       f->sampler.Sample(f->sample_out.size(), f->seed++,
+                                         f->sample_out.data());
+                     }
+                     return n;
+                   }});
+  cases.push_back({"cidr/address_at", [f](size_t n) {
+                     uint32_t sink = 0;
+                     const uint64_t count = f->index.address_count();
+                     for (size_t i = 0; i < n; ++i) {
+                       sink ^= f->index.AddressAt((f->seed++ * 2654435761u) %
+                                                  count);
+                     }
+                     f->sample_out[0] = sink;
+                     return n;
+                   }});
+
+  // TCPing 引擎每个有效样本一次 Record，目标按完成顺序交错，访问近似随机
+  cases.push_back({"latency/record_50k", [f](size_t n) {
+                     const size_t count = f->histograms.size();
+                     for (size_t i = 0; i < n; ++i) {
+                       const uint64_t x = f->seed++ * 2654435761u;
+                       f->histograms[x % count].Record(
+                           static_cast<int32_t>(30 + (x >> 32) % 400));
+                     }
+                     return n;
+                   }});
+  cases.push_back({"latency/percentiles", [f](size_t n) {
+                     int32_t sink = 0;
+                     const size_t count = f->histograms.size();
+                     for (size_t i = 0; i < n; ++i) {
+                       const cfvpn::LatencyHistogram& histogram =
+                           f->histograms[(f->seed++ * 2654435761u) % count];
+                       sink ^= histogram.ValueAtPercentile(50) ^
+                               histogram.ValueAtPercentile(90) ^
+                               histogram.ValueAtPercentile(99);
+                     }
+                     f->sample_out[0] = static_cast<uint32_t>(sink);
+                     return n;
+                   }});
+
+  cases.push_back({"link/parse_vless", [f](size_t n) {
+                     cfvpn::ShareLink link;
+                     std::string error;
+                     for (size_t i = 0; i < n; ++i) {
+                       cfvpn::ParseShareLink(f->vless, &link, &error);
+                     }
+                     return n;
+                   }});
+  cases.push_back({"link/subscription_1k", [f](size_t n) {
+                     for (size_t i = 0; i < n; ++i) {
+                       f->links.clear();
+                       f->link_errors.clear();
+                       cfvpn::ParseSubscription(f->subscription, &f->links,
+                                                &f->link_errors);
+                     }
+                     return n;
+                   }});
+
+  if (f->builder.loaded()) {
+    cases.push_back({"config/build", [f](size_t n) {
+                       for (size_t i = 0; i < n; ++i) {
+                         f->params.server_ip[7] =
+                             static_cast<char>('0' + i % 10);
+                         f->builder.Build(f->params);
+                       }
+                       return n;
+                     }});
+    cases.push_back({"config/load_template", [f](size_t n) {
+                       cfvpn::V2rayConfigBuilder builder;
+                       std::string error;
+                       for (size_t i = 0; i < n; ++i) {
+                         builder.LoadTemplate(f->config_template, &error);
+                       }
+                       return n;
+                     }});
+  }
+
+  // 生产者路径：复制进队列即返回。每个样本后等写线程清空队列，
+  // 避免队列满后测到的是丢弃路径。
+  if (f->logger) {
+    const std::string message =
+        "TCPing 104.16.123.45:443 latency=87ms loss=0.00 sent=3 received=3";
+    Case log{"log/enqueue", [f, message](size_t n) {
+               for (size_t i = 0; i < n; ++i) {
+                 f->logger->Write(cfvpn::LogLevel::kInfo, "bench", message);
+               }
+               return n;
+             },
+             1024};
+    log.after_sample = [f] { f->logger->Flush(); };
+    cases.push_back(std::move(log));
+  }
+
+  // 探测引擎：一个样本是一次 Run，op 是一个目标
+  if (f->tcp_server.ok()) {
+    Case tcping{"probe/tcping_loopback", [f](size_t n) {
+                  cfvpn::TcpingOptions options;
+                  options.attempts = 1;
+                  options.min_valid_latency_ms = 0;
+                  options.interval_ms = 0;
+                  options.max_inflight = 128;
+                  cfvpn::TcpingEngine engine(options);
+                  const std::vector<cfvpn::ProbeTarget> targets(
+                      n, cfvpn::ProbeTarget{LoopbackResponder::kLoopbackIp,
+                                            f->tcp_server.port()});
+                  std::vector<cfvpn::ProbeResult> results;
+                  if (!engine.Run(targets, &results)) return size_t{0};
+                  return n;
+                },
+                256};
+    cases.push_back(std::move(tcping));
+  }
+  if (f->http_server.ok()) {
+    Case http{"probe/http_trace_loopback", [f](size_t n) {
+                cfvpn::HttpProbeOptions options;
+                options.timeout_ms = 2000;
+                cfvpn::HttpProbeEngine engine(options);
+                const std::vector<cfvpn::ProbeTarget> targets(
+                    n, cfvpn::ProbeTarget{LoopbackResponder::kLoopbackIp,
+                                          f->http_server.port()});
+                std::vector<cfvpn::HttpProbeResult> results;
+                if (!engine.Run(targets, &results)) return size_t{0};
+                return n;
+              },
+              64};
+    cases.push_back(std::move(http));
+  }
+  return cases;
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "用法: cfvpn_bench [--filter TEXT] [--min-time MS] "
+               "[--json PATH] [--baseline PATH] [--threshold PCT]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string filter;
+  int min_time_ms = 300;
+  std::string json_path;
+  std::string baseline_path;
+  double threshold = 10;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--filter" && has_value) {
+      filter = argv[++i];
+    } else if (arg == "--min-time" && has_value) {
+      min_time_ms = std::max(std::atoi(argv[++i]), 1);
+    } else if (arg == "--json" && has_value) {
+      json_path = argv[++i];
+    } else if (arg == "--baseline" && has_value) {
+      baseline_path = argv[++i];
+    } else if (arg == "--threshold" && has_value) {
+      threshold = std::atof(argv[++i]);
+    } else if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  std::map<std::string, BaselineEntry> baseline;
+  if (!baseline_path.empty() && !LoadBaseline(baseline_path, &baseline)) {
+    std::fprintf(stderr, "无法读取基线 %s\n", baseline_path.c_str());
+    return 2;
+  }
+
+  cfvpn::InitSocketLibrary();
+  Fixtures fixtures;
+  {
+    std::ifstream file(CFVPN_ASSETS_DIR "/js/v2ray_config.json",
+                       std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    fixtures.config_template = text.str();
+    std::string error;
+    if (!fixtures.builder.LoadTemplate(fixtures.config_template, &error)) {
+      std::fprintf(stderr, "跳过 config/*：%s\n", error.c_str());
+    }
+    fixtures.params.server_ip = "104.16.0.1";
+    fixtures.params.server_name = "edge.example.com";
+  }
+  fixtures.log_dir = fs::temp_directory_path() / "cfvpn_bench_logs";
+  fs::remove_all(fixtures.log_dir);
+  if (fs::create_directories(fixtures.log_dir)) {
+    cfvpn::AsyncLoggerOptions options;
+    options.directory = fixtures.log_dir.string();
+    options.max_file_bytes = 256 * 1024 * 1024;
+    fixtures.logger = std::make_unique<cfvpn::AsyncLogger>(options);
+    fixtures.logger->Start();
+  }
+
+  std::printf("%-28s %10s %10s %10s %10s %9s %9s\n", "benchmark", "ns/op",
+              "p50", "p90", "p99", "allocs/op", "B/op");
+  std::vector<Result> results;
+  for (const Case& bench : MakeCases(&fixtures)) {
+    if (!filter.empty() && bench.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    const Result r = Measure(bench, std::chrono::milliseconds(min_time_ms));
+    if (r.ops == 0) {
+      std::printf("%-28s failed\n", r.name.c_str());
+      continue;
+    }
+    std::printf("%-28s %10.1f %10.1f %10.1f %10.1f %9.2f %9.1f\n",
+                r.name.c_str(), r.ns_per_op, r.p50_ns, r.p90_ns, r.p99_ns,
+                r.allocs_per_op, r.bytes_per_op);
+    std::fflush(stdout);
+    results.push_back(r);
+  }
+  if (fixtures.logger) {
+    fixtures.logger->Stop();
+    if (fixtures.logger->dropped() > 0) {
+      std::printf("log/enqueue dropped %llu records\n",
+                  static_cast<unsigned long long>(fixtures.logger->dropped()));
+    }
+    fixtures.logger.reset();
+  }
+  fs::remove_all(fixtures.log_dir);
+
+  if (!json_path.empty()) {
+    const std::string json = ToJson(results);
+    if (json_path == "-") {
+      std::fwrite(json.data(), 1, json.size(), stdout);
+    } else {
+      std::ofstream(json_path, std::ios::binary | std::ios::trunc) << json;
+    }
+  }
+  if (!baseline.empty()) {
+    const int regressions = CompareWithBaseline(results, baseline, threshold);
+    if (regressions > 0) {
+      std::printf("%d regression(s) above %.0f%%\n", regressions, threshold);
+      return 1;
+    }
+  }
+  return 0;
+}
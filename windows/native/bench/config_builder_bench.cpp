@@ -0,0 +1,148 @@
+// 节点切换时生成 v2ray 配置的耗时。
+//
+//   cfvpn_config_bench [模板路径] [切换次数]
+//
+// reparse：每次都解析模板、修改文档并序列化（原来每次连接的做法）；
+// cached：模板只解析一次，之后由 V2rayConfigBuilder 增量拼接；
+// cached+write：增量拼接并写入配置文件（临时文件后替换）。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/json.h"
+#include "core/native_api.h"
+#include "core/v2ray_config.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+cfvpn::JsonValue* FindTagged(cfvpn::JsonValue* list, const char* tag) {
+  if (list == nullptr) return nullptr;
+  for (cfvpn::JsonValue& item : list->items) {
+    const cfvpn::JsonValue* field = item.Find("tag");
+    if (field != nullptr && field->text == tag) return &item;
+  }
+  return nullptr;
+}
+
+// 与 V2RayService._generateConfigMap 相同的完整流程
+std::string Reparse(const std::string& text,
+                    const cfvpn::V2rayConfigParams& params) {
+  cfvpn::JsonValue root;
+  if (!cfvpn::ParseJson(text, &root, nullptr)) return std::string();
+  cfvpn::JsonValue* inbounds = root.Find("inbounds");
+  if (cfvpn::JsonValue* socks = FindTagged(inbounds, "socks")) {
+    socks->Member("port") = cfvpn::JsonValue::Number(params.socks_port);
+  }
+  if (cfvpn::JsonValue* http = FindTagged(inbounds, "http")) {
+    http->Member("port") = cfvpn::JsonValue::Number(params.http_port);
+  }
+  if (cfvpn::JsonValue* proxy = FindTagged(root.Find("outbounds"), "proxy")) {
+    cfvpn::JsonValue& server = proxy->Find("settings")->Find("vnext")->items[0];
+    server.Member("address") = cfvpn::JsonValue::String(params.server_ip);
+    cfvpn::JsonValue* stream = proxy->Find("streamSettings");
+    stream->Find("tlsSettings")->Member("serverName") =
+        cfvpn::JsonValue::String(params.server_name);
+    stream->Find("wsSettings")->Find("headers")->Member("Host") =
+        cfvpn::JsonValue::String(params.server_name);
+  }
+  if (params.global_proxy) {
+    cfvpn::JsonValue& rules = *root.Find("routing")->Find("rules");
+    rules.items.resize(1);
+    cfvpn::JsonValue global;
+    global.type = cfvpn::JsonValue::Type::kObject;
+    global.Member("type") = cfvpn::JsonValue::String("field");
+    global.Member("port") = cfvpn::JsonValue::String("0-65535");
+    global.Member("outboundTag") = cfvpn::JsonValue::String("proxy");
+    rules.items.push_back(global);
+  }
+  std::string out;
+  cfvpn::AppendJson(root, &out);
+  return out;
+}
+
+cfvpn::V2rayConfigParams SwitchParams(int i) {
+  cfvpn::V2rayConfigParams params;
+  params.server_ip = "104.16." + std::to_string(i / 256 % 256) + "." +
+                     std::to_string(i % 256);
+  params.server_name = "edge.example.com";
+  params.global_proxy = i % 4 == 0;
+  return params;
+}
+
+template <typename Fn>
+void Measure(const char* name, int switches, Fn&& fn) {
+  std::vector<double> samples;
+  samples.reserve(static_cast<size_t>(switches));
+  size_t bytes = 0;
+  for (int i = 0; i < switches; ++i) {
+    const auto start = Clock::now();
+    bytes += fn(i);
+    samples.push_back(
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (double sample : samples) total += sample;
+  std::printf("%-14s %10.0f ns/switch  p50 %10.0f  p99 %10.0f  (%zu bytes)\n",
+              name, total / switches, samples[samples.size() / 2],
+              samples[samples.size() * 99 / 100], bytes / switches);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string path =
+      argc > 1 ? argv[1] : CFVPN_ASSETS_DIR "/js/v2ray_config.json";
+  const int switches = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 20000;
+
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  const std::string text = content.str();
+
+  const auto load_start = Clock::now();
+  cfvpn::V2rayConfigBuilder builder;
+  std::string error;
+  if (!builder.LoadTemplate(text, &error)) {
+    std::fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+    return 1;
+  }
+  std::printf("template       %zu bytes, load %.1f us\n", text.size(),
+              std::chrono::duration<double, std::micro>(Clock::now() -
+                                                        load_start)
+                  .count());
+
+  Measure("reparse", switches,
+          [&](int i) { return Reparse(text, SwitchParams(i)).size(); });
+  Measure("cached", switches,
+          [&](int i) { return builder.Build(SwitchParams(i)).size(); });
+
+  CfvpnConfigBuilder* native =
+      cfvpn_config_builder_create(text.data(), static_cast<int32_t>(text.size()));
+  const std::string output =
+      (std::filesystem::temp_directory_path() / "cfvpn_config_bench.json")
+          .string();
+  Measure("cached+write", std::min(switches, 2000), [&](int i) {
+    const cfvpn::V2rayConfigParams params = SwitchParams(i);
+    CfvpnV2rayConfigParams c_params = {};
+    c_params.server_ip = params.server_ip.c_str();
+    c_params.server_name = params.server_name.c_str();
+    c_params.socks_port = params.socks_port;
+    c_params.http_port = params.http_port;
+    c_params.global_proxy = params.global_proxy ? 1 : 0;
+    return static_cast<size_t>(std::max(
+        cfvpn_config_builder_write(native, &c_params, output.c_str()), 0));
+  });
+  cfvpn_config_builder_free(native);
+  std::filesystem::remove(output);
+  return 0;
+}
@@ -0,0 +1,120 @@
+// 订阅解析吞吐量。
+//
+//   cfvpn_link_bench [链接数] [轮数]
+//
+// 生成混合协议的订阅（vmess/vless/trojan/ss 各占四分之一），分别测量
+// 明文按行解析、整体 base64 订阅解析，以及经由 C API 打包成扁平记录
+// （Dart 侧实际走的路径）的耗时。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/share_link.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string Base64(const std::string& data) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((data.size() + 2) / 3 * 4);
+  for (size_t i = 0; i < data.size(); i += 3) {
+    uint32_t x = static_cast<uint8_t>(data[i]) << 16;
+    if (i + 1 < data.size()) x |= static_cast<uint8_t>(data[i + 1]) << 8;
+    if (i + 2 < data.size()) x |= static_cast<uint8_t>(data[i + 2]);
+    out.push_back(kAlphabet[x >> 18 & 63]);
+    out.push_back(kAlphabet[x >> 12 & 63]);
+    out.push_back(i + 1 < data.size() ? kAlphabet[x >> 6 & 63] : '=');
+    out.push_back(i + 2 < data.size() ? kAlphabet[x & 63] : '=');
+  }
+  return out;
+}
+
+std::string MakeSubscription(int count) {
+  std::string out;
+  for (int i = 0; i < count; ++i) {
+    const std::string ip = "104.16." + std::to_string(i / 256 % 256) + "." +
+                           std::to_string(i % 256);
+    const std::string id = "b831381d-6324-4d53-ad4f-" + std::to_string(100000000000 + i);
+    switch (i % 4) {
+      case 0:
+        out += "vmess://" +
+               Base64(R"({"v":"2","ps":"节点 )" + std::to_string(i) +
+                      R"(","add":")" + ip + R"(","port":"443","id":")" + id +
+                      R"(","aid":"0","net":"ws","type":"none",)"
+                      R"("host":"edge.example.com","path":"/ws","tls":"tls"})");
+        break;
+      case 1:
+        out += "vless://" + id + "@" + ip +
+               ":443?encryption=none&security=tls&sni=edge.example.com"
+               "&type=ws&host=edge.example.com&path=%2F%3Fed%3D2048#node-" +
+               std::to_string(i);
+        break;
+      case 2:
+        out += "trojan://password" + std::to_string(i) + "@" + ip +
+               ":8443?security=tls&type=grpc&serviceName=grpc#t" +
+               std::to_string(i);
+        break;
+      default:
+        out += "ss://" + Base64("aes-256-gcm:secret" + std::to_string(i)) +
+               "@" + ip + ":8388#ss-" + std::to_string(i);
+        break;
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+template <typename Fn>
+void Measure(const char* name, const std::string& data, int rounds, Fn&& fn) {
+  std::vector<double> samples;
+  size_t links = 0;
+  for (int round = 0; round < rounds; ++round) {
+    const auto start = Clock::now();
+    links = fn(data);
+    samples.push_back(
+        std::chrono::duration<double>(Clock::now() - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  const double median = samples[samples.size() / 2];
+  std::printf("%-12s %8.1f MB/s  %10.0f links/s  (%zu links, %.2f ms)\n", name,
+              static_cast<double>(data.size()) / median / 1e6,
+              static_cast<double>(links) / median, links, median * 1e3);
+}
+
+size_t ParseAll(const std::string& data) {
+  std::vector<cfvpn::ShareLink> links;
+  std::vector<cfvpn::LinkError> errors;
+  cfvpn::ParseSubscription(data, &links, &errors);
+  return links.size();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int count = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 20000;
+  const int rounds = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 9;
+
+  const std::string plain = MakeSubscription(count);
+  const std::string encoded = Base64(plain);
+  std::printf("subscription   %d links, %zu bytes plain, %zu bytes base64\n",
+              count, plain.size(), encoded.size());
+
+  Measure("plain", plain, rounds, ParseAll);
+  Measure("base64", encoded, rounds, ParseAll);
+  Measure("c-api", encoded, rounds, [](const std::string& data) {
+    CfvpnLinkBatch* batch =
+        cfvpn_links_parse(data.data(), static_cast<int32_t>(data.size()));
+    const size_t links = static_cast<size_t>(cfvpn_links_count(batch));
+    cfvpn_links_free(batch);
+    return links;
+  });
+  return 0;
+}
@@ -0,0 +1,184 @@
+// 启动预热与引擎启动重叠后缩短的"连接按钮可用"时间。
+//
+//   cfvpn_startup_bench [引擎启动毫秒] [轮数] [--cold]
+//
+// 按发布包的规模在临时目录中生成节点缓存（4096 个节点）、v2ray 可执行
+// 文件和 geo 文件，模板使用打包的 assets/js/v2ray_config.json。
+// Flutter 引擎启动（FlutterViewController 创建到 Dart 可以运行）用固定
+// 睡眠代替，默认 350 ms，真实值可从启动追踪（CFVPN_TRACE_FILE）中读取。
+//
+// serial：先启动引擎，再由 Dart 依次做预热中的工作（原来的做法）；
+// overlapped：预热线程与引擎启动并行，引擎就绪后等待预热结束。
+// --cold（仅 Linux）每轮之前用 posix_fadvise 把文件逐出页缓存，模拟
+// 开机后第一次启动。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/node_cache.h"
+#include "core/startup_prewarm.h"
+#include "core/v2ray_config.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+constexpr int64_t kMiB = 1 << 20;
+
+void WriteBlob(const fs::path& path, int64_t size, const char* magic) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  std::vector<char> chunk(static_cast<size_t>(kMiB));
+  uint32_t x = 0x9E3779B9u;
+  for (char& c : chunk) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    c = static_cast<char>(x);
+  }
+  std::memcpy(chunk.data(), magic, std::strlen(magic));
+  for (int64_t written = 0; written < size; written += kMiB) {
+    file.write(chunk.data(),
+               static_cast<std::streamsize>(std::min(kMiB, size - written)));
+  }
+}
+
+void EvictFromPageCache(const std::vector<std::string>& paths) {
+#ifdef __linux__
+  for (const std::string& path : paths) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+#else
+  (void)paths;
+#endif
+}
+
+double Ms(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int engine_ms = 350;
+  int rounds = 7;
+  bool cold = false;
+  int positional = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--cold") == 0) {
+      cold = true;
+    } else if (positional++ == 0) {
+      engine_ms = std::max(std::atoi(argv[i]), 0);
+    } else {
+      rounds = std::max(std::atoi(argv[i]), 1);
+    }
+  }
+
+  const fs::path dir = fs::temp_directory_path() / "cfvpn_startup_bench";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "v2ray");
+
+  cfvpn::PrewarmOptions options;
+  options.node_cache_path = (dir / "node_cache.bin").string();
+  options.config_template_path = CFVPN_ASSETS_DIR "/js/v2ray_config.json";
+  options.v2ray_path = (dir / "v2ray" / "v2ray.exe").string();
+  options.geo_files = {(dir / "v2ray" / "geoip.dat").string(),
+                       (dir / "v2ray" / "geosite.dat").string()};
+  {
+    cfvpn::NodeCache cache;
+    if (!cache.Open(options.node_cache_path, options.node_cache)) {
+      std::fprintf(stderr, "cannot create %s\n",
+                   options.node_cache_path.c_str());
+      return 1;
+    }
+    for (uint32_t i = 0; i < options.node_cache.capacity; ++i) {
+      cfvpn::NodeSample sample;
+      sample.ip = 0x68100000u + i;
+      sample.latency_ms = 40 + static_cast<int32_t>(i % 200);
+      sample.loss_rate = 0;
+      cache.Update(sample, 1700000000);
+    }
+  }
+#ifdef _WIN32
+  WriteBlob(options.v2ray_path, 24 * kMiB, "MZ");
+#else
+  WriteBlob(options.v2ray_path, 24 * kMiB, "\x7f" "ELF");
+#endif
+  WriteBlob(options.geo_files[0], 18 * kMiB, "");
+  WriteBlob(options.geo_files[1], 6 * kMiB, "");
+  std::vector<std::string> files = options.geo_files;
+  files.push_back(options.v2ray_path);
+  files.push_back(options.node_cache_path);
+
+  std::printf("engine boot    %d ms (simulated), %d rounds%s\n", engine_ms,
+              rounds, cold ? ", cold page cache" : "");
+
+  std::vector<double> work;
+  std::vector<double> serial;
+  std::vector<double> overlapped;
+  for (int round = 0; round < rounds; ++round) {
+    const auto engine = std::chrono::milliseconds(engine_ms);
+    {
+      if (cold) EvictFromPageCache(files);
+      const auto start = Clock::now();
+      std::this_thread::sleep_for(engine);
+      cfvpn::NodeCache cache;
+      cfvpn::V2rayConfigBuilder builder;
+      cfvpn::PrewarmReport report;
+      cfvpn::RunStartupPrewarm(options, &cache, &builder, &report);
+      serial.push_back(Ms(Clock::now() - start));
+      work.push_back(report.total_us / 1000.0);
+      if (!report.template_loaded || !report.v2ray_executable) {
+        std::fprintf(stderr, "prewarm failed: %s\n",
+                     report.template_error.c_str());
+        return 1;
+      }
+    }
+    {
+      if (cold) EvictFromPageCache(files);
+      const auto start = Clock::now();
+      cfvpn::NodeCache cache;
+      cfvpn::V2rayConfigBuilder builder;
+      cfvpn::PrewarmReport report;
+      std::thread prewarm([&] {
+        cfvpn::RunStartupPrewarm(options, &cache, &builder, &report);
+      });
+      std::this_thread::sleep_for(engine);
+      prewarm.join();
+      overlapped.push_back(Ms(Clock::now() - start));
+    }
+  }
+
+  const double serial_ms = Median(serial);
+  const double overlapped_ms = Median(overlapped);
+  std::printf("prewarm work   %8.1f ms  (cache + template + v2ray/geo files)\n",
+              Median(work));
+  std::printf("serial         %8.1f ms  to connect-ready\n", serial_ms);
+  std::printf("overlapped     %8.1f ms  to connect-ready\n", overlapped_ms);
+  std::printf("saved          %8.1f ms  (%.0f%%)\n", serial_ms - overlapped_ms,
+              100.0 * (serial_ms - overlapped_ms) / serial_ms);
+  fs::remove_all(dir);
+  return 0;
+}
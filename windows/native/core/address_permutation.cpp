@@ -0,0 +1,121 @@
+#include "core/address_permutation.h"
+
+#include <algorithm>
+
+namespace cfvpn {
+
+namespace {
+
+// splitmix64 的输出函数，作为 Feistel 轮函数
+uint64_t Mix64(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+bool PrefixLess(const IpPrefix& a, const IpPrefix& b) {
+  if (a.base.v6 != b.base.v6) return !a.base.v6;
+  if (a.base.value != b.base.value) return a.base.value < b.base.value;
+  return a.length < b.length;
+}
+
+}  // namespace
+
+FeistelPermutation::FeistelPermutation(const Uint128& size, uint64_t seed)
+    : size_(size) {
+  if (size_ != Uint128()) {
+    int width = (size_ - Uint128::Make(0, 1)).BitWidth();
+    if (width < 2) width = 2;
+    half_bits_ = (width + 1) / 2;
+  }
+  for (uint64_t& key : keys_) {
+    seed += 0x9E3779B97F4A7C15ull;
+    key = Mix64(seed);
+  }
+}
+
+Uint128 FeistelPermutation::Permute(const Uint128& value) const {
+  const uint64_t mask =
+      half_bits_ >= 64 ? ~0ull : (1ull << half_bits_) - 1;
+  uint64_t left = (value >> half_bits_).lo & mask;
+  uint64_t right = value.lo & mask;
+  for (uint64_t key : keys_) {
+    const uint64_t next = left ^ (Mix64(right ^ key) & mask);
+    left = right;
+    right = next;
+  }
+  return (Uint128::Make(0, left) << half_bits_) | Uint128::Make(0, right);
+}
+
+Uint128 FeistelPermutation::At(const Uint128& index) const {
+  Uint128 value = Permute(index);
+  while (!(value < size_)) value = Permute(value);
+  return value;
+}
+
+namespace {
+
+// 去掉被包含的前缀，并计算每个前缀在合并空间中的起始序号
+Uint128 NormalizePrefixes(const std::vector<IpPrefix>& prefixes,
+                          std::vector<IpPrefix>* normalized,
+                          std::vector<Uint128>* starts) {
+  std::vector<IpPrefix> sorted = prefixes;
+  std::sort(sorted.begin(), sorted.end(), PrefixLess);
+  // CIDR 前缀之间要么包含要么不相交，排序后被包含的前缀一定紧跟在
+  // 包含它的前缀之后
+  for (const IpPrefix& prefix : sorted) {
+    if (!normalized->empty() && normalized->back().Contains(prefix.base)) {
+      continue;
+    }
+    normalized->push_back(prefix);
+  }
+
+  const Uint128 saturated = Uint128::LowMask(128);
+  Uint128 size;
+  starts->reserve(normalized->size());
+  for (const IpPrefix& prefix : *normalized) {
+    starts->push_back(size);
+    const Uint128 next = size + prefix.size();
+    size = next < size ? saturated : next;
+  }
+  return size;
+}
+
+}  // namespace
+
+AddressPermutation::AddressPermutation(const std::vector<IpPrefix>& prefixes,
+                                       uint64_t seed)
+    : permutation_(NormalizePrefixes(prefixes, &prefixes_, &starts_), seed) {}
+
+IpAddress AddressPermutation::At(const Uint128& index) const {
+  size_t ignored;
+  return AddressAt(permutation_.At(index), &ignored);
+}
+
+IpAddress AddressPermutation::AddressAt(const Uint128& offset,
+                                        size_t* prefix_index) const {
+  const auto it = std::upper_bound(starts_.begin(), starts_.end(), offset);
+  const size_t index = static_cast<size_t>(it - starts_.begin()) - 1;
+  *prefix_index = index;
+  IpAddress address = prefixes_[index].base;
+  address.value = address.value + (offset - starts_[index]);
+  return address;
+}
+
+bool AddressPermutation::Next(IpAddress* out) {
+  while (position_ < size()) {
+    const Uint128 offset = permutation_.At(position_);
+    position_ = position_ + Uint128::Make(0, 1);
+    size_t prefix_index = 0;
+    const IpAddress address = AddressAt(offset, &prefix_index);
+    if (!address.v6 && prefixes_[prefix_index].length <= 24) {
+      const uint32_t host = address.v4() & 0xFF;
+      if (host == 0 || host == 255) continue;
+    }
+    *out = address;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace cfvpn
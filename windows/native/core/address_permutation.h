@@ -0,0 +1,77 @@
+#ifndef NATIVE_CORE_ADDRESS_PERMUTATION_H_
+#define NATIVE_CORE_ADDRESS_PERMUTATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/ip_address.h"
+
+namespace cfvpn {
+
+// [0, size) 上由种子决定的伪随机双射。
+//
+// 在覆盖 size 的最小偶数位宽上做带密钥的平衡 Feistel 置换，结果不小于
+// size 时继续置换（cycle-walking，期望少于 4 次）。无状态、O(1) 内存，
+// 可以随机访问第 k 个元素。
+class FeistelPermutation {
+ public:
+  FeistelPermutation(const Uint128& size, uint64_t seed);
+
+  Uint128 size() const { return size_; }
+
+  // 排列中第 index 个元素（0 <= index < size）
+  Uint128 At(const Uint128& index) const;
+
+ private:
+  static constexpr int kRounds = 6;
+
+  // [0, 2^(2 * half_bits_)) 上的一次 Feistel 置换
+  Uint128 Permute(const Uint128& value) const;
+
+  Uint128 size_;
+  int half_bits_ = 1;
+  uint64_t keys_[kRounds] = {};
+};
+
+// 混合 IPv4/IPv6 前缀集合上的伪随机排列。
+//
+// 所有前缀（去掉被包含的重复前缀后）按顺序拼成一个大小为 N 的地址空间，
+// 再用 FeistelPermutation 打乱。因此第 k 个地址可以随机访问、整个序列
+// 不重复，内存只与前缀数量有关，与地址数无关，适合 IPv6 /32 这种无法
+// 用位图去重的空间。
+// 相同的前缀集合和种子产生相同的序列。
+class AddressPermutation {
+ public:
+  AddressPermutation(const std::vector<IpPrefix>& prefixes, uint64_t seed);
+
+  // 去重后的前缀，IPv4 在前，各自按地址排序
+  const std::vector<IpPrefix>& prefixes() const { return prefixes_; }
+
+  // 地址总数，超过 2^128 - 1 时饱和
+  Uint128 size() const { return permutation_.size(); }
+
+  // 排列中第 index 个地址（0 <= index < size）
+  IpAddress At(const Uint128& index) const;
+
+  // 按排列顺序取下一个地址，跳过 /24 及更大的 IPv4 段中的 .0 和 .255
+  // （与 CidrSampler 一致）。全部取完后返回 false。
+  bool Next(IpAddress* out);
+
+  // 已经消耗的排列序号，可用于断点续扫
+  Uint128 position() const { return position_; }
+  void set_position(const Uint128& position) { position_ = position; }
+
+ private:
+  // 合并空间中的序号映射为地址
+  IpAddress AddressAt(const Uint128& offset, size_t* prefix_index) const;
+
+  std::vector<IpPrefix> prefixes_;
+  std::vector<Uint128> starts_;  // 每个前缀首地址在合并空间中的序号
+  FeistelPermutation permutation_;
+  Uint128 position_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_ADDRESS_PERMUTATION_H_
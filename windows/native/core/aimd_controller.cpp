@@ -0,0 +1,63 @@
+#include "core/aimd_controller.h"
+
+#include <algorithm>
+
+namespace cfvpn {
+
+AimdController::AimdController(const AimdOptions& options)
+    : options_(options) {
+  options_.min_window = std::max(1, options_.min_window);
+  options_.max_window = std::max(options_.min_window, options_.max_window);
+  window_ = static_cast<double>(std::min(
+      options_.max_window,
+      std::max(options_.min_window, options_.initial_window)));
+}
+
+void AimdController::OnSuccess() {
+  // 慢启动每次成功加一；之后每轮加一，即每次加 1/window
+  window_ += slow_start_ ? 1.0 : 1.0 / window_;
+  window_ = std::min(window_, static_cast<double>(options_.max_window));
+  CompleteOne();
+}
+
+void AimdController::OnTimeout() {
+  ++round_timeouts_;
+  CompleteOne();
+}
+
+void AimdController::OnFailure() {
+  CompleteOne();
+}
+
+void AimdController::OnLocalError() {
+  // 资源错误不算一次完成，但同样受“每轮最多收缩一次”的限制
+  if (since_decrease_ >= static_cast<int64_t>(window_) / 2 || decreases_ == 0) {
+    Decrease(options_.local_error_decrease);
+  }
+}
+
+void AimdController::CompleteOne() {
+  ++since_decrease_;
+  if (++round_completions_ < static_cast<int>(window_)) {
+    return;
+  }
+  double ratio = static_cast<double>(round_timeouts_) / round_completions_;
+  round_completions_ = 0;
+  round_timeouts_ = 0;
+  if (ratio > options_.timeout_ratio_threshold &&
+      (since_decrease_ >= static_cast<int64_t>(window_) || decreases_ == 0)) {
+    Decrease(options_.timeout_decrease);
+  }
+}
+
+void AimdController::Decrease(double factor) {
+  window_ = std::max(static_cast<double>(options_.min_window),
+                     window_ * factor);
+  slow_start_ = false;
+  ++decreases_;
+  since_decrease_ = 0;
+  round_completions_ = 0;
+  round_timeouts_ = 0;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,72 @@
+#ifndef NATIVE_CORE_AIMD_CONTROLLER_H_
+#define NATIVE_CORE_AIMD_CONTROLLER_H_
+
+#include <cstdint>
+
+namespace cfvpn {
+
+// 并发窗口参数
+struct AimdOptions {
+  int min_window = 16;
+  int max_window = 1024;
+  int initial_window = 128;
+  // 本机资源不足（端口耗尽、缓冲区不足）时窗口乘以该系数
+  double local_error_decrease = 0.5;
+  // 一轮内超时比例超过阈值时窗口乘以该系数
+  double timeout_decrease = 0.75;
+  double timeout_ratio_threshold = 0.5;
+};
+
+// 探测并发窗口的 AIMD 控制器。
+//
+// 与 TCP 拥塞控制类似：开始时每次成功窗口加一（慢启动，约每轮翻倍），
+// 第一次收缩后改为每轮只加一。每完成“一个窗口”的探测算作一轮，
+// 这一轮里超时比例过高说明本机到路由器之间已经拥塞（家用路由器的 NAT 表
+// 被占满时表现为大量超时），窗口按比例收缩；本机资源错误立即收缩。
+// 超时引起的收缩至少间隔一轮、资源错误至少间隔半轮，避免同一波拥塞
+// 把窗口一路压到最小值。
+//
+// 非线程安全，由引擎线程独占使用。
+class AimdController {
+ public:
+  explicit AimdController(const AimdOptions& options);
+
+  // 当前允许的在途数
+  int window() const { return static_cast<int>(window_); }
+
+  // 是否仍处于慢启动阶段
+  bool slow_start() const { return slow_start_; }
+
+  // 收缩次数，用于日志和测试
+  int decreases() const { return decreases_; }
+
+  // 一次探测成功建立连接
+  void OnSuccess();
+
+  // 一次探测超时
+  void OnTimeout();
+
+  // 一次探测被对端拒绝或出现其他与拥塞无关的失败
+  void OnFailure();
+
+  // 发起连接时遇到本机资源错误
+  void OnLocalError();
+
+ private:
+  void CompleteOne();
+  void Decrease(double factor);
+
+  AimdOptions options_;
+  double window_;
+  bool slow_start_ = true;
+  int decreases_ = 0;
+  // 当前一轮的统计
+  int round_completions_ = 0;
+  int round_timeouts_ = 0;
+  // 上次收缩后完成的探测数
+  int64_t since_decrease_ = 0;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_AIMD_CONTROLLER_H_
@@ -0,0 +1,508 @@
+#include "core/async_logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+namespace cfvpn {
+
+namespace {
+
+#if defined(_WIN32)
+constexpr char kPlatform[] = "windows";
+
+std::wstring Utf8ToWide(const std::string& text) {
+  int length = ::MultiByteToWideChar(CP_UTF8, 0, text.data(),
+                                     static_cast<int>(text.size()), nullptr, 0);
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  if (length > 0) {
+    ::MultiByteToWideChar(CP_UTF8, 0, text.data(),
+                          static_cast<int>(text.size()), &wide[0], length);
+  }
+  return wide;
+}
+
+std::FILE* OpenForAppend(const std::string& path) {
+  return ::_wfopen(Utf8ToWide(path).c_str(), L"ab");
+}
+
+void RemoveFile(const std::string& path) {
+  ::_wremove(Utf8ToWide(path).c_str());
+}
+
+void RenameFile(const std::string& from, const std::string& to) {
+  ::_wrename(Utf8ToWide(from).c_str(), Utf8ToWide(to).c_str());
+}
+
+bool LocalTime(std::time_t seconds, std::tm* out) {
+  return ::localtime_s(out, &seconds) == 0;
+}
+#else
+#if defined(__APPLE__)
+constexpr char kPlatform[] = "macos";
+#else
+constexpr char kPlatform[] = "linux";
+#endif
+
+std::FILE* OpenForAppend(const std::string& path) {
+  return std::fopen(path.c_str(), "ab");
+}
+
+void RemoveFile(const std::string& path) { std::remove(path.c_str()); }
+
+void RenameFile(const std::string& from, const std::string& to) {
+  std::rename(from.c_str(), to.c_str());
+}
+
+bool LocalTime(std::time_t seconds, std::tm* out) {
+  return ::localtime_r(&seconds, out) != nullptr;
+}
+#endif
+
+const char* LevelName(uint8_t level) {
+  switch (static_cast<LogLevel>(level)) {
+    case LogLevel::kDebug:
+      return "DEBUG";
+    case LogLevel::kInfo:
+      return "INFO";
+    case LogLevel::kWarn:
+      return "WARN";
+    case LogLevel::kError:
+      return "ERROR";
+  }
+  return "INFO";
+}
+
+// 与 Dart 端的 tag.replaceAll(RegExp(r'[^\w\-]'), '_') 一致
+std::string SafeTag(std::string_view tag) {
+  std::string safe(tag);
+  for (char& c : safe) {
+    const bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                      (c >= '0' && c <= '9') || c == '_' || c == '-';
+    if (!word) c = '_';
+  }
+  return safe;
+}
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// 本地时间，格式与 Dart 的 DateTime.toIso8601String() 相同
+struct LocalStamp {
+  char iso[64];  // 留足 snprintf 对任意 int 的最坏长度
+  char date[48];
+};
+
+void FormatStamp(int64_t time_us, LocalStamp* out) {
+  const std::time_t seconds = static_cast<std::time_t>(
+      time_us >= 0 ? time_us / 1000000 : (time_us - 999999) / 1000000);
+  const int micros = static_cast<int>(time_us - seconds * 1000000LL);
+  std::tm tm = {};
+  LocalTime(seconds, &tm);
+  std::snprintf(out->iso, sizeof(out->iso),
+                "%04d-%02d-%02dT%02d:%02d:%02d.%06d", tm.tm_year + 1900,
+                tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                micros);
+  std::snprintf(out->date, sizeof(out->date), "%04d%02d%02d",
+                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) result <<= 1;
+  return result;
+}
+
+}  // namespace
+
+AsyncLogger::AsyncLogger(const AsyncLoggerOptions& options)
+    : options_(options) {
+  const size_t capacity = RoundUpToPowerOfTwo(
+      std::max(options_.queue_records, kMaxRecordsPerMessage));
+  records_.reset(new Record[capacity]);
+  mask_ = capacity - 1;
+  for (size_t i = 0; i < capacity; ++i) {
+    records_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  options_.max_open_files = std::max(options_.max_open_files, 1);
+  options_.max_backups = std::max(options_.max_backups, 0);
+  options_.flush_interval_ms = std::max(options_.flush_interval_ms, 1);
+  if (options_.binary) {
+    BinaryLogOptions binary_options;
+    binary_options.directory = options_.directory;
+    binary_options.max_segment_bytes = options_.binary_segment_bytes;
+    binary_options.max_segments = options_.binary_max_segments;
+    binary_ = std::make_unique<BinaryLogWriter>(binary_options);
+  }
+}
+
+AsyncLogger::~AsyncLogger() {
+  if (DefaultLogger() == this) SetDefaultLogger(nullptr);
+  Stop();
+}
+
+void AsyncLogger::Start() {
+  if (worker_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
+  }
+  worker_ = std::thread(&AsyncLogger::Run, this);
+}
+
+void AsyncLogger::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  if (worker_.joinable()) worker_.join();
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+  Drain();
+  Sync(true);
+  CloseAll();
+}
+
+bool AsyncLogger::Write(LogLevel level, std::string_view tag,
+                        std::string_view message) {
+  return WriteAt(NowMicros(), level, tag, message);
+}
+
+bool AsyncLogger::WriteAt(int64_t time_us, LogLevel level,
+                          std::string_view tag, std::string_view message) {
+  if (message.size() > kMaxMessageBytes) {
+    // 截断时不拆开 UTF-8 多字节字符
+    size_t length = kMaxMessageBytes;
+    while (length > 0 &&
+           (static_cast<uint8_t>(message[length]) & 0xC0) == 0x80) {
+      --length;
+    }
+    message = message.substr(0, length);
+  }
+  const size_t needed =
+      std::max<size_t>((message.size() + kTextBytes - 1) / kTextBytes, 1);
+
+  // 预留 needed 个连续槽位。消费者按顺序释放槽位，所以最后一个槽位
+  // 空闲时前面的也都空闲。
+  uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    const uint64_t last = pos + needed - 1;
+    const uint64_t sequence =
+        records_[last & mask_].sequence.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(sequence - last);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + needed,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  for (size_t i = 0; i < needed; ++i) {
+    Record& record = records_[(pos + i) & mask_];
+    if (i == 0) {
+      const size_t tag_length = std::min(tag.size(), kTagBytes);
+      record.time_us = time_us;
+      record.level = static_cast<uint8_t>(level);
+      record.tag_length = static_cast<uint8_t>(tag_length);
+      std::memcpy(record.tag, tag.data(), tag_length);
+    }
+    const size_t offset = i * kTextBytes;  // 不超过 message.size()
+    const size_t length = std::min(message.size() - offset, kTextBytes);
+    std::memcpy(record.text, message.data() + offset, length);
+    record.length = static_cast<uint16_t>(length);
+    record.continued = i + 1 < needed ? 1 : 0;
+    record.sequence.store(pos + i + 1, std::memory_order_release);
+  }
+
+  // ERROR 立即唤醒写线程，其余记录等待批量写入
+  if (level == LogLevel::kError) wake_.notify_one();
+  return true;
+}
+
+void AsyncLogger::Flush() {
+  const uint64_t target = enqueue_pos_.load(std::memory_order_acquire);
+  if (!worker_.joinable()) {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    Drain();
+    Sync(true);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (written_pos_ < target && !stopping_) {
+    seal_requested_.store(true);
+    wake_.notify_one();
+    drained_.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
+
+void AsyncLogger::CloseFiles() {
+  Flush();
+  std::lock_guard<std::mutex> lock(drain_mutex_);
+  CloseAll();
+}
+
+void AsyncLogger::FlushOnCrash() {
+  // 写线程可能正在写入，短暂等待；崩溃发生在写线程内部时放弃
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    if (drain_mutex_.try_lock()) {
+      Drain();
+      Sync(true);
+      drain_mutex_.unlock();
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void AsyncLogger::Run() {
+  const auto interval = std::chrono::milliseconds(options_.flush_interval_ms);
+  for (;;) {
+    bool stopping;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping = stopping_;
+    }
+    const bool force = seal_requested_.exchange(false) || stopping;
+    size_t processed;
+    uint64_t position;
+    {
+      std::lock_guard<std::mutex> lock(drain_mutex_);
+      processed = Drain();
+      Sync(force);
+      position = durable_pos_;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    written_pos_ = position;
+    drained_.notify_all();
+    if (stopping) break;
+    if (processed == 0 && !stopping_) wake_.wait_for(lock, interval);
+  }
+}
+
+size_t AsyncLogger::Drain() {
+  size_t processed = 0;
+  std::vector<std::FILE*> dirty;
+  for (;;) {
+    Record& record = records_[dequeue_pos_ & mask_];
+    if (record.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+      break;
+    }
+    if (!in_message_) {
+      pending_head_.time_us = record.time_us;
+      pending_head_.level = record.level;
+      pending_head_.tag_length = record.tag_length;
+      std::memcpy(pending_head_.tag, record.tag, record.tag_length);
+    }
+    pending_text_.append(record.text, record.length);
+    const bool continued = record.continued != 0;
+    record.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_pos_;
+    ++processed;
+
+    if (continued) {
+      in_message_ = true;
+      continue;
+    }
+    in_message_ = false;
+    if (binary_ != nullptr) {
+      binary_->Append(pending_head_.time_us,
+                      static_cast<LogLevel>(pending_head_.level),
+                      std::string_view(pending_head_.tag,
+                                       pending_head_.tag_length),
+                      pending_text_);
+      pending_text_.clear();
+      continue;
+    }
+    std::FILE* file = WriteLine(pending_head_, pending_text_);
+    pending_text_.clear();
+    if (file != nullptr &&
+        std::find(dirty.begin(), dirty.end(), file) == dirty.end()) {
+      dirty.push_back(file);
+    }
+  }
+  for (std::FILE* file : dirty) std::fflush(file);
+  return processed;
+}
+
+void AsyncLogger::Sync(bool force) {
+  if (binary_ != nullptr &&
+      (force || binary_->ShouldSeal(NowMicros()))) {
+    binary_->Seal();
+  }
+  // 二进制模式下未压缩写出的块还不算落盘
+  if (binary_ == nullptr || binary_->pending_bytes() == 0) {
+    durable_pos_ = dequeue_pos_;
+  }
+}
+
+std::FILE* AsyncLogger::WriteLine(const Record& head, const std::string& text) {
+  LocalStamp stamp;
+  FormatStamp(head.time_us, &stamp);
+  line_.clear();
+  line_.push_back('[');
+  line_.append(stamp.iso);
+  line_.append("] [");
+  line_.append(LevelName(head.level));
+  line_.append("] ");
+  line_.append(text);
+  line_.push_back('\n');
+
+  const std::string_view tag(head.tag, head.tag_length);
+  OpenFile* open = FileFor(SafeTag(tag), tag, stamp.date, line_.size());
+  if (open == nullptr) return nullptr;
+  std::fwrite(line_.data(), 1, line_.size(), open->file);
+  open->size += static_cast<int64_t>(line_.size());
+  return open->file;
+}
+
+AsyncLogger::OpenFile* AsyncLogger::FileFor(const std::string& tag,
+                                            std::string_view original_tag,
+                                            const std::string& date,
+                                            size_t incoming) {
+  auto it = files_.find(tag);
+  if (it != files_.end()) {
+    OpenFile& open = it->second;
+    const bool new_day = open.date != date;
+    const bool too_large =
+        open.size > 0 &&
+        open.size + static_cast<int64_t>(incoming) > options_.max_file_bytes;
+    if (!new_day && !too_large) {
+      open.last_used = ++use_counter_;
+      return &open;
+    }
+    std::fclose(open.file);
+    files_.erase(it);
+    if (!new_day) Rotate(tag, date);
+  }
+
+  if (files_.size() >= static_cast<size_t>(options_.max_open_files)) {
+    auto oldest = std::min_element(
+        files_.begin(), files_.end(), [](const auto& a, const auto& b) {
+          return a.second.last_used < b.second.last_used;
+        });
+    std::fclose(oldest->second.file);
+    files_.erase(oldest);
+  }
+
+  std::FILE* file = OpenForAppend(PathFor(tag, date, 0));
+  if (file == nullptr) return nullptr;
+  std::fseek(file, 0, SEEK_END);
+  OpenFile open;
+  open.file = file;
+  open.date = date;
+  open.size = static_cast<int64_t>(std::ftell(file));
+  open.last_used = ++use_counter_;
+  if (open.size <= 0) {
+    // 新文件写入会话分隔符，与 Dart 实现一致
+    LocalStamp stamp;
+    FormatStamp(NowMicros(), &stamp);
+    std::string header = "\n" + std::string(50, '=') + "\n=== 日志会话开始 ===\n";
+    header += "时间: " + std::string(stamp.iso) + "\n";
+    header += "日志标签: " + std::string(original_tag) + "\n";
+    header += "平台: " + std::string(kPlatform) + "\n";
+    header += std::string(50, '=') + "\n\n";
+    std::fwrite(header.data(), 1, header.size(), file);
+    open.size = static_cast<int64_t>(header.size());
+  }
+  return &files_.emplace(tag, open).first->second;
+}
+
+void AsyncLogger::Rotate(const std::string& tag, const std::string& date) {
+  const int backups = options_.max_backups;
+  if (backups == 0) {
+    RemoveFile(PathFor(tag, date, 0));
+    return;
+  }
+  RemoveFile(PathFor(tag, date, backups));
+  for (int i = backups - 1; i >= 1; --i) {
+    RenameFile(PathFor(tag, date, i), PathFor(tag, date, i + 1));
+  }
+  RenameFile(PathFor(tag, date, 0), PathFor(tag, date, 1));
+}
+
+std::string AsyncLogger::PathFor(const std::string& tag,
+                                 const std::string& date, int backup) const {
+  std::string path = options_.directory;
+  if (!path.empty() && path.back() != '/' && path.back() != '\\') {
+    path.push_back('/');
+  }
+  path += tag + "_" + date;
+  if (backup > 0) path += "." + std::to_string(backup);
+  path += ".log";
+  return path;
+}
+
+void AsyncLogger::CloseAll() {
+  for (auto& entry : files_) std::fclose(entry.second.file);
+  files_.clear();
+  if (binary_ != nullptr) binary_->Close();
+}
+
+namespace {
+
+std::atomic<AsyncLogger*> g_default_logger{nullptr};
+std::once_flag g_crash_handlers_once;
+
+void FlushDefaultLogger() {
+  AsyncLogger* logger = g_default_logger.load(std::memory_order_acquire);
+  if (logger != nullptr) logger->FlushOnCrash();
+}
+
+#if defined(_WIN32)
+LPTOP_LEVEL_EXCEPTION_FILTER g_previous_filter = nullptr;
+
+LONG WINAPI OnUnhandledException(EXCEPTION_POINTERS* info) {
+  FlushDefaultLogger();
+  return g_previous_filter != nullptr ? g_previous_filter(info)
+                                      : EXCEPTION_CONTINUE_SEARCH;
+}
+
+void InstallCrashHandlers() {
+  g_previous_filter = ::SetUnhandledExceptionFilter(OnUnhandledException);
+  std::atexit(FlushDefaultLogger);
+}
+#else
+// 不处理致命信号：FlushOnCrash 要加锁、等待并经 stdio 写文件，都不是
+// 异步信号安全的，崩溃发生在 malloc 或 stdio 内部时会卡死而不是退出
+void InstallCrashHandlers() { std::atexit(FlushDefaultLogger); }
+#endif
+
+}  // namespace
+
+void SetDefaultLogger(AsyncLogger* logger) {
+  if (logger != nullptr) {
+    std::call_once(g_crash_handlers_once, InstallCrashHandlers);
+  }
+  g_default_logger.store(logger, std::memory_order_release);
+}
+
+AsyncLogger* DefaultLogger() {
+  return g_default_logger.load(std::memory_order_acquire);
+}
+
+void LogMessage(LogLevel level, std::string_view tag,
+                std::string_view message) {
+  AsyncLogger* logger = DefaultLogger();
+  if (logger != nullptr) logger->Write(level, tag, message);
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,157 @@
+#ifndef NATIVE_CORE_ASYNC_LOGGER_H_
+#define NATIVE_CORE_ASYNC_LOGGER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "core/binary_log.h"
+
+namespace cfvpn {
+
+enum class LogLevel : uint8_t { kDebug = 0, kInfo = 1, kWarn = 2, kError = 3 };
+
+struct AsyncLoggerOptions {
+  std::string directory;  // UTF-8，需已存在
+  // 单个文件超过该大小后轮转为 <tag>_<日期>.1.log、.2.log ...
+  int64_t max_file_bytes = 10 * 1024 * 1024;
+  int max_backups = 5;
+  int max_open_files = 10;     // 与 AppConfig.logMaxOpenFiles 一致
+  size_t queue_records = 8192;  // 向上取整为 2 的幂
+  // 队列空闲时写线程的最长等待，也是非 ERROR 记录落盘的最大延迟
+  int flush_interval_ms = 200;
+  // 为 true 时所有 tag 写入压缩的二进制段文件（见 core/binary_log.h），
+  // 不再写文本文件；用 cfvpn_logcat 解码
+  bool binary = false;
+  int64_t binary_segment_bytes = 4 * 1024 * 1024;
+  int binary_max_segments = 64;
+};
+
+// 异步文件日志。
+//
+// 生产者（任意线程，包括 Dart 通过 FFI 调用）把消息复制进固定大小的记录，
+// 放入无锁的多生产者单消费者有界队列后立即返回；唯一的写线程批量取出、
+// 格式化为 "[时间] [级别] 消息"，按 tag 和日期写入 <tag>_<YYYYMMDD>.log，
+// 并负责按日期和大小轮转。队列满时丢弃新记录并计数，生产者从不阻塞。
+//
+// 队列是 Vyukov 风格的环形数组，每个槽位带序号：生产者通过 CAS 预留连续的
+// 槽位（长消息跨多个记录），写完后发布序号；消费者按顺序读取并释放。
+class AsyncLogger {
+ public:
+  explicit AsyncLogger(const AsyncLoggerOptions& options);
+  ~AsyncLogger();
+
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  // 启动写线程
+  void Start();
+  // 写出队列中剩余的记录，关闭文件并停止写线程
+  void Stop();
+
+  // 线程安全、无锁。队列已满时丢弃并返回 false。
+  // 超长的消息截断到 kMaxMessageBytes。
+  bool Write(LogLevel level, std::string_view tag, std::string_view message);
+  // 指定时间（Unix 微秒）写入，用于测试日期轮转
+  bool WriteAt(int64_t time_us, LogLevel level, std::string_view tag,
+               std::string_view message);
+
+  // 阻塞直到调用前写入的记录全部写入文件
+  void Flush();
+  // Flush 后关闭所有打开的文件（清空日志前调用，之后的写入会重新打开）
+  void CloseFiles();
+
+  // 在调用线程中尽力写出仍在队列中的记录，供崩溃处理使用
+  void FlushOnCrash();
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  static constexpr size_t kTagBytes = 32;
+  static constexpr size_t kTextBytes = 200;
+  static constexpr size_t kMaxRecordsPerMessage = 64;
+  static constexpr size_t kMaxMessageBytes = kTextBytes * kMaxRecordsPerMessage;
+
+ private:
+  struct Record {
+    std::atomic<uint64_t> sequence;
+    int64_t time_us;
+    uint16_t length;  // text 中的有效字节数
+    uint8_t level;
+    uint8_t tag_length;
+    uint8_t continued;  // 非 0 表示下一条记录是同一消息的后续部分
+    uint8_t reserved[3];
+    char tag[kTagBytes];
+    char text[kTextBytes];
+  };
+  static_assert(sizeof(Record) == 256, "records stay cache-line multiples");
+
+  struct OpenFile {
+    std::FILE* file = nullptr;
+    std::string date;  // YYYYMMDD
+    int64_t size = 0;
+    uint64_t last_used = 0;
+  };
+
+  void Run();
+  // 取出所有已发布的记录并写入文件，返回处理的记录数。调用方持有 drain_mutex_。
+  size_t Drain();
+  // 二进制模式下按需（或强制）压缩写出当前块，并更新 durable_pos_。
+  // 调用方持有 drain_mutex_。
+  void Sync(bool force);
+  // 写入一行，返回写入的文件（失败时为 nullptr）
+  std::FILE* WriteLine(const Record& head, const std::string& text);
+  OpenFile* FileFor(const std::string& tag, std::string_view original_tag,
+                    const std::string& date, size_t incoming);
+  void Rotate(const std::string& tag, const std::string& date);
+  std::string PathFor(const std::string& tag, const std::string& date,
+                      int backup) const;
+  void CloseAll();
+
+  AsyncLoggerOptions options_;
+  std::unique_ptr<Record[]> records_;
+  size_t mask_ = 0;
+
+  alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+  alignas(64) std::atomic<uint64_t> dropped_{0};
+  alignas(64) uint64_t dequeue_pos_ = 0;  // 仅在持有 drain_mutex_ 时访问
+
+  std::mutex drain_mutex_;
+  std::unordered_map<std::string, OpenFile> files_;
+  uint64_t use_counter_ = 0;
+  Record pending_head_;        // 当前消息第一条记录的时间、级别和 tag
+  bool in_message_ = false;    // 正在拼接跨记录的消息
+  std::string pending_text_;
+  std::string line_;
+  std::unique_ptr<BinaryLogWriter> binary_;
+  uint64_t durable_pos_ = 0;  // 已落盘的队列位置，drain_mutex_ 保护
+  std::atomic<bool> seal_requested_{false};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable drained_;
+  uint64_t written_pos_ = 0;  // durable_pos_ 的副本，mutex_ 保护
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+// 进程内的默认日志器，C++ 代码通过 LogMessage 写日志。
+// 首次设置时安装退出处理（atexit，Windows 上另有未处理的 SEH 异常），
+// 在进程退出前写出队列中剩余的记录；POSIX 上的致命信号不会写出。
+// 传入 nullptr 取消设置。
+void SetDefaultLogger(AsyncLogger* logger);
+AsyncLogger* DefaultLogger();
+
+// 没有默认日志器时什么也不做
+void LogMessage(LogLevel level, std::string_view tag, std::string_view message);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_ASYNC_LOGGER_H_
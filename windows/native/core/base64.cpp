@@ -0,0 +1,136 @@
+#include "core/base64.h"
+
+#include <cstdint>
+
+namespace cfvpn {
+
+namespace {
+
+constexpr uint32_t kBad = 1u << 24;  // 任何合法组合都小于它
+
+struct DecodeTables {
+  uint32_t shifted[4][256];
+};
+
+constexpr int SextetOf(int c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+' || c == '-') return 62;
+  if (c == '/' || c == '_') return 63;
+  return -1;
+}
+
+constexpr DecodeTables MakeTables() {
+  DecodeTables tables{};
+  for (int c = 0; c < 256; ++c) {
+    const int value = SextetOf(c);
+    for (int position = 0; position < 4; ++position) {
+      tables.shifted[position][c] =
+          value < 0 ? kBad
+                    : static_cast<uint32_t>(value) << (18 - 6 * position);
+    }
+  }
+  return tables;
+}
+
+constexpr DecodeTables kTables = MakeTables();
+
+bool IsSpace(unsigned char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+}  // namespace
+
+bool Base64Decode(std::string_view in, std::string* out) {
+  const auto* p = reinterpret_cast<const unsigned char*>(in.data());
+  const size_t n = in.size();
+  const size_t start = out->size();
+  out->resize(start + n / 4 * 3 + 3);
+  char* dst = &(*out)[start];
+  char* const dst_begin = dst;
+
+  const uint32_t* d0 = kTables.shifted[0];
+  const uint32_t* d1 = kTables.shifted[1];
+  const uint32_t* d2 = kTables.shifted[2];
+  const uint32_t* d3 = kTables.shifted[3];
+
+  size_t i = 0;
+  uint32_t accumulator = 0;
+  int pending = 0;  // 慢路径中已收集的字符数
+  bool padded = false;
+  for (;;) {
+    if (pending == 0) {
+      while (i + 4 <= n) {
+        const uint32_t x = d0[p[i]] | d1[p[i + 1]] | d2[p[i + 2]] | d3[p[i + 3]];
+        if (x >= kBad) break;  // 空白、填充或非法字符
+        dst[0] = static_cast<char>(x >> 16);
+        dst[1] = static_cast<char>(x >> 8);
+        dst[2] = static_cast<char>(x);
+        dst += 3;
+        i += 4;
+      }
+    }
+    if (i >= n) break;
+    const unsigned char c = p[i++];
+    if (IsSpace(c)) continue;
+    if (c == '=') {
+      padded = true;
+      break;
+    }
+    const uint32_t value = d3[c];
+    if (value >= kBad) {
+      out->resize(start);
+      return false;
+    }
+    accumulator = accumulator << 6 | value;
+    if (++pending == 4) {
+      dst[0] = static_cast<char>(accumulator >> 16);
+      dst[1] = static_cast<char>(accumulator >> 8);
+      dst[2] = static_cast<char>(accumulator);
+      dst += 3;
+      accumulator = 0;
+      pending = 0;
+    }
+  }
+  // 填充之后只允许更多的填充和空白
+  if (padded) {
+    for (; i < n; ++i) {
+      if (p[i] != '=' && !IsSpace(p[i])) {
+        out->resize(start);
+        return false;
+      }
+    }
+  }
+  switch (pending) {
+    case 1:
+      out->resize(start);
+      return false;
+    case 2:
+      *dst++ = static_cast<char>(accumulator >> 4);
+      break;
+    case 3:
+      *dst++ = static_cast<char>(accumulator >> 10);
+      *dst++ = static_cast<char>(accumulator >> 2);
+      break;
+    default:
+      break;
+  }
+  out->resize(start + static_cast<size_t>(dst - dst_begin));
+  return true;
+}
+
+bool LooksLikeBase64(std::string_view in) {
+  bool any = false;
+  for (char ch : in) {
+    const unsigned char c = static_cast<unsigned char>(ch);
+    if (kTables.shifted[3][c] < kBad) {
+      any = true;
+    } else if (c != '=' && !IsSpace(c)) {
+      return false;
+    }
+  }
+  return any;
+}
+
+}  // namespace cfvpn
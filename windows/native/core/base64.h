@@ -0,0 +1,24 @@
+#ifndef NATIVE_CORE_BASE64_H_
+#define NATIVE_CORE_BASE64_H_
+
+#include <string>
+#include <string_view>
+
+namespace cfvpn {
+
+// Base64 解码，同时接受标准（+/）和 URL 安全（-_）字母表，填充可省略，
+// 忽略其中的空白（订阅内容常按 76 列换行）。结果追加到 out。
+//
+// 每 4 个字符查 4 张预先移位好的表，按位或得到 3 个字节；非法字符在表中
+// 是超出 24 位的哨兵值，整块只需一次比较即可发现，主循环没有逐字符分支。
+// 遇到空白或块末尾时才退回逐字符的慢路径。
+//
+// 输入含非法字符、或有效字符数除 4 余 1 时返回 false，out 的内容不确定。
+bool Base64Decode(std::string_view in, std::string* out);
+
+// 看起来是否是 base64 文本（只含字母表字符、填充和空白）
+bool LooksLikeBase64(std::string_view in);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_BASE64_H_
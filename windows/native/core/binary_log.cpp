@@ -0,0 +1,412 @@
+#include "core/binary_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <system_error>
+
+#include "core/async_logger.h"
+#include "core/lz4_block.h"
+
+namespace cfvpn {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr uint8_t kDefineTag = 1;
+constexpr uint8_t kDefineTemplate = 2;
+constexpr uint8_t kTemplateRecord = 3;
+constexpr uint8_t kRawRecord = 4;
+
+constexpr char kPlaceholder = '\x01';
+constexpr size_t kMaxDigits = 18;  // 不超过 int64
+constexpr size_t kMaxTemplateBytes = 1024;
+constexpr size_t kSegmentHeaderBytes = 16;
+constexpr size_t kBlockHeaderBytes = 12;
+// 解码时拒绝异常大的块，避免损坏的头导致大量分配
+constexpr uint32_t kMaxBlockBytes = 64 * 1024 * 1024;
+
+uint32_t Fnv1a(const std::string& data) {
+  uint32_t hash = 2166136261u;
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void PutZigzag(int64_t value, std::string* out) {
+  PutVarint((static_cast<uint64_t>(value) << 1) ^
+                static_cast<uint64_t>(value >> 63),
+            out);
+}
+
+void PutFixed(uint64_t value, size_t bytes, std::string* out) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out->push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+uint64_t GetFixed(const char* data, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+  }
+  return value;
+}
+
+bool GetVarint(const std::string& data, size_t* offset, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*offset >= data.size()) return false;
+    const uint8_t byte = static_cast<uint8_t>(data[(*offset)++]);
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+bool GetZigzag(const std::string& data, size_t* offset, int64_t* value) {
+  uint64_t raw;
+  if (!GetVarint(data, offset, &raw)) return false;
+  *value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+  return true;
+}
+
+bool GetBytes(const std::string& data, size_t* offset, std::string* out) {
+  uint64_t length;
+  if (!GetVarint(data, offset, &length) || length > data.size() - *offset) {
+    return false;
+  }
+  out->assign(data, *offset, static_cast<size_t>(length));
+  *offset += static_cast<size_t>(length);
+  return true;
+}
+
+std::string SegmentStamp(int64_t time_us) {
+  const std::time_t seconds = static_cast<std::time_t>(time_us / 1000000);
+  std::tm tm = {};
+#if defined(_WIN32)
+  ::localtime_s(&tm, &seconds);
+#else
+  ::localtime_r(&seconds, &tm);
+#endif
+  char stamp[32];
+  std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+  return stamp;
+}
+
+}  // namespace
+
+bool SplitLogTemplate(std::string_view message, std::string* templ,
+                      std::vector<uint64_t>* arguments) {
+  templ->clear();
+  arguments->clear();
+  size_t i = 0;
+  while (i < message.size()) {
+    const char c = message[i];
+    if (c == kPlaceholder) return false;
+    if (c < '0' || c > '9') {
+      templ->push_back(c);
+      ++i;
+      continue;
+    }
+    size_t end = i;
+    while (end < message.size() && message[end] >= '0' && message[end] <= '9') {
+      ++end;
+    }
+    const size_t digits = end - i;
+    // 前导 0 和超长数字无法从整数还原，保留原文
+    if (digits > kMaxDigits || (digits > 1 && c == '0')) {
+      templ->append(message.substr(i, digits));
+    } else {
+      uint64_t value = 0;
+      for (size_t j = i; j < end; ++j) {
+        value = value * 10 + static_cast<uint64_t>(message[j] - '0');
+      }
+      templ->push_back(kPlaceholder);
+      arguments->push_back(value);
+    }
+    i = end;
+  }
+  return true;
+}
+
+BinaryLogWriter::BinaryLogWriter(const BinaryLogOptions& options)
+    : options_(options) {
+  options_.max_segments = std::max(options_.max_segments, 1);
+  options_.block_bytes = std::max<size_t>(options_.block_bytes, 1);
+}
+
+BinaryLogWriter::~BinaryLogWriter() { Close(); }
+
+uint32_t BinaryLogWriter::Intern(
+    std::unordered_map<std::string, uint32_t>* table, uint8_t kind,
+    std::string_view value) {
+  auto it = table->find(std::string(value));
+  if (it != table->end()) return it->second;
+  const uint32_t id = static_cast<uint32_t>(table->size());
+  table->emplace(std::string(value), id);
+  block_.push_back(static_cast<char>(kind));
+  PutVarint(id, &block_);
+  PutVarint(value.size(), &block_);
+  block_.append(value.data(), value.size());
+  return id;
+}
+
+void BinaryLogWriter::Append(int64_t time_us, LogLevel level,
+                             std::string_view tag, std::string_view message) {
+  if (!file_.is_open() && !OpenSegment(time_us)) return;
+  const size_t before = block_.size();
+  if (block_.empty()) block_started_us_ = time_us;
+
+  const uint32_t tag_id = Intern(&tags_, kDefineTag, tag);
+  const bool templated =
+      SplitLogTemplate(message, &template_, &arguments_) &&
+      template_.size() <= kMaxTemplateBytes &&
+      (templates_.size() < options_.max_templates ||
+       templates_.count(template_) != 0);
+  const uint32_t template_id =
+      templated ? Intern(&templates_, kDefineTemplate, template_) : 0;
+
+  block_.push_back(static_cast<char>(templated ? kTemplateRecord : kRawRecord));
+  PutZigzag(time_us - previous_time_us_, &block_);
+  previous_time_us_ = time_us;
+  block_.push_back(static_cast<char>(level));
+  PutVarint(tag_id, &block_);
+  if (templated) {
+    PutVarint(template_id, &block_);
+    // 参数写成与同一模板上一条记录对应参数的差值：递增的计数、相邻的 IP
+    // 等只占一个字节
+    if (template_id == template_arguments_.size()) {
+      template_arguments_.emplace_back(arguments_.size(), 0);
+    }
+    std::vector<uint64_t>& previous = template_arguments_[template_id];
+    for (size_t i = 0; i < arguments_.size(); ++i) {
+      PutZigzag(static_cast<int64_t>(arguments_[i] - previous[i]), &block_);
+      previous[i] = arguments_[i];
+    }
+  } else {
+    PutVarint(message.size(), &block_);
+    block_.append(message.data(), message.size());
+  }
+  raw_bytes_ += static_cast<int64_t>(block_.size() - before);
+}
+
+bool BinaryLogWriter::ShouldSeal(int64_t now_us) const {
+  if (block_.empty()) return false;
+  return block_.size() >= options_.block_bytes ||
+         now_us - block_started_us_ >=
+             static_cast<int64_t>(options_.seal_interval_ms) * 1000;
+}
+
+bool BinaryLogWriter::Seal() {
+  if (block_.empty()) return true;
+  compressed_.clear();
+  PutFixed(block_.size(), 4, &compressed_);
+  PutFixed(0, 8, &compressed_);  // 压缩大小和校验和，压缩后回填
+  const size_t size = Lz4Compress(
+      reinterpret_cast<const uint8_t*>(block_.data()), block_.size(),
+      &compressed_);
+  const uint32_t checksum = Fnv1a(compressed_.substr(kBlockHeaderBytes));
+  for (size_t i = 0; i < 4; ++i) {
+    compressed_[4 + i] = static_cast<char>((size >> (8 * i)) & 0xFF);
+    compressed_[8 + i] = static_cast<char>((checksum >> (8 * i)) & 0xFF);
+  }
+  block_.clear();
+
+  file_.write(compressed_.data(),
+              static_cast<std::streamsize>(compressed_.size()));
+  file_.flush();
+  if (!file_) {
+    file_.close();
+    return false;
+  }
+  segment_bytes_ += static_cast<int64_t>(compressed_.size());
+  bytes_written_ += static_cast<int64_t>(compressed_.size());
+  if (segment_bytes_ >= options_.max_segment_bytes) file_.close();
+  return true;
+}
+
+void BinaryLogWriter::Close() {
+  if (!file_.is_open()) return;
+  Seal();
+  file_.close();
+}
+
+bool BinaryLogWriter::OpenSegment(int64_t time_us) {
+  const fs::path directory = fs::u8path(options_.directory);
+  const std::string stamp = SegmentStamp(time_us);
+  fs::path path;
+  std::error_code error;
+  do {
+    char counter[8];
+    std::snprintf(counter, sizeof(counter), "%04d", segment_counter_++ % 10000);
+    path = directory / fs::u8path(options_.prefix + "_" + stamp + "_" +
+                                  counter + kBinaryLogExtension);
+  } while (fs::exists(path, error));
+
+  file_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!file_.is_open()) return false;
+
+  std::string header;
+  PutFixed(kBinaryLogMagic, 4, &header);
+  PutFixed(kBinaryLogVersion, 2, &header);
+  PutFixed(0, 2, &header);
+  PutFixed(static_cast<uint64_t>(time_us), 8, &header);
+  file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+  segment_path_ = path.u8string();
+  segment_bytes_ = static_cast<int64_t>(header.size());
+  bytes_written_ += segment_bytes_;
+  previous_time_us_ = time_us;
+  tags_.clear();
+  templates_.clear();
+  template_arguments_.clear();
+  PruneSegments();
+  return true;
+}
+
+void BinaryLogWriter::PruneSegments() {
+  const std::string prefix = options_.prefix + "_";
+  std::vector<fs::path> segments;
+  std::error_code error;
+  for (fs::directory_iterator it(fs::u8path(options_.directory), error), end;
+       !error && it != end; it.increment(error)) {
+    const std::string name = it->path().filename().u8string();
+    if (name.compare(0, prefix.size(), prefix) == 0 &&
+        it->path().extension() == kBinaryLogExtension) {
+      segments.push_back(it->path());
+    }
+  }
+  if (segments.size() <= static_cast<size_t>(options_.max_segments)) return;
+  // 文件名以时间和序号开头，字典序即时间顺序
+  std::sort(segments.begin(), segments.end());
+  const size_t excess = segments.size() - static_cast<size_t>(options_.max_segments);
+  for (size_t i = 0; i < excess; ++i) fs::remove(segments[i], error);
+}
+
+bool BinaryLogReader::Open(const std::string& path) {
+  file_.open(fs::u8path(path), std::ios::binary);
+  char header[kSegmentHeaderBytes];
+  if (!file_.read(header, sizeof(header)) ||
+      GetFixed(header, 4) != kBinaryLogMagic ||
+      GetFixed(header + 4, 2) != kBinaryLogVersion) {
+    return false;
+  }
+  base_time_us_ = static_cast<int64_t>(GetFixed(header + 8, 8));
+  previous_time_us_ = base_time_us_;
+  return true;
+}
+
+bool BinaryLogReader::Fail() {
+  truncated_ = true;
+  block_.clear();
+  offset_ = 0;
+  return false;
+}
+
+bool BinaryLogReader::LoadBlock() {
+  char header[kBlockHeaderBytes];
+  file_.read(header, sizeof(header));
+  if (file_.gcount() == 0) return false;  // 正常结束
+  if (file_.gcount() != static_cast<std::streamsize>(sizeof(header))) {
+    return Fail();
+  }
+  const uint32_t raw_size = static_cast<uint32_t>(GetFixed(header, 4));
+  const uint32_t compressed_size = static_cast<uint32_t>(GetFixed(header + 4, 4));
+  const uint32_t checksum = static_cast<uint32_t>(GetFixed(header + 8, 4));
+  if (raw_size > kMaxBlockBytes || compressed_size > kMaxBlockBytes) {
+    return Fail();
+  }
+  compressed_.resize(compressed_size);
+  if (!file_.read(&compressed_[0], compressed_size) ||
+      Fnv1a(compressed_) != checksum) {
+    return Fail();
+  }
+  block_.resize(raw_size);
+  if (!Lz4Decompress(reinterpret_cast<const uint8_t*>(compressed_.data()),
+                     compressed_.size(),
+                     reinterpret_cast<uint8_t*>(&block_[0]), raw_size)) {
+    return Fail();
+  }
+  offset_ = 0;
+  return true;
+}
+
+bool BinaryLogReader::Next(BinaryLogEntry* entry) {
+  for (;;) {
+    if (truncated_) return false;
+    if (offset_ >= block_.size() && !LoadBlock()) return false;
+
+    const uint8_t kind = static_cast<uint8_t>(block_[offset_++]);
+    if (kind == kDefineTag || kind == kDefineTemplate) {
+      uint64_t id;
+      std::string value;
+      std::vector<std::string>& table =
+          kind == kDefineTag ? tags_ : templates_;
+      if (!GetVarint(block_, &offset_, &id) || id != table.size() ||
+          !GetBytes(block_, &offset_, &value)) {
+        return Fail();
+      }
+      if (kind == kDefineTemplate) {
+        template_arguments_.emplace_back(
+            std::count(value.begin(), value.end(), kPlaceholder), 0);
+      }
+      table.push_back(std::move(value));
+      continue;
+    }
+    if (kind != kTemplateRecord && kind != kRawRecord) return Fail();
+
+    int64_t delta;
+    uint64_t tag_id;
+    if (!GetZigzag(block_, &offset_, &delta) || offset_ >= block_.size()) {
+      return Fail();
+    }
+    entry->level = static_cast<uint8_t>(block_[offset_++]);
+    if (!GetVarint(block_, &offset_, &tag_id) || tag_id >= tags_.size()) {
+      return Fail();
+    }
+    previous_time_us_ += delta;
+    entry->time_us = previous_time_us_;
+    entry->tag = tags_[static_cast<size_t>(tag_id)];
+
+    if (kind == kRawRecord) {
+      if (!GetBytes(block_, &offset_, &entry->message)) return Fail();
+      return true;
+    }
+    uint64_t template_id;
+    if (!GetVarint(block_, &offset_, &template_id) ||
+        template_id >= templates_.size()) {
+      return Fail();
+    }
+    const std::string& templ = templates_[static_cast<size_t>(template_id)];
+    std::vector<uint64_t>& previous =
+        template_arguments_[static_cast<size_t>(template_id)];
+    entry->message.clear();
+    size_t index = 0;
+    for (char c : templ) {
+      if (c != kPlaceholder) {
+        entry->message.push_back(c);
+        continue;
+      }
+      int64_t argument_delta;
+      if (!GetZigzag(block_, &offset_, &argument_delta)) return Fail();
+      previous[index] += static_cast<uint64_t>(argument_delta);
+      entry->message += std::to_string(previous[index++]);
+    }
+    return true;
+  }
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,146 @@
+#ifndef NATIVE_CORE_BINARY_LOG_H_
+#define NATIVE_CORE_BINARY_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cfvpn {
+
+enum class LogLevel : uint8_t;
+
+// 紧凑的二进制日志段文件（<prefix>_<YYYYMMDD-HHMMSS>_<NNNN>.clog）。
+//
+// 段文件以 16 字节的头开始：magic "CFLG"、版本、段的基准时间（Unix 微秒）。
+// 之后是若干独立压缩的块：
+//   u32 原始大小 | u32 压缩大小 | u32 FNV-1a(压缩数据) | LZ4 块数据
+// 块内是连续的条目，第一个字节为类型：
+//   1 定义 tag：     varint id | varint 长度 | 字节
+//   2 定义模板：     varint id | varint 长度 | 字节
+//   3 模板记录：     zigzag varint 时间增量 | u8 级别 | varint tag | varint 模板 |
+//                    每个占位符一个 zigzag varint，为参数与该模板上一条记录
+//                    同一位置参数的差值（段内首次为与 0 的差值）
+//   4 原文记录：     zigzag varint 时间增量 | u8 级别 | varint tag | varint 长度 | 字节
+//
+// 日志都是格式化好的字符串，没有真正的格式串。写入时把消息中的十进制
+// 数字串（不含前导 0，最多 18 位）替换为占位符 0x01，替换后的"模板"
+// 在段内只定义一次，之后每条记录只写模板 id 和数字参数。扫描日志里大量的
+// IP、端口、延迟因此只占几个字节，再经 LZ4 压缩。
+//
+// tag 和模板的编号在每个段内独立，定义一定出现在首次使用之前，所以
+// 解码只能从段头顺序读取；某个块损坏时后面的内容无法解码。
+constexpr uint32_t kBinaryLogMagic = 0x474C4643;  // "CFLG"
+constexpr uint16_t kBinaryLogVersion = 1;
+constexpr char kBinaryLogExtension[] = ".clog";
+
+struct BinaryLogOptions {
+  std::string directory;  // UTF-8，需已存在
+  std::string prefix = "cfvpn";
+  int64_t max_segment_bytes = 4 * 1024 * 1024;  // 超过后开始新的段
+  int max_segments = 64;                        // 超出时删除最旧的段
+  size_t block_bytes = 64 * 1024;  // 未压缩数据达到该大小时压缩写出
+  int seal_interval_ms = 1000;     // 未满的块最多等待这么久
+  size_t max_templates = 8192;     // 每段最多定义的模板数，超出后写原文
+};
+
+class BinaryLogWriter {
+ public:
+  explicit BinaryLogWriter(const BinaryLogOptions& options);
+  ~BinaryLogWriter();
+
+  BinaryLogWriter(const BinaryLogWriter&) = delete;
+  BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+
+  // 编码一条记录到当前块（不写文件）
+  void Append(int64_t time_us, LogLevel level, std::string_view tag,
+              std::string_view message);
+
+  // 当前块已满或等待超过 seal_interval_ms 时返回 true
+  bool ShouldSeal(int64_t now_us) const;
+
+  // 压缩并写出当前块；段超过大小上限时关闭，下次 Append 开始新的段。
+  // 写入失败时返回 false（块被丢弃）。
+  bool Seal();
+
+  // 写出当前块并关闭段文件
+  void Close();
+
+  size_t pending_bytes() const { return block_.size(); }
+  // 写入磁盘的累计字节数（含段头和块头）
+  int64_t bytes_written() const { return bytes_written_; }
+  // 已编码的未压缩字节数
+  int64_t raw_bytes() const { return raw_bytes_; }
+  const std::string& segment_path() const { return segment_path_; }
+
+ private:
+  bool OpenSegment(int64_t time_us);
+  void PruneSegments();
+  uint32_t Intern(std::unordered_map<std::string, uint32_t>* table,
+                  uint8_t kind, std::string_view value);
+
+  BinaryLogOptions options_;
+  std::ofstream file_;
+  std::string segment_path_;
+  int64_t segment_bytes_ = 0;
+  int64_t previous_time_us_ = 0;
+  int64_t block_started_us_ = 0;
+  int segment_counter_ = 0;
+  std::unordered_map<std::string, uint32_t> tags_;
+  std::unordered_map<std::string, uint32_t> templates_;
+  std::vector<std::vector<uint64_t>> template_arguments_;  // 按模板 id
+  std::string block_;
+  std::string compressed_;
+  std::string template_;
+  std::vector<uint64_t> arguments_;
+  int64_t bytes_written_ = 0;
+  int64_t raw_bytes_ = 0;
+};
+
+struct BinaryLogEntry {
+  int64_t time_us = 0;
+  uint8_t level = 0;
+  std::string tag;
+  std::string message;
+};
+
+// 顺序解码一个段文件
+class BinaryLogReader {
+ public:
+  // path 为 UTF-8。文件不存在或段头无效时返回 false。
+  bool Open(const std::string& path);
+
+  // 读取下一条记录；到达末尾或遇到损坏/截断的块时返回 false，
+  // 后一种情况 truncated() 为 true
+  bool Next(BinaryLogEntry* entry);
+
+  bool truncated() const { return truncated_; }
+  int64_t base_time_us() const { return base_time_us_; }
+
+ private:
+  bool LoadBlock();
+  bool Fail();
+
+  std::ifstream file_;
+  int64_t base_time_us_ = 0;
+  int64_t previous_time_us_ = 0;
+  std::vector<std::string> tags_;
+  std::vector<std::string> templates_;
+  std::vector<std::vector<uint64_t>> template_arguments_;
+  std::string block_;
+  size_t offset_ = 0;
+  std::string compressed_;
+  bool truncated_ = false;
+};
+
+// 把消息拆成模板和数字参数（用于测试和解码器统计）；
+// 消息本身含有占位符字节时返回 false
+bool SplitLogTemplate(std::string_view message, std::string* templ,
+                      std::vector<uint64_t>* arguments);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_BINARY_LOG_H_
@@ -0,0 +1,72 @@
+#ifndef NATIVE_CORE_CHILD_PROCESS_H_
+#define NATIVE_CORE_CHILD_PROCESS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cfvpn {
+
+struct ChildProcessOptions {
+  std::string executable;              // UTF-8 路径
+  std::vector<std::string> arguments;  // 不含 argv[0]
+  std::string working_directory;       // 为空时继承当前目录
+};
+
+// ChildProcess::Wait 的结果
+enum class ChildEvent : uint8_t {
+  kTimeout,
+  kOutput,  // 读到一段输出（可能不是完整的行）
+  kExited,  // 子进程已退出并被回收，输出已读完
+  kWoken,   // 其他线程调用了 Wakeup()
+};
+
+// 一个带 stdout/stderr 管道的子进程。
+//
+// Windows 下用 CreateProcessW 启动并放入设置了 KILL_ON_JOB_CLOSE 的作业
+// 对象，句柄关闭（包括 runner 崩溃）时整个进程树都会被系统结束；输出管道
+// 是重叠 I/O 的命名管道，与进程句柄一起等待。POSIX 下用 posix_spawn 启动，
+// 通过 pidfd（内核不支持时退回 waitpid 轮询）与两个管道一起 poll。
+//
+// 除 Wakeup() 外，所有方法都必须在同一线程调用。析构时若子进程仍在运行，
+// 会强制结束并回收，不会留下僵尸进程。
+class ChildProcess {
+ public:
+  ChildProcess();
+  ~ChildProcess();
+
+  ChildProcess(const ChildProcess&) = delete;
+  ChildProcess& operator=(const ChildProcess&) = delete;
+
+  bool Spawn(const ChildProcessOptions& options, std::string* error);
+
+  // 等待输出、退出或唤醒，timeout_ms < 0 表示无限等待。
+  // kOutput 时 chunk 为本次读到的数据，from_stderr 标明来源。
+  ChildEvent Wait(int timeout_ms, std::string* chunk, bool* from_stderr);
+
+  // 请求退出：POSIX 发送 SIGTERM；Windows 没有可用于无控制台子进程的
+  // 优雅退出方式，直接结束作业对象
+  void Terminate();
+  // 强制结束（SIGKILL / TerminateJobObject），之后 Wait 很快返回 kExited
+  void Kill();
+
+  // 使正在进行或下一次的 Wait 返回 kWoken，可从任意线程调用
+  void Wakeup();
+
+  bool running() const { return running_; }
+  int64_t pid() const { return pid_; }
+  // 退出码；POSIX 下被信号结束时为 128 + 信号值
+  int exit_code() const { return exit_code_; }
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+  bool running_ = false;
+  int64_t pid_ = 0;
+  int exit_code_ = 0;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_CHILD_PROCESS_H_
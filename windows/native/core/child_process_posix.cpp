@@ -0,0 +1,308 @@
+#include "core/child_process.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+extern char** environ;
+
+namespace cfvpn {
+
+namespace {
+
+// 没有 pidfd 时检查子进程状态的间隔
+constexpr int kReapPollMs = 20;
+constexpr size_t kReadChunk = 64 * 1024;
+
+void CloseFd(int* fd) {
+  if (*fd >= 0) {
+    ::close(*fd);
+    *fd = -1;
+  }
+}
+
+bool MakePipe(int fds[2]) {
+  if (::pipe(fds) != 0) return false;
+  for (int i = 0; i < 2; ++i) {
+    ::fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+  }
+  ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+int OpenPidFd(pid_t pid) {
+#if defined(SYS_pidfd_open)
+  const long fd = ::syscall(SYS_pidfd_open, pid, 0);
+  if (fd >= 0) {
+    ::fcntl(static_cast<int>(fd), F_SETFD, FD_CLOEXEC);
+    return static_cast<int>(fd);
+  }
+#else
+  (void)pid;
+#endif
+  return -1;
+}
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+struct ChildProcess::Impl {
+  pid_t pid = -1;
+  int pid_fd = -1;
+  int out_fd = -1;
+  int err_fd = -1;
+  int wake_read = -1;
+  int wake_write = -1;
+  bool exited = false;  // 已回收，仅剩管道中的输出待读
+  int status = 0;
+
+  ~Impl() {
+    CloseFd(&pid_fd);
+    CloseFd(&out_fd);
+    CloseFd(&err_fd);
+    CloseFd(&wake_read);
+    CloseFd(&wake_write);
+  }
+
+  // 非阻塞地读一次，读到数据返回 true；EOF 时关闭 fd
+  bool ReadFrom(int* fd, std::string* chunk) {
+    if (*fd < 0) return false;
+    char buffer[kReadChunk];
+    for (;;) {
+      const ssize_t n = ::read(*fd, buffer, sizeof(buffer));
+      if (n > 0) {
+        chunk->assign(buffer, static_cast<size_t>(n));
+        return true;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) CloseFd(fd);
+      return false;
+    }
+  }
+
+  bool TryReap(bool block) {
+    if (exited) return true;
+    for (;;) {
+      const pid_t result = ::waitpid(pid, &status, block ? 0 : WNOHANG);
+      if (result == pid) {
+        exited = true;
+        CloseFd(&pid_fd);
+        return true;
+      }
+      if (result < 0 && errno == EINTR) continue;
+      if (result < 0 && errno == ECHILD) {
+        // 不应发生（除非别处回收了它），按退出处理以免永久等待
+        exited = true;
+        status = 0;
+        CloseFd(&pid_fd);
+        return true;
+      }
+      return false;
+    }
+  }
+};
+
+ChildProcess::ChildProcess() : impl_(new Impl) {
+  int wake[2];
+  if (MakePipe(wake)) {
+    ::fcntl(wake[1], F_SETFL, ::fcntl(wake[1], F_GETFL) | O_NONBLOCK);
+    impl_->wake_read = wake[0];
+    impl_->wake_write = wake[1];
+  }
+}
+
+ChildProcess::~ChildProcess() {
+  if (running_) {
+    Kill();
+    impl_->TryReap(true);
+  }
+}
+
+bool ChildProcess::Spawn(const ChildProcessOptions& options,
+                         std::string* error) {
+  if (running_) {
+    if (error != nullptr) *error = "子进程已在运行";
+    return false;
+  }
+  int out[2] = {-1, -1};
+  int err[2] = {-1, -1};
+  if (!MakePipe(out) || !MakePipe(err)) {
+    if (error != nullptr) *error = std::string("创建管道失败: ") + std::strerror(errno);
+    CloseFd(&out[0]);
+    CloseFd(&out[1]);
+    return false;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, out[1], 1);
+  posix_spawn_file_actions_adddup2(&actions, err[1], 2);
+  bool chdir_supported = true;
+  if (!options.working_directory.empty()) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+    posix_spawn_file_actions_addchdir_np(&actions,
+                                         options.working_directory.c_str());
+#else
+    chdir_supported = false;
+#endif
+  }
+
+  // 子进程自成进程组，结束时连同它派生的进程一起发信号；
+  // 恢复默认的信号处理和空信号掩码，不继承 runner 的设置
+  posix_spawnattr_t attributes;
+  posix_spawnattr_init(&attributes);
+  sigset_t signals;
+  sigemptyset(&signals);
+  posix_spawnattr_setsigmask(&attributes, &signals);
+  sigaddset(&signals, SIGPIPE);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+  posix_spawnattr_setsigdefault(&attributes, &signals);
+  posix_spawnattr_setpgroup(&attributes, 0);
+  posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP |
+                                            POSIX_SPAWN_SETSIGMASK |
+                                            POSIX_SPAWN_SETSIGDEF);
+
+  std::vector<char*> argv;
+  argv.push_back(const_cast<char*>(options.executable.c_str()));
+  for (const std::string& argument : options.arguments) {
+    argv.push_back(const_cast<char*>(argument.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  pid_t pid = -1;
+  int result = chdir_supported
+                   ? ::posix_spawn(&pid, options.executable.c_str(), &actions,
+                                   &attributes, argv.data(), environ)
+                   : ENOTSUP;
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attributes);
+  CloseFd(&out[1]);
+  CloseFd(&err[1]);
+  if (result != 0) {
+    CloseFd(&out[0]);
+    CloseFd(&err[0]);
+    if (error != nullptr) {
+      *error = "启动 " + options.executable + " 失败: " + std::strerror(result);
+    }
+    return false;
+  }
+
+  impl_->pid = pid;
+  impl_->pid_fd = OpenPidFd(pid);
+  impl_->out_fd = out[0];
+  impl_->err_fd = err[0];
+  impl_->exited = false;
+  impl_->status = 0;
+  running_ = true;
+  pid_ = pid;
+  exit_code_ = 0;
+  return true;
+}
+
+ChildEvent ChildProcess::Wait(int timeout_ms, std::string* chunk,
+                              bool* from_stderr) {
+  if (!running_) return ChildEvent::kExited;
+  Impl& impl = *impl_;
+  const int64_t deadline = timeout_ms < 0 ? -1 : NowMs() + timeout_ms;
+  for (;;) {
+    if (impl.exited) {
+      // 已回收：读完管道中剩余的输出。孙进程可能仍持有管道，
+      // 所以读到 EAGAIN 就认为输出已结束，不再等待 EOF。
+      if (impl.ReadFrom(&impl.out_fd, chunk)) {
+        *from_stderr = false;
+        return ChildEvent::kOutput;
+      }
+      if (impl.ReadFrom(&impl.err_fd, chunk)) {
+        *from_stderr = true;
+        return ChildEvent::kOutput;
+      }
+      CloseFd(&impl.out_fd);
+      CloseFd(&impl.err_fd);
+      const int status = impl.status;
+      exit_code_ = WIFEXITED(status)     ? WEXITSTATUS(status)
+                   : WIFSIGNALED(status) ? 128 + WTERMSIG(status)
+                                         : status;
+      running_ = false;
+      return ChildEvent::kExited;
+    }
+
+    pollfd fds[4];
+    int count = 0;
+    fds[count++] = {impl.wake_read, POLLIN, 0};
+    const int out_index = impl.out_fd >= 0 ? count : -1;
+    if (out_index >= 0) fds[count++] = {impl.out_fd, POLLIN, 0};
+    const int err_index = impl.err_fd >= 0 ? count : -1;
+    if (err_index >= 0) fds[count++] = {impl.err_fd, POLLIN, 0};
+    const int pid_index = impl.pid_fd >= 0 ? count : -1;
+    if (pid_index >= 0) fds[count++] = {impl.pid_fd, POLLIN, 0};
+
+    int wait_ms = -1;
+    if (deadline >= 0) {
+      wait_ms = static_cast<int>(std::max<int64_t>(deadline - NowMs(), 0));
+    }
+    if (impl.pid_fd < 0 && (wait_ms < 0 || wait_ms > kReapPollMs)) {
+      wait_ms = kReapPollMs;
+    }
+    const int ready = ::poll(fds, static_cast<nfds_t>(count), wait_ms);
+    if (ready < 0 && errno != EINTR) return ChildEvent::kTimeout;
+
+    if (ready > 0 && (fds[0].revents & POLLIN) != 0) {
+      char drain[64];
+      while (::read(impl.wake_read, drain, sizeof(drain)) > 0) {
+      }
+      return ChildEvent::kWoken;
+    }
+    if (out_index >= 0 && fds[out_index].revents != 0 &&
+        impl.ReadFrom(&impl.out_fd, chunk)) {
+      *from_stderr = false;
+      return ChildEvent::kOutput;
+    }
+    if (err_index >= 0 && fds[err_index].revents != 0 &&
+        impl.ReadFrom(&impl.err_fd, chunk)) {
+      *from_stderr = true;
+      return ChildEvent::kOutput;
+    }
+    if (pid_index < 0 || fds[pid_index].revents != 0) {
+      impl.TryReap(false);
+    }
+    if (!impl.exited && deadline >= 0 && NowMs() >= deadline) {
+      return ChildEvent::kTimeout;
+    }
+  }
+}
+
+void ChildProcess::Terminate() {
+  if (!running_ || impl_->exited) return;
+  if (::kill(-impl_->pid, SIGTERM) != 0) ::kill(impl_->pid, SIGTERM);
+}
+
+void ChildProcess::Kill() {
+  if (!running_ || impl_->exited) return;
+  if (::kill(-impl_->pid, SIGKILL) != 0) ::kill(impl_->pid, SIGKILL);
+}
+
+void ChildProcess::Wakeup() {
+  if (impl_->wake_write >= 0) {
+    const char byte = 1;
+    (void)!::write(impl_->wake_write, &byte, 1);
+  }
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,373 @@
+#include "core/child_process.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cwchar>
+#include <string>
+
+namespace cfvpn {
+
+namespace {
+
+constexpr DWORD kPipeBuffer = 64 * 1024;
+
+std::wstring Utf8ToWide(const std::string& text) {
+  int length = ::MultiByteToWideChar(CP_UTF8, 0, text.data(),
+                                     static_cast<int>(text.size()), nullptr, 0);
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  if (length > 0) {
+    ::MultiByteToWideChar(CP_UTF8, 0, text.data(),
+                          static_cast<int>(text.size()), &wide[0], length);
+  }
+  return wide;
+}
+
+// 按 CommandLineToArgvW 的解析规则给参数加引号
+void AppendQuoted(const std::wstring& argument, std::wstring* out) {
+  if (!argument.empty() &&
+      argument.find_first_of(L" \t\n\v\"") == std::wstring::npos) {
+    *out += argument;
+    return;
+  }
+  out->push_back(L'"');
+  size_t backslashes = 0;
+  for (wchar_t c : argument) {
+    if (c == L'\\') {
+      ++backslashes;
+      continue;
+    }
+    if (c == L'"') {
+      out->append(backslashes * 2 + 1, L'\\');
+    } else {
+      out->append(backslashes, L'\\');
+    }
+    backslashes = 0;
+    out->push_back(c);
+  }
+  out->append(backslashes * 2, L'\\');
+  out->push_back(L'"');
+}
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// 重叠 I/O 命名管道的读端。匿名管道不支持重叠 I/O，
+// 无法与进程句柄一起 WaitForMultipleObjects。
+struct PipeReader {
+  HANDLE pipe = INVALID_HANDLE_VALUE;
+  OVERLAPPED overlapped = {};
+  bool pending = false;
+  char buffer[kPipeBuffer];
+
+  ~PipeReader() { Close(); }
+
+  bool open() const { return pipe != INVALID_HANDLE_VALUE; }
+
+  // 创建管道，写端可被子进程继承
+  bool Create(HANDLE* write_end) {
+    static std::atomic<unsigned> counter{0};
+    wchar_t name[96];
+    std::swprintf(name, 96, L"\\\\.\\pipe\\cfvpn-child-%lu-%u",
+                  ::GetCurrentProcessId(), counter.fetch_add(1));
+    pipe = ::CreateNamedPipeW(
+        name, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED |
+                  FILE_FLAG_FIRST_PIPE_INSTANCE,
+        PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1,
+        kPipeBuffer, kPipeBuffer, 0, nullptr);
+    if (pipe == INVALID_HANDLE_VALUE) return false;
+    SECURITY_ATTRIBUTES attributes = {sizeof(attributes), nullptr, TRUE};
+    *write_end = ::CreateFileW(name, GENERIC_WRITE, 0, &attributes,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    overlapped.hEvent = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (*write_end == INVALID_HANDLE_VALUE || overlapped.hEvent == nullptr) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  // 发起一次重叠读。同步完成时事件同样会被置位，统一在 Finish 中取结果。
+  void StartRead() {
+    if (!open() || pending) return;
+    if (::ReadFile(pipe, buffer, sizeof(buffer), nullptr, &overlapped) ||
+        ::GetLastError() == ERROR_IO_PENDING) {
+      pending = true;
+    } else {
+      Close();  // ERROR_BROKEN_PIPE：写端已全部关闭
+    }
+  }
+
+  // 读操作已完成时取出数据并发起下一次读，读到数据返回 true
+  bool Finish(std::string* chunk) {
+    DWORD bytes = 0;
+    pending = false;
+    if (!::GetOverlappedResult(pipe, &overlapped, &bytes, FALSE)) {
+      Close();
+      return false;
+    }
+    chunk->assign(buffer, bytes);
+    StartRead();
+    return bytes > 0;
+  }
+
+  bool Completed() const {
+    return pending && HasOverlappedIoCompleted(&overlapped);
+  }
+
+  void Close() {
+    if (pipe != INVALID_HANDLE_VALUE) {
+      if (pending) {
+        DWORD bytes = 0;
+        ::CancelIoEx(pipe, &overlapped);
+        ::GetOverlappedResult(pipe, &overlapped, &bytes, TRUE);
+        pending = false;
+      }
+      ::CloseHandle(pipe);
+      pipe = INVALID_HANDLE_VALUE;
+    }
+    if (overlapped.hEvent != nullptr) {
+      ::CloseHandle(overlapped.hEvent);
+      overlapped.hEvent = nullptr;
+    }
+  }
+};
+
+}  // namespace
+
+struct ChildProcess::Impl {
+  HANDLE job = nullptr;
+  HANDLE process = nullptr;
+  HANDLE wake = nullptr;
+  PipeReader out;
+  PipeReader err;
+  bool exited = false;
+
+  Impl() { wake = ::CreateEventW(nullptr, FALSE, FALSE, nullptr); }
+
+  ~Impl() {
+    CloseChild();
+    if (wake != nullptr) ::CloseHandle(wake);
+  }
+
+  void CloseChild() {
+    out.Close();
+    err.Close();
+    if (process != nullptr) {
+      ::CloseHandle(process);
+      process = nullptr;
+    }
+    // KILL_ON_JOB_CLOSE：关闭最后一个句柄时结束作业中剩余的所有进程
+    if (job != nullptr) {
+      ::CloseHandle(job);
+      job = nullptr;
+    }
+  }
+};
+
+ChildProcess::ChildProcess() : impl_(new Impl) {}
+
+ChildProcess::~ChildProcess() {
+  if (running_) {
+    Kill();
+    if (impl_->process != nullptr) {
+      ::WaitForSingleObject(impl_->process, 5000);
+    }
+  }
+}
+
+bool ChildProcess::Spawn(const ChildProcessOptions& options,
+                         std::string* error) {
+  if (running_) {
+    if (error != nullptr) *error = "子进程已在运行";
+    return false;
+  }
+  Impl& impl = *impl_;
+  impl.CloseChild();
+  impl.exited = false;
+
+  auto fail = [&](const char* what) {
+    if (error != nullptr) {
+      *error = std::string(what) + " 失败，错误码 " +
+               std::to_string(::GetLastError());
+    }
+    impl.CloseChild();
+    return false;
+  };
+
+  HANDLE out_write = INVALID_HANDLE_VALUE;
+  HANDLE err_write = INVALID_HANDLE_VALUE;
+  if (!impl.out.Create(&out_write)) return fail("创建输出管道");
+  if (!impl.err.Create(&err_write)) {
+    ::CloseHandle(out_write);
+    return fail("创建输出管道");
+  }
+  SECURITY_ATTRIBUTES inherit = {sizeof(inherit), nullptr, TRUE};
+  HANDLE null_input =
+      ::CreateFileW(L"NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                    &inherit, OPEN_EXISTING, 0, nullptr);
+
+  // 只让子进程继承这三个句柄，避免把 runner 中其他可继承句柄带过去
+  HANDLE inherited[3] = {out_write, err_write, null_input};
+  const DWORD inherited_count = null_input == INVALID_HANDLE_VALUE ? 2 : 3;
+  SIZE_T list_size = 0;
+  ::InitializeProcThreadAttributeList(nullptr, 1, 0, &list_size);
+  std::string list_storage(list_size, '\0');
+  auto* attribute_list =
+      reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(&list_storage[0]);
+  const bool has_list =
+      ::InitializeProcThreadAttributeList(attribute_list, 1, 0, &list_size) &&
+      ::UpdateProcThreadAttribute(attribute_list, 0,
+                                  PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited,
+                                  inherited_count * sizeof(HANDLE), nullptr,
+                                  nullptr);
+
+  STARTUPINFOEXW startup = {};
+  startup.StartupInfo.cb = sizeof(startup);
+  startup.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+  startup.StartupInfo.hStdInput =
+      null_input == INVALID_HANDLE_VALUE ? nullptr : null_input;
+  startup.StartupInfo.hStdOutput = out_write;
+  startup.StartupInfo.hStdError = err_write;
+  if (has_list) startup.lpAttributeList = attribute_list;
+
+  const std::wstring application = Utf8ToWide(options.executable);
+  std::wstring command_line;
+  AppendQuoted(application, &command_line);
+  for (const std::string& argument : options.arguments) {
+    command_line.push_back(L' ');
+    AppendQuoted(Utf8ToWide(argument), &command_line);
+  }
+  const std::wstring directory = Utf8ToWide(options.working_directory);
+
+  PROCESS_INFORMATION info = {};
+  const BOOL created = ::CreateProcessW(
+      application.c_str(), &command_line[0], nullptr, nullptr, TRUE,
+      CREATE_SUSPENDED | CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT |
+          (has_list ? EXTENDED_STARTUPINFO_PRESENT : 0),
+      nullptr, directory.empty() ? nullptr : directory.c_str(),
+      &startup.StartupInfo, &info);
+  const DWORD create_error = ::GetLastError();
+  if (has_list) ::DeleteProcThreadAttributeList(attribute_list);
+  ::CloseHandle(out_write);
+  ::CloseHandle(err_write);
+  if (null_input != INVALID_HANDLE_VALUE) ::CloseHandle(null_input);
+  if (!created) {
+    ::SetLastError(create_error);
+    return fail(("启动 " + options.executable).c_str());
+  }
+
+  // 在恢复主线程之前放入作业对象，子进程派生的进程也都会属于该作业
+  impl.job = ::CreateJobObjectW(nullptr, nullptr);
+  if (impl.job != nullptr) {
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+    limits.BasicLimitInformation.LimitFlags =
+        JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE |
+        JOB_OBJECT_LIMIT_DIE_ON_UNHANDLED_EXCEPTION;
+    if (!::SetInformationJobObject(impl.job,
+                                   JobObjectExtendedLimitInformation, &limits,
+                                   sizeof(limits)) ||
+        !::AssignProcessToJobObject(impl.job, info.hProcess)) {
+      ::CloseHandle(impl.job);
+      impl.job = nullptr;
+    }
+  }
+  impl.process = info.hProcess;
+  ::ResumeThread(info.hThread);
+  ::CloseHandle(info.hThread);
+
+  impl.out.StartRead();
+  impl.err.StartRead();
+  running_ = true;
+  pid_ = static_cast<int64_t>(info.dwProcessId);
+  exit_code_ = 0;
+  return true;
+}
+
+ChildEvent ChildProcess::Wait(int timeout_ms, std::string* chunk,
+                              bool* from_stderr) {
+  if (!running_) return ChildEvent::kExited;
+  Impl& impl = *impl_;
+  const int64_t deadline = timeout_ms < 0 ? -1 : NowMs() + timeout_ms;
+  for (;;) {
+    if (impl.exited) {
+      // 已退出：只取已经完成的读，孙进程可能仍持有管道写端
+      for (PipeReader* reader : {&impl.out, &impl.err}) {
+        while (reader->Completed()) {
+          if (reader->Finish(chunk)) {
+            *from_stderr = reader == &impl.err;
+            return ChildEvent::kOutput;
+          }
+        }
+      }
+      DWORD code = 0;
+      ::GetExitCodeProcess(impl.process, &code);
+      exit_code_ = static_cast<int>(code);
+      impl.CloseChild();
+      running_ = false;
+      return ChildEvent::kExited;
+    }
+
+    // 管道排在进程句柄之前，同时就绪时先读完输出再报告退出
+    HANDLE handles[4];
+    PipeReader* readers[4] = {};
+    DWORD count = 0;
+    handles[count++] = impl.wake;
+    for (PipeReader* reader : {&impl.out, &impl.err}) {
+      if (reader->pending) {
+        readers[count] = reader;
+        handles[count++] = reader->overlapped.hEvent;
+      }
+    }
+    const DWORD process_index = count;
+    handles[count++] = impl.process;
+
+    DWORD wait_ms = INFINITE;
+    if (deadline >= 0) {
+      wait_ms = static_cast<DWORD>(std::max<int64_t>(deadline - NowMs(), 0));
+    }
+    const DWORD result =
+        ::WaitForMultipleObjects(count, handles, FALSE, wait_ms);
+    if (result == WAIT_TIMEOUT || result == WAIT_FAILED) {
+      return ChildEvent::kTimeout;
+    }
+    const DWORD index = result - WAIT_OBJECT_0;
+    if (index == 0) return ChildEvent::kWoken;
+    if (index == process_index) {
+      impl.exited = true;
+      continue;
+    }
+    if (index < count && readers[index] != nullptr &&
+        readers[index]->Finish(chunk)) {
+      *from_stderr = readers[index] == &impl.err;
+      return ChildEvent::kOutput;
+    }
+  }
+}
+
+void ChildProcess::Terminate() {
+  Kill();
+}
+
+void ChildProcess::Kill() {
+  if (!running_ || impl_->exited) return;
+  if (impl_->job != nullptr) {
+    ::TerminateJobObject(impl_->job, 1);
+  } else if (impl_->process != nullptr) {
+    ::TerminateProcess(impl_->process, 1);
+  }
+}
+
+void ChildProcess::Wakeup() {
+  if (impl_->wake != nullptr) ::SetEvent(impl_->wake);
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,279 @@
+#include "core/cidr_sampler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "core/random.h"
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+namespace {
+
+bool IsSeparator(char c) {
+  return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r' ||
+         c == '\n';
+}
+
+// 在 /24 子段 block 与段 range 的交集中随机取一个主机地址，
+// 优先避开 .0 和 .255（仅当交集里只有这两个地址时才使用它们）
+uint32_t PickHost(uint32_t block, const Ipv4Range& range, Random* rng) {
+  const uint32_t base = block << 8;
+  uint32_t low = std::max(base + 1, range.first);
+  uint32_t high = std::min(base + 254, range.last);
+  if (low > high) {
+    low = std::max(base, range.first);
+    high = std::min(base + 255, range.last);
+  }
+  return low + static_cast<uint32_t>(rng->Uniform(uint64_t{high} - low + 1));
+}
+
+bool IsEdgeHost(uint32_t ip) {
+  const uint32_t octet = ip & 0xFF;
+  return octet == 0 || octet == 255;
+}
+
+}  // namespace
+
+bool ParseCidr(const char* text, size_t length, Ipv4Range* out) {
+  // 最长形如 "255.255.255.255/32"
+  char buffer[24];
+  while (length > 0 && IsSeparator(*text)) {
+    ++text;
+    --length;
+  }
+  while (length > 0 && IsSeparator(text[length - 1])) {
+    --length;
+  }
+  if (length == 0 || length >= sizeof(buffer)) {
+    return false;
+  }
+  std::memcpy(buffer, text, length);
+  buffer[length] = '\0';
+
+  int prefix = 32;
+  char* slash = std::strchr(buffer, '/');
+  if (slash != nullptr) {
+    *slash = '\0';
+    const char* digits = slash + 1;
+    if (*digits == '\0' || std::strlen(digits) > 2) {
+      return false;
+    }
+    prefix = 0;
+    for (const char* p = digits; *p != '\0'; ++p) {
+      if (*p < '0' || *p > '9') {
+        return false;
+      }
+      prefix = prefix * 10 + (*p - '0');
+    }
+    if (prefix > 32) {
+      return false;
+    }
+  }
+
+  uint32_t ip;
+  if (!ParseIpv4(buffer, &ip)) {
+    return false;
+  }
+  const uint32_t mask = prefix == 0 ? 0 : 0xFFFFFFFFu << (32 - prefix);
+  out->first = ip & mask;
+  out->last = out->first | ~mask;
+  return true;
+}
+
+size_t ParseCidrList(const char* text, std::vector<Ipv4Range>* out) {
+  size_t invalid = 0;
+  const char* p = text;
+  while (*p != '\0') {
+    while (*p != '\0' && IsSeparator(*p)) {
+      ++p;
+    }
+    const char* start = p;
+    while (*p != '\0' && !IsSeparator(*p)) {
+      ++p;
+    }
+    if (p == start) {
+      continue;
+    }
+    Ipv4Range range;
+    if (ParseCidr(start, static_cast<size_t>(p - start), &range)) {
+      out->push_back(range);
+    } else {
+      ++invalid;
+    }
+  }
+  return invalid;
+}
+
+Ipv4RangeIndex::Ipv4RangeIndex(std::vector<Ipv4Range> ranges)
+    : ranges_(std::move(ranges)) {
+  intervals_ = ranges_;
+  std::sort(intervals_.begin(), intervals_.end(),
+            [](const Ipv4Range& a, const Ipv4Range& b) {
+              return a.first < b.first;
+            });
+  size_t merged = 0;
+  for (size_t i = 0; i < intervals_.size(); ++i) {
+    if (merged > 0 &&
+        uint64_t{intervals_[i].first} <= uint64_t{intervals_[merged - 1].last} + 1) {
+      intervals_[merged - 1].last =
+          std::max(intervals_[merged - 1].last, intervals_[i].last);
+    } else {
+      intervals_[merged++] = intervals_[i];
+    }
+  }
+  intervals_.resize(merged);
+
+  starts_.reserve(intervals_.size());
+  for (const Ipv4Range& interval : intervals_) {
+    starts_.push_back(address_count_);
+    address_count_ += uint64_t{interval.last} - interval.first + 1;
+  }
+}
+
+uint32_t Ipv4RangeIndex::AddressAt(uint64_t offset) const {
+  // 找到最后一个起始序号 <= offset 的区间
+  auto it = std::upper_bound(starts_.begin(), starts_.end(), offset);
+  const size_t i = static_cast<size_t>(it - starts_.begin()) - 1;
+  return intervals_[i].first + static_cast<uint32_t>(offset - starts_[i]);
+}
+
+bool Ipv4RangeIndex::OffsetOf(uint32_t ip, uint64_t* offset) const {
+  auto it = std::upper_bound(
+      intervals_.begin(), intervals_.end(), ip,
+      [](uint32_t value, const Ipv4Range& range) { return value < range.first; });
+  if (it == intervals_.begin()) {
+    return false;
+  }
+  --it;
+  if (ip > it->last) {
+    return false;
+  }
+  const size_t i = static_cast<size_t>(it - intervals_.begin());
+  *offset = starts_[i] + (ip - it->first);
+  return true;
+}
+
+CidrSampler::CidrSampler(const Ipv4RangeIndex& index) : index_(index) {
+  if (index_.address_count() <= kMaxBitmapBits) {
+    bitmap_.resize(static_cast<size_t>((index_.address_count() + 63) / 64));
+  }
+}
+
+void CidrSampler::ResetMarks() {
+  std::fill(bitmap_.begin(), bitmap_.end(), 0);
+  overflow_.clear();
+}
+
+bool CidrSampler::Mark(uint32_t ip) {
+  if (bitmap_.empty()) {
+    return overflow_.insert(ip).second;
+  }
+  uint64_t offset;
+  if (!index_.OffsetOf(ip, &offset)) {
+    return false;
+  }
+  uint64_t& word = bitmap_[static_cast<size_t>(offset >> 6)];
+  const uint64_t bit = 1ull << (offset & 63);
+  if (word & bit) {
+    return false;
+  }
+  word |= bit;
+  return true;
+}
+
+size_t CidrSampler::Sample(size_t count, uint64_t seed, uint32_t* out) {
+  const std::vector<Ipv4Range>& ranges = index_.ranges();
+  const uint64_t total = index_.address_count();
+  if (ranges.empty() || count == 0 || total == 0) {
+    return 0;
+  }
+  count = static_cast<size_t>(std::min<uint64_t>(count, total));
+  ResetMarks();
+  Random rng(seed);
+  size_t produced = 0;
+
+  // 第一轮：按段平均分配，每段最多取其 /24 子段数个。先满足容量小的段，
+  // 分不完的预算自然落到大段上（等价于 Dart 端从大段补充）。
+  const size_t range_count = ranges.size();
+  std::vector<uint64_t> capacity(range_count);
+  std::vector<size_t> order(range_count);
+  for (size_t i = 0; i < range_count; ++i) {
+    capacity[i] = (ranges[i].last >> 8) - (ranges[i].first >> 8) + 1;
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&capacity](size_t a, size_t b) {
+    return capacity[a] < capacity[b];
+  });
+  std::vector<uint64_t> quota(range_count);
+  uint64_t remaining = count;
+  size_t left = range_count;
+  for (size_t i : order) {
+    const uint64_t share = (remaining + left - 1) / left;
+    quota[i] = std::min(capacity[i], share);
+    remaining -= quota[i];
+    --left;
+  }
+
+  for (size_t i = 0; i < range_count; ++i) {
+    const uint64_t cap = capacity[i];
+    const uint64_t take = quota[i];
+    if (take == 0) {
+      continue;
+    }
+    // Floyd 算法：在 cap 个子段中不重复地随机挑选 take 个
+    block_bitmap_.assign(static_cast<size_t>((cap + 63) / 64), 0);
+    const uint32_t first_block = ranges[i].first >> 8;
+    for (uint64_t j = cap - take; j < cap; ++j) {
+      uint64_t pick = rng.Uniform(j + 1);
+      if (block_bitmap_[static_cast<size_t>(pick >> 6)] & (1ull << (pick & 63))) {
+        pick = j;
+      }
+      block_bitmap_[static_cast<size_t>(pick >> 6)] |= 1ull << (pick & 63);
+      const uint32_t host =
+          PickHost(first_block + static_cast<uint32_t>(pick), ranges[i], &rng);
+      // 段之间有重叠时可能重复，交给第二轮补足
+      if (Mark(host)) {
+        out[produced++] = host;
+      }
+    }
+  }
+
+  // 第二轮：在整个合并空间中随机补足
+  if (produced < count) {
+    const uint64_t max_attempts = uint64_t{count - produced} * 16 + 4096;
+    for (uint64_t attempt = 0; attempt < max_attempts && produced < count;
+         ++attempt) {
+      const uint32_t ip = index_.AddressAt(rng.Uniform(total));
+      if (!IsEdgeHost(ip) && Mark(ip)) {
+        out[produced++] = ip;
+      }
+    }
+  }
+
+  // 接近耗尽时随机采样效率很低，改为从随机位置顺序扫描剩余地址
+  if (produced < count) {
+    const std::vector<Ipv4Range>& intervals = index_.intervals();
+    const size_t start = static_cast<size_t>(rng.Uniform(intervals.size()));
+    for (size_t k = 0; k < intervals.size() && produced < count; ++k) {
+      const Ipv4Range& interval = intervals[(start + k) % intervals.size()];
+      for (uint64_t ip = interval.first; ip <= interval.last && produced < count;
+           ++ip) {
+        const uint32_t address = static_cast<uint32_t>(ip);
+        if (!IsEdgeHost(address) && Mark(address)) {
+          out[produced++] = address;
+        }
+      }
+    }
+  }
+
+  // 打乱顺序，避免同一段的地址扎堆
+  for (size_t i = produced; i > 1; --i) {
+    const size_t j = static_cast<size_t>(rng.Uniform(i));
+    std::swap(out[i - 1], out[j]);
+  }
+  return produced;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,91 @@
+#ifndef NATIVE_CORE_CIDR_SAMPLER_H_
+#define NATIVE_CORE_CIDR_SAMPLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace cfvpn {
+
+// 闭区间 [first, last] 的 IPv4 段（主机字节序）
+struct Ipv4Range {
+  uint32_t first;
+  uint32_t last;
+};
+
+// 解析 "a.b.c.d/n" 或单个地址。主机位不为零时按网络地址对齐，
+// 与 _sampleFromCidr 的处理一致。
+bool ParseCidr(const char* text, size_t length, Ipv4Range* out);
+
+// 解析以逗号、空白或换行分隔的 CIDR 列表，追加到 out，返回无效项的数量
+size_t ParseCidrList(const char* text, std::vector<Ipv4Range>* out);
+
+// 只读的 IPv4 段索引。
+//
+// 保留原始顺序的段用于按段分配采样配额；另外保存排序合并后的区间和
+// 前缀和，可以在 O(log n) 内把“第 k 个地址”映射为 IP，或反向查询。
+// 构造后不再修改，可被多个采样器共享。
+class Ipv4RangeIndex {
+ public:
+  explicit Ipv4RangeIndex(std::vector<Ipv4Range> ranges);
+
+  // 原始顺序的段
+  const std::vector<Ipv4Range>& ranges() const { return ranges_; }
+
+  // 排序并合并重叠/相邻部分后的区间
+  const std::vector<Ipv4Range>& intervals() const { return intervals_; }
+
+  // 合并后的地址总数
+  uint64_t address_count() const { return address_count_; }
+
+  // 第 offset 个地址（0 <= offset < address_count）
+  uint32_t AddressAt(uint64_t offset) const;
+
+  // 地址在合并空间中的序号；不在任何区间内时返回 false
+  bool OffsetOf(uint32_t ip, uint64_t* offset) const;
+
+  bool Contains(uint32_t ip) const {
+    uint64_t ignored;
+    return OffsetOf(ip, &ignored);
+  }
+
+ private:
+  std::vector<Ipv4Range> ranges_;
+  std::vector<Ipv4Range> intervals_;
+  std::vector<uint64_t> starts_;  // 每个区间首地址在合并空间中的序号
+  uint64_t address_count_ = 0;
+};
+
+// 基于索引的 IPv4 采样器。
+//
+// 策略与 Dart 端 _sampleIpsFromRanges 相同：先把预算平均分给各段，
+// 每段随机挑选不重复的 /24 子段并在其中随机取一个主机地址（避开 .0/.255）；
+// 不够时再从整个地址空间随机补足，最后打乱顺序。去重使用合并空间上的
+// 位图，结果直接写入调用方提供的 uint32 数组，不创建任何字符串。
+class CidrSampler {
+ public:
+  explicit CidrSampler(const Ipv4RangeIndex& index);
+
+  CidrSampler(const CidrSampler&) = delete;
+  CidrSampler& operator=(const CidrSampler&) = delete;
+
+  // 采样最多 count 个不重复地址写入 out，返回实际数量。相同种子结果相同。
+  size_t Sample(size_t count, uint64_t seed, uint32_t* out);
+
+ private:
+  // 合并空间过大时（例如 0.0.0.0/0）改用哈希集合去重，避免巨大的位图
+  static constexpr uint64_t kMaxBitmapBits = 1ull << 27;
+
+  bool Mark(uint32_t ip);
+  void ResetMarks();
+
+  const Ipv4RangeIndex& index_;
+  std::vector<uint64_t> bitmap_;
+  std::unordered_set<uint32_t> overflow_;
+  std::vector<uint64_t> block_bitmap_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_CIDR_SAMPLER_H_
@@ -0,0 +1,267 @@
+#include "core/dns_message.h"
+
+#include <algorithm>
+#include <map>
+
+namespace cfvpn {
+
+namespace {
+
+constexpr size_t kHeaderBytes = 12;
+constexpr size_t kMaxNameLength = 253;
+constexpr int kMaxPointerHops = 32;
+constexpr int kMaxCnameHops = 8;
+
+uint16_t ReadU16(const uint8_t* p) {
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) |
+         (uint32_t{p[2]} << 8) | p[3];
+}
+
+void WriteU16(uint16_t value, std::vector<uint8_t>* out) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void WriteU32(uint32_t value, std::vector<uint8_t>* out) {
+  WriteU16(static_cast<uint16_t>(value >> 16), out);
+  WriteU16(static_cast<uint16_t>(value), out);
+}
+
+char LowerAscii(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// 从 *pos 读一个（可能压缩的）名称，*pos 移到名称之后
+bool ReadName(const uint8_t* data, size_t length, size_t* pos,
+              std::string* out) {
+  out->clear();
+  size_t cursor = *pos;
+  size_t end = 0;  // 第一次跳转前的位置，即名称在原处的结尾
+  int hops = 0;
+  for (;;) {
+    if (cursor >= length) return false;
+    const uint8_t label = data[cursor];
+    if ((label & 0xC0) == 0xC0) {
+      if (cursor + 1 >= length || ++hops > kMaxPointerHops) return false;
+      if (end == 0) end = cursor + 2;
+      cursor = ((label & 0x3F) << 8) | data[cursor + 1];
+      continue;
+    }
+    if ((label & 0xC0) != 0) return false;  // 保留的标签类型
+    ++cursor;
+    if (label == 0) break;
+    if (cursor + label > length) return false;
+    if (!out->empty()) out->push_back('.');
+    for (size_t i = 0; i < label; ++i) {
+      out->push_back(LowerAscii(static_cast<char>(data[cursor + i])));
+    }
+    if (out->size() > kMaxNameLength) return false;
+    cursor += label;
+  }
+  *pos = end != 0 ? end : cursor;
+  return true;
+}
+
+void WriteName(const std::string& name, std::vector<uint8_t>* out) {
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t dot = name.find('.', start);
+    if (dot == std::string::npos) dot = name.size();
+    out->push_back(static_cast<uint8_t>(dot - start));
+    out->insert(out->end(), name.begin() + static_cast<ptrdiff_t>(start),
+                name.begin() + static_cast<ptrdiff_t>(dot));
+    start = dot + 1;
+  }
+  out->push_back(0);
+}
+
+struct Record {
+  std::string name;
+  uint16_t type = 0;
+  uint32_t ttl = 0;
+  size_t rdata = 0;  // RDATA 在报文中的偏移
+  uint16_t rdlength = 0;
+};
+
+bool ReadRecord(const uint8_t* data, size_t length, size_t* pos,
+                Record* out) {
+  if (!ReadName(data, length, pos, &out->name)) return false;
+  if (*pos + 10 > length) return false;
+  const uint8_t* p = data + *pos;
+  out->type = ReadU16(p);
+  out->ttl = ReadU32(p + 4);
+  // TTL 的最高位置位时按 0 处理（RFC 2181 §8）
+  if (out->ttl > 0x7FFFFFFFu) out->ttl = 0;
+  out->rdlength = ReadU16(p + 8);
+  out->rdata = *pos + 10;
+  *pos = out->rdata + out->rdlength;
+  return *pos <= length;
+}
+
+}  // namespace
+
+bool NormalizeDnsName(std::string_view name, std::string* out) {
+  if (!name.empty() && name.back() == '.') name.remove_suffix(1);
+  if (name.empty() || name.size() > kMaxNameLength) return false;
+  std::string normalized;
+  normalized.reserve(name.size());
+  size_t label = 0;
+  for (char c : name) {
+    if (c == '.') {
+      if (label == 0) return false;
+      label = 0;
+    } else {
+      const bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                         (c >= '0' && c <= '9') || c == '-' || c == '_';
+      if (!valid || ++label > 63) return false;
+    }
+    normalized.push_back(LowerAscii(c));
+  }
+  *out = std::move(normalized);
+  return true;
+}
+
+bool BuildDnsQuery(uint16_t id, const std::string& name, uint16_t type,
+                   std::vector<uint8_t>* out) {
+  if (name.empty() || name.size() > kMaxNameLength) return false;
+  out->clear();
+  WriteU16(id, out);
+  WriteU16(0x0100, out);  // RD
+  WriteU16(1, out);
+  WriteU16(0, out);
+  WriteU16(0, out);
+  WriteU16(0, out);
+  WriteName(name, out);
+  WriteU16(type, out);
+  WriteU16(kDnsClassIn, out);
+  return true;
+}
+
+bool ParseDnsMessage(const uint8_t* data, size_t length, DnsMessage* out) {
+  if (length < kHeaderBytes) return false;
+  DnsMessage message;
+  message.id = ReadU16(data);
+  message.flags = ReadU16(data + 2);
+  const uint16_t qdcount = ReadU16(data + 4);
+  const uint16_t ancount = ReadU16(data + 6);
+  const uint16_t nscount = ReadU16(data + 8);
+  size_t pos = kHeaderBytes;
+
+  for (uint16_t i = 0; i < qdcount; ++i) {
+    DnsQuestion question;
+    if (!ReadName(data, length, &pos, &question.name)) return false;
+    if (pos + 4 > length) return false;
+    question.type = ReadU16(data + pos);
+    question.klass = ReadU16(data + pos + 2);
+    pos += 4;
+    message.questions.push_back(std::move(question));
+  }
+
+  std::vector<Record> answers;
+  for (uint16_t i = 0; i < ancount; ++i) {
+    Record record;
+    if (!ReadRecord(data, length, &pos, &record)) return false;
+    answers.push_back(std::move(record));
+  }
+  for (uint16_t i = 0; i < nscount; ++i) {
+    Record record;
+    if (!ReadRecord(data, length, &pos, &record)) return false;
+    if (record.type != kDnsTypeSoa) continue;
+    size_t rdata = record.rdata;
+    std::string ignored;
+    if (!ReadName(data, length, &rdata, &ignored) ||
+        !ReadName(data, length, &rdata, &ignored) || rdata + 20 > length) {
+      return false;
+    }
+    const uint32_t minimum = ReadU32(data + rdata + 16);
+    message.negative_ttl = std::min(record.ttl, minimum);
+  }
+  // 附加部分不需要
+
+  if (!message.questions.empty()) {
+    // 沿 CNAME 链找到最终名称，再收集该名称下与问题类型相同的地址
+    const DnsQuestion& question = message.questions.front();
+    std::map<std::string, const Record*> cnames;
+    for (const Record& record : answers) {
+      if (record.type == kDnsTypeCname) cnames.emplace(record.name, &record);
+    }
+    std::string target = question.name;
+    uint32_t ttl = UINT32_MAX;
+    for (int hop = 0; hop < kMaxCnameHops; ++hop) {
+      auto it = cnames.find(target);
+      if (it == cnames.end()) break;
+      size_t rdata = it->second->rdata;
+      std::string next;
+      if (!ReadName(data, length, &rdata, &next)) return false;
+      ttl = std::min(ttl, it->second->ttl);
+      target = std::move(next);
+    }
+    for (const Record& record : answers) {
+      if (record.type != question.type || record.name != target) continue;
+      if (record.type == kDnsTypeA && record.rdlength == 4) {
+        message.addresses.push_back(
+            IpAddressFromBytes(data + record.rdata, false));
+      } else if (record.type == kDnsTypeAaaa && record.rdlength == 16) {
+        message.addresses.push_back(
+            IpAddressFromBytes(data + record.rdata, true));
+      } else {
+        continue;
+      }
+      ttl = std::min(ttl, record.ttl);
+    }
+    if (!message.addresses.empty()) message.ttl = ttl;
+  }
+
+  *out = std::move(message);
+  return true;
+}
+
+void BuildDnsResponse(const DnsMessage& query, uint8_t rcode,
+                      const std::vector<IpAddress>& answers, uint32_t ttl,
+                      std::vector<uint8_t>* out) {
+  out->clear();
+  WriteU16(query.id, out);
+  // 回显 opcode 和 RD，置 QR 和 RA
+  WriteU16(static_cast<uint16_t>(0x8000 | (query.flags & 0x7900) | 0x0080 |
+                                 (rcode & 0x0F)),
+           out);
+  const bool has_question = !query.questions.empty();
+  WriteU16(has_question ? 1 : 0, out);
+  WriteU16(0, out);  // ANCOUNT，最后回填
+  WriteU16(0, out);
+  WriteU16(0, out);
+  if (!has_question) return;
+
+  const DnsQuestion& question = query.questions.front();
+  WriteName(question.name, out);
+  WriteU16(question.type, out);
+  WriteU16(question.klass, out);
+
+  uint16_t count = 0;
+  for (const IpAddress& address : answers) {
+    const uint16_t type = address.v6 ? kDnsTypeAaaa : kDnsTypeA;
+    if (type != question.type) continue;
+    const size_t rdlength = address.v6 ? 16 : 4;
+    if (out->size() + 12 + rdlength > kDnsUdpMaxBytes) {
+      (*out)[2] |= 0x02;  // TC
+      break;
+    }
+    WriteU16(0xC00C, out);  // 指向问题中的名称
+    WriteU16(type, out);
+    WriteU16(kDnsClassIn, out);
+    WriteU32(ttl, out);
+    WriteU16(static_cast<uint16_t>(rdlength), out);
+    uint8_t bytes[16];
+    IpAddressBytes(address, bytes);
+    out->insert(out->end(), bytes, bytes + rdlength);
+    ++count;
+  }
+  (*out)[6] = static_cast<uint8_t>(count >> 8);
+  (*out)[7] = static_cast<uint8_t>(count);
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,74 @@
+#ifndef NATIVE_CORE_DNS_MESSAGE_H_
+#define NATIVE_CORE_DNS_MESSAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/ip_address.h"
+
+namespace cfvpn {
+
+// RFC 1035 报文编解码，只覆盖解析器需要的部分：A/AAAA 查询与回答、
+// 跟随 CNAME 链、从 SOA 取否定缓存时间。
+
+constexpr uint16_t kDnsTypeA = 1;
+constexpr uint16_t kDnsTypeCname = 5;
+constexpr uint16_t kDnsTypeSoa = 6;
+constexpr uint16_t kDnsTypeAaaa = 28;
+constexpr uint16_t kDnsClassIn = 1;
+
+constexpr uint8_t kDnsRcodeNoError = 0;
+constexpr uint8_t kDnsRcodeFormErr = 1;
+constexpr uint8_t kDnsRcodeServFail = 2;
+constexpr uint8_t kDnsRcodeNxDomain = 3;
+
+// UDP 报文的上限（不使用 EDNS0）
+constexpr size_t kDnsUdpMaxBytes = 512;
+
+struct DnsQuestion {
+  std::string name;  // 小写、不带末尾的点
+  uint16_t type = 0;
+  uint16_t klass = kDnsClassIn;
+};
+
+struct DnsMessage {
+  uint16_t id = 0;
+  uint16_t flags = 0;
+  std::vector<DnsQuestion> questions;
+  // 回答中属于第一个问题（沿 CNAME 链）的 A/AAAA 地址
+  std::vector<IpAddress> addresses;
+  // 上述地址及所经 CNAME 记录的最小 TTL，没有地址时为 0
+  uint32_t ttl = 0;
+  // 授权部分 SOA 的 min(TTL, MINIMUM)，即 RFC 2308 的否定缓存时间；
+  // 没有 SOA 时为 0
+  uint32_t negative_ttl = 0;
+
+  bool response() const { return (flags & 0x8000) != 0; }
+  bool truncated() const { return (flags & 0x0200) != 0; }
+  uint8_t rcode() const { return static_cast<uint8_t>(flags & 0x000F); }
+};
+
+// 规范化域名：转小写、去掉末尾的点并检查标签长度（1..63）和总长度
+// （不超过 253）。只接受字母、数字、'-' 和 '_'。
+bool NormalizeDnsName(std::string_view name, std::string* out);
+
+// 构造设置了 RD 的单问题查询，name 须已规范化
+bool BuildDnsQuery(uint16_t id, const std::string& name, uint16_t type,
+                   std::vector<uint8_t>* out);
+
+// 解析报文，支持名称压缩。格式错误时返回 false。
+bool ParseDnsMessage(const uint8_t* data, size_t length, DnsMessage* out);
+
+// 按 query 的第一个问题构造回答：回显问题，answers 中与问题类型相同
+// 的地址各生成一条记录（名称用指向问题的压缩指针）。超出 UDP 上限时
+// 截断并设置 TC。
+void BuildDnsResponse(const DnsMessage& query, uint8_t rcode,
+                      const std::vector<IpAddress>& answers, uint32_t ttl,
+                      std::vector<uint8_t>* out);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_DNS_MESSAGE_H_
@@ -0,0 +1,869 @@
+#include "core/dns_resolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <poll.h>
+#endif
+
+namespace cfvpn {
+
+namespace {
+
+constexpr size_t kMaxMessageBytes = 65535;
+constexpr size_t kRecvBufferBytes = 4096;
+constexpr int kMaxIdAttempts = 64;
+
+#if defined(_WIN32)
+using PollEntry = WSAPOLLFD;
+constexpr int kSendFlags = 0;
+
+int PollMany(PollEntry* entries, size_t count, int timeout_ms) {
+  return ::WSAPoll(entries, static_cast<ULONG>(count), timeout_ms);
+}
+#else
+using PollEntry = pollfd;
+constexpr int kSendFlags = MSG_NOSIGNAL;
+
+int PollMany(PollEntry* entries, size_t count, int timeout_ms) {
+  int ready;
+  do {
+    ready = ::poll(entries, static_cast<nfds_t>(count), timeout_ms);
+  } while (ready < 0 && errno == EINTR);
+  return ready;
+}
+#endif
+
+PollEntry MakePollEntry(NativeSocket socket, short events) {
+  PollEntry entry;
+  entry.fd = socket;
+  entry.events = events;
+  entry.revents = 0;
+  return entry;
+}
+
+bool ParsePort(std::string_view text, uint16_t* out) {
+  if (text.empty() || text.size() > 5) return false;
+  uint32_t value = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9') return false;
+    value = value * 10 + static_cast<uint32_t>(c - '0');
+  }
+  if (value == 0 || value > 65535) return false;
+  *out = static_cast<uint16_t>(value);
+  return true;
+}
+
+std::string CacheKey(const std::string& name, uint16_t type) {
+  return std::to_string(type) + "/" + name;
+}
+
+// 对端地址是否为该上游
+bool FromUpstream(const sockaddr_storage& from, const DnsUpstream& upstream) {
+  sockaddr_storage expected;
+  MakeSockaddr(upstream.address, upstream.port, &expected);
+  if (from.ss_family != expected.ss_family) return false;
+  if (from.ss_family == AF_INET) {
+    const auto* a = reinterpret_cast<const sockaddr_in*>(&from);
+    const auto* b = reinterpret_cast<const sockaddr_in*>(&expected);
+    return a->sin_port == b->sin_port &&
+           a->sin_addr.s_addr == b->sin_addr.s_addr;
+  }
+  const auto* a = reinterpret_cast<const sockaddr_in6*>(&from);
+  const auto* b = reinterpret_cast<const sockaddr_in6*>(&expected);
+  return a->sin6_port == b->sin6_port &&
+         std::memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+}
+
+NativeSocket OpenUdp(int family, uint32_t bind_ip, uint16_t port) {
+  NativeSocket socket = ::socket(family, SOCK_DGRAM, IPPROTO_UDP);
+  if (socket == kInvalidSocket) return kInvalidSocket;
+  sockaddr_storage address;
+  IpAddress any;
+  any.v6 = family == AF_INET6;
+  if (!any.v6) any = IpAddress::V4(bind_ip);
+  const int length = MakeSockaddr(any, port, &address);
+  if (!SetNonBlocking(socket) ||
+      ::bind(socket, reinterpret_cast<const sockaddr*>(&address), length) !=
+          0) {
+    CloseSocket(socket);
+    return kInvalidSocket;
+  }
+  return socket;
+}
+
+uint16_t LocalPort(NativeSocket socket) {
+  sockaddr_in address;
+  socklen_t length = sizeof(address);
+  if (::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) !=
+      0) {
+    return 0;
+  }
+  return ntohs(address.sin_port);
+}
+
+}  // namespace
+
+bool ParseDnsUpstream(std::string_view text, DnsUpstream* out) {
+  DnsUpstream upstream;
+  if (text.substr(0, 6) == "tcp://") {
+    upstream.tcp = true;
+    text.remove_prefix(6);
+  } else if (text.substr(0, 6) == "udp://") {
+    text.remove_prefix(6);
+  }
+  std::string_view host = text;
+  if (!text.empty() && text.front() == '[') {
+    const size_t close = text.find(']');
+    if (close == std::string_view::npos) return false;
+    host = text.substr(1, close - 1);
+    const std::string_view rest = text.substr(close + 1);
+    if (!rest.empty() &&
+        (rest.front() != ':' || !ParsePort(rest.substr(1), &upstream.port))) {
+      return false;
+    }
+  } else if (std::count(text.begin(), text.end(), ':') == 1) {
+    const size_t colon = text.find(':');
+    host = text.substr(0, colon);
+    if (!ParsePort(text.substr(colon + 1), &upstream.port)) return false;
+  }
+  if (!ParseIpAddress(host, &upstream.address)) return false;
+  *out = upstream;
+  return true;
+}
+
+size_t ParseDnsUpstreamList(std::string_view text,
+                            std::vector<DnsUpstream>* out) {
+  size_t invalid = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    const size_t end = text.find_first_of(", \t\r\n", pos);
+    const size_t stop = end == std::string_view::npos ? text.size() : end;
+    if (stop > pos) {
+      DnsUpstream upstream;
+      if (ParseDnsUpstream(text.substr(pos, stop - pos), &upstream)) {
+        out->push_back(upstream);
+      } else {
+        ++invalid;
+      }
+    }
+    pos = stop + 1;
+  }
+  return invalid;
+}
+
+// 一次上游查询：解析器自己的（名称, 类型）查询，或本地服务原样转发
+// 的客户端查询
+struct DnsResolver::Query {
+  std::string key;  // 转发查询为空
+  std::string name;
+  uint16_t type = 0;
+  uint16_t id = 0;
+  std::vector<uint8_t> packet;  // 事务 ID 已替换为 id
+  std::vector<Waiter> waiters;
+
+  size_t upstream = 0;      // 当前尝试的上游下标
+  bool tcp = false;         // 当前上游改用 TCP（UDP 回答被截断）
+  bool sent = false;        // 当前尝试已发出
+  int64_t deadline_us = 0;
+
+  // TCP 连接状态
+  NativeSocket socket = kInvalidSocket;
+  bool connected = false;
+  std::vector<uint8_t> out;  // 带两字节长度前缀的查询
+  size_t out_pos = 0;
+  std::vector<uint8_t> in;
+
+  // 转发查询的客户端
+  bool forward = false;
+  DnsMessage request;  // 客户端的原始查询（含原事务 ID）
+  sockaddr_storage client;
+  socklen_t client_length = 0;
+};
+
+// Resolve 的一次调用，等待 A/AAAA 两个结果
+struct DnsResolver::Request {
+  Callback callback;
+  std::atomic<int> remaining{0};
+  Answer answers[2];
+  bool cached[2] = {true, true};
+};
+
+DnsResolver::DnsResolver(const DnsResolverOptions& options)
+    : options_(options),
+      random_(static_cast<uint64_t>(MonotonicMicros())) {
+  options_.timeout_ms = std::max(1, options_.timeout_ms);
+  options_.min_ttl_sec = std::min(options_.min_ttl_sec, options_.max_ttl_sec);
+  options_.prefetch_ratio = std::min(std::max(options_.prefetch_ratio, 0.0), 1.0);
+}
+
+DnsResolver::~DnsResolver() { Stop(); }
+
+bool DnsResolver::Start(std::string* error) {
+  bool stopped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped = stopping_;
+  }
+  if (worker_.joinable() || stopped) {
+    *error = "解析器已启动过";
+    return false;
+  }
+  if (options_.upstreams.empty()) {
+    *error = "没有上游 DNS 服务器";
+    return false;
+  }
+  if (!InitSocketLibrary()) {
+    *error = "套接字库初始化失败";
+    return false;
+  }
+  bool need_v4 = false;
+  bool need_v6 = false;
+  for (const DnsUpstream& upstream : options_.upstreams) {
+    if (upstream.tcp) continue;
+    (upstream.address.v6 ? need_v6 : need_v4) = true;
+  }
+  wake_ = OpenUdp(AF_INET, 0x7F000001, 0);
+  if (wake_ != kInvalidSocket) wake_port_ = LocalPort(wake_);
+  if (need_v4) udp4_ = OpenUdp(AF_INET, 0, 0);
+  if (need_v6) udp6_ = OpenUdp(AF_INET6, 0, 0);
+  if (options_.serve) {
+    server_ = OpenUdp(AF_INET, 0x7F000001, options_.listen_port);
+    if (server_ != kInvalidSocket) local_port_ = LocalPort(server_);
+  }
+  if (wake_ == kInvalidSocket || (need_v4 && udp4_ == kInvalidSocket) ||
+      (need_v6 && udp6_ == kInvalidSocket) ||
+      (options_.serve && server_ == kInvalidSocket)) {
+    *error = SocketErrorString(LastSocketError());
+    for (NativeSocket* socket : {&wake_, &udp4_, &udp6_, &server_}) {
+      CloseSocket(*socket);
+      *socket = kInvalidSocket;
+    }
+    local_port_ = 0;
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = true;
+  }
+  worker_ = std::thread(&DnsResolver::Run, this);
+  return true;
+}
+
+void DnsResolver::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) return;
+    stopping_ = true;
+  }
+  if (worker_.joinable()) {
+    Wakeup();
+    worker_.join();
+  }
+  ReadyList ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    Answer cancelled;
+    cancelled.status = DnsStatus::kCancelled;
+    while (!queries_.empty()) {
+      FinishQueryLocked(queries_.begin()->second.get(), cancelled, &ready);
+    }
+  }
+  for (NativeSocket* socket : {&wake_, &udp4_, &udp6_, &server_}) {
+    CloseSocket(*socket);
+    *socket = kInvalidSocket;
+  }
+  for (const auto& callback : ready) callback();
+}
+
+void DnsResolver::Wakeup() {
+  if (wake_ == kInvalidSocket) return;
+  const sockaddr_in address = MakeSockaddrV4(0x7F000001, wake_port_);
+  const char byte = 0;
+  ::sendto(wake_, &byte, 1, 0, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address));
+}
+
+void DnsResolver::Resolve(const std::string& name, Callback callback) {
+  std::string normalized;
+  if (!NormalizeDnsName(name, &normalized)) {
+    DnsResult result;
+    result.status = DnsStatus::kInvalidName;
+    callback(result);
+    return;
+  }
+  auto request = std::make_shared<Request>();
+  request->callback = std::move(callback);
+  const uint16_t types[2] = {kDnsTypeA, kDnsTypeAaaa};
+  const int count = options_.ipv6 ? 2 : 1;
+  request->remaining.store(count);
+  ReadyList ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_ || stopping_) {
+      DnsResult result;
+      result.status = DnsStatus::kCancelled;
+      ready.push_back([request, result]() { request->callback(result); });
+    } else {
+      ++stats_.lookups;
+      for (int i = 0; i < count; ++i) {
+        LookupLocked(
+            normalized, types[i],
+            [request, i, count](const Answer& answer, bool from_cache) {
+              request->answers[i] = answer;
+              request->cached[i] = from_cache;
+              if (request->remaining.fetch_sub(1) != 1) return;
+              // 两个类型都已返回：合并地址，状态以有地址或 NOERROR 为准
+              DnsResult result;
+              result.status = request->answers[0].status;
+              result.ttl_sec = UINT32_MAX;
+              result.from_cache = true;
+              bool any_ok = false;
+              for (int k = 0; k < count; ++k) {
+                const Answer& part = request->answers[k];
+                result.addresses.insert(result.addresses.end(),
+                                        part.addresses.begin(),
+                                        part.addresses.end());
+                result.ttl_sec = std::min(result.ttl_sec, part.ttl_sec);
+                result.from_cache = result.from_cache && request->cached[k];
+                any_ok = any_ok || part.status == DnsStatus::kOk;
+              }
+              if (any_ok) result.status = DnsStatus::kOk;
+              request->callback(result);
+            },
+            &ready);
+      }
+    }
+  }
+  for (const auto& run : ready) run();
+}
+
+DnsResult DnsResolver::ResolveSync(const std::string& name, int timeout_ms) {
+  struct State {
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;
+    DnsResult result;
+  };
+  auto state = std::make_shared<State>();
+  Resolve(name, [state](const DnsResult& result) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->result = result;
+    state->finished = true;
+    state->done.notify_all();
+  });
+  std::unique_lock<std::mutex> lock(state->mutex);
+  if (!state->done.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                            [&]() { return state->finished; })) {
+    DnsResult result;
+    result.status = DnsStatus::kTimeout;
+    return result;
+  }
+  return state->result;
+}
+
+void DnsResolver::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.clear();
+  lru_.clear();
+}
+
+DnsResolverStats DnsResolver::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  DnsResolverStats stats = stats_;
+  stats.cache_size = cache_.size();
+  return stats;
+}
+
+void DnsResolver::LookupLocked(const std::string& name, uint16_t type,
+                               Waiter waiter, ReadyList* ready) {
+  const std::string key = CacheKey(name, type);
+  Answer answer;
+  if (CacheLookupLocked(key, MonotonicMicros(), &answer)) {
+    ++stats_.cache_hits;
+    ready->push_back([waiter = std::move(waiter), answer]() {
+      waiter(answer, true);
+    });
+    return;
+  }
+  ++stats_.cache_misses;
+  auto pending = pending_.find(key);
+  if (pending != pending_.end()) {
+    ++stats_.coalesced;
+    pending->second->waiters.push_back(std::move(waiter));
+    return;
+  }
+  Query* query = StartQueryLocked(name, type);
+  if (query == nullptr) {
+    answer.status = DnsStatus::kServFail;
+    ready->push_back([waiter = std::move(waiter), answer]() {
+      waiter(answer, false);
+    });
+    return;
+  }
+  query->waiters.push_back(std::move(waiter));
+}
+
+bool DnsResolver::CacheLookupLocked(const std::string& key, int64_t now_us,
+                                    Answer* answer) {
+  auto it = cache_.find(key);
+  if (it == cache_.end()) return false;
+  CacheEntry& entry = it->second;
+  if (now_us >= entry.expires_us) {
+    lru_.erase(entry.lru);
+    cache_.erase(it);
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, entry.lru);
+  ++entry.hits;
+  const int64_t remaining_us = entry.expires_us - now_us;
+  *answer = entry.answer;
+  answer->ttl_sec = static_cast<uint32_t>((remaining_us + 999999) / 1000000);
+
+  // 热门条目在过期前刷新；刷新结果写回时保留命中计数
+  if (options_.prefetch_hits > 0 &&
+      entry.hits >= static_cast<uint32_t>(options_.prefetch_hits) &&
+      remaining_us < static_cast<int64_t>(entry.answer.ttl_sec * 1e6 *
+                                          options_.prefetch_ratio) &&
+      pending_.count(key) == 0) {
+    if (StartQueryLocked(entry.name, entry.type) != nullptr) {
+      ++stats_.prefetches;
+    }
+  }
+  return true;
+}
+
+void DnsResolver::CacheStoreLocked(const std::string& key,
+                                   const std::string& name, uint16_t type,
+                                   const Answer& answer, int64_t now_us) {
+  if (options_.cache_capacity == 0 || answer.ttl_sec == 0) return;
+  auto it = cache_.find(key);
+  if (it == cache_.end()) {
+    lru_.push_front(key);
+    it = cache_.emplace(key, CacheEntry()).first;
+    it->second.lru = lru_.begin();
+    it->second.name = name;
+    it->second.type = type;
+  } else {
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+  }
+  it->second.answer = answer;
+  it->second.expires_us =
+      now_us + static_cast<int64_t>(answer.ttl_sec) * 1000000;
+  while (cache_.size() > options_.cache_capacity) {
+    cache_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+DnsResolver::Query* DnsResolver::NewQueryLocked() {
+  uint16_t id = 0;
+  int attempt = 0;
+  do {
+    if (++attempt > kMaxIdAttempts) return nullptr;
+    id = static_cast<uint16_t>(random_.Next());
+  } while (queries_.count(id) != 0);
+  auto query = std::make_unique<Query>();
+  query->id = id;
+  Query* raw = query.get();
+  queries_.emplace(id, std::move(query));
+  Wakeup();
+  return raw;
+}
+
+DnsResolver::Query* DnsResolver::StartQueryLocked(const std::string& name,
+                                                  uint16_t type) {
+  Query* query = NewQueryLocked();
+  if (query == nullptr) return nullptr;
+  query->key = CacheKey(name, type);
+  query->name = name;
+  query->type = type;
+  BuildDnsQuery(query->id, name, type, &query->packet);
+  pending_[query->key] = query;
+  return query;
+}
+
+void DnsResolver::FinishQueryLocked(Query* query, const Answer& answer,
+                                    ReadyList* ready) {
+  if (query->forward) {
+    // 转发失败时回 SERVFAIL；停止时不再发送
+    if (answer.status != DnsStatus::kCancelled) {
+      std::vector<uint8_t> response;
+      BuildDnsResponse(query->request, kDnsRcodeServFail, {}, 0, &response);
+      SendToClient(response, query->client, query->client_length);
+    }
+  } else {
+    CacheStoreLocked(query->key, query->name, query->type, answer,
+                     MonotonicMicros());
+    pending_.erase(query->key);
+    for (Waiter& waiter : query->waiters) {
+      ready->push_back([waiter = std::move(waiter), answer]() {
+        waiter(answer, false);
+      });
+    }
+  }
+  EraseQueryLocked(query);
+}
+
+void DnsResolver::EraseQueryLocked(Query* query) {
+  if (query->socket != kInvalidSocket) CloseSocket(query->socket, true);
+  queries_.erase(query->id);
+}
+
+void DnsResolver::SendToClient(const std::vector<uint8_t>& message,
+                               const sockaddr_storage& client,
+                               socklen_t client_length) {
+  if (server_ == kInvalidSocket) return;
+  if (::sendto(server_, reinterpret_cast<const char*>(message.data()),
+               static_cast<int>(message.size()), 0,
+               reinterpret_cast<const sockaddr*>(&client),
+               client_length) >= 0) {
+    ++stats_.served;
+  }
+}
+
+void DnsResolver::SendQuery(Query* query, int64_t now_us, ReadyList* ready) {
+  const DnsUpstream& upstream = options_.upstreams[query->upstream];
+  query->sent = true;
+  query->deadline_us = now_us + int64_t{options_.timeout_ms} * 1000;
+  ++stats_.upstream_queries;
+  sockaddr_storage address;
+  const int address_length =
+      MakeSockaddr(upstream.address, upstream.port, &address);
+
+  if (upstream.tcp || query->tcp) {
+    query->connected = false;
+    query->out.clear();
+    query->out.push_back(static_cast<uint8_t>(query->packet.size() >> 8));
+    query->out.push_back(static_cast<uint8_t>(query->packet.size()));
+    query->out.insert(query->out.end(), query->packet.begin(),
+                      query->packet.end());
+    query->out_pos = 0;
+    query->in.clear();
+    query->socket = ::socket(address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (query->socket != kInvalidSocket && SetNonBlocking(query->socket)) {
+      if (::connect(query->socket, reinterpret_cast<const sockaddr*>(&address),
+                    address_length) == 0 ||
+          IsInProgressError(LastSocketError())) {
+        return;
+      }
+    }
+  } else {
+    const NativeSocket socket = upstream.address.v6 ? udp6_ : udp4_;
+    if (::sendto(socket, reinterpret_cast<const char*>(query->packet.data()),
+                 static_cast<int>(query->packet.size()), 0,
+                 reinterpret_cast<const sockaddr*>(&address),
+                 address_length) >= 0) {
+      return;
+    }
+  }
+  AdvanceUpstream(query, now_us, DnsStatus::kTimeout, ready);
+}
+
+void DnsResolver::AdvanceUpstream(Query* query, int64_t now_us,
+                                  DnsStatus failure, ReadyList* ready) {
+  if (query->socket != kInvalidSocket) {
+    CloseSocket(query->socket, true);
+    query->socket = kInvalidSocket;
+  }
+  query->tcp = false;
+  if (++query->upstream >= options_.upstreams.size()) {
+    Answer answer;
+    answer.status = failure;
+    FinishQueryLocked(query, answer, ready);
+    return;
+  }
+  SendQuery(query, now_us, ready);
+}
+
+void DnsResolver::Run() {
+  std::vector<PollEntry> entries;
+  std::vector<uint16_t> tcp_ids;  // entries 中 TCP 套接字对应的查询
+  std::vector<uint16_t> ids;
+  for (;;) {
+    ReadyList ready;
+    int timeout_ms = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) return;
+      const int64_t now_us = MonotonicMicros();
+      // 发出新查询，超时的查询换下一个上游
+      ids.clear();
+      for (const auto& item : queries_) ids.push_back(item.first);
+      for (uint16_t id : ids) {
+        auto it = queries_.find(id);
+        if (it == queries_.end()) continue;
+        Query* query = it->second.get();
+        if (!query->sent) {
+          SendQuery(query, now_us, &ready);
+        } else if (now_us >= query->deadline_us) {
+          ++stats_.upstream_timeouts;
+          AdvanceUpstream(query, now_us, DnsStatus::kTimeout, &ready);
+        }
+      }
+
+      entries.clear();
+      tcp_ids.clear();
+      for (NativeSocket socket : {wake_, udp4_, udp6_, server_}) {
+        if (socket != kInvalidSocket) {
+          entries.push_back(MakePollEntry(socket, POLLIN));
+        }
+      }
+      int64_t next_deadline = INT64_MAX;
+      for (const auto& item : queries_) {
+        const Query& query = *item.second;
+        next_deadline = std::min(next_deadline, query.deadline_us);
+        if (query.socket == kInvalidSocket) continue;
+        const bool writing =
+            !query.connected || query.out_pos < query.out.size();
+        entries.push_back(
+            MakePollEntry(query.socket, writing ? POLLOUT : POLLIN));
+        tcp_ids.push_back(query.id);
+      }
+      if (next_deadline != INT64_MAX) {
+        timeout_ms = static_cast<int>(
+            std::max<int64_t>(0, (next_deadline - now_us + 999) / 1000));
+      }
+    }
+    for (const auto& run : ready) run();
+    ready.clear();
+
+    if (PollMany(entries.data(), entries.size(), timeout_ms) <= 0) continue;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const int64_t now_us = MonotonicMicros();
+      const size_t fixed = entries.size() - tcp_ids.size();
+      for (size_t i = 0; i < fixed; ++i) {
+        const PollEntry& entry = entries[i];
+        if (entry.revents == 0) continue;
+        if (entry.fd == wake_) {
+          char buffer[64];
+          while (::recv(wake_, buffer, sizeof(buffer), 0) > 0) {
+          }
+        } else if (entry.fd == server_) {
+          OnServerReadable(&ready);
+        } else {
+          OnUdpReadable(entry.fd, now_us, &ready);
+        }
+      }
+      for (size_t i = fixed; i < entries.size(); ++i) {
+        if (entries[i].revents == 0) continue;
+        auto it = queries_.find(tcp_ids[i - fixed]);
+        // 查询可能已在本轮结束，或换了上游重新连接
+        if (it == queries_.end() || it->second->socket != entries[i].fd) {
+          continue;
+        }
+        OnTcpEvent(it->second.get(), entries[i].revents, now_us, &ready);
+      }
+    }
+    for (const auto& run : ready) run();
+  }
+}
+
+void DnsResolver::OnUdpReadable(NativeSocket socket, int64_t now_us,
+                                ReadyList* ready) {
+  uint8_t buffer[kRecvBufferBytes];
+  for (;;) {
+    sockaddr_storage from;
+    socklen_t from_length = sizeof(from);
+    const auto received = ::recvfrom(
+        socket, reinterpret_cast<char*>(buffer), sizeof(buffer), 0,
+        reinterpret_cast<sockaddr*>(&from), &from_length);
+    if (received < 0) return;
+    if (received < 2) continue;
+    const uint16_t id = static_cast<uint16_t>((buffer[0] << 8) | buffer[1]);
+    auto it = queries_.find(id);
+    if (it == queries_.end()) continue;
+    Query* query = it->second.get();
+    // 只接受当前上游通过 UDP 发来的回答，其余视为迟到或伪造
+    if (!query->sent || query->socket != kInvalidSocket ||
+        !FromUpstream(from, options_.upstreams[query->upstream])) {
+      continue;
+    }
+    HandleResponse(query, buffer, static_cast<size_t>(received), false,
+                   now_us, ready);
+  }
+}
+
+void DnsResolver::OnTcpEvent(Query* query, short revents, int64_t now_us,
+                             ReadyList* ready) {
+  if (!query->connected) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (::getsockopt(query->socket, SOL_SOCKET, SO_ERROR,
+                     reinterpret_cast<char*>(&error), &length) != 0 ||
+        error != 0) {
+      AdvanceUpstream(query, now_us, DnsStatus::kTimeout, ready);
+      return;
+    }
+    query->connected = true;
+  }
+  if (query->out_pos < query->out.size()) {
+    const auto sent = ::send(
+        query->socket,
+        reinterpret_cast<const char*>(query->out.data() + query->out_pos),
+        static_cast<int>(query->out.size() - query->out_pos), kSendFlags);
+    if (sent < 0) {
+      if (!IsInProgressError(LastSocketError())) {
+        AdvanceUpstream(query, now_us, DnsStatus::kTimeout, ready);
+      }
+      return;
+    }
+    query->out_pos += static_cast<size_t>(sent);
+    return;
+  }
+  if ((revents & (POLLIN | POLLERR | POLLHUP)) == 0) return;
+  uint8_t buffer[kRecvBufferBytes];
+  const auto received = ::recv(query->socket, reinterpret_cast<char*>(buffer),
+                               sizeof(buffer), 0);
+  if (received < 0 && IsInProgressError(LastSocketError())) return;
+  if (received <= 0 || query->in.size() + static_cast<size_t>(received) >
+                           kMaxMessageBytes + 2) {
+    AdvanceUpstream(query, now_us, DnsStatus::kTimeout, ready);
+    return;
+  }
+  query->in.insert(query->in.end(), buffer, buffer + received);
+  if (query->in.size() < 2) return;
+  const size_t length = (size_t{query->in[0]} << 8) | query->in[1];
+  if (query->in.size() < length + 2) return;
+  HandleResponse(query, query->in.data() + 2, length, true, now_us, ready);
+}
+
+void DnsResolver::HandleResponse(Query* query, const uint8_t* data,
+                                 size_t length, bool via_tcp, int64_t now_us,
+                                 ReadyList* ready) {
+  DnsMessage message;
+  const bool parsed = ParseDnsMessage(data, length, &message) &&
+                      message.response() && message.id == query->id;
+  if (!parsed) {
+    // UDP 上的坏报文可能是伪造的，继续等待；TCP 连接上的则换上游
+    if (via_tcp) AdvanceUpstream(query, now_us, DnsStatus::kServFail, ready);
+    return;
+  }
+  if (!via_tcp && message.truncated()) {
+    ++stats_.tcp_fallbacks;
+    query->tcp = true;
+    SendQuery(query, now_us, ready);
+    return;
+  }
+
+  if (query->forward) {
+    // 恢复客户端的事务 ID 后原样转发；超过 UDP 上限时只回报头并设置 TC，
+    // 让客户端自行改用 TCP
+    std::vector<uint8_t> response(data, data + length);
+    response[0] = static_cast<uint8_t>(query->request.id >> 8);
+    response[1] = static_cast<uint8_t>(query->request.id);
+    if (response.size() > kDnsUdpMaxBytes) {
+      response.resize(12);
+      response[2] |= 0x02;
+      std::fill(response.begin() + 4, response.end(), 0);
+    }
+    SendToClient(response, query->client, query->client_length);
+    EraseQueryLocked(query);
+    return;
+  }
+
+  if (message.questions.empty() ||
+      message.questions.front().name != query->name ||
+      message.questions.front().type != query->type) {
+    if (via_tcp) AdvanceUpstream(query, now_us, DnsStatus::kServFail, ready);
+    return;
+  }
+  Answer answer;
+  const uint8_t rcode = message.rcode();
+  if (rcode != kDnsRcodeNoError && rcode != kDnsRcodeNxDomain) {
+    AdvanceUpstream(query, now_us, DnsStatus::kServFail, ready);
+    return;
+  }
+  answer.status =
+      rcode == kDnsRcodeNxDomain ? DnsStatus::kNxDomain : DnsStatus::kOk;
+  answer.addresses = std::move(message.addresses);
+  if (!answer.addresses.empty()) {
+    answer.ttl_sec = std::min(std::max(message.ttl, options_.min_ttl_sec),
+                              options_.max_ttl_sec);
+  } else {
+    answer.ttl_sec = message.negative_ttl > 0
+                         ? std::min(message.negative_ttl,
+                                    options_.negative_ttl_sec)
+                         : options_.negative_ttl_sec;
+  }
+  FinishQueryLocked(query, answer, ready);
+}
+
+void DnsResolver::OnServerReadable(ReadyList* ready) {
+  uint8_t buffer[kRecvBufferBytes];
+  for (;;) {
+    sockaddr_storage client;
+    socklen_t client_length = sizeof(client);
+    const auto received = ::recvfrom(
+        server_, reinterpret_cast<char*>(buffer), sizeof(buffer), 0,
+        reinterpret_cast<sockaddr*>(&client), &client_length);
+    if (received < 0) return;
+    DnsMessage request;
+    if (!ParseDnsMessage(buffer, static_cast<size_t>(received), &request) ||
+        request.response()) {
+      continue;
+    }
+    if (request.questions.size() != 1) {
+      std::vector<uint8_t> response;
+      BuildDnsResponse(request, kDnsRcodeFormErr, {}, 0, &response);
+      SendToClient(response, client, client_length);
+      continue;
+    }
+    const DnsQuestion& question = request.questions.front();
+    std::string name;
+    const bool cacheable =
+        question.klass == kDnsClassIn &&
+        (question.type == kDnsTypeA || question.type == kDnsTypeAaaa) &&
+        NormalizeDnsName(question.name, &name);
+
+    if (cacheable && question.type == kDnsTypeAaaa && !options_.ipv6) {
+      // 关闭 IPv6 时 AAAA 一律回空（NODATA），客户端直接用 IPv4
+      std::vector<uint8_t> response;
+      BuildDnsResponse(request, kDnsRcodeNoError, {}, 0, &response);
+      SendToClient(response, client, client_length);
+      continue;
+    }
+    if (cacheable) {
+      ++stats_.lookups;
+      LookupLocked(
+          name, question.type,
+          [this, request, client, client_length](const Answer& answer,
+                                                 bool /*from_cache*/) {
+            if (answer.status == DnsStatus::kCancelled) return;
+            uint8_t rcode = kDnsRcodeNoError;
+            if (answer.status == DnsStatus::kNxDomain) {
+              rcode = kDnsRcodeNxDomain;
+            } else if (answer.status != DnsStatus::kOk) {
+              rcode = kDnsRcodeServFail;
+            }
+            std::vector<uint8_t> response;
+            BuildDnsResponse(request, rcode, answer.addresses, answer.ttl_sec,
+                             &response);
+            std::lock_guard<std::mutex> lock(mutex_);
+            SendToClient(response, client, client_length);
+          },
+          ready);
+      continue;
+    }
+
+    // 其他类型原样转发，不缓存
+    Query* query = NewQueryLocked();
+    if (query == nullptr) continue;
+    query->forward = true;
+    query->request = std::move(request);
+    query->client = client;
+    query->client_length = client_length;
+    query->packet.assign(buffer, buffer + received);
+    query->packet[0] = static_cast<uint8_t>(query->id >> 8);
+    query->packet[1] = static_cast<uint8_t>(query->id);
+  }
+}
+
+}  // namespace cfvpn
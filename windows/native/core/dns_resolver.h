@@ -0,0 +1,207 @@
+#ifndef NATIVE_CORE_DNS_RESOLVER_H_
+#define NATIVE_CORE_DNS_RESOLVER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/dns_message.h"
+#include "core/ip_address.h"
+#include "core/random.h"
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+struct DnsUpstream {
+  IpAddress address;
+  uint16_t port = 53;
+  // 只用 DNS over TCP。v2ray 的 dns-in 入站（dokodemo-door）经隧道转发，
+  // 用 TCP 访问它可以避开 UDP 在部分网络上被丢弃或劫持的问题。
+  bool tcp = false;
+};
+
+// 解析 "ip[:port]"、"[ipv6]:port" 或带 "tcp://" / "udp://" 前缀的形式
+bool ParseDnsUpstream(std::string_view text, DnsUpstream* out);
+
+// 解析以逗号或空白分隔的上游列表，返回无效项的数量
+size_t ParseDnsUpstreamList(std::string_view text,
+                            std::vector<DnsUpstream>* out);
+
+struct DnsResolverOptions {
+  std::vector<DnsUpstream> upstreams;  // 依次尝试，前一个超时才用下一个
+  int timeout_ms = 2000;               // 每个上游的超时
+  size_t cache_capacity = 1024;        // 缓存的（名称, 类型）条目数
+  // 上游 TTL 被限制在 [min_ttl_sec, max_ttl_sec] 内；NXDOMAIN 和无地址
+  // 的回答按 SOA 的否定 TTL 缓存，没有 SOA 或超过 negative_ttl_sec 时
+  // 取 negative_ttl_sec
+  uint32_t min_ttl_sec = 30;
+  uint32_t max_ttl_sec = 3600;
+  uint32_t negative_ttl_sec = 60;
+  // 命中次数达到 prefetch_hits、剩余 TTL 不足原 TTL 的 prefetch_ratio
+  // 的条目在命中时后台刷新，热门名称因此不会过期
+  int prefetch_hits = 2;
+  double prefetch_ratio = 0.1;
+  bool ipv6 = true;  // 同时查询 AAAA
+  // 在 127.0.0.1 上提供 UDP DNS 服务：A/AAAA 走缓存，其余类型原样转发。
+  // listen_port 为 0 时由系统分配，见 DnsResolver::local_port()
+  bool serve = false;
+  uint16_t listen_port = 0;
+};
+
+enum class DnsStatus : int32_t {
+  kOk = 0,           // NOERROR，地址可能为空（NODATA）
+  kNxDomain = 1,
+  kServFail = 2,     // 上游返回其他错误码或无法解析的回答
+  kTimeout = 3,      // 所有上游都超时或连接失败
+  kInvalidName = 4,
+  kCancelled = 5,    // 解析器未启动或已停止
+};
+
+struct DnsResult {
+  DnsStatus status = DnsStatus::kOk;
+  std::vector<IpAddress> addresses;  // 先 IPv4 后 IPv6
+  uint32_t ttl_sec = 0;              // 剩余 TTL
+  bool from_cache = false;
+};
+
+struct DnsResolverStats {
+  uint64_t lookups = 0;         // Resolve 调用次数（含本地服务收到的查询）
+  uint64_t cache_hits = 0;      // 按（名称, 类型）计
+  uint64_t cache_misses = 0;
+  uint64_t coalesced = 0;       // 合并到在途查询的次数
+  uint64_t prefetches = 0;
+  uint64_t upstream_queries = 0;
+  uint64_t upstream_timeouts = 0;
+  uint64_t tcp_fallbacks = 0;   // UDP 回答被截断后改用 TCP
+  uint64_t served = 0;          // 本地服务回复的报文数
+  size_t cache_size = 0;
+};
+
+// 进程内异步 DNS 解析器。
+//
+// 一个工作线程用 poll 驱动所有上游套接字：UDP 查询按事务 ID 匹配，
+// 被截断（TC）时改用 TCP，上游配置为 TCP 时直接用带长度前缀的
+// DNS over TCP。一个名称的 A 和 AAAA 并行查询；相同（名称, 类型）的
+// 在途查询合并为一次。结果进入按 TTL 过期的 LRU 缓存，命中时按
+// 命中次数和剩余 TTL 决定是否后台预取。
+//
+// Resolve 可从任意线程调用；回调在缓存全部命中时于调用线程中执行，
+// 否则在工作线程中执行，回调内不要阻塞。
+class DnsResolver {
+ public:
+  using Callback = std::function<void(const DnsResult& result)>;
+
+  explicit DnsResolver(const DnsResolverOptions& options);
+  ~DnsResolver();
+
+  DnsResolver(const DnsResolver&) = delete;
+  DnsResolver& operator=(const DnsResolver&) = delete;
+
+  // 创建套接字并启动工作线程；Stop 后不能再次启动
+  bool Start(std::string* error);
+  // 停止工作线程，在途的查询以 kCancelled 结束。可重复调用。
+  void Stop();
+
+  void Resolve(const std::string& name, Callback callback);
+
+  // 阻塞等待 Resolve 的结果，最多 timeout_ms（超时返回 kTimeout）
+  DnsResult ResolveSync(const std::string& name, int timeout_ms);
+
+  // 清空缓存（代替 ipconfig /flushdns），在途的查询不受影响
+  void Clear();
+
+  DnsResolverStats stats() const;
+
+  // 本地服务实际监听的端口，未开启时为 0
+  uint16_t local_port() const { return local_port_; }
+
+ private:
+  // 一个（名称, 类型）的结果，也是缓存条目的内容
+  struct Answer {
+    DnsStatus status = DnsStatus::kOk;
+    std::vector<IpAddress> addresses;
+    uint32_t ttl_sec = 0;  // 限制后的原始 TTL，不缓存的结果为 0
+  };
+  using Waiter = std::function<void(const Answer& answer, bool from_cache)>;
+
+  struct CacheEntry {
+    Answer answer;
+    std::string name;
+    uint16_t type = 0;
+    int64_t expires_us = 0;
+    uint32_t hits = 0;  // 累计命中次数，刷新后保留
+    std::list<std::string>::iterator lru;
+  };
+
+  struct Query;
+  struct Request;
+
+  // 以下方法调用时持有 mutex_，需要执行的回调追加到 ready，释放锁后执行
+  using ReadyList = std::vector<std::function<void()>>;
+  void LookupLocked(const std::string& name, uint16_t type, Waiter waiter,
+                    ReadyList* ready);
+  // 命中时返回 true 并写出结果（ttl_sec 为剩余 TTL），顺带判断是否预取
+  bool CacheLookupLocked(const std::string& key, int64_t now_us,
+                         Answer* answer);
+  void CacheStoreLocked(const std::string& key, const std::string& name,
+                        uint16_t type, const Answer& answer, int64_t now_us);
+  // 分配事务 ID 并唤醒工作线程，查询在工作线程的下一轮发出
+  Query* NewQueryLocked();
+  Query* StartQueryLocked(const std::string& name, uint16_t type);
+  void FinishQueryLocked(Query* query, const Answer& answer,
+                         ReadyList* ready);
+  void EraseQueryLocked(Query* query);
+
+  // 以下方法只在工作线程中调用（同样持有 mutex_）。SendQuery、
+  // AdvanceUpstream 和 HandleResponse 可能结束并释放 query。
+  void Run();
+  void SendQuery(Query* query, int64_t now_us, ReadyList* ready);
+  // 换下一个上游重试，没有更多上游时以 failure 结束
+  void AdvanceUpstream(Query* query, int64_t now_us, DnsStatus failure,
+                       ReadyList* ready);
+  void OnUdpReadable(NativeSocket socket, int64_t now_us, ReadyList* ready);
+  void OnTcpEvent(Query* query, short revents, int64_t now_us,
+                  ReadyList* ready);
+  void OnServerReadable(ReadyList* ready);
+  void HandleResponse(Query* query, const uint8_t* data, size_t length,
+                      bool via_tcp, int64_t now_us, ReadyList* ready);
+  void SendToClient(const std::vector<uint8_t>& message,
+                    const sockaddr_storage& client, socklen_t client_length);
+  void Wakeup();
+
+  DnsResolverOptions options_;
+  uint16_t local_port_ = 0;
+
+  mutable std::mutex mutex_;
+  bool running_ = false;
+  bool stopping_ = false;
+  // 缓存：键为 "类型/名称"，lru_ 头部是最近使用的
+  std::unordered_map<std::string, CacheEntry> cache_;
+  std::list<std::string> lru_;
+  // 在途查询，按事务 ID 和键索引
+  std::map<uint16_t, std::unique_ptr<Query>> queries_;
+  std::unordered_map<std::string, Query*> pending_;
+  Random random_;
+  DnsResolverStats stats_;
+
+  // 只由工作线程读写（Start 之前和 Stop 之后除外）
+  NativeSocket udp4_ = kInvalidSocket;
+  NativeSocket udp6_ = kInvalidSocket;
+  NativeSocket wake_ = kInvalidSocket;    // 绑定回环的 UDP，向自身发包唤醒
+  uint16_t wake_port_ = 0;
+  NativeSocket server_ = kInvalidSocket;
+  std::thread worker_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_DNS_RESOLVER_H_
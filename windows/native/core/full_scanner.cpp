@@ -0,0 +1,342 @@
+#include "core/full_scanner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include "core/address_permutation.h"
+#include "core/json.h"
+#include "core/node_scanner.h"
+#include "core/random.h"
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr int kCheckpointVersion = 1;
+constexpr char kCsvHeader[] = "ip,port,latency_ms,loss_rate,sent,received\n";
+
+// ranges 覆盖的 /24 编号（ip >> 8），由 Ipv4RangeIndex 合并重叠部分
+std::vector<Ipv4Range> BlockRanges(const std::vector<Ipv4Range>& ranges) {
+  std::vector<Ipv4Range> blocks;
+  blocks.reserve(ranges.size());
+  for (const Ipv4Range& range : ranges) {
+    blocks.push_back(Ipv4Range{range.first >> 8, range.last >> 8});
+  }
+  return blocks;
+}
+
+// /24 中被测试的地址：由种子决定的 .1 ~ .254 之一；段比 /24 小时取
+// 段内的地址，只有 .0 或 .255 在段内时才使用它们
+uint32_t HostFor(uint32_t block, uint64_t seed, const Ipv4RangeIndex& index) {
+  const uint32_t base = block << 8;
+  const uint32_t start =
+      1 + static_cast<uint32_t>(Random(seed ^ (block * 0x9E3779B97F4A7C15ull))
+                                    .Uniform(254));
+  uint32_t fallback = base;
+  for (uint32_t i = 0; i < 256; ++i) {
+    const uint32_t host = (start + i) & 0xFF;
+    if (!index.Contains(base | host)) continue;
+    if (host != 0 && host != 255) return base | host;
+    fallback = base | host;
+  }
+  return fallback;
+}
+
+// 段列表、种子和端口的 FNV-1a 指纹，任何一项变化都不能续扫
+std::string Fingerprint(const Ipv4RangeIndex& ranges, uint64_t seed,
+                        uint16_t port) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  auto mix = [&hash](uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+      hash ^= (value >> (8 * i)) & 0xFF;
+      hash *= 0x100000001B3ull;
+    }
+  };
+  for (const Ipv4Range& interval : ranges.intervals()) {
+    mix((static_cast<uint64_t>(interval.first) << 32) | interval.last);
+  }
+  mix(seed);
+  mix(port);
+  char text[17];
+  std::snprintf(text, sizeof(text), "%016llx",
+                static_cast<unsigned long long>(hash));
+  return text;
+}
+
+struct Checkpoint {
+  uint64_t position = 0;      // 已完成的排列序号
+  uint64_t output_bytes = 0;  // 对应的结果文件长度
+};
+
+bool LoadCheckpoint(const std::string& path, const std::string& fingerprint,
+                    Checkpoint* out) {
+  std::ifstream file(fs::u8path(path), std::ios::binary);
+  if (!file) return false;
+  const std::string text((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  JsonValue root;
+  if (!ParseJson(text, &root, nullptr) || !root.is_object()) return false;
+  const JsonValue* version = root.Find("version");
+  const JsonValue* stored = root.Find("fingerprint");
+  const JsonValue* position = root.Find("position");
+  const JsonValue* output_bytes = root.Find("output_bytes");
+  if (version == nullptr || version->AsInt() != kCheckpointVersion ||
+      stored == nullptr || stored->text != fingerprint ||
+      position == nullptr || output_bytes == nullptr) {
+    return false;
+  }
+  out->position = static_cast<uint64_t>(std::max<int64_t>(0, position->AsInt()));
+  out->output_bytes =
+      static_cast<uint64_t>(std::max<int64_t>(0, output_bytes->AsInt()));
+  return true;
+}
+
+// 先写临时文件再改名，进程在任何时刻被杀死都不会留下半个检查点
+bool SaveCheckpoint(const std::string& path, const std::string& fingerprint,
+                    const Checkpoint& checkpoint, uint64_t total,
+                    uint64_t reachable) {
+  JsonValue root;
+  root.type = JsonValue::Type::kObject;
+  root.Member("version") = JsonValue::Number(kCheckpointVersion);
+  root.Member("fingerprint") = JsonValue::String(fingerprint);
+  root.Member("position") =
+      JsonValue::Number(static_cast<int64_t>(checkpoint.position));
+  root.Member("total") = JsonValue::Number(static_cast<int64_t>(total));
+  root.Member("output_bytes") =
+      JsonValue::Number(static_cast<int64_t>(checkpoint.output_bytes));
+  root.Member("reachable") = JsonValue::Number(static_cast<int64_t>(reachable));
+  std::string json;
+  AppendJson(root, &json);
+
+  const fs::path target = fs::u8path(path);
+  fs::path temporary = target;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+    if (!file.flush()) return false;
+  }
+  std::error_code error;
+  fs::rename(temporary, target, error);
+  if (error) {
+    fs::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+// Dart 端把 maxLatency 同时作为 TCPing 的连接超时
+TcpingOptions TcpingFor(const FullScanOptions& options) {
+  TcpingOptions tcping = options.tcping;
+  tcping.timeout_ms = options.max_latency_ms;
+  return tcping;
+}
+
+}  // namespace
+
+FullScanOptions::FullScanOptions() {
+  ParseCidrList(kCloudflareIpRanges, &ranges);
+  // 与 CloudflareTestService._testLatencyNative 一致，但不提前结束
+  tcping.attempts = 3;
+  tcping.min_valid_latency_ms = 30;
+  tcping.interval_ms = 50;
+  tcping.max_inflight = 1024;
+  tcping.adaptive_inflight = true;
+  tcping.min_inflight = 32;
+  tcping.initial_inflight = 256;
+}
+
+FullScanner::FullScanner(const FullScanOptions& options)
+    : options_(options),
+      engine_(TcpingFor(options)),
+      cancelled_(false),
+      total_blocks_(0),
+      done_blocks_(0),
+      reachable_(0) {}
+
+void FullScanner::Cancel() {
+  cancelled_.store(true, std::memory_order_relaxed);
+  engine_.Cancel();
+}
+
+void FullScanner::Offer(const FullScanNode& node) {
+  const size_t keep = static_cast<size_t>(std::max(options_.keep_best, 0));
+  if (best_.size() >= keep &&
+      (keep == 0 || best_.back().latency_ms <= node.latency_ms)) {
+    return;
+  }
+  const auto it = std::upper_bound(
+      best_.begin(), best_.end(), node,
+      [](const FullScanNode& a, const FullScanNode& b) {
+        return a.latency_ms < b.latency_ms;
+      });
+  best_.insert(it, node);
+  if (best_.size() > keep) best_.pop_back();
+}
+
+bool FullScanner::Run(std::string* error, const ProgressCallback& progress) {
+  error->clear();
+  best_.clear();
+  reachable_.store(0, std::memory_order_relaxed);
+  if (options_.ranges.empty()) {
+    *error = "没有可扫描的 IP 段";
+    return false;
+  }
+  if (options_.output_path.empty()) {
+    *error = "没有指定结果文件";
+    return false;
+  }
+  InitSocketLibrary();
+
+  const Ipv4RangeIndex addresses(options_.ranges);
+  const Ipv4RangeIndex blocks(BlockRanges(options_.ranges));
+  const uint64_t total = blocks.address_count();
+  total_blocks_.store(total, std::memory_order_relaxed);
+  const std::string fingerprint =
+      Fingerprint(blocks, options_.seed, options_.port);
+
+  // 1. 读取检查点。结果文件比检查点记录的短，说明被外部改动过，从头开始
+  Checkpoint checkpoint;
+  const fs::path output_path = fs::u8path(options_.output_path);
+  if (!options_.restart && !options_.checkpoint_path.empty() &&
+      LoadCheckpoint(options_.checkpoint_path, fingerprint, &checkpoint)) {
+    std::error_code size_error;
+    const uintmax_t size = fs::file_size(output_path, size_error);
+    if (size_error || size < checkpoint.output_bytes) {
+      checkpoint = Checkpoint();
+    }
+  }
+  checkpoint.position = std::min(checkpoint.position, total);
+  resumed_from_ = checkpoint.position;
+  done_blocks_.store(checkpoint.position, std::memory_order_relaxed);
+
+  // 2. 续扫时截掉检查点之后写入的半批结果，并从已有结果恢复统计
+  std::ofstream output;
+  if (checkpoint.position > 0) {
+    std::error_code resize_error;
+    fs::resize_file(output_path, checkpoint.output_bytes, resize_error);
+    if (resize_error) {
+      *error = "无法截断结果文件: " + resize_error.message();
+      return false;
+    }
+    std::ifstream existing(output_path, std::ios::binary);
+    std::string line;
+    std::getline(existing, line);  // 表头
+    while (std::getline(existing, line)) {
+      uint32_t ip = 0;
+      const size_t comma = line.find(',');
+      if (comma == std::string::npos ||
+          !ParseIpv4(line.substr(0, comma).c_str(), &ip)) {
+        continue;
+      }
+      int port = 0;
+      FullScanNode node;
+      node.ip = ip;
+      int sent = 0;
+      int received = 0;
+      if (std::sscanf(line.c_str() + comma + 1, "%d,%d,%f,%d,%d", &port,
+                      &node.latency_ms, &node.loss_rate, &sent,
+                      &received) != 5 ||
+          received == 0 || node.latency_ms > options_.max_latency_ms) {
+        continue;
+      }
+      reachable_.fetch_add(1, std::memory_order_relaxed);
+      Offer(node);
+    }
+    output.open(output_path, std::ios::binary | std::ios::app);
+  } else {
+    output.open(output_path, std::ios::binary | std::ios::trunc);
+    output << kCsvHeader;
+    checkpoint.output_bytes = sizeof(kCsvHeader) - 1;
+  }
+  if (!output || !output.flush()) {
+    *error = "无法打开结果文件: " + options_.output_path;
+    return false;
+  }
+  // 从头开始时立即覆盖旧检查点，避免它与刚清空的结果文件不一致
+  if (checkpoint.position == 0 && !options_.checkpoint_path.empty() &&
+      !SaveCheckpoint(options_.checkpoint_path, fingerprint, checkpoint,
+                      total, 0)) {
+    *error = "保存检查点失败: " + options_.checkpoint_path;
+    return false;
+  }
+
+  // 3. 按排列顺序分批探测，每批结束后写结果、存检查点
+  const FeistelPermutation order(Uint128::Make(0, total), options_.seed);
+  const size_t chunk = static_cast<size_t>(std::max(options_.chunk_blocks, 1));
+  std::vector<ProbeTarget> targets;
+  std::vector<ProbeResult> results;
+  targets.reserve(static_cast<size_t>(
+      std::min<uint64_t>(chunk, total - checkpoint.position)));
+  char line[96];
+  while (checkpoint.position < total &&
+         !cancelled_.load(std::memory_order_relaxed)) {
+    const size_t count = static_cast<size_t>(
+        std::min<uint64_t>(chunk, total - checkpoint.position));
+    targets.clear();
+    for (size_t i = 0; i < count; ++i) {
+      const uint64_t offset =
+          order.At(Uint128::Make(0, checkpoint.position + i)).lo;
+      const uint32_t block = blocks.AddressAt(offset);
+      targets.push_back(
+          {HostFor(block, options_.seed, addresses), options_.port});
+    }
+
+    const uint64_t base = checkpoint.position;
+    const bool ok = engine_.Run(
+        targets, &results, [&](size_t, const ProbeResult&) {
+          const uint64_t done = base + engine_.completed();
+          done_blocks_.store(done, std::memory_order_relaxed);
+          if (progress) progress(done, total);
+        });
+    if (!ok) {
+      *error = "事件循环初始化失败";
+      return false;
+    }
+    if (cancelled_.load(std::memory_order_relaxed)) {
+      // 被取消的一批不写入，续扫时整批重测
+      done_blocks_.store(base, std::memory_order_relaxed);
+      break;
+    }
+
+    for (const ProbeResult& result : results) {
+      const bool reachable = result.received > 0 &&
+                             result.latency_ms <= options_.max_latency_ms;
+      if (!reachable && !options_.write_failures) continue;
+      const int length = std::snprintf(
+          line, sizeof(line), "%s,%u,%d,%.2f,%d,%d\n",
+          FormatIpv4(result.ip).c_str(), static_cast<unsigned>(result.port),
+          result.latency_ms, result.loss_rate, result.sent, result.received);
+      output.write(line, length);
+      checkpoint.output_bytes += static_cast<uint64_t>(length);
+      if (reachable) {
+        reachable_.fetch_add(1, std::memory_order_relaxed);
+        FullScanNode node;
+        node.ip = result.ip;
+        node.latency_ms = result.latency_ms;
+        node.loss_rate = result.loss_rate;
+        Offer(node);
+      }
+    }
+    if (!output.flush()) {
+      *error = "写入结果文件失败: " + options_.output_path;
+      return false;
+    }
+    checkpoint.position += count;
+    if (!options_.checkpoint_path.empty() &&
+        !SaveCheckpoint(options_.checkpoint_path, fingerprint, checkpoint,
+                        total, reachable())) {
+      *error = "保存检查点失败: " + options_.checkpoint_path;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace cfvpn
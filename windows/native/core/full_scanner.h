@@ -0,0 +1,100 @@
+#ifndef NATIVE_CORE_FULL_SCANNER_H_
+#define NATIVE_CORE_FULL_SCANNER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "core/cidr_sampler.h"
+#include "core/tcping_engine.h"
+
+namespace cfvpn {
+
+// 全量扫描参数
+struct FullScanOptions {
+  FullScanOptions();
+
+  std::vector<Ipv4Range> ranges;  // 默认 kCloudflareIpRanges
+  // 决定 /24 的遍历顺序和每段中的测试地址；续扫时必须与检查点一致
+  uint64_t seed = 1;
+  uint16_t port = 443;
+  TcpingOptions tcping;  // 默认值见构造函数，不启用提前结束
+  int chunk_blocks = 1024;  // 每批探测的 /24 数，也是保存检查点的间隔
+  int keep_best = 5;        // 内存中保留的最低延迟节点数
+  int max_latency_ms = 300;  // 超过该延迟的节点不写入结果
+  bool write_failures = false;  // 是否把不可达的 /24 也写入结果文件
+  std::string output_path;      // CSV 结果，续扫时追加
+  std::string checkpoint_path;  // 为空时不保存进度
+  bool restart = false;         // 忽略已有检查点，从头开始并清空结果文件
+};
+
+// 一个可达的节点（主机字节序）
+struct FullScanNode {
+  uint32_t ip = 0;
+  int32_t latency_ms = 0;
+  float loss_rate = 0;
+};
+
+// 对 ranges 覆盖的每个 /24 各测一个地址的全量扫描。
+//
+// 所有 /24 按 FeistelPermutation 决定的顺序分批交给 TcpingEngine，每批
+// 结束后把结果追加到 CSV，再原子地替换检查点文件（排列位置、结果文件
+// 长度和段列表指纹）。进程被杀死后用相同参数再次运行，会截掉结果文件中
+// 检查点之后的部分并从该位置继续；被取消的那一批整批重测。内存只与段
+// 数量、chunk_blocks 和 keep_best 有关，与 /24 总数无关。
+class FullScanner {
+ public:
+  // 每个 /24 完成时回调（在调用 Run 的线程中）
+  using ProgressCallback = std::function<void(uint64_t done, uint64_t total)>;
+
+  explicit FullScanner(const FullScanOptions& options);
+
+  FullScanner(const FullScanner&) = delete;
+  FullScanner& operator=(const FullScanner&) = delete;
+
+  // 阻塞执行扫描，完成或被取消时返回 true；文件读写或事件循环失败时
+  // 返回 false 并写入 error。检查点表明已全部完成时直接返回。
+  bool Run(std::string* error, const ProgressCallback& progress = nullptr);
+
+  // 请求取消，可从任意线程调用
+  void Cancel();
+
+  // /24 总数（Run 开始后有效）
+  uint64_t total_blocks() const {
+    return total_blocks_.load(std::memory_order_relaxed);
+  }
+  // 已完成的 /24 数，包括续扫前完成的部分
+  uint64_t done_blocks() const {
+    return done_blocks_.load(std::memory_order_relaxed);
+  }
+  // 续扫的起点，0 表示从头开始
+  uint64_t resumed_from() const { return resumed_from_; }
+  // 写入结果文件的可达节点数
+  uint64_t reachable() const {
+    return reachable_.load(std::memory_order_relaxed);
+  }
+  bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+  // 延迟最低的 keep_best 个节点，包括续扫前写入结果文件的节点。
+  // 只在 Run 返回后调用。
+  const std::vector<FullScanNode>& best() const { return best_; }
+
+ private:
+  void Offer(const FullScanNode& node);
+
+  FullScanOptions options_;
+  TcpingEngine engine_;
+  std::atomic<bool> cancelled_;
+  std::atomic<uint64_t> total_blocks_;
+  std::atomic<uint64_t> done_blocks_;
+  std::atomic<uint64_t> reachable_;
+  uint64_t resumed_from_ = 0;
+  std::vector<FullScanNode> best_;  // 按延迟升序
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_FULL_SCANNER_H_
@@ -0,0 +1,125 @@
+#ifndef NATIVE_CORE_HEALTH_MONITOR_H_
+#define NATIVE_CORE_HEALTH_MONITOR_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/random.h"
+#include "core/tcping_engine.h"
+
+namespace cfvpn {
+
+// 健康检查参数。默认值下当前节点每 2 秒、每个备用节点每 10 秒各做一次
+// TCP 握手（约 4 个包），3 个备用节点时合计不到 4 包/秒。
+struct HealthMonitorOptions {
+  int active_interval_ms = 2000;
+  int standby_interval_ms = 10000;
+  double jitter = 0.2;     // 每次间隔在 ±jitter 比例内随机，避免与其他定时任务同步
+  int timeout_ms = 1000;   // 握手超时，超时计为丢包
+  double alpha = 0.25;     // 延迟、抖动和丢包率 EWMA 中新样本的权重
+  // 以下任一条件持续 degraded_checks 次检查即判定当前节点变差
+  int max_latency_ms = 300;
+  int max_jitter_ms = 100;
+  double max_loss_rate = 0.3;
+  int min_samples = 4;       // 样本少于此数时只看连续失败
+  int degraded_checks = 3;
+  int max_failure_streak = 3;  // 连续失败达到此数立即判定变差
+  // 备用节点的得分至少比当前节点好这么多比例才切换
+  double switch_margin = 0.2;
+  int cooldown_ms = 30000;   // 两次切换的最短间隔
+  uint64_t seed = 0;         // 间隔抖动的种子，0 表示按时间
+};
+
+// 一个节点的滑动统计
+struct NodeHealth {
+  ProbeTarget target;
+  double latency_ms = 0;  // 成功握手耗时的 EWMA
+  double jitter_ms = 0;   // 相邻两次成功握手耗时之差的 EWMA（RFC 3550 风格）
+  double loss_rate = 0;   // 失败（0/1）的 EWMA
+  int32_t samples = 0;
+  int32_t failure_streak = 0;
+  int32_t last_latency_ms = -1;  // 最近一次成功的握手耗时
+  bool degraded = false;
+
+  // 合并一次探测结果，latency_ms < 0 表示失败
+  void Add(int32_t latency_ms, double alpha);
+
+  // 越小越好：延迟按丢包率放大再加上抖动，没有成功样本时为无穷大
+  double Score() const;
+};
+
+// 已连接节点的后台健康检查与自动切换。
+//
+// 一个线程按抖动后的间隔依次探测当前节点和备用节点，每次只做一次
+// TCP 握手，其余时间阻塞在条件变量上。当前节点连续 degraded_checks 次
+// 超过阈值（或连续失败 max_failure_streak 次）时，选出得分最好且明显
+// 优于它的备用节点，交换两者的角色并调用 FailoverCallback；具体的
+// 切换动作（重新生成出站配置并重启 v2ray）由调用方完成。
+class HealthMonitor {
+ public:
+  // 返回握手耗时（毫秒），失败返回 -1。默认实现为非阻塞 connect + poll。
+  using Prober = std::function<int32_t(const ProbeTarget& target,
+                                       int timeout_ms)>;
+  // 切换时在监控线程中调用，参数为节点在 nodes 中的下标
+  using FailoverCallback = std::function<void(size_t from, size_t to)>;
+
+  // nodes[0] 是当前节点，其余为备用节点
+  HealthMonitor(const HealthMonitorOptions& options,
+                std::vector<ProbeTarget> nodes, Prober prober = nullptr);
+  ~HealthMonitor();
+
+  HealthMonitor(const HealthMonitor&) = delete;
+  HealthMonitor& operator=(const HealthMonitor&) = delete;
+
+  void set_failover_callback(FailoverCallback callback) {
+    on_failover_ = std::move(callback);
+  }
+
+  // 启动监控线程；Stop 后不能再次启动
+  void Start();
+  // 停止并等待监控线程退出，可重复调用
+  void Stop();
+
+  // 探测一个节点并更新统计，随后检查是否需要切换。由监控线程调用，
+  // 测试中也可以在未 Start 时直接调用。
+  void ProbeOnce(size_t index);
+
+  // 当前节点的下标
+  size_t active() const;
+  // 已发生的切换次数
+  int failovers() const;
+  // 所有节点统计的副本
+  std::vector<NodeHealth> Snapshot() const;
+
+  static int32_t TcpHandshake(const ProbeTarget& target, int timeout_ms);
+
+ private:
+  void Run();
+  int64_t NextDelayUs(bool active);
+  // 调用时持有 mutex_，需要切换时返回 true 并写出目标下标
+  bool EvaluateLocked(int64_t now_us, size_t* to);
+
+  HealthMonitorOptions options_;
+  Prober prober_;
+  FailoverCallback on_failover_;
+  Random random_;  // 仅在监控线程中使用
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<NodeHealth> nodes_;
+  size_t active_ = 0;
+  int bad_checks_ = 0;
+  int failovers_ = 0;
+  int64_t last_switch_us_ = 0;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_HEALTH_MONITOR_H_
@@ -0,0 +1,383 @@
+#include "core/http_probe_engine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#include "core/io_reactor.h"
+#include "core/socket_util.h"
+#include "core/trace_response_parser.h"
+
+namespace cfvpn {
+
+namespace {
+
+constexpr int kEventBatch = 256;
+constexpr int kMaxWaitMs = 50;
+constexpr int64_t kLocalErrorBackoffUs = 10 * 1000;
+
+// trace 响应约 600 字节，一次读取足够
+constexpr uint32_t kRecvBufferSize = 4096;
+
+// 每条在途连接占用一个槽位，接收缓冲区和解析器按槽位复用
+struct Connection {
+  TraceResponseParser parser;
+  char buffer[kRecvBufferSize];
+};
+
+enum class Stage : uint8_t {
+  kIdle,
+  kConnecting,
+  kSending,
+  kReceiving,
+};
+
+struct TargetState {
+  NativeSocket socket = kInvalidSocket;
+  Stage stage = Stage::kIdle;
+  uint32_t sequence = 0;  // 每次建连或发送请求时递增，识别过期的事件和超时
+  int32_t slot = -1;
+  int64_t connect_start_us = 0;
+  int64_t request_start_us = 0;
+  int64_t request_origin_us = 0;  // 连接上的首个请求从建连算起
+  int64_t ttfb_us = -1;
+  int64_t ttfb_sum_us = 0;
+  int32_t connect_ms = -1;
+  int32_t total_ms = -1;
+  int32_t sent = 0;
+  int32_t received = 0;
+  uint16_t status = 0;
+  char colo[8] = {};
+  char loc[4] = {};
+  bool done = false;
+};
+
+struct Deadline {
+  int64_t at_us;
+  uint32_t index;
+  uint32_t sequence;
+};
+
+uint64_t MakeToken(uint32_t index, uint32_t sequence) {
+  return (static_cast<uint64_t>(sequence) << 32) | index;
+}
+
+HttpProbeResult MakeResult(const ProbeTarget& target, const TargetState& state) {
+  HttpProbeResult result;
+  result.ip = target.ip;
+  result.port = target.port;
+  result.status = state.status;
+  result.connect_ms = state.connect_ms;
+  result.ttfb_ms =
+      state.received > 0
+          ? static_cast<int32_t>(state.ttfb_sum_us / state.received / 1000)
+          : -1;
+  result.total_ms = state.total_ms;
+  result.sent = state.sent;
+  result.received = state.received;
+  std::memcpy(result.colo, state.colo, sizeof(result.colo));
+  std::memcpy(result.loc, state.loc, sizeof(result.loc));
+  return result;
+}
+
+}  // namespace
+
+HttpProbeEngine::HttpProbeEngine(const HttpProbeOptions& options)
+    : options_(options), cancelled_(false), completed_(0) {
+  options_.requests = std::max(1, options_.requests);
+  options_.timeout_ms = std::max(1, options_.timeout_ms);
+  options_.max_inflight = std::max(1, options_.max_inflight);
+}
+
+std::string HttpProbeEngine::BuildRequest(const std::string& host) const {
+  // 请求头与 _testTraceSpeed 相同，另外显式要求保持连接
+  return "GET " + options_.path + " HTTP/1.1\r\nHost: " + host +
+         "\r\nUser-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) "
+         "AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 "
+         "Safari/537.36\r\nAccept: text/plain\r\n"
+         "Connection: keep-alive\r\n\r\n";
+}
+
+void HttpProbeEngine::Cancel() {
+  cancelled_.store(true, std::memory_order_relaxed);
+}
+
+bool HttpProbeEngine::Run(const std::vector<ProbeTarget>& targets,
+                          std::vector<HttpProbeResult>* results,
+                          const CompletionCallback& on_complete) {
+  completed_.store(0, std::memory_order_relaxed);
+  results->clear();
+  results->reserve(targets.size());
+  for (const ProbeTarget& target : targets) {
+    results->push_back(MakeResult(target, TargetState()));
+  }
+
+  IoReactor reactor;
+  if (!InitSocketLibrary() || !reactor.Open()) {
+    return false;
+  }
+
+  const size_t total = targets.size();
+  const int64_t timeout_us = static_cast<int64_t>(options_.timeout_ms) * 1000;
+  const size_t slot_count =
+      std::min(total, static_cast<size_t>(options_.max_inflight));
+
+  // 请求报文只拼一次；Host 使用目标 IP 时每个目标各一份
+  std::vector<std::string> requests;
+  if (options_.host.empty()) {
+    requests.reserve(total);
+    for (const ProbeTarget& target : targets) {
+      const std::string host = FormatIpAddress(target.address);
+      requests.push_back(
+          BuildRequest(target.address.v6 ? "[" + host + "]" : host));
+    }
+  } else {
+    requests.push_back(BuildRequest(options_.host));
+  }
+
+  std::vector<TargetState> states(total);
+  std::vector<Connection> connections(slot_count);
+  std::vector<int32_t> free_slots;
+  for (size_t i = slot_count; i > 0; --i) {
+    free_slots.push_back(static_cast<int32_t>(i - 1));
+  }
+  std::deque<Deadline> timeouts;
+  std::deque<Deadline> retries;  // 本机资源不足时延后重新建连
+  size_t next_fresh = 0;
+  size_t finished = 0;
+
+  auto close_socket = [&](TargetState& state) {
+    if (state.socket != kInvalidSocket) {
+      reactor.Close(state.socket, true);
+      state.socket = kInvalidSocket;
+    }
+    state.stage = Stage::kIdle;
+  };
+
+  auto finish = [&](uint32_t index) {
+    TargetState& state = states[index];
+    close_socket(state);
+    if (state.slot >= 0) {
+      free_slots.push_back(state.slot);
+      state.slot = -1;
+    }
+    state.done = true;
+    (*results)[index] = MakeResult(targets[index], state);
+    ++finished;
+    completed_.store(finished, std::memory_order_relaxed);
+    if (on_complete) {
+      on_complete(index, (*results)[index]);
+    }
+  };
+
+  // 建连、发送与收尾几个步骤相互调用，先声明
+  std::function<void(uint32_t, int64_t)> connect;
+  std::function<void(uint32_t, bool, int64_t)> next;
+
+  auto send_request = [&](uint32_t index, int64_t now_us) {
+    TargetState& state = states[index];
+    state.sequence++;
+    state.request_start_us = now_us;
+    state.ttfb_us = -1;
+    connections[static_cast<size_t>(state.slot)].parser.Reset();
+    const std::string& request = requests[requests.size() == 1 ? 0 : index];
+    int error = reactor.StartSend(state.socket, request.data(),
+                                  static_cast<uint32_t>(request.size()),
+                                  MakeToken(index, state.sequence));
+    if (error != 0) {
+      state.sent++;
+      close_socket(state);
+      next(index, false, now_us);
+      return;
+    }
+    state.stage = Stage::kSending;
+    timeouts.push_back({now_us + timeout_us, index, state.sequence});
+  };
+
+  // 一个请求失败：关闭连接，按需重连
+  auto fail = [&](uint32_t index, int64_t now_us) {
+    TargetState& state = states[index];
+    state.sent++;
+    close_socket(state);
+    next(index, false, now_us);
+  };
+
+  // 一个响应完整读完
+  auto complete = [&](uint32_t index, const TraceResponseParser& parser,
+                      bool reusable, int64_t now_us) {
+    TargetState& state = states[index];
+    state.sent++;
+    state.status = static_cast<uint16_t>(parser.status_code());
+    bool ok = options_.expected_status == 0
+                  ? (state.status >= 200 && state.status < 300)
+                  : state.status == options_.expected_status;
+    if (ok) {
+      state.received++;
+      state.ttfb_sum_us += state.ttfb_us;
+      if (state.total_ms < 0) {
+        state.total_ms =
+            static_cast<int32_t>((now_us - state.request_origin_us) / 1000);
+      }
+    }
+    if (parser.colo()[0] != '\0') {
+      std::memcpy(state.colo, parser.colo(), sizeof(state.colo));
+    }
+    if (parser.loc()[0] != '\0') {
+      std::memcpy(state.loc, parser.loc(), sizeof(state.loc));
+    }
+    next(index, reusable && parser.keep_alive(), now_us);
+  };
+
+  next = [&](uint32_t index, bool reusable, int64_t now_us) {
+    TargetState& state = states[index];
+    bool give_up = state.received == 0 && state.sent >= 2;
+    if (give_up || state.sent >= options_.requests) {
+      finish(index);
+    } else if (reusable && state.socket != kInvalidSocket) {
+      state.request_origin_us = now_us;
+      send_request(index, now_us);
+    } else {
+      close_socket(state);
+      connect(index, now_us);
+    }
+  };
+
+  // 建立新连接，调用前目标必须已分配槽位
+  connect = [&](uint32_t index, int64_t now_us) {
+    TargetState& state = states[index];
+    state.sequence++;
+    sockaddr_storage address;
+    const int address_length =
+        MakeSockaddr(targets[index].address, targets[index].port, &address);
+    state.connect_start_us = now_us;
+    state.request_origin_us = now_us;
+    int error = reactor.StartConnect(reinterpret_cast<sockaddr*>(&address),
+                                     address_length,
+                                     MakeToken(index, state.sequence),
+                                     &state.socket);
+    if (error == 0) {
+      state.stage = Stage::kConnecting;
+      timeouts.push_back({now_us + timeout_us, index, state.sequence});
+    } else if (IsLocalResourceError(error)) {
+      state.socket = kInvalidSocket;
+      retries.push_back({now_us + kLocalErrorBackoffUs, index, state.sequence});
+    } else {
+      state.socket = kInvalidSocket;
+      fail(index, now_us);
+    }
+  };
+
+  IoEvent events[kEventBatch];
+  while (finished < total) {
+    if (cancelled_.load(std::memory_order_relaxed)) {
+      break;
+    }
+
+    int64_t now_us = MonotonicMicros();
+    while (!retries.empty() && retries.front().at_us <= now_us) {
+      uint32_t index = retries.front().index;
+      retries.pop_front();
+      connect(index, now_us);
+    }
+    while (!free_slots.empty() && next_fresh < total) {
+      uint32_t index = static_cast<uint32_t>(next_fresh++);
+      states[index].slot = free_slots.back();
+      free_slots.pop_back();
+      connect(index, now_us);
+    }
+
+    int64_t wake_us = now_us + kMaxWaitMs * 1000;
+    if (!timeouts.empty()) {
+      wake_us = std::min(wake_us, timeouts.front().at_us);
+    }
+    if (!retries.empty()) {
+      wake_us = std::min(wake_us, retries.front().at_us);
+    }
+    int wait_ms = static_cast<int>(
+        std::max<int64_t>(0, (wake_us - now_us + 999) / 1000));
+
+    int count = reactor.Wait(events, kEventBatch, wait_ms);
+    now_us = MonotonicMicros();
+    for (int i = 0; i < count; ++i) {
+      const IoEvent& event = events[i];
+      uint32_t index = static_cast<uint32_t>(event.token & 0xFFFFFFFFu);
+      uint32_t sequence = static_cast<uint32_t>(event.token >> 32);
+      if (index >= total) {
+        continue;
+      }
+      TargetState& state = states[index];
+      if (state.sequence != sequence || state.socket == kInvalidSocket) {
+        continue;
+      }
+      if (event.error != 0) {
+        fail(index, now_us);
+        continue;
+      }
+
+      Connection& connection = connections[static_cast<size_t>(state.slot)];
+      if (event.op == IoOp::kConnect && state.stage == Stage::kConnecting) {
+        if (state.connect_ms < 0) {
+          state.connect_ms =
+              static_cast<int32_t>((now_us - state.connect_start_us) / 1000);
+        }
+        send_request(index, now_us);
+      } else if (event.op == IoOp::kSend && state.stage == Stage::kSending) {
+        int error = reactor.StartRecv(state.socket, connection.buffer,
+                                      kRecvBufferSize, event.token);
+        if (error != 0) {
+          fail(index, now_us);
+        } else {
+          state.stage = Stage::kReceiving;
+        }
+      } else if (event.op == IoOp::kRecv && state.stage == Stage::kReceiving) {
+        TraceResponseParser::Status status;
+        bool reusable = true;
+        if (event.bytes == 0) {
+          status = connection.parser.FeedEof();
+          reusable = false;
+        } else {
+          if (state.ttfb_us < 0) {
+            state.ttfb_us = now_us - state.request_start_us;
+          }
+          size_t consumed = 0;
+          status = connection.parser.Feed(connection.buffer, event.bytes,
+                                          &consumed);
+          // 响应之后还有多余数据，说明连接状态不可信，不再复用
+          reusable = consumed == event.bytes;
+        }
+        if (status == TraceResponseParser::Status::kDone) {
+          complete(index, connection.parser, reusable, now_us);
+        } else if (status == TraceResponseParser::Status::kError) {
+          fail(index, now_us);
+        } else if (reactor.StartRecv(state.socket, connection.buffer,
+                                     kRecvBufferSize, event.token) != 0) {
+          fail(index, now_us);
+        }
+      }
+    }
+
+    while (!timeouts.empty() && timeouts.front().at_us <= now_us) {
+      Deadline deadline = timeouts.front();
+      timeouts.pop_front();
+      TargetState& state = states[deadline.index];
+      if (state.sequence != deadline.sequence || state.done ||
+          state.stage == Stage::kIdle) {
+        continue;
+      }
+      fail(deadline.index, now_us);
+    }
+  }
+
+  if (finished < total) {
+    for (size_t index = 0; index < total; ++index) {
+      TargetState& state = states[index];
+      close_socket(state);
+      if (!state.done) {
+        (*results)[index] = MakeResult(targets[index], state);
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,78 @@
+#ifndef NATIVE_CORE_HTTP_PROBE_ENGINE_H_
+#define NATIVE_CORE_HTTP_PROBE_ENGINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "core/tcping_engine.h"
+
+namespace cfvpn {
+
+// HTTPing / Trace 参数，默认值对应 _testTraceSpeed
+struct HttpProbeOptions {
+  int requests = 1;           // 每个 IP 在同一连接上依次发送的请求数
+  int timeout_ms = 5000;      // 建连和每个请求各自的超时
+  int max_inflight = 64;      // 同时在途的连接数上限
+  int expected_status = 200;  // 视为成功的状态码，0 表示任意 2xx
+  std::string host = "cloudflare.com";  // 为空时使用目标 IP，与 HTTPing 一致
+  std::string path = "/cdn-cgi/trace";
+};
+
+// 单个 IP 的 HTTP 探测结果
+struct HttpProbeResult {
+  uint32_t ip;
+  uint16_t port;
+  uint16_t status;     // 最后一个响应的状态码，没有响应时为 0
+  // 以下耗时单位为毫秒，没有对应样本时为 -1
+  int32_t connect_ms;  // 首次建连耗时
+  int32_t ttfb_ms;     // 成功请求从发出到收到首字节的平均耗时
+  int32_t total_ms;    // 首个成功请求含建连在内读完响应的耗时，对应 Trace 的 speed
+  int32_t sent;
+  int32_t received;    // 状态码符合预期且响应完整的请求数
+  char colo[8];        // 响应体中的 colo=，以 NUL 结尾
+  char loc[4];         // 响应体中的 loc=
+};
+
+// 高并发 HTTP/1.1 探测引擎。
+//
+// 与 TcpingEngine 共用 IoReactor，同时保持最多 max_inflight 条连接。
+// 每个 IP 建立一条 keep-alive 连接，依次发送预先拼好的同一份请求，
+// 响应由 TraceResponseParser 在接收缓冲区上原地解析。服务器关闭连接时
+// 自动重连继续剩余的请求；与 TCPing 一样，前两次请求都失败时提前结束。
+class HttpProbeEngine {
+ public:
+  using CompletionCallback =
+      std::function<void(size_t index, const HttpProbeResult& result)>;
+
+  explicit HttpProbeEngine(const HttpProbeOptions& options);
+
+  HttpProbeEngine(const HttpProbeEngine&) = delete;
+  HttpProbeEngine& operator=(const HttpProbeEngine&) = delete;
+
+  // 阻塞执行全部探测，结果按 targets 的顺序写入 results
+  bool Run(const std::vector<ProbeTarget>& targets,
+           std::vector<HttpProbeResult>* results,
+           const CompletionCallback& on_complete = nullptr);
+
+  // 请求取消，可从任意线程调用
+  void Cancel();
+
+  // 已完成的目标数，可从任意线程读取
+  size_t completed() const { return completed_.load(std::memory_order_relaxed); }
+
+ private:
+  // 拼出完整的请求报文
+  std::string BuildRequest(const std::string& host) const;
+
+  HttpProbeOptions options_;
+  std::atomic<bool> cancelled_;
+  std::atomic<size_t> completed_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_HTTP_PROBE_ENGINE_H_
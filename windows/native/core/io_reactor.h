@@ -0,0 +1,78 @@
+#ifndef NATIVE_CORE_IO_REACTOR_H_
+#define NATIVE_CORE_IO_REACTOR_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+// 异步操作类型
+enum class IoOp : uint8_t {
+  kConnect,
+  kSend,
+  kRecv,
+};
+
+// 一次异步操作的完成事件
+struct IoEvent {
+  uint64_t token;  // 发起操作时调用方传入的标识
+  IoOp op;
+  int error;       // 0 表示成功，否则为平台错误码
+  uint32_t bytes;  // 收发字节数；kRecv 返回 0 且 error 为 0 表示对端关闭
+};
+
+// 单线程完成式（proactor）I/O 反应器。
+//
+// Linux 下基于 epoll 在就绪时代为完成收发，Windows 下基于 IOCP 与
+// ConnectEx/WSASend/WSARecv。上层只看到统一的“操作完成”事件，
+// 因此探测引擎等模块无需关心平台差异。
+//
+// 除 Wakeup() 外，所有方法都必须在同一线程调用。
+class IoReactor {
+ public:
+  IoReactor();
+  ~IoReactor();
+
+  IoReactor(const IoReactor&) = delete;
+  IoReactor& operator=(const IoReactor&) = delete;
+
+  // 创建底层 epoll/IOCP 句柄
+  bool Open();
+
+  // 创建非阻塞 TCP 套接字并发起连接。成功发起返回 0 并写出套接字，
+  // 结果通过 kConnect 事件送达；立即失败时返回错误码且不会产生事件。
+  int StartConnect(const sockaddr* address, int address_length,
+                   uint64_t token, NativeSocket* out_socket);
+
+  // 发送整个缓冲区，全部写出后产生 kSend 事件。完成前 data 必须保持有效。
+  int StartSend(NativeSocket socket, const char* data, uint32_t length,
+                uint64_t token);
+
+  // 接收一次数据，产生 kRecv 事件。完成前 buffer 必须保持有效。
+  int StartRecv(NativeSocket socket, char* buffer, uint32_t capacity,
+                uint64_t token);
+
+  // 接收并丢弃最多 capacity 字节，产生 kRecv 事件（bytes 为丢弃的字节数）。
+  // Linux 下用 MSG_TRUNC 让内核直接丢弃，数据不复制到用户态；Windows 下
+  // 读入反应器内所有套接字共用的暂存缓冲区。用于只统计字节数的吞吐测试。
+  int StartDiscard(NativeSocket socket, uint32_t capacity, uint64_t token);
+
+  // 关闭套接字并丢弃其尚未送达的事件，调用后不会再收到该套接字的事件
+  void Close(NativeSocket socket, bool abortive);
+
+  // 等待完成事件，timeout_ms < 0 表示无限等待。返回写入 events 的数量。
+  int Wait(IoEvent* events, int max_events, int timeout_ms);
+
+  // 唤醒阻塞中的 Wait()，可从任意线程调用
+  void Wakeup();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_IO_REACTOR_H_
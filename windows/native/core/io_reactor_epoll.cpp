@@ -0,0 +1,333 @@
+#include "core/io_reactor.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <deque>
+#include <vector>
+
+namespace cfvpn {
+
+namespace {
+
+// 单次 epoll_wait 最多取回的事件数
+constexpr int kMaxEpollEvents = 512;
+
+// 单个套接字上挂起的操作。每种操作同一时刻最多一个。
+struct SocketState {
+  bool open = false;
+  bool in_epoll = false;
+  uint32_t generation = 0;
+  uint32_t registered = 0;
+
+  bool connecting = false;
+  uint64_t connect_token = 0;
+
+  bool sending = false;
+  const char* send_data = nullptr;
+  uint32_t send_length = 0;
+  uint32_t send_offset = 0;
+  uint64_t send_token = 0;
+
+  bool receiving = false;
+  bool discarding = false;  // 接收的数据由内核丢弃（MSG_TRUNC）
+  char* recv_buffer = nullptr;
+  uint32_t recv_capacity = 0;
+  uint64_t recv_token = 0;
+};
+
+// 已完成但尚未交给调用方的事件；generation 用于丢弃已关闭套接字的事件
+struct ReadyEvent {
+  int fd;
+  uint32_t generation;
+  IoEvent event;
+};
+
+}  // namespace
+
+struct IoReactor::Impl {
+  int epoll_fd = -1;
+  int wake_fd = -1;
+  std::vector<SocketState> sockets;
+  std::deque<ReadyEvent> ready;
+  epoll_event epoll_events[kMaxEpollEvents];
+
+  ~Impl() {
+    for (size_t fd = 0; fd < sockets.size(); ++fd) {
+      if (sockets[fd].open) {
+        CloseSocket(static_cast<int>(fd), true);
+      }
+    }
+    if (wake_fd >= 0) {
+      ::close(wake_fd);
+    }
+    if (epoll_fd >= 0) {
+      ::close(epoll_fd);
+    }
+  }
+
+  SocketState* Get(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= sockets.size() ||
+        !sockets[fd].open) {
+      return nullptr;
+    }
+    return &sockets[fd];
+  }
+
+  SocketState& Track(int fd) {
+    if (static_cast<size_t>(fd) >= sockets.size()) {
+      sockets.resize(static_cast<size_t>(fd) + 64);
+    }
+    SocketState& state = sockets[fd];
+    uint32_t generation = state.generation + 1;
+    state = SocketState();
+    state.open = true;
+    state.generation = generation;
+    return state;
+  }
+
+  void Push(int fd, const SocketState& state, uint64_t token, IoOp op,
+            int error, uint32_t bytes) {
+    ready.push_back({fd, state.generation, {token, op, error, bytes}});
+  }
+
+  // 根据挂起的操作调整 epoll 关注的事件。没有挂起操作时从 epoll 移除，
+  // 避免对端关闭后 EPOLLHUP 持续触发。
+  void UpdateInterest(int fd, SocketState& state) {
+    uint32_t desired = 0;
+    if (state.connecting || state.sending) {
+      desired |= EPOLLOUT;
+    }
+    if (state.receiving) {
+      desired |= EPOLLIN;
+    }
+    if (desired == state.registered && (desired != 0) == state.in_epoll) {
+      return;
+    }
+    epoll_event event = {};
+    event.events = desired;
+    event.data.fd = fd;
+    if (desired == 0) {
+      if (state.in_epoll) {
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        state.in_epoll = false;
+      }
+    } else if (state.in_epoll) {
+      ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    } else {
+      ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+      state.in_epoll = true;
+    }
+    state.registered = desired;
+  }
+
+  // 尽可能写出剩余数据，返回 true 表示操作已结束（完成或出错）
+  bool ContinueSend(int fd, SocketState& state) {
+    while (state.send_offset < state.send_length) {
+      ssize_t written =
+          ::send(fd, state.send_data + state.send_offset,
+                 state.send_length - state.send_offset, MSG_NOSIGNAL);
+      if (written > 0) {
+        state.send_offset += static_cast<uint32_t>(written);
+        continue;
+      }
+      if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return false;
+      }
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      state.sending = false;
+      Push(fd, state, state.send_token, IoOp::kSend, written < 0 ? errno : EPIPE,
+           state.send_offset);
+      return true;
+    }
+    state.sending = false;
+    Push(fd, state, state.send_token, IoOp::kSend, 0, state.send_offset);
+    return true;
+  }
+
+  void HandleEpollEvent(const epoll_event& event) {
+    int fd = event.data.fd;
+    if (fd == wake_fd) {
+      uint64_t value;
+      ssize_t ignored = ::read(wake_fd, &value, sizeof(value));
+      (void)ignored;
+      return;
+    }
+    SocketState* state = Get(fd);
+    if (state == nullptr) {
+      return;
+    }
+    const uint32_t flags = event.events;
+    const bool failed = (flags & (EPOLLERR | EPOLLHUP)) != 0;
+
+    if (state->connecting && ((flags & EPOLLOUT) || failed)) {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0) {
+        error = errno;
+      }
+      state->connecting = false;
+      Push(fd, *state, state->connect_token, IoOp::kConnect, error, 0);
+    } else if (state->sending && ((flags & EPOLLOUT) || failed)) {
+      ContinueSend(fd, *state);
+    }
+
+    if (state->receiving && ((flags & EPOLLIN) || failed)) {
+      // TCP 上的 MSG_TRUNC 在内核中丢弃数据，只返回字节数
+      ssize_t received =
+          ::recv(fd, state->recv_buffer, state->recv_capacity,
+                 state->discarding ? MSG_TRUNC : 0);
+      if (received >= 0) {
+        state->receiving = false;
+        Push(fd, *state, state->recv_token, IoOp::kRecv, 0,
+             static_cast<uint32_t>(received));
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        state->receiving = false;
+        Push(fd, *state, state->recv_token, IoOp::kRecv, errno, 0);
+      }
+    }
+    UpdateInterest(fd, *state);
+  }
+};
+
+IoReactor::IoReactor() : impl_(new Impl()) {}
+
+IoReactor::~IoReactor() {}
+
+bool IoReactor::Open() {
+  if (impl_->epoll_fd >= 0) {
+    return true;
+  }
+  impl_->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (impl_->epoll_fd < 0) {
+    return false;
+  }
+  impl_->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (impl_->wake_fd < 0) {
+    return false;
+  }
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = impl_->wake_fd;
+  return ::epoll_ctl(impl_->epoll_fd, EPOLL_CTL_ADD, impl_->wake_fd, &event) == 0;
+}
+
+int IoReactor::StartConnect(const sockaddr* address, int address_length,
+                            uint64_t token, NativeSocket* out_socket) {
+  int fd = ::socket(address->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    0);
+  if (fd < 0) {
+    return errno;
+  }
+  int result = ::connect(fd, address, static_cast<socklen_t>(address_length));
+  if (result != 0 && errno != EINPROGRESS) {
+    int error = errno;
+    ::close(fd);
+    return error;
+  }
+  SocketState& state = impl_->Track(fd);
+  if (result == 0) {
+    impl_->Push(fd, state, token, IoOp::kConnect, 0, 0);
+  } else {
+    state.connecting = true;
+    state.connect_token = token;
+    impl_->UpdateInterest(fd, state);
+  }
+  *out_socket = fd;
+  return 0;
+}
+
+int IoReactor::StartSend(NativeSocket socket, const char* data, uint32_t length,
+                         uint64_t token) {
+  SocketState* state = impl_->Get(socket);
+  if (state == nullptr || state->sending || state->connecting) {
+    return EINVAL;
+  }
+  state->sending = true;
+  state->send_data = data;
+  state->send_length = length;
+  state->send_offset = 0;
+  state->send_token = token;
+  // 通常一次即可写完，省去一轮 epoll
+  impl_->ContinueSend(socket, *state);
+  impl_->UpdateInterest(socket, *state);
+  return 0;
+}
+
+int IoReactor::StartRecv(NativeSocket socket, char* buffer, uint32_t capacity,
+                         uint64_t token) {
+  SocketState* state = impl_->Get(socket);
+  if (state == nullptr || state->receiving) {
+    return EINVAL;
+  }
+  state->receiving = true;
+  state->discarding = false;
+  state->recv_buffer = buffer;
+  state->recv_capacity = capacity;
+  state->recv_token = token;
+  impl_->UpdateInterest(socket, *state);
+  return 0;
+}
+
+int IoReactor::StartDiscard(NativeSocket socket, uint32_t capacity,
+                            uint64_t token) {
+  SocketState* state = impl_->Get(socket);
+  if (state == nullptr || state->receiving) {
+    return EINVAL;
+  }
+  state->receiving = true;
+  state->discarding = true;
+  state->recv_buffer = nullptr;
+  state->recv_capacity = capacity;
+  state->recv_token = token;
+  impl_->UpdateInterest(socket, *state);
+  return 0;
+}
+
+void IoReactor::Close(NativeSocket socket, bool abortive) {
+  SocketState* state = impl_->Get(socket);
+  if (state == nullptr) {
+    return;
+  }
+  if (state->in_epoll) {
+    ::epoll_ctl(impl_->epoll_fd, EPOLL_CTL_DEL, socket, nullptr);
+  }
+  uint32_t generation = state->generation;
+  *state = SocketState();
+  // 保留代数，使队列中该套接字的旧事件失效
+  state->generation = generation + 1;
+  CloseSocket(socket, abortive);
+}
+
+int IoReactor::Wait(IoEvent* events, int max_events, int timeout_ms) {
+  if (impl_->ready.empty()) {
+    int count = ::epoll_wait(impl_->epoll_fd, impl_->epoll_events,
+                             kMaxEpollEvents, timeout_ms);
+    for (int i = 0; i < count; ++i) {
+      impl_->HandleEpollEvent(impl_->epoll_events[i]);
+    }
+  }
+
+  int delivered = 0;
+  while (delivered < max_events && !impl_->ready.empty()) {
+    const ReadyEvent& ready = impl_->ready.front();
+    if (static_cast<size_t>(ready.fd) < impl_->sockets.size() &&
+        impl_->sockets[ready.fd].generation == ready.generation) {
+      events[delivered++] = ready.event;
+    }
+    impl_->ready.pop_front();
+  }
+  return delivered;
+}
+
+void IoReactor::Wakeup() {
+  uint64_t value = 1;
+  ssize_t ignored = ::write(impl_->wake_fd, &value, sizeof(value));
+  (void)ignored;
+}
+
+}  // namespace cfvpn
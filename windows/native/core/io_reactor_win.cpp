@@ -0,0 +1,369 @@
+#include "core/io_reactor.h"
+
+#include <mswsock.h>
+#include <windows.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace cfvpn {
+
+namespace {
+
+// 单次 GetQueuedCompletionStatusEx 最多取回的完成包
+constexpr ULONG kMaxCompletionEntries = 512;
+
+// 唤醒 Wait() 用的完成键
+constexpr ULONG_PTR kWakeupKey = 1;
+
+// StartDiscard 共用的暂存缓冲区大小，单次丢弃的上限
+constexpr uint32_t kDiscardBufferSize = 256 * 1024;
+
+struct SocketOps;
+
+// 一次重叠操作。OVERLAPPED 必须位于首位，并且在完成包到达前保持有效，
+// 即使套接字已被关闭（此时会收到 ERROR_OPERATION_ABORTED）。
+struct Operation {
+  OVERLAPPED overlapped;
+  SocketOps* owner;
+  IoOp op;
+  uint64_t token;
+  WSABUF buffer;
+  uint32_t total;
+  uint32_t done;
+  bool pending;
+};
+
+// 套接字上的三类操作。关闭后从表中移到 closing，要等所有挂起操作的
+// 完成包都到达后才释放。
+struct SocketOps {
+  SOCKET socket = INVALID_SOCKET;
+  bool closed = false;
+  int outstanding = 0;
+  Operation connect = {};
+  Operation send = {};
+  Operation recv = {};
+};
+
+// 已完成但尚未交给调用方的事件
+struct ReadyEvent {
+  SocketOps* owner;
+  IoEvent event;
+};
+
+}  // namespace
+
+struct IoReactor::Impl {
+  HANDLE iocp = nullptr;
+  LPFN_CONNECTEX connect_ex = nullptr;
+  std::unordered_map<SOCKET, SocketOps*> sockets;
+  // 已关闭但仍有挂起操作的套接字，最后一个完成包到达时释放
+  std::unordered_set<SocketOps*> closing;
+  std::deque<ReadyEvent> ready;
+  OVERLAPPED_ENTRY entries[kMaxCompletionEntries];
+  // 多个重叠接收可以同时写入，内容不会被读取
+  std::vector<char> discard_buffer;
+
+  ~Impl() {
+    for (auto& pair : sockets) {
+      CloseSocket(pair.first, true);
+      Retire(pair.second);
+    }
+    sockets.clear();
+    // 关闭套接字后排空已取消操作的完成包，再释放其内存
+    while (!closing.empty()) {
+      ULONG removed = 0;
+      if (!::GetQueuedCompletionStatusEx(iocp, entries, kMaxCompletionEntries,
+                                         &removed, 100, FALSE)) {
+        break;
+      }
+      for (ULONG i = 0; i < removed; ++i) {
+        Complete(entries[i]);
+      }
+    }
+    if (iocp != nullptr) {
+      ::CloseHandle(iocp);
+    }
+    // 等待超时仍未到达的完成包不会再投递到已关闭的完成端口
+    for (SocketOps* owner : closing) {
+      delete owner;
+    }
+  }
+
+  // 标记为已关闭：没有挂起操作时立即释放，否则等完成包
+  void Retire(SocketOps* owner) {
+    owner->closed = true;
+    if (owner->outstanding == 0) {
+      delete owner;
+    } else {
+      closing.insert(owner);
+    }
+  }
+
+  SocketOps* Get(SOCKET socket) {
+    auto it = sockets.find(socket);
+    if (it == sockets.end() || it->second->closed) {
+      return nullptr;
+    }
+    return it->second;
+  }
+
+  void Prepare(SocketOps* owner, Operation* operation, IoOp op, uint64_t token) {
+    std::memset(&operation->overlapped, 0, sizeof(operation->overlapped));
+    operation->owner = owner;
+    operation->op = op;
+    operation->token = token;
+    operation->total = 0;
+    operation->done = 0;
+    operation->pending = true;
+    owner->outstanding++;
+  }
+
+  // 提交（或继续提交）WSASend，直到整个缓冲区写完
+  int IssueSend(SocketOps* owner) {
+    Operation* operation = &owner->send;
+    std::memset(&operation->overlapped, 0, sizeof(operation->overlapped));
+    WSABUF buffer;
+    buffer.buf = operation->buffer.buf + operation->done;
+    buffer.len = operation->total - operation->done;
+    if (::WSASend(owner->socket, &buffer, 1, nullptr, 0,
+                  &operation->overlapped, nullptr) != 0) {
+      int error = ::WSAGetLastError();
+      if (error != WSA_IO_PENDING) {
+        return error;
+      }
+    }
+    return 0;
+  }
+
+  void Finish(Operation* operation, int error, uint32_t bytes) {
+    operation->pending = false;
+    if (!operation->owner->closed) {
+      ready.push_back(
+          {operation->owner, {operation->token, operation->op, error, bytes}});
+    }
+  }
+
+  void Complete(const OVERLAPPED_ENTRY& entry) {
+    if (entry.lpCompletionKey == kWakeupKey || entry.lpOverlapped == nullptr) {
+      return;
+    }
+    Operation* operation = reinterpret_cast<Operation*>(entry.lpOverlapped);
+    SocketOps* owner = operation->owner;
+
+    if (owner->closed) {
+      operation->pending = false;
+      if (--owner->outstanding == 0) {
+        closing.erase(owner);
+        delete owner;
+      }
+      return;
+    }
+
+    DWORD bytes = 0;
+    DWORD flags = 0;
+    int error = 0;
+    if (!::WSAGetOverlappedResult(owner->socket, &operation->overlapped, &bytes,
+                                  FALSE, &flags)) {
+      error = ::WSAGetLastError();
+    }
+
+    switch (operation->op) {
+      case IoOp::kConnect:
+        if (error == 0) {
+          // 使 getpeername/shutdown 等在 ConnectEx 套接字上可用
+          ::setsockopt(owner->socket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT,
+                       nullptr, 0);
+        }
+        owner->outstanding--;
+        Finish(operation, error, 0);
+        break;
+      case IoOp::kSend:
+        if (error == 0 && bytes > 0) {
+          operation->done += bytes;
+          if (operation->done < operation->total) {
+            error = IssueSend(owner);
+            if (error == 0) {
+              return;
+            }
+          }
+        } else if (error == 0) {
+          error = WSAECONNRESET;
+        }
+        owner->outstanding--;
+        Finish(operation, error, operation->done);
+        break;
+      case IoOp::kRecv:
+        owner->outstanding--;
+        Finish(operation, error, bytes);
+        break;
+    }
+  }
+};
+
+IoReactor::IoReactor() : impl_(new Impl()) {}
+
+IoReactor::~IoReactor() {}
+
+bool IoReactor::Open() {
+  if (impl_->iocp != nullptr) {
+    return true;
+  }
+  if (!InitSocketLibrary()) {
+    return false;
+  }
+  impl_->iocp = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+  if (impl_->iocp == nullptr) {
+    return false;
+  }
+  // ConnectEx 需要通过 WSAIoctl 动态获取
+  SOCKET probe = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (probe == INVALID_SOCKET) {
+    return false;
+  }
+  GUID guid = WSAID_CONNECTEX;
+  DWORD bytes = 0;
+  int result = ::WSAIoctl(probe, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid,
+                          sizeof(guid), &impl_->connect_ex,
+                          sizeof(impl_->connect_ex), &bytes, nullptr, nullptr);
+  ::closesocket(probe);
+  return result == 0 && impl_->connect_ex != nullptr;
+}
+
+int IoReactor::StartConnect(const sockaddr* address, int address_length,
+                            uint64_t token, NativeSocket* out_socket) {
+  SOCKET socket = ::WSASocketW(address->sa_family, SOCK_STREAM, IPPROTO_TCP,
+                               nullptr, 0, WSA_FLAG_OVERLAPPED);
+  if (socket == INVALID_SOCKET) {
+    return ::WSAGetLastError();
+  }
+
+  // ConnectEx 要求套接字已绑定
+  sockaddr_storage local = {};
+  local.ss_family = address->sa_family;
+  int local_length = static_cast<int>(address->sa_family == AF_INET6
+                                          ? sizeof(sockaddr_in6)
+                                          : sizeof(sockaddr_in));
+  if (::bind(socket, reinterpret_cast<sockaddr*>(&local), local_length) != 0 ||
+      ::CreateIoCompletionPort(reinterpret_cast<HANDLE>(socket), impl_->iocp, 0,
+                               0) == nullptr) {
+    int error = ::WSAGetLastError();
+    ::closesocket(socket);
+    return error;
+  }
+
+  SocketOps* owner = new SocketOps();
+  owner->socket = socket;
+  impl_->Prepare(owner, &owner->connect, IoOp::kConnect, token);
+  if (!impl_->connect_ex(socket, address, address_length, nullptr, 0, nullptr,
+                         &owner->connect.overlapped)) {
+    int error = ::WSAGetLastError();
+    if (error != ERROR_IO_PENDING) {
+      ::closesocket(socket);
+      delete owner;
+      return error;
+    }
+  }
+  impl_->sockets[socket] = owner;
+  *out_socket = socket;
+  return 0;
+}
+
+int IoReactor::StartSend(NativeSocket socket, const char* data, uint32_t length,
+                         uint64_t token) {
+  SocketOps* owner = impl_->Get(socket);
+  if (owner == nullptr || owner->send.pending) {
+    return WSAEINVAL;
+  }
+  impl_->Prepare(owner, &owner->send, IoOp::kSend, token);
+  owner->send.buffer.buf = const_cast<char*>(data);
+  owner->send.buffer.len = length;
+  owner->send.total = length;
+  int error = impl_->IssueSend(owner);
+  if (error != 0) {
+    owner->outstanding--;
+    impl_->Finish(&owner->send, error, 0);
+  }
+  return 0;
+}
+
+int IoReactor::StartRecv(NativeSocket socket, char* buffer, uint32_t capacity,
+                         uint64_t token) {
+  SocketOps* owner = impl_->Get(socket);
+  if (owner == nullptr || owner->recv.pending) {
+    return WSAEINVAL;
+  }
+  impl_->Prepare(owner, &owner->recv, IoOp::kRecv, token);
+  owner->recv.buffer.buf = buffer;
+  owner->recv.buffer.len = capacity;
+  DWORD flags = 0;
+  if (::WSARecv(socket, &owner->recv.buffer, 1, nullptr, &flags,
+                &owner->recv.overlapped, nullptr) != 0) {
+    int error = ::WSAGetLastError();
+    if (error != WSA_IO_PENDING) {
+      owner->outstanding--;
+      impl_->Finish(&owner->recv, error, 0);
+    }
+  }
+  return 0;
+}
+
+int IoReactor::StartDiscard(NativeSocket socket, uint32_t capacity,
+                            uint64_t token) {
+  // IOCP 没有 MSG_TRUNC，接收到共用缓冲区后忽略内容
+  if (impl_->discard_buffer.empty()) {
+    impl_->discard_buffer.resize(kDiscardBufferSize);
+  }
+  return StartRecv(socket, impl_->discard_buffer.data(),
+                   std::min(capacity, kDiscardBufferSize), token);
+}
+
+void IoReactor::Close(NativeSocket socket, bool abortive) {
+  auto it = impl_->sockets.find(socket);
+  if (it == impl_->sockets.end() || it->second->closed) {
+    return;
+  }
+  SocketOps* owner = it->second;
+  impl_->sockets.erase(it);
+  // 丢弃已排队但尚未交付的事件
+  for (auto ready = impl_->ready.begin(); ready != impl_->ready.end();) {
+    if (ready->owner == owner) {
+      ready = impl_->ready.erase(ready);
+    } else {
+      ++ready;
+    }
+  }
+  CloseSocket(socket, abortive);
+  impl_->Retire(owner);
+}
+
+int IoReactor::Wait(IoEvent* events, int max_events, int timeout_ms) {
+  if (impl_->ready.empty()) {
+    ULONG removed = 0;
+    DWORD timeout = timeout_ms < 0 ? INFINITE : static_cast<DWORD>(timeout_ms);
+    if (::GetQueuedCompletionStatusEx(impl_->iocp, impl_->entries,
+                                      kMaxCompletionEntries, &removed, timeout,
+                                      FALSE)) {
+      for (ULONG i = 0; i < removed; ++i) {
+        impl_->Complete(impl_->entries[i]);
+      }
+    }
+  }
+
+  int delivered = 0;
+  while (delivered < max_events && !impl_->ready.empty()) {
+    events[delivered++] = impl_->ready.front().event;
+    impl_->ready.pop_front();
+  }
+  return delivered;
+}
+
+void IoReactor::Wakeup() {
+  ::PostQueuedCompletionStatus(impl_->iocp, 0, kWakeupKey, nullptr);
+}
+
+}  // namespace cfvpn
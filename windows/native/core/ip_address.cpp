@@ -0,0 +1,285 @@
+#include "core/ip_address.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+namespace {
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool ParseIpv6(std::string_view text, Uint128* out) {
+  uint16_t groups[8] = {};
+  int count = 0;
+  int gap = -1;  // "::" 出现的位置（其后的组号）
+  size_t pos = 0;
+  if (text.size() >= 2 && text[0] == ':' && text[1] == ':') {
+    gap = 0;
+    pos = 2;
+  } else if (!text.empty() && text[0] == ':') {
+    return false;
+  }
+  while (pos < text.size()) {
+    if (count == 8) return false;
+    // 末尾内嵌的 IPv4（如 ::ffff:1.2.3.4）
+    const size_t next_colon = text.find(':', pos);
+    const std::string_view part = text.substr(
+        pos, next_colon == std::string_view::npos ? text.size() - pos
+                                                  : next_colon - pos);
+    if (next_colon == std::string_view::npos &&
+        part.find('.') != std::string_view::npos) {
+      if (count > 6) return false;
+      uint32_t ip = 0;
+      const std::string copy(part);
+      if (!ParseIpv4(copy.c_str(), &ip)) return false;
+      groups[count++] = static_cast<uint16_t>(ip >> 16);
+      groups[count++] = static_cast<uint16_t>(ip);
+      pos = text.size();
+      break;
+    }
+    if (part.empty() || part.size() > 4) return false;
+    uint32_t group = 0;
+    for (char c : part) {
+      const int digit = HexValue(c);
+      if (digit < 0) return false;
+      group = group << 4 | static_cast<uint32_t>(digit);
+    }
+    groups[count++] = static_cast<uint16_t>(group);
+    pos += part.size();
+    if (pos == text.size()) break;
+    ++pos;  // ':'
+    if (pos < text.size() && text[pos] == ':') {
+      if (gap >= 0) return false;
+      gap = count;
+      ++pos;
+    } else if (pos == text.size()) {
+      return false;  // 以单个 ':' 结尾
+    }
+  }
+  if (gap < 0 && count != 8) return false;
+  if (gap >= 0 && count == 8) return false;
+
+  uint16_t full[8] = {};
+  if (gap < 0) {
+    std::memcpy(full, groups, sizeof(full));
+  } else {
+    const int tail = count - gap;
+    for (int i = 0; i < gap; ++i) full[i] = groups[i];
+    for (int i = 0; i < tail; ++i) full[8 - tail + i] = groups[gap + i];
+  }
+  Uint128 value;
+  for (int i = 0; i < 4; ++i) value.hi = value.hi << 16 | full[i];
+  for (int i = 4; i < 8; ++i) value.lo = value.lo << 16 | full[i];
+  *out = value;
+  return true;
+}
+
+bool IsSeparator(char c) {
+  return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+}  // namespace
+
+Uint128 Uint128::operator<<(int shift) const {
+  if (shift <= 0) return *this;
+  if (shift >= 128) return Uint128();
+  if (shift >= 64) return Make(lo << (shift - 64), 0);
+  return Make(hi << shift | lo >> (64 - shift), lo << shift);
+}
+
+Uint128 Uint128::operator>>(int shift) const {
+  if (shift <= 0) return *this;
+  if (shift >= 128) return Uint128();
+  if (shift >= 64) return Make(0, hi >> (shift - 64));
+  return Make(hi >> shift, lo >> shift | hi << (64 - shift));
+}
+
+Uint128 Uint128::LowMask(int bits) {
+  if (bits <= 0) return Uint128();
+  if (bits >= 128) return Make(~0ull, ~0ull);
+  if (bits >= 64) {
+    return Make(bits == 64 ? 0 : (~0ull >> (128 - bits)), ~0ull);
+  }
+  return Make(0, ~0ull >> (64 - bits));
+}
+
+int Uint128::BitWidth() const {
+  int width = 0;
+  uint64_t word = hi;
+  if (hi != 0) {
+    width = 64;
+  } else {
+    word = lo;
+  }
+  while (word != 0) {
+    ++width;
+    word >>= 1;
+  }
+  return width;
+}
+
+Uint128 IpPrefix::size() const {
+  const int host_bits = base.bits() - length;
+  if (host_bits >= 128) return Uint128::LowMask(128);
+  return Uint128::Make(0, 1) << host_bits;
+}
+
+bool IpPrefix::Contains(const IpAddress& address) const {
+  if (address.v6 != base.v6) return false;
+  const Uint128 host_mask = Uint128::LowMask(base.bits() - length);
+  return (address.value | host_mask) == (base.value | host_mask);
+}
+
+bool ParseIpAddress(std::string_view text, IpAddress* out) {
+  IpAddress address;
+  if (text.find(':') != std::string_view::npos) {
+    address.v6 = true;
+    if (!ParseIpv6(text, &address.value)) return false;
+  } else {
+    uint32_t ip = 0;
+    const std::string copy(text);
+    if (!ParseIpv4(copy.c_str(), &ip)) return false;
+    address = IpAddress::V4(ip);
+  }
+  *out = address;
+  return true;
+}
+
+bool ParseIpPrefix(std::string_view text, IpPrefix* out) {
+  const size_t slash = text.find('/');
+  IpPrefix prefix;
+  if (!ParseIpAddress(text.substr(0, slash), &prefix.base)) return false;
+  prefix.length = prefix.base.bits();
+  if (slash != std::string_view::npos) {
+    const std::string_view digits = text.substr(slash + 1);
+    if (digits.empty() || digits.size() > 3) return false;
+    int length = 0;
+    for (char c : digits) {
+      if (c < '0' || c > '9') return false;
+      length = length * 10 + (c - '0');
+    }
+    if (length > prefix.base.bits()) return false;
+    prefix.length = length;
+  }
+  const Uint128 host_mask =
+      Uint128::LowMask(prefix.base.bits() - prefix.length);
+  prefix.base.value = prefix.base.value & Uint128::Make(~host_mask.hi,
+                                                        ~host_mask.lo);
+  *out = prefix;
+  return true;
+}
+
+size_t ParseIpPrefixList(std::string_view text, std::vector<IpPrefix>* out) {
+  size_t invalid = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    while (pos < text.size() && IsSeparator(text[pos])) ++pos;
+    size_t end = pos;
+    while (end < text.size() && !IsSeparator(text[end])) ++end;
+    if (end > pos) {
+      IpPrefix prefix;
+      if (ParseIpPrefix(text.substr(pos, end - pos), &prefix)) {
+        out->push_back(prefix);
+      } else {
+        ++invalid;
+      }
+    }
+    pos = end;
+  }
+  return invalid;
+}
+
+std::string FormatIpAddress(const IpAddress& address) {
+  if (!address.v6) return FormatIpv4(address.v4());
+  uint16_t groups[8];
+  for (int i = 0; i < 4; ++i) {
+    groups[i] = static_cast<uint16_t>(address.value.hi >> (48 - 16 * i));
+    groups[4 + i] = static_cast<uint16_t>(address.value.lo >> (48 - 16 * i));
+  }
+  // 最长的连续零组（至少两组）压缩为 "::"，相同长度取第一个
+  int best_start = -1;
+  int best_length = 1;
+  for (int i = 0; i < 8;) {
+    if (groups[i] != 0) {
+      ++i;
+      continue;
+    }
+    int j = i;
+    while (j < 8 && groups[j] == 0) ++j;
+    if (j - i > best_length) {
+      best_start = i;
+      best_length = j - i;
+    }
+    i = j;
+  }
+  std::string out;
+  char group[8];
+  for (int i = 0; i < 8; ++i) {
+    if (i == best_start) {
+      out += "::";
+      i += best_length - 1;
+      continue;
+    }
+    if (!out.empty() && out.back() != ':') out.push_back(':');
+    std::snprintf(group, sizeof(group), "%x", groups[i]);
+    out += group;
+  }
+  return out;
+}
+
+int IpAddressBytes(const IpAddress& address, uint8_t* out) {
+  if (!address.v6) {
+    const uint32_t ip = address.v4();
+    for (int i = 0; i < 4; ++i) {
+      out[i] = static_cast<uint8_t>(ip >> (24 - 8 * i));
+    }
+    return 4;
+  }
+  for (int i = 0; i < 8; ++i) {
+    out[i] = static_cast<uint8_t>(address.value.hi >> (56 - 8 * i));
+    out[8 + i] = static_cast<uint8_t>(address.value.lo >> (56 - 8 * i));
+  }
+  return 16;
+}
+
+IpAddress IpAddressFromBytes(const uint8_t* bytes, bool v6) {
+  IpAddress address;
+  if (!v6) {
+    uint32_t ip = 0;
+    for (int i = 0; i < 4; ++i) ip = ip << 8 | bytes[i];
+    return IpAddress::V4(ip);
+  }
+  address.v6 = true;
+  for (int i = 0; i < 8; ++i) {
+    address.value.hi = address.value.hi << 8 | bytes[i];
+    address.value.lo = address.value.lo << 8 | bytes[8 + i];
+  }
+  return address;
+}
+
+int MakeSockaddr(const IpAddress& address, uint16_t port,
+                 sockaddr_storage* out) {
+  std::memset(out, 0, sizeof(*out));
+  if (!address.v6) {
+    const sockaddr_in v4 = MakeSockaddrV4(address.v4(), port);
+    std::memcpy(out, &v4, sizeof(v4));
+    return static_cast<int>(sizeof(v4));
+  }
+  sockaddr_in6 v6;
+  std::memset(&v6, 0, sizeof(v6));
+  v6.sin6_family = AF_INET6;
+  v6.sin6_port = htons(port);
+  IpAddressBytes(address, reinterpret_cast<uint8_t*>(&v6.sin6_addr));
+  std::memcpy(out, &v6, sizeof(v6));
+  return static_cast<int>(sizeof(v6));
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,112 @@
+#ifndef NATIVE_CORE_IP_ADDRESS_H_
+#define NATIVE_CORE_IP_ADDRESS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 只在 MakeSockaddr 中用到，避免在头文件里引入平台套接字头
+struct sockaddr_storage;
+
+namespace cfvpn {
+
+// 可移植的 128 位无符号整数（MSVC 没有 __int128），只实现地址运算
+// 需要的操作。
+struct Uint128 {
+  uint64_t hi = 0;
+  uint64_t lo = 0;
+
+  static constexpr Uint128 Make(uint64_t hi, uint64_t lo) {
+    Uint128 value;
+    value.hi = hi;
+    value.lo = lo;
+    return value;
+  }
+
+  bool operator==(const Uint128& other) const {
+    return hi == other.hi && lo == other.lo;
+  }
+  bool operator!=(const Uint128& other) const { return !(*this == other); }
+  bool operator<(const Uint128& other) const {
+    return hi != other.hi ? hi < other.hi : lo < other.lo;
+  }
+  bool operator<=(const Uint128& other) const { return !(other < *this); }
+
+  Uint128 operator+(const Uint128& other) const {
+    const uint64_t low = lo + other.lo;
+    return Make(hi + other.hi + (low < lo ? 1 : 0), low);
+  }
+  Uint128 operator-(const Uint128& other) const {
+    return Make(hi - other.hi - (lo < other.lo ? 1 : 0), lo - other.lo);
+  }
+  Uint128 operator<<(int shift) const;
+  Uint128 operator>>(int shift) const;
+  Uint128 operator|(const Uint128& other) const {
+    return Make(hi | other.hi, lo | other.lo);
+  }
+  Uint128 operator&(const Uint128& other) const {
+    return Make(hi & other.hi, lo & other.lo);
+  }
+
+  // 低 bits 位为 1 的掩码，bits 取 0..128
+  static Uint128 LowMask(int bits);
+  // 表示 value 至少需要的位数（0 的位数为 0）
+  int BitWidth() const;
+};
+
+// IPv4 或 IPv6 地址。IPv4 保存在 value 的低 32 位。
+struct IpAddress {
+  Uint128 value;
+  bool v6 = false;
+
+  static IpAddress V4(uint32_t ip) {
+    IpAddress address;
+    address.value.lo = ip;
+    return address;
+  }
+
+  int bits() const { return v6 ? 128 : 32; }
+  uint32_t v4() const { return static_cast<uint32_t>(value.lo); }
+
+  bool operator==(const IpAddress& other) const {
+    return v6 == other.v6 && value == other.value;
+  }
+  bool operator!=(const IpAddress& other) const { return !(*this == other); }
+};
+
+// 前缀 base/length，base 的主机位为 0
+struct IpPrefix {
+  IpAddress base;
+  int length = 0;
+
+  // 前缀内的地址数（/0 的 IPv6 为 2^128，无法表示，按 2^128 - 1 计）
+  Uint128 size() const;
+  bool Contains(const IpAddress& address) const;
+};
+
+// 解析点分十进制 IPv4 或 RFC 4291 文本形式的 IPv6（支持 :: 压缩和
+// 末尾内嵌 IPv4，不支持 %zone）
+bool ParseIpAddress(std::string_view text, IpAddress* out);
+
+// 解析 "地址/长度" 或单个地址。主机位不为零时按网络地址对齐。
+bool ParseIpPrefix(std::string_view text, IpPrefix* out);
+
+// 解析以逗号、空白或换行分隔的前缀列表，追加到 out，返回无效项的数量
+size_t ParseIpPrefixList(std::string_view text, std::vector<IpPrefix>* out);
+
+// IPv4 为点分十进制，IPv6 为 RFC 5952 推荐的压缩形式
+std::string FormatIpAddress(const IpAddress& address);
+
+// 网络字节序的原始字节，IPv4 写 4 字节，IPv6 写 16 字节，返回字节数
+int IpAddressBytes(const IpAddress& address, uint8_t* out);
+IpAddress IpAddressFromBytes(const uint8_t* bytes, bool v6);
+
+// 构造 sockaddr_in 或 sockaddr_in6，返回地址结构的长度
+int MakeSockaddr(const IpAddress& address, uint16_t port,
+                 sockaddr_storage* out);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_IP_ADDRESS_H_
@@ -0,0 +1,358 @@
+#include "core/json.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace cfvpn {
+
+namespace {
+
+constexpr int kMaxDepth = 64;
+
+class Parser {
+ public:
+  explicit Parser(std::string_view text) : text_(text) {}
+
+  bool Parse(JsonValue* out, std::string* error) {
+    bool ok = SkipSpace() && ParseValue(out, 0) && SkipSpace();
+    if (ok && pos_ != text_.size()) ok = Fail("多余的内容");
+    if (!ok && error != nullptr) {
+      *error = error_ + "（偏移 " + std::to_string(pos_) + "）";
+    }
+    return ok;
+  }
+
+ private:
+  bool Fail(const char* message) {
+    if (error_.empty()) error_ = message;
+    return false;
+  }
+
+  // 跳过空白和注释；注释未闭合时返回 false
+  bool SkipSpace() {
+    while (pos_ < text_.size()) {
+      const char c = text_[pos_];
+      if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        ++pos_;
+      } else if (c == '/' && pos_ + 1 < text_.size() && text_[pos_ + 1] == '/') {
+        const size_t end = text_.find('\n', pos_);
+        pos_ = end == std::string_view::npos ? text_.size() : end + 1;
+      } else if (c == '/' && pos_ + 1 < text_.size() && text_[pos_ + 1] == '*') {
+        const size_t end = text_.find("*/", pos_ + 2);
+        if (end == std::string_view::npos) return Fail("注释未闭合");
+        pos_ = end + 2;
+      } else {
+        break;
+      }
+    }
+    return true;
+  }
+
+  bool Consume(std::string_view literal) {
+    if (text_.substr(pos_, literal.size()) != literal) return false;
+    pos_ += literal.size();
+    return true;
+  }
+
+  bool ParseValue(JsonValue* out, int depth) {
+    if (depth > kMaxDepth) return Fail("嵌套过深");
+    if (pos_ >= text_.size()) return Fail("意外的结尾");
+    *out = JsonValue();
+    const char c = text_[pos_];
+    if (c == '{') return ParseObject(out, depth);
+    if (c == '[') return ParseArray(out, depth);
+    if (c == '"') {
+      out->type = JsonValue::Type::kString;
+      return ParseString(&out->text);
+    }
+    if (Consume("true")) {
+      out->type = JsonValue::Type::kBool;
+      out->boolean = true;
+      return true;
+    }
+    if (Consume("false")) {
+      out->type = JsonValue::Type::kBool;
+      return true;
+    }
+    if (Consume("null")) return true;
+    return ParseNumber(out);
+  }
+
+  bool ParseObject(JsonValue* out, int depth) {
+    out->type = JsonValue::Type::kObject;
+    ++pos_;
+    for (;;) {
+      if (!SkipSpace()) return false;
+      if (pos_ < text_.size() && text_[pos_] == '}') {
+        ++pos_;
+        return true;
+      }
+      if (pos_ >= text_.size() || text_[pos_] != '"') {
+        return Fail("应为成员名");
+      }
+      out->members.emplace_back();
+      auto& member = out->members.back();
+      if (!ParseString(&member.first) || !SkipSpace()) return false;
+      if (pos_ >= text_.size() || text_[pos_] != ':') return Fail("应为 ':'");
+      ++pos_;
+      if (!SkipSpace() || !ParseValue(&member.second, depth + 1) ||
+          !SkipSpace()) {
+        return false;
+      }
+      if (pos_ < text_.size() && text_[pos_] == ',') {
+        ++pos_;
+      } else if (pos_ >= text_.size() || text_[pos_] != '}') {
+        return Fail("应为 ',' 或 '}'");
+      }
+    }
+  }
+
+  bool ParseArray(JsonValue* out, int depth) {
+    out->type = JsonValue::Type::kArray;
+    ++pos_;
+    for (;;) {
+      if (!SkipSpace()) return false;
+      if (pos_ < text_.size() && text_[pos_] == ']') {
+        ++pos_;
+        return true;
+      }
+      out->items.emplace_back();
+      if (!ParseValue(&out->items.back(), depth + 1) || !SkipSpace()) {
+        return false;
+      }
+      if (pos_ < text_.size() && text_[pos_] == ',') {
+        ++pos_;
+      } else if (pos_ >= text_.size() || text_[pos_] != ']') {
+        return Fail("应为 ',' 或 ']'");
+      }
+    }
+  }
+
+  bool ParseHex4(uint32_t* value) {
+    if (text_.size() - pos_ < 4) return Fail("\\u 转义不完整");
+    *value = 0;
+    for (int i = 0; i < 4; ++i) {
+      const char c = text_[pos_++];
+      uint32_t digit;
+      if (c >= '0' && c <= '9') {
+        digit = static_cast<uint32_t>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        digit = static_cast<uint32_t>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        digit = static_cast<uint32_t>(c - 'A' + 10);
+      } else {
+        return Fail("\\u 转义无效");
+      }
+      *value = *value << 4 | digit;
+    }
+    return true;
+  }
+
+  static void AppendUtf8(uint32_t code, std::string* out) {
+    if (code < 0x80) {
+      out->push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+      out->push_back(static_cast<char>(0xC0 | code >> 6));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      out->push_back(static_cast<char>(0xE0 | code >> 12));
+      out->push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+      out->push_back(static_cast<char>(0xF0 | code >> 18));
+      out->push_back(static_cast<char>(0x80 | (code >> 12 & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+  }
+
+  bool ParseString(std::string* out) {
+    ++pos_;  // 开头的引号
+    out->clear();
+    for (;;) {
+      // 批量复制不需要转义的部分
+      size_t end = pos_;
+      while (end < text_.size() && text_[end] != '"' && text_[end] != '\\' &&
+             static_cast<unsigned char>(text_[end]) >= 0x20) {
+        ++end;
+      }
+      out->append(text_.data() + pos_, end - pos_);
+      pos_ = end;
+      if (pos_ >= text_.size()) return Fail("字符串未闭合");
+      const char c = text_[pos_++];
+      if (c == '"') return true;
+      if (c != '\\') return Fail("字符串中有控制字符");
+      if (pos_ >= text_.size()) return Fail("字符串未闭合");
+      switch (text_[pos_++]) {
+        case '"': out->push_back('"'); break;
+        case '\\': out->push_back('\\'); break;
+        case '/': out->push_back('/'); break;
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'n': out->push_back('\n'); break;
+        case 'r': out->push_back('\r'); break;
+        case 't': out->push_back('\t'); break;
+        case 'u': {
+          uint32_t code;
+          if (!ParseHex4(&code)) return false;
+          // 代理对合并为一个码点；落单的代理项按 U+FFFD 处理
+          if (code >= 0xD800 && code < 0xDC00 && Consume("\\u")) {
+            uint32_t low;
+            if (!ParseHex4(&low)) return false;
+            code = low >= 0xDC00 && low < 0xE000
+                       ? 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00)
+                       : 0xFFFD;
+          } else if (code >= 0xD800 && code < 0xE000) {
+            code = 0xFFFD;
+          }
+          AppendUtf8(code, out);
+          break;
+        }
+        default:
+          return Fail("无效的转义");
+      }
+    }
+  }
+
+  bool ParseNumber(JsonValue* out) {
+    const size_t start = pos_;
+    auto digits = [this] {
+      const size_t begin = pos_;
+      while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+        ++pos_;
+      }
+      return pos_ > begin;
+    };
+    if (pos_ < text_.size() && text_[pos_] == '-') ++pos_;
+    if (!digits()) return Fail("无效的值");
+    if (pos_ < text_.size() && text_[pos_] == '.') {
+      ++pos_;
+      if (!digits()) return Fail("无效的数字");
+    }
+    if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+      ++pos_;
+      if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) {
+        ++pos_;
+      }
+      if (!digits()) return Fail("无效的数字");
+    }
+    out->type = JsonValue::Type::kNumber;
+    out->text.assign(text_.data() + start, pos_ - start);
+    return true;
+  }
+
+  std::string_view text_;
+  size_t pos_ = 0;
+  std::string error_;
+};
+
+}  // namespace
+
+JsonValue JsonValue::String(std::string_view value) {
+  JsonValue result;
+  result.type = Type::kString;
+  result.text.assign(value.data(), value.size());
+  return result;
+}
+
+JsonValue JsonValue::Number(int64_t value) {
+  JsonValue result;
+  result.type = Type::kNumber;
+  result.text = std::to_string(value);
+  return result;
+}
+
+JsonValue* JsonValue::Find(std::string_view key) {
+  if (type != Type::kObject) return nullptr;
+  for (auto& member : members) {
+    if (member.first == key) return &member.second;
+  }
+  return nullptr;
+}
+
+const JsonValue* JsonValue::Find(std::string_view key) const {
+  return const_cast<JsonValue*>(this)->Find(key);
+}
+
+JsonValue& JsonValue::Member(std::string_view key) {
+  if (JsonValue* value = Find(key)) return *value;
+  members.emplace_back(std::string(key), JsonValue());
+  return members.back().second;
+}
+
+int64_t JsonValue::AsInt(int64_t fallback) const {
+  if (type != Type::kNumber) return fallback;
+  char* end = nullptr;
+  const long long value = std::strtoll(text.c_str(), &end, 10);
+  return end != nullptr && *end == '\0' ? value : fallback;
+}
+
+bool ParseJson(std::string_view text, JsonValue* out, std::string* error) {
+  return Parser(text).Parse(out, error);
+}
+
+void AppendJsonString(std::string_view value, std::string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  out->push_back('"');
+  size_t start = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    const unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out->append(value.data() + start, i - start);
+    start = i + 1;
+    out->push_back('\\');
+    switch (c) {
+      case '"': out->push_back('"'); break;
+      case '\\': out->push_back('\\'); break;
+      case '\b': out->push_back('b'); break;
+      case '\f': out->push_back('f'); break;
+      case '\n': out->push_back('n'); break;
+      case '\r': out->push_back('r'); break;
+      case '\t': out->push_back('t'); break;
+      default:
+        out->append("u00");
+        out->push_back(kHex[c >> 4]);
+        out->push_back(kHex[c & 0x0F]);
+        break;
+    }
+  }
+  out->append(value.data() + start, value.size() - start);
+  out->push_back('"');
+}
+
+void AppendJson(const JsonValue& value, std::string* out) {
+  switch (value.type) {
+    case JsonValue::Type::kNull:
+      out->append("null");
+      break;
+    case JsonValue::Type::kBool:
+      out->append(value.boolean ? "true" : "false");
+      break;
+    case JsonValue::Type::kNumber:
+      out->append(value.text);
+      break;
+    case JsonValue::Type::kString:
+      AppendJsonString(value.text, out);
+      break;
+    case JsonValue::Type::kArray:
+      out->push_back('[');
+      for (size_t i = 0; i < value.items.size(); ++i) {
+        if (i > 0) out->push_back(',');
+        AppendJson(value.items[i], out);
+      }
+      out->push_back(']');
+      break;
+    case JsonValue::Type::kObject:
+      out->push_back('{');
+      for (size_t i = 0; i < value.members.size(); ++i) {
+        if (i > 0) out->push_back(',');
+        AppendJsonString(value.members[i].first, out);
+        out->push_back(':');
+        AppendJson(value.members[i].second, out);
+      }
+      out->push_back('}');
+      break;
+  }
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,54 @@
+#ifndef NATIVE_CORE_JSON_H_
+#define NATIVE_CORE_JSON_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cfvpn {
+
+// 最小的 JSON 文档模型，用于解析配置模板等少量、结构已知的 JSON。
+//
+// 对象成员保持原始顺序（与 Dart 的 jsonDecode/jsonEncode 一致），
+// 数字保留原文，序列化时原样输出，不经过浮点转换。
+struct JsonValue {
+  enum class Type : uint8_t { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  Type type = Type::kNull;
+  bool boolean = false;
+  std::string text;  // 数字的原文，或反转义后的字符串（UTF-8）
+  std::vector<JsonValue> items;
+  std::vector<std::pair<std::string, JsonValue>> members;
+
+  static JsonValue String(std::string_view value);
+  static JsonValue Number(int64_t value);
+
+  bool is_object() const { return type == Type::kObject; }
+  bool is_array() const { return type == Type::kArray; }
+  bool is_string() const { return type == Type::kString; }
+  bool is_number() const { return type == Type::kNumber; }
+
+  // 对象中名为 key 的成员，不存在或不是对象时返回 nullptr
+  JsonValue* Find(std::string_view key);
+  const JsonValue* Find(std::string_view key) const;
+  // 返回名为 key 的成员，不存在时在末尾添加一个 null 成员
+  JsonValue& Member(std::string_view key);
+
+  // 数字转为整数；不是整数时返回 fallback
+  int64_t AsInt(int64_t fallback = 0) const;
+};
+
+// 解析 JSON。兼容配置模板中常见的扩展：// 和 /* */ 注释、数组和对象的
+// 尾随逗号。失败时返回 false，error（可为空）给出原因和字节偏移。
+bool ParseJson(std::string_view text, JsonValue* out, std::string* error);
+
+// 紧凑格式序列化（无空白），追加到 out
+void AppendJson(const JsonValue& value, std::string* out);
+// 追加带引号和转义的 JSON 字符串
+void AppendJsonString(std::string_view value, std::string* out);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_JSON_H_
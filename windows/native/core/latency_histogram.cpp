@@ -0,0 +1,87 @@
+#include "core/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace cfvpn {
+
+namespace {
+
+// 前 16 个桶逐毫秒，之后每个 2 的幂区间 8 个子桶
+constexpr int kLinearBuckets = 16;
+constexpr int kSubBucketBits = 3;
+constexpr int kSubBuckets = 1 << kSubBucketBits;
+constexpr int kFirstExponent = 4;  // 第一个对数区间为 [16, 32)
+
+int HighestBit(uint32_t value) {
+  int bit = 0;
+  while (value >>= 1) ++bit;
+  return bit;
+}
+
+}  // namespace
+
+int LatencyHistogram::BucketFor(int32_t latency_ms) {
+  if (latency_ms < kLinearBuckets) {
+    return std::max(latency_ms, 0);
+  }
+  const uint32_t value = static_cast<uint32_t>(latency_ms);
+  const int exponent = HighestBit(value);
+  const int sub = static_cast<int>(value >> (exponent - kSubBucketBits)) &
+                  (kSubBuckets - 1);
+  const int bucket =
+      kLinearBuckets + (exponent - kFirstExponent) * kSubBuckets + sub;
+  return std::min(bucket, kBuckets - 1);
+}
+
+int32_t LatencyHistogram::BucketLow(int bucket) {
+  if (bucket < kLinearBuckets) {
+    return bucket;
+  }
+  const int exponent = kFirstExponent + (bucket - kLinearBuckets) / kSubBuckets;
+  const int sub = (bucket - kLinearBuckets) % kSubBuckets;
+  return (kSubBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+int32_t LatencyHistogram::BucketHigh(int bucket) {
+  if (bucket < kLinearBuckets) {
+    return bucket + 1;
+  }
+  const int exponent = kFirstExponent + (bucket - kLinearBuckets) / kSubBuckets;
+  return BucketLow(bucket) + (1 << (exponent - kSubBucketBits));
+}
+
+void LatencyHistogram::Record(int32_t latency_ms) {
+  uint8_t& count = counts_[BucketFor(latency_ms)];
+  if (count < UINT8_MAX) ++count;
+}
+
+void LatencyHistogram::Clear() { std::memset(counts_, 0, sizeof(counts_)); }
+
+int32_t LatencyHistogram::count() const {
+  int32_t total = 0;
+  for (uint8_t count : counts_) total += count;
+  return total;
+}
+
+int32_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+  const int32_t total = count();
+  if (total == 0) {
+    return -1;
+  }
+  // 最近秩：第 ceil(p * n) 个样本，至少为第 1 个
+  const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+  const int32_t rank = std::max(
+      1, static_cast<int32_t>(std::ceil(clamped / 100.0 * total)));
+  int32_t seen = 0;
+  for (int bucket = 0; bucket < kBuckets; ++bucket) {
+    seen += counts_[bucket];
+    if (seen >= rank) {
+      return (BucketLow(bucket) + BucketHigh(bucket)) / 2;
+    }
+  }
+  return BucketLow(kBuckets - 1);
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,806 @@
+#include "core/local_relay.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/ip_address.h"
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace cfvpn {
+
+namespace {
+
+constexpr int kPollIntervalMs = 100;
+constexpr int kListenBacklog = 256;
+constexpr size_t kMinBufferBytes = 4096;
+// 超过这么多字节仍无法识别的首部按 "unknown" 计
+constexpr size_t kMaxSniffBytes = 8192;
+constexpr size_t kDestinationNameBytes = 128;
+constexpr uint32_t kNoDestination = UINT32_MAX;
+constexpr uint32_t kOtherDestination = 0;
+constexpr char kOtherName[] = "other";
+constexpr char kUnknownName[] = "unknown";
+
+#if defined(_WIN32)
+using PollEntry = WSAPOLLFD;
+constexpr int kSendFlags = 0;
+constexpr int kShutdownSend = SD_SEND;
+
+int PollMany(PollEntry* entries, size_t count, int timeout_ms) {
+  return ::WSAPoll(entries, static_cast<ULONG>(count), timeout_ms);
+}
+
+bool IsRetryable(int error) { return IsInProgressError(error); }
+#else
+using PollEntry = pollfd;
+constexpr int kSendFlags = MSG_NOSIGNAL;
+constexpr int kShutdownSend = SHUT_WR;
+
+int PollMany(PollEntry* entries, size_t count, int timeout_ms) {
+  int ready;
+  do {
+    ready = ::poll(entries, static_cast<nfds_t>(count), timeout_ms);
+  } while (ready < 0 && errno == EINTR);
+  return ready;
+}
+
+bool IsRetryable(int error) {
+  return IsInProgressError(error) || error == EINTR;
+}
+#endif
+
+constexpr short kReadable = POLLIN | POLLERR | POLLHUP;
+constexpr short kWritable = POLLOUT | POLLERR | POLLHUP;
+
+// 不关心的套接字以无效句柄占位，poll 会忽略它（也就不会报告 POLLHUP）
+PollEntry MakePollEntry(NativeSocket socket, short events) {
+  PollEntry entry;
+  entry.fd = events != 0 ? socket : kInvalidSocket;
+  entry.events = events;
+  entry.revents = 0;
+  return entry;
+}
+
+void SetNoDelay(NativeSocket socket) {
+  int no_delay = 1;
+  ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+               reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+}
+
+// 计数器只有工作线程写入，读-加-写不会丢更新，也就不需要带锁的 RMW
+template <typename T>
+void Add(std::atomic<T>& counter, T value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+template <typename T>
+void Subtract(std::atomic<T>& counter, T value) {
+  counter.store(counter.load(std::memory_order_relaxed) - value,
+                std::memory_order_relaxed);
+}
+
+char LowerAscii(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool StartsWithNoCase(std::string_view text, std::string_view prefix) {
+  if (text.size() < prefix.size()) return false;
+  for (size_t i = 0; i < prefix.size(); ++i) {
+    if (LowerAscii(text[i]) != prefix[i]) return false;
+  }
+  return true;
+}
+
+// "host[:port]" 或 "[v6]:port" 规范化为 "host:port"
+bool NormalizeAuthority(std::string_view authority, uint16_t default_port,
+                        std::string* out) {
+  const size_t at = authority.rfind('@');
+  if (at != std::string_view::npos) authority.remove_prefix(at + 1);
+  std::string_view host = authority;
+  std::string_view port;
+  if (!authority.empty() && authority.front() == '[') {
+    const size_t close = authority.find(']');
+    if (close == std::string_view::npos) return false;
+    host = authority.substr(0, close + 1);
+    const std::string_view rest = authority.substr(close + 1);
+    if (!rest.empty()) {
+      if (rest.front() != ':') return false;
+      port = rest.substr(1);
+    }
+  } else {
+    const size_t colon = authority.find(':');
+    if (colon != std::string_view::npos) {
+      host = authority.substr(0, colon);
+      port = authority.substr(colon + 1);
+    }
+  }
+  if (host.empty() || host.size() > kDestinationNameBytes - 7) return false;
+  uint32_t value = default_port;
+  if (!port.empty()) {
+    if (port.size() > 5) return false;
+    value = 0;
+    for (char c : port) {
+      if (c < '0' || c > '9') return false;
+      value = value * 10 + static_cast<uint32_t>(c - '0');
+    }
+    if (value == 0 || value > 65535) return false;
+  }
+  std::string result;
+  result.reserve(host.size() + 6);
+  for (char c : host) {
+    if (static_cast<unsigned char>(c) <= ' ') return false;
+    result.push_back(LowerAscii(c));
+  }
+  result.push_back(':');
+  result += std::to_string(value);
+  *out = std::move(result);
+  return true;
+}
+
+SniffStatus SniffHttp(std::string_view data, std::string* out) {
+  const size_t line_end = data.find("\r\n");
+  if (line_end == std::string_view::npos) {
+    return data.size() < kMaxSniffBytes ? SniffStatus::kNeedMore
+                                        : SniffStatus::kUnknown;
+  }
+  const std::string_view line = data.substr(0, line_end);
+  const size_t method_end = line.find(' ');
+  if (method_end == std::string_view::npos) return SniffStatus::kUnknown;
+  const std::string_view method = line.substr(0, method_end);
+  std::string_view target = line.substr(method_end + 1);
+  target = target.substr(0, target.find(' '));
+
+  if (method == "CONNECT") {
+    return NormalizeAuthority(target, 443, out) ? SniffStatus::kFound
+                                                : SniffStatus::kUnknown;
+  }
+  uint16_t default_port = 80;
+  if (StartsWithNoCase(target, "http://")) {
+    target.remove_prefix(7);
+  } else if (StartsWithNoCase(target, "https://")) {
+    target.remove_prefix(8);
+    default_port = 443;
+  } else {
+    // origin-form，目标在 Host 头中
+    const size_t headers_end = data.find("\r\n\r\n");
+    size_t pos = line_end + 2;
+    for (;;) {
+      const size_t end = data.find("\r\n", pos);
+      if (end == std::string_view::npos || end == pos) break;
+      const std::string_view header = data.substr(pos, end - pos);
+      if (StartsWithNoCase(header, "host:")) {
+        std::string_view value = header.substr(5);
+        while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+        while (!value.empty() && value.back() == ' ') value.remove_suffix(1);
+        return NormalizeAuthority(value, default_port, out)
+                   ? SniffStatus::kFound
+                   : SniffStatus::kUnknown;
+      }
+      pos = end + 2;
+    }
+    return headers_end == std::string_view::npos && data.size() < kMaxSniffBytes
+               ? SniffStatus::kNeedMore
+               : SniffStatus::kUnknown;
+  }
+  const size_t authority_end = target.find_first_of("/?#");
+  return NormalizeAuthority(target.substr(0, authority_end), default_port, out)
+             ? SniffStatus::kFound
+             : SniffStatus::kUnknown;
+}
+
+SniffStatus SniffSocks5(std::string_view data, std::string* out) {
+  const auto byte = [&data](size_t i) {
+    return static_cast<uint8_t>(data[i]);
+  };
+  // 方法协商：VER NMETHODS METHODS...
+  if (data.size() < 2) return SniffStatus::kNeedMore;
+  size_t pos = 2 + byte(1);
+  // 用户名/密码子协商（RFC 1929）：VER=1 ULEN UNAME PLEN PASSWD
+  if (data.size() > pos && byte(pos) == 0x01) {
+    if (data.size() < pos + 2) return SniffStatus::kNeedMore;
+    const size_t password = pos + 2 + byte(pos + 1);
+    if (data.size() <= password) return SniffStatus::kNeedMore;
+    pos = password + 1 + byte(password);
+  }
+  // 请求：VER CMD RSV ATYP DST.ADDR DST.PORT
+  if (data.size() < pos + 5) return SniffStatus::kNeedMore;
+  if (byte(pos) != 0x05 || byte(pos + 1) != 0x01) return SniffStatus::kUnknown;
+  const uint8_t type = byte(pos + 3);
+  pos += 4;
+  std::string host;
+  if (type == 0x01 || type == 0x04) {
+    const size_t length = type == 0x01 ? 4 : 16;
+    if (data.size() < pos + length + 2) return SniffStatus::kNeedMore;
+    const IpAddress address = IpAddressFromBytes(
+        reinterpret_cast<const uint8_t*>(data.data() + pos), type == 0x04);
+    host = address.v6 ? "[" + FormatIpAddress(address) + "]"
+                      : FormatIpAddress(address);
+    pos += length;
+  } else if (type == 0x03) {
+    const size_t length = byte(pos);
+    if (length == 0) return SniffStatus::kUnknown;
+    if (data.size() < pos + 1 + length + 2) return SniffStatus::kNeedMore;
+    host.assign(data.substr(pos + 1, length));
+    pos += 1 + length;
+  } else {
+    return SniffStatus::kUnknown;
+  }
+  const uint16_t port = static_cast<uint16_t>((byte(pos) << 8) | byte(pos + 1));
+  return NormalizeAuthority(host + ":" + std::to_string(port), port, out)
+             ? SniffStatus::kFound
+             : SniffStatus::kUnknown;
+}
+
+}  // namespace
+
+SniffStatus SniffProxyDestination(std::string_view data, std::string* out) {
+  if (data.empty()) return SniffStatus::kNeedMore;
+  if (data.front() == 0x05) return SniffSocks5(data, out);
+  if (data.front() >= 'A' && data.front() <= 'Z') return SniffHttp(data, out);
+  return SniffStatus::kUnknown;
+}
+
+// 名称在 destination_count_ 发布之前写好，之后不再修改
+struct LocalRelay::DestinationSlot {
+  char name[kDestinationNameBytes] = {};
+  std::atomic<uint64_t> bytes_up{0};
+  std::atomic<uint64_t> bytes_down{0};
+  std::atomic<uint64_t> connections{0};
+  std::atomic<uint32_t> active{0};
+};
+
+// id 为 0 表示空闲。读取方在读完其他字段后再次检查 id，
+// 以丢弃读取过程中被复用的槽位。
+struct LocalRelay::ConnectionSlot {
+  std::atomic<uint64_t> id{0};
+  std::atomic<uint32_t> destination{kNoDestination};
+  std::atomic<uint64_t> bytes_up{0};
+  std::atomic<uint64_t> bytes_down{0};
+  std::atomic<int64_t> started_us{0};
+};
+
+// 一个方向：从 from 读、向 to 写。拷贝模式经 buffer，
+// splice 模式经管道（只在 Linux 上）。
+struct LocalRelay::Direction {
+  NativeSocket from = kInvalidSocket;
+  NativeSocket to = kInvalidSocket;
+  bool up = false;
+  std::vector<char> buffer;  // 按需分配
+  size_t begin = 0;
+  size_t end = 0;
+  int pipe_read = -1;
+  int pipe_write = -1;
+  size_t pipe_capacity = 0;
+  size_t in_pipe = 0;
+  bool splicing = false;
+  bool read_closed = false;
+  bool write_closed = false;
+
+  size_t pending() const { return splicing ? in_pipe : end - begin; }
+  // 还能继续读（未到 EOF 且缓冲或管道未满）
+  bool readable(size_t buffer_bytes) const {
+    if (read_closed) return false;
+    return splicing ? in_pipe < pipe_capacity : end < buffer_bytes;
+  }
+};
+
+struct LocalRelay::Connection {
+  uint64_t id = 0;
+  uint32_t slot = 0;
+  NativeSocket client = kInvalidSocket;
+  NativeSocket upstream = kInvalidSocket;
+  bool connecting = false;
+  bool upstream_failed = false;  // 在 Release 中计入 upstream_failures_
+  Direction up;
+  Direction down;
+  bool sniffing = true;
+  std::string sniffed;
+  uint32_t destination = kNoDestination;
+};
+
+namespace {
+
+#if defined(__linux__)
+constexpr unsigned kSpliceFlags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+// 向已关闭的套接字 splice 时内核会发 SIGPIPE（没有 MSG_NOSIGNAL 可用）。
+// 工作线程屏蔽了它，出错后把挂起的信号取走。
+void DiscardPendingSigpipe() {
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  const timespec zero = {0, 0};
+  while (sigtimedwait(&set, nullptr, &zero) > 0) {
+  }
+}
+
+bool OpenPipe(size_t capacity, int* read_fd, int* write_fd,
+              size_t* actual_capacity) {
+  int fds[2];
+  if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) return false;
+  // 超过 /proc/sys/fs/pipe-max-size 时设置失败，沿用默认大小
+  ::fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(capacity));
+  const int size = ::fcntl(fds[1], F_GETPIPE_SZ);
+  if (size <= 0) {
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return false;
+  }
+  *read_fd = fds[0];
+  *write_fd = fds[1];
+  *actual_capacity = static_cast<size_t>(size);
+  return true;
+}
+#endif
+
+void ClosePipe(int* read_fd, int* write_fd) {
+#if defined(__linux__)
+  if (*read_fd >= 0) ::close(*read_fd);
+  if (*write_fd >= 0) ::close(*write_fd);
+#endif
+  *read_fd = -1;
+  *write_fd = -1;
+}
+
+}  // namespace
+
+LocalRelay::LocalRelay(const LocalRelayOptions& options) : options_(options) {
+  options_.max_connections = std::max<size_t>(1, options_.max_connections);
+  options_.buffer_bytes = std::max(kMinBufferBytes, options_.buffer_bytes);
+#if defined(__linux__)
+  zero_copy_ = options_.zero_copy;
+#endif
+  destination_capacity_ = options_.max_destinations + 1;
+  destinations_.reset(new DestinationSlot[destination_capacity_]);
+  std::memcpy(destinations_[kOtherDestination].name, kOtherName,
+              sizeof(kOtherName));
+  destination_count_.store(1, std::memory_order_release);
+  connection_slots_.reset(new ConnectionSlot[options_.max_connections]);
+  free_slots_.reserve(options_.max_connections);
+  for (size_t i = options_.max_connections; i > 0; --i) {
+    free_slots_.push_back(static_cast<uint32_t>(i - 1));
+  }
+}
+
+LocalRelay::~LocalRelay() { Stop(); }
+
+bool LocalRelay::Start(std::string* error) {
+  if (worker_.joinable() || stopping_.load()) {
+    *error = "中继已启动过";
+    return false;
+  }
+  if (options_.upstream_port == 0) {
+    *error = "没有上游端口";
+    return false;
+  }
+  if (!InitSocketLibrary()) {
+    *error = "套接字库初始化失败";
+    return false;
+  }
+  NativeSocket listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (listener == kInvalidSocket) {
+    *error = SocketErrorString(LastSocketError());
+    return false;
+  }
+#if !defined(_WIN32)
+  // 固定端口在重启后可以立即复用（Windows 上 SO_REUSEADDR 允许抢占端口，
+  // 不设置）
+  int reuse = 1;
+  ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+  sockaddr_in address = MakeSockaddrV4(0x7F000001, options_.listen_port);
+  socklen_t length = sizeof(address);
+  if (::bind(listener, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(listener, kListenBacklog) != 0 || !SetNonBlocking(listener) ||
+      ::getsockname(listener, reinterpret_cast<sockaddr*>(&address),
+                    &length) != 0) {
+    *error = SocketErrorString(LastSocketError());
+    CloseSocket(listener);
+    return false;
+  }
+  listener_ = listener;
+  port_ = ntohs(address.sin_port);
+  worker_ = std::thread(&LocalRelay::Run, this);
+  return true;
+}
+
+void LocalRelay::Stop() {
+  stopping_.store(true);
+  if (worker_.joinable()) worker_.join();
+}
+
+std::vector<RelayTalker> LocalRelay::TopTalkers(size_t limit) const {
+  std::vector<RelayTalker> talkers;
+  const uint32_t count = destination_count_.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < count; ++i) {
+    const DestinationSlot& slot = destinations_[i];
+    RelayTalker talker;
+    talker.connections = slot.connections.load(std::memory_order_relaxed);
+    if (talker.connections == 0) continue;
+    talker.destination = slot.name;
+    talker.bytes_up = slot.bytes_up.load(std::memory_order_relaxed);
+    talker.bytes_down = slot.bytes_down.load(std::memory_order_relaxed);
+    talker.active = slot.active.load(std::memory_order_relaxed);
+    talkers.push_back(std::move(talker));
+  }
+  std::sort(talkers.begin(), talkers.end(),
+            [](const RelayTalker& a, const RelayTalker& b) {
+              const uint64_t total_a = a.bytes_up + a.bytes_down;
+              const uint64_t total_b = b.bytes_up + b.bytes_down;
+              if (total_a != total_b) return total_a > total_b;
+              return a.destination < b.destination;
+            });
+  if (limit != 0 && talkers.size() > limit) talkers.resize(limit);
+  return talkers;
+}
+
+std::vector<RelayConnection> LocalRelay::Connections() const {
+  std::vector<RelayConnection> connections;
+  const int64_t now_us = MonotonicMicros();
+  const uint32_t count = destination_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < options_.max_connections; ++i) {
+    const ConnectionSlot& slot = connection_slots_[i];
+    RelayConnection connection;
+    connection.id = slot.id.load(std::memory_order_acquire);
+    if (connection.id == 0) continue;
+    const uint32_t destination =
+        slot.destination.load(std::memory_order_relaxed);
+    connection.bytes_up = slot.bytes_up.load(std::memory_order_relaxed);
+    connection.bytes_down = slot.bytes_down.load(std::memory_order_relaxed);
+    connection.age_us =
+        now_us - slot.started_us.load(std::memory_order_relaxed);
+    if (slot.id.load(std::memory_order_acquire) != connection.id) continue;
+    if (destination < count) {
+      connection.destination = destinations_[destination].name;
+    }
+    connections.push_back(std::move(connection));
+  }
+  std::sort(connections.begin(), connections.end(),
+            [](const RelayConnection& a, const RelayConnection& b) {
+              return a.id < b.id;
+            });
+  return connections;
+}
+
+LocalRelayStats LocalRelay::stats() const {
+  LocalRelayStats stats;
+  stats.accepted = accepted_.load(std::memory_order_relaxed);
+  stats.rejected = rejected_.load(std::memory_order_relaxed);
+  stats.upstream_failures = upstream_failures_.load(std::memory_order_relaxed);
+  stats.bytes_up = bytes_up_.load(std::memory_order_relaxed);
+  stats.bytes_down = bytes_down_.load(std::memory_order_relaxed);
+  stats.zero_copy_bytes = zero_copy_bytes_.load(std::memory_order_relaxed);
+  stats.active = active_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void LocalRelay::Run() {
+#if defined(__linux__)
+  sigset_t sigpipe;
+  sigemptyset(&sigpipe);
+  sigaddset(&sigpipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+#endif
+  std::vector<PollEntry> entries;
+  while (!stopping_.load()) {
+    // entries[0] 是监听套接字，之后每个连接依次是客户端和上游
+    entries.clear();
+    entries.push_back(MakePollEntry(listener_, POLLIN));
+    for (const auto& connection : connections_) {
+      short client_events = 0;
+      short upstream_events = 0;
+      if (connection->up.readable(options_.buffer_bytes)) {
+        client_events |= POLLIN;
+      }
+      if (connection->down.pending() > 0) client_events |= POLLOUT;
+      if (connection->connecting) {
+        upstream_events = POLLOUT;
+      } else {
+        if (connection->down.readable(options_.buffer_bytes)) {
+          upstream_events |= POLLIN;
+        }
+        if (connection->up.pending() > 0) upstream_events |= POLLOUT;
+      }
+      entries.push_back(MakePollEntry(connection->client, client_events));
+      entries.push_back(MakePollEntry(connection->upstream, upstream_events));
+    }
+    if (PollMany(entries.data(), entries.size(), kPollIntervalMs) <= 0) {
+      continue;
+    }
+
+    const size_t count = connections_.size();
+    for (size_t i = 0; i < count; ++i) {
+      Connection* connection = connections_[i].get();
+      const short client_events = entries[1 + 2 * i].revents;
+      const short upstream_events = entries[2 + 2 * i].revents;
+      if (client_events == 0 && upstream_events == 0) continue;
+      if (!Pump(connection, client_events, upstream_events) ||
+          (connection->up.write_closed && connection->down.write_closed)) {
+        Release(connection);
+        connections_[i].reset();
+      }
+    }
+    connections_.erase(
+        std::remove(connections_.begin(), connections_.end(), nullptr),
+        connections_.end());
+    if (entries[0].revents & kReadable) Accept();
+  }
+  for (const auto& connection : connections_) Release(connection.get());
+  connections_.clear();
+  CloseSocket(listener_);
+  listener_ = kInvalidSocket;
+}
+
+void LocalRelay::Accept() {
+  for (;;) {
+    NativeSocket client = ::accept(listener_, nullptr, nullptr);
+    if (client == kInvalidSocket) return;
+    if (free_slots_.empty()) {
+      CloseSocket(client, true);
+      Add<uint64_t>(rejected_, 1);
+      continue;
+    }
+    NativeSocket upstream = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    bool connecting = false;
+    bool ok = upstream != kInvalidSocket && SetNonBlocking(client) &&
+              SetNonBlocking(upstream);
+    if (ok) {
+      SetNoDelay(client);
+      SetNoDelay(upstream);
+      const sockaddr_in address =
+          MakeSockaddrV4(options_.upstream_ip, options_.upstream_port);
+      if (::connect(upstream, reinterpret_cast<const sockaddr*>(&address),
+                    sizeof(address)) != 0) {
+        connecting = IsInProgressError(LastSocketError());
+        ok = connecting;
+      }
+    }
+    if (!ok) {
+      Add<uint64_t>(upstream_failures_, 1);
+      CloseSocket(client, true);
+      if (upstream != kInvalidSocket) CloseSocket(upstream);
+      continue;
+    }
+
+    auto connection = std::make_unique<Connection>();
+    connection->id = next_id_++;
+    connection->slot = free_slots_.back();
+    free_slots_.pop_back();
+    connection->client = client;
+    connection->upstream = upstream;
+    connection->connecting = connecting;
+    connection->up.from = client;
+    connection->up.to = upstream;
+    connection->up.up = true;
+    connection->down.from = upstream;
+    connection->down.to = client;
+#if defined(__linux__)
+    // 打不开管道（如文件句柄不足）时该方向退回拷贝
+    if (zero_copy_) {
+      for (Direction* direction : {&connection->up, &connection->down}) {
+        OpenPipe(options_.buffer_bytes, &direction->pipe_read,
+                 &direction->pipe_write, &direction->pipe_capacity);
+      }
+      // 上行要先识别目标，见 WriteFrom
+      connection->down.splicing = connection->down.pipe_read >= 0;
+    }
+#endif
+
+    ConnectionSlot& slot = connection_slots_[connection->slot];
+    slot.destination.store(kNoDestination, std::memory_order_relaxed);
+    slot.bytes_up.store(0, std::memory_order_relaxed);
+    slot.bytes_down.store(0, std::memory_order_relaxed);
+    slot.started_us.store(MonotonicMicros(), std::memory_order_relaxed);
+    slot.id.store(connection->id, std::memory_order_release);
+    connections_.push_back(std::move(connection));
+    Add<uint64_t>(accepted_, 1);
+    Add<uint32_t>(active_, 1);
+  }
+}
+
+bool LocalRelay::Pump(Connection* connection, short client_events,
+                      short upstream_events) {
+  bool connected_now = false;
+  if (connection->connecting) {
+    if ((upstream_events & kWritable) == 0) {
+      return (client_events & kReadable) == 0 ||
+             ReadInto(connection, &connection->up);
+    }
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (::getsockopt(connection->upstream, SOL_SOCKET, SO_ERROR,
+                     reinterpret_cast<char*>(&error), &length) != 0 ||
+        error != 0) {
+      connection->upstream_failed = true;
+      return false;
+    }
+    connection->connecting = false;
+    connected_now = true;
+  }
+  // 读到数据后立即尝试写出，不必等下一轮 poll 报告可写
+  const bool client_readable = (client_events & kReadable) != 0;
+  if (client_readable && !ReadInto(connection, &connection->up)) return false;
+  if ((client_readable || connected_now || (upstream_events & kWritable)) &&
+      !WriteFrom(connection, &connection->up)) {
+    return false;
+  }
+  const bool upstream_readable =
+      !connected_now && (upstream_events & kReadable) != 0;
+  if (upstream_readable && !ReadInto(connection, &connection->down)) {
+    return false;
+  }
+  if ((upstream_readable || (client_events & kWritable)) &&
+      !WriteFrom(connection, &connection->down)) {
+    return false;
+  }
+  return true;
+}
+
+bool LocalRelay::ReadInto(Connection* connection, Direction* direction) {
+  if (!direction->readable(options_.buffer_bytes)) return true;
+#if defined(__linux__)
+  if (direction->splicing) {
+    const ssize_t moved =
+        ::splice(direction->from, nullptr, direction->pipe_write, nullptr,
+                 direction->pipe_capacity - direction->in_pipe, kSpliceFlags);
+    if (moved > 0) {
+      direction->in_pipe += static_cast<size_t>(moved);
+    } else if (moved == 0) {
+      direction->read_closed = true;
+    } else if (!IsRetryable(errno)) {
+      return false;
+    }
+    return true;
+  }
+#endif
+  if (direction->buffer.empty()) {
+    direction->buffer.resize(options_.buffer_bytes);
+  }
+  char* target = direction->buffer.data() + direction->end;
+  const int received = static_cast<int>(
+      ::recv(direction->from, target,
+             static_cast<int>(options_.buffer_bytes - direction->end), 0));
+  if (received > 0) {
+    if (direction->up && connection->sniffing) {
+      Sniff(connection, target, static_cast<size_t>(received));
+    }
+    direction->end += static_cast<size_t>(received);
+  } else if (received == 0) {
+    direction->read_closed = true;
+  } else if (!IsRetryable(LastSocketError())) {
+    return false;
+  }
+  return true;
+}
+
+bool LocalRelay::WriteFrom(Connection* connection, Direction* direction) {
+#if defined(__linux__)
+  if (direction->splicing && direction->in_pipe > 0) {
+    const ssize_t moved =
+        ::splice(direction->pipe_read, nullptr, direction->to, nullptr,
+                 direction->in_pipe, kSpliceFlags);
+    if (moved > 0) {
+      direction->in_pipe -= static_cast<size_t>(moved);
+      Account(connection, direction->up, static_cast<size_t>(moved), true);
+    } else if (moved < 0 && !IsRetryable(errno)) {
+      if (errno == EPIPE) DiscardPendingSigpipe();
+      return false;
+    }
+  }
+#endif
+  if (!direction->splicing && direction->end > direction->begin) {
+    const int sent = static_cast<int>(::send(
+        direction->to, direction->buffer.data() + direction->begin,
+        static_cast<int>(direction->end - direction->begin), kSendFlags));
+    if (sent > 0) {
+      direction->begin += static_cast<size_t>(sent);
+      Account(connection, direction->up, static_cast<size_t>(sent), false);
+    } else if (!IsRetryable(LastSocketError())) {
+      return false;
+    }
+  }
+  if (!direction->splicing && direction->begin == direction->end) {
+    direction->begin = direction->end = 0;
+    // 识别出目标且缓冲排空后改用管道，缓冲随之释放
+    if (direction->pipe_read >= 0 && !(direction->up && connection->sniffing)) {
+      direction->splicing = true;
+      std::vector<char>().swap(direction->buffer);
+    }
+  }
+  if (direction->read_closed && direction->pending() == 0 &&
+      !direction->write_closed) {
+    ::shutdown(direction->to, kShutdownSend);
+    direction->write_closed = true;
+  }
+  return true;
+}
+
+void LocalRelay::Sniff(Connection* connection, const char* data,
+                       size_t length) {
+  connection->sniffed.append(
+      data, std::min(length, kMaxSniffBytes - connection->sniffed.size()));
+  std::string destination;
+  const SniffStatus status =
+      SniffProxyDestination(connection->sniffed, &destination);
+  if (status == SniffStatus::kNeedMore &&
+      connection->sniffed.size() < kMaxSniffBytes) {
+    return;
+  }
+  if (status != SniffStatus::kFound) destination = kUnknownName;
+  connection->sniffing = false;
+  std::string().swap(connection->sniffed);
+
+  connection->destination = FindDestination(destination);
+  DestinationSlot& target = destinations_[connection->destination];
+  ConnectionSlot& slot = connection_slots_[connection->slot];
+  // 识别之前已经转发的字节（如 SOCKS5 协商）补记到目标
+  Add(target.bytes_up, slot.bytes_up.load(std::memory_order_relaxed));
+  Add(target.bytes_down, slot.bytes_down.load(std::memory_order_relaxed));
+  Add<uint64_t>(target.connections, 1);
+  Add<uint32_t>(target.active, 1);
+  slot.destination.store(connection->destination, std::memory_order_relaxed);
+}
+
+uint32_t LocalRelay::FindDestination(const std::string& name) {
+  auto it = destination_index_.find(name);
+  if (it != destination_index_.end()) return it->second;
+  const uint32_t count = destination_count_.load(std::memory_order_relaxed);
+  if (count >= destination_capacity_) return kOtherDestination;
+  DestinationSlot& slot = destinations_[count];
+  const size_t length = std::min(name.size(), kDestinationNameBytes - 1);
+  std::memcpy(slot.name, name.data(), length);
+  slot.name[length] = '\0';
+  destination_count_.store(count + 1, std::memory_order_release);
+  destination_index_.emplace(name, count);
+  return count;
+}
+
+void LocalRelay::Account(Connection* connection, bool up, size_t bytes,
+                         bool zero_copy) {
+  const uint64_t value = bytes;
+  ConnectionSlot& slot = connection_slots_[connection->slot];
+  Add(up ? slot.bytes_up : slot.bytes_down, value);
+  if (connection->destination != kNoDestination) {
+    DestinationSlot& target = destinations_[connection->destination];
+    Add(up ? target.bytes_up : target.bytes_down, value);
+  }
+  Add(up ? bytes_up_ : bytes_down_, value);
+  if (zero_copy) Add(zero_copy_bytes_, value);
+}
+
+void LocalRelay::Release(Connection* connection) {
+  // 两个方向都正常结束时优雅关闭，否则发送 RST 让对端尽快感知
+  const bool graceful =
+      connection->up.write_closed && connection->down.write_closed;
+  CloseSocket(connection->client, !graceful);
+  CloseSocket(connection->upstream, !graceful);
+  for (Direction* direction : {&connection->up, &connection->down}) {
+    ClosePipe(&direction->pipe_read, &direction->pipe_write);
+  }
+  if (connection->destination != kNoDestination) {
+    Subtract<uint32_t>(destinations_[connection->destination].active, 1);
+  }
+  connection_slots_[connection->slot].id.store(0, std::memory_order_release);
+  free_slots_.push_back(connection->slot);
+  Subtract<uint32_t>(active_, 1);
+  // 先释放再计数：读取方看到失败计数时连接已不在 active 中
+  if (connection->upstream_failed) Add<uint64_t>(upstream_failures_, 1);
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,150 @@
+#ifndef NATIVE_CORE_LOCAL_RELAY_H_
+#define NATIVE_CORE_LOCAL_RELAY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+enum class SniffStatus {
+  kNeedMore,  // 数据不足以判断
+  kFound,
+  kUnknown,   // 不是可识别的代理请求
+};
+
+// 从客户端发往代理入站的首部识别目标：HTTP CONNECT、绝对 URI 形式的
+// HTTP 请求，以及 SOCKS5 CONNECT（跳过方法协商）。找到时写出
+// "host:port"，host 转为小写，IPv6 地址带方括号。
+SniffStatus SniffProxyDestination(std::string_view data, std::string* out);
+
+struct LocalRelayOptions {
+  uint16_t listen_port = 0;    // 127.0.0.1 上的监听端口，0 由系统分配
+  uint32_t upstream_ip = 0x7F000001;  // 主机字节序
+  uint16_t upstream_port = 0;  // v2ray 的 http 或 socks 入站
+  size_t max_connections = 1024;   // 超过时新连接直接关闭
+  size_t max_destinations = 1024;  // 目标表容量，满后计入 "other"
+  size_t buffer_bytes = 64 * 1024;  // 每个方向的缓冲或管道容量
+  // Linux 上用 splice 经管道在内核中搬运数据，其他平台忽略
+  bool zero_copy = true;
+};
+
+// 按目标汇总的流量，bytes_up 为客户端发往上游的字节
+struct RelayTalker {
+  std::string destination;
+  uint64_t bytes_up = 0;
+  uint64_t bytes_down = 0;
+  uint64_t connections = 0;  // 累计连接数
+  uint32_t active = 0;
+};
+
+struct RelayConnection {
+  uint64_t id = 0;
+  std::string destination;  // 尚未识别时为空
+  uint64_t bytes_up = 0;
+  uint64_t bytes_down = 0;
+  int64_t age_us = 0;
+};
+
+struct LocalRelayStats {
+  uint64_t accepted = 0;
+  uint64_t rejected = 0;        // 超过 max_connections
+  uint64_t upstream_failures = 0;
+  uint64_t bytes_up = 0;
+  uint64_t bytes_down = 0;
+  uint64_t zero_copy_bytes = 0;  // 其中经 splice 搬运的字节
+  uint32_t active = 0;
+};
+
+// 位于 v2ray 入站之前的本机 TCP 中继，按连接和目标统计流量。
+//
+// 一个工作线程用 poll 驱动所有连接。客户端发出的首部按 HTTP/SOCKS5
+// 代理协议识别目标，识别期间走用户态拷贝；之后（以及下行方向全程）在
+// Linux 上改用 splice 经每个方向一对管道转发，数据不进入用户态。
+// HTTP keep-alive 连接上的后续请求记在第一个目标下。
+//
+// 计数器只由工作线程写入，按连接和目标放在固定大小的原子槽位中，
+// 读取方（TopTalkers、Connections、stats）不加锁，读到的是近似快照。
+class LocalRelay {
+ public:
+  explicit LocalRelay(const LocalRelayOptions& options);
+  ~LocalRelay();
+
+  LocalRelay(const LocalRelay&) = delete;
+  LocalRelay& operator=(const LocalRelay&) = delete;
+
+  // 开始监听并启动工作线程；Stop 后不能再次启动
+  bool Start(std::string* error);
+  // 关闭全部连接并停止工作线程，最多等待一个轮询周期（100ms）。
+  // 可重复调用，之后统计仍可读取。
+  void Stop();
+
+  uint16_t port() const { return port_; }
+  // 实际是否使用 splice
+  bool zero_copy() const { return zero_copy_; }
+
+  // 按上下行字节总和从大到小排列，limit 为 0 时返回全部
+  std::vector<RelayTalker> TopTalkers(size_t limit) const;
+  // 当前活动的连接
+  std::vector<RelayConnection> Connections() const;
+  LocalRelayStats stats() const;
+
+ private:
+  struct DestinationSlot;
+  struct ConnectionSlot;
+  struct Direction;
+  struct Connection;
+
+  // 以下方法只在工作线程中调用
+  void Run();
+  void Accept();
+  // 返回 false 表示连接应关闭
+  bool Pump(Connection* connection, short client_events,
+            short upstream_events);
+  bool ReadInto(Connection* connection, Direction* direction);
+  bool WriteFrom(Connection* connection, Direction* direction);
+  void Sniff(Connection* connection, const char* data, size_t length);
+  uint32_t FindDestination(const std::string& name);
+  void Account(Connection* connection, bool up, size_t bytes,
+               bool zero_copy);
+  void Release(Connection* connection);
+
+  LocalRelayOptions options_;
+  bool zero_copy_ = false;
+  uint16_t port_ = 0;
+  NativeSocket listener_ = kInvalidSocket;
+  std::atomic<bool> stopping_{false};
+  std::thread worker_;
+
+  // 固定容量的槽位表，槽位 0 是 "other"
+  std::unique_ptr<DestinationSlot[]> destinations_;
+  std::unique_ptr<ConnectionSlot[]> connection_slots_;
+  size_t destination_capacity_ = 0;
+  std::atomic<uint32_t> destination_count_{0};
+
+  // 只由工作线程读写
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::vector<uint32_t> free_slots_;
+  std::unordered_map<std::string, uint32_t> destination_index_;
+  uint64_t next_id_ = 1;
+
+  std::atomic<uint64_t> accepted_{0};
+  std::atomic<uint64_t> rejected_{0};
+  std::atomic<uint64_t> upstream_failures_{0};
+  std::atomic<uint64_t> bytes_up_{0};
+  std::atomic<uint64_t> bytes_down_{0};
+  std::atomic<uint64_t> zero_copy_bytes_{0};
+  std::atomic<uint32_t> active_{0};
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_LOCAL_RELAY_H_
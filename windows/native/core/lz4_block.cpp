@@ -0,0 +1,149 @@
+#include "core/lz4_block.h"
+
+#include <cstring>
+#include <vector>
+
+namespace cfvpn {
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kLastLiterals = 5;  // 块末尾至少 5 个字节是字面量
+constexpr size_t kMatchFindLimit = 12;  // 最后一个匹配至少在末尾 12 字节之前开始
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 12;
+
+uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+void WriteLength(size_t length, std::string* out) {
+  while (length >= 255) {
+    out->push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out->push_back(static_cast<char>(length));
+}
+
+void EmitSequence(const uint8_t* literals, size_t literal_length,
+                  size_t offset, size_t match_length, std::string* out) {
+  const size_t match_code = match_length - kMinMatch;
+  const uint8_t token = static_cast<uint8_t>(
+      ((literal_length < 15 ? literal_length : 15) << 4) |
+      (match_code < 15 ? match_code : 15));
+  out->push_back(static_cast<char>(token));
+  if (literal_length >= 15) WriteLength(literal_length - 15, out);
+  out->append(reinterpret_cast<const char*>(literals), literal_length);
+  out->push_back(static_cast<char>(offset & 0xFF));
+  out->push_back(static_cast<char>(offset >> 8));
+  if (match_code >= 15) WriteLength(match_code - 15, out);
+}
+
+void EmitLastLiterals(const uint8_t* literals, size_t literal_length,
+                      std::string* out) {
+  const uint8_t token = static_cast<uint8_t>(
+      (literal_length < 15 ? literal_length : 15) << 4);
+  out->push_back(static_cast<char>(token));
+  if (literal_length >= 15) WriteLength(literal_length - 15, out);
+  out->append(reinterpret_cast<const char*>(literals), literal_length);
+}
+
+bool ReadLength(const uint8_t** ip, const uint8_t* end, size_t* length) {
+  uint8_t byte;
+  do {
+    if (*ip >= end) return false;
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+}  // namespace
+
+size_t Lz4Compress(const uint8_t* src, size_t size, std::string* out) {
+  const size_t start = out->size();
+  size_t anchor = 0;
+  if (size > kMatchFindLimit) {
+    // 位置加 1 存储，0 表示空
+    std::vector<uint32_t> table(size_t{1} << kHashBits, 0);
+    const size_t limit = size - kMatchFindLimit;
+    const size_t match_end_limit = size - kLastLiterals;
+    size_t ip = 0;
+    while (ip < limit) {
+      const uint32_t sequence = Read32(src + ip);
+      const uint32_t hash = Hash(sequence);
+      const size_t candidate = table[hash];
+      table[hash] = static_cast<uint32_t>(ip + 1);
+      if (candidate == 0 || ip - (candidate - 1) > kMaxOffset ||
+          Read32(src + candidate - 1) != sequence) {
+        ++ip;
+        continue;
+      }
+      size_t match = candidate - 1;
+      while (ip > anchor && match > 0 && src[ip - 1] == src[match - 1]) {
+        --ip;
+        --match;
+      }
+      size_t length = kMinMatch;
+      while (ip + length < match_end_limit &&
+             src[ip + length] == src[match + length]) {
+        ++length;
+      }
+      EmitSequence(src + anchor, ip - anchor, ip - match, length, out);
+      ip += length;
+      anchor = ip;
+      // 把匹配末尾附近的位置也放进表里，提高后续命中率
+      if (ip >= 2 && ip - 2 < limit) {
+        table[Hash(Read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2 + 1);
+      }
+    }
+  }
+  EmitLastLiterals(src + anchor, size - anchor, out);
+  return out->size() - start;
+}
+
+bool Lz4Decompress(const uint8_t* src, size_t size, uint8_t* dst,
+                   size_t dst_size) {
+  const uint8_t* ip = src;
+  const uint8_t* const end = src + size;
+  size_t op = 0;
+  while (ip < end) {
+    const uint8_t token = *ip++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !ReadLength(&ip, end, &literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<size_t>(end - ip) ||
+        literal_length > dst_size - op) {
+      return false;
+    }
+    std::memcpy(dst + op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    if (ip == end) break;  // 最后一个序列只有字面量
+
+    if (end - ip < 2) return false;
+    const size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) return false;
+    size_t match_length = token & 0x0F;
+    if (match_length == 15 && !ReadLength(&ip, end, &match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (match_length > dst_size - op) return false;
+    // 源和目标可能重叠（offset < match_length），逐字节复制
+    const uint8_t* match = dst + op - offset;
+    for (size_t i = 0; i < match_length; ++i) dst[op + i] = match[i];
+    op += match_length;
+  }
+  return op == dst_size;
+}
+
+}  // namespace cfvpn
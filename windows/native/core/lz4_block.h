@@ -0,0 +1,23 @@
+#ifndef NATIVE_CORE_LZ4_BLOCK_H_
+#define NATIVE_CORE_LZ4_BLOCK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cfvpn {
+
+// LZ4 块格式（https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md）
+// 的最小实现：单遍贪心匹配、4096 项哈希表，压缩和解压都不需要外部依赖。
+// 输出与官方解码器兼容，但不追求官方实现的速度。
+
+// 压缩 src 并追加到 out，返回追加的字节数
+size_t Lz4Compress(const uint8_t* src, size_t size, std::string* out);
+
+// 解压恰好 dst_size 字节到 dst；输入损坏或大小不符时返回 false
+bool Lz4Decompress(const uint8_t* src, size_t size, uint8_t* dst,
+                   size_t dst_size);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_LZ4_BLOCK_H_
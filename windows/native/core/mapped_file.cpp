@@ -0,0 +1,154 @@
+#include "core/mapped_file.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cfvpn {
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+#if defined(_WIN32)
+
+namespace {
+
+std::wstring Utf8ToWide(const std::string& text) {
+  int length = ::MultiByteToWideChar(CP_UTF8, 0, text.data(),
+                                     static_cast<int>(text.size()), nullptr, 0);
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  if (length > 0) {
+    ::MultiByteToWideChar(CP_UTF8, 0, text.data(),
+                          static_cast<int>(text.size()), &wide[0], length);
+  }
+  return wide;
+}
+
+}  // namespace
+
+bool MappedFile::Open(const std::string& path, size_t size) {
+  Close();
+  if (size == 0) {
+    return false;
+  }
+  HANDLE file = ::CreateFileW(Utf8ToWide(path).c_str(),
+                              GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                              nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER current;
+  LARGE_INTEGER wanted;
+  wanted.QuadPart = static_cast<LONGLONG>(size);
+  if (!::GetFileSizeEx(file, &current) ||
+      (current.QuadPart != wanted.QuadPart &&
+       (!::SetFilePointerEx(file, wanted, nullptr, FILE_BEGIN) ||
+        !::SetEndOfFile(file)))) {
+    ::CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = ::CreateFileMappingW(
+      file, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+      static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+  if (mapping == nullptr) {
+    ::CloseHandle(file);
+    return false;
+  }
+  void* view = ::MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0,
+                               size);
+  if (view == nullptr) {
+    ::CloseHandle(mapping);
+    ::CloseHandle(file);
+    return false;
+  }
+  file_ = file;
+  mapping_ = mapping;
+  data_ = static_cast<uint8_t*>(view);
+  size_ = size;
+  original_size_ = static_cast<uint64_t>(current.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    ::FlushViewOfFile(data_, 0);
+    ::UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+  if (mapping_ != nullptr) {
+    ::CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+  if (file_ != nullptr) {
+    ::CloseHandle(file_);
+    file_ = nullptr;
+  }
+  size_ = 0;
+}
+
+bool MappedFile::Flush() {
+  return data_ != nullptr && ::FlushViewOfFile(data_, 0) != 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, size_t size) {
+  Close();
+  if (size == 0) {
+    return false;
+  }
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0 ||
+      (static_cast<uint64_t>(info.st_size) != size &&
+       ::ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+    ::close(fd);
+    return false;
+  }
+  void* view =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (view == MAP_FAILED) {
+    ::close(fd);
+    return false;
+  }
+  fd_ = fd;
+  data_ = static_cast<uint8_t*>(view);
+  size_ = size;
+  original_size_ = static_cast<uint64_t>(info.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    ::msync(data_, size_, MS_ASYNC);
+    ::munmap(data_, size_);
+    data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+}
+
+bool MappedFile::Flush() {
+  return data_ != nullptr && ::msync(data_, size_, MS_ASYNC) == 0;
+}
+
+#endif
+
+}  // namespace cfvpn
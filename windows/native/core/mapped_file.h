@@ -0,0 +1,53 @@
+#ifndef NATIVE_CORE_MAPPED_FILE_H_
+#define NATIVE_CORE_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cfvpn {
+
+// 以读写方式映射到内存的文件（Windows 上为 CreateFileMapping，
+// 其他平台为 mmap）。
+//
+// 写入映射区的数据由系统在后台写回，进程崩溃不会丢失已写入的内容；
+// Flush() 只是尽早发起写回，以减少断电时的损失。
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // 打开（不存在时创建）path 并把文件大小调整为恰好 size 字节后整体映射。
+  // 扩展出来的部分为零。path 为 UTF-8。
+  bool Open(const std::string& path, size_t size);
+
+  void Close();
+
+  // 异步发起脏页写回
+  bool Flush();
+
+  bool is_open() const { return data_ != nullptr; }
+  uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // 打开前文件的大小，新建的文件为 0
+  uint64_t original_size() const { return original_size_; }
+
+ private:
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  uint64_t original_size_ = 0;
+#if defined(_WIN32)
+  void* file_ = nullptr;     // HANDLE
+  void* mapping_ = nullptr;  // HANDLE
+#else
+  int fd_ = -1;
+#endif
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_MAPPED_FILE_H_
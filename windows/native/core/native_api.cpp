@@ -0,0 +1,1636 @@
+#include "core/native_api.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/address_permutation.h"
+#include "core/async_logger.h"
+#include "core/cidr_sampler.h"
+#include "core/dns_resolver.h"
+#include "core/full_scanner.h"
+#include "core/health_monitor.h"
+#include "core/http_probe_engine.h"
+#include "core/ip_address.h"
+#include "core/local_relay.h"
+#include "core/node_cache.h"
+#include "core/process_supervisor.h"
+#include "core/range_bandit.h"
+#include "core/share_link.h"
+#include "core/startup_prewarm.h"
+#include "core/tcping_engine.h"
+#include "core/throughput_tester.h"
+#include "core/trace_recorder.h"
+#include "core/traffic_sampler.h"
+#include "core/v2ray_config.h"
+#include "core/v2ray_stats_client.h"
+
+struct CfvpnTcpingJob {
+  explicit CfvpnTcpingJob(const cfvpn::TcpingOptions& options)
+      : engine(options), done(false) {}
+
+  cfvpn::TcpingEngine engine;
+  // cfvpn_bandit_tcping_start 创建的任务由它代替 engine 分轮探测
+  std::unique_ptr<cfvpn::BanditProber> bandit;
+  std::vector<cfvpn::ProbeTarget> targets;
+  std::vector<cfvpn::ProbeResult> results;
+  std::atomic<bool> done;
+  std::thread worker;
+};
+
+struct CfvpnHttpProbeJob {
+  explicit CfvpnHttpProbeJob(const cfvpn::HttpProbeOptions& options)
+      : engine(options), done(false) {}
+
+  cfvpn::HttpProbeEngine engine;
+  std::vector<cfvpn::ProbeTarget> targets;
+  std::vector<cfvpn::HttpProbeResult> results;
+  std::atomic<bool> done;
+  std::thread worker;
+};
+
+struct CfvpnThroughputJob {
+  explicit CfvpnThroughputJob(const cfvpn::ThroughputOptions& options)
+      : tester(options), done(false) {}
+
+  cfvpn::ThroughputTester tester;
+  cfvpn::ProbeTarget target;
+  cfvpn::ThroughputResult result;
+  std::atomic<bool> done;
+  std::thread worker;
+};
+
+struct CfvpnCidrIndex {
+  explicit CfvpnCidrIndex(std::vector<cfvpn::Ipv4Range> ranges)
+      : index(std::move(ranges)), sampler(index) {}
+
+  cfvpn::Ipv4RangeIndex index;
+  std::mutex mutex;  // 保护 sampler 的去重位图
+  cfvpn::CidrSampler sampler;
+};
+
+struct CfvpnAddressSampler {
+  CfvpnAddressSampler(const std::vector<cfvpn::IpPrefix>& prefixes,
+                      uint64_t seed)
+      : permutation(prefixes, seed) {}
+
+  cfvpn::AddressPermutation permutation;
+  std::mutex mutex;
+};
+
+struct CfvpnFullScanJob {
+  explicit CfvpnFullScanJob(const cfvpn::FullScanOptions& options)
+      : scanner(options),
+        port(options.port),
+        state(CFVPN_FULL_SCAN_RUNNING) {}
+
+  cfvpn::FullScanner scanner;
+  uint16_t port;
+  std::atomic<int32_t> state;
+  std::string error;  // state 变为 FAILED 之前写入
+  std::thread worker;
+};
+
+struct CfvpnStatsClient {
+  explicit CfvpnStatsClient(const cfvpn::V2rayStatsOptions& options)
+      : client(options) {}
+
+  cfvpn::V2rayStatsClient client;
+  std::mutex mutex;
+  std::vector<cfvpn::StatsCounter> counters;  // 复用，避免每次查询重新分配
+};
+
+struct CfvpnLogger {
+  explicit CfvpnLogger(const cfvpn::AsyncLoggerOptions& options)
+      : logger(options) {}
+
+  cfvpn::AsyncLogger logger;
+};
+
+struct CfvpnTrafficSampler {
+  CfvpnTrafficSampler(const cfvpn::TrafficRingOptions& ring_options,
+                      const cfvpn::V2rayStatsOptions& stats_options,
+                      std::string pattern)
+      : client(stats_options),
+        pattern(std::move(pattern)),
+        sampler(ring_options, [this](int64_t* up, int64_t* down) {
+          return Query(up, down);
+        }) {}
+
+  // 只在采样线程中调用
+  bool Query(int64_t* up, int64_t* down) {
+    if (!client.QueryStats(pattern, false, &counters)) return false;
+    *up = 0;
+    *down = 0;
+    for (const cfvpn::StatsCounter& counter : counters) {
+      if (EndsWith(counter.name, ">>>uplink")) {
+        *up += counter.value;
+      } else if (EndsWith(counter.name, ">>>downlink")) {
+        *down += counter.value;
+      }
+    }
+    return true;
+  }
+
+  static bool EndsWith(const std::string& text, const char* suffix) {
+    const size_t length = std::strlen(suffix);
+    return text.size() >= length &&
+           text.compare(text.size() - length, length, suffix) == 0;
+  }
+
+  cfvpn::V2rayStatsClient client;
+  std::string pattern;
+  std::vector<cfvpn::StatsCounter> counters;
+  cfvpn::TrafficSampler sampler;  // 最后构造、最先析构，保证线程先停止
+};
+
+struct CfvpnNodeCache {
+  cfvpn::NodeCache cache;
+  std::mutex mutex;  // 测速结果的写入与启动时的查询可能来自不同线程
+};
+
+struct CfvpnConfigBuilder {
+  const std::string& Build(const CfvpnV2rayConfigParams* in) {
+    params.server_ip = in->server_ip != nullptr ? in->server_ip : "";
+    params.server_name = in->server_name != nullptr ? in->server_name : "";
+    params.user_id = in->user_id != nullptr ? in->user_id : "";
+    params.server_port = in->server_port;
+    params.socks_port = in->socks_port;
+    params.http_port = in->http_port;
+    params.global_proxy = in->global_proxy != 0;
+    return builder.Build(params);
+  }
+
+  cfvpn::V2rayConfigBuilder builder;
+  cfvpn::V2rayConfigParams params;  // 复用字符串的容量
+};
+
+struct CfvpnSupervisor {
+  explicit CfvpnSupervisor(cfvpn::SupervisorOptions options)
+      : supervisor(std::move(options), &CfvpnSupervisor::Output) {}
+
+  // v2ray 输出写入默认日志器；与 Dart 端一样过滤掉断线时的常见噪声
+  static void Output(std::string_view line, bool from_stderr) {
+    if (line.empty() ||
+        line.find("websocket: close") != std::string_view::npos ||
+        line.find("failed to process outbound traffic") !=
+            std::string_view::npos) {
+      return;
+    }
+    cfvpn::LogMessage(from_stderr ? cfvpn::LogLevel::kWarn
+                                  : cfvpn::LogLevel::kDebug,
+                      "V2Ray", line);
+  }
+
+  cfvpn::ProcessSupervisor supervisor;
+};
+
+struct CfvpnHealthMonitor {
+  CfvpnHealthMonitor(const cfvpn::HealthMonitorOptions& options,
+                     std::vector<cfvpn::ProbeTarget> nodes)
+      : monitor(options, std::move(nodes)) {}
+
+  cfvpn::HealthMonitor monitor;
+};
+
+struct CfvpnDnsResolver {
+  explicit CfvpnDnsResolver(const cfvpn::DnsResolverOptions& options)
+      : resolver(options) {}
+
+  cfvpn::DnsResolver resolver;
+};
+
+struct CfvpnDnsQuery {
+  // 回调可能在查询被释放之后才执行，因此结果放在共享的状态里
+  struct State {
+    std::mutex mutex;
+    cfvpn::DnsResult result;
+    std::atomic<bool> done{false};
+  };
+
+  std::shared_ptr<State> state = std::make_shared<State>();
+};
+
+struct CfvpnRelay {
+  explicit CfvpnRelay(const cfvpn::LocalRelayOptions& options)
+      : relay(options) {}
+
+  cfvpn::LocalRelay relay;
+};
+
+struct CfvpnPrewarm {
+  // 有意不析构：预热线程是分离的，进程退出时可能仍在运行
+  static CfvpnPrewarm& Instance() {
+    static CfvpnPrewarm* prewarm = new CfvpnPrewarm();
+    return *prewarm;
+  }
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  int32_t state = CFVPN_PREWARM_NOT_STARTED;
+  int64_t started_us = 0;
+  cfvpn::PrewarmReport report;
+  std::unique_ptr<CfvpnNodeCache> node_cache;
+  std::unique_ptr<CfvpnConfigBuilder> config_builder;
+};
+
+struct CfvpnLinkBatch {
+  CfvpnStringRef Intern(const std::string& value) {
+    const CfvpnStringRef ref = {static_cast<int32_t>(strings.size()),
+                                static_cast<int32_t>(value.size())};
+    strings.append(value);
+    return ref;
+  }
+
+  std::vector<CfvpnShareLink> records;
+  std::vector<CfvpnLinkError> errors;
+  std::string strings;
+};
+
+namespace {
+
+// cfvpn_bandit_tcping_start 默认只用 7 天内探测过的节点作为先验
+constexpr int64_t kBanditHistoryMaxAgeSec = 7 * 24 * 3600;
+
+cfvpn::TcpingOptions ToTcpingOptions(const CfvpnTcpingOptions* options) {
+  cfvpn::TcpingOptions engine_options;
+  if (options != nullptr) {
+    engine_options.attempts = options->attempts;
+    engine_options.timeout_ms = options->timeout_ms;
+    engine_options.min_valid_latency_ms = options->min_valid_latency_ms;
+    engine_options.interval_ms = options->interval_ms;
+    engine_options.max_inflight = options->max_inflight;
+    engine_options.adaptive_inflight = options->adaptive_inflight != 0;
+    if (options->min_inflight > 0) {
+      engine_options.min_inflight = options->min_inflight;
+    }
+    if (options->initial_inflight > 0) {
+      engine_options.initial_inflight = options->initial_inflight;
+    }
+    engine_options.stop_after_good = options->stop_after_good;
+    engine_options.good_latency_ms = options->good_latency_ms;
+    engine_options.good_loss_rate = options->good_loss_rate;
+    engine_options.failure_window = options->failure_window;
+    engine_options.failure_rate_threshold = options->failure_rate_threshold;
+    engine_options.extra_attempts = options->extra_attempts;
+    if (options->extra_jitter_ratio > 0) {
+      engine_options.extra_jitter_ratio = options->extra_jitter_ratio;
+    }
+    if (options->score_mean != 0 || options->score_p50 != 0 ||
+        options->score_p90 != 0 || options->score_p99 != 0 ||
+        options->score_jitter != 0) {
+      engine_options.score.mean = options->score_mean;
+      engine_options.score.p50 = options->score_p50;
+      engine_options.score.p90 = options->score_p90;
+      engine_options.score.p99 = options->score_p99;
+      engine_options.score.jitter = options->score_jitter;
+    }
+    engine_options.score.loss = options->score_loss;
+  }
+  return engine_options;
+}
+
+CfvpnTcpingJob* StartTcpingJob(const CfvpnTcpingOptions* options,
+                               std::vector<cfvpn::ProbeTarget> targets) {
+  CfvpnTcpingJob* job = new CfvpnTcpingJob(ToTcpingOptions(options));
+  job->targets = std::move(targets);
+  job->worker = std::thread([job]() {
+    job->engine.Run(job->targets, &job->results);
+    job->done.store(true, std::memory_order_release);
+  });
+  return job;
+}
+
+CfvpnHttpProbeJob* StartHttpProbeJob(const CfvpnHttpProbeOptions* options,
+                                     std::vector<cfvpn::ProbeTarget> targets) {
+  cfvpn::HttpProbeOptions engine_options;
+  if (options != nullptr) {
+    engine_options.requests = options->requests;
+    engine_options.timeout_ms = options->timeout_ms;
+    engine_options.max_inflight = options->max_inflight;
+    engine_options.expected_status = options->expected_status;
+    if (options->host != nullptr) {
+      engine_options.host = options->host;
+    }
+    if (options->path != nullptr && options->path[0] != '\0') {
+      engine_options.path = options->path;
+    }
+  }
+
+  CfvpnHttpProbeJob* job = new CfvpnHttpProbeJob(engine_options);
+  job->targets = std::move(targets);
+  job->worker = std::thread([job]() {
+    job->engine.Run(job->targets, &job->results);
+    job->done.store(true, std::memory_order_release);
+  });
+  return job;
+}
+
+std::vector<cfvpn::ProbeTarget> ToProbeTargets(
+    const CfvpnIpAddress* addresses, int32_t count, uint16_t port) {
+  std::vector<cfvpn::ProbeTarget> targets;
+  targets.reserve(static_cast<size_t>(std::max(0, count)));
+  for (int32_t i = 0; i < count; ++i) {
+    targets.push_back({cfvpn::IpAddressFromBytes(addresses[i].bytes,
+                                                 addresses[i].family == 6),
+                       port});
+  }
+  return targets;
+}
+
+}  // namespace
+
+extern "C" {
+
+CfvpnTcpingJob* cfvpn_tcping_start(const uint32_t* ips, int32_t count,
+                                   uint16_t port,
+                                   const CfvpnTcpingOptions* options) {
+  if (ips == nullptr || count <= 0) return nullptr;
+  std::vector<cfvpn::ProbeTarget> targets;
+  targets.reserve(static_cast<size_t>(count));
+  for (int32_t i = 0; i < count; ++i) {
+    targets.push_back({ips[i], port});
+  }
+  return StartTcpingJob(options, std::move(targets));
+}
+
+CfvpnTcpingJob* cfvpn_tcping_start_addresses(
+    const CfvpnIpAddress* addresses, int32_t count, uint16_t port,
+    const CfvpnTcpingOptions* options) {
+  if (addresses == nullptr || count <= 0) return nullptr;
+  return StartTcpingJob(options, ToProbeTargets(addresses, count, port));
+}
+
+int32_t cfvpn_tcping_completed(CfvpnTcpingJob* job) {
+  if (job->bandit) {
+    return static_cast<int32_t>(job->bandit->completed());
+  }
+  return static_cast<int32_t>(job->engine.completed());
+}
+
+int32_t cfvpn_tcping_is_done(CfvpnTcpingJob* job) {
+  return job->done.load(std::memory_order_acquire) ? 1 : 0;
+}
+
+int32_t cfvpn_tcping_results(CfvpnTcpingJob* job, CfvpnProbeResult* out,
+                             int32_t capacity) {
+  if (!job->done.load(std::memory_order_acquire)) {
+    return -1;
+  }
+  int32_t count = static_cast<int32_t>(
+      std::min<size_t>(job->results.size(), static_cast<size_t>(capacity)));
+  for (int32_t i = 0; i < count; ++i) {
+    const cfvpn::ProbeResult& result = job->results[i];
+    out[i].ip = result.ip;
+    out[i].port = result.port;
+    out[i].reserved = 0;
+    out[i].latency_ms = result.latency_ms;
+    out[i].sent = result.sent;
+    out[i].received = result.received;
+    out[i].loss_rate = result.loss_rate;
+    out[i].p50_ms = result.p50_ms;
+    out[i].p90_ms = result.p90_ms;
+    out[i].p99_ms = result.p99_ms;
+    out[i].jitter_ms = result.jitter_ms;
+    out[i].score = result.score;
+  }
+  return count;
+}
+
+int32_t cfvpn_tcping_inflight_limit(CfvpnTcpingJob* job) {
+  if (job->bandit) {
+    return job->bandit->inflight_limit();
+  }
+  return job->engine.inflight_limit();
+}
+
+int32_t cfvpn_tcping_stop_reason(CfvpnTcpingJob* job) {
+  if (job->bandit) {
+    return static_cast<int32_t>(job->bandit->stop_reason());
+  }
+  return static_cast<int32_t>(job->engine.stop_reason());
+}
+
+void cfvpn_tcping_cancel(CfvpnTcpingJob* job) {
+  job->engine.Cancel();
+  if (job->bandit) {
+    job->bandit->Cancel();
+  }
+}
+
+void cfvpn_tcping_free(CfvpnTcpingJob* job) {
+  if (job == nullptr) {
+    return;
+  }
+  cfvpn_tcping_cancel(job);
+  if (job->worker.joinable()) {
+    job->worker.join();
+  }
+  delete job;
+}
+
+CfvpnHttpProbeJob* cfvpn_http_probe_start(
+    const uint32_t* ips, int32_t count, uint16_t port,
+    const CfvpnHttpProbeOptions* options) {
+  if (ips == nullptr || count <= 0) return nullptr;
+  std::vector<cfvpn::ProbeTarget> targets;
+  targets.reserve(static_cast<size_t>(count));
+  for (int32_t i = 0; i < count; ++i) {
+    targets.push_back({ips[i], port});
+  }
+  return StartHttpProbeJob(options, std::move(targets));
+}
+
+CfvpnHttpProbeJob* cfvpn_http_probe_start_addresses(
+    const CfvpnIpAddress* addresses, int32_t count, uint16_t port,
+    const CfvpnHttpProbeOptions* options) {
+  if (addresses == nullptr || count <= 0) return nullptr;
+  return StartHttpProbeJob(options, ToProbeTargets(addresses, count, port));
+}
+
+int32_t cfvpn_http_probe_completed(CfvpnHttpProbeJob* job) {
+  return static_cast<int32_t>(job->engine.completed());
+}
+
+int32_t cfvpn_http_probe_is_done(CfvpnHttpProbeJob* job) {
+  return job->done.load(std::memory_order_acquire) ? 1 : 0;
+}
+
+int32_t cfvpn_http_probe_results(CfvpnHttpProbeJob* job,
+                                 CfvpnHttpProbeResult* out,
+                                 int32_t capacity) {
+  if (!job->done.load(std::memory_order_acquire)) {
+    return -1;
+  }
+  int32_t count = static_cast<int32_t>(
+      std::min<size_t>(job->results.size(), static_cast<size_t>(capacity)));
+  for (int32_t i = 0; i < count; ++i) {
+    const cfvpn::HttpProbeResult& result = job->results[i];
+    out[i].ip = result.ip;
+    out[i].port = result.port;
+    out[i].status = result.status;
+    out[i].connect_ms = result.connect_ms;
+    out[i].ttfb_ms = result.ttfb_ms;
+    out[i].total_ms = result.total_ms;
+    out[i].sent = result.sent;
+    out[i].received = result.received;
+    std::memcpy(out[i].colo, result.colo, sizeof(out[i].colo));
+    std::memcpy(out[i].loc, result.loc, sizeof(out[i].loc));
+  }
+  return count;
+}
+
+void cfvpn_http_probe_cancel(CfvpnHttpProbeJob* job) {
+  job->engine.Cancel();
+}
+
+void cfvpn_http_probe_free(CfvpnHttpProbeJob* job) {
+  if (job == nullptr) {
+    return;
+  }
+  job->engine.Cancel();
+  if (job->worker.joinable()) {
+    job->worker.join();
+  }
+  delete job;
+}
+
+CfvpnThroughputJob* cfvpn_throughput_start(
+    const CfvpnIpAddress* address, uint16_t port,
+    const CfvpnThroughputOptions* options) {
+  if (address == nullptr) {
+    return nullptr;
+  }
+  cfvpn::ThroughputOptions tester_options;
+  if (options != nullptr) {
+    if (options->connections > 0) {
+      tester_options.connections = options->connections;
+    }
+    if (options->duration_ms > 0) {
+      tester_options.duration_ms = options->duration_ms;
+    }
+    if (options->connect_timeout_ms > 0) {
+      tester_options.connect_timeout_ms = options->connect_timeout_ms;
+    }
+    if (options->sample_interval_ms > 0) {
+      tester_options.sample_interval_ms = options->sample_interval_ms;
+    }
+    if (options->host != nullptr) {
+      tester_options.host = options->host;
+    }
+    if (options->path != nullptr && options->path[0] != '\0') {
+      tester_options.path = options->path;
+    }
+  }
+
+  CfvpnThroughputJob* job = new CfvpnThroughputJob(tester_options);
+  job->target = {cfvpn::IpAddressFromBytes(address->bytes,
+                                           address->family == 6),
+                 port};
+  job->worker = std::thread([job]() {
+    job->tester.Run(job->target, &job->result);
+    job->done.store(true, std::memory_order_release);
+  });
+  return job;
+}
+
+int64_t cfvpn_throughput_bytes(CfvpnThroughputJob* job) {
+  return job->tester.bytes();
+}
+
+int32_t cfvpn_throughput_is_done(CfvpnThroughputJob* job) {
+  return job->done.load(std::memory_order_acquire) ? 1 : 0;
+}
+
+int32_t cfvpn_throughput_result(CfvpnThroughputJob* job,
+                                CfvpnThroughputResult* out) {
+  if (!job->done.load(std::memory_order_acquire)) {
+    return -1;
+  }
+  const cfvpn::ThroughputResult& result = job->result;
+  *out = CfvpnThroughputResult();
+  out->bytes = result.bytes;
+  out->sustained_mbps = result.sustained_mbps;
+  out->peak_mbps = result.peak_mbps;
+  out->connected = result.connected;
+  out->failed = result.failed;
+  out->connect_ms = result.connect_ms;
+  out->ttfb_ms = result.ttfb_ms;
+  out->ramp_up_ms = result.ramp_up_ms;
+  out->elapsed_ms = result.elapsed_ms;
+  out->status = result.status;
+  out->sample_count = static_cast<int32_t>(result.samples_mbps.size());
+  return 0;
+}
+
+int32_t cfvpn_throughput_samples(CfvpnThroughputJob* job, double* out,
+                                 int32_t capacity) {
+  if (!job->done.load(std::memory_order_acquire)) {
+    return -1;
+  }
+  const std::vector<double>& samples = job->result.samples_mbps;
+  const int32_t count = static_cast<int32_t>(
+      std::min<size_t>(samples.size(), static_cast<size_t>(capacity)));
+  std::copy(samples.begin(), samples.begin() + count, out);
+  return count;
+}
+
+void cfvpn_throughput_cancel(CfvpnThroughputJob* job) {
+  job->tester.Cancel();
+}
+
+void cfvpn_throughput_free(CfvpnThroughputJob* job) {
+  if (job == nullptr) {
+    return;
+  }
+  job->tester.Cancel();
+  if (job->worker.joinable()) {
+    job->worker.join();
+  }
+  delete job;
+}
+
+CfvpnCidrIndex* cfvpn_cidr_index_create(const char* cidr_list,
+                                        int32_t* invalid_count) {
+  std::vector<cfvpn::Ipv4Range> ranges;
+  size_t invalid = 0;
+  if (cidr_list != nullptr) {
+    invalid = cfvpn::ParseCidrList(cidr_list, &ranges);
+  }
+  if (invalid_count != nullptr) {
+    *invalid_count = static_cast<int32_t>(invalid);
+  }
+  if (ranges.empty()) {
+    return nullptr;
+  }
+  return new CfvpnCidrIndex(std::move(ranges));
+}
+
+int32_t cfvpn_cidr_index_range_count(CfvpnCidrIndex* index) {
+  return static_cast<int32_t>(index->index.ranges().size());
+}
+
+int64_t cfvpn_cidr_index_address_count(CfvpnCidrIndex* index) {
+  return static_cast<int64_t>(index->index.address_count());
+}
+
+int32_t cfvpn_cidr_sample(CfvpnCidrIndex* index, uint32_t* out, int32_t count,
+                          uint64_t seed) {
+  if (count <= 0) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(index->mutex);
+  return static_cast<int32_t>(
+      index->sampler.Sample(static_cast<size_t>(count), seed, out));
+}
+
+void cfvpn_cidr_index_free(CfvpnCidrIndex* index) {
+  delete index;
+}
+
+CfvpnAddressSampler* cfvpn_address_sampler_create(const char* prefix_list,
+                                                  uint64_t seed,
+                                                  int32_t* invalid_count) {
+  std::vector<cfvpn::IpPrefix> prefixes;
+  size_t invalid = 0;
+  if (prefix_list != nullptr) {
+    invalid = cfvpn::ParseIpPrefixList(prefix_list, &prefixes);
+  }
+  if (invalid_count != nullptr) {
+    *invalid_count = static_cast<int32_t>(invalid);
+  }
+  if (prefixes.empty()) {
+    return nullptr;
+  }
+  return new CfvpnAddressSampler(prefixes, seed);
+}
+
+int32_t cfvpn_address_sampler_next(CfvpnAddressSampler* sampler,
+                                   CfvpnIpAddress* out, int32_t count) {
+  std::lock_guard<std::mutex> lock(sampler->mutex);
+  int32_t written = 0;
+  cfvpn::IpAddress address;
+  while (written < count && sampler->permutation.Next(&address)) {
+    CfvpnIpAddress& item = out[written++];
+    std::memset(&item, 0, sizeof(item));
+    item.family = address.v6 ? 6 : 4;
+    cfvpn::IpAddressBytes(address, item.bytes);
+  }
+  return written;
+}
+
+void cfvpn_address_sampler_free(CfvpnAddressSampler* sampler) {
+  delete sampler;
+}
+
+CfvpnFullScanJob* cfvpn_full_scan_start(const CfvpnFullScanOptions* options) {
+  if (options == nullptr || options->output_path == nullptr ||
+      options->output_path[0] == '\0') {
+    return nullptr;
+  }
+  cfvpn::FullScanOptions scan_options;
+  if (options->ranges != nullptr && options->ranges[0] != '\0') {
+    scan_options.ranges.clear();
+    cfvpn::ParseCidrList(options->ranges, &scan_options.ranges);
+    if (scan_options.ranges.empty()) {
+      return nullptr;
+    }
+  }
+  scan_options.output_path = options->output_path;
+  if (options->checkpoint_path != nullptr) {
+    scan_options.checkpoint_path = options->checkpoint_path;
+  }
+  if (options->seed != 0) {
+    scan_options.seed = options->seed;
+  }
+  scan_options.port = options->port;
+  if (options->min_valid_latency_ms >= 0) {
+    scan_options.tcping.min_valid_latency_ms = options->min_valid_latency_ms;
+  }
+  if (options->max_latency_ms > 0) {
+    scan_options.max_latency_ms = options->max_latency_ms;
+  }
+  if (options->attempts > 0) {
+    scan_options.tcping.attempts = options->attempts;
+  }
+  if (options->max_inflight > 0) {
+    scan_options.tcping.max_inflight = options->max_inflight;
+    scan_options.tcping.initial_inflight =
+        std::min(scan_options.tcping.initial_inflight, options->max_inflight);
+    scan_options.tcping.min_inflight =
+        std::min(scan_options.tcping.min_inflight, options->max_inflight);
+  }
+  if (options->chunk_blocks > 0) {
+    scan_options.chunk_blocks = options->chunk_blocks;
+  }
+  if (options->keep_best > 0) {
+    scan_options.keep_best = options->keep_best;
+  }
+  scan_options.write_failures = options->write_failures != 0;
+  scan_options.restart = options->restart != 0;
+
+  CfvpnFullScanJob* job = new CfvpnFullScanJob(scan_options);
+  job->worker = std::thread([job]() {
+    std::string error;
+    int32_t state = CFVPN_FULL_SCAN_COMPLETED;
+    if (!job->scanner.Run(&error)) {
+      job->error = std::move(error);
+      state = CFVPN_FULL_SCAN_FAILED;
+    } else if (job->scanner.cancelled()) {
+      state = CFVPN_FULL_SCAN_CANCELLED;
+    }
+    job->state.store(state, std::memory_order_release);
+  });
+  return job;
+}
+
+void cfvpn_full_scan_status(CfvpnFullScanJob* job, CfvpnFullScanStatus* out) {
+  out->state = job->state.load(std::memory_order_acquire);
+  out->total_blocks = static_cast<int64_t>(job->scanner.total_blocks());
+  out->done_blocks = static_cast<int64_t>(job->scanner.done_blocks());
+  out->resumed_from = static_cast<int64_t>(job->scanner.resumed_from());
+  out->reachable = static_cast<int64_t>(job->scanner.reachable());
+  out->reserved = 0;
+}
+
+int32_t cfvpn_full_scan_best(CfvpnFullScanJob* job, CfvpnProbeResult* out,
+                             int32_t capacity) {
+  if (job->state.load(std::memory_order_acquire) ==
+      CFVPN_FULL_SCAN_RUNNING) {
+    return -1;
+  }
+  const std::vector<cfvpn::FullScanNode>& best = job->scanner.best();
+  const int32_t count = static_cast<int32_t>(
+      std::min<size_t>(best.size(), static_cast<size_t>(capacity)));
+  for (int32_t i = 0; i < count; ++i) {
+    out[i].ip = best[i].ip;
+    out[i].port = job->port;
+    out[i].reserved = 0;
+    out[i].latency_ms = best[i].latency_ms;
+    out[i].sent = 0;
+    out[i].received = 0;
+    out[i].loss_rate = best[i].loss_rate;
+    // 检查点只保存平均延迟
+    out[i].p50_ms = out[i].p90_ms = out[i].p99_ms = best[i].latency_ms;
+    out[i].jitter_ms = 0;
+    out[i].score = static_cast<float>(best[i].latency_ms);
+  }
+  return count;
+}
+
+int32_t cfvpn_full_scan_error(CfvpnFullScanJob* job, char* out,
+                              int32_t capacity) {
+  if (job->state.load(std::memory_order_acquire) !=
+      CFVPN_FULL_SCAN_FAILED) {
+    if (capacity > 0) out[0] = '\0';
+    return 0;
+  }
+  const std::string& error = job->error;
+  if (capacity > 0) {
+    const size_t length =
+        std::min(error.size(), static_cast<size_t>(capacity) - 1);
+    std::memcpy(out, error.data(), length);
+    out[length] = '\0';
+  }
+  return static_cast<int32_t>(error.size());
+}
+
+void cfvpn_full_scan_cancel(CfvpnFullScanJob* job) {
+  job->scanner.Cancel();
+}
+
+void cfvpn_full_scan_free(CfvpnFullScanJob* job) {
+  if (job == nullptr) {
+    return;
+  }
+  job->scanner.Cancel();
+  if (job->worker.joinable()) {
+    job->worker.join();
+  }
+  delete job;
+}
+
+CfvpnNodeCache* cfvpn_node_cache_open(const char* path, int32_t capacity) {
+  if (path == nullptr) {
+    return nullptr;
+  }
+  cfvpn::NodeCacheOptions options;
+  if (capacity > 0) {
+    options.capacity = static_cast<uint32_t>(capacity);
+  }
+  auto* cache = new CfvpnNodeCache();
+  if (!cache->cache.Open(path, options)) {
+    delete cache;
+    return nullptr;
+  }
+  return cache;
+}
+
+int32_t cfvpn_node_cache_size(CfvpnNodeCache* cache) {
+  std::lock_guard<std::mutex> lock(cache->mutex);
+  return static_cast<int32_t>(cache->cache.size());
+}
+
+void cfvpn_node_cache_update(CfvpnNodeCache* cache,
+                             const CfvpnNodeSample* samples, int32_t count,
+                             int64_t now) {
+  std::lock_guard<std::mutex> lock(cache->mutex);
+  for (int32_t i = 0; i < count; ++i) {
+    cfvpn::NodeSample sample;
+    sample.ip = samples[i].ip;
+    sample.latency_ms = samples[i].latency_ms;
+    sample.loss_rate = samples[i].loss_rate;
+    std::memcpy(sample.colo, samples[i].colo, sizeof(sample.colo));
+    cache->cache.Update(sample, now);
+  }
+  if (count > 0) {
+    cache->cache.Flush();
+  }
+}
+
+int32_t cfvpn_node_cache_best(CfvpnNodeCache* cache, CfvpnNodeQuality* out,
+                              int32_t capacity, int64_t now,
+                              int32_t max_age_sec,
+                              int32_t max_failure_streak) {
+  if (capacity <= 0) {
+    return 0;
+  }
+  std::vector<cfvpn::NodeQuality> best(static_cast<size_t>(capacity));
+  size_t count;
+  {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    count = cache->cache.Best(now, max_age_sec,
+                              static_cast<uint32_t>(
+                                  std::max<int32_t>(1, max_failure_streak)),
+                              best.data(), best.size());
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const cfvpn::NodeQuality& quality = best[i];
+    CfvpnNodeQuality& entry = out[i];
+    entry.ip = quality.ip;
+    entry.latency_ms = quality.latency_ms;
+    entry.loss_rate = quality.loss_rate;
+    entry.score = quality.score;
+    entry.last_seen = quality.last_seen;
+    entry.samples = static_cast<int32_t>(quality.samples);
+    entry.failure_streak = static_cast<int32_t>(quality.failure_streak);
+    std::memcpy(entry.colo, quality.colo, sizeof(entry.colo));
+    entry.reserved = 0;
+  }
+  return static_cast<int32_t>(count);
+}
+
+void cfvpn_node_cache_close(CfvpnNodeCache* cache) {
+  delete cache;
+}
+
+CfvpnTcpingJob* cfvpn_bandit_tcping_start(const char* cidr_list,
+                                          int32_t budget, uint16_t port,
+                                          const CfvpnTcpingOptions* options,
+                                          const CfvpnBanditOptions* bandit) {
+  std::vector<cfvpn::Ipv4Range> ranges;
+  if (cidr_list != nullptr) {
+    cfvpn::ParseCidrList(cidr_list, &ranges);
+  }
+  if (ranges.empty()) {
+    return nullptr;
+  }
+  cfvpn::RangeBanditOptions bandit_options;
+  int64_t max_age = kBanditHistoryMaxAgeSec;
+  CfvpnNodeCache* history = nullptr;
+  uint64_t seed = 0;
+  if (bandit != nullptr) {
+    bandit_options.policy = bandit->policy == 1 ? cfvpn::BanditPolicy::kUcb
+                                                : cfvpn::BanditPolicy::kThompson;
+    if (bandit->arm_prefix > 0) bandit_options.arm_prefix = bandit->arm_prefix;
+    if (bandit->batch > 0) bandit_options.batch = bandit->batch;
+    if (bandit->prior_weight > 0) {
+      bandit_options.prior_weight = bandit->prior_weight;
+    }
+    if (bandit->max_prior > 0) bandit_options.max_prior = bandit->max_prior;
+    if (bandit->history_max_age_sec > 0) {
+      max_age = bandit->history_max_age_sec;
+    }
+    history = bandit->history;
+    seed = bandit->seed;
+  }
+  if (seed == 0) {
+    seed = static_cast<uint64_t>(
+        std::chrono::system_clock::now().time_since_epoch().count());
+  }
+
+  const cfvpn::TcpingOptions engine_options = ToTcpingOptions(options);
+  CfvpnTcpingJob* job = new CfvpnTcpingJob(engine_options);
+  job->bandit = std::make_unique<cfvpn::BanditProber>(
+      ranges, engine_options, bandit_options, seed);
+  if (history != nullptr) {
+    std::vector<cfvpn::NodeQuality> nodes;
+    {
+      std::lock_guard<std::mutex> lock(history->mutex);
+      const int64_t now =
+          std::chrono::duration_cast<std::chrono::seconds>(
+              std::chrono::system_clock::now().time_since_epoch())
+              .count();
+      nodes.resize(history->cache.size());
+      nodes.resize(history->cache.Best(now, max_age, UINT32_MAX, nodes.data(),
+                                       nodes.size()));
+    }
+    job->bandit->AddHistory(nodes.data(), nodes.size());
+  }
+  const size_t limit = static_cast<size_t>(std::max(0, budget));
+  job->worker = std::thread([job, port, limit]() {
+    job->bandit->Run(port, limit, &job->results);
+    job->done.store(true, std::memory_order_release);
+  });
+  return job;
+}
+
+CfvpnStatsClient* cfvpn_stats_client_create(uint16_t port,
+                                            int32_t timeout_ms) {
+  cfvpn::V2rayStatsOptions options;
+  options.port = port;
+  if (timeout_ms > 0) {
+    options.timeout_ms = timeout_ms;
+  }
+  return new CfvpnStatsClient(options);
+}
+
+int32_t cfvpn_stats_query(CfvpnStatsClient* client, const char* pattern,
+                          int32_t reset, CfvpnStatsCounter* out,
+                          int32_t capacity) {
+  std::lock_guard<std::mutex> lock(client->mutex);
+  if (!client->client.QueryStats(pattern != nullptr ? pattern : "", reset != 0,
+                                 &client->counters)) {
+    return -1;
+  }
+  const size_t count = std::min(client->counters.size(),
+                                static_cast<size_t>(std::max(0, capacity)));
+  for (size_t i = 0; i < count; ++i) {
+    const cfvpn::StatsCounter& counter = client->counters[i];
+    const size_t length =
+        std::min(counter.name.size(), sizeof(out[i].name) - 1);
+    std::memcpy(out[i].name, counter.name.data(), length);
+    out[i].name[length] = '\0';
+    out[i].value = counter.value;
+  }
+  return static_cast<int32_t>(client->counters.size());
+}
+
+int32_t cfvpn_stats_last_error(CfvpnStatsClient* client, char* out,
+                               int32_t capacity) {
+  std::lock_guard<std::mutex> lock(client->mutex);
+  const std::string& error = client->client.last_error();
+  if (capacity > 0) {
+    const size_t length =
+        std::min(error.size(), static_cast<size_t>(capacity) - 1);
+    std::memcpy(out, error.data(), length);
+    out[length] = '\0';
+  }
+  return static_cast<int32_t>(error.size());
+}
+
+void cfvpn_stats_client_free(CfvpnStatsClient* client) {
+  delete client;
+}
+
+CfvpnTrafficSampler* cfvpn_traffic_sampler_start(uint16_t port,
+                                                 int32_t interval_ms,
+                                                 const char* pattern) {
+  cfvpn::TrafficRingOptions ring_options;
+  if (interval_ms > 0) {
+    ring_options.sample_interval_ms = interval_ms;
+  }
+  cfvpn::V2rayStatsOptions stats_options;
+  stats_options.port = port;
+  // 查询超时不超过一个采样周期，v2ray 未响应时不会拖慢节拍
+  stats_options.timeout_ms = ring_options.sample_interval_ms;
+  CfvpnTrafficSampler* sampler = new CfvpnTrafficSampler(
+      ring_options, stats_options, pattern != nullptr ? pattern : "");
+  sampler->sampler.Start();
+  return sampler;
+}
+
+const void* cfvpn_traffic_sampler_ring(CfvpnTrafficSampler* sampler) {
+  return sampler->sampler.ring().header();
+}
+
+int64_t cfvpn_traffic_sampler_ring_size(CfvpnTrafficSampler* sampler) {
+  return static_cast<int64_t>(sampler->sampler.ring().size_bytes());
+}
+
+void cfvpn_traffic_sampler_free(CfvpnTrafficSampler* sampler) {
+  delete sampler;
+}
+
+CfvpnLogger* cfvpn_log_open(const char* directory, int64_t max_file_bytes,
+                            int32_t max_backups, int32_t max_open_files,
+                            int32_t binary) {
+  cfvpn::AsyncLoggerOptions options;
+  options.directory = directory != nullptr ? directory : "";
+  options.binary = binary != 0;
+  if (max_file_bytes > 0) {
+    options.max_file_bytes = max_file_bytes;
+  }
+  if (max_backups > 0) {
+    options.max_backups = max_backups;
+  }
+  if (max_open_files > 0) {
+    options.max_open_files = max_open_files;
+  }
+  CfvpnLogger* logger = new CfvpnLogger(options);
+  logger->logger.Start();
+  cfvpn::SetDefaultLogger(&logger->logger);
+  return logger;
+}
+
+int32_t cfvpn_log_write(CfvpnLogger* logger, int32_t level, const char* tag,
+                        int32_t tag_length, const char* message,
+                        int32_t message_length) {
+  const int32_t clamped = std::min(std::max(level, 0), CFVPN_LOG_ERROR);
+  return logger->logger.Write(
+             static_cast<cfvpn::LogLevel>(clamped),
+             std::string_view(tag, static_cast<size_t>(std::max(tag_length, 0))),
+             std::string_view(message,
+                              static_cast<size_t>(std::max(message_length, 0))))
+             ? 1
+             : 0;
+}
+
+void cfvpn_log_flush(CfvpnLogger* logger) {
+  logger->logger.Flush();
+}
+
+void cfvpn_log_close_files(CfvpnLogger* logger) {
+  logger->logger.CloseFiles();
+}
+
+int64_t cfvpn_log_dropped(CfvpnLogger* logger) {
+  return static_cast<int64_t>(logger->logger.dropped());
+}
+
+void cfvpn_log_close(CfvpnLogger* logger) {
+  delete logger;
+}
+
+CfvpnConfigBuilder* cfvpn_config_builder_create(const char* template_json,
+                                                int32_t length) {
+  if (template_json == nullptr || length < 0) return nullptr;
+  CfvpnConfigBuilder* builder = new CfvpnConfigBuilder();
+  if (!builder->builder.LoadTemplate(
+          std::string_view(template_json, static_cast<size_t>(length)),
+          nullptr)) {
+    delete builder;
+    return nullptr;
+  }
+  return builder;
+}
+
+const char* cfvpn_config_builder_build(CfvpnConfigBuilder* builder,
+                                       const CfvpnV2rayConfigParams* params,
+                                       int32_t* length) {
+  const std::string& config = builder->Build(params);
+  *length = static_cast<int32_t>(config.size());
+  return config.data();
+}
+
+int32_t cfvpn_config_builder_write(CfvpnConfigBuilder* builder,
+                                   const CfvpnV2rayConfigParams* params,
+                                   const char* path) {
+  namespace fs = std::filesystem;
+  const std::string& config = builder->Build(params);
+  const fs::path target = fs::u8path(path);
+  fs::path temporary = target;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(config.data(), static_cast<std::streamsize>(config.size()));
+    if (!file.flush()) return -1;
+  }
+  std::error_code error;
+  fs::rename(temporary, target, error);
+  if (error) {
+    fs::remove(temporary, error);
+    return -1;
+  }
+  return static_cast<int32_t>(config.size());
+}
+
+void cfvpn_config_builder_free(CfvpnConfigBuilder* builder) {
+  delete builder;
+}
+
+CfvpnLinkBatch* cfvpn_links_parse(const char* data, int32_t length) {
+  std::vector<cfvpn::ShareLink> links;
+  std::vector<cfvpn::LinkError> errors;
+  cfvpn::ParseSubscription(
+      std::string_view(data, static_cast<size_t>(std::max(length, 0))), &links,
+      &errors);
+
+  CfvpnLinkBatch* batch = new CfvpnLinkBatch();
+  batch->records.resize(links.size());
+  for (size_t i = 0; i < links.size(); ++i) {
+    const cfvpn::ShareLink& link = links[i];
+    CfvpnShareLink& record = batch->records[i];
+    record.protocol = static_cast<int32_t>(link.protocol);
+    record.port = link.port;
+    record.line = link.line;
+    record.reserved = 0;
+    record.name = batch->Intern(link.name);
+    record.address = batch->Intern(link.address);
+    record.user_id = batch->Intern(link.user_id);
+    record.method = batch->Intern(link.method);
+    record.network = batch->Intern(link.network);
+    record.security = batch->Intern(link.security);
+    record.host = batch->Intern(link.host);
+    record.path = batch->Intern(link.path);
+    record.sni = batch->Intern(link.sni);
+  }
+  batch->errors.resize(errors.size());
+  for (size_t i = 0; i < errors.size(); ++i) {
+    batch->errors[i].line = errors[i].line;
+    batch->errors[i].message = batch->Intern(errors[i].message);
+  }
+  return batch;
+}
+
+int32_t cfvpn_links_count(CfvpnLinkBatch* batch) {
+  return static_cast<int32_t>(batch->records.size());
+}
+
+const CfvpnShareLink* cfvpn_links_records(CfvpnLinkBatch* batch) {
+  return batch->records.data();
+}
+
+int32_t cfvpn_links_error_count(CfvpnLinkBatch* batch) {
+  return static_cast<int32_t>(batch->errors.size());
+}
+
+const CfvpnLinkError* cfvpn_links_errors(CfvpnLinkBatch* batch) {
+  return batch->errors.data();
+}
+
+const char* cfvpn_links_strings(CfvpnLinkBatch* batch) {
+  return batch->strings.data();
+}
+
+int32_t cfvpn_links_strings_size(CfvpnLinkBatch* batch) {
+  return static_cast<int32_t>(batch->strings.size());
+}
+
+void cfvpn_links_free(CfvpnLinkBatch* batch) {
+  delete batch;
+}
+
+CfvpnSupervisor* cfvpn_supervisor_start(const CfvpnSupervisorOptions* options) {
+  if (options == nullptr || options->executable == nullptr) return nullptr;
+  cfvpn::SupervisorOptions copy;
+  copy.process.executable = options->executable;
+  if (options->working_directory != nullptr) {
+    copy.process.working_directory = options->working_directory;
+  }
+  for (int32_t i = 0; i < options->argument_count; ++i) {
+    copy.process.arguments.emplace_back(options->arguments[i]);
+  }
+  for (int32_t i = 0; i < options->ready_port_count; ++i) {
+    copy.ready_ports.push_back(options->ready_ports[i]);
+  }
+  if (options->ready_timeout_ms > 0) {
+    copy.ready_timeout_ms = options->ready_timeout_ms;
+  }
+  if (options->max_restarts != 0) {
+    copy.max_restarts = std::max(options->max_restarts, 0);
+  }
+  if (options->backoff_initial_ms > 0) {
+    copy.backoff_initial_ms = options->backoff_initial_ms;
+  }
+  if (options->backoff_max_ms > 0) {
+    copy.backoff_max_ms = options->backoff_max_ms;
+  }
+  if (options->stop_grace_ms > 0) {
+    copy.stop_grace_ms = options->stop_grace_ms;
+  }
+  CfvpnSupervisor* supervisor = new CfvpnSupervisor(std::move(copy));
+  supervisor->supervisor.Start();
+  return supervisor;
+}
+
+void cfvpn_supervisor_status(CfvpnSupervisor* supervisor,
+                             CfvpnSupervisorStatus* out) {
+  const cfvpn::SupervisorStatus status = supervisor->supervisor.status();
+  *out = CfvpnSupervisorStatus{};
+  out->state = static_cast<int32_t>(status.state);
+  out->restarts = status.restarts;
+  out->last_exit_code = status.last_exit_code;
+  out->pid = status.pid;
+  out->ready_latency_us = status.ready_latency_us;
+  const size_t length =
+      std::min(status.last_error.size(), sizeof(out->last_error) - 1);
+  std::memcpy(out->last_error, status.last_error.data(), length);
+}
+
+void cfvpn_supervisor_stop(CfvpnSupervisor* supervisor) {
+  supervisor->supervisor.RequestStop();
+}
+
+void cfvpn_supervisor_free(CfvpnSupervisor* supervisor) {
+  delete supervisor;
+}
+
+CfvpnHealthMonitor* cfvpn_health_monitor_start(
+    const CfvpnIpAddress* addresses, int32_t count, uint16_t port,
+    const CfvpnHealthOptions* options) {
+  if (addresses == nullptr || count <= 0) {
+    return nullptr;
+  }
+  cfvpn::HealthMonitorOptions copy;
+  if (options != nullptr) {
+    if (options->active_interval_ms > 0) {
+      copy.active_interval_ms = options->active_interval_ms;
+    }
+    if (options->standby_interval_ms > 0) {
+      copy.standby_interval_ms = options->standby_interval_ms;
+    }
+    if (options->timeout_ms > 0) copy.timeout_ms = options->timeout_ms;
+    if (options->max_latency_ms > 0) {
+      copy.max_latency_ms = options->max_latency_ms;
+    }
+    if (options->max_jitter_ms > 0) copy.max_jitter_ms = options->max_jitter_ms;
+    if (options->max_loss_rate > 0) copy.max_loss_rate = options->max_loss_rate;
+    if (options->degraded_checks > 0) {
+      copy.degraded_checks = options->degraded_checks;
+    }
+    if (options->cooldown_ms > 0) copy.cooldown_ms = options->cooldown_ms;
+  }
+  std::vector<cfvpn::ProbeTarget> nodes =
+      ToProbeTargets(addresses, count, port);
+  CfvpnHealthMonitor* monitor = new CfvpnHealthMonitor(copy, nodes);
+  monitor->monitor.set_failover_callback([nodes](size_t from, size_t to) {
+    cfvpn::LogMessage(cfvpn::LogLevel::kWarn, "Health",
+                      "failover " + cfvpn::FormatIpAddress(nodes[from].address) +
+                          " -> " +
+                          cfvpn::FormatIpAddress(nodes[to].address));
+  });
+  monitor->monitor.Start();
+  return monitor;
+}
+
+int32_t cfvpn_health_monitor_active(CfvpnHealthMonitor* monitor) {
+  return static_cast<int32_t>(monitor->monitor.active());
+}
+
+int32_t cfvpn_health_monitor_failovers(CfvpnHealthMonitor* monitor) {
+  return monitor->monitor.failovers();
+}
+
+int32_t cfvpn_health_monitor_snapshot(CfvpnHealthMonitor* monitor,
+                                      CfvpnNodeHealth* out,
+                                      int32_t capacity) {
+  const std::vector<cfvpn::NodeHealth> nodes = monitor->monitor.Snapshot();
+  const size_t active = monitor->monitor.active();
+  const int32_t written =
+      std::min(capacity, static_cast<int32_t>(nodes.size()));
+  for (int32_t i = 0; i < written; ++i) {
+    const cfvpn::NodeHealth& node = nodes[static_cast<size_t>(i)];
+    CfvpnNodeHealth& item = out[i];
+    std::memset(&item, 0, sizeof(item));
+    item.latency_ms = node.last_latency_ms < 0
+                          ? -1.0f
+                          : static_cast<float>(node.latency_ms);
+    item.jitter_ms = static_cast<float>(node.jitter_ms);
+    item.loss_rate = static_cast<float>(node.loss_rate);
+    item.samples = node.samples;
+    item.failure_streak = node.failure_streak;
+    item.degraded = node.degraded ? 1 : 0;
+    item.active = static_cast<size_t>(i) == active ? 1 : 0;
+  }
+  return std::max(0, written);
+}
+
+void cfvpn_health_monitor_free(CfvpnHealthMonitor* monitor) {
+  delete monitor;
+}
+
+CfvpnDnsResolver* cfvpn_dns_resolver_create(const CfvpnDnsOptions* options,
+                                            char* error,
+                                            int32_t error_capacity) {
+  cfvpn::DnsResolverOptions copy;
+  if (options != nullptr) {
+    if (options->upstreams != nullptr) {
+      cfvpn::ParseDnsUpstreamList(options->upstreams, &copy.upstreams);
+    }
+    if (options->timeout_ms > 0) copy.timeout_ms = options->timeout_ms;
+    if (options->cache_capacity > 0) {
+      copy.cache_capacity = static_cast<size_t>(options->cache_capacity);
+    }
+    if (options->min_ttl_sec > 0) {
+      copy.min_ttl_sec = static_cast<uint32_t>(options->min_ttl_sec);
+    }
+    if (options->max_ttl_sec > 0) {
+      copy.max_ttl_sec = static_cast<uint32_t>(options->max_ttl_sec);
+    }
+    if (options->negative_ttl_sec > 0) {
+      copy.negative_ttl_sec = static_cast<uint32_t>(options->negative_ttl_sec);
+    }
+    if (options->prefetch_hits != 0) {
+      copy.prefetch_hits = std::max(0, options->prefetch_hits);
+    }
+    if (options->prefetch_ratio > 0) {
+      copy.prefetch_ratio = options->prefetch_ratio;
+    }
+    copy.ipv6 = options->disable_ipv6 == 0;
+    if (options->listen_port != 0) {
+      copy.serve = true;
+      copy.listen_port = options->listen_port > 0
+                             ? static_cast<uint16_t>(options->listen_port)
+                             : 0;
+    }
+  }
+  auto resolver = std::make_unique<CfvpnDnsResolver>(copy);
+  std::string message;
+  if (!resolver->resolver.Start(&message)) {
+    if (error != nullptr && error_capacity > 0) {
+      const size_t length =
+          std::min(message.size(), static_cast<size_t>(error_capacity) - 1);
+      std::memcpy(error, message.data(), length);
+      error[length] = '\0';
+    }
+    return nullptr;
+  }
+  return resolver.release();
+}
+
+int32_t cfvpn_dns_resolver_local_port(CfvpnDnsResolver* resolver) {
+  return resolver->resolver.local_port();
+}
+
+void cfvpn_dns_resolver_clear(CfvpnDnsResolver* resolver) {
+  resolver->resolver.Clear();
+}
+
+void cfvpn_dns_resolver_stats(CfvpnDnsResolver* resolver, CfvpnDnsStats* out) {
+  const cfvpn::DnsResolverStats stats = resolver->resolver.stats();
+  out->lookups = static_cast<int64_t>(stats.lookups);
+  out->cache_hits = static_cast<int64_t>(stats.cache_hits);
+  out->cache_misses = static_cast<int64_t>(stats.cache_misses);
+  out->coalesced = static_cast<int64_t>(stats.coalesced);
+  out->prefetches = static_cast<int64_t>(stats.prefetches);
+  out->upstream_queries = static_cast<int64_t>(stats.upstream_queries);
+  out->upstream_timeouts = static_cast<int64_t>(stats.upstream_timeouts);
+  out->tcp_fallbacks = static_cast<int64_t>(stats.tcp_fallbacks);
+  out->served = static_cast<int64_t>(stats.served);
+  out->cache_size = static_cast<int64_t>(stats.cache_size);
+}
+
+void cfvpn_dns_resolver_free(CfvpnDnsResolver* resolver) { delete resolver; }
+
+CfvpnDnsQuery* cfvpn_dns_resolve_start(CfvpnDnsResolver* resolver,
+                                       const char* name) {
+  CfvpnDnsQuery* query = new CfvpnDnsQuery();
+  std::shared_ptr<CfvpnDnsQuery::State> state = query->state;
+  resolver->resolver.Resolve(name != nullptr ? name : "",
+                             [state](const cfvpn::DnsResult& result) {
+                               std::lock_guard<std::mutex> lock(state->mutex);
+                               state->result = result;
+                               state->done.store(true,
+                                                 std::memory_order_release);
+                             });
+  return query;
+}
+
+int32_t cfvpn_dns_resolve_is_done(CfvpnDnsQuery* query) {
+  return query->state->done.load(std::memory_order_acquire) ? 1 : 0;
+}
+
+int32_t cfvpn_dns_resolve_result(CfvpnDnsQuery* query, CfvpnDnsAnswer* out,
+                                 CfvpnIpAddress* addresses,
+                                 int32_t capacity) {
+  CfvpnDnsQuery::State& state = *query->state;
+  if (!state.done.load(std::memory_order_acquire)) return -1;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  const cfvpn::DnsResult& result = state.result;
+  if (out != nullptr) {
+    out->status = static_cast<int32_t>(result.status);
+    out->ttl_sec = static_cast<int32_t>(
+        std::min<uint32_t>(result.ttl_sec, INT32_MAX));
+    out->from_cache = result.from_cache ? 1 : 0;
+    out->address_count = static_cast<int32_t>(result.addresses.size());
+  }
+  const int32_t written = std::max(
+      0, std::min(capacity, static_cast<int32_t>(result.addresses.size())));
+  for (int32_t i = 0; i < written; ++i) {
+    const cfvpn::IpAddress& address = result.addresses[static_cast<size_t>(i)];
+    CfvpnIpAddress& item = addresses[i];
+    std::memset(&item, 0, sizeof(item));
+    item.family = address.v6 ? 6 : 4;
+    cfvpn::IpAddressBytes(address, item.bytes);
+  }
+  return written;
+}
+
+void cfvpn_dns_resolve_free(CfvpnDnsQuery* query) { delete query; }
+
+CfvpnRelay* cfvpn_relay_start(const CfvpnRelayOptions* options, char* error,
+                              int32_t error_capacity) {
+  cfvpn::LocalRelayOptions copy;
+  if (options != nullptr) {
+    if (options->listen_port > 0 && options->listen_port <= 65535) {
+      copy.listen_port = static_cast<uint16_t>(options->listen_port);
+    }
+    if (options->upstream_port > 0 && options->upstream_port <= 65535) {
+      copy.upstream_port = static_cast<uint16_t>(options->upstream_port);
+    }
+    if (options->max_connections > 0) {
+      copy.max_connections = static_cast<size_t>(options->max_connections);
+    }
+    if (options->max_destinations > 0) {
+      copy.max_destinations = static_cast<size_t>(options->max_destinations);
+    }
+    if (options->buffer_bytes > 0) {
+      copy.buffer_bytes = static_cast<size_t>(options->buffer_bytes);
+    }
+    copy.zero_copy = options->disable_zero_copy == 0;
+  }
+  auto relay = std::make_unique<CfvpnRelay>(copy);
+  std::string message;
+  if (!relay->relay.Start(&message)) {
+    if (error != nullptr && error_capacity > 0) {
+      const size_t length =
+          std::min(message.size(), static_cast<size_t>(error_capacity) - 1);
+      std::memcpy(error, message.data(), length);
+      error[length] = '\0';
+    }
+    return nullptr;
+  }
+  return relay.release();
+}
+
+int32_t cfvpn_relay_port(CfvpnRelay* relay) { return relay->relay.port(); }
+
+void cfvpn_relay_stats(CfvpnRelay* relay, CfvpnRelayStats* out) {
+  const cfvpn::LocalRelayStats stats = relay->relay.stats();
+  out->accepted = static_cast<int64_t>(stats.accepted);
+  out->rejected = static_cast<int64_t>(stats.rejected);
+  out->upstream_failures = static_cast<int64_t>(stats.upstream_failures);
+  out->bytes_up = static_cast<int64_t>(stats.bytes_up);
+  out->bytes_down = static_cast<int64_t>(stats.bytes_down);
+  out->zero_copy_bytes = static_cast<int64_t>(stats.zero_copy_bytes);
+  out->active = static_cast<int32_t>(stats.active);
+  out->zero_copy = relay->relay.zero_copy() ? 1 : 0;
+}
+
+int32_t cfvpn_relay_top_talkers(CfvpnRelay* relay, CfvpnRelayTalker* out,
+                                int32_t capacity) {
+  if (capacity <= 0) return 0;
+  const std::vector<cfvpn::RelayTalker> talkers =
+      relay->relay.TopTalkers(static_cast<size_t>(capacity));
+  for (size_t i = 0; i < talkers.size(); ++i) {
+    const cfvpn::RelayTalker& talker = talkers[i];
+    CfvpnRelayTalker& item = out[i];
+    std::memset(&item, 0, sizeof(item));
+    const size_t length =
+        std::min(talker.destination.size(), sizeof(item.destination) - 1);
+    std::memcpy(item.destination, talker.destination.data(), length);
+    item.bytes_up = static_cast<int64_t>(talker.bytes_up);
+    item.bytes_down = static_cast<int64_t>(talker.bytes_down);
+    item.connections = static_cast<int64_t>(talker.connections);
+    item.active = static_cast<int32_t>(talker.active);
+  }
+  return static_cast<int32_t>(talkers.size());
+}
+
+void cfvpn_relay_free(CfvpnRelay* relay) { delete relay; }
+
+// ===== 启动预热 =====
+
+int32_t cfvpn_prewarm_start(const CfvpnPrewarmOptions* options) {
+  if (options == nullptr) return 0;
+  CfvpnPrewarm& prewarm = CfvpnPrewarm::Instance();
+  {
+    std::lock_guard<std::mutex> lock(prewarm.mutex);
+    if (prewarm.state != CFVPN_PREWARM_NOT_STARTED) return 0;
+    prewarm.state = CFVPN_PREWARM_RUNNING;
+    prewarm.started_us = cfvpn::TraceRecorder::Global().NowUs();
+  }
+  cfvpn::PrewarmOptions copy;
+  if (options->node_cache_path != nullptr) {
+    copy.node_cache_path = options->node_cache_path;
+  }
+  if (options->node_cache_capacity > 0) {
+    copy.node_cache.capacity =
+        static_cast<uint32_t>(options->node_cache_capacity);
+  }
+  if (options->config_template_path != nullptr) {
+    copy.config_template_path = options->config_template_path;
+  }
+  if (options->v2ray_path != nullptr) copy.v2ray_path = options->v2ray_path;
+  for (int32_t i = 0; i < options->geo_file_count; ++i) {
+    if (options->geo_files[i] != nullptr) {
+      copy.geo_files.emplace_back(options->geo_files[i]);
+    }
+  }
+
+  std::thread([&prewarm, options = std::move(copy)] {
+    cfvpn::TraceRecorder::Global().SetThreadName("prewarm");
+    auto node_cache = std::make_unique<CfvpnNodeCache>();
+    auto config_builder = std::make_unique<CfvpnConfigBuilder>();
+    cfvpn::PrewarmReport report;
+    cfvpn::RunStartupPrewarm(options, &node_cache->cache,
+                             &config_builder->builder, &report);
+    {
+      std::lock_guard<std::mutex> lock(prewarm.mutex);
+      if (report.node_cache_opened) prewarm.node_cache = std::move(node_cache);
+      if (report.template_loaded) {
+        prewarm.config_builder = std::move(config_builder);
+      }
+      prewarm.report = std::move(report);
+      prewarm.state = CFVPN_PREWARM_DONE;
+    }
+    prewarm.finished.notify_all();
+  }).detach();
+  return 1;
+}
+
+int32_t cfvpn_prewarm_status(int32_t timeout_ms, CfvpnPrewarmStatus* out) {
+  CfvpnPrewarm& prewarm = CfvpnPrewarm::Instance();
+  std::unique_lock<std::mutex> lock(prewarm.mutex);
+  if (timeout_ms > 0) {
+    prewarm.finished.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                              [&prewarm] {
+                                return prewarm.state != CFVPN_PREWARM_RUNNING;
+                              });
+  }
+  if (out == nullptr) return prewarm.state;
+
+  const cfvpn::PrewarmReport& report = prewarm.report;
+  *out = CfvpnPrewarmStatus{};
+  out->state = prewarm.state;
+  out->started_us = prewarm.started_us;
+  if (prewarm.state != CFVPN_PREWARM_DONE) return prewarm.state;
+  out->node_cache_size = report.node_cache_opened ? report.node_cache_size : -1;
+  out->template_loaded = report.template_loaded ? 1 : 0;
+  out->v2ray_found = report.v2ray_executable ? 1 : 0;
+  out->v2ray_size = report.v2ray.size;
+  out->total_us = report.total_us;
+  out->node_cache_us = report.node_cache_us;
+  out->template_us = report.template_us;
+  out->files_us = report.files_us;
+  out->prefetched_bytes = report.prefetched_bytes;
+  std::string message = report.template_error;
+  if (message.empty() && !report.v2ray.path.empty() &&
+      !report.v2ray_executable) {
+    message = "v2ray 可执行文件缺失或无效: " + report.v2ray.path;
+  }
+  for (const cfvpn::PrewarmFileCheck& check : report.geo_files) {
+    if (check.found) continue;
+    ++out->geo_missing;
+    if (message.empty()) message = "缺少文件: " + check.path;
+  }
+  const size_t length = std::min(message.size(), sizeof(out->message) - 1);
+  std::memcpy(out->message, message.data(), length);
+  return prewarm.state;
+}
+
+CfvpnNodeCache* cfvpn_prewarm_take_node_cache(void) {
+  CfvpnPrewarm& prewarm = CfvpnPrewarm::Instance();
+  std::lock_guard<std::mutex> lock(prewarm.mutex);
+  return prewarm.node_cache.release();
+}
+
+CfvpnConfigBuilder* cfvpn_prewarm_take_config_builder(void) {
+  CfvpnPrewarm& prewarm = CfvpnPrewarm::Instance();
+  std::lock_guard<std::mutex> lock(prewarm.mutex);
+  return prewarm.config_builder.release();
+}
+
+int32_t cfvpn_prewarm_reset(void) {
+  CfvpnPrewarm& prewarm = CfvpnPrewarm::Instance();
+  std::lock_guard<std::mutex> lock(prewarm.mutex);
+  if (prewarm.state == CFVPN_PREWARM_RUNNING) return 0;
+  prewarm.state = CFVPN_PREWARM_NOT_STARTED;
+  prewarm.started_us = 0;
+  prewarm.report = cfvpn::PrewarmReport{};
+  prewarm.node_cache.reset();
+  prewarm.config_builder.reset();
+  return 1;
+}
+
+// ===== 启动追踪 =====
+
+int64_t cfvpn_trace_now_us(void) {
+  return cfvpn::TraceRecorder::Global().NowUs();
+}
+
+void cfvpn_trace_add_span(const char* name, const char* category,
+                          int64_t start_us, int64_t duration_us) {
+  cfvpn::TraceRecorder& recorder = cfvpn::TraceRecorder::Global();
+  recorder.AddComplete(recorder.Intern(name != nullptr ? name : ""),
+                       recorder.Intern(category != nullptr ? category : "dart"),
+                       start_us, duration_us);
+}
+
+void cfvpn_trace_instant(const char* name, const char* category) {
+  cfvpn::TraceRecorder& recorder = cfvpn::TraceRecorder::Global();
+  recorder.AddInstant(recorder.Intern(name != nullptr ? name : ""),
+                      recorder.Intern(category != nullptr ? category : "dart"));
+}
+
+void cfvpn_trace_clear(void) { cfvpn::TraceRecorder::Global().Clear(); }
+
+int32_t cfvpn_trace_dump(const char* path) {
+  if (path == nullptr) return -1;
+  const cfvpn::TraceRecorder& recorder = cfvpn::TraceRecorder::Global();
+  const size_t count = recorder.event_count();
+  return recorder.WriteJson(path) ? static_cast<int32_t>(count) : -1;
+}
+
+}  // extern "C"
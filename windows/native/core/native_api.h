@@ -0,0 +1,871 @@
+#ifndef NATIVE_CORE_NATIVE_API_H_
+#define NATIVE_CORE_NATIVE_API_H_
+
+// 原生核心导出给 Dart（dart:ffi）的 C 接口。
+//
+// 这些符号由 runner 可执行文件导出，Dart 端通过
+// DynamicLibrary.executable() 查找，见 lib/services/native_core.dart。
+// 结构体布局必须与 Dart 端的 Struct 定义保持一致。
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define CFVPN_EXPORT __declspec(dllexport)
+#else
+#define CFVPN_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===== TCPing =====
+
+typedef struct CfvpnTcpingOptions {
+  int32_t attempts;              // 每个 IP 的连接次数
+  int32_t timeout_ms;            // 单次连接超时
+  int32_t min_valid_latency_ms;  // 低于该值视为假连接
+  int32_t interval_ms;           // 同一 IP 两次连接的间隔
+  int32_t max_inflight;          // 同时在途的连接数上限
+  // 以下字段为 0 时保持旧行为（固定并发、不提前结束）
+  int32_t adaptive_inflight;     // 非 0 时由 AIMD 调整在途数
+  int32_t min_inflight;
+  int32_t initial_inflight;
+  int32_t stop_after_good;       // 找到这么多优质节点后提前结束
+  int32_t good_latency_ms;
+  float good_loss_rate;
+  int32_t failure_window;        // 最近多少个目标的失败比例过高时提前结束
+  float failure_rate_threshold;
+  // 抖动超过平均延迟的 extra_jitter_ratio（0 时为 0.25）时最多追加的次数
+  int32_t extra_attempts;
+  float extra_jitter_ratio;
+  // 排序得分的权重，全部为 0 时只看平均延迟，见 cfvpn::LatencyScoreWeights
+  float score_mean;
+  float score_p50;
+  float score_p90;
+  float score_p99;
+  float score_jitter;
+  float score_loss;
+} CfvpnTcpingOptions;
+
+typedef struct CfvpnProbeResult {
+  uint32_t ip;  // 主机字节序
+  uint16_t port;
+  uint16_t reserved;
+  int32_t latency_ms;
+  int32_t sent;
+  int32_t received;
+  float loss_rate;
+  // 有效样本的延迟百分位，没有有效样本时为 999
+  int32_t p50_ms;
+  int32_t p90_ms;
+  int32_t p99_ms;
+  float jitter_ms;
+  float score;  // 越小越好
+} CfvpnProbeResult;
+
+// IPv4 或 IPv6 地址，bytes 为网络字节序，IPv4 只使用前 4 字节
+typedef struct CfvpnIpAddress {
+  uint8_t family;  // 4 或 6
+  uint8_t reserved[3];
+  uint8_t bytes[16];
+} CfvpnIpAddress;
+
+typedef struct CfvpnTcpingJob CfvpnTcpingJob;
+
+// 在后台线程启动一次 TCPing 扫描。ips 会被复制，调用返回后即可释放。
+// ips 为 NULL 或 count <= 0 时返回 NULL。
+CFVPN_EXPORT CfvpnTcpingJob* cfvpn_tcping_start(
+    const uint32_t* ips, int32_t count, uint16_t port,
+    const CfvpnTcpingOptions* options);
+
+// 同 cfvpn_tcping_start，目标可以是 IPv6。结果按 addresses 的顺序返回，
+// IPv6 目标结果中的 ip 为 0，由调用方按下标对应。addresses 为 NULL 或
+// count <= 0 时返回 NULL。
+CFVPN_EXPORT CfvpnTcpingJob* cfvpn_tcping_start_addresses(
+    const CfvpnIpAddress* addresses, int32_t count, uint16_t port,
+    const CfvpnTcpingOptions* options);
+
+// 已完成的 IP 数
+CFVPN_EXPORT int32_t cfvpn_tcping_completed(CfvpnTcpingJob* job);
+
+// 扫描是否已结束（完成或被取消）
+CFVPN_EXPORT int32_t cfvpn_tcping_is_done(CfvpnTcpingJob* job);
+
+// 扫描结束后复制结果，返回写入数量；未结束时返回 -1
+CFVPN_EXPORT int32_t cfvpn_tcping_results(CfvpnTcpingJob* job,
+                                          CfvpnProbeResult* out,
+                                          int32_t capacity);
+
+// 当前在途连接数上限（自适应并发时随拥塞情况变化）
+CFVPN_EXPORT int32_t cfvpn_tcping_inflight_limit(CfvpnTcpingJob* job);
+
+// 扫描结束的原因：0 全部完成，1 优质节点已足够，2 失败过多，3 被取消
+CFVPN_EXPORT int32_t cfvpn_tcping_stop_reason(CfvpnTcpingJob* job);
+
+// 请求取消，随后仍需调用 cfvpn_tcping_free
+CFVPN_EXPORT void cfvpn_tcping_cancel(CfvpnTcpingJob* job);
+
+// 等待后台线程退出并释放任务
+CFVPN_EXPORT void cfvpn_tcping_free(CfvpnTcpingJob* job);
+
+// ===== HTTPing / Trace =====
+
+typedef struct CfvpnHttpProbeOptions {
+  int32_t requests;         // 每个 IP 在同一连接上发送的请求数
+  int32_t timeout_ms;       // 建连和每个请求各自的超时
+  int32_t max_inflight;     // 同时在途的连接数上限
+  int32_t expected_status;  // 视为成功的状态码，0 表示任意 2xx
+  const char* host;         // Host 头：NULL 时为 cloudflare.com，空串时为目标 IP
+  const char* path;         // 请求路径，为空时使用 /cdn-cgi/trace
+} CfvpnHttpProbeOptions;
+
+typedef struct CfvpnHttpProbeResult {
+  uint32_t ip;  // 主机字节序
+  uint16_t port;
+  uint16_t status;  // 最后一个响应的状态码，没有响应时为 0
+  // 以下耗时单位为毫秒，没有样本时为 -1
+  int32_t connect_ms;
+  int32_t ttfb_ms;
+  int32_t total_ms;
+  int32_t sent;
+  int32_t received;
+  char colo[8];  // 以 NUL 结尾
+  char loc[4];
+} CfvpnHttpProbeResult;
+
+typedef struct CfvpnHttpProbeJob CfvpnHttpProbeJob;
+
+// 在后台线程启动一次 HTTP 探测，参数含义同 cfvpn_tcping_start，
+// ips 为 NULL 或 count <= 0 时同样返回 NULL。
+// options 中的字符串会被复制。
+CFVPN_EXPORT CfvpnHttpProbeJob* cfvpn_http_probe_start(
+    const uint32_t* ips, int32_t count, uint16_t port,
+    const CfvpnHttpProbeOptions* options);
+
+// 同 cfvpn_http_probe_start，目标可以是 IPv6，结果的对应方式同
+// cfvpn_tcping_start_addresses。Host 为目标 IP 时 IPv6 地址加方括号。
+CFVPN_EXPORT CfvpnHttpProbeJob* cfvpn_http_probe_start_addresses(
+    const CfvpnIpAddress* addresses, int32_t count, uint16_t port,
+    const CfvpnHttpProbeOptions* options);
+
+CFVPN_EXPORT int32_t cfvpn_http_probe_completed(CfvpnHttpProbeJob* job);
+
+CFVPN_EXPORT int32_t cfvpn_http_probe_is_done(CfvpnHttpProbeJob* job);
+
+// 探测结束后复制结果，返回写入数量；未结束时返回 -1
+CFVPN_EXPORT int32_t cfvpn_http_probe_results(CfvpnHttpProbeJob* job,
+                                              CfvpnHttpProbeResult* out,
+                                              int32_t capacity);
+
+CFVPN_EXPORT void cfvpn_http_probe_cancel(CfvpnHttpProbeJob* job);
+
+CFVPN_EXPORT void cfvpn_http_probe_free(CfvpnHttpProbeJob* job);
+
+// ===== 下载吞吐测试 =====
+
+// 以下字段为 0 时使用默认值
+typedef struct CfvpnThroughputOptions {
+  int32_t connections;         // 并行连接数，默认 4
+  int32_t duration_ms;         // 测试时长上限，默认 10000
+  int32_t connect_timeout_ms;  // 建连到收到响应头的超时，默认 3000
+  int32_t sample_interval_ms;  // 吞吐采样窗，默认 100
+  // Host 头：NULL 时为 speed.cloudflare.com，空串时为目标 IP
+  const char* host;
+  const char* path;  // 为空时为 /__down?bytes=1000000000
+} CfvpnThroughputOptions;
+
+typedef struct CfvpnThroughputResult {
+  int64_t bytes;          // 响应体总字节数
+  double sustained_mbps;  // 爬升结束后的平均吞吐
+  double peak_mbps;       // 最高的单个采样窗
+  int32_t connected;      // 收到 2xx 响应头的连接数（含重连）
+  int32_t failed;         // 失败的连接数
+  // 以下耗时单位为毫秒，没有样本时为 -1
+  int32_t connect_ms;
+  int32_t ttfb_ms;
+  int32_t ramp_up_ms;
+  int32_t elapsed_ms;    // 从首个响应体字节到结束
+  uint16_t status;       // 第一个响应的状态码
+  uint16_t reserved;
+  int32_t sample_count;  // cfvpn_throughput_samples 可取的采样窗数
+} CfvpnThroughputResult;
+
+typedef struct CfvpnThroughputJob CfvpnThroughputJob;
+
+// 在后台线程对一个节点做多连接下载测试，在 duration_ms 后、全部连接
+// 失败或被取消时结束。options 可为空，其中的字符串会被复制。
+CFVPN_EXPORT CfvpnThroughputJob* cfvpn_throughput_start(
+    const CfvpnIpAddress* address, uint16_t port,
+    const CfvpnThroughputOptions* options);
+
+// 已收到的响应体字节数，可在运行中轮询
+CFVPN_EXPORT int64_t cfvpn_throughput_bytes(CfvpnThroughputJob* job);
+
+CFVPN_EXPORT int32_t cfvpn_throughput_is_done(CfvpnThroughputJob* job);
+
+// 结束后写入结果并返回 0；未结束时返回 -1
+CFVPN_EXPORT int32_t cfvpn_throughput_result(CfvpnThroughputJob* job,
+                                             CfvpnThroughputResult* out);
+
+// 结束后复制每个采样窗的吞吐（Mbps），返回写入数量；未结束时返回 -1
+CFVPN_EXPORT int32_t cfvpn_throughput_samples(CfvpnThroughputJob* job,
+                                              double* out, int32_t capacity);
+
+// 请求取消，已收到的数据仍计入结果；随后仍需调用 cfvpn_throughput_free
+CFVPN_EXPORT void cfvpn_throughput_cancel(CfvpnThroughputJob* job);
+
+CFVPN_EXPORT void cfvpn_throughput_free(CfvpnThroughputJob* job);
+
+// ===== CIDR 采样 =====
+
+typedef struct CfvpnCidrIndex CfvpnCidrIndex;
+
+// 由逗号/空白/换行分隔的 CIDR 列表创建索引。invalid_count 可为空，
+// 用于返回无法解析的条目数。没有任何有效段时返回空指针。
+CFVPN_EXPORT CfvpnCidrIndex* cfvpn_cidr_index_create(const char* cidr_list,
+                                                     int32_t* invalid_count);
+
+// 有效段的数量
+CFVPN_EXPORT int32_t cfvpn_cidr_index_range_count(CfvpnCidrIndex* index);
+
+// 合并重叠部分后的地址总数
+CFVPN_EXPORT int64_t cfvpn_cidr_index_address_count(CfvpnCidrIndex* index);
+
+// 采样最多 count 个不重复地址（主机字节序）写入 out，返回实际数量。
+// 相同种子结果相同；同一索引可在多个线程中调用（内部串行化）。
+CFVPN_EXPORT int32_t cfvpn_cidr_sample(CfvpnCidrIndex* index, uint32_t* out,
+                                       int32_t count, uint64_t seed);
+
+CFVPN_EXPORT void cfvpn_cidr_index_free(CfvpnCidrIndex* index);
+
+// ===== IPv4/IPv6 排列采样 =====
+
+typedef struct CfvpnAddressSampler CfvpnAddressSampler;
+
+// 由逗号/空白/换行分隔的 IPv4/IPv6 前缀列表创建采样器。地址按种子
+// 决定的伪随机排列依次取出，整个序列不重复，内存与地址数无关，
+// 可用于 IPv6 这类无法枚举的大空间。没有任何有效前缀时返回空指针。
+CFVPN_EXPORT CfvpnAddressSampler* cfvpn_address_sampler_create(
+    const char* prefix_list, uint64_t seed, int32_t* invalid_count);
+
+// 按排列顺序取出最多 count 个地址，返回实际数量，取完后返回 0
+CFVPN_EXPORT int32_t cfvpn_address_sampler_next(CfvpnAddressSampler* sampler,
+                                                CfvpnIpAddress* out,
+                                                int32_t count);
+
+CFVPN_EXPORT void cfvpn_address_sampler_free(CfvpnAddressSampler* sampler);
+
+// ===== 全量扫描 =====
+
+typedef struct CfvpnFullScanOptions {
+  const char* ranges;           // CIDR 列表，NULL 或空串时为内置 Cloudflare 段
+  const char* output_path;      // CSV 结果文件，续扫时追加
+  const char* checkpoint_path;  // 检查点文件，NULL 或空串时不保存进度
+  uint64_t seed;                // 遍历顺序，续扫时必须相同；0 时为 1
+  uint16_t port;
+  uint16_t reserved;
+  int32_t min_valid_latency_ms;  // 低于该值视为假连接，负数时使用默认值 30
+  // 以下字段为 0 时使用默认值
+  int32_t max_latency_ms;  // 也是连接超时，默认 300
+  int32_t attempts;        // 每个地址的连接次数，默认 3
+  int32_t max_inflight;    // 自适应并发的上限，默认 1024
+  int32_t chunk_blocks;    // 检查点间隔（/24 数），默认 1024
+  int32_t keep_best;       // 保留的最低延迟节点数，默认 5
+  int32_t write_failures;  // 非 0 时不可达的 /24 也写入结果文件
+  int32_t restart;         // 非 0 时忽略检查点，从头开始
+} CfvpnFullScanOptions;
+
+#define CFVPN_FULL_SCAN_RUNNING 0
+#define CFVPN_FULL_SCAN_COMPLETED 1
+#define CFVPN_FULL_SCAN_CANCELLED 2
+#define CFVPN_FULL_SCAN_FAILED 3
+
+typedef struct CfvpnFullScanStatus {
+  int64_t total_blocks;  // /24 总数
+  int64_t done_blocks;   // 已完成的 /24 数，包括续扫前的部分
+  int64_t resumed_from;  // 续扫的起点，0 表示从头开始
+  int64_t reachable;     // 写入结果文件的可达节点数
+  int32_t state;         // CFVPN_FULL_SCAN_*
+  int32_t reserved;
+} CfvpnFullScanStatus;
+
+typedef struct CfvpnFullScanJob CfvpnFullScanJob;
+
+// 在后台线程对每个 /24 各测一个地址，结果流式写入 output_path，每批
+// 结束后保存检查点；用相同参数再次启动时从检查点继续。字符串会被复制。
+// 没有 output_path 或 ranges 全部无效时返回空指针。
+CFVPN_EXPORT CfvpnFullScanJob* cfvpn_full_scan_start(
+    const CfvpnFullScanOptions* options);
+
+CFVPN_EXPORT void cfvpn_full_scan_status(CfvpnFullScanJob* job,
+                                         CfvpnFullScanStatus* out);
+
+// 结束后复制延迟最低的节点（按延迟升序），返回写入数量；未结束时返回 -1
+CFVPN_EXPORT int32_t cfvpn_full_scan_best(CfvpnFullScanJob* job,
+                                          CfvpnProbeResult* out,
+                                          int32_t capacity);
+
+// 出错的原因，写入以 NUL 结尾的 out，返回完整长度
+CFVPN_EXPORT int32_t cfvpn_full_scan_error(CfvpnFullScanJob* job, char* out,
+                                           int32_t capacity);
+
+// 请求取消，当前一批不写入；随后仍需调用 cfvpn_full_scan_free
+CFVPN_EXPORT void cfvpn_full_scan_cancel(CfvpnFullScanJob* job);
+
+CFVPN_EXPORT void cfvpn_full_scan_free(CfvpnFullScanJob* job);
+
+// ===== 节点质量缓存 =====
+
+typedef struct CfvpnNodeSample {
+  uint32_t ip;         // 主机字节序
+  int32_t latency_ms;  // 小于 0 表示失败
+  float loss_rate;     // >= 1 表示失败，小于 0 表示只更新 colo
+  char colo[4];        // 数据中心代码，为空时不更新
+} CfvpnNodeSample;
+
+typedef struct CfvpnNodeQuality {
+  uint32_t ip;
+  float latency_ms;  // 平滑后的延迟
+  float loss_rate;   // 平滑后的丢包率
+  float score;       // 越小越好
+  int64_t last_seen;  // Unix 时间（秒）
+  int32_t samples;
+  int32_t failure_streak;
+  char colo[4];
+  int32_t reserved;
+} CfvpnNodeQuality;
+
+typedef struct CfvpnNodeCache CfvpnNodeCache;
+
+// 打开（不存在时创建）内存映射的缓存文件，path 为 UTF-8。
+// capacity 为 0 时使用默认容量。失败时返回空指针。
+CFVPN_EXPORT CfvpnNodeCache* cfvpn_node_cache_open(const char* path,
+                                                   int32_t capacity);
+
+// 当前保存的节点数
+CFVPN_EXPORT int32_t cfvpn_node_cache_size(CfvpnNodeCache* cache);
+
+// 合并一批探测结果并发起写回，now 为 Unix 时间（秒）
+CFVPN_EXPORT void cfvpn_node_cache_update(CfvpnNodeCache* cache,
+                                          const CfvpnNodeSample* samples,
+                                          int32_t count, int64_t now);
+
+// 按综合分选出最多 capacity 个节点，返回写入数量。只考虑 max_age_sec 秒内
+// 探测过且连续失败少于 max_failure_streak 次的节点。
+CFVPN_EXPORT int32_t cfvpn_node_cache_best(CfvpnNodeCache* cache,
+                                           CfvpnNodeQuality* out,
+                                           int32_t capacity, int64_t now,
+                                           int32_t max_age_sec,
+                                           int32_t max_failure_streak);
+
+// 写回并关闭
+CFVPN_EXPORT void cfvpn_node_cache_close(CfvpnNodeCache* cache);
+
+// ===== 按段分配预算的 TCPing =====
+
+typedef struct CfvpnBanditOptions {
+  int32_t policy;        // 0 Thompson 采样，1 UCB
+  int32_t arm_prefix;    // 每个臂的前缀长度，0 时为 16
+  int32_t batch;         // 每轮探测的地址数，0 时为 32
+  float prior_weight;    // 每条历史记录折合的样本数，0 时为 0.5
+  float max_prior;       // 每个臂的历史最多折合的样本数，0 时为 8
+  int32_t history_max_age_sec;  // 只用这么久以内探测过的历史，0 时为 7 天
+  CfvpnNodeCache* history;      // 先验来源，可为空
+  uint64_t seed;                // 0 时按当前时间
+} CfvpnBanditOptions;
+
+// 把 cidr_list 的每段（大段按 arm_prefix 切开）当作一个臂，按本次扫描中
+// 各臂的优质节点比例（以节点缓存中的历史为先验）分轮分配最多 budget 个
+// 地址并做 TCPing，找到 options->stop_after_good 个优质节点后结束；
+// failure_window 不生效。返回的任务用 cfvpn_tcping_* 查询和释放，结果按
+// 分配顺序排列，可能包含提前结束时已分配但未探测（sent 为 0）的地址。
+// cidr_list 中没有有效段时返回空指针。
+CFVPN_EXPORT CfvpnTcpingJob* cfvpn_bandit_tcping_start(
+    const char* cidr_list, int32_t budget, uint16_t port,
+    const CfvpnTcpingOptions* options, const CfvpnBanditOptions* bandit);
+
+// ===== v2ray 流量统计 =====
+
+typedef struct CfvpnStatsCounter {
+  char name[128];  // 以 NUL 结尾，过长时截断
+  int64_t value;
+} CfvpnStatsCounter;
+
+typedef struct CfvpnStatsClient CfvpnStatsClient;
+
+// 创建连接 127.0.0.1:port（v2ray api 入站）的统计客户端。
+// 连接在第一次查询时建立并保持，断开后自动重连。
+CFVPN_EXPORT CfvpnStatsClient* cfvpn_stats_client_create(uint16_t port,
+                                                         int32_t timeout_ms);
+
+// StatsService.QueryStats：把名称包含 pattern 的计数器写入 out，
+// 返回计数器总数（可能大于 capacity，只写入前 capacity 个）；失败时返回 -1。
+// 同步调用，回环上通常不到 1ms，超时由 timeout_ms 限制。
+CFVPN_EXPORT int32_t cfvpn_stats_query(CfvpnStatsClient* client,
+                                       const char* pattern, int32_t reset,
+                                       CfvpnStatsCounter* out,
+                                       int32_t capacity);
+
+// 最近一次查询失败的原因，写入以 NUL 结尾的 out，返回完整长度
+CFVPN_EXPORT int32_t cfvpn_stats_last_error(CfvpnStatsClient* client,
+                                            char* out, int32_t capacity);
+
+CFVPN_EXPORT void cfvpn_stats_client_free(CfvpnStatsClient* client);
+
+// ===== 流量采样环 =====
+
+typedef struct CfvpnTrafficSampler CfvpnTrafficSampler;
+
+// 启动后台采样线程：每 interval_ms 通过 127.0.0.1:port 的 v2ray api
+// 查询名称包含 pattern 的计数器，把其中 uplink/downlink 之和写入分层
+// 环形缓冲区（全分辨率保留 1 小时，另有 5 秒/1 天、1 分钟/7 天两个降采样层）。
+CFVPN_EXPORT CfvpnTrafficSampler* cfvpn_traffic_sampler_start(
+    uint16_t port, int32_t interval_ms, const char* pattern);
+
+// 环形缓冲区首地址，直到 free 之前都有效，Dart 端直接映射读取。
+// 布局见 core/traffic_ring.h 的 TrafficRingHeader。
+CFVPN_EXPORT const void* cfvpn_traffic_sampler_ring(
+    CfvpnTrafficSampler* sampler);
+
+// 环形缓冲区总字节数
+CFVPN_EXPORT int64_t cfvpn_traffic_sampler_ring_size(
+    CfvpnTrafficSampler* sampler);
+
+// 停止采样线程并释放缓冲区
+CFVPN_EXPORT void cfvpn_traffic_sampler_free(CfvpnTrafficSampler* sampler);
+
+// ===== 异步日志 =====
+
+typedef struct CfvpnLogger CfvpnLogger;
+
+// 与 cfvpn::LogLevel 一致
+#define CFVPN_LOG_DEBUG 0
+#define CFVPN_LOG_INFO 1
+#define CFVPN_LOG_WARN 2
+#define CFVPN_LOG_ERROR 3
+
+// 在已存在的 directory（UTF-8）下写 <tag>_<YYYYMMDD>.log，启动写线程，
+// 并设为进程的默认日志器（原生代码的日志也写到这里，崩溃时写出剩余记录）。
+// max_file_bytes/max_backups/max_open_files 不大于 0 时使用默认值。
+// binary 非 0 时改为写压缩的二进制段文件 cfvpn_*.clog，用 cfvpn_logcat 解码。
+CFVPN_EXPORT CfvpnLogger* cfvpn_log_open(const char* directory,
+                                         int64_t max_file_bytes,
+                                         int32_t max_backups,
+                                         int32_t max_open_files,
+                                         int32_t binary);
+
+// 无锁写入一条日志（tag/message 为 UTF-8，不要求以 NUL 结尾），
+// 复制后立即返回。队列满时丢弃并返回 0，成功返回 1。
+CFVPN_EXPORT int32_t cfvpn_log_write(CfvpnLogger* logger, int32_t level,
+                                     const char* tag, int32_t tag_length,
+                                     const char* message,
+                                     int32_t message_length);
+
+// 阻塞直到此前写入的日志全部落盘
+CFVPN_EXPORT void cfvpn_log_flush(CfvpnLogger* logger);
+
+// 落盘并关闭所有日志文件，用于删除日志文件前；之后的写入会重新打开
+CFVPN_EXPORT void cfvpn_log_close_files(CfvpnLogger* logger);
+
+// 因队列满而丢弃的日志条数
+CFVPN_EXPORT int64_t cfvpn_log_dropped(CfvpnLogger* logger);
+
+// 写出剩余日志、停止写线程并释放
+CFVPN_EXPORT void cfvpn_log_close(CfvpnLogger* logger);
+
+// ===== v2ray 配置 =====
+
+typedef struct CfvpnV2rayConfigParams {
+  const char* server_ip;
+  const char* server_name;  // 为空或空串时使用模板中的值
+  const char* user_id;      // 为空或空串时保留模板中的 UUID
+  int32_t server_port;      // 模板中没有有效端口时才使用
+  int32_t socks_port;
+  int32_t http_port;
+  int32_t global_proxy;
+} CfvpnV2rayConfigParams;
+
+typedef struct CfvpnConfigBuilder CfvpnConfigBuilder;
+
+// 解析配置模板（UTF-8，允许注释和尾随逗号）并缓存，模板无效时返回空指针
+CFVPN_EXPORT CfvpnConfigBuilder* cfvpn_config_builder_create(
+    const char* template_json, int32_t length);
+
+// 生成配置，返回内部缓冲区（不以 NUL 结尾），直到下一次生成或释放前有效。
+// length 不可为空。
+CFVPN_EXPORT const char* cfvpn_config_builder_build(
+    CfvpnConfigBuilder* builder, const CfvpnV2rayConfigParams* params,
+    int32_t* length);
+
+// 生成配置并写入 path（UTF-8，先写临时文件再替换），返回写入的字节数，
+// 失败时返回 -1
+CFVPN_EXPORT int32_t cfvpn_config_builder_write(
+    CfvpnConfigBuilder* builder, const CfvpnV2rayConfigParams* params,
+    const char* path);
+
+CFVPN_EXPORT void cfvpn_config_builder_free(CfvpnConfigBuilder* builder);
+
+// ===== 分享链接 / 订阅解析 =====
+
+// 与 cfvpn::LinkProtocol 一致
+#define CFVPN_LINK_VMESS 1
+#define CFVPN_LINK_VLESS 2
+#define CFVPN_LINK_TROJAN 3
+#define CFVPN_LINK_SHADOWSOCKS 4
+
+// 字符串池（cfvpn_links_strings）中的一段 UTF-8，不以 NUL 结尾
+typedef struct CfvpnStringRef {
+  int32_t offset;
+  int32_t length;
+} CfvpnStringRef;
+
+typedef struct CfvpnShareLink {
+  int32_t protocol;  // CFVPN_LINK_*
+  int32_t port;
+  int32_t line;      // 订阅中的行号，从 1 开始
+  int32_t reserved;
+  CfvpnStringRef name;
+  CfvpnStringRef address;
+  CfvpnStringRef user_id;   // vmess/vless 的 UUID，trojan/ss 的密码
+  CfvpnStringRef method;    // ss 的加密方式，vmess 的 scy，vless 的 encryption
+  CfvpnStringRef network;
+  CfvpnStringRef security;
+  CfvpnStringRef host;
+  CfvpnStringRef path;
+  CfvpnStringRef sni;
+} CfvpnShareLink;
+
+typedef struct CfvpnLinkError {
+  int32_t line;  // 0 表示整份订阅无法解码
+  CfvpnStringRef message;
+} CfvpnLinkError;
+
+typedef struct CfvpnLinkBatch CfvpnLinkBatch;
+
+// 解析整份订阅（整体 base64 或逐行的分享链接，UTF-8）。
+// 结果数组和字符串池在 cfvpn_links_free 之前有效。
+CFVPN_EXPORT CfvpnLinkBatch* cfvpn_links_parse(const char* data,
+                                               int32_t length);
+
+CFVPN_EXPORT int32_t cfvpn_links_count(CfvpnLinkBatch* batch);
+CFVPN_EXPORT const CfvpnShareLink* cfvpn_links_records(CfvpnLinkBatch* batch);
+CFVPN_EXPORT int32_t cfvpn_links_error_count(CfvpnLinkBatch* batch);
+CFVPN_EXPORT const CfvpnLinkError* cfvpn_links_errors(CfvpnLinkBatch* batch);
+CFVPN_EXPORT const char* cfvpn_links_strings(CfvpnLinkBatch* batch);
+CFVPN_EXPORT int32_t cfvpn_links_strings_size(CfvpnLinkBatch* batch);
+
+CFVPN_EXPORT void cfvpn_links_free(CfvpnLinkBatch* batch);
+
+// ===== v2ray 进程看护 =====
+
+#define CFVPN_SUPERVISOR_STOPPED 0
+#define CFVPN_SUPERVISOR_STARTING 1
+#define CFVPN_SUPERVISOR_READY 2
+#define CFVPN_SUPERVISOR_BACKOFF 3  // 进程崩溃，等待自动重启
+#define CFVPN_SUPERVISOR_FAILED 4   // 超过重启上限，已放弃
+
+typedef struct CfvpnSupervisorOptions {
+  const char* executable;         // UTF-8
+  const char* working_directory;  // 可为 NULL
+  const char* const* arguments;   // 不含可执行文件本身
+  int32_t argument_count;
+  int32_t ready_port_count;
+  const uint16_t* ready_ports;    // 全部可连接才算就绪
+  // 以下字段为 0 时使用默认值
+  int32_t ready_timeout_ms;       // 默认 10000
+  int32_t max_restarts;           // 连续崩溃的重启上限，默认 5，-1 表示不重启
+  int32_t backoff_initial_ms;     // 默认 500，每次翻倍
+  int32_t backoff_max_ms;         // 默认 15000
+  int32_t stop_grace_ms;          // 默认 2000
+} CfvpnSupervisorOptions;
+
+typedef struct CfvpnSupervisorStatus {
+  int32_t state;  // CFVPN_SUPERVISOR_*
+  int32_t restarts;
+  int32_t last_exit_code;
+  int32_t reserved;
+  int64_t pid;
+  int64_t ready_latency_us;  // 最近一次启动到就绪的耗时
+  char last_error[256];      // 以 NUL 结尾，过长时截断
+} CfvpnSupervisorStatus;
+
+typedef struct CfvpnSupervisor CfvpnSupervisor;
+
+// 在后台线程启动并看护 v2ray：stdout/stderr 逐行写入原生日志（tag V2Ray），
+// 输出 "started" 后确认入站端口可连接即为就绪；意外退出时按指数退避重启。
+// Windows 下子进程放入作业对象，runner 退出（包括崩溃）时由系统一并结束。
+// 字符串和数组会被复制。
+CFVPN_EXPORT CfvpnSupervisor* cfvpn_supervisor_start(
+    const CfvpnSupervisorOptions* options);
+
+CFVPN_EXPORT void cfvpn_supervisor_status(CfvpnSupervisor* supervisor,
+                                          CfvpnSupervisorStatus* out);
+
+// 请求停止，不等待；状态变为 STOPPED 时进程已被回收
+CFVPN_EXPORT void cfvpn_supervisor_stop(CfvpnSupervisor* supervisor);
+
+// 停止（必要时强制结束子进程）并释放
+CFVPN_EXPORT void cfvpn_supervisor_free(CfvpnSupervisor* supervisor);
+
+// ===== 节点健康检查 =====
+
+// 以下字段为 0 时使用默认值
+typedef struct CfvpnHealthOptions {
+  int32_t active_interval_ms;   // 当前节点的探测间隔，默认 2000
+  int32_t standby_interval_ms;  // 每个备用节点的探测间隔，默认 10000
+  int32_t timeout_ms;           // 默认 1000
+  int32_t max_latency_ms;       // 默认 300
+  int32_t max_jitter_ms;        // 默认 100
+  float max_loss_rate;          // 默认 0.3
+  int32_t degraded_checks;      // 连续超过阈值多少次才切换，默认 3
+  int32_t cooldown_ms;          // 两次切换的最短间隔，默认 30000
+} CfvpnHealthOptions;
+
+typedef struct CfvpnNodeHealth {
+  float latency_ms;  // EWMA，没有成功样本时为 -1
+  float jitter_ms;
+  float loss_rate;
+  int32_t samples;
+  int32_t failure_streak;
+  uint8_t degraded;
+  uint8_t active;
+  uint8_t reserved[2];
+} CfvpnNodeHealth;
+
+typedef struct CfvpnHealthMonitor CfvpnHealthMonitor;
+
+// 在后台线程对已连接节点（addresses[0]）和备用节点做周期性 TCP 握手，
+// 当前节点持续超过阈值时切换到明显更好的备用节点，并写一条日志
+// （tag Health）。调用方轮询 cfvpn_health_monitor_active 得知切换并自行
+// 重新生成出站配置。count 为 0 时返回 NULL。
+CFVPN_EXPORT CfvpnHealthMonitor* cfvpn_health_monitor_start(
+    const CfvpnIpAddress* addresses, int32_t count, uint16_t port,
+    const CfvpnHealthOptions* options);
+
+// 当前节点在 addresses 中的下标
+CFVPN_EXPORT int32_t cfvpn_health_monitor_active(CfvpnHealthMonitor* monitor);
+
+CFVPN_EXPORT int32_t cfvpn_health_monitor_failovers(
+    CfvpnHealthMonitor* monitor);
+
+// 按 addresses 的顺序写出最多 capacity 个节点的统计，返回写出的个数
+CFVPN_EXPORT int32_t cfvpn_health_monitor_snapshot(
+    CfvpnHealthMonitor* monitor, CfvpnNodeHealth* out, int32_t capacity);
+
+// 停止监控线程并释放
+CFVPN_EXPORT void cfvpn_health_monitor_free(CfvpnHealthMonitor* monitor);
+
+// ===== DNS 解析 =====
+
+// 与 cfvpn::DnsStatus 一致
+#define CFVPN_DNS_OK 0
+#define CFVPN_DNS_NXDOMAIN 1
+#define CFVPN_DNS_SERVFAIL 2
+#define CFVPN_DNS_TIMEOUT 3
+#define CFVPN_DNS_INVALID_NAME 4
+#define CFVPN_DNS_CANCELLED 5
+
+// 以下数值字段为 0 时使用默认值
+typedef struct CfvpnDnsOptions {
+  // 以逗号分隔的上游，"ip[:port]" 或 "[ipv6]:port"，"tcp://" 前缀表示
+  // 只用 DNS over TCP（例如经隧道的 v2ray dns-in 入站）
+  const char* upstreams;
+  int32_t timeout_ms;        // 每个上游的超时，默认 2000
+  int32_t cache_capacity;    // 默认 1024
+  int32_t min_ttl_sec;       // 默认 30
+  int32_t max_ttl_sec;       // 默认 3600
+  int32_t negative_ttl_sec;  // 默认 60
+  int32_t prefetch_hits;     // 默认 2，小于 0 时不预取
+  float prefetch_ratio;      // 默认 0.1
+  int32_t disable_ipv6;      // 非 0 时不查询 AAAA
+  int32_t listen_port;       // 127.0.0.1 上的 UDP 服务，0 不开启，-1 由系统分配
+} CfvpnDnsOptions;
+
+typedef struct CfvpnDnsAnswer {
+  int32_t status;         // CFVPN_DNS_*
+  int32_t ttl_sec;        // 剩余 TTL
+  int32_t from_cache;
+  int32_t address_count;  // 地址总数，可能大于写出的数量
+} CfvpnDnsAnswer;
+
+typedef struct CfvpnDnsStats {
+  int64_t lookups;
+  int64_t cache_hits;
+  int64_t cache_misses;
+  int64_t coalesced;
+  int64_t prefetches;
+  int64_t upstream_queries;
+  int64_t upstream_timeouts;
+  int64_t tcp_fallbacks;
+  int64_t served;
+  int64_t cache_size;
+} CfvpnDnsStats;
+
+typedef struct CfvpnDnsResolver CfvpnDnsResolver;
+typedef struct CfvpnDnsQuery CfvpnDnsQuery;
+
+// 创建并启动进程内解析器（TTL 缓存、A/AAAA 并行查询、热门名称预取）。
+// 失败时返回 NULL，并把原因写入以 NUL 结尾的 error（可为 NULL）。
+CFVPN_EXPORT CfvpnDnsResolver* cfvpn_dns_resolver_create(
+    const CfvpnDnsOptions* options, char* error, int32_t error_capacity);
+
+// 本地 UDP 服务实际监听的端口，未开启时为 0
+CFVPN_EXPORT int32_t cfvpn_dns_resolver_local_port(CfvpnDnsResolver* resolver);
+
+// 清空缓存，代替 ipconfig /flushdns
+CFVPN_EXPORT void cfvpn_dns_resolver_clear(CfvpnDnsResolver* resolver);
+
+CFVPN_EXPORT void cfvpn_dns_resolver_stats(CfvpnDnsResolver* resolver,
+                                           CfvpnDnsStats* out);
+
+// 停止解析器并释放，未结束的查询以 CFVPN_DNS_CANCELLED 结束
+CFVPN_EXPORT void cfvpn_dns_resolver_free(CfvpnDnsResolver* resolver);
+
+// 异步解析一个名称。缓存命中时返回的查询已经结束。
+CFVPN_EXPORT CfvpnDnsQuery* cfvpn_dns_resolve_start(CfvpnDnsResolver* resolver,
+                                                    const char* name);
+
+CFVPN_EXPORT int32_t cfvpn_dns_resolve_is_done(CfvpnDnsQuery* query);
+
+// 查询结束后写出结果和最多 capacity 个地址（先 IPv4 后 IPv6），
+// 返回写出的地址数；未结束时返回 -1
+CFVPN_EXPORT int32_t cfvpn_dns_resolve_result(CfvpnDnsQuery* query,
+                                              CfvpnDnsAnswer* out,
+                                              CfvpnIpAddress* addresses,
+                                              int32_t capacity);
+
+// 可在查询结束前调用，结果随后被丢弃
+CFVPN_EXPORT void cfvpn_dns_resolve_free(CfvpnDnsQuery* query);
+
+// ===== 本地中继 =====
+
+// 以下数值字段为 0 时使用默认值
+typedef struct CfvpnRelayOptions {
+  int32_t listen_port;        // 127.0.0.1 上的端口，0 由系统分配
+  int32_t upstream_port;      // 127.0.0.1 上 v2ray 的 http 或 socks 入站
+  int32_t max_connections;    // 默认 1024
+  int32_t max_destinations;   // 按目标统计的条目数，默认 1024
+  int32_t buffer_bytes;       // 每个方向的缓冲，默认 65536
+  int32_t disable_zero_copy;  // 非 0 时 Linux 上也不用 splice
+} CfvpnRelayOptions;
+
+typedef struct CfvpnRelayTalker {
+  char destination[128];  // "host:port"，以 NUL 结尾；无法识别的为 "unknown"
+  int64_t bytes_up;       // 客户端发往上游
+  int64_t bytes_down;
+  int64_t connections;    // 累计连接数
+  int32_t active;
+  int32_t reserved;
+} CfvpnRelayTalker;
+
+typedef struct CfvpnRelayStats {
+  int64_t accepted;
+  int64_t rejected;  // 超过 max_connections
+  int64_t upstream_failures;
+  int64_t bytes_up;
+  int64_t bytes_down;
+  int64_t zero_copy_bytes;  // 其中经 splice 搬运的字节
+  int32_t active;
+  int32_t zero_copy;        // 是否使用 splice
+} CfvpnRelayStats;
+
+typedef struct CfvpnRelay CfvpnRelay;
+
+// 在 127.0.0.1 上启动转发到 upstream_port 的中继，按 HTTP/SOCKS5 代理
+// 请求识别目标并按连接和目标统计流量，系统代理改指向 cfvpn_relay_port
+// 即可。失败时返回 NULL，并把原因写入以 NUL 结尾的 error（可为 NULL）。
+CFVPN_EXPORT CfvpnRelay* cfvpn_relay_start(const CfvpnRelayOptions* options,
+                                           char* error,
+                                           int32_t error_capacity);
+
+CFVPN_EXPORT int32_t cfvpn_relay_port(CfvpnRelay* relay);
+
+CFVPN_EXPORT void cfvpn_relay_stats(CfvpnRelay* relay, CfvpnRelayStats* out);
+
+// 按上下行字节总和从大到小写出最多 capacity 个目标，返回写出的个数
+CFVPN_EXPORT int32_t cfvpn_relay_top_talkers(CfvpnRelay* relay,
+                                             CfvpnRelayTalker* out,
+                                             int32_t capacity);
+
+// 关闭全部连接并释放
+CFVPN_EXPORT void cfvpn_relay_free(CfvpnRelay* relay);
+
+// ===== 启动预热 =====
+
+#define CFVPN_PREWARM_NOT_STARTED 0
+#define CFVPN_PREWARM_RUNNING 1
+#define CFVPN_PREWARM_DONE 2
+
+typedef struct CfvpnPrewarmOptions {
+  const char* node_cache_path;       // UTF-8，可为 NULL
+  int32_t node_cache_capacity;       // 0 使用默认值，需与 Dart 端一致
+  int32_t geo_file_count;
+  const char* config_template_path;  // 可为 NULL
+  const char* v2ray_path;            // 可为 NULL
+  const char* const* geo_files;
+} CfvpnPrewarmOptions;
+
+typedef struct CfvpnPrewarmStatus {
+  int32_t state;            // CFVPN_PREWARM_*
+  int32_t node_cache_size;  // 缓存未打开时为 -1
+  int32_t template_loaded;
+  int32_t v2ray_found;      // 存在且是可执行文件
+  int32_t geo_missing;      // 缺失的 geo 文件数
+  int32_t reserved;
+  int64_t v2ray_size;
+  int64_t started_us;       // 启动时刻，cfvpn_trace_now_us 的时钟
+  int64_t total_us;
+  int64_t node_cache_us;
+  int64_t template_us;
+  int64_t files_us;
+  int64_t prefetched_bytes;
+  char message[256];        // 模板错误或第一个缺失的文件，以 NUL 结尾
+} CfvpnPrewarmStatus;
+
+// 在后台线程中打开节点缓存、预解析配置模板、检查 v2ray 和 geo 文件。
+// 进程内只执行一次：runner 在创建 Flutter 引擎前调用，之后的调用返回 0
+// （cfvpn_prewarm_reset 之后除外）。
+// 字符串会被复制。
+CFVPN_EXPORT int32_t cfvpn_prewarm_start(const CfvpnPrewarmOptions* options);
+
+// 最多等待 timeout_ms（0 不等待）直到预热结束，返回 CFVPN_PREWARM_*。
+// out 可为 NULL。
+CFVPN_EXPORT int32_t cfvpn_prewarm_status(int32_t timeout_ms,
+                                          CfvpnPrewarmStatus* out);
+
+// 取走预热打开的节点缓存 / 解析好的模板，所有权转给调用方
+// （之后用 cfvpn_node_cache_close / cfvpn_config_builder_free 释放）。
+// 预热未结束、失败或已被取走时返回 NULL。
+CFVPN_EXPORT CfvpnNodeCache* cfvpn_prewarm_take_node_cache(void);
+CFVPN_EXPORT CfvpnConfigBuilder* cfvpn_prewarm_take_config_builder(void);
+
+// 释放未取走的结果并回到未启动状态，之后可以再次 cfvpn_prewarm_start。
+// 预热进行中时不做任何事并返回 0，否则返回 1。
+CFVPN_EXPORT int32_t cfvpn_prewarm_reset(void);
+
+// ===== 启动追踪 =====
+
+// 追踪时钟（单调，微秒），与 runner 中原生区间使用同一起点
+CFVPN_EXPORT int64_t cfvpn_trace_now_us(void);
+
+// 记录一个已结束的区间。start_us 取自 cfvpn_trace_now_us；名称会被复制。
+// category 可为 NULL（默认 "dart"）。
+CFVPN_EXPORT void cfvpn_trace_add_span(const char* name, const char* category,
+                                       int64_t start_us, int64_t duration_us);
+
+// 记录一个瞬时事件
+CFVPN_EXPORT void cfvpn_trace_instant(const char* name, const char* category);
+
+// 丢弃目前记录的全部事件（线程名保留）
+CFVPN_EXPORT void cfvpn_trace_clear(void);
+
+// 把目前记录的全部事件写成 Chrome trace_event JSON（UTF-8 路径），
+// 返回写入的事件数（不含线程名元数据），失败返回 -1
+CFVPN_EXPORT int32_t cfvpn_trace_dump(const char* path);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // NATIVE_CORE_NATIVE_API_H_
@@ -0,0 +1,282 @@
+#include "core/node_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace cfvpn {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x514E4643;  // "CFNQ"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kRecordSize = 32;
+constexpr size_t kChecksumOffset = 4;
+constexpr uint16_t kSaturated = std::numeric_limits<uint16_t>::max();
+
+struct FileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t capacity;
+  uint32_t checksum;  // 前面各字段的 FNV-1a
+};
+
+// FNV-1a，足以发现写到一半的记录
+uint32_t Fnv1a(const void* data, size_t length, uint32_t hash = 2166136261u) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// 记录的校验和覆盖除校验和字段本身以外的全部字节
+uint32_t RecordChecksum(const void* record) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(record);
+  uint32_t hash = Fnv1a(bytes, kChecksumOffset);
+  return Fnv1a(bytes + kChecksumOffset + sizeof(uint32_t),
+               kRecordSize - kChecksumOffset - sizeof(uint32_t), hash);
+}
+
+}  // namespace
+
+// 磁盘上的记录布局，小端
+struct NodeCache::Record {
+  uint32_t ip;        // 0 表示空槽
+  uint32_t checksum;  // 除本字段外其余字节的 FNV-1a
+  int64_t last_seen;
+  float latency_ms;
+  float loss_rate;
+  uint16_t samples;
+  uint16_t failure_streak;
+  char colo[4];
+};
+
+static_assert(sizeof(FileHeader) <= kHeaderSize, "header too large");
+
+bool NodeCache::Open(const std::string& path, const NodeCacheOptions& options) {
+  static_assert(sizeof(Record) == kRecordSize &&
+                    offsetof(Record, checksum) == kChecksumOffset,
+                "record layout changed");
+  Close();
+  options_ = options;
+  options_.alpha = std::min(1.0, std::max(0.01, options_.alpha));
+  capacity_ = std::max<uint32_t>(1, options_.capacity);
+  const size_t size = kHeaderSize + kRecordSize * capacity_;
+  if (!file_.Open(path, size)) {
+    capacity_ = 0;
+    return false;
+  }
+
+  FileHeader header;
+  std::memcpy(&header, file_.data(), sizeof(header));
+  const bool valid =
+      file_.original_size() == size && header.magic == kMagic &&
+      header.version == kVersion && header.record_size == kRecordSize &&
+      header.capacity == capacity_ &&
+      header.checksum == Fnv1a(&header, offsetof(FileHeader, checksum));
+  if (valid) {
+    Load();
+  } else {
+    Initialize();
+  }
+  return true;
+}
+
+void NodeCache::Close() {
+  file_.Close();
+  index_.clear();
+  free_slots_.clear();
+  capacity_ = 0;
+  discarded_ = 0;
+  rebuilt_ = false;
+}
+
+void NodeCache::ReadRecord(uint32_t slot, Record* out) const {
+  std::memcpy(out, file_.data() + kHeaderSize + kRecordSize * slot,
+              kRecordSize);
+}
+
+void NodeCache::WriteRecord(uint32_t slot, Record* record) {
+  record->checksum = RecordChecksum(record);
+  std::memcpy(file_.data() + kHeaderSize + kRecordSize * slot, record,
+              kRecordSize);
+}
+
+void NodeCache::Initialize() {
+  // 先清空记录区，最后写文件头：中途崩溃时下次打开仍会重建
+  std::memset(file_.data(), 0, file_.size());
+  FileHeader header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.record_size = static_cast<uint16_t>(kRecordSize);
+  header.capacity = capacity_;
+  header.checksum = Fnv1a(&header, offsetof(FileHeader, checksum));
+  std::memcpy(file_.data(), &header, sizeof(header));
+  file_.Flush();
+
+  index_.clear();
+  free_slots_.clear();
+  for (uint32_t slot = capacity_; slot > 0; --slot) {
+    free_slots_.push_back(slot - 1);
+  }
+  rebuilt_ = true;
+}
+
+void NodeCache::Load() {
+  index_.clear();
+  free_slots_.clear();
+  index_.reserve(capacity_);
+  const Record empty = {};
+  for (uint32_t slot = capacity_; slot > 0; --slot) {
+    const uint32_t current = slot - 1;
+    Record record;
+    ReadRecord(current, &record);
+    bool keep = record.ip != 0;
+    if (keep) {
+      keep = record.checksum == RecordChecksum(&record) &&
+             index_.count(record.ip) == 0;
+      if (!keep) {
+        ++discarded_;
+      }
+    }
+    if (keep) {
+      index_.emplace(record.ip, current);
+    } else {
+      if (std::memcmp(&record, &empty, kRecordSize) != 0) {
+        std::memcpy(file_.data() + kHeaderSize + kRecordSize * current,
+                    &empty, kRecordSize);
+      }
+      free_slots_.push_back(current);
+    }
+  }
+}
+
+uint32_t NodeCache::AllocateSlot() {
+  if (!free_slots_.empty()) {
+    uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+  }
+  // 已满：淘汰最久没有探测过的节点
+  uint32_t victim_ip = 0;
+  uint32_t victim_slot = 0;
+  int64_t oldest = std::numeric_limits<int64_t>::max();
+  for (const auto& entry : index_) {
+    Record record;
+    ReadRecord(entry.second, &record);
+    if (record.last_seen < oldest) {
+      oldest = record.last_seen;
+      victim_ip = entry.first;
+      victim_slot = entry.second;
+    }
+  }
+  index_.erase(victim_ip);
+  return victim_slot;
+}
+
+void NodeCache::Update(const NodeSample& sample, int64_t now) {
+  if (!is_open() || sample.ip == 0) {
+    return;
+  }
+  const bool probed = sample.loss_rate >= 0;
+  const bool failed =
+      probed && (sample.latency_ms < 0 || sample.loss_rate >= 1.0f);
+  Record record = {};
+  uint32_t slot;
+  auto it = index_.find(sample.ip);
+  if (it != index_.end()) {
+    slot = it->second;
+    ReadRecord(slot, &record);
+  } else {
+    // 只为成功过的节点建立记录：一次扫描中绝大多数失败的候选IP
+    // 不值得占用容量，更不应该把已知的好节点挤出去
+    if (!probed || failed) {
+      return;
+    }
+    slot = AllocateSlot();
+    record.ip = sample.ip;
+    index_.emplace(sample.ip, slot);
+  }
+
+  if (probed) {
+    const float loss = failed ? 1.0f : sample.loss_rate;
+    const float alpha = static_cast<float>(options_.alpha);
+    // 第一次探测直接采用样本值
+    const bool first = record.samples == 0 && record.failure_streak == 0;
+    record.loss_rate =
+        first ? loss : alpha * loss + (1.0f - alpha) * record.loss_rate;
+    if (failed) {
+      if (record.failure_streak < kSaturated) {
+        ++record.failure_streak;
+      }
+    } else {
+      const float latency = static_cast<float>(sample.latency_ms);
+      record.latency_ms =
+          record.samples == 0
+              ? latency
+              : alpha * latency + (1.0f - alpha) * record.latency_ms;
+      if (record.samples < kSaturated) {
+        ++record.samples;
+      }
+      record.failure_streak = 0;
+    }
+    record.last_seen = now;
+  }
+  if (sample.colo[0] != '\0') {
+    std::memcpy(record.colo, sample.colo, sizeof(record.colo));
+    record.colo[sizeof(record.colo) - 1] = '\0';
+  }
+  WriteRecord(slot, &record);
+}
+
+bool NodeCache::Lookup(uint32_t ip, NodeQuality* out) const {
+  auto it = index_.find(ip);
+  if (it == index_.end()) {
+    return false;
+  }
+  Record record;
+  ReadRecord(it->second, &record);
+  out->ip = record.ip;
+  out->latency_ms = record.latency_ms;
+  out->loss_rate = record.loss_rate;
+  out->score = Score(record.latency_ms, record.loss_rate);
+  out->last_seen = record.last_seen;
+  out->samples = record.samples;
+  out->failure_streak = record.failure_streak;
+  std::memcpy(out->colo, record.colo, sizeof(out->colo));
+  return true;
+}
+
+size_t NodeCache::Best(int64_t now, int64_t max_age,
+                       uint32_t max_failure_streak, NodeQuality* out,
+                       size_t count) const {
+  if (count == 0) {
+    return 0;
+  }
+  std::vector<NodeQuality> candidates;
+  candidates.reserve(index_.size());
+  for (const auto& entry : index_) {
+    NodeQuality quality;
+    Lookup(entry.first, &quality);
+    if (quality.samples == 0 || quality.failure_streak >= max_failure_streak ||
+        now - quality.last_seen > max_age) {
+      continue;
+    }
+    candidates.push_back(quality);
+  }
+  const size_t selected = std::min(count, candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + selected,
+                    candidates.end(),
+                    [](const NodeQuality& a, const NodeQuality& b) {
+                      return a.score < b.score ||
+                             (a.score == b.score && a.ip < b.ip);
+                    });
+  std::copy(candidates.begin(), candidates.begin() + selected, out);
+  return selected;
+}
+
+}  // namespace cfvpn
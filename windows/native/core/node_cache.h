@@ -0,0 +1,116 @@
+#ifndef NATIVE_CORE_NODE_CACHE_H_
+#define NATIVE_CORE_NODE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/mapped_file.h"
+
+namespace cfvpn {
+
+struct NodeCacheOptions {
+  // 最多保存的节点数，文件大小固定为 64 + 32 * capacity 字节
+  uint32_t capacity = 4096;
+  // EWMA 系数：新样本的权重
+  double alpha = 0.3;
+};
+
+// 一次探测的结果
+struct NodeSample {
+  uint32_t ip = 0;  // 主机字节序
+  // 成功时的延迟；小于 0 或 loss_rate >= 1 表示本次探测失败
+  int32_t latency_ms = -1;
+  // 小于 0 表示没有探测结果，只更新 colo
+  float loss_rate = 0;
+  char colo[4] = {};  // 数据中心代码，为空时不更新
+};
+
+// 节点的历史质量
+struct NodeQuality {
+  uint32_t ip = 0;
+  float latency_ms = 0;  // 成功探测延迟的 EWMA
+  float loss_rate = 0;   // 丢包率的 EWMA
+  float score = 0;       // 越小越好，见 NodeCache::Score
+  int64_t last_seen = 0;  // 最近一次探测的 Unix 时间（秒）
+  uint32_t samples = 0;   // 有效探测次数（饱和于 65535）
+  uint32_t failure_streak = 0;  // 连续失败次数
+  char colo[4] = {};
+};
+
+// 持久化的节点质量缓存，按 IPv4 索引。
+//
+// 文件是固定大小的记录数组，通过内存映射读写，更新只改动对应的一条
+// 32 字节记录，不会增长。满了以后淘汰最久没有探测过的节点。
+// 启动时用 Best() 直接从缓存里挑选节点，不必等待完整测速。
+//
+// 崩溃安全：每条记录带校验和，写到一半的记录在下次打开时被丢弃；
+// 文件头带版本号，格式不匹配或文件头损坏时整个缓存重建。缓存只是加速，
+// 丢失的数据可以通过重新测速恢复。
+//
+// 非线程安全，C 接口中由互斥锁串行化。
+class NodeCache {
+ public:
+  NodeCache() = default;
+
+  NodeCache(const NodeCache&) = delete;
+  NodeCache& operator=(const NodeCache&) = delete;
+
+  // 打开或创建缓存文件，path 为 UTF-8
+  bool Open(const std::string& path, const NodeCacheOptions& options);
+  void Close();
+  bool is_open() const { return file_.is_open(); }
+
+  // 当前保存的节点数
+  size_t size() const { return index_.size(); }
+  uint32_t capacity() const { return capacity_; }
+
+  // 打开时因校验失败被丢弃的记录数
+  size_t discarded() const { return discarded_; }
+
+  // 打开时是否重建了文件（新建、版本不符或文件头损坏）
+  bool rebuilt() const { return rebuilt_; }
+
+  // 合并一次探测结果，now 为 Unix 时间（秒）。只有成功的探测会新建记录，
+  // 失败和只带 colo 的样本只更新已有节点。
+  void Update(const NodeSample& sample, int64_t now);
+
+  bool Lookup(uint32_t ip, NodeQuality* out) const;
+
+  // 选出最多 count 个最好的节点写入 out（按 score 升序），返回数量。
+  // 只考虑 max_age 秒内探测过、至少成功过一次且连续失败少于
+  // max_failure_streak 次的节点。
+  size_t Best(int64_t now, int64_t max_age, uint32_t max_failure_streak,
+              NodeQuality* out, size_t count) const;
+
+  // 发起写回
+  bool Flush() { return file_.Flush(); }
+
+  // 排序用的综合分：平滑延迟加上丢包惩罚（每 10% 丢包折合 100ms）
+  static float Score(float latency_ms, float loss_rate) {
+    return latency_ms + loss_rate * 1000.0f;
+  }
+
+ private:
+  struct Record;
+
+  void ReadRecord(uint32_t slot, Record* out) const;
+  void WriteRecord(uint32_t slot, Record* record);
+  uint32_t AllocateSlot();
+  void Initialize();
+  void Load();
+
+  MappedFile file_;
+  NodeCacheOptions options_;
+  uint32_t capacity_ = 0;
+  std::unordered_map<uint32_t, uint32_t> index_;  // ip -> 槽位
+  std::vector<uint32_t> free_slots_;
+  size_t discarded_ = 0;
+  bool rebuilt_ = false;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_NODE_CACHE_H_
@@ -0,0 +1,187 @@
+#include "core/node_scanner.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+namespace {
+
+// Trace 失败时的耗时，与 _performTraceTestNative 一致
+constexpr int32_t kFailedTraceMs = 9999;
+
+// 以 NUL 结尾（或占满整个数组）的定长字段
+template <size_t N>
+std::string FixedString(const char (&field)[N]) {
+  return std::string(field, std::find(field, field + N, '\0'));
+}
+
+// Dart 端把 maxLatency 同时作为 TCPing 的连接超时
+TcpingOptions TcpingFor(const ScanOptions& options) {
+  TcpingOptions tcping = options.tcping;
+  tcping.timeout_ms = options.max_latency_ms;
+  return tcping;
+}
+
+uint64_t SeedFor(const ScanOptions& options) {
+  return options.seed != 0
+             ? options.seed
+             : static_cast<uint64_t>(
+                   std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+}  // namespace
+
+ScanOptions::ScanOptions() {
+  ParseCidrList(kCloudflareIpRanges, &ranges);
+  // 与 CloudflareTestService._testLatencyNative 传入的参数一致
+  tcping.attempts = 3;
+  tcping.min_valid_latency_ms = 30;
+  tcping.interval_ms = 50;
+  tcping.max_inflight = 1024;
+  tcping.adaptive_inflight = true;
+  tcping.min_inflight = 32;
+  tcping.initial_inflight = 256;
+  tcping.stop_after_good = 10;
+  tcping.good_latency_ms = 300;
+  tcping.good_loss_rate = 0.1f;
+  tcping.failure_window = 60;
+  // 与 _performTraceTestNative 一致
+  http.timeout_ms = 5000;
+  http.max_inflight = 64;
+}
+
+NodeScanner::NodeScanner(const ScanOptions& options)
+    : options_(options),
+      seed_(SeedFor(options)),
+      tcping_(TcpingFor(options)),
+      http_(options.http),
+      cancelled_(false) {
+  if (options_.sampler == ScanSampler::kBandit) {
+    bandit_ = std::make_unique<BanditProber>(
+        options_.ranges, TcpingFor(options_), options_.bandit, seed_);
+    bandit_->AddHistory(options_.history.data(), options_.history.size());
+  }
+}
+
+void NodeScanner::Cancel() {
+  cancelled_.store(true, std::memory_order_relaxed);
+  tcping_.Cancel();
+  if (bandit_) bandit_->Cancel();
+  http_.Cancel();
+}
+
+bool NodeScanner::Run(std::vector<ScanResult>* ranked, ScanSummary* summary,
+                      const ProgressCallback& progress) {
+  ranked->clear();
+  *summary = ScanSummary();
+  if (options_.ranges.empty()) return false;
+  InitSocketLibrary();
+
+  int64_t phase_us = MonotonicMicros();
+  std::vector<ProbeResult> probes;
+  size_t done = 0;
+  if (bandit_) {
+    // 1+2. 采样与 TCPing 交替进行，由 bandit 决定每轮探测哪些段
+    const size_t budget =
+        static_cast<size_t>(std::max(options_.sample_count, 0));
+    const bool tcping_ok = bandit_->Run(
+        options_.port, budget, &probes, [&](size_t, const ProbeResult&) {
+          if (progress) progress(ScanPhase::kTcping, ++done, budget);
+        });
+    summary->tcping_us = MonotonicMicros() - phase_us;
+    if (!tcping_ok) return false;
+    summary->sampled = probes.size();
+    summary->stop_reason = bandit_->stop_reason();
+  } else {
+    // 1. CIDR 采样
+    std::vector<ProbeTarget> targets;
+    {
+      const Ipv4RangeIndex index(options_.ranges);
+      CidrSampler sampler(index);
+      std::vector<uint32_t> ips(static_cast<size_t>(
+          std::max(options_.sample_count, 0)));
+      ips.resize(sampler.Sample(ips.size(), seed_, ips.data()));
+      targets.reserve(ips.size());
+      for (uint32_t ip : ips) targets.push_back(ProbeTarget{ip, options_.port});
+    }
+    summary->sampled = targets.size();
+    summary->sample_us = MonotonicMicros() - phase_us;
+
+    // 2. TCPing
+    phase_us = MonotonicMicros();
+    const bool tcping_ok = tcping_.Run(
+        targets, &probes, [&](size_t, const ProbeResult&) {
+          if (progress) progress(ScanPhase::kTcping, ++done, targets.size());
+        });
+    summary->tcping_us = MonotonicMicros() - phase_us;
+    if (!tcping_ok) return false;
+    summary->stop_reason = tcping_.stop_reason();
+  }
+
+  std::vector<ScanResult> valid;
+  for (const ProbeResult& probe : probes) {
+    if (probe.sent > 0) ++summary->probed;
+    if (probe.received == 0 || probe.latency_ms > options_.max_latency_ms) {
+      continue;
+    }
+    ScanResult result;
+    result.ip = probe.ip;
+    result.port = probe.port;
+    result.latency_ms = probe.latency_ms;
+    result.loss_rate = probe.loss_rate;
+    result.score = probe.score;
+    valid.push_back(result);
+  }
+  std::stable_sort(valid.begin(), valid.end(),
+                   [](const ScanResult& a, const ScanResult& b) {
+                     return a.score < b.score;
+                   });
+  summary->reachable = valid.size();
+
+  // 3. Trace：测试全部低延迟节点
+  const size_t limit = options_.result_count > 0
+                           ? static_cast<size_t>(options_.result_count)
+                           : valid.size();
+  if (options_.trace && !valid.empty() &&
+      !cancelled_.load(std::memory_order_relaxed)) {
+    phase_us = MonotonicMicros();
+    std::vector<ProbeTarget> trace_targets;
+    trace_targets.reserve(valid.size());
+    for (const ScanResult& result : valid) {
+      trace_targets.push_back(ProbeTarget{result.ip, options_.trace_port});
+    }
+    std::vector<HttpProbeResult> traces;
+    done = 0;
+    const bool trace_ok = http_.Run(
+        trace_targets, &traces, [&](size_t, const HttpProbeResult&) {
+          if (progress) {
+            progress(ScanPhase::kTrace, ++done, trace_targets.size());
+          }
+        });
+    summary->trace_us = MonotonicMicros() - phase_us;
+    if (!trace_ok) return false;
+    for (size_t i = 0; i < valid.size() && i < traces.size(); ++i) {
+      const HttpProbeResult& trace = traces[i];
+      if (trace.sent > 0) ++summary->traced;
+      valid[i].trace_ms = trace.received > 0 ? trace.total_ms : kFailedTraceMs;
+      valid[i].colo = FixedString(trace.colo);
+      valid[i].loc = FixedString(trace.loc);
+    }
+    // 节点不足时保持得分顺序，否则按 Trace 耗时重新排序
+    if (valid.size() > limit) {
+      std::stable_sort(valid.begin(), valid.end(),
+                       [](const ScanResult& a, const ScanResult& b) {
+                         return a.trace_ms < b.trace_ms;
+                       });
+    }
+  }
+
+  if (valid.size() > limit) valid.resize(limit);
+  *ranked = std::move(valid);
+  return true;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,114 @@
+#ifndef NATIVE_CORE_NODE_SCANNER_H_
+#define NATIVE_CORE_NODE_SCANNER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/cidr_sampler.h"
+#include "core/http_probe_engine.h"
+#include "core/node_cache.h"
+#include "core/range_bandit.h"
+#include "core/tcping_engine.h"
+
+namespace cfvpn {
+
+// 与 AppConfig.cloudflareIpRanges 一致
+constexpr char kCloudflareIpRanges[] =
+    "173.245.48.0/20,103.21.244.0/22,103.22.200.0/22,103.31.4.0/22,"
+    "141.101.64.0/18,108.162.192.0/18,190.93.240.0/20,188.114.96.0/20,"
+    "197.234.240.0/22,198.41.128.0/17,162.158.0.0/15,104.16.0.0/12,"
+    "172.64.0.0/17,172.64.128.0/18,172.64.192.0/19,172.64.224.0/22,"
+    "172.64.229.0/24,172.64.230.0/23,172.64.232.0/21,172.64.240.0/21,"
+    "172.64.248.0/21,172.65.0.0/16,172.66.0.0/16,172.67.0.0/16,"
+    "131.0.72.0/22";
+
+// 地址的选取方式
+enum class ScanSampler : uint8_t {
+  kUniform,  // CidrSampler：一次性在各段间平均采样 sample_count 个地址
+  kBandit,   // BanditProber：sample_count 作为预算，按各段的优质节点比例分轮分配
+};
+
+// 一次完整扫描的参数，默认值与 CloudflareTestService 的原生路径一致
+struct ScanOptions {
+  ScanOptions();
+
+  std::vector<Ipv4Range> ranges;  // 默认 kCloudflareIpRanges
+  int sample_count = 500;         // AppConfig.defaultSampleCount
+  ScanSampler sampler = ScanSampler::kUniform;
+  RangeBanditOptions bandit;         // 仅 kBandit
+  std::vector<NodeQuality> history;  // kBandit 的先验，通常来自 NodeCache
+  uint64_t seed = 0;              // 0 表示按当前时间取种子
+  uint16_t port = 443;
+  int max_latency_ms = 300;       // AppConfig.defaultMaxLatency，也是 TCPing 超时
+  TcpingOptions tcping;           // 默认值见构造函数（_testLatencyNative）
+  bool trace = true;              // 对低延迟节点做 /cdn-cgi/trace 测速
+  uint16_t trace_port = 80;       // 与 _performTraceTestNative 一致
+  HttpProbeOptions http;
+  int result_count = 5;           // AppConfig.defaultTestNodeCount，0 表示全部
+};
+
+// 排好序的一个节点
+struct ScanResult {
+  uint32_t ip = 0;  // 主机字节序
+  uint16_t port = 0;
+  int32_t latency_ms = 0;
+  float loss_rate = 0;
+  float score = 0;  // ProbeResult::score，TCPing 阶段按它排序
+  // Trace 读完响应的耗时；失败时与 Dart 端一致为 9999，未做 Trace 时为 -1
+  int32_t trace_ms = -1;
+  std::string colo;
+  std::string loc;
+};
+
+enum class ScanPhase : uint8_t { kTcping, kTrace };
+
+struct ScanSummary {
+  size_t sampled = 0;
+  size_t probed = 0;     // TCPing 实际探测的目标数（可能提前结束）
+  size_t reachable = 0;  // 延迟不超过 max_latency_ms 的节点数
+  size_t traced = 0;
+  StopReason stop_reason = StopReason::kCompleted;
+  int64_t sample_us = 0;
+  int64_t tcping_us = 0;
+  int64_t trace_us = 0;
+};
+
+// 不依赖 Flutter 的完整节点扫描：CIDR 采样 -> TCPing -> Trace -> 排序，
+// 流程与 CloudflareTestService.executeTestWithProgress 的原生路径相同。
+// 供命令行工具（cfvpn_scan）在无界面的机器和 CI 上使用。
+class NodeScanner {
+ public:
+  // 每个目标完成时回调（在调用 Run 的线程中）
+  using ProgressCallback =
+      std::function<void(ScanPhase phase, size_t done, size_t total)>;
+
+  explicit NodeScanner(const ScanOptions& options);
+
+  NodeScanner(const NodeScanner&) = delete;
+  NodeScanner& operator=(const NodeScanner&) = delete;
+
+  // 阻塞执行扫描。ranked 按 Trace 耗时（节点多于 result_count 时）或
+  // TCPing 得分（tcping.score）排序，最多 result_count 个。ranges 为空或
+  // 事件循环初始化失败时返回 false。
+  bool Run(std::vector<ScanResult>* ranked, ScanSummary* summary,
+           const ProgressCallback& progress = nullptr);
+
+  // 请求取消，只写原子变量，可在信号处理函数中调用
+  void Cancel();
+
+ private:
+  ScanOptions options_;
+  uint64_t seed_;
+  TcpingEngine tcping_;
+  std::unique_ptr<BanditProber> bandit_;  // 仅 kBandit
+  HttpProbeEngine http_;
+  std::atomic<bool> cancelled_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_NODE_SCANNER_H_
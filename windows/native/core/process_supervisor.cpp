@@ -0,0 +1,321 @@
+#include "core/process_supervisor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+namespace {
+
+constexpr uint32_t kLoopbackIp = 0x7F000001;
+// 看到就绪标记后端口仍不可连接时（极少见）的重试间隔
+constexpr int kMarkerProbeMs = 10;
+// 单次端口检查的连接超时。Windows 上连接回环的未监听端口会重试 SYN，
+// 要靠超时结束，所以不能太长。
+constexpr int kProbeConnectTimeoutMs = 100;
+// 没有换行的输出超过该长度时直接作为一行交出
+constexpr size_t kMaxLineLength = 16 * 1024;
+
+bool ContainsIgnoreCase(std::string_view text, std::string_view needle) {
+  if (needle.empty()) return true;
+  auto it = std::search(text.begin(), text.end(), needle.begin(), needle.end(),
+                        [](char a, char b) {
+                          return std::tolower(static_cast<unsigned char>(a)) ==
+                                 std::tolower(static_cast<unsigned char>(b));
+                        });
+  return it != text.end();
+}
+
+bool LoopbackPortAccepts(uint16_t port) {
+  NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (socket == kInvalidSocket) return false;
+  bool connected = false;
+  if (SetNonBlocking(socket)) {
+    sockaddr_in address = MakeSockaddrV4(kLoopbackIp, port);
+    if (::connect(socket, reinterpret_cast<const sockaddr*>(&address),
+                  sizeof(address)) == 0) {
+      connected = true;
+    } else if (IsInProgressError(LastSocketError()) &&
+               PollSocket(socket, true, kProbeConnectTimeoutMs) == 1) {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      connected = ::getsockopt(socket, SOL_SOCKET, SO_ERROR,
+                               reinterpret_cast<char*>(&error), &length) == 0 &&
+                  error == 0;
+    }
+  }
+  CloseSocket(socket);
+  return connected;
+}
+
+// 把输出块切成行，去掉行尾的 \r
+class LineSplitter {
+ public:
+  template <typename Fn>
+  void Feed(const std::string& chunk, Fn&& emit) {
+    pending_ += chunk;
+    size_t start = 0;
+    for (;;) {
+      const size_t end = pending_.find('\n', start);
+      if (end == std::string::npos) break;
+      Emit(std::string_view(pending_).substr(start, end - start), emit);
+      start = end + 1;
+    }
+    pending_.erase(0, start);
+    if (pending_.size() > kMaxLineLength) Flush(emit);
+  }
+
+  template <typename Fn>
+  void Flush(Fn&& emit) {
+    if (!pending_.empty()) Emit(pending_, emit);
+    pending_.clear();
+  }
+
+ private:
+  template <typename Fn>
+  static void Emit(std::string_view line, Fn&& emit) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    emit(line);
+  }
+
+  std::string pending_;
+};
+
+}  // namespace
+
+ProcessSupervisor::ProcessSupervisor(SupervisorOptions options,
+                                     OutputHandler output)
+    : options_(std::move(options)), output_(std::move(output)) {}
+
+ProcessSupervisor::~ProcessSupervisor() { Stop(); }
+
+bool ProcessSupervisor::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) return false;
+  if (worker_.joinable()) worker_.join();  // 上一次已自行结束（kFailed）
+  InitSocketLibrary();
+  stopping_ = false;
+  running_ = true;
+  status_ = SupervisorStatus();
+  status_.state = SupervisorState::kStarting;
+  worker_ = std::thread(&ProcessSupervisor::Run, this);
+  return true;
+}
+
+void ProcessSupervisor::RequestStop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  changed_.notify_all();
+  child_.Wakeup();
+}
+
+void ProcessSupervisor::Stop() {
+  RequestStop();
+  if (worker_.joinable()) worker_.join();
+}
+
+bool ProcessSupervisor::WaitReady(int timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] {
+    return status_.state == SupervisorState::kReady || !running_ ||
+           status_.state == SupervisorState::kFailed;
+  });
+  return status_.state == SupervisorState::kReady;
+}
+
+bool ProcessSupervisor::WaitStopped(int timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return changed_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                           [this] { return !running_; });
+}
+
+SupervisorStatus ProcessSupervisor::status() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+void ProcessSupervisor::SetState(SupervisorState state) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.state = state;
+  }
+  changed_.notify_all();
+}
+
+bool ProcessSupervisor::stopping() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stopping_;
+}
+
+bool ProcessSupervisor::PortsReady() const {
+  for (uint16_t port : options_.ready_ports) {
+    if (!LoopbackPortAccepts(port)) return false;
+  }
+  return true;
+}
+
+void ProcessSupervisor::Run() {
+  int consecutive_failures = 0;
+  int backoff_ms = std::max(options_.backoff_initial_ms, 0);
+  SupervisorState final_state = SupervisorState::kStopped;
+  while (!stopping()) {
+    SetState(SupervisorState::kStarting);
+    std::string error;
+    RunResult result;
+    if (child_.Spawn(options_.process, &error)) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_.pid = child_.pid();
+      }
+      result = Supervise();
+    } else {
+      std::lock_guard<std::mutex> lock(mutex_);
+      status_.last_error = error;
+      status_.last_exit_code = -1;
+    }
+    if (stopping()) break;
+
+    // 意外退出或启动失败：稳定运行过一段时间的不算连续失败
+    if (result.became_ready &&
+        result.ran_us >= static_cast<int64_t>(options_.stable_run_ms) * 1000) {
+      consecutive_failures = 0;
+      backoff_ms = std::max(options_.backoff_initial_ms, 0);
+    }
+    if (++consecutive_failures > options_.max_restarts) {
+      final_state = SupervisorState::kFailed;
+      break;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      status_.state = SupervisorState::kBackoff;
+      status_.pid = 0;
+      ++status_.restarts;
+      changed_.notify_all();
+      changed_.wait_for(lock, std::chrono::milliseconds(backoff_ms),
+                        [this] { return stopping_; });
+    }
+    backoff_ms = std::min(std::max(backoff_ms * 2, 1), options_.backoff_max_ms);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.state = final_state;
+    status_.pid = 0;
+    running_ = false;
+  }
+  changed_.notify_all();
+}
+
+ProcessSupervisor::RunResult ProcessSupervisor::Supervise() {
+  RunResult result;
+  const int64_t started_us = MonotonicMicros();
+  const int64_t ready_deadline_us =
+      started_us + static_cast<int64_t>(options_.ready_timeout_ms) * 1000;
+  bool ready = false;
+  bool marker_seen = options_.ready_marker.empty();
+  bool terminating = false;
+  bool timed_out = false;
+  int64_t kill_deadline_us = 0;
+  LineSplitter stdout_lines;
+  LineSplitter stderr_lines;
+
+  auto mark_ready_if_bound = [&]() {
+    if (ready || !PortsReady()) return;
+    ready = true;
+    result.became_ready = true;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      status_.ready_latency_us = MonotonicMicros() - started_us;
+      status_.state = SupervisorState::kReady;
+    }
+    changed_.notify_all();
+  };
+  if (marker_seen) mark_ready_if_bound();
+
+  for (;;) {
+    const int64_t now_us = MonotonicMicros();
+    if (!terminating && stopping()) {
+      child_.Terminate();
+      terminating = true;
+      kill_deadline_us =
+          now_us + static_cast<int64_t>(options_.stop_grace_ms) * 1000;
+    }
+
+    int64_t wait_us = -1;
+    if (terminating) {
+      wait_us = std::max<int64_t>(kill_deadline_us - now_us, 0);
+    } else if (!ready) {
+      wait_us = std::max<int64_t>(ready_deadline_us - now_us, 0);
+      const int probe_ms =
+          marker_seen ? kMarkerProbeMs : options_.fallback_probe_ms;
+      if (probe_ms > 0) {
+        wait_us = std::min<int64_t>(wait_us, probe_ms * int64_t{1000});
+      }
+    }
+
+    std::string chunk;
+    bool from_stderr = false;
+    const ChildEvent event = child_.Wait(
+        wait_us < 0 ? -1 : static_cast<int>((wait_us + 999) / 1000), &chunk,
+        &from_stderr);
+    switch (event) {
+      case ChildEvent::kOutput: {
+        auto emit = [&](std::string_view line) {
+          if (output_) output_(line, from_stderr);
+          if (!marker_seen && ContainsIgnoreCase(line, options_.ready_marker)) {
+            marker_seen = true;
+          }
+        };
+        (from_stderr ? stderr_lines : stdout_lines).Feed(chunk, emit);
+        if (marker_seen) mark_ready_if_bound();
+        break;
+      }
+      case ChildEvent::kTimeout:
+        if (terminating) {
+          child_.Kill();
+        } else if (!ready) {
+          if (marker_seen || options_.fallback_probe_ms > 0) {
+            mark_ready_if_bound();
+          }
+          if (!ready && MonotonicMicros() >= ready_deadline_us) {
+            timed_out = true;
+            child_.Kill();
+            terminating = true;
+            kill_deadline_us = MonotonicMicros() +
+                               static_cast<int64_t>(options_.stop_grace_ms) *
+                                   1000;
+          }
+        }
+        break;
+      case ChildEvent::kWoken:
+        break;
+      case ChildEvent::kExited: {
+        auto emit = [&](bool is_stderr) {
+          return [&, is_stderr](std::string_view line) {
+            if (output_) output_(line, is_stderr);
+          };
+        };
+        stdout_lines.Flush(emit(false));
+        stderr_lines.Flush(emit(true));
+        result.ran_us = MonotonicMicros() - started_us;
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_.last_exit_code = child_.exit_code();
+        if (!stopping_) {
+          status_.last_error =
+              timed_out ? "启动超时：入站端口未就绪"
+                        : "进程意外退出，退出码 " +
+                              std::to_string(child_.exit_code());
+        }
+        return result;
+      }
+    }
+  }
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,111 @@
+#ifndef NATIVE_CORE_PROCESS_SUPERVISOR_H_
+#define NATIVE_CORE_PROCESS_SUPERVISOR_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/child_process.h"
+
+namespace cfvpn {
+
+struct SupervisorOptions {
+  ChildProcessOptions process;
+  // 回环地址上需要能连接的入站端口，全部可连接才算就绪
+  std::vector<uint16_t> ready_ports;
+  // 输出中出现该文本（不区分大小写）时立即检查端口。v2ray 在所有入站
+  // 监听完成后才打印 "V2Ray x.y.z started"（warning 级别）。
+  std::string ready_marker = "started";
+  int ready_timeout_ms = 10000;  // 超时仍未就绪视为启动失败
+  // 没看到标记时检查端口的间隔，兼容关闭了日志的配置；0 表示只依赖标记
+  int fallback_probe_ms = 250;
+  int max_restarts = 5;  // 连续崩溃后自动重启的次数上限
+  int backoff_initial_ms = 500;
+  int backoff_max_ms = 15000;
+  // 运行超过该时长后才崩溃的不算连续失败，退避重新从初始值开始
+  int stable_run_ms = 60000;
+  int stop_grace_ms = 2000;  // 请求退出后等待多久再强制结束
+};
+
+enum class SupervisorState : uint8_t {
+  kStopped = 0,
+  kStarting = 1,
+  kReady = 2,
+  kBackoff = 3,  // 子进程崩溃，等待重启
+  kFailed = 4,   // 超过重启上限，已放弃
+};
+
+struct SupervisorStatus {
+  SupervisorState state = SupervisorState::kStopped;
+  int64_t pid = 0;
+  int restarts = 0;  // 累计自动重启次数
+  int last_exit_code = 0;
+  int64_t ready_latency_us = 0;  // 最近一次从启动到就绪的耗时
+  std::string last_error;
+};
+
+// 在后台线程中运行并看护一个子进程（v2ray）。
+//
+// 子进程的 stdout/stderr 按行交给 output 回调（在看护线程中调用）。
+// 就绪由输出事件驱动：看到 ready_marker 后立即确认入站端口可连接，
+// 而不是固定等待几秒再轮询。子进程意外退出或启动超时时按指数退避
+// 重启；停止时先请求退出，超过 stop_grace_ms 再强制结束，并且总会
+// 回收子进程。
+class ProcessSupervisor {
+ public:
+  using OutputHandler =
+      std::function<void(std::string_view line, bool from_stderr)>;
+
+  ProcessSupervisor(SupervisorOptions options, OutputHandler output);
+  ~ProcessSupervisor();
+
+  ProcessSupervisor(const ProcessSupervisor&) = delete;
+  ProcessSupervisor& operator=(const ProcessSupervisor&) = delete;
+
+  // 启动看护线程，已在运行时返回 false
+  bool Start();
+  // 请求停止但不等待；状态变为 kStopped 时子进程已被回收
+  void RequestStop();
+  // 停止并等待看护线程退出，可重复调用
+  void Stop();
+
+  // 等待进入 kReady，返回是否就绪；kFailed、kStopped 或超时返回 false
+  bool WaitReady(int timeout_ms);
+  // 等待看护线程结束（kStopped 或 kFailed）
+  bool WaitStopped(int timeout_ms);
+
+  SupervisorStatus status() const;
+
+ private:
+  // 一次子进程运行的结果
+  struct RunResult {
+    bool became_ready = false;
+    int64_t ran_us = 0;
+  };
+
+  void Run();
+  RunResult Supervise();
+  bool PortsReady() const;
+  void SetState(SupervisorState state);
+  bool stopping() const;
+
+  const SupervisorOptions options_;
+  OutputHandler output_;
+  ChildProcess child_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  bool stopping_ = false;
+  bool running_ = false;  // 看护线程是否在运行
+  SupervisorStatus status_;
+  std::thread worker_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_PROCESS_SUPERVISOR_H_
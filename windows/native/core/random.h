@@ -0,0 +1,77 @@
+#ifndef NATIVE_CORE_RANDOM_H_
+#define NATIVE_CORE_RANDOM_H_
+
+#include <cstdint>
+
+namespace cfvpn {
+
+// xoshiro256** 伪随机数发生器。速度快、可由种子复现，用于采样与打乱顺序，
+// 不用于任何安全相关的场景。
+class Random {
+ public:
+  explicit Random(uint64_t seed) { Seed(seed); }
+
+  void Seed(uint64_t seed) {
+    // 用 splitmix64 展开种子，避免全零状态
+    for (uint64_t& word : state_) {
+      seed += 0x9E3779B97F4A7C15ull;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t Next() {
+    const uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+    const uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotl(state_[3], 45);
+    return result;
+  }
+
+  // [0, bound) 内的均匀随机数（Lemire 乘法取舍法，无取模偏差）
+  uint64_t Uniform(uint64_t bound) {
+    if (bound <= 1) {
+      return 0;
+    }
+    if (bound <= 0xFFFFFFFFull) {
+      uint64_t m = (Next() >> 32) * bound;
+      uint32_t low = static_cast<uint32_t>(m);
+      if (low < bound) {
+        const uint32_t threshold =
+            static_cast<uint32_t>((0x100000000ull - bound) % bound);
+        while (low < threshold) {
+          m = (Next() >> 32) * bound;
+          low = static_cast<uint32_t>(m);
+        }
+      }
+      return m >> 32;
+    }
+    // 超过 32 位的范围较少见，使用拒绝采样
+    const uint64_t limit = UINT64_MAX - UINT64_MAX % bound;
+    uint64_t value;
+    do {
+      value = Next();
+    } while (value >= limit);
+    return value % bound;
+  }
+
+  // [0, 1) 内的双精度随机数
+  double NextDouble() {
+    return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+ private:
+  static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  uint64_t state_[4];
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_RANDOM_H_
@@ -0,0 +1,329 @@
+#include "core/range_bandit.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cfvpn {
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+
+bool IsEdgeHost(uint32_t ip) {
+  const uint32_t octet = ip & 0xFF;
+  return octet == 0 || octet == 255;
+}
+
+// 区间内不是 .0/.255 的地址数
+uint64_t HostCount(const Ipv4Range& range) {
+  uint64_t count = 0;
+  for (uint32_t block = range.first >> 8; block <= (range.last >> 8);
+       ++block) {
+    const uint64_t base = uint64_t{block} << 8;
+    const uint64_t low = std::max<uint64_t>(base, range.first);
+    const uint64_t high = std::min<uint64_t>(base + 255, range.last);
+    count += high - low + 1;
+    if (low == base) --count;
+    if (high == base + 255) --count;
+    if (block == 0xFFFFFFu) break;
+  }
+  return count;
+}
+
+}  // namespace
+
+RangeBandit::RangeBandit(const std::vector<Ipv4Range>& ranges,
+                         const RangeBanditOptions& options, uint64_t seed)
+    : options_(options), rng_(seed) {
+  options_.arm_prefix = std::min(32, std::max(8, options_.arm_prefix));
+  options_.prior_weight = std::max(0.0f, options_.prior_weight);
+  options_.max_prior = std::max(0.0f, options_.max_prior);
+
+  const Ipv4RangeIndex index(ranges);
+  const uint64_t arm_size = uint64_t{1} << (32 - options_.arm_prefix);
+  for (const Ipv4Range& interval : index.intervals()) {
+    uint64_t first = interval.first;
+    while (first <= interval.last) {
+      const uint64_t last =
+          std::min<uint64_t>(interval.last, first | (arm_size - 1));
+      Arm arm;
+      arm.range = {static_cast<uint32_t>(first), static_cast<uint32_t>(last)};
+      arm.capacity = HostCount(arm.range);
+      if (arm.capacity > 0) arms_.push_back(arm);
+      first = last + 1;
+    }
+  }
+}
+
+int RangeBandit::ArmOf(uint32_t ip) const {
+  auto it = std::upper_bound(
+      arms_.begin(), arms_.end(), ip,
+      [](uint32_t value, const Arm& arm) { return value < arm.range.first; });
+  if (it == arms_.begin()) return -1;
+  --it;
+  if (ip > it->range.last) return -1;
+  return static_cast<int>(it - arms_.begin());
+}
+
+void RangeBandit::AddPrior(uint32_t ip, bool good) {
+  const int arm = ArmOf(ip);
+  if (arm < 0) return;
+  if (good) {
+    arms_[arm].prior_good += 1;
+  } else {
+    arms_[arm].prior_bad += 1;
+  }
+}
+
+void RangeBandit::Posterior(const Arm& arm, double* alpha,
+                            double* beta) const {
+  const double raw = arm.prior_good + arm.prior_bad;
+  double scale = options_.prior_weight;
+  if (raw * scale > options_.max_prior) scale = options_.max_prior / raw;
+  *alpha = 1.0 + arm.prior_good * scale + arm.good;
+  *beta = 1.0 + arm.prior_bad * scale + arm.bad;
+}
+
+double RangeBandit::Mean(size_t arm) const {
+  double alpha, beta;
+  Posterior(arms_[arm], &alpha, &beta);
+  return alpha / (alpha + beta);
+}
+
+double RangeBandit::SampleNormal() {
+  // Box-Muller，u1 取 (0, 1] 避免 log(0)
+  const double u1 = 1.0 - rng_.NextDouble();
+  const double u2 = rng_.NextDouble();
+  return std::sqrt(-2.0 * std::log(u1)) * std::cos(kTwoPi * u2);
+}
+
+double RangeBandit::SampleGamma(double shape) {
+  if (shape < 1.0) {
+    // Gamma(a) = Gamma(a + 1) * U^(1/a)
+    const double u = 1.0 - rng_.NextDouble();
+    return SampleGamma(shape + 1.0) * std::pow(u, 1.0 / shape);
+  }
+  // Marsaglia-Tsang
+  const double d = shape - 1.0 / 3.0;
+  const double c = 1.0 / std::sqrt(9.0 * d);
+  for (;;) {
+    const double x = SampleNormal();
+    double v = 1.0 + c * x;
+    if (v <= 0) continue;
+    v = v * v * v;
+    const double u = 1.0 - rng_.NextDouble();
+    if (u < 1.0 - 0.0331 * x * x * x * x ||
+        std::log(u) < 0.5 * x * x + d * (1.0 - v + std::log(v))) {
+      return d * v;
+    }
+  }
+}
+
+double RangeBandit::SampleBeta(double alpha, double beta) {
+  const double x = SampleGamma(alpha);
+  const double y = SampleGamma(beta);
+  return x / (x + y);
+}
+
+int RangeBandit::SelectArm() {
+  int best = -1;
+  double best_value = 0;
+  const double log_total = std::log(static_cast<double>(total_pulls_) + 1.0);
+  for (size_t i = 0; i < arms_.size(); ++i) {
+    const Arm& arm = arms_[i];
+    if (arm.pulls >= arm.capacity) continue;
+    double alpha, beta;
+    Posterior(arm, &alpha, &beta);
+    double value;
+    if (options_.policy == BanditPolicy::kThompson) {
+      value = SampleBeta(alpha, beta);
+    } else {
+      // 先验折合的样本和在途的地址都算作已观测
+      const double observed = alpha + beta - 2.0 + arm.pending;
+      value = alpha / (alpha + beta) +
+              options_.ucb_exploration *
+                  std::sqrt(2.0 * log_total / (observed + 1.0));
+    }
+    if (best < 0 || value > best_value) {
+      best = static_cast<int>(i);
+      best_value = value;
+    }
+  }
+  return best;
+}
+
+uint32_t RangeBandit::PickAddress(Arm* arm) {
+  const Ipv4Range& range = arm->range;
+  const uint32_t first_block = range.first >> 8;
+  const uint64_t blocks = (range.last >> 8) - first_block + 1;
+  // 先随机挑 /24 子段和主机，臂快被取完时改为从随机位置顺序查找
+  for (int attempt = 0; attempt < 32; ++attempt) {
+    const uint32_t base =
+        (first_block + static_cast<uint32_t>(rng_.Uniform(blocks))) << 8;
+    const uint32_t low = std::max(base + 1, range.first);
+    const uint32_t high = std::min(base + 254, range.last);
+    if (low > high) continue;
+    const uint32_t ip =
+        low + static_cast<uint32_t>(rng_.Uniform(uint64_t{high} - low + 1));
+    if (used_.insert(ip).second) return ip;
+  }
+  const uint64_t size = uint64_t{range.last} - range.first + 1;
+  const uint64_t start = rng_.Uniform(size);
+  for (uint64_t k = 0; k < size; ++k) {
+    const uint32_t ip = range.first + static_cast<uint32_t>((start + k) % size);
+    if (!IsEdgeHost(ip) && used_.insert(ip).second) return ip;
+  }
+  return 0;  // pulls < capacity 时不会到这里
+}
+
+size_t RangeBandit::Next(size_t count, uint32_t* out) {
+  size_t produced = 0;
+  while (produced < count) {
+    const int index = SelectArm();
+    if (index < 0) break;
+    Arm& arm = arms_[index];
+    const uint32_t ip = PickAddress(&arm);
+    ++arm.pulls;
+    if (ip == 0) continue;
+    ++arm.pending;
+    ++total_pulls_;
+    out[produced++] = ip;
+  }
+  return produced;
+}
+
+void RangeBandit::Update(uint32_t ip, bool good) {
+  const int index = ArmOf(ip);
+  if (index < 0) return;
+  Arm& arm = arms_[index];
+  if (arm.pending > 0) --arm.pending;
+  if (good) {
+    ++arm.good;
+  } else {
+    ++arm.bad;
+  }
+}
+
+void RangeBandit::Release(uint32_t ip) {
+  const int index = ArmOf(ip);
+  if (index < 0) return;
+  Arm& arm = arms_[index];
+  if (arm.pending > 0) --arm.pending;
+}
+
+BanditProber::BanditProber(const std::vector<Ipv4Range>& ranges,
+                           const TcpingOptions& tcping,
+                           const RangeBanditOptions& bandit, uint64_t seed)
+    : tcping_(tcping),
+      bandit_(ranges, bandit, seed),
+      batch_(static_cast<size_t>(std::max(1, bandit.batch))),
+      cancelled_(false),
+      completed_(0),
+      stop_reason_(StopReason::kCompleted) {
+  tcping_.failure_window = 0;
+}
+
+bool BanditProber::IsGood(const ProbeResult& result) const {
+  return result.received > 0 && result.latency_ms < tcping_.good_latency_ms &&
+         result.loss_rate < tcping_.good_loss_rate;
+}
+
+void BanditProber::AddHistory(const NodeQuality* nodes, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const NodeQuality& node = nodes[i];
+    const bool good = node.failure_streak == 0 &&
+                      node.latency_ms < tcping_.good_latency_ms &&
+                      node.loss_rate < tcping_.good_loss_rate;
+    bandit_.AddPrior(node.ip, good);
+  }
+}
+
+void BanditProber::Cancel() {
+  cancelled_.store(true, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (engine_) engine_->Cancel();
+}
+
+size_t BanditProber::completed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return completed_.load(std::memory_order_relaxed) +
+         (engine_ ? engine_->completed() : 0);
+}
+
+int BanditProber::inflight_limit() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return engine_ ? engine_->inflight_limit() : 0;
+}
+
+bool BanditProber::Run(uint16_t port, size_t budget,
+                       std::vector<ProbeResult>* results,
+                       const TcpingEngine::CompletionCallback& on_complete) {
+  results->clear();
+  completed_.store(0, std::memory_order_relaxed);
+  stop_reason_.store(StopReason::kCompleted, std::memory_order_relaxed);
+  const size_t wanted =
+      static_cast<size_t>(std::max(0, tcping_.stop_after_good));
+  size_t good = 0;
+  StopReason stop = StopReason::kCompleted;
+  std::vector<uint32_t> ips(batch_);
+  std::vector<ProbeTarget> targets;
+  std::vector<ProbeResult> round;
+
+  while (results->size() < budget) {
+    if (cancelled_.load(std::memory_order_relaxed)) {
+      stop = StopReason::kCancelled;
+      break;
+    }
+    const size_t count = bandit_.Next(
+        std::min(batch_, budget - results->size()), ips.data());
+    if (count == 0) break;  // 所有臂都已取完
+    targets.clear();
+    for (size_t i = 0; i < count; ++i) targets.push_back({ips[i], port});
+
+    TcpingOptions options = tcping_;
+    options.stop_after_good = wanted > 0 ? static_cast<int>(wanted - good) : 0;
+    TcpingEngine* engine;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      engine_ = std::make_unique<TcpingEngine>(options);
+      if (cancelled_.load(std::memory_order_relaxed)) engine_->Cancel();
+      engine = engine_.get();
+    }
+    const size_t offset = results->size();
+    const bool ok = engine->Run(
+        targets, &round, [&](size_t index, const ProbeResult& result) {
+          if (on_complete) on_complete(offset + index, result);
+        });
+    StopReason round_stop;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      completed_.fetch_add(engine->completed(), std::memory_order_relaxed);
+      round_stop = engine->stop_reason();
+      engine_.reset();
+    }
+    if (!ok) return false;
+
+    for (const ProbeResult& result : round) {
+      if (result.sent > 0) {
+        const bool is_good = IsGood(result);
+        if (is_good) ++good;
+        bandit_.Update(result.ip, is_good);
+      } else {
+        bandit_.Release(result.ip);
+      }
+      results->push_back(result);
+    }
+    if (round_stop == StopReason::kCancelled) {
+      stop = StopReason::kCancelled;
+      break;
+    }
+    if (wanted > 0 && good >= wanted) {
+      stop = StopReason::kEnoughGood;
+      break;
+    }
+  }
+  stop_reason_.store(stop, std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace cfvpn
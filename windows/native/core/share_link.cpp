@@ -0,0 +1,452 @@
+#include "core/share_link.h"
+
+#include <utility>
+
+#include "core/base64.h"
+#include "core/json.h"
+
+namespace cfvpn {
+
+namespace {
+
+constexpr uint16_t kDefaultPort = 443;  // 与 V2RayURL.port 一致
+
+struct UrlParts {
+  std::string_view userinfo;
+  std::string_view host;
+  std::string_view port;
+  std::string_view query;
+  std::string_view fragment;
+};
+
+bool StartsWith(std::string_view text, std::string_view prefix) {
+  return text.substr(0, prefix.size()) == prefix;
+}
+
+std::string_view Trim(std::string_view text) {
+  const char* const kSpace = " \t\r\n";
+  const size_t begin = text.find_first_not_of(kSpace);
+  if (begin == std::string_view::npos) return std::string_view();
+  const size_t end = text.find_last_not_of(kSpace);
+  return text.substr(begin, end - begin + 1);
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// 百分号解码；不完整的 % 序列原样保留
+std::string PercentDecode(std::string_view text, bool plus_as_space) {
+  std::string out;
+  out.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == '%' && i + 2 < text.size()) {
+      const int high = HexValue(text[i + 1]);
+      const int low = HexValue(text[i + 2]);
+      if (high >= 0 && low >= 0) {
+        out.push_back(static_cast<char>(high << 4 | low));
+        i += 2;
+        continue;
+      }
+    }
+    out.push_back(plus_as_space && c == '+' ? ' ' : c);
+  }
+  return out;
+}
+
+// 解析 scheme:// 之后的部分：[userinfo@]host[:port][/path][?query][#fragment]
+bool SplitUrl(std::string_view rest, UrlParts* parts, std::string* error) {
+  size_t hash = rest.find('#');
+  if (hash != std::string_view::npos) {
+    parts->fragment = rest.substr(hash + 1);
+    rest = rest.substr(0, hash);
+  }
+  const size_t question = rest.find('?');
+  if (question != std::string_view::npos) {
+    parts->query = rest.substr(question + 1);
+    rest = rest.substr(0, question);
+  }
+  std::string_view authority = rest.substr(0, rest.find('/'));
+  const size_t at = authority.rfind('@');
+  if (at != std::string_view::npos) {
+    parts->userinfo = authority.substr(0, at);
+    authority = authority.substr(at + 1);
+  }
+  if (!authority.empty() && authority[0] == '[') {
+    const size_t close = authority.find(']');
+    if (close == std::string_view::npos) {
+      *error = "IPv6 地址缺少 ']'";
+      return false;
+    }
+    parts->host = authority.substr(1, close - 1);
+    authority = authority.substr(close + 1);
+    if (!authority.empty()) {
+      if (authority[0] != ':') {
+        *error = "地址格式无效";
+        return false;
+      }
+      parts->port = authority.substr(1);
+    }
+  } else {
+    const size_t colon = authority.rfind(':');
+    parts->host = authority.substr(0, colon);
+    if (colon != std::string_view::npos) {
+      parts->port = authority.substr(colon + 1);
+    }
+  }
+  if (parts->host.empty()) {
+    *error = "缺少服务器地址";
+    return false;
+  }
+  return true;
+}
+
+// 空串返回默认端口
+bool ParsePort(std::string_view text, uint16_t* port, std::string* error) {
+  if (text.empty()) {
+    *port = kDefaultPort;
+    return true;
+  }
+  uint32_t value = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9' || value > 65535) {
+      *error = "端口无效: " + std::string(text);
+      return false;
+    }
+    value = value * 10 + static_cast<uint32_t>(c - '0');
+  }
+  if (value == 0 || value > 65535) {
+    *error = "端口无效: " + std::string(text);
+    return false;
+  }
+  *port = static_cast<uint16_t>(value);
+  return true;
+}
+
+class Query {
+ public:
+  explicit Query(std::string_view text) {
+    while (!text.empty()) {
+      const size_t amp = text.find('&');
+      const std::string_view pair = text.substr(0, amp);
+      text = amp == std::string_view::npos ? std::string_view()
+                                           : text.substr(amp + 1);
+      if (pair.empty()) continue;
+      const size_t eq = pair.find('=');
+      std::string key = PercentDecode(pair.substr(0, eq), true);
+      std::string value =
+          eq == std::string_view::npos
+              ? std::string()
+              : PercentDecode(pair.substr(eq + 1), true);
+      // 重复的键以最后一个为准，与 Uri.queryParameters 一致
+      bool replaced = false;
+      for (auto& entry : entries_) {
+        if (entry.first == key) {
+          entry.second = std::move(value);
+          replaced = true;
+          break;
+        }
+      }
+      if (!replaced) entries_.emplace_back(std::move(key), std::move(value));
+    }
+  }
+
+  bool empty() const { return entries_.empty(); }
+
+  const std::string* Find(std::string_view key) const {
+    for (const auto& entry : entries_) {
+      if (entry.first == key) return &entry.second;
+    }
+    return nullptr;
+  }
+
+  std::string Get(std::string_view key, std::string_view fallback = {}) const {
+    const std::string* value = Find(key);
+    return value != nullptr ? *value : std::string(fallback);
+  }
+
+ private:
+  std::vector<std::pair<std::string, std::string>> entries_;
+};
+
+std::string FirstOf(const std::string& list) {
+  return list.substr(0, list.find(','));
+}
+
+// type/security/host/path/sni 等标准参数（vless、trojan、ss）
+void ApplyTransport(const Query& query, std::string_view default_security,
+                    ShareLink* out) {
+  out->network = query.Get("type", "tcp");
+  out->security = query.Get("security", default_security);
+  out->host = query.Get("host");
+  out->path = out->network == "grpc" ? query.Get("serviceName", query.Get("path"))
+                                     : query.Get("path");
+  const std::string* sni = query.Find("sni");
+  out->sni = sni != nullptr ? *sni : FirstOf(out->host);
+}
+
+bool ParseUrlLink(std::string_view rest, LinkProtocol protocol, ShareLink* out,
+                  std::string* error) {
+  UrlParts parts;
+  if (!SplitUrl(rest, &parts, error) || !ParsePort(parts.port, &out->port, error)) {
+    return false;
+  }
+  if (parts.userinfo.empty()) {
+    *error = protocol == LinkProtocol::kVless ? "缺少 UUID" : "缺少密码";
+    return false;
+  }
+  out->address = PercentDecode(parts.host, false);
+  out->user_id = PercentDecode(parts.userinfo, false);
+  out->name = PercentDecode(parts.fragment, true);
+  const Query query(parts.query);
+  if (protocol == LinkProtocol::kVless) {
+    ApplyTransport(query, "", out);
+    out->method = query.Get("encryption", "none");
+  } else if (query.empty()) {
+    out->network = "tcp";
+    out->security = "tls";
+  } else {
+    ApplyTransport(query, "tls", out);
+  }
+  return true;
+}
+
+// vmess 的字段可能是字符串也可能是数字
+std::string FieldText(const JsonValue& object, std::string_view key) {
+  const JsonValue* value = object.Find(key);
+  if (value == nullptr) return std::string();
+  if (value->is_string() || value->is_number()) return value->text;
+  return std::string();
+}
+
+bool ParseVmess(std::string_view rest, ShareLink* out, std::string* error) {
+  std::string decoded;
+  if (!Base64Decode(rest, &decoded)) {
+    *error = "vmess 内容不是有效的 base64";
+    return false;
+  }
+  JsonValue config;
+  std::string json_error;
+  if (!ParseJson(decoded, &config, &json_error) || !config.is_object()) {
+    *error = "vmess 内容不是有效的 JSON " + json_error;
+    return false;
+  }
+  out->address = FieldText(config, "add");
+  if (out->address.empty()) {
+    *error = "缺少服务器地址";
+    return false;
+  }
+  // 端口无效时与 VmessURL 一样使用默认端口
+  std::string ignored;
+  if (!ParsePort(FieldText(config, "port"), &out->port, &ignored)) {
+    out->port = kDefaultPort;
+  }
+  out->user_id = FieldText(config, "id");
+  if (out->user_id.empty()) {
+    *error = "缺少 UUID";
+    return false;
+  }
+  out->name = FieldText(config, "ps");
+  out->method = FieldText(config, "scy");
+  if (out->method.empty()) out->method = "auto";
+  out->network = FieldText(config, "net");
+  if (out->network.empty()) out->network = "tcp";
+  out->security = FieldText(config, "tls");
+  out->host = FieldText(config, "host");
+  out->path = FieldText(config, "path");
+  out->sni = FieldText(config, "sni");
+  if (out->sni.empty()) out->sni = FirstOf(out->host);
+  return true;
+}
+
+// v2ray-plugin;mode=websocket;host=...;path=...;tls
+void ApplyPlugin(std::string_view plugin, ShareLink* out) {
+  if (!StartsWith(plugin, "v2ray-plugin")) return;
+  std::string mode;
+  out->network = "tcp";
+  out->security.clear();
+  while (!plugin.empty()) {
+    const size_t semicolon = plugin.find(';');
+    const std::string_view part = Trim(plugin.substr(0, semicolon));
+    plugin = semicolon == std::string_view::npos ? std::string_view()
+                                                 : plugin.substr(semicolon + 1);
+    const size_t eq = part.find('=');
+    if (eq == std::string_view::npos) {
+      if (part == "tls") out->security = "tls";
+      if (part == "quic") out->network = "quic";
+      continue;
+    }
+    const std::string_view key = Trim(part.substr(0, eq));
+    const std::string value(Trim(part.substr(eq + 1)));
+    if (key == "host") {
+      out->host = value;
+    } else if (key == "path") {
+      out->path = value;
+    } else if (key == "mode") {
+      mode = value;
+    }
+  }
+  if (mode == "websocket" || mode == "ws") {
+    out->network = "ws";
+  } else if (mode == "quic") {
+    out->network = "quic";
+  } else if (mode == "http" || mode == "h2" || mode == "http2") {
+    out->network = "h2";
+  } else if (mode == "grpc") {
+    out->network = "grpc";
+  } else if (mode.empty() && !out->path.empty()) {
+    out->network = "ws";
+  }
+  out->sni = FirstOf(out->host);
+}
+
+bool SplitMethodPassword(std::string_view text, ShareLink* out,
+                         std::string* error) {
+  const size_t colon = text.find(':');
+  if (colon == std::string_view::npos || colon == 0) {
+    *error = "用户信息应为 method:password";
+    return false;
+  }
+  out->method = std::string(text.substr(0, colon));
+  out->user_id = std::string(text.substr(colon + 1));
+  return true;
+}
+
+bool ParseShadowsocks(std::string_view rest, ShareLink* out,
+                      std::string* error) {
+  const size_t hash = rest.find('#');
+  out->name = hash == std::string_view::npos
+                  ? std::string()
+                  : PercentDecode(rest.substr(hash + 1), true);
+  const std::string_view body = rest.substr(0, hash);
+  std::string decoded;
+
+  if (body.find('@') == std::string_view::npos) {
+    // 旧格式：ss://base64(method:password@host:port)#name
+    const std::string_view encoded = body.substr(0, body.find_first_of("/?"));
+    if (!Base64Decode(encoded, &decoded)) {
+      *error = "ss 内容不是有效的 base64";
+      return false;
+    }
+    const size_t at = decoded.rfind('@');
+    if (at == std::string::npos) {
+      *error = "ss 内容缺少服务器地址";
+      return false;
+    }
+    UrlParts parts;
+    const std::string_view server = std::string_view(decoded).substr(at + 1);
+    if (!SplitUrl(server, &parts, error) ||
+        !ParsePort(parts.port, &out->port, error) ||
+        !SplitMethodPassword(std::string_view(decoded).substr(0, at), out,
+                             error)) {
+      return false;
+    }
+    out->address = std::string(parts.host);
+    out->network = "tcp";
+    return true;
+  }
+
+  // SIP002：ss://userinfo@host:port[/][?plugin=...]#name，
+  // userinfo 为 base64(method:password) 或百分号编码的明文
+  UrlParts parts;
+  if (!SplitUrl(body, &parts, error) || !ParsePort(parts.port, &out->port, error)) {
+    return false;
+  }
+  out->address = PercentDecode(parts.host, false);
+  const std::string userinfo = PercentDecode(parts.userinfo, false);
+  if (userinfo.find(':') == std::string::npos) {
+    if (!Base64Decode(userinfo, &decoded)) {
+      *error = "ss 用户信息不是有效的 base64";
+      return false;
+    }
+  } else {
+    decoded = userinfo;
+  }
+  if (!SplitMethodPassword(decoded, out, error)) return false;
+
+  const Query query(parts.query);
+  if (const std::string* plugin = query.Find("plugin")) {
+    ApplyPlugin(*plugin, out);
+  } else if (!query.empty()) {
+    ApplyTransport(query, "", out);
+  } else {
+    out->network = "tcp";
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ParseShareLink(std::string_view link, ShareLink* out,
+                    std::string* error) {
+  *out = ShareLink();
+  link = Trim(link);
+  const size_t separator = link.find("://");
+  if (separator == std::string_view::npos) {
+    *error = "不是分享链接";
+    return false;
+  }
+  std::string scheme(link.substr(0, separator));
+  for (char& c : scheme) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+  }
+  const std::string_view rest = link.substr(separator + 3);
+  if (scheme == "vmess") {
+    out->protocol = LinkProtocol::kVmess;
+    return ParseVmess(rest, out, error);
+  }
+  if (scheme == "vless") {
+    out->protocol = LinkProtocol::kVless;
+    return ParseUrlLink(rest, LinkProtocol::kVless, out, error);
+  }
+  if (scheme == "trojan") {
+    out->protocol = LinkProtocol::kTrojan;
+    return ParseUrlLink(rest, LinkProtocol::kTrojan, out, error);
+  }
+  if (scheme == "ss") {
+    out->protocol = LinkProtocol::kShadowsocks;
+    return ParseShadowsocks(rest, out, error);
+  }
+  *error = "不支持的协议: " + scheme;
+  return false;
+}
+
+int ParseSubscription(std::string_view data, std::vector<ShareLink>* links,
+                      std::vector<LinkError>* errors) {
+  if (StartsWith(data, "\xEF\xBB\xBF")) data.remove_prefix(3);
+  std::string decoded;
+  if (data.find("://") == std::string_view::npos && LooksLikeBase64(data)) {
+    if (!Base64Decode(data, &decoded)) {
+      errors->push_back(LinkError{0, "订阅内容不是有效的 base64"});
+      return 0;
+    }
+    data = decoded;
+  }
+
+  int processed = 0;
+  int line_number = 0;
+  ShareLink link;
+  std::string error;
+  while (!data.empty()) {
+    ++line_number;
+    const size_t newline = data.find('\n');
+    const std::string_view line = Trim(data.substr(0, newline));
+    data = newline == std::string_view::npos ? std::string_view()
+                                             : data.substr(newline + 1);
+    if (line.empty()) continue;
+    ++processed;
+    if (ParseShareLink(line, &link, &error)) {
+      link.line = line_number;
+      links->push_back(std::move(link));
+    } else {
+      errors->push_back(LinkError{line_number, std::move(error)});
+    }
+  }
+  return processed;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,52 @@
+#ifndef NATIVE_CORE_SHARE_LINK_H_
+#define NATIVE_CORE_SHARE_LINK_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cfvpn {
+
+// 与 native_api.h 中的 CFVPN_LINK_* 一致
+enum class LinkProtocol : uint8_t {
+  kVmess = 1,
+  kVless = 2,
+  kTrojan = 3,
+  kShadowsocks = 4,
+};
+
+// 一条分享链接解析后的扁平记录，字段对应 lib/url 中各 URL 类的
+// address/port/remark 以及生成出站配置所需的参数
+struct ShareLink {
+  LinkProtocol protocol = LinkProtocol::kVmess;
+  uint16_t port = 443;
+  int line = 0;          // 在订阅中的行号（从 1 开始）
+  std::string name;      // 备注（vmess 的 ps，其他协议的 #fragment）
+  std::string address;   // 主机名或 IP（IPv6 不带方括号）
+  std::string user_id;   // vmess/vless 的 UUID，trojan/ss 的密码
+  std::string method;    // ss 的加密方式，vmess 的 scy
+  std::string network;   // tcp、ws、grpc、h2 ...
+  std::string security;  // tls、reality 或空
+  std::string host;      // ws/h2 的 Host
+  std::string path;      // ws/h2 路径，grpc 的 serviceName
+  std::string sni;
+};
+
+struct LinkError {
+  int line = 0;
+  std::string message;
+};
+
+// 解析单条分享链接（vmess://、vless://、trojan://、ss://）。
+// 失败时返回 false，error 给出原因。
+bool ParseShareLink(std::string_view link, ShareLink* out, std::string* error);
+
+// 解析整份订阅：内容整体是 base64 时先解码，然后按行解析，跳过空行。
+// 成功的链接追加到 links，失败的行追加到 errors；返回处理的非空行数。
+int ParseSubscription(std::string_view data, std::vector<ShareLink>* links,
+                      std::vector<LinkError>* errors);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_SHARE_LINK_H_
@@ -0,0 +1,177 @@
+#include "core/socket_util.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <mutex>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace cfvpn {
+
+bool InitSocketLibrary() {
+#if defined(_WIN32)
+  static std::once_flag once;
+  static bool initialized = false;
+  std::call_once(once, []() {
+    WSADATA data;
+    initialized = (::WSAStartup(MAKEWORD(2, 2), &data) == 0);
+  });
+  return initialized;
+#else
+  return true;
+#endif
+}
+
+int LastSocketError() {
+#if defined(_WIN32)
+  return ::WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+bool SetNonBlocking(NativeSocket socket) {
+#if defined(_WIN32)
+  u_long mode = 1;
+  return ::ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+  int flags = ::fcntl(socket, F_GETFL, 0);
+  if (flags < 0) {
+    return false;
+  }
+  return ::fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+void CloseSocket(NativeSocket socket, bool abortive) {
+  if (socket == kInvalidSocket) {
+    return;
+  }
+  if (abortive) {
+    linger option;
+    option.l_onoff = 1;
+    option.l_linger = 0;
+    ::setsockopt(socket, SOL_SOCKET, SO_LINGER,
+                 reinterpret_cast<const char*>(&option), sizeof(option));
+  }
+#if defined(_WIN32)
+  ::closesocket(socket);
+#else
+  ::close(socket);
+#endif
+}
+
+bool IsLocalResourceError(int error) {
+#if defined(_WIN32)
+  return error == WSAEADDRNOTAVAIL || error == WSAENOBUFS ||
+         error == WSAEMFILE || error == WSAEADDRINUSE;
+#else
+  return error == EADDRNOTAVAIL || error == ENOBUFS || error == EMFILE ||
+         error == ENFILE || error == EADDRINUSE || error == ENOMEM;
+#endif
+}
+
+bool IsInProgressError(int error) {
+#if defined(_WIN32)
+  return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS ||
+         error == WSA_IO_PENDING;
+#else
+  return error == EINPROGRESS || error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+int PollSocket(NativeSocket socket, bool for_write, int timeout_ms) {
+#if defined(_WIN32)
+  WSAPOLLFD entry;
+  entry.fd = socket;
+  entry.events = for_write ? POLLWRNORM : POLLRDNORM;
+  entry.revents = 0;
+  int ready = ::WSAPoll(&entry, 1, timeout_ms);
+#else
+  pollfd entry;
+  entry.fd = socket;
+  entry.events = for_write ? POLLOUT : POLLIN;
+  entry.revents = 0;
+  int ready;
+  do {
+    ready = ::poll(&entry, 1, timeout_ms);
+  } while (ready < 0 && errno == EINTR);
+#endif
+  if (ready < 0) {
+    return -1;
+  }
+  // 出错或对端关闭时同样视为就绪，由随后的读写返回具体错误
+  return ready > 0 ? 1 : 0;
+}
+
+std::string SocketErrorString(int error) {
+#if defined(_WIN32)
+  char buffer[256] = {0};
+  DWORD length = ::FormatMessageA(
+      FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr,
+      static_cast<DWORD>(error), 0, buffer, sizeof(buffer), nullptr);
+  while (length > 0 && (buffer[length - 1] == '\r' || buffer[length - 1] == '\n')) {
+    buffer[--length] = '\0';
+  }
+  return std::string(buffer, length);
+#else
+  return std::strerror(error);
+#endif
+}
+
+bool ParseIpv4(const char* text, uint32_t* out) {
+  uint32_t value = 0;
+  int parts = 0;
+  const char* p = text;
+  while (parts < 4) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    uint32_t part = 0;
+    int digits = 0;
+    while (*p >= '0' && *p <= '9') {
+      part = part * 10 + static_cast<uint32_t>(*p - '0');
+      if (++digits > 3 || part > 255) {
+        return false;
+      }
+      ++p;
+    }
+    value = (value << 8) | part;
+    ++parts;
+    if (parts < 4) {
+      if (*p != '.') {
+        return false;
+      }
+      ++p;
+    }
+  }
+  if (*p != '\0') {
+    return false;
+  }
+  *out = value;
+  return true;
+}
+
+std::string FormatIpv4(uint32_t ip) {
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (ip >> 24) & 0xFF,
+                (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
+  return buffer;
+}
+
+sockaddr_in MakeSockaddrV4(uint32_t ip, uint16_t port) {
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(ip);
+  return address;
+}
+
+}  // namespace cfvpn
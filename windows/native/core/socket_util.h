@@ -0,0 +1,75 @@
+#ifndef NATIVE_CORE_SOCKET_UTIL_H_
+#define NATIVE_CORE_SOCKET_UTIL_H_
+
+// 跨平台套接字辅助函数。Windows 下包含 winsock2，因此本头文件只应被
+// 原生核心内部和测试使用，不要在 runner 的 UI 代码中直接包含。
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace cfvpn {
+
+#if defined(_WIN32)
+using NativeSocket = SOCKET;
+constexpr NativeSocket kInvalidSocket = INVALID_SOCKET;
+#else
+using NativeSocket = int;
+constexpr NativeSocket kInvalidSocket = -1;
+#endif
+
+// 初始化平台套接字库（Windows 上的 WSAStartup），可重复调用
+bool InitSocketLibrary();
+
+// 最近一次套接字调用的错误码（errno 或 WSAGetLastError）
+int LastSocketError();
+
+// 设置非阻塞模式
+bool SetNonBlocking(NativeSocket socket);
+
+// 关闭套接字。abortive 为 true 时设置 SO_LINGER=0，直接发送 RST，
+// 避免大量探测连接在本机堆积 TIME_WAIT 占用临时端口
+void CloseSocket(NativeSocket socket, bool abortive = false);
+
+// 是否是本机资源不足导致的错误（端口耗尽、缓冲区不足、文件句柄耗尽等），
+// 这类错误与目标节点无关，不应计入丢包
+bool IsLocalResourceError(int error);
+
+// 是否为“操作进行中”类错误（EINPROGRESS / WSAEWOULDBLOCK）
+bool IsInProgressError(int error);
+
+// 等待套接字可读（for_write 为 false）或可写，返回 1 就绪、0 超时、-1 出错
+int PollSocket(NativeSocket socket, bool for_write, int timeout_ms);
+
+// 错误码的可读描述
+std::string SocketErrorString(int error);
+
+// 点分十进制 IPv4 与主机字节序 uint32 互相转换
+bool ParseIpv4(const char* text, uint32_t* out);
+std::string FormatIpv4(uint32_t ip);
+
+// 构造 IPv4 地址结构（ip 为主机字节序）
+sockaddr_in MakeSockaddrV4(uint32_t ip, uint16_t port);
+
+// 单调时钟，单位微秒
+inline int64_t MonotonicMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_SOCKET_UTIL_H_
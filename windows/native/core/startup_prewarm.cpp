@@ -0,0 +1,118 @@
+#include "core/startup_prewarm.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "core/socket_util.h"
+#include "core/trace_recorder.h"
+
+namespace cfvpn {
+
+namespace {
+
+constexpr size_t kPrefetchChunkBytes = 1 << 20;
+
+namespace fs = std::filesystem;
+
+PrewarmFileCheck CheckFile(const std::string& path) {
+  PrewarmFileCheck check;
+  check.path = path;
+  std::error_code error;
+  const fs::path file = fs::u8path(path);
+  if (!fs::is_regular_file(file, error)) return check;
+  const uintmax_t size = fs::file_size(file, error);
+  if (error) return check;
+  check.size = static_cast<int64_t>(size);
+  check.found = size > 0;
+  return check;
+}
+
+// 本平台可执行文件的文件头：PE 为 "MZ"，Linux 为 ELF（测试中的替身进程）
+bool HasExecutableHeader(const std::string& path) {
+  std::ifstream file(fs::u8path(path), std::ios::binary);
+  char magic[4] = {};
+  file.read(magic, sizeof(magic));
+  if (file.gcount() < 2) return false;
+#ifdef _WIN32
+  return magic[0] == 'M' && magic[1] == 'Z';
+#else
+  return (file.gcount() == 4 && std::memcmp(magic, "\x7f" "ELF", 4) == 0) ||
+         (magic[0] == '#' && magic[1] == '!');
+#endif
+}
+
+// 顺序读完整个文件，返回读到的字节数
+int64_t Prefetch(const std::string& path, std::vector<char>* buffer) {
+  std::ifstream file(fs::u8path(path), std::ios::binary);
+  int64_t total = 0;
+  while (file) {
+    file.read(buffer->data(), static_cast<std::streamsize>(buffer->size()));
+    total += file.gcount();
+  }
+  return total;
+}
+
+}  // namespace
+
+void RunStartupPrewarm(const PrewarmOptions& options, NodeCache* node_cache,
+                       V2rayConfigBuilder* config_builder,
+                       PrewarmReport* report) {
+  *report = PrewarmReport();
+  const int64_t started_us = MonotonicMicros();
+
+  if (!options.node_cache_path.empty() && node_cache != nullptr) {
+    CFVPN_TRACE_SCOPE("Prewarm: node cache", "prewarm");
+    const int64_t step_us = MonotonicMicros();
+    report->node_cache_opened =
+        node_cache->Open(options.node_cache_path, options.node_cache);
+    if (report->node_cache_opened) {
+      report->node_cache_size = static_cast<int>(node_cache->size());
+    }
+    report->node_cache_us = MonotonicMicros() - step_us;
+  }
+
+  if (!options.config_template_path.empty() && config_builder != nullptr) {
+    CFVPN_TRACE_SCOPE("Prewarm: config template", "prewarm");
+    const int64_t step_us = MonotonicMicros();
+    std::ifstream file(fs::u8path(options.config_template_path),
+                       std::ios::binary);
+    if (!file) {
+      report->template_error = "无法读取配置模板: " + options.config_template_path;
+    } else {
+      std::stringstream content;
+      content << file.rdbuf();
+      report->template_loaded =
+          config_builder->LoadTemplate(content.str(), &report->template_error);
+    }
+    report->template_us = MonotonicMicros() - step_us;
+  }
+
+  {
+    CFVPN_TRACE_SCOPE("Prewarm: v2ray files", "prewarm");
+    const int64_t step_us = MonotonicMicros();
+    std::vector<char> buffer;
+    if (options.prefetch_files) buffer.resize(kPrefetchChunkBytes);
+    auto verify = [&](const std::string& path) {
+      PrewarmFileCheck check = CheckFile(path);
+      if (check.found && options.prefetch_files) {
+        report->prefetched_bytes += Prefetch(path, &buffer);
+      }
+      return check;
+    };
+    if (!options.v2ray_path.empty()) {
+      report->v2ray = verify(options.v2ray_path);
+      report->v2ray_executable =
+          report->v2ray.found && HasExecutableHeader(options.v2ray_path);
+    }
+    for (const std::string& path : options.geo_files) {
+      report->geo_files.push_back(verify(path));
+    }
+    report->files_us = MonotonicMicros() - step_us;
+  }
+
+  report->total_us = MonotonicMicros() - started_us;
+}
+
+}  // namespace cfvpn
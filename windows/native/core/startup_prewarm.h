@@ -0,0 +1,58 @@
+#ifndef NATIVE_CORE_STARTUP_PREWARM_H_
+#define NATIVE_CORE_STARTUP_PREWARM_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/node_cache.h"
+#include "core/v2ray_config.h"
+
+namespace cfvpn {
+
+struct PrewarmOptions {
+  std::string node_cache_path;  // 为空时跳过
+  NodeCacheOptions node_cache;
+  std::string config_template_path;  // Flutter 资源目录中的模板，为空时跳过
+  std::string v2ray_path;            // 为空时跳过
+  std::vector<std::string> geo_files;  // geoip.dat / geosite.dat
+  // 顺序读一遍 v2ray 和 geo 文件，让首次连接时启动 v2ray 命中页缓存
+  bool prefetch_files = true;
+};
+
+struct PrewarmFileCheck {
+  std::string path;
+  bool found = false;  // 存在、是普通文件且非空
+  int64_t size = 0;
+};
+
+struct PrewarmReport {
+  bool node_cache_opened = false;
+  int node_cache_size = 0;
+  bool template_loaded = false;
+  std::string template_error;
+  PrewarmFileCheck v2ray;
+  bool v2ray_executable = false;  // 文件头是本平台的可执行格式
+  std::vector<PrewarmFileCheck> geo_files;
+  int64_t prefetched_bytes = 0;
+  // 各步骤耗时（微秒）
+  int64_t node_cache_us = 0;
+  int64_t template_us = 0;
+  int64_t files_us = 0;
+  int64_t total_us = 0;
+};
+
+// 在调用线程中依次执行启动预热：映射节点缓存、读取并预解析 v2ray
+// 配置模板、检查 v2ray 可执行文件和 geo 文件。runner 在创建 Flutter
+// 引擎之前把它放到单独的线程中运行，与引擎启动重叠；Dart 之后通过
+// FFI 直接取走打开的缓存和解析好的模板。
+//
+// node_cache 和 config_builder 由调用方提供，对应选项为空时不修改。
+// 每个步骤都会记录到全局 TraceRecorder。
+void RunStartupPrewarm(const PrewarmOptions& options, NodeCache* node_cache,
+                       V2rayConfigBuilder* config_builder,
+                       PrewarmReport* report);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_STARTUP_PREWARM_H_
@@ -0,0 +1,401 @@
+#include "core/tcping_engine.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+
+#include "core/aimd_controller.h"
+#include "core/io_reactor.h"
+#include "core/latency_histogram.h"
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+namespace {
+
+// 单次从反应器取回的事件数
+constexpr int kEventBatch = 256;
+
+// 事件循环最长等待时间，保证取消请求能被及时响应
+constexpr int kMaxWaitMs = 50;
+
+// 本机资源不足时重新发起连接前的等待时间
+constexpr int64_t kLocalErrorBackoffUs = 10 * 1000;
+
+// 单个目标的探测状态
+struct TargetState {
+  NativeSocket socket = kInvalidSocket;
+  int64_t attempt_start_us = 0;
+  uint32_t sequence = 0;  // 每次尝试递增，用于识别过期的超时项和事件
+  int32_t latency_sum_ms = 0;
+  int32_t sent = 0;
+  int32_t received = 0;
+  int32_t min_ms = 0;
+  int32_t max_ms = 0;
+  int32_t last_ms = 0;
+  int32_t jitter_sum_ms = 0;  // 相邻有效样本之差的绝对值之和
+  bool done = false;
+};
+
+// 超时与重试都是固定时长，按发起顺序入队即按到期时间有序，用 FIFO 即可
+struct Deadline {
+  int64_t at_us;
+  uint32_t index;
+  uint32_t sequence;
+};
+
+uint64_t MakeToken(uint32_t index, uint32_t sequence) {
+  return (static_cast<uint64_t>(sequence) << 32) | index;
+}
+
+int32_t ClampedPercentile(const LatencyHistogram& histogram,
+                          const TargetState& state, double percentile) {
+  return std::min(state.max_ms,
+                  std::max(state.min_ms, histogram.ValueAtPercentile(percentile)));
+}
+
+ProbeResult MakeResult(const ProbeTarget& target, const TargetState& state,
+                       const LatencyHistogram& histogram,
+                       const LatencyScoreWeights& weights) {
+  ProbeResult result;
+  result.ip = target.ip;
+  result.port = target.port;
+  result.sent = state.sent;
+  result.received = state.received;
+  result.latency_ms = state.received > 0 ? state.latency_sum_ms / state.received
+                                         : kFailedLatencyMs;
+  result.loss_rate =
+      state.sent > 0
+          ? static_cast<float>(state.sent - state.received) /
+                static_cast<float>(state.sent)
+          : 1.0f;
+  if (state.received > 0) {
+    result.p50_ms = ClampedPercentile(histogram, state, 50);
+    result.p90_ms = ClampedPercentile(histogram, state, 90);
+    result.p99_ms = ClampedPercentile(histogram, state, 99);
+  } else {
+    result.p50_ms = result.p90_ms = result.p99_ms = kFailedLatencyMs;
+  }
+  result.jitter_ms =
+      state.received > 1 ? static_cast<float>(state.jitter_sum_ms) /
+                               static_cast<float>(state.received - 1)
+                         : 0.0f;
+  result.score = LatencyScore(result, weights);
+  return result;
+}
+
+// 追加采样的条件：抖动相对平均延迟过高
+bool HighVariance(const TargetState& state, float jitter_ratio) {
+  if (state.received < 2) {
+    return false;
+  }
+  const float mean = static_cast<float>(state.latency_sum_ms) /
+                     static_cast<float>(state.received);
+  const float jitter = static_cast<float>(state.jitter_sum_ms) /
+                       static_cast<float>(state.received - 1);
+  return jitter > jitter_ratio * mean;
+}
+
+}  // namespace
+
+float LatencyScore(const ProbeResult& result,
+                   const LatencyScoreWeights& weights) {
+  const float base =
+      weights.mean * static_cast<float>(result.latency_ms) +
+      weights.p50 * static_cast<float>(result.p50_ms) +
+      weights.p90 * static_cast<float>(result.p90_ms) +
+      weights.p99 * static_cast<float>(result.p99_ms) +
+      weights.jitter * result.jitter_ms;
+  return base * (1.0f + weights.loss * result.loss_rate);
+}
+
+TcpingEngine::TcpingEngine(const TcpingOptions& options)
+    : options_(options),
+      cancelled_(false),
+      completed_(0),
+      inflight_limit_(0),
+      stop_reason_(StopReason::kCompleted) {
+  options_.attempts = std::max(1, options_.attempts);
+  options_.timeout_ms = std::max(1, options_.timeout_ms);
+  options_.interval_ms = std::max(0, options_.interval_ms);
+  options_.max_inflight = std::max(1, options_.max_inflight);
+  options_.min_inflight =
+      std::min(options_.max_inflight, std::max(1, options_.min_inflight));
+  options_.failure_window = std::max(0, options_.failure_window);
+  options_.extra_attempts = std::max(0, options_.extra_attempts);
+}
+
+void TcpingEngine::Cancel() {
+  cancelled_.store(true, std::memory_order_relaxed);
+}
+
+bool TcpingEngine::Run(const std::vector<ProbeTarget>& targets,
+                       std::vector<ProbeResult>* results,
+                       const CompletionCallback& on_complete) {
+  completed_.store(0, std::memory_order_relaxed);
+  stop_reason_.store(StopReason::kCompleted, std::memory_order_relaxed);
+  results->clear();
+  results->reserve(targets.size());
+  for (const ProbeTarget& target : targets) {
+    results->push_back(
+        MakeResult(target, TargetState(), LatencyHistogram(), options_.score));
+  }
+
+  IoReactor reactor;
+  if (!InitSocketLibrary() || !reactor.Open()) {
+    return false;
+  }
+
+  const size_t total = targets.size();
+  const int64_t timeout_us = static_cast<int64_t>(options_.timeout_ms) * 1000;
+  const int64_t interval_us = static_cast<int64_t>(options_.interval_ms) * 1000;
+  const int64_t min_valid_us =
+      static_cast<int64_t>(options_.min_valid_latency_ms) * 1000;
+
+  std::vector<TargetState> states(total);
+  // 直方图单独成组，连接状态保持紧凑
+  std::vector<LatencyHistogram> histograms(total);
+  std::deque<Deadline> timeouts;
+  std::deque<Deadline> retries;
+  // 本机资源不足时延后重新发起。延迟固定，追加到队尾即按到期时间有序；
+  // 与 retries 分开，避免退避中的目标挡住已到期的重试。
+  std::deque<Deadline> backoffs;
+  size_t next_fresh = 0;
+  size_t finished = 0;
+  int inflight = 0;
+
+  AimdOptions aimd_options;
+  aimd_options.min_window = options_.min_inflight;
+  aimd_options.max_window = options_.max_inflight;
+  aimd_options.initial_window = options_.initial_inflight;
+  AimdController aimd(aimd_options);
+  auto current_limit = [&]() {
+    return options_.adaptive_inflight ? aimd.window() : options_.max_inflight;
+  };
+  inflight_limit_.store(current_limit(), std::memory_order_relaxed);
+
+  // 提前结束的统计
+  size_t good = 0;
+  std::vector<uint8_t> recent_failures(options_.failure_window, 0);
+  size_t recent_count = 0;
+  size_t recent_failed = 0;
+  StopReason stop = StopReason::kCompleted;
+
+  auto finish = [&](uint32_t index) {
+    TargetState& state = states[index];
+    state.done = true;
+    const ProbeResult& result = (*results)[index] =
+        MakeResult(targets[index], state, histograms[index], options_.score);
+    ++finished;
+    completed_.store(finished, std::memory_order_relaxed);
+    if (on_complete) {
+      on_complete(index, result);
+    }
+
+    if (result.latency_ms < options_.good_latency_ms &&
+        result.loss_rate < options_.good_loss_rate) {
+      ++good;
+    }
+    if (!recent_failures.empty()) {
+      const uint8_t failed = result.received == 0 ? 1 : 0;
+      uint8_t& slot = recent_failures[recent_count % recent_failures.size()];
+      if (recent_count >= recent_failures.size()) {
+        recent_failed -= slot;
+      }
+      slot = failed;
+      recent_failed += failed;
+      ++recent_count;
+    }
+    if (options_.stop_after_good > 0 &&
+        good >= static_cast<size_t>(options_.stop_after_good)) {
+      stop = StopReason::kEnoughGood;
+    } else if (!recent_failures.empty() &&
+               recent_count >= recent_failures.size() &&
+               static_cast<float>(recent_failed) >=
+                   options_.failure_rate_threshold *
+                       static_cast<float>(recent_failures.size())) {
+      stop = StopReason::kTooManyFailures;
+    }
+  };
+
+  // 一次尝试结束后的统一处理：记录样本，决定重试还是结束
+  auto record = [&](uint32_t index, bool connected, int64_t latency_us,
+                    int64_t now_us) {
+    TargetState& state = states[index];
+    state.sent++;
+    // 超过超时仍然连上的情况按超时处理，与 Socket.connect 的行为一致
+    bool failed = !connected || latency_us > timeout_us;
+    if (connected && latency_us >= min_valid_us && latency_us <= timeout_us) {
+      const int32_t latency_ms = static_cast<int32_t>(latency_us / 1000);
+      if (state.received == 0) {
+        state.min_ms = state.max_ms = latency_ms;
+      } else {
+        state.min_ms = std::min(state.min_ms, latency_ms);
+        state.max_ms = std::max(state.max_ms, latency_ms);
+        state.jitter_sum_ms += std::abs(latency_ms - state.last_ms);
+      }
+      state.last_ms = latency_ms;
+      state.received++;
+      state.latency_sum_ms += latency_ms;
+      histograms[index].Record(latency_ms);
+    }
+    // 与 Dart 实现一致：连续失败（没有成功且已尝试两次）时提前结束
+    bool give_up = failed && state.received == 0 && state.sent >= 2;
+    bool enough = state.sent >= options_.attempts &&
+                  (state.sent >= options_.attempts + options_.extra_attempts ||
+                   !HighVariance(state, options_.extra_jitter_ratio));
+    if (give_up || enough) {
+      finish(index);
+    } else {
+      retries.push_back({now_us + interval_us, index, state.sequence});
+    }
+  };
+
+  IoEvent events[kEventBatch];
+  while (finished < total && stop == StopReason::kCompleted) {
+    if (cancelled_.load(std::memory_order_relaxed)) {
+      stop = StopReason::kCancelled;
+      break;
+    }
+
+    // 补充在途连接：优先处理到期的重试和退避（先到期的先发），其次是新目标
+    int64_t now_us = MonotonicMicros();
+    int limit = current_limit();
+    while (inflight < limit) {
+      const bool retry_due =
+          !retries.empty() && retries.front().at_us <= now_us;
+      const bool backoff_due =
+          !backoffs.empty() && backoffs.front().at_us <= now_us;
+      uint32_t index;
+      if (retry_due || backoff_due) {
+        const bool use_backoff =
+            backoff_due &&
+            (!retry_due || backoffs.front().at_us < retries.front().at_us);
+        std::deque<Deadline>& queue = use_backoff ? backoffs : retries;
+        index = queue.front().index;
+        queue.pop_front();
+      } else if (next_fresh < total) {
+        index = static_cast<uint32_t>(next_fresh++);
+      } else {
+        break;
+      }
+
+      TargetState& state = states[index];
+      state.sequence++;
+      sockaddr_storage address;
+      const int address_length =
+          MakeSockaddr(targets[index].address, targets[index].port, &address);
+      state.attempt_start_us = MonotonicMicros();
+      int error = reactor.StartConnect(reinterpret_cast<sockaddr*>(&address),
+                                       address_length,
+                                       MakeToken(index, state.sequence),
+                                       &state.socket);
+      if (error == 0) {
+        ++inflight;
+        timeouts.push_back(
+            {state.attempt_start_us + timeout_us, index, state.sequence});
+      } else if (IsLocalResourceError(error)) {
+        // 本机端口或缓冲区不足：不计入该目标的丢包，稍后重新发起
+        state.socket = kInvalidSocket;
+        backoffs.push_back(
+            {now_us + kLocalErrorBackoffUs, index, state.sequence});
+        aimd.OnLocalError();
+        break;
+      } else {
+        state.socket = kInvalidSocket;
+        aimd.OnFailure();
+        record(index, false, 0, now_us);
+        if (stop != StopReason::kCompleted) {
+          break;
+        }
+      }
+    }
+
+    // 计算等待时间：最近的超时或重试到期时刻
+    int64_t wake_us = now_us + kMaxWaitMs * 1000;
+    if (!timeouts.empty()) {
+      wake_us = std::min(wake_us, timeouts.front().at_us);
+    }
+    if (inflight < current_limit()) {
+      if (!retries.empty()) {
+        wake_us = std::min(wake_us, retries.front().at_us);
+      }
+      if (!backoffs.empty()) {
+        wake_us = std::min(wake_us, backoffs.front().at_us);
+      }
+    }
+    int wait_ms = static_cast<int>(
+        std::max<int64_t>(0, (wake_us - now_us + 999) / 1000));
+
+    int count = reactor.Wait(events, kEventBatch, wait_ms);
+    now_us = MonotonicMicros();
+    for (int i = 0; i < count && stop == StopReason::kCompleted; ++i) {
+      const IoEvent& event = events[i];
+      if (event.op != IoOp::kConnect) {
+        continue;
+      }
+      uint32_t index = static_cast<uint32_t>(event.token & 0xFFFFFFFFu);
+      uint32_t sequence = static_cast<uint32_t>(event.token >> 32);
+      if (index >= total) {
+        continue;
+      }
+      TargetState& state = states[index];
+      if (state.sequence != sequence || state.socket == kInvalidSocket) {
+        continue;
+      }
+      reactor.Close(state.socket, true);
+      state.socket = kInvalidSocket;
+      --inflight;
+      if (IsLocalResourceError(event.error)) {
+        // 与同步发起时相同：本机资源不足不计入丢包，退避后重新发起
+        aimd.OnLocalError();
+        backoffs.push_back(
+            {now_us + kLocalErrorBackoffUs, index, state.sequence});
+        continue;
+      }
+      if (event.error == 0) {
+        aimd.OnSuccess();
+      } else {
+        aimd.OnFailure();
+      }
+      record(index, event.error == 0, now_us - state.attempt_start_us, now_us);
+    }
+
+    // 处理超时
+    while (!timeouts.empty() && timeouts.front().at_us <= now_us &&
+           stop == StopReason::kCompleted) {
+      Deadline deadline = timeouts.front();
+      timeouts.pop_front();
+      TargetState& state = states[deadline.index];
+      if (state.sequence != deadline.sequence ||
+          state.socket == kInvalidSocket) {
+        continue;
+      }
+      reactor.Close(state.socket, true);
+      state.socket = kInvalidSocket;
+      --inflight;
+      aimd.OnTimeout();
+      record(deadline.index, false, 0, now_us);
+    }
+    inflight_limit_.store(current_limit(), std::memory_order_relaxed);
+  }
+  stop_reason_.store(stop, std::memory_order_relaxed);
+
+  // 取消或提前结束时关闭仍在途的连接，未完成的目标按当前统计输出
+  if (finished < total) {
+    for (size_t index = 0; index < total; ++index) {
+      TargetState& state = states[index];
+      if (state.socket != kInvalidSocket) {
+        reactor.Close(state.socket, true);
+        state.socket = kInvalidSocket;
+      }
+      if (!state.done) {
+        (*results)[index] = MakeResult(targets[index], state, histograms[index],
+                                       options_.score);
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,153 @@
+#ifndef NATIVE_CORE_TCPING_ENGINE_H_
+#define NATIVE_CORE_TCPING_ENGINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "core/ip_address.h"
+
+namespace cfvpn {
+
+// 全部失败时返回的延迟值，与 Dart 端保持一致
+constexpr int32_t kFailedLatencyMs = 999;
+
+// 排序得分的权重：score = mean * 平均延迟 + p50/p90/p99 * 对应百分位
+// + jitter * 抖动，再乘以 (1 + loss * 丢包率)。默认只看平均延迟，与旧的
+// 排序一致；调大 p99 和 jitter 的权重可以把尾延迟差的节点排到后面。
+struct LatencyScoreWeights {
+  float mean = 1.0f;
+  float p50 = 0.0f;
+  float p90 = 0.0f;
+  float p99 = 0.0f;
+  float jitter = 0.0f;
+  float loss = 0.0f;
+};
+
+// TCPing 参数，默认值对应 AppConfig 中的配置
+struct TcpingOptions {
+  int attempts = 3;               // AppConfig.tcpPingTimes
+  int timeout_ms = 300;           // 单次连接超时（Dart 端传入 maxLatency）
+  int min_valid_latency_ms = 30;  // AppConfig.minValidTcpLatency，过低视为假连接
+  int interval_ms = 50;           // AppConfig.tcpTestInterval
+  int max_inflight = 1024;        // 同时在途的连接数上限
+
+  // 自适应并发：开启后 max_inflight 只是上限，实际在途数由 AimdController
+  // 根据超时和本机资源错误调整
+  bool adaptive_inflight = false;
+  int min_inflight = 16;
+  int initial_inflight = 128;
+
+  // 提前结束条件，每个目标完成时检查，0 表示不启用
+  int stop_after_good = 0;       // AppConfig.earlyStopGoodNodeCount
+  int good_latency_ms = 300;     // AppConfig.goodNodeLatencyThreshold（不含）
+  float good_loss_rate = 0.1f;   // AppConfig.goodNodeLossRateThreshold（不含）
+  int failure_window = 0;        // 统计最近多少个完成的目标
+  float failure_rate_threshold = 0.9f;  // 窗口内失败比例达到该值时结束
+
+  // 自适应追加采样：attempts 次之后抖动仍超过平均延迟的
+  // extra_jitter_ratio 时继续测试，最多再测 extra_attempts 次
+  int extra_attempts = 0;
+  float extra_jitter_ratio = 0.25f;
+
+  LatencyScoreWeights score;
+};
+
+// Run() 结束的原因
+enum class StopReason : int32_t {
+  kCompleted = 0,        // 全部目标都已探测
+  kEnoughGood = 1,       // 已找到 stop_after_good 个优质节点
+  kTooManyFailures = 2,  // 最近 failure_window 个目标失败比例过高
+  kCancelled = 3,
+};
+
+// 探测目标。ip 为主机字节序的 IPv4，address 同时保存 IPv4 或 IPv6
+// 地址，连接时以 address 为准；IPv6 目标的 ip 为 0。
+struct ProbeTarget {
+  ProbeTarget() = default;
+  ProbeTarget(uint32_t ip, uint16_t port)
+      : ip(ip), port(port), address(IpAddress::V4(ip)) {}
+  ProbeTarget(const IpAddress& address, uint16_t port)
+      : ip(address.v6 ? 0 : address.v4()), port(port), address(address) {}
+
+  uint32_t ip = 0;
+  uint16_t port = 0;
+  IpAddress address;
+};
+
+// 单个 IP 的探测结果，前几个字段与 _testSingleIpLatencyWithLossRate
+// 返回的 {'ip','latency','lossRate','sent','received'} 一一对应
+struct ProbeResult {
+  uint32_t ip;
+  uint16_t port;
+  int32_t latency_ms;  // 有效样本的平均延迟，没有有效样本时为 kFailedLatencyMs
+  int32_t sent;        // 实际尝试次数
+  int32_t received;    // 有效样本数
+  float loss_rate;     // (sent - received) / sent
+  // 有效样本的延迟分布，来自 LatencyHistogram 并限制在实测的最小、最大值
+  // 之间；没有有效样本时为 kFailedLatencyMs
+  int32_t p50_ms;
+  int32_t p90_ms;
+  int32_t p99_ms;
+  float jitter_ms;     // 相邻有效样本之差的平均绝对值，少于两个样本时为 0
+  float score;         // 按 TcpingOptions::score 计算，越小越好
+};
+
+// 按权重计算排序得分，没有有效样本时为 kFailedLatencyMs 乘以丢包惩罚
+float LatencyScore(const ProbeResult& result,
+                   const LatencyScoreWeights& weights);
+
+// 高并发 TCPing 引擎。
+//
+// 单线程事件循环同时保持最多 max_inflight 个非阻塞连接，每个目标按顺序
+// 进行 attempts 次连接测试，两次之间间隔 interval_ms；与 Dart 实现一样，
+// 前两次都失败且没有任何成功时提前结束该目标。新目标一有空位就立即补上，
+// 没有批次屏障；提前结束条件在每个目标完成时检查。每个有效样本记入
+// 该目标的 LatencyHistogram，结果中给出百分位、抖动和排序得分。
+class TcpingEngine {
+ public:
+  // 单个目标完成时回调（在引擎线程中调用）
+  using CompletionCallback =
+      std::function<void(size_t index, const ProbeResult& result)>;
+
+  explicit TcpingEngine(const TcpingOptions& options);
+
+  TcpingEngine(const TcpingEngine&) = delete;
+  TcpingEngine& operator=(const TcpingEngine&) = delete;
+
+  // 阻塞执行全部探测，结果按 targets 的顺序写入 results。
+  // 返回 false 表示事件循环初始化失败。被取消或提前结束时，未探测的目标
+  // sent 为 0，探测到一半的目标按已有样本输出。
+  bool Run(const std::vector<ProbeTarget>& targets,
+           std::vector<ProbeResult>* results,
+           const CompletionCallback& on_complete = nullptr);
+
+  // 请求取消，可从任意线程调用
+  void Cancel();
+
+  // 已完成的目标数，可从任意线程读取
+  size_t completed() const { return completed_.load(std::memory_order_relaxed); }
+
+  // 当前在途连接数上限，可从任意线程读取
+  int inflight_limit() const {
+    return inflight_limit_.load(std::memory_order_relaxed);
+  }
+
+  // 最近一次 Run() 结束的原因
+  StopReason stop_reason() const {
+    return stop_reason_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  TcpingOptions options_;
+  std::atomic<bool> cancelled_;
+  std::atomic<size_t> completed_;
+  std::atomic<int> inflight_limit_;
+  std::atomic<StopReason> stop_reason_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_TCPING_ENGINE_H_
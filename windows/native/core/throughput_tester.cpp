@@ -0,0 +1,360 @@
+#include "core/throughput_tester.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#include "core/io_reactor.h"
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+namespace {
+
+constexpr int kEventBatch = 64;
+constexpr int kMaxWaitMs = 50;
+
+// 响应头必须在这个大小内读完
+constexpr uint32_t kHeaderBufferSize = 4096;
+// 每次丢弃的上限；MSG_TRUNC 不需要缓冲区，取大一些减少事件数
+constexpr uint32_t kDiscardChunk = 1 << 20;
+
+enum class Stage : uint8_t {
+  kIdle,
+  kConnecting,
+  kSending,
+  kHeaders,
+  kBody,
+  kDead,  // 失败后不再重连
+};
+
+struct ConnectionState {
+  NativeSocket socket = kInvalidSocket;
+  Stage stage = Stage::kIdle;
+  uint32_t sequence = 0;  // 每次建连时递增，识别过期的事件和超时
+  int64_t connect_start_us = 0;
+  int64_t request_start_us = 0;
+  bool first_byte = false;  // 本次连接是否已收到响应的首字节
+  bool got_body = false;    // 本次连接是否已收到响应体
+  uint32_t header_length = 0;
+  char header[kHeaderBufferSize];
+};
+
+struct Deadline {
+  int64_t at_us;
+  uint32_t index;
+  uint32_t sequence;
+};
+
+uint64_t MakeToken(uint32_t index, uint32_t sequence) {
+  return (static_cast<uint64_t>(sequence) << 32) | index;
+}
+
+// 解析 "HTTP/1.x NNN"，失败时返回 0
+int ParseStatus(const char* data, size_t length) {
+  if (length < 12 || std::memcmp(data, "HTTP/1.", 7) != 0 || data[8] != ' ') {
+    return 0;
+  }
+  int status = 0;
+  for (size_t i = 9; i < 12; ++i) {
+    if (data[i] < '0' || data[i] > '9') return 0;
+    status = status * 10 + (data[i] - '0');
+  }
+  return status;
+}
+
+// 采样窗的字节数换算为 Mbps（bit/us 即 Mbit/s）
+double ToMbps(int64_t bytes, int64_t interval_us) {
+  return interval_us > 0 ? static_cast<double>(bytes) * 8.0 /
+                               static_cast<double>(interval_us)
+                         : 0.0;
+}
+
+}  // namespace
+
+ThroughputTester::ThroughputTester(const ThroughputOptions& options)
+    : options_(options), cancelled_(false), bytes_(0) {
+  options_.connections = std::max(1, options_.connections);
+  options_.duration_ms = std::max(1, options_.duration_ms);
+  options_.connect_timeout_ms = std::max(1, options_.connect_timeout_ms);
+  options_.sample_interval_ms = std::max(1, options_.sample_interval_ms);
+}
+
+void ThroughputTester::Cancel() {
+  cancelled_.store(true, std::memory_order_relaxed);
+}
+
+bool ThroughputTester::Run(const ProbeTarget& target,
+                           ThroughputResult* result) {
+  *result = ThroughputResult();
+  bytes_.store(0, std::memory_order_relaxed);
+
+  IoReactor reactor;
+  if (!InitSocketLibrary() || !reactor.Open()) {
+    return false;
+  }
+
+  std::string host = options_.host;
+  if (host.empty()) {
+    host = FormatIpAddress(target.address);
+    if (target.address.v6) host = "[" + host + "]";
+  }
+  const std::string request =
+      "GET " + options_.path + " HTTP/1.1\r\nHost: " + host +
+      "\r\nUser-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) "
+      "AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 "
+      "Safari/537.36\r\nAccept: */*\r\nConnection: close\r\n\r\n";
+  sockaddr_storage address;
+  const int address_length =
+      MakeSockaddr(target.address, target.port, &address);
+
+  const size_t count = static_cast<size_t>(options_.connections);
+  const int64_t start_us = MonotonicMicros();
+  const int64_t end_us =
+      start_us + static_cast<int64_t>(options_.duration_ms) * 1000;
+  const int64_t timeout_us =
+      static_cast<int64_t>(options_.connect_timeout_ms) * 1000;
+  const int64_t interval_us =
+      static_cast<int64_t>(options_.sample_interval_ms) * 1000;
+
+  std::vector<ConnectionState> states(count);
+  // 采样窗从首个响应体字节起算，最多覆盖整个测试时长
+  std::vector<int64_t> bins(
+      static_cast<size_t>(options_.duration_ms / options_.sample_interval_ms) +
+      1);
+  std::deque<Deadline> timeouts;
+  int64_t first_byte_us = 0;
+  int64_t connect_sum_us = 0;
+  int32_t connect_samples = 0;
+  int64_t ttfb_sum_us = 0;
+  int32_t ttfb_samples = 0;
+  size_t alive = count;
+
+  auto account = [&](int64_t now_us, int64_t bytes) {
+    if (bytes <= 0) return;
+    if (first_byte_us == 0) first_byte_us = now_us;
+    const size_t bin = std::min(
+        bins.size() - 1, static_cast<size_t>((now_us - first_byte_us) /
+                                             interval_us));
+    bins[bin] += bytes;
+    result->bytes += bytes;
+    bytes_.store(result->bytes, std::memory_order_relaxed);
+  };
+
+  auto close_socket = [&](ConnectionState& state) {
+    if (state.socket != kInvalidSocket) {
+      reactor.Close(state.socket, true);
+      state.socket = kInvalidSocket;
+    }
+  };
+
+  auto kill = [&](uint32_t index) {
+    ConnectionState& state = states[index];
+    close_socket(state);
+    if (state.stage != Stage::kDead) {
+      state.stage = Stage::kDead;
+      result->failed++;
+      --alive;
+    }
+  };
+
+  auto connect = [&](uint32_t index, int64_t now_us) {
+    ConnectionState& state = states[index];
+    state.sequence++;
+    state.connect_start_us = now_us;
+    state.first_byte = false;
+    state.got_body = false;
+    state.header_length = 0;
+    const int error = reactor.StartConnect(
+        reinterpret_cast<const sockaddr*>(&address), address_length,
+        MakeToken(index, state.sequence), &state.socket);
+    if (error != 0) {
+      state.socket = kInvalidSocket;
+      kill(index);
+      return;
+    }
+    state.stage = Stage::kConnecting;
+    timeouts.push_back({now_us + timeout_us, index, state.sequence});
+  };
+
+  // 连接结束：已经在传输响应体时说明服务器发完了，剩余时间内重连；
+  // 否则这条连接视为失败
+  auto finish = [&](uint32_t index, int64_t now_us) {
+    ConnectionState& state = states[index];
+    close_socket(state);
+    if (state.got_body && now_us < end_us) {
+      connect(index, now_us);
+    } else if (state.got_body) {
+      state.stage = Stage::kIdle;
+    } else {
+      kill(index);
+    }
+  };
+
+  auto discard = [&](uint32_t index, int64_t now_us) {
+    ConnectionState& state = states[index];
+    if (reactor.StartDiscard(state.socket, kDiscardChunk,
+                             MakeToken(index, state.sequence)) != 0) {
+      finish(index, now_us);
+    }
+  };
+
+  // 在已收到的数据中找响应头的结尾
+  auto parse_headers = [&](uint32_t index, int64_t now_us) {
+    ConnectionState& state = states[index];
+    const char* data = state.header;
+    const size_t length = state.header_length;
+    const char* end = nullptr;
+    for (size_t i = 3; i < length; ++i) {
+      if (std::memcmp(data + i - 3, "\r\n\r\n", 4) == 0) {
+        end = data + i + 1;
+        break;
+      }
+    }
+    if (end == nullptr) {
+      if (length == kHeaderBufferSize) {
+        kill(index);
+      } else if (reactor.StartRecv(state.socket, state.header + length,
+                                   kHeaderBufferSize - static_cast<uint32_t>(
+                                                           length),
+                                   MakeToken(index, state.sequence)) != 0) {
+        kill(index);
+      }
+      return;
+    }
+    const int status = ParseStatus(data, length);
+    if (result->status == 0) result->status = static_cast<uint16_t>(status);
+    if (status < 200 || status >= 300) {
+      kill(index);
+      return;
+    }
+    result->connected++;
+    state.stage = Stage::kBody;
+    state.got_body = true;
+    account(now_us, static_cast<int64_t>(data + length - end));
+    discard(index, now_us);
+  };
+
+  for (uint32_t index = 0; index < count; ++index) {
+    connect(index, start_us);
+  }
+
+  IoEvent events[kEventBatch];
+  int64_t now_us = start_us;
+  while (alive > 0 && now_us < end_us &&
+         !cancelled_.load(std::memory_order_relaxed)) {
+    int64_t wake_us = std::min(end_us, now_us + kMaxWaitMs * 1000);
+    if (!timeouts.empty()) {
+      wake_us = std::min(wake_us, timeouts.front().at_us);
+    }
+    const int wait_ms = static_cast<int>(
+        std::max<int64_t>(0, (wake_us - now_us + 999) / 1000));
+    const int ready = reactor.Wait(events, kEventBatch, wait_ms);
+    now_us = MonotonicMicros();
+    for (int i = 0; i < ready; ++i) {
+      const IoEvent& event = events[i];
+      const uint32_t index = static_cast<uint32_t>(event.token & 0xFFFFFFFFu);
+      const uint32_t sequence = static_cast<uint32_t>(event.token >> 32);
+      if (index >= count) continue;
+      ConnectionState& state = states[index];
+      if (state.sequence != sequence || state.socket == kInvalidSocket) {
+        continue;
+      }
+      if (event.error != 0) {
+        finish(index, now_us);
+        continue;
+      }
+      if (event.op == IoOp::kConnect && state.stage == Stage::kConnecting) {
+        connect_sum_us += now_us - state.connect_start_us;
+        connect_samples++;
+        state.request_start_us = now_us;
+        if (reactor.StartSend(state.socket, request.data(),
+                              static_cast<uint32_t>(request.size()),
+                              event.token) != 0) {
+          kill(index);
+        } else {
+          state.stage = Stage::kSending;
+        }
+      } else if (event.op == IoOp::kSend && state.stage == Stage::kSending) {
+        state.stage = Stage::kHeaders;
+        if (reactor.StartRecv(state.socket, state.header, kHeaderBufferSize,
+                              event.token) != 0) {
+          kill(index);
+        }
+      } else if (event.op == IoOp::kRecv && event.bytes == 0) {
+        finish(index, now_us);
+      } else if (event.op == IoOp::kRecv && state.stage == Stage::kHeaders) {
+        if (!state.first_byte) {
+          state.first_byte = true;
+          ttfb_sum_us += now_us - state.request_start_us;
+          ttfb_samples++;
+        }
+        state.header_length += event.bytes;
+        parse_headers(index, now_us);
+      } else if (event.op == IoOp::kRecv && state.stage == Stage::kBody) {
+        account(now_us, event.bytes);
+        discard(index, now_us);
+      }
+    }
+
+    while (!timeouts.empty() && timeouts.front().at_us <= now_us) {
+      const Deadline deadline = timeouts.front();
+      timeouts.pop_front();
+      ConnectionState& state = states[deadline.index];
+      if (state.sequence == deadline.sequence &&
+          (state.stage == Stage::kConnecting ||
+           state.stage == Stage::kSending || state.stage == Stage::kHeaders)) {
+        kill(deadline.index);
+      }
+    }
+  }
+  for (ConnectionState& state : states) {
+    close_socket(state);
+  }
+
+  if (connect_samples > 0) {
+    result->connect_ms =
+        static_cast<int32_t>(connect_sum_us / connect_samples / 1000);
+  }
+  if (ttfb_samples > 0) {
+    result->ttfb_ms = static_cast<int32_t>(ttfb_sum_us / ttfb_samples / 1000);
+  }
+  if (first_byte_us == 0) {
+    return true;
+  }
+
+  // 只统计完整的采样窗，最后不满一个窗口的数据只计入总字节数
+  const int64_t elapsed_us = std::max<int64_t>(1, now_us - first_byte_us);
+  result->elapsed_ms = static_cast<int32_t>(elapsed_us / 1000);
+  const size_t complete =
+      std::min(bins.size(), static_cast<size_t>(elapsed_us / interval_us));
+  for (size_t i = 0; i < complete; ++i) {
+    const double mbps = ToMbps(bins[i], interval_us);
+    result->samples_mbps.push_back(mbps);
+    result->peak_mbps = std::max(result->peak_mbps, mbps);
+  }
+  if (complete < 2) {
+    result->sustained_mbps = ToMbps(result->bytes, elapsed_us);
+    result->peak_mbps = std::max(result->peak_mbps, result->sustained_mbps);
+    return true;
+  }
+
+  int64_t steady_bytes = 0;
+  for (size_t i = complete / 2; i < complete; ++i) steady_bytes += bins[i];
+  const double steady = ToMbps(
+      steady_bytes,
+      interval_us * static_cast<int64_t>(complete - complete / 2));
+  size_t ramp = 0;
+  while (ramp + 1 < complete && result->samples_mbps[ramp] < steady * 0.9) {
+    ++ramp;
+  }
+  result->ramp_up_ms =
+      static_cast<int32_t>(ramp) * options_.sample_interval_ms;
+  int64_t sustained_bytes = 0;
+  for (size_t i = ramp; i < complete; ++i) sustained_bytes += bins[i];
+  result->sustained_mbps = ToMbps(
+      sustained_bytes, interval_us * static_cast<int64_t>(complete - ramp));
+  return true;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,73 @@
+#ifndef NATIVE_CORE_THROUGHPUT_TESTER_H_
+#define NATIVE_CORE_THROUGHPUT_TESTER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/tcping_engine.h"
+
+namespace cfvpn {
+
+// 下载吞吐测试参数
+struct ThroughputOptions {
+  int connections = 4;          // 并行连接数
+  int duration_ms = 10000;      // 整个测试的时长上限，含建连
+  int connect_timeout_ms = 3000;  // 建连到收到响应头的超时
+  int sample_interval_ms = 100;   // 吞吐采样的时间窗
+  std::string host = "speed.cloudflare.com";  // 为空时使用目标 IP
+  std::string path = "/__down?bytes=1000000000";
+};
+
+// 一次吞吐测试的结果。耗时单位为毫秒，没有样本时为 -1。
+struct ThroughputResult {
+  int32_t connected = 0;    // 收到 2xx 响应头的连接数（含重连）
+  int32_t failed = 0;       // 建连、超时或状态码不符而失败的连接数
+  uint16_t status = 0;      // 第一个响应的状态码
+  int32_t connect_ms = -1;  // 平均建连耗时
+  int32_t ttfb_ms = -1;     // 平均从发出请求到收到首个字节的耗时
+  // 从首个响应体字节起，吞吐首次达到稳定值 90% 所用的时间
+  int32_t ramp_up_ms = -1;
+  int32_t elapsed_ms = 0;   // 从首个响应体字节到测试结束
+  int64_t bytes = 0;        // 响应体总字节数
+  double sustained_mbps = 0;  // 爬升结束后的平均吞吐
+  double peak_mbps = 0;       // 最高的单个采样窗
+  std::vector<double> samples_mbps;  // 每个完整采样窗的吞吐
+};
+
+// 多连接下载吞吐测试。
+//
+// 对一个节点并行打开 connections 条连接，各自发送同一个 GET 请求；读到
+// 响应头后改用 IoReactor::StartDiscard 接收响应体，Linux 下数据在内核中
+// 被丢弃，不复制到用户态。服务器提前结束响应时在剩余时间内重连。
+// 吞吐按 sample_interval_ms 分窗统计：后一半完整采样窗的平均值作为
+// 稳定值，第一个达到其 90% 的窗口视为爬升结束。
+class ThroughputTester {
+ public:
+  explicit ThroughputTester(const ThroughputOptions& options);
+
+  ThroughputTester(const ThroughputTester&) = delete;
+  ThroughputTester& operator=(const ThroughputTester&) = delete;
+
+  // 阻塞执行测试，在 duration_ms 后、全部连接失败时或被取消时返回。
+  // 事件循环无法创建时返回 false。
+  bool Run(const ProbeTarget& target, ThroughputResult* result);
+
+  // 请求取消，可从任意线程调用；已收到的数据仍计入结果
+  void Cancel();
+
+  bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+  // 已收到的响应体字节数，可从任意线程读取
+  int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  ThroughputOptions options_;
+  std::atomic<bool> cancelled_;
+  std::atomic<int64_t> bytes_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_THROUGHPUT_TESTER_H_
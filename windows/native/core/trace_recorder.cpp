@@ -0,0 +1,246 @@
+#include "core/trace_recorder.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "core/json.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace cfvpn {
+
+namespace {
+
+std::atomic<uint64_t> g_next_recorder_id{1};
+
+int64_t CurrentPid() {
+#ifdef _WIN32
+  return static_cast<int64_t>(::GetCurrentProcessId());
+#else
+  return static_cast<int64_t>(::getpid());
+#endif
+}
+
+// 每个线程缓存最近使用的记录器缓冲区，避免每次写入都查表加锁
+struct LocalCache {
+  uint64_t recorder_id = 0;
+  void* buffer = nullptr;
+};
+
+thread_local LocalCache t_cache;
+
+}  // namespace
+
+struct TraceRecorder::ThreadBuffer {
+  ThreadBuffer(std::thread::id owner, int tid, int capacity)
+      : owner(owner), tid(tid), events(new TraceEvent[capacity]) {}
+
+  const std::thread::id owner;
+  const int tid;  // 输出用的线程号，按注册顺序从 1 开始
+  std::string name;  // 受 mutex_ 保护
+  std::unique_ptr<TraceEvent[]> events;
+  // 只由所属线程递增；写入事件后 release 存储，导出时 acquire 读取
+  std::atomic<int> count{0};
+};
+
+TraceRecorder::TraceRecorder(int events_per_thread)
+    : id_(g_next_recorder_id.fetch_add(1, std::memory_order_relaxed)),
+      capacity_(std::max(events_per_thread, 1)),
+      origin_(std::chrono::steady_clock::now()) {}
+
+TraceRecorder::~TraceRecorder() = default;
+
+TraceRecorder& TraceRecorder::Global() {
+  // 有意不析构：退出阶段其他线程和静态对象析构时可能仍在记录
+  static TraceRecorder* recorder = new TraceRecorder();
+  return *recorder;
+}
+
+int64_t TraceRecorder::NowUs() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - origin_)
+      .count();
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::LocalBuffer() {
+  if (t_cache.recorder_id == id_) {
+    return static_cast<ThreadBuffer*>(t_cache.buffer);
+  }
+  const std::thread::id self = std::this_thread::get_id();
+  ThreadBuffer* buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& candidate : buffers_) {
+      if (candidate->owner == self) {
+        buffer = candidate.get();
+        break;
+      }
+    }
+    if (buffer == nullptr) {
+      buffers_.push_back(std::make_unique<ThreadBuffer>(
+          self, static_cast<int>(buffers_.size()) + 1, capacity_));
+      buffer = buffers_.back().get();
+    }
+  }
+  t_cache.recorder_id = id_;
+  t_cache.buffer = buffer;
+  return buffer;
+}
+
+void TraceRecorder::AddComplete(const char* name, const char* category,
+                                int64_t start_us, int64_t duration_us) {
+  ThreadBuffer* buffer = LocalBuffer();
+  const int index = buffer->count.load(std::memory_order_relaxed);
+  if (index >= capacity_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->events[index] = TraceEvent{name, category, start_us,
+                                     std::max<int64_t>(duration_us, 0), 'X'};
+  buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void TraceRecorder::AddInstant(const char* name, const char* category) {
+  ThreadBuffer* buffer = LocalBuffer();
+  const int index = buffer->count.load(std::memory_order_relaxed);
+  if (index >= capacity_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->events[index] = TraceEvent{name, category, NowUs(), 0, 'i'};
+  buffer->count.store(index + 1, std::memory_order_release);
+}
+
+const char* TraceRecorder::Intern(std::string_view text) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = strings_.find(text);
+  if (it == strings_.end()) it = strings_.emplace(text).first;
+  return it->c_str();
+}
+
+void TraceRecorder::SetThreadName(std::string_view name) {
+  ThreadBuffer* buffer = LocalBuffer();
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer->name.assign(name);
+}
+
+void TraceRecorder::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& buffer : buffers_) {
+    buffer->count.store(0, std::memory_order_release);
+  }
+  dropped_.store(0, std::memory_order_relaxed);
+}
+
+size_t TraceRecorder::event_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t total = 0;
+  for (const auto& buffer : buffers_) {
+    total += static_cast<size_t>(buffer->count.load(std::memory_order_acquire));
+  }
+  return total;
+}
+
+std::string TraceRecorder::ToJson() const {
+  struct Entry {
+    const TraceEvent* event;
+    int tid;
+  };
+  std::vector<Entry> entries;
+  std::vector<std::pair<int, std::string>> thread_names;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& buffer : buffers_) {
+      const int count = buffer->count.load(std::memory_order_acquire);
+      for (int i = 0; i < count; ++i) {
+        entries.push_back(Entry{&buffer->events[i], buffer->tid});
+      }
+      if (!buffer->name.empty()) {
+        thread_names.emplace_back(buffer->tid, buffer->name);
+      }
+    }
+  }
+  // 已发布的事件不会再被改写，释放锁后读取是安全的
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return a.event->start_us < b.event->start_us;
+                   });
+  const int64_t base_us =
+      entries.empty() ? 0 : std::min<int64_t>(entries.front().event->start_us, 0);
+  const std::string pid = std::to_string(CurrentPid());
+
+  std::string out;
+  out.reserve(64 + entries.size() * 96);
+  out += "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto& [tid, name] : thread_names) {
+    if (!first) out += ',';
+    first = false;
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":";
+    out += pid;
+    out += ",\"tid\":";
+    out += std::to_string(tid);
+    out += ",\"args\":{\"name\":";
+    AppendJsonString(name, &out);
+    out += "}}";
+  }
+  for (const Entry& entry : entries) {
+    const TraceEvent& event = *entry.event;
+    if (!first) out += ',';
+    first = false;
+    out += "{\"name\":";
+    AppendJsonString(event.name != nullptr ? event.name : "", &out);
+    out += ",\"cat\":";
+    AppendJsonString(event.category != nullptr ? event.category : "", &out);
+    out += ",\"ph\":\"";
+    out += event.phase;
+    out += "\",\"ts\":";
+    out += std::to_string(event.start_us - base_us);
+    if (event.phase == 'X') {
+      out += ",\"dur\":";
+      out += std::to_string(event.duration_us);
+    } else {
+      out += ",\"s\":\"t\"";
+    }
+    out += ",\"pid\":";
+    out += pid;
+    out += ",\"tid\":";
+    out += std::to_string(entry.tid);
+    out += '}';
+  }
+  out += "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":";
+  out += std::to_string(dropped());
+  out += "}}";
+  return out;
+}
+
+bool TraceRecorder::WriteJson(const std::string& path) const {
+  namespace fs = std::filesystem;
+  const std::string json = ToJson();
+  const fs::path target = fs::u8path(path);
+  fs::path temporary = target;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+    if (!file.flush()) return false;
+  }
+  std::error_code error;
+  fs::rename(temporary, target, error);
+  if (error) {
+    fs::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,113 @@
+#ifndef NATIVE_CORE_TRACE_RECORDER_H_
+#define NATIVE_CORE_TRACE_RECORDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cfvpn {
+
+struct TraceEvent {
+  const char* name;      // 字面量或 TraceRecorder::Intern 返回的字符串
+  const char* category;
+  int64_t start_us;      // 相对记录器起点，可以为负（如进程创建时间）
+  int64_t duration_us;   // 'X' 事件的时长，瞬时事件为 0
+  char phase;            // 'X' 完整区间，'i' 瞬时事件
+};
+
+// 启动阶段的轻量追踪记录器，输出 Chrome trace_event JSON
+// （chrome://tracing 或 ui.perfetto.dev 打开）。
+//
+// 每个线程写自己的定长缓冲区：写入只是一次数组赋值加一次 release 存储，
+// 不加锁；缓冲区写满后丢弃并计数。只有线程第一次写入、驻留字符串和
+// 导出时需要加锁。时间取单调时钟，单位微秒。
+class TraceRecorder {
+ public:
+  static constexpr int kDefaultEventsPerThread = 4096;
+
+  explicit TraceRecorder(int events_per_thread = kDefaultEventsPerThread);
+  ~TraceRecorder();
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  // 进程级记录器，起点为第一次调用的时刻（runner 在 wWinMain 开头调用）
+  static TraceRecorder& Global();
+
+  // 相对起点的当前时间
+  int64_t NowUs() const;
+
+  void AddComplete(const char* name, const char* category, int64_t start_us,
+                   int64_t duration_us);
+  void AddInstant(const char* name, const char* category);
+
+  // 复制动态字符串（如 Dart 传来的名称），返回的指针在记录器销毁前有效
+  const char* Intern(std::string_view text);
+
+  // 当前线程在追踪视图中显示的名称
+  void SetThreadName(std::string_view name);
+
+  // 丢弃已记录的事件和丢弃计数，线程名与驻留字符串保留。与写入并发时
+  // 正在写入的线程可能留下清空前的部分事件。
+  void Clear();
+
+  size_t event_count() const;
+  int64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // 导出全部事件。有负时间戳时整体平移，使最早的事件从 0 开始。
+  std::string ToJson() const;
+  // 写入文件（先写临时文件再替换），返回是否成功
+  bool WriteJson(const std::string& path) const;
+
+ private:
+  struct ThreadBuffer;
+
+  ThreadBuffer* LocalBuffer();
+
+  const uint64_t id_;
+  const int capacity_;
+  const std::chrono::steady_clock::time_point origin_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  std::set<std::string, std::less<>> strings_;
+  std::atomic<int64_t> dropped_{0};
+};
+
+// 作用域内的耗时区间，析构时记录到全局记录器
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name, const char* category = "startup")
+      : name_(name),
+        category_(category),
+        start_us_(TraceRecorder::Global().NowUs()) {}
+  ~TraceScope() {
+    TraceRecorder& recorder = TraceRecorder::Global();
+    recorder.AddComplete(name_, category_, start_us_,
+                         recorder.NowUs() - start_us_);
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+  const char* category_;
+  int64_t start_us_;
+};
+
+#define CFVPN_TRACE_CONCAT_INNER(a, b) a##b
+#define CFVPN_TRACE_CONCAT(a, b) CFVPN_TRACE_CONCAT_INNER(a, b)
+// 记录当前作用域：CFVPN_TRACE_SCOPE("RegisterPlugins");
+#define CFVPN_TRACE_SCOPE(...) \
+  ::cfvpn::TraceScope CFVPN_TRACE_CONCAT(cfvpn_trace_scope_, __LINE__)(__VA_ARGS__)
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_TRACE_RECORDER_H_
@@ -0,0 +1,333 @@
+#include "core/trace_response_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cfvpn {
+
+namespace {
+
+char ToLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// 不区分大小写地比较 line 是否以 prefix 开头
+bool StartsWithIgnoreCase(const char* line, size_t length, const char* prefix) {
+  size_t prefix_length = std::strlen(prefix);
+  if (length < prefix_length) {
+    return false;
+  }
+  for (size_t i = 0; i < prefix_length; ++i) {
+    if (ToLower(line[i]) != prefix[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 不区分大小写地查找 token（token 为小写）
+bool ContainsIgnoreCase(const char* text, size_t length, const char* token) {
+  size_t token_length = std::strlen(token);
+  for (size_t i = 0; i + token_length <= length; ++i) {
+    if (StartsWithIgnoreCase(text + i, length - i, token)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TrimSpaces(const char** text, size_t* length) {
+  while (*length > 0 && (**text == ' ' || **text == '\t')) {
+    ++*text;
+    --*length;
+  }
+  while (*length > 0 &&
+         ((*text)[*length - 1] == ' ' || (*text)[*length - 1] == '\t')) {
+    --*length;
+  }
+}
+
+// 复制字段值，超出 capacity - 1 的部分截断
+void CopyField(const char* value, size_t length, char* out, size_t capacity) {
+  size_t n = std::min(length, capacity - 1);
+  std::memcpy(out, value, n);
+  out[n] = '\0';
+}
+
+}  // namespace
+
+void TraceResponseParser::Reset() {
+  phase_ = Phase::kStatusLine;
+  status_code_ = 0;
+  keep_alive_ = true;
+  chunked_ = false;
+  content_length_ = -1;
+  remaining_ = 0;
+  line_.length = 0;
+  line_.overflow = false;
+  body_line_.length = 0;
+  body_line_.overflow = false;
+  colo_[0] = '\0';
+  loc_[0] = '\0';
+}
+
+bool TraceResponseParser::TakeLine(const char* data, size_t length,
+                                   size_t* consumed, LineBuffer* buffer,
+                                   const char** line, size_t* line_length) {
+  const char* start = data + *consumed;
+  size_t available = length - *consumed;
+  const char* newline =
+      static_cast<const char*>(std::memchr(start, '\n', available));
+  size_t piece = newline != nullptr ? static_cast<size_t>(newline - start)
+                                    : available;
+
+  if (newline != nullptr && buffer->length == 0 && !buffer->overflow) {
+    // 常见情况：整行都在本次数据中，不复制
+    *line = start;
+    *line_length = piece;
+  } else {
+    size_t room = sizeof(buffer->data) - buffer->length;
+    size_t copy = std::min(piece, room);
+    std::memcpy(buffer->data + buffer->length, start, copy);
+    buffer->length += copy;
+    if (copy < piece) {
+      buffer->overflow = true;
+    }
+    if (newline == nullptr) {
+      *consumed = length;
+      return false;
+    }
+    *line = buffer->data;
+    *line_length = buffer->length;
+  }
+  *consumed += piece + 1;
+  if (*line_length > 0 && (*line)[*line_length - 1] == '\r') {
+    --*line_length;
+  }
+  return true;
+}
+
+TraceResponseParser::Status TraceResponseParser::Feed(const char* data,
+                                                      size_t length,
+                                                      size_t* consumed) {
+  *consumed = 0;
+  while (*consumed < length && phase_ != Phase::kDone &&
+         phase_ != Phase::kError) {
+    const char* line;
+    size_t line_length;
+    switch (phase_) {
+      case Phase::kStatusLine:
+      case Phase::kHeaders:
+      case Phase::kChunkSize:
+      case Phase::kChunkDataEnd:
+      case Phase::kTrailers:
+        if (!TakeLine(data, length, consumed, &line_, &line, &line_length)) {
+          break;
+        }
+        if (phase_ == Phase::kStatusLine) {
+          if (!OnStatusLine(line, line_length)) {
+            phase_ = Phase::kError;
+          } else {
+            phase_ = Phase::kHeaders;
+          }
+        } else if (phase_ == Phase::kHeaders) {
+          if (line_length == 0) {
+            OnHeadersEnd();
+          } else {
+            OnHeaderLine(line, line_length);
+          }
+        } else if (phase_ == Phase::kChunkSize) {
+          uint64_t size = 0;
+          size_t digits = 0;
+          for (; digits < line_length; ++digits) {
+            char c = ToLower(line[digits]);
+            int value;
+            if (c >= '0' && c <= '9') {
+              value = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+              value = c - 'a' + 10;
+            } else {
+              break;
+            }
+            if (size > (UINT64_MAX >> 4)) {
+              phase_ = Phase::kError;
+              break;
+            }
+            size = (size << 4) | static_cast<uint64_t>(value);
+          }
+          if (phase_ == Phase::kError) {
+            break;
+          }
+          if (digits == 0) {
+            phase_ = Phase::kError;
+          } else if (size == 0) {
+            phase_ = Phase::kTrailers;
+          } else {
+            remaining_ = size;
+            phase_ = Phase::kChunkData;
+          }
+        } else if (phase_ == Phase::kChunkDataEnd) {
+          phase_ = line_length == 0 ? Phase::kChunkSize : Phase::kError;
+        } else if (line_length == 0) {  // kTrailers
+          FinishBody();
+        }
+        line_.length = 0;
+        line_.overflow = false;
+        break;
+
+      case Phase::kBody:
+      case Phase::kChunkData: {
+        size_t take = static_cast<size_t>(
+            std::min<uint64_t>(remaining_, length - *consumed));
+        OnBodyBytes(data + *consumed, take);
+        *consumed += take;
+        remaining_ -= take;
+        if (remaining_ == 0) {
+          if (phase_ == Phase::kBody) {
+            FinishBody();
+          } else {
+            phase_ = Phase::kChunkDataEnd;
+          }
+        }
+        break;
+      }
+
+      case Phase::kBodyUntilClose:
+        OnBodyBytes(data + *consumed, length - *consumed);
+        *consumed = length;
+        break;
+
+      case Phase::kDone:
+      case Phase::kError:
+        break;
+    }
+  }
+
+  if (phase_ == Phase::kDone) {
+    return Status::kDone;
+  }
+  return phase_ == Phase::kError ? Status::kError : Status::kNeedMore;
+}
+
+TraceResponseParser::Status TraceResponseParser::FeedEof() {
+  if (phase_ == Phase::kBodyUntilClose) {
+    FinishBody();
+  }
+  keep_alive_ = false;
+  if (phase_ == Phase::kDone) {
+    return Status::kDone;
+  }
+  phase_ = Phase::kError;
+  return Status::kError;
+}
+
+bool TraceResponseParser::OnStatusLine(const char* line, size_t length) {
+  // HTTP/1.x NNN Reason
+  if (length < 12 || std::memcmp(line, "HTTP/1.", 7) != 0 || line[8] != ' ') {
+    return false;
+  }
+  if (line[7] == '0') {
+    keep_alive_ = false;
+  }
+  int code = 0;
+  for (size_t i = 9; i < 12; ++i) {
+    if (line[i] < '0' || line[i] > '9') {
+      return false;
+    }
+    code = code * 10 + (line[i] - '0');
+  }
+  status_code_ = code;
+  return true;
+}
+
+void TraceResponseParser::OnHeaderLine(const char* line, size_t length) {
+  const char* colon =
+      static_cast<const char*>(std::memchr(line, ':', length));
+  if (colon == nullptr) {
+    return;
+  }
+  size_t name_length = static_cast<size_t>(colon - line);
+  const char* value = colon + 1;
+  size_t value_length = length - name_length - 1;
+  TrimSpaces(&value, &value_length);
+
+  if (name_length == 14 && StartsWithIgnoreCase(line, length, "content-length")) {
+    int64_t parsed = 0;
+    for (size_t i = 0; i < value_length; ++i) {
+      if (value[i] < '0' || value[i] > '9' || parsed > (INT64_MAX / 10)) {
+        phase_ = Phase::kError;
+        return;
+      }
+      parsed = parsed * 10 + (value[i] - '0');
+    }
+    content_length_ = parsed;
+  } else if (name_length == 17 &&
+             StartsWithIgnoreCase(line, length, "transfer-encoding")) {
+    chunked_ = ContainsIgnoreCase(value, value_length, "chunked");
+  } else if (name_length == 10 &&
+             StartsWithIgnoreCase(line, length, "connection")) {
+    if (ContainsIgnoreCase(value, value_length, "close")) {
+      keep_alive_ = false;
+    } else if (ContainsIgnoreCase(value, value_length, "keep-alive")) {
+      keep_alive_ = true;
+    }
+  }
+}
+
+void TraceResponseParser::OnHeadersEnd() {
+  if (status_code_ >= 100 && status_code_ < 200) {
+    // 1xx 临时响应之后还有正式响应
+    bool saved_keep_alive = keep_alive_;
+    Reset();
+    keep_alive_ = saved_keep_alive;
+    return;
+  }
+  if (status_code_ == 204 || status_code_ == 304) {
+    FinishBody();
+  } else if (chunked_) {
+    phase_ = Phase::kChunkSize;
+  } else if (content_length_ >= 0) {
+    remaining_ = static_cast<uint64_t>(content_length_);
+    if (remaining_ == 0) {
+      FinishBody();
+    } else {
+      phase_ = Phase::kBody;
+    }
+  } else {
+    keep_alive_ = false;
+    phase_ = Phase::kBodyUntilClose;
+  }
+}
+
+void TraceResponseParser::OnBodyBytes(const char* data, size_t length) {
+  size_t consumed = 0;
+  while (consumed < length) {
+    const char* line;
+    size_t line_length;
+    if (!TakeLine(data, length, &consumed, &body_line_, &line, &line_length)) {
+      return;
+    }
+    OnBodyLine(line, line_length);
+    body_line_.length = 0;
+    body_line_.overflow = false;
+  }
+}
+
+void TraceResponseParser::OnBodyLine(const char* line, size_t length) {
+  if (length > 5 && std::memcmp(line, "colo=", 5) == 0) {
+    CopyField(line + 5, length - 5, colo_, sizeof(colo_));
+  } else if (length > 4 && std::memcmp(line, "loc=", 4) == 0) {
+    CopyField(line + 4, length - 4, loc_, sizeof(loc_));
+  }
+}
+
+void TraceResponseParser::FinishBody() {
+  // 最后一行可能没有换行符
+  if (body_line_.length > 0) {
+    OnBodyLine(body_line_.data, body_line_.length);
+    body_line_.length = 0;
+  }
+  phase_ = Phase::kDone;
+}
+
+}  // namespace cfvpn
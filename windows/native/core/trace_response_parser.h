@@ -0,0 +1,91 @@
+#ifndef NATIVE_CORE_TRACE_RESPONSE_PARSER_H_
+#define NATIVE_CORE_TRACE_RESPONSE_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cfvpn {
+
+// 增量式 HTTP/1.1 响应解析器，专用于 /cdn-cgi/trace。
+//
+// 直接在接收缓冲区上扫描，只提取状态码、连接是否可复用以及响应体中的
+// colo= 与 loc= 两个字段，不分配任何内存。支持 Content-Length、chunked
+// 以及以连接关闭结束的响应体。只有跨越两次读取的行才会被复制到内部的
+// 小缓冲区里，超长的行（如很长的 Set-Cookie）只保留开头部分。
+class TraceResponseParser {
+ public:
+  enum class Status {
+    kNeedMore,  // 响应尚未结束
+    kDone,      // 响应完整结束
+    kError,     // 格式错误
+  };
+
+  TraceResponseParser() { Reset(); }
+
+  // 准备解析同一连接上的下一个响应
+  void Reset();
+
+  // 解析一段数据。*consumed 返回消费的字节数，响应结束后的数据不会被消费。
+  Status Feed(const char* data, size_t length, size_t* consumed);
+
+  // 对端关闭连接时调用，以连接关闭作为结束的响应在这里完成
+  Status FeedEof();
+
+  int status_code() const { return status_code_; }
+
+  // 响应结束后连接是否可以继续发送请求
+  bool keep_alive() const { return keep_alive_; }
+
+  // 以 NUL 结尾，没有对应字段时为空串
+  const char* colo() const { return colo_; }
+  const char* loc() const { return loc_; }
+
+ private:
+  enum class Phase {
+    kStatusLine,
+    kHeaders,
+    kBody,            // Content-Length
+    kBodyUntilClose,  // 既没有长度也不是 chunked
+    kChunkSize,
+    kChunkData,
+    kChunkDataEnd,    // 数据块后的 CRLF
+    kTrailers,
+    kDone,
+    kError,
+  };
+
+  // 跨读取暂存的一行
+  struct LineBuffer {
+    char data[256];
+    size_t length;
+    bool overflow;
+  };
+
+  // 从 data 中取出一行；整行都在 data 中时直接返回指向 data 的指针，
+  // 否则拼接到 buffer 中。*consumed 累加消费的字节数，行不完整时返回 false。
+  static bool TakeLine(const char* data, size_t length, size_t* consumed,
+                       LineBuffer* buffer, const char** line,
+                       size_t* line_length);
+
+  bool OnStatusLine(const char* line, size_t length);
+  void OnHeaderLine(const char* line, size_t length);
+  void OnHeadersEnd();
+  void OnBodyBytes(const char* data, size_t length);
+  void OnBodyLine(const char* line, size_t length);
+  void FinishBody();
+
+  Phase phase_;
+  int status_code_;
+  bool keep_alive_;
+  bool chunked_;
+  int64_t content_length_;  // -1 表示未知
+  uint64_t remaining_;      // 当前响应体或数据块剩余字节数
+  LineBuffer line_;
+  LineBuffer body_line_;
+  char colo_[8];
+  char loc_[4];
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_TRACE_RESPONSE_PARSER_H_
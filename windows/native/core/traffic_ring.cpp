@@ -0,0 +1,109 @@
+#include "core/traffic_ring.h"
+
+#include <algorithm>
+#include <new>
+
+namespace cfvpn {
+
+namespace {
+
+int32_t TierCapacity(int seconds, int interval_ms) {
+  const int64_t interval = std::max(interval_ms, 1);
+  const int64_t capacity = (static_cast<int64_t>(seconds) * 1000 +
+                            interval - 1) / interval;
+  return static_cast<int32_t>(std::max<int64_t>(capacity, 1));
+}
+
+}  // namespace
+
+TrafficRing::TrafficRing(const TrafficRingOptions& options) {
+  const int intervals[kTrafficTierCount] = {
+      std::max(options.sample_interval_ms, 1),
+      std::max(options.medium_interval_ms, 1),
+      std::max(options.coarse_interval_ms, 1)};
+  const int32_t capacities[kTrafficTierCount] = {
+      TierCapacity(options.full_resolution_seconds, intervals[0]),
+      TierCapacity(options.medium_seconds, intervals[1]),
+      TierCapacity(options.coarse_seconds, intervals[2])};
+
+  size_t offset = sizeof(TrafficRingHeader);
+  size_t offsets[kTrafficTierCount];
+  for (int i = 0; i < kTrafficTierCount; ++i) {
+    offsets[i] = offset;
+    offset += sizeof(TrafficSample) * static_cast<size_t>(capacities[i]);
+  }
+  size_bytes_ = offset;
+  const size_t words = (size_bytes_ + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  storage_.reset(new uint64_t[words]());
+
+  header_ = new (storage_.get()) TrafficRingHeader;
+  header_->magic = kTrafficRingMagic;
+  header_->tier_count = kTrafficTierCount;
+  for (int i = 0; i < kTrafficTierCount; ++i) {
+    TrafficTierHeader& tier = header_->tiers[i];
+    tier.write_count.store(0, std::memory_order_relaxed);
+    tier.capacity = capacities[i];
+    tier.interval_ms = intervals[i];
+    tier.samples_offset = static_cast<int64_t>(offsets[i]);
+    tier.reserved = 0;
+  }
+}
+
+TrafficSample* TrafficRing::SamplesOf(int tier) const {
+  return reinterpret_cast<TrafficSample*>(
+      reinterpret_cast<uint8_t*>(header_) +
+      header_->tiers[tier].samples_offset);
+}
+
+void TrafficRing::Append(const TrafficSample& sample) {
+  for (int i = 0; i < kTrafficTierCount; ++i) {
+    TrafficTierHeader& tier = header_->tiers[i];
+    // 全分辨率层记录每个样本，其余层只在跨过间隔边界时记录
+    if (i > 0 && sample.time_ms < next_due_ms_[i]) continue;
+    const int64_t count = tier.write_count.load(std::memory_order_relaxed);
+    SamplesOf(i)[count % tier.capacity] = sample;
+    tier.write_count.store(count + 1, std::memory_order_release);
+    next_due_ms_[i] = (sample.time_ms / tier.interval_ms + 1) *
+                      tier.interval_ms;
+  }
+}
+
+void TrafficRing::Read(int tier, int64_t since_ms,
+                       std::vector<TrafficSample>* out) const {
+  if (tier < 0 || tier >= kTrafficTierCount) return;
+  const TrafficTierHeader& header = header_->tiers[tier];
+  const TrafficSample* samples = SamplesOf(tier);
+  const int64_t end = header.write_count.load(std::memory_order_acquire);
+  const int64_t begin = std::max<int64_t>(end - header.capacity, 0);
+
+  // 从最新样本向前复制，直到早于 since_ms
+  const size_t first = out->size();
+  int64_t index = end - 1;
+  for (; index >= begin; --index) {
+    const TrafficSample& sample = samples[index % header.capacity];
+    if (sample.time_ms < since_ms) break;
+    out->push_back(sample);
+  }
+
+  // 复制期间生产者可能已经覆盖了最旧的样本（包括正在写、尚未发布的那个），
+  // 丢弃这部分
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const int64_t after = header.write_count.load(std::memory_order_relaxed);
+  const int64_t valid_from = after - header.capacity + 1;
+  const int64_t copied_from = index + 1;
+  if (copied_from < valid_from) {
+    const size_t torn = static_cast<size_t>(valid_from - copied_from);
+    out->resize(out->size() - std::min(torn, out->size() - first));
+  }
+  std::reverse(out->begin() + static_cast<std::ptrdiff_t>(first), out->end());
+}
+
+bool TrafficRing::Latest(TrafficSample* out) const {
+  const TrafficTierHeader& header = header_->tiers[0];
+  const int64_t count = header.write_count.load(std::memory_order_acquire);
+  if (count == 0) return false;
+  *out = SamplesOf(0)[(count - 1) % header.capacity];
+  return true;
+}
+
+}  // namespace cfvpn
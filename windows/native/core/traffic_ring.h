@@ -0,0 +1,97 @@
+#ifndef NATIVE_CORE_TRAFFIC_RING_H_
+#define NATIVE_CORE_TRAFFIC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cfvpn {
+
+// 流量采样，up/down 为采样器启动以来的累计字节数（单调不减），
+// 任意两个样本相减即可得到这段时间的平均速率
+struct TrafficSample {
+  int64_t time_ms;  // Unix 时间（毫秒）
+  int64_t up_bytes;
+  int64_t down_bytes;
+};
+
+// 一个分辨率层级。以下布局直接暴露给 Dart（见 lib/services/native_core.dart
+// 中的 TrafficRing），字段顺序和大小不能改变。
+struct TrafficTierHeader {
+  // 已写入的样本总数，只增不减。最新样本位于 (write_count - 1) % capacity。
+  std::atomic<int64_t> write_count;
+  int32_t capacity;
+  int32_t interval_ms;     // 相邻样本的间隔
+  int64_t samples_offset;  // 样本数组相对于 TrafficRingHeader 的字节偏移
+  int64_t reserved;
+};
+
+constexpr uint32_t kTrafficRingMagic = 0x52465443;  // "CTFR"
+constexpr int kTrafficTierCount = 3;
+
+struct TrafficRingHeader {
+  uint32_t magic;
+  int32_t tier_count;
+  TrafficTierHeader tiers[kTrafficTierCount];
+};
+
+static_assert(std::atomic<int64_t>::is_always_lock_free,
+              "readers rely on lock-free 64-bit counters");
+static_assert(sizeof(TrafficSample) == 24, "layout shared with Dart");
+static_assert(sizeof(TrafficTierHeader) == 32, "layout shared with Dart");
+static_assert(sizeof(TrafficRingHeader) == 8 + 32 * kTrafficTierCount,
+              "layout shared with Dart");
+
+struct TrafficRingOptions {
+  // 全分辨率层的采样间隔和保留时长
+  int sample_interval_ms = 250;
+  int full_resolution_seconds = 3600;
+  // 降采样层：5 秒保留 1 天，1 分钟保留 7 天
+  int medium_interval_ms = 5000;
+  int medium_seconds = 24 * 3600;
+  int coarse_interval_ms = 60000;
+  int coarse_seconds = 7 * 24 * 3600;
+};
+
+// 单生产者、多读者的分层流量环形缓冲区。
+//
+// 所有层级放在一块连续内存中，读者（包括 Dart 通过指针直接读取）不加锁：
+// 先读 write_count，复制所需样本，再读一次 write_count，丢弃期间可能被
+// 覆盖的样本（序号小于第二次读到的 write_count - capacity）。
+// 生产者先写样本、再以 release 语义递增 write_count。
+//
+// 样本是累计值，降采样只需在跨过层级间隔边界时记录当前样本，不需要求和。
+class TrafficRing {
+ public:
+  explicit TrafficRing(const TrafficRingOptions& options);
+
+  TrafficRing(const TrafficRing&) = delete;
+  TrafficRing& operator=(const TrafficRing&) = delete;
+
+  // 追加一个样本（仅由生产者线程调用），time_ms 应单调不减
+  void Append(const TrafficSample& sample);
+
+  // 读取 tier 层中 time_ms >= since_ms 的样本，按时间升序追加到 out。
+  // 可以与 Append 并发调用。
+  void Read(int tier, int64_t since_ms, std::vector<TrafficSample>* out) const;
+
+  // 最新的全分辨率样本，没有样本时返回 false
+  bool Latest(TrafficSample* out) const;
+
+  const TrafficRingHeader* header() const { return header_; }
+  size_t size_bytes() const { return size_bytes_; }
+
+ private:
+  TrafficSample* SamplesOf(int tier) const;
+
+  std::unique_ptr<uint64_t[]> storage_;  // 8 字节对齐
+  size_t size_bytes_ = 0;
+  TrafficRingHeader* header_ = nullptr;
+  int64_t next_due_ms_[kTrafficTierCount] = {};  // 仅生产者使用
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_TRAFFIC_RING_H_
@@ -0,0 +1,76 @@
+#include "core/traffic_sampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace cfvpn {
+
+TrafficSampler::TrafficSampler(const TrafficRingOptions& options,
+                               Source source)
+    : ring_(options),
+      source_(std::move(source)),
+      interval_ms_(std::max(options.sample_interval_ms, 1)) {}
+
+TrafficSampler::~TrafficSampler() { Stop(); }
+
+void TrafficSampler::Start() {
+  if (worker_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
+  }
+  worker_ = std::thread(&TrafficSampler::Run, this);
+}
+
+void TrafficSampler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  if (worker_.joinable()) worker_.join();
+}
+
+void TrafficSampler::SampleOnce(int64_t time_ms) {
+  int64_t up = 0;
+  int64_t down = 0;
+  if (!source_ || !source_(&up, &down)) {
+    failures_.fetch_add(1);
+    return;
+  }
+  total_up_ += up >= last_up_ ? up - last_up_ : up;
+  total_down_ += down >= last_down_ ? down - last_down_ : down;
+  last_up_ = up;
+  last_down_ = down;
+
+  TrafficSample sample;
+  sample.time_ms = time_ms;
+  sample.up_bytes = total_up_;
+  sample.down_bytes = total_down_;
+  ring_.Append(sample);
+}
+
+void TrafficSampler::Run() {
+  using Clock = std::chrono::steady_clock;
+  const auto interval = std::chrono::milliseconds(interval_ms_);
+  auto next = Clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    lock.unlock();
+    const int64_t now_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    SampleOnce(now_ms);
+    lock.lock();
+
+    // 按固定节拍调度，查询耗时不累积漂移；落后太多（休眠唤醒）时重新对齐
+    next += interval;
+    const auto now = Clock::now();
+    if (next < now) next = now + interval;
+    wake_.wait_until(lock, next, [this] { return stopping_; });
+  }
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,65 @@
+#ifndef NATIVE_CORE_TRAFFIC_SAMPLER_H_
+#define NATIVE_CORE_TRAFFIC_SAMPLER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "core/traffic_ring.h"
+
+namespace cfvpn {
+
+// 按固定间隔读取流量计数器并写入 TrafficRing 的后台线程。
+//
+// 采样线程是环形缓冲区唯一的生产者；界面是否可见不影响采样，
+// 每次采样的开销固定（一次回环 gRPC 查询加几次内存写入）。
+class TrafficSampler {
+ public:
+  // 读取当前的上/下行累计字节数，失败时返回 false（本次不记录样本）。
+  // 样本的累计值从 0 开始按增量累加，没有清零时与计数器本身相等；
+  // 计数器变小视为被清零（v2ray 重启或 reset 查询），继续累计。
+  using Source = std::function<bool(int64_t* up_bytes, int64_t* down_bytes)>;
+
+  TrafficSampler(const TrafficRingOptions& options, Source source);
+  ~TrafficSampler();
+
+  TrafficSampler(const TrafficSampler&) = delete;
+  TrafficSampler& operator=(const TrafficSampler&) = delete;
+
+  // 启动采样线程，间隔为 options.sample_interval_ms
+  void Start();
+  // 停止并等待采样线程退出，可重复调用
+  void Stop();
+
+  // 采样一次，time_ms 为 Unix 时间（毫秒）。由采样线程调用，
+  // 测试中也可以在未 Start 时直接调用以控制时间。
+  void SampleOnce(int64_t time_ms);
+
+  const TrafficRing& ring() const { return ring_; }
+  int64_t failures() const { return failures_.load(); }
+
+ private:
+  void Run();
+
+  TrafficRing ring_;
+  Source source_;
+  int interval_ms_;
+
+  int64_t last_up_ = 0;
+  int64_t last_down_ = 0;
+  int64_t total_up_ = 0;
+  int64_t total_down_ = 0;
+  std::atomic<int64_t> failures_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_TRAFFIC_SAMPLER_H_
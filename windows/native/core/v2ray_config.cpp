@@ -0,0 +1,228 @@
+#include "core/v2ray_config.h"
+
+#include <charconv>
+#include <unordered_map>
+#include <utility>
+
+#include "core/json.h"
+
+namespace cfvpn {
+
+namespace {
+
+bool IsTagged(const JsonValue& value, std::string_view tag) {
+  const JsonValue* field = value.Find("tag");
+  return field != nullptr && field->is_string() && field->text == tag;
+}
+
+bool ContainsString(const JsonValue* list, std::string_view value) {
+  if (list == nullptr || !list->is_array()) return false;
+  for (const JsonValue& item : list->items) {
+    if (item.is_string() && item.text == value) return true;
+  }
+  return false;
+}
+
+void AppendInt(int64_t value, std::string* out) {
+  char buffer[24];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out->append(buffer, result.ptr);
+}
+
+template <typename Slot>
+using SlotMap = std::unordered_map<const JsonValue*, Slot>;
+
+// 把模板序列化为固定文本，遇到槽位节点时结束当前段
+template <typename Slot, typename Piece>
+void Flatten(const JsonValue& value, const SlotMap<Slot>& slots,
+             std::string* literal, std::vector<Piece>* pieces) {
+  const auto it = slots.find(&value);
+  if (it != slots.end()) {
+    pieces->push_back(Piece{std::move(*literal), it->second});
+    literal->clear();
+    return;
+  }
+  if (value.is_array()) {
+    literal->push_back('[');
+    for (size_t i = 0; i < value.items.size(); ++i) {
+      if (i > 0) literal->push_back(',');
+      Flatten(value.items[i], slots, literal, pieces);
+    }
+    literal->push_back(']');
+  } else if (value.is_object()) {
+    literal->push_back('{');
+    for (size_t i = 0; i < value.members.size(); ++i) {
+      if (i > 0) literal->push_back(',');
+      AppendJsonString(value.members[i].first, literal);
+      literal->push_back(':');
+      Flatten(value.members[i].second, slots, literal, pieces);
+    }
+    literal->push_back('}');
+  } else {
+    AppendJson(value, literal);
+  }
+}
+
+}  // namespace
+
+bool V2rayConfigBuilder::LoadTemplate(std::string_view text,
+                                      std::string* error) {
+  loaded_ = false;
+  pieces_.clear();
+  tail_.clear();
+  template_server_port_ = 0;
+  default_server_name_.clear();
+  default_user_id_.clear();
+  smart_rules_.clear();
+  global_rules_.clear();
+
+  JsonValue root;
+  if (!ParseJson(text, &root, error)) return false;
+  if (!root.is_object()) {
+    if (error != nullptr) *error = "模板不是 JSON 对象";
+    return false;
+  }
+
+  // 先补全需要写入但模板中缺少的成员，再记录节点地址：同一对象中
+  // 添加成员会使其他成员的地址失效
+  SlotMap<Slot> slots;
+  if (JsonValue* inbounds = root.Find("inbounds");
+      inbounds != nullptr && inbounds->is_array()) {
+    for (JsonValue& inbound : inbounds->items) {
+      if (IsTagged(inbound, "socks")) {
+        slots[&inbound.Member("port")] = Slot::kSocksPort;
+      } else if (IsTagged(inbound, "http")) {
+        slots[&inbound.Member("port")] = Slot::kHttpPort;
+      }
+    }
+  }
+
+  JsonValue* proxy = nullptr;
+  if (JsonValue* outbounds = root.Find("outbounds");
+      outbounds != nullptr && outbounds->is_array()) {
+    for (JsonValue& outbound : outbounds->items) {
+      if (outbound.is_object() && IsTagged(outbound, "proxy")) {
+        proxy = &outbound;
+        break;
+      }
+    }
+  }
+  if (proxy != nullptr) {
+    JsonValue* settings = proxy->Find("settings");
+    JsonValue* vnext = settings != nullptr ? settings->Find("vnext") : nullptr;
+    if (vnext != nullptr && vnext->is_array() && !vnext->items.empty() &&
+        vnext->items[0].is_object()) {
+      JsonValue& server = vnext->items[0];
+      // 模板中有有效端口时保留，否则使用传入的端口
+      const JsonValue* port = server.Find("port");
+      template_server_port_ =
+          port != nullptr ? static_cast<int>(port->AsInt(0)) : 0;
+      if (template_server_port_ <= 0) {
+        template_server_port_ = 0;
+        server.Member("port");
+      }
+      server.Member("address");
+      slots[server.Find("address")] = Slot::kServerAddress;
+      if (template_server_port_ == 0) {
+        slots[server.Find("port")] = Slot::kServerPort;
+      }
+      JsonValue* users = server.Find("users");
+      if (users != nullptr && users->is_array() && !users->items.empty() &&
+          users->items[0].is_object()) {
+        JsonValue& id = users->items[0].Member("id");
+        AppendJson(id, &default_user_id_);
+        slots[&id] = Slot::kUserId;
+      }
+    }
+
+    JsonValue* stream = proxy->Find("streamSettings");
+    JsonValue* tls = stream != nullptr ? stream->Find("tlsSettings") : nullptr;
+    JsonValue* ws = stream != nullptr ? stream->Find("wsSettings") : nullptr;
+    JsonValue* headers = ws != nullptr ? ws->Find("headers") : nullptr;
+    // 默认 serverName：TLS serverName，其次 WebSocket Host
+    for (const JsonValue* source :
+         {tls != nullptr ? tls->Find("serverName") : nullptr,
+          headers != nullptr ? headers->Find("Host") : nullptr}) {
+      if (default_server_name_.empty() && source != nullptr &&
+          source->is_string()) {
+        default_server_name_ = source->text;
+      }
+    }
+    if (default_server_name_.empty()) {
+      default_server_name_ = kDefaultV2rayServerName;
+    }
+    if (tls != nullptr && tls->is_object()) {
+      slots[&tls->Member("serverName")] = Slot::kServerName;
+    }
+    if (headers != nullptr && headers->is_object()) {
+      slots[&headers->Member("Host")] = Slot::kServerName;
+    }
+  }
+
+  JsonValue* routing = root.Find("routing");
+  JsonValue* rules = routing != nullptr ? routing->Find("rules") : nullptr;
+  if (rules != nullptr && rules->is_array()) {
+    AppendJson(*rules, &smart_rules_);
+    global_rules_.push_back('[');
+    for (const JsonValue& rule : rules->items) {
+      if (rule.is_object() && ContainsString(rule.Find("inboundTag"), "api")) {
+        AppendJson(rule, &global_rules_);
+        global_rules_.push_back(',');
+      }
+    }
+    global_rules_.append(
+        R"({"type":"field","port":"0-65535","outboundTag":"proxy"}])");
+    slots[rules] = Slot::kRoutingRules;
+  }
+
+  Flatten(root, slots, &tail_, &pieces_);
+  output_.reserve(tail_.size() + smart_rules_.size() + 256);
+  loaded_ = true;
+  return true;
+}
+
+void V2rayConfigBuilder::AppendSlot(Slot slot,
+                                    const V2rayConfigParams& params) {
+  switch (slot) {
+    case Slot::kSocksPort:
+      AppendInt(params.socks_port, &output_);
+      break;
+    case Slot::kHttpPort:
+      AppendInt(params.http_port, &output_);
+      break;
+    case Slot::kServerAddress:
+      AppendJsonString(params.server_ip, &output_);
+      break;
+    case Slot::kServerPort:
+      AppendInt(params.server_port, &output_);
+      break;
+    case Slot::kUserId:
+      if (params.user_id.empty()) {
+        output_.append(default_user_id_);
+      } else {
+        AppendJsonString(params.user_id, &output_);
+      }
+      break;
+    case Slot::kServerName:
+      AppendJsonString(params.server_name.empty() ? default_server_name_
+                                                  : params.server_name,
+                       &output_);
+      break;
+    case Slot::kRoutingRules:
+      output_.append(params.global_proxy ? global_rules_ : smart_rules_);
+      break;
+  }
+}
+
+const std::string& V2rayConfigBuilder::Build(const V2rayConfigParams& params) {
+  output_.clear();
+  if (!loaded_) return output_;
+  for (const Piece& piece : pieces_) {
+    output_.append(piece.text);
+    AppendSlot(piece.slot, params);
+  }
+  output_.append(tail_);
+  return output_;
+}
+
+}  // namespace cfvpn
@@ -0,0 +1,81 @@
+#ifndef NATIVE_CORE_V2RAY_CONFIG_H_
+#define NATIVE_CORE_V2RAY_CONFIG_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cfvpn {
+
+// 未指定且模板中也没有时使用的 serverName，与 V2RayService 一致
+constexpr char kDefaultV2rayServerName[] = "pages-vless-a9f.pages.dev";
+
+struct V2rayConfigParams {
+  std::string server_ip;    // proxy 出站地址（CDN IP）
+  int server_port = 443;    // 模板中没有有效端口时才使用
+  std::string server_name;  // TLS serverName 和 WebSocket Host，空则用模板中的值
+  std::string user_id;      // VLESS 用户 UUID，空则保留模板中的值
+  int socks_port = 7898;    // 与 AppConfig.v2raySocksPort 一致
+  int http_port = 7899;     // 与 AppConfig.v2rayHttpPort 一致
+  bool global_proxy = false;  // 全局代理：只保留 API 路由，其余全部走 proxy
+};
+
+// 由 assets/js/v2ray_config.json 模板生成 v2ray 配置，逻辑与
+// V2RayService._generateConfigMap 相同，输出与 jsonEncode 相同的紧凑 JSON。
+//
+// 模板只在 LoadTemplate 时解析一次。随后把模板序列化为若干段固定文本，
+// 段与段之间是随节点和模式变化的"槽位"（入站端口、proxy 出站的地址、
+// 端口、UUID、serverName、Host 以及路由规则）。Build 只需依次拼接固定文本
+// 和槽位的值，写入复用的缓冲区，不再解析或遍历 JSON。
+//
+// 非线程安全。
+class V2rayConfigBuilder {
+ public:
+  // 解析模板（允许注释和尾随逗号）。失败时返回 false，error 给出原因。
+  bool LoadTemplate(std::string_view text, std::string* error);
+
+  bool loaded() const { return loaded_; }
+
+  // 生成配置，返回的引用在下一次 Build 之前有效
+  const std::string& Build(const V2rayConfigParams& params);
+
+  // 模板中 proxy 出站的端口，没有有效端口时为 0（使用 params.server_port）
+  int template_server_port() const { return template_server_port_; }
+  // serverName 为空时实际使用的值
+  const std::string& default_server_name() const {
+    return default_server_name_;
+  }
+
+ private:
+  enum class Slot : uint8_t {
+    kSocksPort,
+    kHttpPort,
+    kServerAddress,
+    kServerPort,
+    kUserId,
+    kServerName,
+    kRoutingRules,
+  };
+
+  struct Piece {
+    std::string text;  // 槽位之前的固定文本
+    Slot slot;
+  };
+
+  void AppendSlot(Slot slot, const V2rayConfigParams& params);
+
+  bool loaded_ = false;
+  std::vector<Piece> pieces_;
+  std::string tail_;  // 最后一个槽位之后的固定文本
+  int template_server_port_ = 0;
+  std::string default_server_name_;
+  std::string default_user_id_;
+  std::string smart_rules_;   // 智能分流：模板中的全部规则
+  std::string global_rules_;  // 全局代理：API 规则加一条全部走 proxy 的规则
+  std::string output_;
+};
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_V2RAY_CONFIG_H_
@@ -0,0 +1,607 @@
+#include "core/v2ray_stats_client.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#else
+#include <netinet/tcp.h>
+#endif
+
+namespace cfvpn {
+
+namespace {
+
+constexpr char kPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// 帧类型
+constexpr uint8_t kData = 0x0;
+constexpr uint8_t kHeaders = 0x1;
+constexpr uint8_t kRstStream = 0x3;
+constexpr uint8_t kSettings = 0x4;
+constexpr uint8_t kPing = 0x6;
+constexpr uint8_t kGoAway = 0x7;
+constexpr uint8_t kWindowUpdate = 0x8;
+
+// 帧标志
+constexpr uint8_t kEndStream = 0x1;
+constexpr uint8_t kAck = 0x1;
+constexpr uint8_t kEndHeaders = 0x4;
+constexpr uint8_t kPadded = 0x8;
+
+constexpr size_t kFrameHeaderSize = 9;
+// 没有修改 SETTINGS_MAX_FRAME_SIZE，对端不会发送更大的帧
+constexpr size_t kMaxFrameSize = 16384;
+// 通告给对端的流级和连接级接收窗口
+constexpr uint32_t kReceiveWindow = 1 << 20;
+constexpr uint32_t kDefaultWindow = 65535;
+
+#if defined(_WIN32)
+constexpr int kSendFlags = 0;
+#else
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#endif
+
+int RemainingMs(int64_t deadline) {
+  int64_t remaining = deadline - MonotonicMicros();
+  return remaining <= 0 ? 0 : static_cast<int>((remaining + 999) / 1000);
+}
+
+void AppendUint32(std::string* out, uint32_t value) {
+  out->push_back(static_cast<char>(value >> 24));
+  out->push_back(static_cast<char>(value >> 16));
+  out->push_back(static_cast<char>(value >> 8));
+  out->push_back(static_cast<char>(value));
+}
+
+uint32_t ReadUint32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) |
+         (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+void AppendFrameHeader(std::string* out, size_t length, uint8_t type,
+                       uint8_t flags, uint32_t stream_id) {
+  out->push_back(static_cast<char>(length >> 16));
+  out->push_back(static_cast<char>(length >> 8));
+  out->push_back(static_cast<char>(length));
+  out->push_back(static_cast<char>(type));
+  out->push_back(static_cast<char>(flags));
+  AppendUint32(out, stream_id & 0x7FFFFFFFu);
+}
+
+void AppendWindowUpdate(std::string* out, uint32_t stream_id,
+                        uint32_t increment) {
+  AppendFrameHeader(out, 4, kWindowUpdate, 0, stream_id);
+  AppendUint32(out, increment);
+}
+
+// HPACK 整数，prefix_bits 位前缀（RFC 7541 5.1）
+void AppendHpackInt(std::string* out, uint8_t first, int prefix_bits,
+                    uint32_t value) {
+  const uint32_t max = (1u << prefix_bits) - 1;
+  if (value < max) {
+    out->push_back(static_cast<char>(first | value));
+    return;
+  }
+  out->push_back(static_cast<char>(first | max));
+  value -= max;
+  while (value >= 128) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// 不使用 Huffman 编码的字符串字面量
+void AppendHpackString(std::string* out, const std::string& value) {
+  AppendHpackInt(out, 0x00, 7, static_cast<uint32_t>(value.size()));
+  out->append(value);
+}
+
+// 静态表中名称的“不带索引的字面量”（RFC 7541 6.2.2）
+void AppendHpackLiteral(std::string* out, uint32_t name_index,
+                        const std::string& value) {
+  AppendHpackInt(out, 0x00, 4, name_index);
+  AppendHpackString(out, value);
+}
+
+void AppendVarint(std::string* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(const uint8_t** cursor, const uint8_t* end, uint64_t* out) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+    uint8_t byte = *(*cursor)++;
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *out = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+// 读取一个 length-delimited 字段的范围
+bool ReadBytes(const uint8_t** cursor, const uint8_t* end,
+               const uint8_t** data, size_t* size) {
+  uint64_t length;
+  if (!ReadVarint(cursor, end, &length) ||
+      length > static_cast<uint64_t>(end - *cursor)) {
+    return false;
+  }
+  *data = *cursor;
+  *size = static_cast<size_t>(length);
+  *cursor += length;
+  return true;
+}
+
+bool SkipField(uint32_t wire_type, const uint8_t** cursor,
+               const uint8_t* end) {
+  uint64_t ignored;
+  const uint8_t* data;
+  size_t size;
+  switch (wire_type) {
+    case 0:
+      return ReadVarint(cursor, end, &ignored);
+    case 1:
+      if (end - *cursor < 8) {
+        return false;
+      }
+      *cursor += 8;
+      return true;
+    case 2:
+      return ReadBytes(cursor, end, &data, &size);
+    case 5:
+      if (end - *cursor < 4) {
+        return false;
+      }
+      *cursor += 4;
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+std::string EncodeQueryStatsRequest(const std::string& pattern, bool reset) {
+  std::string out;
+  if (!pattern.empty()) {
+    out.push_back(0x0A);  // 1: pattern
+    AppendVarint(&out, pattern.size());
+    out.append(pattern);
+  }
+  if (reset) {
+    out.push_back(0x10);  // 2: reset
+    out.push_back(0x01);
+  }
+  return out;
+}
+
+bool DecodeQueryStatsRequest(const uint8_t* data, size_t size,
+                             std::string* pattern, bool* reset) {
+  pattern->clear();
+  *reset = false;
+  const uint8_t* cursor = data;
+  const uint8_t* end = data + size;
+  while (cursor < end) {
+    uint64_t key;
+    if (!ReadVarint(&cursor, end, &key)) {
+      return false;
+    }
+    const uint32_t wire_type = static_cast<uint32_t>(key & 7);
+    if (key >> 3 == 1 && wire_type == 2) {
+      const uint8_t* bytes;
+      size_t length;
+      if (!ReadBytes(&cursor, end, &bytes, &length)) {
+        return false;
+      }
+      pattern->assign(reinterpret_cast<const char*>(bytes), length);
+    } else if (key >> 3 == 2 && wire_type == 0) {
+      uint64_t value;
+      if (!ReadVarint(&cursor, end, &value)) {
+        return false;
+      }
+      *reset = value != 0;
+    } else if (!SkipField(wire_type, &cursor, end)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string EncodeQueryStatsResponse(const std::vector<StatsCounter>& stats) {
+  std::string out;
+  std::string stat;
+  for (const StatsCounter& counter : stats) {
+    stat.clear();
+    stat.push_back(0x0A);  // Stat.name
+    AppendVarint(&stat, counter.name.size());
+    stat.append(counter.name);
+    if (counter.value != 0) {
+      stat.push_back(0x10);  // Stat.value
+      AppendVarint(&stat, static_cast<uint64_t>(counter.value));
+    }
+    out.push_back(0x0A);  // QueryStatsResponse.stat
+    AppendVarint(&out, stat.size());
+    out.append(stat);
+  }
+  return out;
+}
+
+bool DecodeQueryStatsResponse(const uint8_t* data, size_t size,
+                              std::vector<StatsCounter>* out) {
+  const uint8_t* cursor = data;
+  const uint8_t* end = data + size;
+  while (cursor < end) {
+    uint64_t key;
+    if (!ReadVarint(&cursor, end, &key)) {
+      return false;
+    }
+    const uint32_t wire_type = static_cast<uint32_t>(key & 7);
+    if (key >> 3 != 1 || wire_type != 2) {
+      if (!SkipField(wire_type, &cursor, end)) {
+        return false;
+      }
+      continue;
+    }
+    const uint8_t* stat;
+    size_t stat_size;
+    if (!ReadBytes(&cursor, end, &stat, &stat_size)) {
+      return false;
+    }
+    StatsCounter counter;
+    const uint8_t* field = stat;
+    const uint8_t* stat_end = stat + stat_size;
+    while (field < stat_end) {
+      uint64_t stat_key;
+      if (!ReadVarint(&field, stat_end, &stat_key)) {
+        return false;
+      }
+      const uint32_t stat_wire_type = static_cast<uint32_t>(stat_key & 7);
+      if (stat_key >> 3 == 1 && stat_wire_type == 2) {
+        const uint8_t* name;
+        size_t name_size;
+        if (!ReadBytes(&field, stat_end, &name, &name_size)) {
+          return false;
+        }
+        counter.name.assign(reinterpret_cast<const char*>(name), name_size);
+      } else if (stat_key >> 3 == 2 && stat_wire_type == 0) {
+        uint64_t value;
+        if (!ReadVarint(&field, stat_end, &value)) {
+          return false;
+        }
+        counter.value = static_cast<int64_t>(value);
+      } else if (!SkipField(stat_wire_type, &field, stat_end)) {
+        return false;
+      }
+    }
+    out->push_back(std::move(counter));
+  }
+  return true;
+}
+
+V2rayStatsClient::V2rayStatsClient(const V2rayStatsOptions& options)
+    : options_(options) {
+  InitSocketLibrary();
+}
+
+V2rayStatsClient::~V2rayStatsClient() {
+  Close();
+}
+
+void V2rayStatsClient::Close() {
+  if (socket_ != kInvalidSocket) {
+    CloseSocket(socket_);
+    socket_ = kInvalidSocket;
+  }
+  input_.clear();
+  input_offset_ = 0;
+  pending_window_ = 0;
+}
+
+bool V2rayStatsClient::Fail(const std::string& error) {
+  last_error_ = error;
+  Close();
+  return false;
+}
+
+bool V2rayStatsClient::QueryStats(const std::string& pattern, bool reset,
+                                  std::vector<StatsCounter>* out) {
+  out->clear();
+  last_error_.clear();
+  const int64_t deadline =
+      MonotonicMicros() + static_cast<int64_t>(options_.timeout_ms) * 1000;
+  // 流 ID 用尽时换一条连接
+  if (connected() && next_stream_id_ >= 0x7FFFFFFFu) {
+    Close();
+  }
+
+  const bool reused = connected();
+  if (!reused && !Connect(deadline)) {
+    return false;
+  }
+  const std::string request = EncodeQueryStatsRequest(pattern, reset);
+  Result result = Exchange(request, deadline, out);
+  if (result == Result::kTransportError && reused) {
+    // 复用的连接可能已被对端关闭（v2ray 重启等），重连后再试一次
+    out->clear();
+    if (!Connect(deadline)) {
+      return false;
+    }
+    result = Exchange(request, deadline, out);
+  }
+  if (going_away_) {
+    Close();
+  }
+  return result == Result::kOk;
+}
+
+bool V2rayStatsClient::Connect(int64_t deadline) {
+  Close();
+  NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (socket == kInvalidSocket) {
+    return Fail("socket: " + SocketErrorString(LastSocketError()));
+  }
+  socket_ = socket;
+  if (!SetNonBlocking(socket)) {
+    return Fail("set non-blocking: " + SocketErrorString(LastSocketError()));
+  }
+  int no_delay = 1;
+  ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+               reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+
+  sockaddr_in address = MakeSockaddrV4(options_.ip, options_.port);
+  if (::connect(socket, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    int error = LastSocketError();
+    if (!IsInProgressError(error)) {
+      return Fail("connect: " + SocketErrorString(error));
+    }
+    int ready = PollSocket(socket, true, RemainingMs(deadline));
+    if (ready <= 0) {
+      return Fail(ready == 0 ? "connect: timed out"
+                             : "connect: " +
+                                   SocketErrorString(LastSocketError()));
+    }
+    socklen_t length = sizeof(error);
+    if (::getsockopt(socket, SOL_SOCKET, SO_ERROR,
+                     reinterpret_cast<char*>(&error), &length) != 0 ||
+        error != 0) {
+      return Fail("connect: " + SocketErrorString(error));
+    }
+  }
+
+  ++connections_;
+  next_stream_id_ = 1;
+  going_away_ = false;
+
+  // 请求头在连接内固定不变，只构造一次
+  const std::string authority =
+      FormatIpv4(options_.ip) + ":" + std::to_string(options_.port);
+  headers_block_.clear();
+  headers_block_.push_back(static_cast<char>(0x83));  // :method: POST
+  headers_block_.push_back(static_cast<char>(0x86));  // :scheme: http
+  AppendHpackLiteral(&headers_block_, 4,
+                     "/" + options_.service + "/QueryStats");  // :path
+  AppendHpackLiteral(&headers_block_, 1, authority);  // :authority
+  AppendHpackLiteral(&headers_block_, 31, "application/grpc");  // content-type
+  headers_block_.push_back(0x00);  // te: trailers（名称不在静态表中）
+  AppendHpackString(&headers_block_, "te");
+  AppendHpackString(&headers_block_, "trailers");
+
+  // 连接前言、SETTINGS（禁用推送，放大流窗口）、放大连接窗口。
+  // 不等待对端的 SETTINGS，直接随第一个请求发送。
+  output_.assign(kPreface, sizeof(kPreface) - 1);
+  AppendFrameHeader(&output_, 12, kSettings, 0, 0);
+  output_.append("\x00\x02\x00\x00\x00\x00", 6);  // ENABLE_PUSH = 0
+  output_.append("\x00\x04", 2);                  // INITIAL_WINDOW_SIZE
+  AppendUint32(&output_, kReceiveWindow);
+  AppendWindowUpdate(&output_, 0, kReceiveWindow - kDefaultWindow);
+  return SendAll(output_, deadline);
+}
+
+bool V2rayStatsClient::SendAll(const std::string& data, int64_t deadline) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    auto n = ::send(socket_, data.data() + sent,
+                    static_cast<int>(data.size() - sent), kSendFlags);
+    if (n > 0) {
+      sent += static_cast<size_t>(n);
+      continue;
+    }
+    int error = LastSocketError();
+    if (!IsInProgressError(error)) {
+      return Fail("send: " + SocketErrorString(error));
+    }
+    if (PollSocket(socket_, true, RemainingMs(deadline)) <= 0) {
+      return Fail("send: timed out");
+    }
+  }
+  return true;
+}
+
+bool V2rayStatsClient::ReadFrame(Frame* frame, int64_t deadline) {
+  // 上一帧的负载到此失效
+  if (input_offset_ > 0) {
+    input_.erase(0, input_offset_);
+    input_offset_ = 0;
+  }
+  size_t needed = kFrameHeaderSize;
+  for (;;) {
+    if (input_.size() >= kFrameHeaderSize) {
+      const uint8_t* header = reinterpret_cast<const uint8_t*>(input_.data());
+      const size_t length = (static_cast<size_t>(header[0]) << 16) |
+                            (static_cast<size_t>(header[1]) << 8) | header[2];
+      if (length > kMaxFrameSize) {
+        return Fail("protocol error: frame too large");
+      }
+      needed = kFrameHeaderSize + length;
+      if (input_.size() >= needed) {
+        frame->type = header[3];
+        frame->flags = header[4];
+        frame->stream_id = ReadUint32(header + 5) & 0x7FFFFFFFu;
+        frame->payload = header + kFrameHeaderSize;
+        frame->length = length;
+        input_offset_ = needed;
+        return true;
+      }
+    }
+
+    char buffer[kMaxFrameSize];
+    auto n = ::recv(socket_, buffer, static_cast<int>(sizeof(buffer)), 0);
+    if (n > 0) {
+      input_.append(buffer, static_cast<size_t>(n));
+      continue;
+    }
+    if (n == 0) {
+      return Fail("connection closed by peer");
+    }
+    int error = LastSocketError();
+    if (!IsInProgressError(error)) {
+      return Fail("recv: " + SocketErrorString(error));
+    }
+    if (PollSocket(socket_, false, RemainingMs(deadline)) <= 0) {
+      return Fail("recv: timed out");
+    }
+  }
+}
+
+V2rayStatsClient::Result V2rayStatsClient::Exchange(
+    const std::string& request, int64_t deadline,
+    std::vector<StatsCounter>* out) {
+  const uint32_t stream_id = next_stream_id_;
+  next_stream_id_ += 2;
+
+  output_.clear();
+  // 上一次查询消耗的连接窗口随本次请求一起归还，不单独发包
+  if (pending_window_ > 0) {
+    AppendWindowUpdate(&output_, 0, pending_window_);
+    pending_window_ = 0;
+  }
+  AppendFrameHeader(&output_, headers_block_.size(), kHeaders, kEndHeaders,
+                    stream_id);
+  output_.append(headers_block_);
+  AppendFrameHeader(&output_, 5 + request.size(), kData, kEndStream,
+                    stream_id);
+  output_.push_back(0);  // 未压缩
+  AppendUint32(&output_, static_cast<uint32_t>(request.size()));
+  output_.append(request);
+  if (!SendAll(output_, deadline)) {
+    return Result::kTransportError;
+  }
+
+  message_.clear();
+  uint32_t stream_consumed = 0;
+  bool reset = false;
+  for (bool done = false; !done;) {
+    Frame frame;
+    if (!ReadFrame(&frame, deadline)) {
+      return Result::kTransportError;
+    }
+    const bool ours = frame.stream_id == stream_id;
+    output_.clear();
+    switch (frame.type) {
+      case kData: {
+        const uint8_t* data = frame.payload;
+        size_t length = frame.length;
+        if (frame.flags & kPadded) {
+          if (length == 0 || data[0] >= length) {
+            Fail("protocol error: bad padding");
+            return Result::kTransportError;
+          }
+          length -= 1 + data[0];
+          ++data;
+        }
+        if (ours) {
+          message_.append(reinterpret_cast<const char*>(data), length);
+          done = (frame.flags & kEndStream) != 0;
+          stream_consumed += static_cast<uint32_t>(frame.length);
+          if (!done && stream_consumed >= kReceiveWindow / 2) {
+            AppendWindowUpdate(&output_, stream_id, stream_consumed);
+            stream_consumed = 0;
+          }
+        }
+        pending_window_ += static_cast<uint32_t>(frame.length);
+        if (pending_window_ >= kReceiveWindow / 2) {
+          AppendWindowUpdate(&output_, 0, pending_window_);
+          pending_window_ = 0;
+        }
+        break;
+      }
+      case kHeaders:
+        // 响应头或 trailers；不需要其中的内容
+        done = ours && (frame.flags & kEndStream) != 0;
+        break;
+      case kRstStream:
+        if (ours) {
+          done = true;
+          reset = true;
+        }
+        break;
+      case kSettings:
+        if ((frame.flags & kAck) == 0) {
+          AppendFrameHeader(&output_, 0, kSettings, kAck, 0);
+        }
+        break;
+      case kPing:
+        if ((frame.flags & kAck) == 0 && frame.length == 8) {
+          AppendFrameHeader(&output_, 8, kPing, kAck, 0);
+          output_.append(reinterpret_cast<const char*>(frame.payload), 8);
+        }
+        break;
+      case kGoAway:
+        going_away_ = true;
+        if (frame.length >= 4 &&
+            (ReadUint32(frame.payload) & 0x7FFFFFFFu) < stream_id) {
+          // 对端不会处理这个流，可以安全地在新连接上重试
+          Fail("connection going away");
+          return Result::kTransportError;
+        }
+        break;
+      default:
+        // PRIORITY、WINDOW_UPDATE、CONTINUATION 等，请求很小，不需要处理
+        break;
+    }
+    if (!output_.empty() && !SendAll(output_, deadline)) {
+      return Result::kTransportError;
+    }
+  }
+
+  if (reset) {
+    last_error_ = "stream reset by peer";
+    return Result::kCallError;
+  }
+  // gRPC 长度前缀消息
+  const uint8_t* cursor = reinterpret_cast<const uint8_t*>(message_.data());
+  const uint8_t* end = cursor + message_.size();
+  if (cursor == end) {
+    // trailers-only 响应，grpc-status 非 0
+    last_error_ = "call failed without response message";
+    return Result::kCallError;
+  }
+  while (cursor < end) {
+    if (end - cursor < 5 || cursor[0] != 0) {
+      last_error_ = "malformed or compressed gRPC message";
+      return Result::kCallError;
+    }
+    const uint32_t length = ReadUint32(cursor + 1);
+    cursor += 5;
+    if (length > static_cast<uint32_t>(end - cursor) ||
+        !DecodeQueryStatsResponse(cursor, length, out)) {
+      last_error_ = "malformed QueryStatsResponse";
+      return Result::kCallError;
+    }
+    cursor += length;
+  }
+  return Result::kOk;
+}
+
+}  // namespace cfvpn
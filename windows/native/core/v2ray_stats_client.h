@@ -0,0 +1,103 @@
+#ifndef NATIVE_CORE_V2RAY_STATS_CLIENT_H_
+#define NATIVE_CORE_V2RAY_STATS_CLIENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/socket_util.h"
+
+namespace cfvpn {
+
+struct V2rayStatsOptions {
+  uint32_t ip = 0x7F000001;  // 主机字节序
+  uint16_t port = 10085;     // 与 AppConfig.v2rayApiPort 一致
+  int timeout_ms = 1000;     // 单次查询（含必要的重连）的总超时
+  // gRPC 服务名，v2ray 4.x 为 v2ray.core.app.stats.command.StatsService
+  std::string service = "v2ray.core.app.stats.command.StatsService";
+};
+
+struct StatsCounter {
+  std::string name;
+  int64_t value = 0;
+};
+
+// v2ray api 入站的 StatsService 客户端。
+//
+// 通过一条长期保持的 HTTP/2 明文连接（h2c，prior knowledge）直接发送
+// gRPC 请求，替代每次统计都启动 v2ctl 进程。连接断开（v2ray 重启等）后
+// 在下一次查询时自动重连。
+//
+// 只实现查询统计所需的最小 HTTP/2 子集：请求头用不带索引的 HPACK 字面量
+// 编码，不需要维护动态表；响应头和 trailers 不解码，只根据是否收到
+// gRPC 消息判断成败（v2ray 出错时返回不带消息体的 trailers-only 响应）。
+//
+// 非线程安全；同步阻塞调用，回环地址上一次查询通常不到 1ms。
+class V2rayStatsClient {
+ public:
+  explicit V2rayStatsClient(const V2rayStatsOptions& options);
+  ~V2rayStatsClient();
+
+  V2rayStatsClient(const V2rayStatsClient&) = delete;
+  V2rayStatsClient& operator=(const V2rayStatsClient&) = delete;
+
+  // StatsService.QueryStats：返回名称包含 pattern 的计数器。
+  // reset 为 true 时查询后清零。失败时返回 false，原因见 last_error()。
+  bool QueryStats(const std::string& pattern, bool reset,
+                  std::vector<StatsCounter>* out);
+
+  // 关闭当前连接
+  void Close();
+
+  bool connected() const { return socket_ != kInvalidSocket; }
+
+  // 累计建立的连接数，用于测试连接复用
+  int connections() const { return connections_; }
+
+  const std::string& last_error() const { return last_error_; }
+
+ private:
+  // 传输层错误时连接已关闭，可以重连重试；调用错误时连接仍然可用
+  enum class Result { kOk, kTransportError, kCallError };
+
+  struct Frame {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t stream_id;
+    const uint8_t* payload;
+    size_t length;
+  };
+
+  bool Connect(int64_t deadline);
+  Result Exchange(const std::string& request, int64_t deadline,
+                  std::vector<StatsCounter>* out);
+  bool SendAll(const std::string& data, int64_t deadline);
+  bool ReadFrame(Frame* frame, int64_t deadline);
+  bool Fail(const std::string& error);
+
+  V2rayStatsOptions options_;
+  NativeSocket socket_ = kInvalidSocket;
+  uint32_t next_stream_id_ = 1;
+  bool going_away_ = false;
+  int connections_ = 0;
+  std::string headers_block_;  // 每个连接固定的 HPACK 请求头
+  std::string input_;          // 接收缓冲，input_offset_ 之前的已处理
+  size_t input_offset_ = 0;
+  uint32_t pending_window_ = 0;  // 已消耗、尚未归还的连接窗口
+  std::string output_;
+  std::string message_;        // 当前流的 DATA 负载
+  std::string last_error_;
+};
+
+// gRPC/protobuf 编解码，供测试中的模拟服务器复用
+std::string EncodeQueryStatsRequest(const std::string& pattern, bool reset);
+bool DecodeQueryStatsRequest(const uint8_t* data, size_t size,
+                             std::string* pattern, bool* reset);
+std::string EncodeQueryStatsResponse(const std::vector<StatsCounter>& stats);
+bool DecodeQueryStatsResponse(const uint8_t* data, size_t size,
+                              std::vector<StatsCounter>* out);
+
+}  // namespace cfvpn
+
+#endif  // NATIVE_CORE_V2RAY_STATS_CLIENT_H_
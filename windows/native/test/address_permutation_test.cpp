@@ -0,0 +1,192 @@
+#include "core/address_permutation.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/native_api.h"
+
+namespace cfvpn {
+namespace {
+
+IpAddress Address(const char* text) {
+  IpAddress address;
+  EXPECT_TRUE(ParseIpAddress(text, &address)) << text;
+  return address;
+}
+
+std::vector<IpPrefix> Prefixes(const char* text) {
+  std::vector<IpPrefix> prefixes;
+  EXPECT_EQ(ParseIpPrefixList(text, &prefixes), 0u);
+  return prefixes;
+}
+
+TEST(IpAddressTest, ParsesAndFormatsBothFamilies) {
+  IpAddress address = Address("104.16.0.1");
+  EXPECT_FALSE(address.v6);
+  EXPECT_EQ(address.v4(), 0x68100001u);
+  EXPECT_EQ(FormatIpAddress(address), "104.16.0.1");
+
+  address = Address("2606:4700:0:0:0:0:6810:85e5");
+  EXPECT_TRUE(address.v6);
+  EXPECT_EQ(address.value.hi, 0x2606470000000000ull);
+  EXPECT_EQ(address.value.lo, 0x00000000681085E5ull);
+  EXPECT_EQ(FormatIpAddress(address), "2606:4700::6810:85e5");
+
+  EXPECT_EQ(FormatIpAddress(Address("::")), "::");
+  EXPECT_EQ(FormatIpAddress(Address("::1")), "::1");
+  EXPECT_EQ(FormatIpAddress(Address("2400:CB00::")), "2400:cb00::");
+  // 只有一个零组时不压缩；相同长度取第一段
+  EXPECT_EQ(FormatIpAddress(Address("1:0:2:3:4:5:6:7")), "1:0:2:3:4:5:6:7");
+  EXPECT_EQ(FormatIpAddress(Address("1:0:0:2:0:0:3:4")), "1::2:0:0:3:4");
+  EXPECT_EQ(Address("::ffff:1.2.3.4").value.lo, 0x0000FFFF01020304ull);
+
+  IpAddress ignored;
+  for (const char* bad : {"", ":", ":::", "1::2::3", "1:2:3:4:5:6:7:8:9",
+                          "12345::", "1:2:3:4:5:6:7", "g::", "1:", "::1.2.3",
+                          "1.2.3.256"}) {
+    EXPECT_FALSE(ParseIpAddress(bad, &ignored)) << bad;
+  }
+}
+
+TEST(IpAddressTest, ParsesPrefixesAndAlignsHostBits) {
+  IpPrefix prefix;
+  ASSERT_TRUE(ParseIpPrefix("2606:4700:1234::5/32", &prefix));
+  EXPECT_EQ(FormatIpAddress(prefix.base), "2606:4700::");
+  EXPECT_EQ(prefix.length, 32);
+  EXPECT_EQ(prefix.size(), Uint128::Make(0, 1) << 96);
+  EXPECT_TRUE(prefix.Contains(Address("2606:4700:ffff::1")));
+  EXPECT_FALSE(prefix.Contains(Address("2606:4701::")));
+  EXPECT_FALSE(prefix.Contains(Address("38.6.71.0")));
+
+  ASSERT_TRUE(ParseIpPrefix("104.16.3.7/12", &prefix));
+  EXPECT_EQ(prefix.base.v4(), 0x68100000u);
+  EXPECT_EQ(prefix.size(), Uint128::Make(0, 1u << 20));
+
+  ASSERT_TRUE(ParseIpPrefix("::/0", &prefix));
+  EXPECT_EQ(prefix.size(), Uint128::LowMask(128));
+
+  std::vector<IpPrefix> prefixes;
+  EXPECT_EQ(ParseIpPrefixList("1.1.1.0/24,\n2a06:98c0::/29 x/1 ::/129 1.2.3.4/",
+                              &prefixes),
+            3u);
+  EXPECT_EQ(prefixes.size(), 2u);
+}
+
+// 小空间上逐个检查：排列是 [0, N) 上的双射，跨越多个不相邻的前缀
+TEST(AddressPermutationTest, IsBijectionOnSmallDomain) {
+  for (const char* text : {"10.0.0.0/32", "10.0.0.0/31", "10.0.0.0/30",
+                           "10.0.0.0/29, 10.0.1.0/30, 10.0.2.7/32",
+                           "10.0.0.0/23, fd00::/120"}) {
+    AddressPermutation permutation(Prefixes(text), 42);
+    const uint64_t size = permutation.size().lo;
+    std::set<std::pair<bool, Uint128>> seen;
+    for (uint64_t i = 0; i < size; ++i) {
+      const IpAddress address = permutation.At(Uint128::Make(0, i));
+      bool inside = false;
+      for (const IpPrefix& prefix : permutation.prefixes()) {
+        inside = inside || prefix.Contains(address);
+      }
+      EXPECT_TRUE(inside) << FormatIpAddress(address);
+      EXPECT_TRUE(seen.insert({address.v6, address.value}).second)
+          << text << " " << FormatIpAddress(address);
+    }
+    EXPECT_EQ(seen.size(), size) << text;
+  }
+}
+
+TEST(AddressPermutationTest, DropsNestedPrefixes) {
+  AddressPermutation permutation(
+      Prefixes("2606:4700::/32 2606:4700:10::/48 1.1.1.0/24 1.1.1.128/25 "
+               "1.1.1.0/24"),
+      1);
+  ASSERT_EQ(permutation.prefixes().size(), 2u);
+  EXPECT_FALSE(permutation.prefixes()[0].base.v6);
+  EXPECT_EQ(permutation.size(),
+            (Uint128::Make(0, 1) << 96) + Uint128::Make(0, 256));
+}
+
+TEST(AddressPermutationTest, SameSeedSameSequence) {
+  const std::vector<IpPrefix> prefixes =
+      Prefixes("104.16.0.0/12, 2606:4700::/32, 2400:cb00::/32");
+  AddressPermutation a(prefixes, 7);
+  AddressPermutation b(prefixes, 7);
+  AddressPermutation c(prefixes, 8);
+  int differ = 0;
+  IpAddress x, y, z;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(a.Next(&x));
+    ASSERT_TRUE(b.Next(&y));
+    ASSERT_TRUE(c.Next(&z));
+    EXPECT_EQ(x, y);
+    if (x != z) ++differ;
+  }
+  EXPECT_GT(differ, 990);
+  EXPECT_EQ(a.position(), Uint128::Make(0, 1000));
+}
+
+// IPv6 /32 上的样本不重复、不越界，并且分散在整个前缀中
+TEST(AddressPermutationTest, SamplesLargeIpv6PrefixWithoutRepeats) {
+  const std::vector<IpPrefix> prefixes = Prefixes("2606:4700::/32");
+  AddressPermutation permutation(prefixes, 2024);
+  std::set<Uint128> seen;
+  std::set<uint64_t> top_bits;
+  IpAddress address;
+  for (int i = 0; i < 20000; ++i) {
+    ASSERT_TRUE(permutation.Next(&address));
+    ASSERT_TRUE(address.v6);
+    ASSERT_TRUE(prefixes[0].Contains(address)) << FormatIpAddress(address);
+    EXPECT_TRUE(seen.insert(address.value).second);
+    top_bits.insert((address.value.hi >> 24) & 0xFF);  // 主机部分的最高字节
+  }
+  EXPECT_GT(top_bits.size(), 250u);
+}
+
+// 混合集合中每个地址恰好取出一次；IPv4 /24 中跳过 .0 和 .255，
+// 取完后 Next 返回 false
+TEST(AddressPermutationTest, MixedSetIsExhaustedOnce) {
+  AddressPermutation permutation(Prefixes("192.0.2.0/24, 2001:db8::/120"), 5);
+  std::set<std::pair<bool, Uint128>> seen;
+  int v4 = 0;
+  IpAddress address;
+  while (permutation.Next(&address)) {
+    EXPECT_TRUE(seen.insert({address.v6, address.value}).second);
+    if (!address.v6) {
+      ++v4;
+      const uint32_t host = address.v4() & 0xFF;
+      EXPECT_NE(host, 0u);
+      EXPECT_NE(host, 255u);
+    }
+  }
+  EXPECT_EQ(v4, 254);
+  EXPECT_EQ(seen.size(), 254u + 256u);
+  EXPECT_FALSE(permutation.Next(&address));
+}
+
+TEST(AddressPermutationTest, CApiSamplesAddresses) {
+  int32_t invalid = -1;
+  CfvpnAddressSampler* sampler = cfvpn_address_sampler_create(
+      "2606:4700::/32, 104.16.0.0/13, nope", 3, &invalid);
+  ASSERT_NE(sampler, nullptr);
+  EXPECT_EQ(invalid, 1);
+
+  std::vector<CfvpnIpAddress> out(512);
+  ASSERT_EQ(cfvpn_address_sampler_next(sampler, out.data(), 512), 512);
+  const IpPrefix v4 = Prefixes("104.16.0.0/13")[0];
+  const IpPrefix v6 = Prefixes("2606:4700::/32")[0];
+  for (const CfvpnIpAddress& item : out) {
+    ASSERT_TRUE(item.family == 4 || item.family == 6);
+    const IpAddress address = IpAddressFromBytes(item.bytes, item.family == 6);
+    EXPECT_TRUE(item.family == 6 ? v6.Contains(address) : v4.Contains(address))
+        << FormatIpAddress(address);
+  }
+  cfvpn_address_sampler_free(sampler);
+  EXPECT_EQ(cfvpn_address_sampler_create("x", 0, nullptr), nullptr);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,111 @@
+#include "core/aimd_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace cfvpn {
+namespace {
+
+AimdOptions SmallOptions() {
+  AimdOptions options;
+  options.min_window = 4;
+  options.max_window = 64;
+  options.initial_window = 8;
+  return options;
+}
+
+TEST(AimdControllerTest, ClampsInitialWindow) {
+  AimdOptions options = SmallOptions();
+  options.initial_window = 1000;
+  EXPECT_EQ(AimdController(options).window(), 64);
+  options.initial_window = 0;
+  EXPECT_EQ(AimdController(options).window(), 4);
+}
+
+TEST(AimdControllerTest, SlowStartGrowsUntilMaximum) {
+  AimdController aimd(SmallOptions());
+  for (int i = 0; i < 8; ++i) {
+    aimd.OnSuccess();
+  }
+  EXPECT_EQ(aimd.window(), 16);
+  EXPECT_TRUE(aimd.slow_start());
+  for (int i = 0; i < 100; ++i) {
+    aimd.OnSuccess();
+  }
+  EXPECT_EQ(aimd.window(), 64);
+}
+
+TEST(AimdControllerTest, LocalErrorHalvesWindowOncePerHalfRound) {
+  AimdController aimd(SmallOptions());
+  for (int i = 0; i < 24; ++i) {
+    aimd.OnSuccess();
+  }
+  ASSERT_EQ(aimd.window(), 32);
+
+  aimd.OnLocalError();
+  EXPECT_EQ(aimd.window(), 16);
+  EXPECT_FALSE(aimd.slow_start());
+  // 同一波错误不会继续收缩
+  aimd.OnLocalError();
+  aimd.OnLocalError();
+  EXPECT_EQ(aimd.window(), 16);
+  EXPECT_EQ(aimd.decreases(), 1);
+
+  for (int i = 0; i < 8; ++i) {
+    aimd.OnFailure();
+  }
+  aimd.OnLocalError();
+  EXPECT_EQ(aimd.window(), 8);
+}
+
+TEST(AimdControllerTest, AdditiveIncreaseAfterDecrease) {
+  AimdController aimd(SmallOptions());
+  for (int i = 0; i < 8; ++i) {
+    aimd.OnSuccess();
+  }
+  aimd.OnLocalError();
+  ASSERT_EQ(aimd.window(), 8);
+  // 拥塞避免阶段每轮（一个窗口的成功）只加一
+  for (int i = 0; i < 8; ++i) {
+    aimd.OnSuccess();
+  }
+  EXPECT_EQ(aimd.window(), 8);
+  aimd.OnSuccess();
+  EXPECT_EQ(aimd.window(), 9);
+}
+
+TEST(AimdControllerTest, HighTimeoutRatioShrinksWindow) {
+  AimdController aimd(SmallOptions());
+  // 一轮 8 个里 6 个超时
+  for (int i = 0; i < 6; ++i) {
+    aimd.OnTimeout();
+  }
+  aimd.OnFailure();
+  aimd.OnFailure();
+  EXPECT_EQ(aimd.decreases(), 1);
+  EXPECT_LT(aimd.window(), 8);
+}
+
+TEST(AimdControllerTest, OccasionalTimeoutsDoNotShrink) {
+  AimdController aimd(SmallOptions());
+  for (int round = 0; round < 20; ++round) {
+    aimd.OnTimeout();
+    aimd.OnFailure();
+    for (int i = 0; i < 6; ++i) {
+      aimd.OnSuccess();
+    }
+  }
+  EXPECT_EQ(aimd.decreases(), 0);
+  EXPECT_EQ(aimd.window(), 64);
+}
+
+TEST(AimdControllerTest, NeverDropsBelowMinimum) {
+  AimdController aimd(SmallOptions());
+  for (int i = 0; i < 1000; ++i) {
+    aimd.OnTimeout();
+    aimd.OnLocalError();
+  }
+  EXPECT_EQ(aimd.window(), 4);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,298 @@
+#include "core/async_logger.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+
+namespace cfvpn {
+namespace {
+
+namespace fs = std::filesystem;
+
+class AsyncLoggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = fs::path(::testing::TempDir()) /
+                 (std::string("async_logger_") +
+                  ::testing::UnitTest::GetInstance()
+                      ->current_test_info()
+                      ->name());
+    fs::remove_all(directory_);
+    fs::create_directories(directory_);
+  }
+
+  void TearDown() override { fs::remove_all(directory_); }
+
+  AsyncLoggerOptions Options() const {
+    AsyncLoggerOptions options;
+    options.directory = directory_.string();
+    return options;
+  }
+
+  static std::string Today() {
+    const std::time_t now = std::time(nullptr);
+    std::tm tm = {};
+    localtime_r(&now, &tm);
+    char date[16];
+    std::strftime(date, sizeof(date), "%Y%m%d", &tm);
+    return date;
+  }
+
+  std::string Read(const std::string& name) const {
+    std::ifstream file(directory_ / name, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  // 去掉会话分隔符后的日志行
+  std::vector<std::string> Lines(const std::string& name) const {
+    std::vector<std::string> lines;
+    std::istringstream content(Read(name));
+    std::string line;
+    while (std::getline(content, line)) {
+      if (!line.empty() && line[0] == '[') lines.push_back(line);
+    }
+    return lines;
+  }
+
+  std::vector<std::string> Files() const {
+    std::vector<std::string> names;
+    for (const auto& entry : fs::directory_iterator(directory_)) {
+      names.push_back(entry.path().filename().string());
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+
+  fs::path directory_;
+};
+
+TEST_F(AsyncLoggerTest, WritesFormattedLinesPerTag) {
+  AsyncLogger logger(Options());
+  logger.Start();
+  EXPECT_TRUE(logger.Write(LogLevel::kInfo, "CloudflareTest", "开始测试"));
+  EXPECT_TRUE(logger.Write(LogLevel::kError, "v2ray/core", "连接失败"));
+  EXPECT_TRUE(logger.Write(LogLevel::kDebug, "CloudflareTest", ""));
+  logger.Flush();
+
+  const std::string today = Today();
+  const std::string content = Read("CloudflareTest_" + today + ".log");
+  EXPECT_NE(content.find("=== 日志会话开始 ==="), std::string::npos);
+  EXPECT_NE(content.find("日志标签: CloudflareTest"), std::string::npos);
+
+  const std::vector<std::string> lines = Lines("CloudflareTest_" + today + ".log");
+  ASSERT_EQ(lines.size(), 2u);
+  // [2024-01-02T03:04:05.123456] [INFO] 开始测试
+  EXPECT_EQ(lines[0].size(), 28 + std::string(" [INFO] 开始测试").size());
+  EXPECT_EQ(lines[0][11], 'T');
+  EXPECT_EQ(lines[0][20], '.');
+  EXPECT_EQ(lines[0].substr(27), "] [INFO] 开始测试");
+  EXPECT_EQ(lines[1].substr(27), "] [DEBUG] ");
+
+  // tag 中的非单词字符替换为下划线
+  const std::vector<std::string> errors = Lines("v2ray_core_" + today + ".log");
+  ASSERT_EQ(errors.size(), 1u);
+  EXPECT_EQ(errors[0].substr(27), "] [ERROR] 连接失败");
+}
+
+TEST_F(AsyncLoggerTest, LongMessagesSpanRecordsAndAreTruncated) {
+  AsyncLogger logger(Options());
+  logger.Start();
+  std::string stack;
+  for (int i = 0; i < 100; ++i) stack += "#" + std::to_string(i) + " frame\n";
+  ASSERT_GT(stack.size(), AsyncLogger::kTextBytes * 3);
+  logger.Write(LogLevel::kError, "app", stack);
+  logger.Write(LogLevel::kInfo, "app",
+               std::string(AsyncLogger::kMaxMessageBytes + 500, 'x'));
+  logger.Write(LogLevel::kInfo, "app", "after");
+  logger.Flush();
+
+  const std::string content = Read("app_" + Today() + ".log");
+  EXPECT_NE(content.find("[ERROR] " + stack + "\n"), std::string::npos);
+  EXPECT_NE(content.find(
+                "] [INFO] " + std::string(AsyncLogger::kMaxMessageBytes, 'x') +
+                "\n["),
+            std::string::npos);
+  EXPECT_NE(content.find("] [INFO] after\n"), std::string::npos);
+}
+
+TEST_F(AsyncLoggerTest, ConcurrentProducersKeepPerThreadOrder) {
+  AsyncLoggerOptions options = Options();
+  options.queue_records = 1024;
+  AsyncLogger logger(options);
+  logger.Start();
+
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 5000;
+  std::vector<std::thread> producers;
+  for (int t = 0; t < kThreads; ++t) {
+    producers.emplace_back([&logger, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        // 偶尔写一条跨记录的长消息
+        std::string message = std::to_string(t) + ":" + std::to_string(i);
+        if (i % 97 == 0) message += " " + std::string(450, 'p');
+        logger.Write(LogLevel::kDebug, "scan", message);
+      }
+    });
+  }
+  for (std::thread& producer : producers) producer.join();
+  logger.Flush();
+
+  const std::vector<std::string> lines = Lines("scan_" + Today() + ".log");
+  EXPECT_EQ(lines.size() + logger.dropped(),
+            static_cast<size_t>(kThreads * kPerThread));
+  std::map<int, int> last;
+  for (const std::string& line : lines) {
+    const size_t start = line.find("] [DEBUG] ");
+    ASSERT_NE(start, std::string::npos) << line;
+    const std::string message = line.substr(start + 10);
+    const int thread = std::stoi(message);
+    const int index = std::stoi(message.substr(message.find(':') + 1));
+    if (index % 97 == 0) {
+      EXPECT_EQ(message.size(), message.find(' ') + 451) << "torn long message";
+    }
+    auto it = last.find(thread);
+    if (it != last.end()) {
+      EXPECT_GT(index, it->second);
+    }
+    last[thread] = index;
+  }
+}
+
+TEST_F(AsyncLoggerTest, DropsWhenQueueFullWithoutBlocking) {
+  AsyncLoggerOptions options = Options();
+  options.queue_records = 64;
+  AsyncLogger logger(options);  // 未启动写线程，队列不会被消费
+  int accepted = 0;
+  for (int i = 0; i < 100; ++i) {
+    if (logger.Write(LogLevel::kInfo, "app", std::to_string(i))) ++accepted;
+  }
+  EXPECT_EQ(accepted, 64);
+  EXPECT_EQ(logger.dropped(), 36u);
+
+  // 消费后空出的槽位可以继续写入
+  logger.Flush();
+  EXPECT_TRUE(logger.Write(LogLevel::kInfo, "app", "again"));
+  logger.Stop();
+  const std::vector<std::string> lines = Lines("app_" + Today() + ".log");
+  ASSERT_EQ(lines.size(), 65u);
+  EXPECT_EQ(lines[63].substr(27), "] [INFO] 63");
+  EXPECT_EQ(lines[64].substr(27), "] [INFO] again");
+}
+
+TEST_F(AsyncLoggerTest, RotatesBySizeKeepingBackups) {
+  AsyncLoggerOptions options = Options();
+  options.max_file_bytes = 2048;
+  options.max_backups = 2;
+  AsyncLogger logger(options);
+  logger.Start();
+  for (int i = 0; i < 200; ++i) {
+    logger.Write(LogLevel::kInfo, "big", "line " + std::to_string(i));
+  }
+  logger.Stop();
+
+  const std::string today = Today();
+  const std::vector<std::string> expected = {"big_" + today + ".1.log",
+                                             "big_" + today + ".2.log",
+                                             "big_" + today + ".log"};
+  EXPECT_EQ(Files(), expected);
+  for (const std::string& name : expected) {
+    EXPECT_LE(fs::file_size(directory_ / name), 2048u) << name;
+  }
+  const std::vector<std::string> current = Lines("big_" + today + ".log");
+  ASSERT_FALSE(current.empty());
+  EXPECT_EQ(current.back().substr(27), "] [INFO] line 199");
+}
+
+TEST_F(AsyncLoggerTest, RotatesByDate) {
+  AsyncLogger logger(Options());
+  logger.Start();
+  // 两个 UTC 正午相隔两天，在任何时区都是不同的本地日期
+  const int64_t day1 = 1700049600LL * 1000000;  // 2023-11-15 12:00 UTC
+  const int64_t day3 = day1 + 2 * 86400LL * 1000000;
+  logger.WriteAt(day1, LogLevel::kInfo, "app", "old");
+  logger.WriteAt(day3, LogLevel::kInfo, "app", "new");
+  logger.Stop();
+
+  const std::vector<std::string> files = Files();
+  ASSERT_EQ(files.size(), 2u);
+  EXPECT_EQ(Lines(files[0]).size(), 1u);
+  EXPECT_EQ(Lines(files[0])[0].substr(27), "] [INFO] old");
+  EXPECT_EQ(Lines(files[1])[0].substr(27), "] [INFO] new");
+}
+
+TEST_F(AsyncLoggerTest, CloseFilesAllowsDeletion) {
+  AsyncLoggerOptions options = Options();
+  options.max_open_files = 1;
+  AsyncLogger logger(options);
+  logger.Start();
+  logger.Write(LogLevel::kInfo, "a", "1");
+  logger.Write(LogLevel::kInfo, "b", "2");  // 关闭 a 再打开 b
+  logger.Write(LogLevel::kInfo, "a", "3");
+  logger.CloseFiles();
+  EXPECT_EQ(Lines("a_" + Today() + ".log").size(), 2u);
+
+  fs::remove_all(directory_);
+  fs::create_directories(directory_);
+  logger.Write(LogLevel::kInfo, "a", "4");
+  logger.Flush();
+  const std::vector<std::string> lines = Lines("a_" + Today() + ".log");
+  ASSERT_EQ(lines.size(), 1u);
+  EXPECT_EQ(lines[0].substr(27), "] [INFO] 4");
+}
+
+TEST_F(AsyncLoggerTest, FlushesQueuedRecordsOnExit) {
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  AsyncLoggerOptions options = Options();
+  options.flush_interval_ms = 60000;  // 写线程不会主动落盘
+  EXPECT_EXIT(
+      {
+        AsyncLogger* logger = new AsyncLogger(options);
+        logger->Start();
+        SetDefaultLogger(logger);
+        LogMessage(LogLevel::kInfo, "exit", "before exit");
+        std::exit(3);
+      },
+      ::testing::ExitedWithCode(3), "");
+  const std::vector<std::string> lines = Lines("exit_" + Today() + ".log");
+  ASSERT_EQ(lines.size(), 1u);
+  EXPECT_EQ(lines[0].substr(27), "] [INFO] before exit");
+}
+
+TEST_F(AsyncLoggerTest, NativeApiRoundTrip) {
+  CfvpnLogger* logger =
+      cfvpn_log_open(directory_.string().c_str(), 0, 0, 0, 0);
+  ASSERT_NE(logger, nullptr);
+  EXPECT_EQ(DefaultLogger() != nullptr, true);
+  const std::string message = "节点 1.1.1.1 延迟 120ms";
+  EXPECT_EQ(cfvpn_log_write(logger, CFVPN_LOG_WARN, "NativeCore", 10,
+                            message.data(),
+                            static_cast<int32_t>(message.size())),
+            1);
+  // 原生代码通过默认日志器写入同一组文件
+  LogMessage(LogLevel::kDebug, "NativeCore", "from c++");
+  cfvpn_log_flush(logger);
+  EXPECT_EQ(cfvpn_log_dropped(logger), 0);
+  cfvpn_log_close(logger);
+  EXPECT_EQ(DefaultLogger(), nullptr);
+
+  const std::vector<std::string> lines = Lines("NativeCore_" + Today() + ".log");
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[0].substr(27), "] [WARN] " + message);
+  EXPECT_EQ(lines[1].substr(27), "] [DEBUG] from c++");
+}
+
+}  // namespace
+}  // namespace cfvpn
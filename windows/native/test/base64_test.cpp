@@ -0,0 +1,106 @@
+#include "core/base64.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+namespace cfvpn {
+namespace {
+
+std::string Encode(const std::string& data, bool url_safe, bool pad) {
+  const char* alphabet =
+      url_safe
+          ? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+          : "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  size_t i = 0;
+  for (; i + 3 <= data.size(); i += 3) {
+    const uint32_t x = static_cast<uint8_t>(data[i]) << 16 |
+                       static_cast<uint8_t>(data[i + 1]) << 8 |
+                       static_cast<uint8_t>(data[i + 2]);
+    for (int shift = 18; shift >= 0; shift -= 6) out.push_back(alphabet[x >> shift & 63]);
+  }
+  if (i + 1 == data.size()) {
+    const uint32_t x = static_cast<uint8_t>(data[i]) << 16;
+    out.push_back(alphabet[x >> 18 & 63]);
+    out.push_back(alphabet[x >> 12 & 63]);
+    if (pad) out += "==";
+  } else if (i + 2 == data.size()) {
+    const uint32_t x = static_cast<uint8_t>(data[i]) << 16 |
+                       static_cast<uint8_t>(data[i + 1]) << 8;
+    out.push_back(alphabet[x >> 18 & 63]);
+    out.push_back(alphabet[x >> 12 & 63]);
+    out.push_back(alphabet[x >> 6 & 63]);
+    if (pad) out += "=";
+  }
+  return out;
+}
+
+std::string Decode(const std::string& text, bool* ok) {
+  std::string out;
+  *ok = Base64Decode(text, &out);
+  return out;
+}
+
+TEST(Base64Test, DecodesKnownVectors) {
+  bool ok = false;
+  EXPECT_EQ(Decode("", &ok), "");
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(Decode("Zg==", &ok), "f");
+  EXPECT_EQ(Decode("Zm8=", &ok), "fo");
+  EXPECT_EQ(Decode("Zm9v", &ok), "foo");
+  EXPECT_EQ(Decode("Zm9vYmFy", &ok), "foobar");
+  // 省略填充
+  EXPECT_EQ(Decode("Zm9vYg", &ok), "foob");
+  EXPECT_TRUE(ok);
+  // 换行和空白
+  EXPECT_EQ(Decode("Zm9v\r\nYmFy\n", &ok), "foobar");
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(Decode(" Zm 9v Yg = = ", &ok), "foob");
+  EXPECT_TRUE(ok);
+}
+
+TEST(Base64Test, RoundTripsRandomDataInBothAlphabets) {
+  std::mt19937 random(3);
+  for (int size = 0; size < 300; ++size) {
+    std::string data(static_cast<size_t>(size), '\0');
+    for (char& c : data) c = static_cast<char>(random());
+    for (bool url_safe : {false, true}) {
+      for (bool pad : {false, true}) {
+        bool ok = false;
+        EXPECT_EQ(Decode(Encode(data, url_safe, pad), &ok), data);
+        EXPECT_TRUE(ok);
+      }
+    }
+    // 每 76 列换行
+    std::string wrapped = Encode(data, false, true);
+    for (size_t i = 76; i < wrapped.size(); i += 78) wrapped.insert(i, "\r\n");
+    bool ok = false;
+    EXPECT_EQ(Decode(wrapped, &ok), data);
+    EXPECT_TRUE(ok);
+  }
+}
+
+TEST(Base64Test, RejectsInvalidInput) {
+  bool ok = true;
+  for (const char* text : {"Z", "Zm9vY", "Zm9v!", "Zm=9v", "Zm9v====Zg", "é"}) {
+    Decode(text, &ok);
+    EXPECT_FALSE(ok) << text;
+  }
+  std::string out = "prefix";
+  EXPECT_TRUE(Base64Decode("Zm9v", &out));
+  EXPECT_EQ(out, "prefixfoo");
+  // 失败时不留下部分输出
+  EXPECT_FALSE(Base64Decode("Zm9vYmFy!", &out));
+  EXPECT_EQ(out, "prefixfoo");
+}
+
+TEST(Base64Test, DetectsBase64Text) {
+  EXPECT_TRUE(LooksLikeBase64("Zm9v\nYmFy=="));
+  EXPECT_FALSE(LooksLikeBase64("vmess://abc"));
+  EXPECT_FALSE(LooksLikeBase64("  \n"));
+}
+
+}  // namespace
+}  // namespace cfvpn
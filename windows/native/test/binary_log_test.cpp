@@ -0,0 +1,277 @@
+#include "core/binary_log.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/async_logger.h"
+
+namespace cfvpn {
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr int64_t kBaseTimeUs = 1700000000000000;
+
+class BinaryLogTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = fs::path(::testing::TempDir()) /
+                 (std::string("binary_log_") +
+                  ::testing::UnitTest::GetInstance()
+                      ->current_test_info()
+                      ->name());
+    fs::remove_all(directory_);
+    fs::create_directories(directory_);
+  }
+
+  void TearDown() override { fs::remove_all(directory_); }
+
+  BinaryLogOptions Options() const {
+    BinaryLogOptions options;
+    options.directory = directory_.string();
+    return options;
+  }
+
+  std::vector<std::string> Segments() const {
+    std::vector<std::string> paths;
+    for (const auto& entry : fs::directory_iterator(directory_)) {
+      if (entry.path().extension() == kBinaryLogExtension) {
+        paths.push_back(entry.path().string());
+      }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+  }
+
+  static std::vector<BinaryLogEntry> ReadAll(const std::string& path,
+                                             bool* truncated = nullptr) {
+    std::vector<BinaryLogEntry> entries;
+    BinaryLogReader reader;
+    EXPECT_TRUE(reader.Open(path));
+    BinaryLogEntry entry;
+    while (reader.Next(&entry)) entries.push_back(entry);
+    if (truncated != nullptr) *truncated = reader.truncated();
+    return entries;
+  }
+
+  fs::path directory_;
+};
+
+TEST(SplitLogTemplateTest, ReplacesPlainNumbers) {
+  std::string templ;
+  std::vector<uint64_t> arguments;
+  ASSERT_TRUE(SplitLogTemplate("IP 104.16.0.1 延迟 120ms", &templ, &arguments));
+  EXPECT_EQ(templ, "IP \x01.\x01.\x01.\x01 延迟 \x01ms");
+  EXPECT_EQ(arguments, (std::vector<uint64_t>{104, 16, 0, 1, 120}));
+
+  // 前导 0 和超过 18 位的数字保留原文
+  ASSERT_TRUE(SplitLogTemplate("id 007 x 1234567890123456789", &templ,
+                               &arguments));
+  EXPECT_EQ(templ, "id 007 x 1234567890123456789");
+  EXPECT_TRUE(arguments.empty());
+
+  EXPECT_FALSE(SplitLogTemplate("bad \x01 byte", &templ, &arguments));
+}
+
+TEST_F(BinaryLogTest, RoundTripsRecords) {
+  const std::vector<std::string> messages = {
+      "开始测试 100 个 IP",
+      "IP 104.16.0.1 延迟 120ms",
+      "端口 0443 前导零, 时间 2024-01-02T03:04:05",
+      "大数 999999999999999999 和 12345678901234567890",
+      "多行\n第二行 42\n",
+      "含占位符字节 \x01 的消息",
+      "",
+      "0",
+  };
+  {
+    BinaryLogWriter writer(Options());
+    for (size_t i = 0; i < messages.size(); ++i) {
+      // 时间不一定单调（多线程写入时可能倒退）
+      const int64_t time = kBaseTimeUs + (i % 2 == 0 ? 1000 : -500) * int64_t(i);
+      writer.Append(time, static_cast<LogLevel>(i % 4),
+                    i % 2 == 0 ? "CloudflareTest" : "v2ray", messages[i]);
+    }
+    writer.Close();
+  }
+  const std::vector<std::string> segments = Segments();
+  ASSERT_EQ(segments.size(), 1u);
+  const std::vector<BinaryLogEntry> entries = ReadAll(segments[0]);
+  ASSERT_EQ(entries.size(), messages.size());
+  for (size_t i = 0; i < messages.size(); ++i) {
+    EXPECT_EQ(entries[i].message, messages[i]);
+    EXPECT_EQ(entries[i].tag, i % 2 == 0 ? "CloudflareTest" : "v2ray");
+    EXPECT_EQ(entries[i].level, i % 4);
+    EXPECT_EQ(entries[i].time_us,
+              kBaseTimeUs + (i % 2 == 0 ? 1000 : -500) * int64_t(i));
+  }
+}
+
+TEST_F(BinaryLogTest, CompressesScanLogsAtLeastTenfold) {
+  std::string text;
+  {
+    BinaryLogWriter writer(Options());
+    int64_t time = kBaseTimeUs;
+    for (int i = 0; i < 20000; ++i) {
+      time += 1234 + i % 17;
+      std::string message;
+      switch (i % 3) {
+        case 0:
+          message = "测试 IP: 104." + std::to_string(16 + i % 8) + "." +
+                    std::to_string(i / 256 % 256) + "." +
+                    std::to_string(i % 256) + ":443";
+          break;
+        case 1:
+          message = "TCP 连接成功, 延迟: " + std::to_string(80 + i * 7 % 300) +
+                    "ms, 已完成 " + std::to_string(i) + "/20000";
+          break;
+        default:
+          message = "HTTP 状态码: 200, 下载 " + std::to_string(i * 37 % 65536) +
+                    " 字节";
+          break;
+      }
+      writer.Append(time, LogLevel::kInfo, "CloudflareTest", message);
+      // 与文本日志相同的行格式
+      text += "[2024-01-02T03:04:05.123456] [INFO] " + message + "\n";
+      if (writer.ShouldSeal(time)) writer.Seal();
+    }
+    writer.Close();
+    EXPECT_GT(writer.raw_bytes(), writer.bytes_written());
+  }
+  const std::vector<std::string> segments = Segments();
+  ASSERT_EQ(segments.size(), 1u);
+  const auto size = fs::file_size(segments[0]);
+  EXPECT_GE(text.size(), size * 10)
+      << "text " << text.size() << " bytes, binary " << size << " bytes";
+  EXPECT_EQ(ReadAll(segments[0]).size(), 20000u);
+}
+
+TEST_F(BinaryLogTest, StopsAtTruncatedOrCorruptBlock) {
+  BinaryLogOptions options = Options();
+  options.block_bytes = 256;
+  {
+    BinaryLogWriter writer(options);
+    for (int i = 0; i < 100; ++i) {
+      writer.Append(kBaseTimeUs + i, LogLevel::kInfo, "t",
+                    "记录 " + std::to_string(i) + " 的内容");
+      if (writer.ShouldSeal(kBaseTimeUs + i)) writer.Seal();
+    }
+    writer.Close();
+  }
+  const std::string path = Segments()[0];
+  std::string content;
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+  }
+
+  bool truncated = true;
+  EXPECT_EQ(ReadAll(path, &truncated).size(), 100u);
+  EXPECT_FALSE(truncated);
+
+  // 崩溃时最后一个块只写了一半：之前的块仍可解码
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      << content.substr(0, content.size() - 5);
+  std::vector<BinaryLogEntry> entries = ReadAll(path, &truncated);
+  EXPECT_TRUE(truncated);
+  EXPECT_GT(entries.size(), 0u);
+  EXPECT_LT(entries.size(), 100u);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i].message, "记录 " + std::to_string(i) + " 的内容");
+  }
+
+  // 校验和不符的块
+  std::string corrupt = content;
+  corrupt[corrupt.size() - 3] ^= 0x5A;
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << corrupt;
+  EXPECT_LT(ReadAll(path, &truncated).size(), 100u);
+  EXPECT_TRUE(truncated);
+
+  // 段头无效
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a log";
+  BinaryLogReader reader;
+  EXPECT_FALSE(reader.Open(path));
+}
+
+TEST_F(BinaryLogTest, RotatesAndPrunesSegments) {
+  BinaryLogOptions options = Options();
+  options.max_segment_bytes = 2048;
+  options.max_segments = 3;
+  options.block_bytes = 512;
+  BinaryLogWriter writer(options);
+  std::vector<std::string> paths;
+  std::mt19937 random(1);
+  for (int i = 0; i < 2000; ++i) {
+    // 随机字母，避免一个块就压缩到很小
+    std::string noise(16, 'a');
+    for (char& c : noise) c = static_cast<char>('a' + random() % 26);
+    writer.Append(kBaseTimeUs + i, LogLevel::kWarn, "rotate", "seq " + noise);
+    if (writer.ShouldSeal(kBaseTimeUs + i)) {
+      writer.Seal();
+      if (paths.empty() || paths.back() != writer.segment_path()) {
+        paths.push_back(writer.segment_path());
+      }
+    }
+  }
+  writer.Close();
+  ASSERT_GT(paths.size(), 3u);
+
+  const std::vector<std::string> segments = Segments();
+  ASSERT_EQ(segments.size(), 3u);
+  // 保留的是最新的段，每段都能独立解码
+  EXPECT_EQ(fs::path(segments.back()).filename(),
+            fs::path(paths.back()).filename());
+  for (const std::string& segment : segments) {
+    bool truncated = true;
+    const std::vector<BinaryLogEntry> entries = ReadAll(segment, &truncated);
+    EXPECT_FALSE(truncated);
+    ASSERT_FALSE(entries.empty());
+    EXPECT_EQ(entries[0].tag, "rotate");
+  }
+}
+
+TEST_F(BinaryLogTest, AsyncLoggerWritesBinarySegments) {
+  AsyncLoggerOptions options;
+  options.directory = directory_.string();
+  options.binary = true;
+  AsyncLogger logger(options);
+  logger.Start();
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(logger.Write(i % 10 == 0 ? LogLevel::kError : LogLevel::kInfo,
+                             i % 2 == 0 ? "CloudflareTest" : "v2ray",
+                             "消息 " + std::to_string(i)));
+  }
+  // Flush 返回时块已压缩写出
+  logger.Flush();
+
+  std::vector<std::string> segments = Segments();
+  ASSERT_EQ(segments.size(), 1u);
+  std::vector<BinaryLogEntry> entries = ReadAll(segments[0]);
+  ASSERT_EQ(entries.size(), 1000u);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(entries[i].message, "消息 " + std::to_string(i));
+    EXPECT_EQ(entries[i].tag, i % 2 == 0 ? "CloudflareTest" : "v2ray");
+  }
+
+  EXPECT_TRUE(logger.Write(LogLevel::kDebug, "v2ray", "最后一条"));
+  logger.Stop();
+  entries = ReadAll(Segments()[0]);
+  ASSERT_EQ(entries.size(), 1001u);
+  EXPECT_EQ(entries.back().message, "最后一条");
+  // 二进制模式不写文本文件
+  for (const auto& entry : fs::directory_iterator(directory_)) {
+    EXPECT_EQ(entry.path().extension(), kBinaryLogExtension);
+  }
+}
+
+}  // namespace
+}  // namespace cfvpn
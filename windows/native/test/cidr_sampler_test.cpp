@@ -0,0 +1,176 @@
+#include "core/cidr_sampler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+
+#include "core/native_api.h"
+
+namespace cfvpn {
+namespace {
+
+// 与 AppConfig.cloudflareIpRanges 相同的前几段，足以覆盖各种前缀长度
+const char kCloudflareRanges[] =
+    "173.245.48.0/20, 103.21.244.0/22, 103.22.200.0/22, 103.31.4.0/22,"
+    "141.101.64.0/18, 108.162.192.0/18, 190.93.240.0/20, 188.114.96.0/20,"
+    "197.234.240.0/22, 198.41.128.0/17, 162.158.0.0/15, 104.16.0.0/12,"
+    "172.64.0.0/17, 172.64.229.0/24, 172.65.0.0/16, 131.0.72.0/22";
+
+Ipv4Range Range(uint32_t first, uint32_t last) { return Ipv4Range{first, last}; }
+
+std::vector<Ipv4Range> ParseAll(const char* text) {
+  std::vector<Ipv4Range> ranges;
+  EXPECT_EQ(ParseCidrList(text, &ranges), 0u);
+  return ranges;
+}
+
+TEST(CidrParseTest, ParsesPrefixAndAlignsHostBits) {
+  Ipv4Range range;
+  ASSERT_TRUE(ParseCidr("104.16.3.7/12", 13, &range));
+  EXPECT_EQ(range.first, 0x68100000u);
+  EXPECT_EQ(range.last, 0x681FFFFFu);
+
+  ASSERT_TRUE(ParseCidr(" 1.2.3.4 ", 9, &range));
+  EXPECT_EQ(range.first, 0x01020304u);
+  EXPECT_EQ(range.last, 0x01020304u);
+
+  ASSERT_TRUE(ParseCidr("0.0.0.0/0", 9, &range));
+  EXPECT_EQ(range.first, 0u);
+  EXPECT_EQ(range.last, 0xFFFFFFFFu);
+}
+
+TEST(CidrParseTest, RejectsMalformedEntries) {
+  std::vector<Ipv4Range> ranges;
+  EXPECT_EQ(ParseCidrList("1.2.3.0/24,1.2.3/24 ,1.2.3.4/33\n1.2.3.4/x, "
+                          "256.0.0.0/8,1.2.3.4/,10.0.0.0/8",
+                          &ranges),
+            5u);
+  ASSERT_EQ(ranges.size(), 2u);
+  EXPECT_EQ(ranges[0].first, 0x01020300u);
+  EXPECT_EQ(ranges[1].first, 0x0A000000u);
+}
+
+TEST(Ipv4RangeIndexTest, MergesOverlappingAndAdjacentRanges) {
+  Ipv4RangeIndex index({Range(100, 199), Range(10, 19), Range(20, 29),
+                        Range(150, 250), Range(0xFFFFFF00u, 0xFFFFFFFFu)});
+  EXPECT_EQ(index.ranges().size(), 5u);
+  ASSERT_EQ(index.intervals().size(), 3u);
+  EXPECT_EQ(index.intervals()[0].first, 10u);
+  EXPECT_EQ(index.intervals()[0].last, 29u);
+  EXPECT_EQ(index.intervals()[1].first, 100u);
+  EXPECT_EQ(index.intervals()[1].last, 250u);
+  EXPECT_EQ(index.address_count(), 20u + 151u + 256u);
+}
+
+TEST(Ipv4RangeIndexTest, AddressAtAndOffsetOfAreInverse) {
+  Ipv4RangeIndex index(ParseAll(kCloudflareRanges));
+  for (uint64_t offset = 0; offset < index.address_count(); offset += 997) {
+    const uint32_t ip = index.AddressAt(offset);
+    uint64_t back;
+    ASSERT_TRUE(index.OffsetOf(ip, &back));
+    EXPECT_EQ(back, offset);
+  }
+  EXPECT_EQ(index.AddressAt(index.address_count() - 1),
+            index.intervals().back().last);
+  EXPECT_FALSE(index.Contains(0x08080808u));
+  EXPECT_FALSE(index.Contains(index.intervals().front().first - 1));
+}
+
+TEST(CidrSamplerTest, SamplesDistinctAddressesInsideRanges) {
+  Ipv4RangeIndex index(ParseAll(kCloudflareRanges));
+  CidrSampler sampler(index);
+  std::vector<uint32_t> out(5000);
+  ASSERT_EQ(sampler.Sample(out.size(), 42, out.data()), out.size());
+
+  std::unordered_set<uint32_t> seen;
+  for (uint32_t ip : out) {
+    EXPECT_TRUE(index.Contains(ip));
+    EXPECT_NE(ip & 0xFF, 0u);
+    EXPECT_NE(ip & 0xFF, 255u);
+    EXPECT_TRUE(seen.insert(ip).second);
+  }
+}
+
+TEST(CidrSamplerTest, CoversEverySmallRange) {
+  // 预算足够时，每个段（包括单个 /24）都至少分到一个地址
+  std::vector<Ipv4Range> ranges = ParseAll(kCloudflareRanges);
+  Ipv4RangeIndex index(ranges);
+  CidrSampler sampler(index);
+  std::vector<uint32_t> out(200);
+  ASSERT_EQ(sampler.Sample(out.size(), 7, out.data()), out.size());
+  for (const Ipv4Range& range : ranges) {
+    EXPECT_TRUE(std::any_of(out.begin(), out.end(), [&range](uint32_t ip) {
+      return ip >= range.first && ip <= range.last;
+    })) << range.first;
+  }
+}
+
+TEST(CidrSamplerTest, SameSeedReproducesSample) {
+  Ipv4RangeIndex index(ParseAll(kCloudflareRanges));
+  CidrSampler sampler(index);
+  std::vector<uint32_t> first(1000), second(1000), other(1000);
+  sampler.Sample(first.size(), 123, first.data());
+  sampler.Sample(second.size(), 123, second.data());
+  sampler.Sample(other.size(), 124, other.data());
+  EXPECT_EQ(first, second);
+  EXPECT_NE(first, other);
+}
+
+TEST(CidrSamplerTest, ExhaustsTinyRanges) {
+  // 地址不足时返回全部地址，仅剩 .0/.255 时也不会死循环
+  Ipv4RangeIndex index(
+      {Range(0x0A000000u, 0x0A0000FFu), Range(0x0B000005u, 0x0B000005u)});
+  CidrSampler sampler(index);
+  std::vector<uint32_t> out(1000);
+  const size_t count = sampler.Sample(out.size(), 1, out.data());
+  EXPECT_EQ(count, 255u);
+  std::unordered_set<uint32_t> seen(out.begin(), out.begin() + count);
+  EXPECT_EQ(seen.size(), count);
+  EXPECT_EQ(seen.count(0x0B000005u), 1u);
+}
+
+TEST(CidrSamplerTest, HugeSpaceFallsBackToHashSet) {
+  Ipv4RangeIndex index(ParseAll("0.0.0.0/0"));
+  CidrSampler sampler(index);
+  std::vector<uint32_t> out(2000);
+  ASSERT_EQ(sampler.Sample(out.size(), 9, out.data()), out.size());
+  std::unordered_set<uint32_t> seen(out.begin(), out.end());
+  EXPECT_EQ(seen.size(), out.size());
+}
+
+TEST(CidrSamplerTest, SamplesHundredThousandQuickly) {
+  Ipv4RangeIndex index(ParseAll(kCloudflareRanges));
+  CidrSampler sampler(index);
+  std::vector<uint32_t> out(100000);
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(sampler.Sample(out.size(), 2024, out.data()), out.size());
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  // 实际只需几毫秒，这里留足余量以免在慢速 CI 上误报
+  EXPECT_LT(elapsed, std::chrono::milliseconds(500));
+}
+
+TEST(NativeApiTest, CidrIndexRoundTrip) {
+  int32_t invalid = -1;
+  CfvpnCidrIndex* index =
+      cfvpn_cidr_index_create("1.1.1.0/24\nbogus\n1.1.2.0/24", &invalid);
+  ASSERT_NE(index, nullptr);
+  EXPECT_EQ(invalid, 1);
+  EXPECT_EQ(cfvpn_cidr_index_range_count(index), 2);
+  EXPECT_EQ(cfvpn_cidr_index_address_count(index), 512);
+
+  uint32_t out[16];
+  ASSERT_EQ(cfvpn_cidr_sample(index, out, 16, 5), 16);
+  for (uint32_t ip : out) {
+    EXPECT_GE(ip, 0x01010100u);
+    EXPECT_LE(ip, 0x010102FFu);
+  }
+  cfvpn_cidr_index_free(index);
+
+  EXPECT_EQ(cfvpn_cidr_index_create("", nullptr), nullptr);
+}
+
+}  // namespace
+}  // namespace cfvpn
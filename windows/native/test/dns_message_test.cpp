@@ -0,0 +1,128 @@
+#include "core/dns_message.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace cfvpn {
+namespace {
+
+void Append(std::vector<uint8_t>* out, std::initializer_list<int> bytes) {
+  for (int byte : bytes) out->push_back(static_cast<uint8_t>(byte));
+}
+
+TEST(DnsMessageTest, NormalizesNames) {
+  std::string name;
+  EXPECT_TRUE(NormalizeDnsName("WWW.Example.COM.", &name));
+  EXPECT_EQ(name, "www.example.com");
+  EXPECT_TRUE(NormalizeDnsName("_dns.resolver.arpa", &name));
+  EXPECT_FALSE(NormalizeDnsName("", &name));
+  EXPECT_FALSE(NormalizeDnsName(".", &name));
+  EXPECT_FALSE(NormalizeDnsName("a..b", &name));
+  EXPECT_FALSE(NormalizeDnsName("bad name.com", &name));
+  EXPECT_FALSE(NormalizeDnsName(std::string(64, 'a') + ".com", &name));
+  EXPECT_TRUE(NormalizeDnsName(std::string(63, 'a') + ".com", &name));
+}
+
+TEST(DnsMessageTest, QueryRoundTrips) {
+  std::vector<uint8_t> packet;
+  ASSERT_TRUE(BuildDnsQuery(0x1234, "example.com", kDnsTypeAaaa, &packet));
+  DnsMessage message;
+  ASSERT_TRUE(ParseDnsMessage(packet.data(), packet.size(), &message));
+  EXPECT_EQ(message.id, 0x1234);
+  EXPECT_FALSE(message.response());
+  EXPECT_EQ(message.flags & 0x0100, 0x0100);  // RD
+  ASSERT_EQ(message.questions.size(), 1u);
+  EXPECT_EQ(message.questions[0].name, "example.com");
+  EXPECT_EQ(message.questions[0].type, kDnsTypeAaaa);
+  EXPECT_EQ(message.questions[0].klass, kDnsClassIn);
+}
+
+TEST(DnsMessageTest, FollowsCnameChainWithCompression) {
+  // www.example.com CNAME edge.example.net（TTL 300），
+  // edge.example.net A 1.2.3.4（TTL 60）和 5.6.7.8（TTL 120），
+  // 另有一条无关的 A 记录
+  std::vector<uint8_t> packet;
+  Append(&packet, {0xAB, 0xCD, 0x81, 0x80, 0, 1, 0, 4, 0, 0, 0, 0});
+  Append(&packet, {3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e',
+                   3, 'c', 'o', 'm', 0, 0, 1, 0, 1});
+  // CNAME，RDATA 为 edge.example.net（偏移 45 处开始）
+  Append(&packet, {0xC0, 12, 0, 5, 0, 1, 0, 0, 1, 44, 0, 18});
+  Append(&packet, {4, 'e', 'd', 'g', 'e', 7, 'e', 'x', 'a', 'm', 'p', 'l',
+                   'e', 3, 'n', 'e', 't', 0});
+  Append(&packet, {0xC0, 45, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, 1, 2, 3, 4});
+  Append(&packet, {0xC0, 45, 0, 1, 0, 1, 0, 0, 0, 120, 0, 4, 5, 6, 7, 8});
+  Append(&packet, {0xC0, 12, 0, 1, 0, 1, 0, 0, 0, 10, 0, 4, 9, 9, 9, 9});
+
+  DnsMessage message;
+  ASSERT_TRUE(ParseDnsMessage(packet.data(), packet.size(), &message));
+  EXPECT_TRUE(message.response());
+  EXPECT_EQ(message.rcode(), kDnsRcodeNoError);
+  ASSERT_EQ(message.addresses.size(), 2u);
+  EXPECT_EQ(FormatIpAddress(message.addresses[0]), "1.2.3.4");
+  EXPECT_EQ(FormatIpAddress(message.addresses[1]), "5.6.7.8");
+  EXPECT_EQ(message.ttl, 60u);
+}
+
+TEST(DnsMessageTest, ReadsNegativeTtlFromSoa) {
+  std::vector<uint8_t> packet;
+  Append(&packet, {0, 1, 0x81, 0x83, 0, 1, 0, 0, 0, 1, 0, 0});
+  Append(&packet, {4, 'n', 'o', 'n', 'e', 0, 0, 1, 0, 1});
+  // SOA：TTL 900，MINIMUM 300，MNAME/RNAME 为根
+  Append(&packet, {0, 0, 6, 0, 1, 0, 0, 3, 0x84, 0, 22, 0, 0});
+  Append(&packet, {0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4});
+  Append(&packet, {0, 0, 1, 44});
+  DnsMessage message;
+  ASSERT_TRUE(ParseDnsMessage(packet.data(), packet.size(), &message));
+  EXPECT_EQ(message.rcode(), kDnsRcodeNxDomain);
+  EXPECT_TRUE(message.addresses.empty());
+  EXPECT_EQ(message.negative_ttl, 300u);
+}
+
+TEST(DnsMessageTest, RejectsMalformedMessages) {
+  std::vector<uint8_t> packet;
+  ASSERT_TRUE(BuildDnsQuery(1, "example.com", kDnsTypeA, &packet));
+  DnsMessage message;
+  for (size_t length = 0; length < packet.size(); ++length) {
+    EXPECT_FALSE(ParseDnsMessage(packet.data(), length, &message)) << length;
+  }
+  // 指向自身的压缩指针
+  std::vector<uint8_t> loop;
+  Append(&loop, {0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0xC0, 12, 0, 1, 0, 1});
+  EXPECT_FALSE(ParseDnsMessage(loop.data(), loop.size(), &message));
+}
+
+TEST(DnsMessageTest, BuildsResponseForQuestionType) {
+  std::vector<uint8_t> packet;
+  ASSERT_TRUE(BuildDnsQuery(0x4242, "example.com", kDnsTypeA, &packet));
+  DnsMessage query;
+  ASSERT_TRUE(ParseDnsMessage(packet.data(), packet.size(), &query));
+
+  std::vector<IpAddress> answers(2);
+  ASSERT_TRUE(ParseIpAddress("10.0.0.1", &answers[0]));
+  ASSERT_TRUE(ParseIpAddress("2001:db8::1", &answers[1]));
+  std::vector<uint8_t> response;
+  BuildDnsResponse(query, kDnsRcodeNoError, answers, 42, &response);
+
+  DnsMessage parsed;
+  ASSERT_TRUE(ParseDnsMessage(response.data(), response.size(), &parsed));
+  EXPECT_EQ(parsed.id, 0x4242);
+  EXPECT_TRUE(parsed.response());
+  EXPECT_FALSE(parsed.truncated());
+  EXPECT_EQ(parsed.flags & 0x0180, 0x0180);  // RD 回显，RA 置位
+  ASSERT_EQ(parsed.addresses.size(), 1u);  // AAAA 不属于 A 问题
+  EXPECT_EQ(FormatIpAddress(parsed.addresses[0]), "10.0.0.1");
+  EXPECT_EQ(parsed.ttl, 42u);
+
+  // 超过 512 字节时截断并设置 TC
+  std::vector<IpAddress> many(100, answers[0]);
+  BuildDnsResponse(query, kDnsRcodeNoError, many, 42, &response);
+  EXPECT_LE(response.size(), kDnsUdpMaxBytes);
+  ASSERT_TRUE(ParseDnsMessage(response.data(), response.size(), &parsed));
+  EXPECT_TRUE(parsed.truncated());
+  EXPECT_FALSE(parsed.addresses.empty());
+}
+
+}  // namespace
+}  // namespace cfvpn
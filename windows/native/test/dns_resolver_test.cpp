@@ -0,0 +1,617 @@
+#include "core/dns_resolver.h"
+
+#include <gtest/gtest.h>
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+
+// 代替上游的本机 DNS 服务器，在同一端口上提供 UDP 和 TCP。
+// 已知名称按记录回答，未知名称回 NXDOMAIN（带 SOA，MINIMUM 为 5 秒）。
+class FakeDnsServer {
+ public:
+  FakeDnsServer() : stopping_(false) {}
+  ~FakeDnsServer() { Stop(); }
+
+  bool Start() {
+    InitSocketLibrary();
+    udp_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = MakeSockaddrV4(kLoopbackIp, 0);
+    socklen_t length = sizeof(address);
+    if (::bind(udp_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+            0 ||
+        ::getsockname(udp_, reinterpret_cast<sockaddr*>(&address), &length) !=
+            0) {
+      return false;
+    }
+    port_ = ntohs(address.sin_port);
+    tcp_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    ::setsockopt(tcp_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (::bind(tcp_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+            0 ||
+        ::listen(tcp_, 16) != 0) {
+      return false;
+    }
+    thread_ = std::thread(&FakeDnsServer::Run, this);
+    return true;
+  }
+
+  void Stop() {
+    stopping_ = true;
+    if (thread_.joinable()) thread_.join();
+    CloseSocket(udp_);
+    CloseSocket(tcp_);
+    udp_ = tcp_ = kInvalidSocket;
+  }
+
+  void Add(const std::string& name, const std::string& address,
+           uint32_t ttl = 60) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Record& record = records_[name];
+    IpAddress parsed;
+    ParseIpAddress(address, &parsed);
+    record.addresses.push_back(parsed);
+    record.ttl = ttl;
+  }
+
+  // 收到的（名称, 类型）查询数，UDP 和 TCP 合计
+  int queries(const std::string& name, uint16_t type) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counts_[std::to_string(type) + "/" + name];
+  }
+
+  uint16_t port() const { return port_; }
+  DnsUpstream upstream(bool tcp = false) const {
+    DnsUpstream upstream;
+    upstream.address = IpAddress::V4(kLoopbackIp);
+    upstream.port = port_;
+    upstream.tcp = tcp;
+    return upstream;
+  }
+
+  std::atomic<int> udp_queries{0};
+  std::atomic<int> tcp_queries{0};
+  std::atomic<bool> truncate_udp{false};  // UDP 只回空的 TC 报文
+  std::atomic<bool> silent{false};        // 不回答
+  std::atomic<int> delay_ms{0};           // UDP 回答的延迟
+
+ private:
+  struct Record {
+    std::vector<IpAddress> addresses;
+    uint32_t ttl = 60;
+  };
+
+  struct Delayed {
+    int64_t due_us;
+    std::vector<uint8_t> response;
+    sockaddr_in client;
+  };
+
+  bool Answer(const uint8_t* data, size_t length, bool tcp,
+              std::vector<uint8_t>* response) {
+    DnsMessage query;
+    if (!ParseDnsMessage(data, length, &query) || query.questions.empty()) {
+      return false;
+    }
+    const DnsQuestion& question = query.questions.front();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++counts_[std::to_string(question.type) + "/" + question.name];
+    if (!tcp && truncate_udp) {
+      BuildDnsResponse(query, kDnsRcodeNoError, {}, 0, response);
+      (*response)[2] |= 0x02;
+      return true;
+    }
+    auto it = records_.find(question.name);
+    if (it == records_.end()) {
+      BuildDnsResponse(query, kDnsRcodeNxDomain, {}, 0, response);
+      // 授权部分一条 SOA：TTL 30，MINIMUM 5
+      const uint8_t soa[] = {0xC0, 12, 0, 6, 0, 1, 0, 0, 0, 30, 0, 22, 0, 0,
+                             0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4,
+                             0, 0, 0, 5};
+      response->insert(response->end(), soa, soa + sizeof(soa));
+      (*response)[9] = 1;  // NSCOUNT
+      return true;
+    }
+    BuildDnsResponse(query, kDnsRcodeNoError, it->second.addresses,
+                     it->second.ttl, response);
+    return true;
+  }
+
+  void ServeTcp(NativeSocket client) {
+    std::vector<uint8_t> input;
+    uint8_t buffer[4096];
+    while (PollSocket(client, false, 1000) == 1) {
+      const auto received = ::recv(client, buffer, sizeof(buffer), 0);
+      if (received <= 0) break;
+      input.insert(input.end(), buffer, buffer + received);
+      if (input.size() < 2) continue;
+      const size_t length = (size_t{input[0]} << 8) | input[1];
+      if (input.size() < length + 2) continue;
+      ++tcp_queries;
+      std::vector<uint8_t> response;
+      if (!silent && Answer(input.data() + 2, length, true, &response)) {
+        const uint8_t prefix[2] = {static_cast<uint8_t>(response.size() >> 8),
+                                   static_cast<uint8_t>(response.size())};
+        response.insert(response.begin(), prefix, prefix + 2);
+        ::send(client, response.data(), response.size(), MSG_NOSIGNAL);
+      }
+      break;
+    }
+    CloseSocket(client);
+  }
+
+  void Run() {
+    std::vector<Delayed> delayed;
+    while (!stopping_) {
+      pollfd entries[2] = {{udp_, POLLIN, 0}, {tcp_, POLLIN, 0}};
+      ::poll(entries, 2, 5);
+      const int64_t now_us = MonotonicMicros();
+      for (size_t i = 0; i < delayed.size();) {
+        if (delayed[i].due_us > now_us) {
+          ++i;
+          continue;
+        }
+        ::sendto(udp_, delayed[i].response.data(), delayed[i].response.size(),
+                 0, reinterpret_cast<const sockaddr*>(&delayed[i].client),
+                 sizeof(delayed[i].client));
+        delayed.erase(delayed.begin() + static_cast<ptrdiff_t>(i));
+      }
+      if (entries[0].revents & POLLIN) {
+        uint8_t buffer[4096];
+        Delayed item;
+        socklen_t length = sizeof(item.client);
+        const auto received =
+            ::recvfrom(udp_, buffer, sizeof(buffer), 0,
+                       reinterpret_cast<sockaddr*>(&item.client), &length);
+        if (received > 0) {
+          ++udp_queries;
+          if (!silent && Answer(buffer, static_cast<size_t>(received), false,
+                                &item.response)) {
+            item.due_us = now_us + int64_t{delay_ms} * 1000;
+            delayed.push_back(std::move(item));
+          }
+        }
+      }
+      if (entries[1].revents & POLLIN) {
+        const NativeSocket client = ::accept(tcp_, nullptr, nullptr);
+        if (client != kInvalidSocket) ServeTcp(client);
+      }
+    }
+  }
+
+  NativeSocket udp_ = kInvalidSocket;
+  NativeSocket tcp_ = kInvalidSocket;
+  uint16_t port_ = 0;
+  std::atomic<bool> stopping_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::map<std::string, Record> records_;
+  std::map<std::string, int> counts_;
+};
+
+DnsResolverOptions OptionsFor(const FakeDnsServer& server) {
+  DnsResolverOptions options;
+  options.upstreams.push_back(server.upstream());
+  options.timeout_ms = 1000;
+  return options;
+}
+
+std::vector<std::string> Format(const std::vector<IpAddress>& addresses) {
+  std::vector<std::string> text;
+  for (const IpAddress& address : addresses) {
+    text.push_back(FormatIpAddress(address));
+  }
+  return text;
+}
+
+// 向本地服务发一个查询并等待回答
+bool Exchange(uint16_t port, const std::vector<uint8_t>& query,
+              DnsMessage* response) {
+  const NativeSocket socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+  const sockaddr_in address = MakeSockaddrV4(kLoopbackIp, port);
+  ::sendto(socket, query.data(), query.size(), 0,
+           reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+  uint8_t buffer[4096];
+  bool ok = false;
+  if (PollSocket(socket, false, 3000) == 1) {
+    const auto received = ::recv(socket, buffer, sizeof(buffer), 0);
+    ok = received > 0 &&
+         ParseDnsMessage(buffer, static_cast<size_t>(received), response);
+  }
+  CloseSocket(socket);
+  return ok;
+}
+
+TEST(DnsUpstreamTest, ParsesUpstreams) {
+  DnsUpstream upstream;
+  ASSERT_TRUE(ParseDnsUpstream("1.1.1.1", &upstream));
+  EXPECT_EQ(FormatIpAddress(upstream.address), "1.1.1.1");
+  EXPECT_EQ(upstream.port, 53);
+  EXPECT_FALSE(upstream.tcp);
+  ASSERT_TRUE(ParseDnsUpstream("tcp://127.0.0.1:10853", &upstream));
+  EXPECT_EQ(upstream.port, 10853);
+  EXPECT_TRUE(upstream.tcp);
+  ASSERT_TRUE(ParseDnsUpstream("[2606:4700:4700::1111]:5353", &upstream));
+  EXPECT_TRUE(upstream.address.v6);
+  EXPECT_EQ(upstream.port, 5353);
+  ASSERT_TRUE(ParseDnsUpstream("2606:4700:4700::1111", &upstream));
+  EXPECT_EQ(upstream.port, 53);
+  EXPECT_FALSE(ParseDnsUpstream("1.1.1.1:0", &upstream));
+  EXPECT_FALSE(ParseDnsUpstream("dns.google", &upstream));
+
+  std::vector<DnsUpstream> list;
+  EXPECT_EQ(ParseDnsUpstreamList("1.1.1.1, tcp://8.8.8.8:53 bogus", &list),
+            1u);
+  ASSERT_EQ(list.size(), 2u);
+  EXPECT_TRUE(list[1].tcp);
+}
+
+TEST(DnsResolverTest, ResolvesBothFamiliesAndCaches) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("example.com", "93.184.216.34", 300);
+  server.Add("example.com", "2606:2800:220:1::1", 300);
+  DnsResolver resolver(OptionsFor(server));
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  DnsResult result = resolver.ResolveSync("Example.COM.", 3000);
+  EXPECT_EQ(result.status, DnsStatus::kOk);
+  EXPECT_EQ(Format(result.addresses),
+            (std::vector<std::string>{"93.184.216.34", "2606:2800:220:1::1"}));
+  EXPECT_EQ(result.ttl_sec, 300u);
+  EXPECT_FALSE(result.from_cache);
+
+  result = resolver.ResolveSync("example.com", 3000);
+  EXPECT_EQ(result.status, DnsStatus::kOk);
+  EXPECT_EQ(result.addresses.size(), 2u);
+  EXPECT_TRUE(result.from_cache);
+  EXPECT_EQ(server.queries("example.com", kDnsTypeA), 1);
+  EXPECT_EQ(server.queries("example.com", kDnsTypeAaaa), 1);
+
+  const DnsResolverStats stats = resolver.stats();
+  EXPECT_EQ(stats.lookups, 2u);
+  EXPECT_EQ(stats.cache_hits, 2u);
+  EXPECT_EQ(stats.cache_misses, 2u);
+  EXPECT_EQ(stats.cache_size, 2u);
+
+  EXPECT_EQ(resolver.ResolveSync("bad name", 3000).status,
+            DnsStatus::kInvalidName);
+}
+
+TEST(DnsResolverTest, ExpiresEntriesAfterTtl) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("short.test", "10.0.0.1", 1);
+  DnsResolverOptions options = OptionsFor(server);
+  options.ipv6 = false;
+  options.min_ttl_sec = 1;
+  options.prefetch_hits = 0;
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  EXPECT_FALSE(resolver.ResolveSync("short.test", 3000).from_cache);
+  EXPECT_TRUE(resolver.ResolveSync("short.test", 3000).from_cache);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  EXPECT_FALSE(resolver.ResolveSync("short.test", 3000).from_cache);
+  EXPECT_EQ(server.queries("short.test", kDnsTypeA), 2);
+}
+
+TEST(DnsResolverTest, PrefetchesHotNamesBeforeExpiry) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("hot.test", "10.0.0.2", 2);
+  server.Add("cold.test", "10.0.0.3", 2);
+  DnsResolverOptions options = OptionsFor(server);
+  options.ipv6 = false;
+  options.min_ttl_sec = 1;
+  options.prefetch_hits = 2;
+  options.prefetch_ratio = 0.8;  // 剩余不足 1.6 秒时刷新
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  resolver.ResolveSync("hot.test", 3000);
+  resolver.ResolveSync("cold.test", 3000);
+  EXPECT_TRUE(resolver.ResolveSync("hot.test", 3000).from_cache);
+  std::this_thread::sleep_for(std::chrono::milliseconds(600));
+  // 第二次命中且剩余 TTL 已低于阈值，后台刷新
+  EXPECT_TRUE(resolver.ResolveSync("hot.test", 3000).from_cache);
+  EXPECT_TRUE(resolver.ResolveSync("cold.test", 3000).from_cache);
+  for (int i = 0; i < 100 && server.queries("hot.test", kDnsTypeA) < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(server.queries("hot.test", kDnsTypeA), 2);
+  EXPECT_EQ(server.queries("cold.test", kDnsTypeA), 1);
+  EXPECT_EQ(resolver.stats().prefetches, 1u);
+
+  // 原条目过期后热门名称仍然命中，冷门名称需要重新查询
+  std::this_thread::sleep_for(std::chrono::milliseconds(1600));
+  EXPECT_TRUE(resolver.ResolveSync("hot.test", 3000).from_cache);
+  EXPECT_FALSE(resolver.ResolveSync("cold.test", 3000).from_cache);
+}
+
+TEST(DnsResolverTest, CoalescesConcurrentLookups) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("slow.test", "10.0.0.4");
+  server.delay_ms = 200;
+  DnsResolver resolver(OptionsFor(server));
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  constexpr int kCallers = 10;
+  std::atomic<int> done(0);
+  std::atomic<int> ok(0);
+  for (int i = 0; i < kCallers; ++i) {
+    resolver.Resolve("slow.test", [&](const DnsResult& result) {
+      if (result.status == DnsStatus::kOk && result.addresses.size() == 1) {
+        ++ok;
+      }
+      ++done;
+    });
+  }
+  for (int i = 0; i < 300 && done < kCallers; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(ok.load(), kCallers);
+  // A 和 AAAA 各一次上游查询，并行发出，总耗时约一个延迟
+  EXPECT_EQ(server.queries("slow.test", kDnsTypeA), 1);
+  EXPECT_EQ(server.queries("slow.test", kDnsTypeAaaa), 1);
+  EXPECT_EQ(resolver.stats().coalesced, 2u * (kCallers - 1));
+}
+
+TEST(DnsResolverTest, RetriesTruncatedAnswersOverTcp) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("big.test", "10.0.0.5");
+  server.truncate_udp = true;
+  DnsResolverOptions options = OptionsFor(server);
+  options.ipv6 = false;
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  const DnsResult result = resolver.ResolveSync("big.test", 3000);
+  EXPECT_EQ(result.status, DnsStatus::kOk);
+  EXPECT_EQ(Format(result.addresses), std::vector<std::string>{"10.0.0.5"});
+  EXPECT_EQ(server.udp_queries.load(), 1);
+  EXPECT_EQ(server.tcp_queries.load(), 1);
+  EXPECT_EQ(resolver.stats().tcp_fallbacks, 1u);
+}
+
+TEST(DnsResolverTest, UsesTcpOnlyUpstream) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("tunnel.test", "10.0.0.6");
+  DnsResolverOptions options;
+  options.upstreams.push_back(server.upstream(true));
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  const DnsResult result = resolver.ResolveSync("tunnel.test", 3000);
+  EXPECT_EQ(result.status, DnsStatus::kOk);
+  EXPECT_EQ(Format(result.addresses), std::vector<std::string>{"10.0.0.6"});
+  EXPECT_EQ(server.udp_queries.load(), 0);
+  EXPECT_EQ(server.tcp_queries.load(), 2);
+}
+
+TEST(DnsResolverTest, FailsOverToNextUpstream) {
+  FakeDnsServer dead;
+  FakeDnsServer alive;
+  ASSERT_TRUE(dead.Start());
+  ASSERT_TRUE(alive.Start());
+  dead.silent = true;
+  alive.Add("failover.test", "10.0.0.7");
+  DnsResolverOptions options;
+  options.upstreams = {dead.upstream(), alive.upstream()};
+  options.timeout_ms = 200;
+  options.ipv6 = false;
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  const DnsResult result = resolver.ResolveSync("failover.test", 3000);
+  EXPECT_EQ(result.status, DnsStatus::kOk);
+  EXPECT_EQ(dead.udp_queries.load(), 1);
+  EXPECT_EQ(resolver.stats().upstream_timeouts, 1u);
+
+  alive.silent = true;
+  EXPECT_EQ(resolver.ResolveSync("other.test", 3000).status,
+            DnsStatus::kTimeout);
+}
+
+TEST(DnsResolverTest, CachesNegativeAnswers) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  DnsResolverOptions options = OptionsFor(server);
+  options.ipv6 = false;
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  DnsResult result = resolver.ResolveSync("missing.test", 3000);
+  EXPECT_EQ(result.status, DnsStatus::kNxDomain);
+  EXPECT_EQ(result.ttl_sec, 5u);  // min(SOA TTL, MINIMUM)
+  result = resolver.ResolveSync("missing.test", 3000);
+  EXPECT_EQ(result.status, DnsStatus::kNxDomain);
+  EXPECT_TRUE(result.from_cache);
+  EXPECT_EQ(server.queries("missing.test", kDnsTypeA), 1);
+}
+
+TEST(DnsResolverTest, ClearDropsCachedEntries) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("flush.test", "10.0.0.8");
+  DnsResolverOptions options = OptionsFor(server);
+  options.ipv6 = false;
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  resolver.ResolveSync("flush.test", 3000);
+  resolver.Clear();
+  EXPECT_EQ(resolver.stats().cache_size, 0u);
+  EXPECT_FALSE(resolver.ResolveSync("flush.test", 3000).from_cache);
+  EXPECT_EQ(server.queries("flush.test", kDnsTypeA), 2);
+}
+
+TEST(DnsResolverTest, EvictsLeastRecentlyUsed) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("a.test", "10.0.1.1");
+  server.Add("b.test", "10.0.1.2");
+  server.Add("c.test", "10.0.1.3");
+  DnsResolverOptions options = OptionsFor(server);
+  options.ipv6 = false;
+  options.cache_capacity = 2;
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  resolver.ResolveSync("a.test", 3000);
+  resolver.ResolveSync("b.test", 3000);
+  EXPECT_TRUE(resolver.ResolveSync("a.test", 3000).from_cache);
+  resolver.ResolveSync("c.test", 3000);  // 淘汰 b
+  EXPECT_TRUE(resolver.ResolveSync("a.test", 3000).from_cache);
+  EXPECT_FALSE(resolver.ResolveSync("b.test", 3000).from_cache);
+  EXPECT_EQ(resolver.stats().cache_size, 2u);
+}
+
+TEST(DnsResolverTest, ServesLocalQueries) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("local.test", "10.0.0.9", 120);
+  DnsResolverOptions options = OptionsFor(server);
+  options.serve = true;
+  DnsResolver resolver(options);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+  ASSERT_NE(resolver.local_port(), 0);
+
+  std::vector<uint8_t> query;
+  ASSERT_TRUE(BuildDnsQuery(0x1111, "local.test", kDnsTypeA, &query));
+  DnsMessage response;
+  ASSERT_TRUE(Exchange(resolver.local_port(), query, &response));
+  EXPECT_EQ(response.id, 0x1111);
+  EXPECT_EQ(response.rcode(), kDnsRcodeNoError);
+  EXPECT_EQ(Format(response.addresses), std::vector<std::string>{"10.0.0.9"});
+  EXPECT_EQ(response.ttl, 120u);
+
+  // 第二次从缓存回答
+  ASSERT_TRUE(BuildDnsQuery(0x2222, "local.test", kDnsTypeA, &query));
+  ASSERT_TRUE(Exchange(resolver.local_port(), query, &response));
+  EXPECT_EQ(response.id, 0x2222);
+  EXPECT_EQ(response.addresses.size(), 1u);
+  EXPECT_EQ(server.queries("local.test", kDnsTypeA), 1);
+
+  // Resolve 与本地服务共用缓存：A 已缓存，只需查询 AAAA
+  EXPECT_EQ(resolver.ResolveSync("local.test", 3000).addresses.size(), 1u);
+  EXPECT_EQ(server.queries("local.test", kDnsTypeA), 1);
+
+  // 其他类型原样转发，回答中恢复客户端的事务 ID
+  ASSERT_TRUE(BuildDnsQuery(0x3333, "local.test", 16 /* TXT */, &query));
+  ASSERT_TRUE(Exchange(resolver.local_port(), query, &response));
+  EXPECT_EQ(response.id, 0x3333);
+  EXPECT_EQ(server.queries("local.test", 16), 1);
+
+  ASSERT_TRUE(BuildDnsQuery(0x4444, "nowhere.test", kDnsTypeA, &query));
+  ASSERT_TRUE(Exchange(resolver.local_port(), query, &response));
+  EXPECT_EQ(response.rcode(), kDnsRcodeNxDomain);
+  EXPECT_EQ(resolver.stats().served, 4u);
+}
+
+TEST(DnsResolverTest, StopCancelsPendingLookups) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.silent = true;
+  DnsResolver resolver(OptionsFor(server));
+  EXPECT_EQ(resolver.ResolveSync("early.test", 100).status,
+            DnsStatus::kCancelled);
+  std::string error;
+  ASSERT_TRUE(resolver.Start(&error)) << error;
+
+  std::atomic<int> status(-1);
+  resolver.Resolve("pending.test", [&](const DnsResult& result) {
+    status = static_cast<int>(result.status);
+  });
+  resolver.Stop();
+  EXPECT_EQ(status.load(), static_cast<int>(DnsStatus::kCancelled));
+  EXPECT_EQ(resolver.ResolveSync("late.test", 100).status,
+            DnsStatus::kCancelled);
+  EXPECT_FALSE(resolver.Start(&error));
+}
+
+TEST(DnsResolverTest, NativeApiResolvesThroughTcpUpstream) {
+  FakeDnsServer server;
+  ASSERT_TRUE(server.Start());
+  server.Add("native.test", "10.0.0.10", 90);
+  server.Add("native.test", "2001:db8::10", 90);
+  const std::string upstreams =
+      "tcp://127.0.0.1:" + std::to_string(server.port());
+  CfvpnDnsOptions options;
+  std::memset(&options, 0, sizeof(options));
+  options.upstreams = upstreams.c_str();
+  options.listen_port = -1;
+  char error[128];
+  CfvpnDnsResolver* resolver =
+      cfvpn_dns_resolver_create(&options, error, sizeof(error));
+  ASSERT_NE(resolver, nullptr) << error;
+  EXPECT_NE(cfvpn_dns_resolver_local_port(resolver), 0);
+
+  CfvpnDnsAnswer answer;
+  CfvpnIpAddress addresses[1];
+  for (int round = 0; round < 2; ++round) {
+    CfvpnDnsQuery* query = cfvpn_dns_resolve_start(resolver, "native.test");
+    for (int i = 0; i < 300 && !cfvpn_dns_resolve_is_done(query); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // 只留一个位置，地址总数仍然报告完整
+    ASSERT_EQ(cfvpn_dns_resolve_result(query, &answer, addresses, 1), 1);
+    EXPECT_EQ(answer.status, CFVPN_DNS_OK);
+    EXPECT_EQ(answer.address_count, 2);
+    EXPECT_EQ(answer.from_cache, round == 1 ? 1 : 0);
+    EXPECT_EQ(addresses[0].family, 4);
+    EXPECT_EQ(addresses[0].bytes[3], 10);
+    cfvpn_dns_resolve_free(query);
+  }
+  EXPECT_EQ(server.tcp_queries.load(), 2);
+
+  cfvpn_dns_resolver_clear(resolver);
+  CfvpnDnsStats stats;
+  cfvpn_dns_resolver_stats(resolver, &stats);
+  EXPECT_EQ(stats.cache_size, 0);
+  EXPECT_EQ(stats.cache_hits, 2);
+
+  // 结束前释放的查询不影响之后的回调
+  server.silent = true;
+  CfvpnDnsQuery* abandoned = cfvpn_dns_resolve_start(resolver, "gone.test");
+  cfvpn_dns_resolve_free(abandoned);
+  cfvpn_dns_resolver_free(resolver);
+
+  options.upstreams = "not-an-address";
+  EXPECT_EQ(cfvpn_dns_resolver_create(&options, error, sizeof(error)),
+            nullptr);
+  EXPECT_GT(std::strlen(error), 0u);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,133 @@
+// cfvpn_edge_sim：本机 Cloudflare 边缘模拟器（见 edge_simulator.h）。
+//
+//   cfvpn_edge_sim [选项]
+//
+// 例如模拟一个 /24，其中 10% 为 80 ms 的优质节点、30% 为较慢节点、
+// 其余拒绝连接或超时（每个 --profile 一个配置）：
+//
+//   cfvpn_edge_sim --range 127.1.0.0/24 --port 8443 --port 8080
+//       --profile name=good,latency=80,jitter=10,colo=NRT,weight=1
+//       --profile name=slow,latency=250,jitter=60,loss=0.2,colo=SJC,weight=3
+//       --profile name=rst,behavior=reset,weight=3
+//       --profile name=dead,behavior=blackhole,weight=3
+//
+// 然后用与应用相同的流程扫描：
+//
+//   cfvpn_scan --ranges 127.1.0.0/24 -p 8443 --trace-port 8080
+//       --min-valid-latency 0 --seed 1
+//
+// 延迟和丢包只作用于 HTTP 响应；--print-netem 输出让内核对握手整形的
+// tc 脚本（需要 root 和 sch_netem），用于测试 TCPing 阶段的延迟排序。
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "edge_simulator.h"
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void HandleInterrupt(int) { g_stop = 1; }
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "用法: cfvpn_edge_sim [选项]\n"
+      "  -r, --range CIDR      模拟的地址（127.0.0.0/8 内，可重复）\n"
+      "  -p, --port PORT       监听端口（可重复），默认 443 和 80\n"
+      "      --profile SPEC    节点配置（可重复），字段：name、behavior\n"
+      "                        (accept|reset|blackhole)、latency、jitter、loss、\n"
+      "                        colo、loc、weight、range\n"
+      "      --seed N          地址分配和随机序列的种子，默认 1\n"
+      "      --print-netem     输出对握手整形的 tc 脚本后退出\n");
+}
+
+// 每个地址每个端口一个监听套接字，尽量提高文件描述符上限
+void RaiseFileLimit() {
+  rlimit limit = {};
+  if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+      limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  cfvpn::testing::EdgeSimulatorOptions options;
+  bool print_netem = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if ((arg == "-r" || arg == "--range") && has_value) {
+      const std::string text = argv[++i];
+      cfvpn::Ipv4Range range;
+      if (!cfvpn::ParseCidr(text.c_str(), text.size(), &range)) {
+        std::fprintf(stderr, "无效的 CIDR: %s\n", text.c_str());
+        return 2;
+      }
+      options.ranges.push_back(range);
+    } else if ((arg == "-p" || arg == "--port") && has_value) {
+      options.ports.push_back(static_cast<uint16_t>(std::atoi(argv[++i])));
+    } else if (arg == "--profile" && has_value) {
+      cfvpn::testing::EdgeProfile profile;
+      std::string error;
+      if (!cfvpn::testing::ParseEdgeProfile(argv[++i], &profile, &error)) {
+        std::fprintf(stderr, "无效的配置 %s: %s\n", argv[i], error.c_str());
+        return 2;
+      }
+      options.profiles.push_back(std::move(profile));
+    } else if (arg == "--seed" && has_value) {
+      options.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--print-netem") {
+      print_netem = true;
+    } else if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (options.ranges.empty()) {
+    PrintUsage();
+    return 2;
+  }
+  if (options.ports.empty()) options.ports = {443, 80};
+
+  cfvpn::testing::EdgeSimulator simulator(options);
+  if (print_netem) {
+    const std::string script = simulator.NetemScript();
+    std::fwrite(script.data(), 1, script.size(), stdout);
+    return 0;
+  }
+
+  RaiseFileLimit();
+  std::string error;
+  if (!simulator.Start(&error)) {
+    std::fprintf(stderr, "启动失败: %s\n", error.c_str());
+    return 1;
+  }
+  std::signal(SIGINT, &HandleInterrupt);
+  std::signal(SIGTERM, &HandleInterrupt);
+  std::fprintf(stderr, "已监听 %zu 个套接字，Ctrl+C 退出\n",
+               simulator.listening_sockets());
+  while (!g_stop) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  simulator.Stop();
+  std::fprintf(stderr, "连接 %llu，请求 %llu，响应 %llu，丢弃 %llu\n",
+               static_cast<unsigned long long>(simulator.connections()),
+               static_cast<unsigned long long>(simulator.requests()),
+               static_cast<unsigned long long>(simulator.responses()),
+               static_cast<unsigned long long>(simulator.dropped()));
+  return 0;
+}
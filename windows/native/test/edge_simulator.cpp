@@ -0,0 +1,456 @@
+#include "edge_simulator.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace cfvpn {
+namespace testing {
+
+namespace {
+
+constexpr size_t kMaxRequestBytes = 16 * 1024;
+
+uint64_t Mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+bool InRanges(const std::vector<Ipv4Range>& ranges, uint32_t ip) {
+  for (const Ipv4Range& range : ranges) {
+    if (ip >= range.first && ip <= range.last) return true;
+  }
+  return false;
+}
+
+bool ParseInt(const std::string& text, int* out) {
+  char* end = nullptr;
+  const long value = std::strtol(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0' || value < 0 || value > 1000000) {
+    return false;
+  }
+  *out = static_cast<int>(value);
+  return true;
+}
+
+// 请求头中某个字段的值（不区分大小写），没有时返回空串
+std::string HeaderValue(const std::string& head, const char* name) {
+  const size_t name_length = std::strlen(name);
+  size_t line = head.find("\r\n");
+  while (line != std::string::npos && line + 2 < head.size()) {
+    const size_t start = line + 2;
+    const size_t end = head.find("\r\n", start);
+    const size_t colon = head.find(':', start);
+    if (colon != std::string::npos && colon < end &&
+        colon - start == name_length &&
+        ::strncasecmp(head.c_str() + start, name, name_length) == 0) {
+      size_t value = colon + 1;
+      while (value < end && head[value] == ' ') ++value;
+      return head.substr(value, end - value);
+    }
+    line = end;
+  }
+  return std::string();
+}
+
+}  // namespace
+
+bool ParseEdgeProfile(const std::string& text, EdgeProfile* out,
+                      std::string* error) {
+  EdgeProfile profile;
+  size_t pos = 0;
+  while (pos <= text.size()) {
+    size_t comma = text.find(',', pos);
+    if (comma == std::string::npos) comma = text.size();
+    const std::string item = text.substr(pos, comma - pos);
+    pos = comma + 1;
+    if (item.empty()) continue;
+    const size_t equals = item.find('=');
+    if (equals == std::string::npos) {
+      *error = "缺少 '=': " + item;
+      return false;
+    }
+    const std::string key = item.substr(0, equals);
+    const std::string value = item.substr(equals + 1);
+    bool ok = true;
+    if (key == "name") {
+      profile.name = value;
+    } else if (key == "behavior") {
+      if (value == "accept") {
+        profile.behavior = EdgeProfile::Behavior::kAccept;
+      } else if (value == "reset" || value == "rst") {
+        profile.behavior = EdgeProfile::Behavior::kReset;
+      } else if (value == "blackhole") {
+        profile.behavior = EdgeProfile::Behavior::kBlackhole;
+      } else {
+        ok = false;
+      }
+    } else if (key == "latency") {
+      ok = ParseInt(value, &profile.latency_ms);
+    } else if (key == "jitter") {
+      ok = ParseInt(value, &profile.jitter_ms);
+    } else if (key == "loss") {
+      char* end = nullptr;
+      profile.loss_rate = std::strtod(value.c_str(), &end);
+      ok = !value.empty() && *end == '\0' && profile.loss_rate >= 0 &&
+           profile.loss_rate <= 1;
+    } else if (key == "colo") {
+      profile.colo = value;
+    } else if (key == "loc") {
+      profile.loc = value;
+    } else if (key == "weight") {
+      ok = ParseInt(value, &profile.weight);
+    } else if (key == "range") {
+      Ipv4Range range;
+      ok = ParseCidr(value.c_str(), value.size(), &range);
+      if (ok) profile.ranges.push_back(range);
+    } else {
+      *error = "未知的字段: " + key;
+      return false;
+    }
+    if (!ok) {
+      *error = "无效的值: " + item;
+      return false;
+    }
+  }
+  *out = std::move(profile);
+  return true;
+}
+
+struct EdgeSimulator::Connection {
+  NativeSocket socket = kInvalidSocket;
+  const EdgeProfile* profile = nullptr;
+  uint32_t local_ip = 0;
+  uint32_t peer_ip = 0;
+  std::string input;
+  std::string output;
+  size_t output_pos = 0;
+  int64_t due_us = -1;       // 响应可以开始发送的时间，-1 表示没有待发响应
+  bool silent = false;       // 请求被"丢弃"，不再回复
+  bool close_after = false;  // 发完响应后关闭（Connection: close）
+};
+
+EdgeSimulator::EdgeSimulator(const EdgeSimulatorOptions& options)
+    : options_(options), random_(options.seed) {
+  if (options_.profiles.empty()) options_.profiles.emplace_back();
+  uint64_t total = 0;
+  for (size_t i = 0; i < options_.profiles.size(); ++i) {
+    const EdgeProfile& profile = options_.profiles[i];
+    if (!profile.ranges.empty() || profile.weight <= 0) continue;
+    total += static_cast<uint64_t>(profile.weight);
+    weighted_.push_back(i);
+    cumulative_weights_.push_back(total);
+  }
+}
+
+EdgeSimulator::~EdgeSimulator() { Stop(); }
+
+const EdgeProfile& EdgeSimulator::ProfileFor(uint32_t ip) const {
+  for (const EdgeProfile& profile : options_.profiles) {
+    if (InRanges(profile.ranges, ip)) return profile;
+  }
+  if (weighted_.empty()) return options_.profiles.front();
+  const uint64_t pick =
+      Mix(options_.seed ^ (static_cast<uint64_t>(ip) << 16)) %
+      cumulative_weights_.back();
+  const size_t slot = static_cast<size_t>(
+      std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(),
+                       pick) -
+      cumulative_weights_.begin());
+  return options_.profiles[weighted_[slot]];
+}
+
+bool EdgeSimulator::Start(std::string* error) {
+  InitSocketLibrary();
+  for (const Ipv4Range& range : options_.ranges) {
+    if ((range.first >> 24) != 127 || (range.last >> 24) != 127) {
+      *error = "只能模拟 127.0.0.0/8 内的地址";
+      return false;
+    }
+    for (uint64_t ip = range.first; ip <= range.last; ++ip) {
+      const EdgeProfile& profile = ProfileFor(static_cast<uint32_t>(ip));
+      if (profile.behavior == EdgeProfile::Behavior::kReset) continue;
+      const bool blackhole =
+          profile.behavior == EdgeProfile::Behavior::kBlackhole;
+      for (uint16_t port : options_.ports) {
+        const NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        ::setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        const sockaddr_in address =
+            MakeSockaddrV4(static_cast<uint32_t>(ip), port);
+        if (socket == kInvalidSocket ||
+            ::bind(socket, reinterpret_cast<const sockaddr*>(&address),
+                   sizeof(address)) != 0 ||
+            ::listen(socket, blackhole ? 0 : 1024) != 0) {
+          *error = FormatIpv4(static_cast<uint32_t>(ip)) + ":" +
+                   std::to_string(port) + ": " +
+                   SocketErrorString(LastSocketError());
+          if (socket != kInvalidSocket) CloseSocket(socket);
+          Stop();
+          return false;
+        }
+        if (blackhole) {
+          // 用一条永不 accept 的连接占满接受队列，之后的 SYN 被丢弃
+          const NativeSocket filler = ::socket(AF_INET, SOCK_STREAM, 0);
+          ::connect(filler, reinterpret_cast<const sockaddr*>(&address),
+                    sizeof(address));
+          blackhole_fillers_.push_back(filler);
+          blackhole_fillers_.push_back(socket);
+          continue;
+        }
+        SetNonBlocking(socket);
+        listeners_.push_back(
+            Listener{socket, static_cast<uint32_t>(ip), &profile});
+      }
+    }
+  }
+  stopping_.store(false);
+  worker_ = std::thread(&EdgeSimulator::Run, this);
+  return true;
+}
+
+void EdgeSimulator::Stop() {
+  stopping_.store(true);
+  if (worker_.joinable()) worker_.join();
+  for (const auto& connection : connections_list_) {
+    CloseSocket(connection->socket);
+  }
+  connections_list_.clear();
+  for (const Listener& listener : listeners_) CloseSocket(listener.socket);
+  listeners_.clear();
+  for (NativeSocket socket : blackhole_fillers_) CloseSocket(socket);
+  blackhole_fillers_.clear();
+}
+
+int EdgeSimulator::SampleLatencyMs(const EdgeProfile& profile) {
+  if (profile.jitter_ms <= 0) return profile.latency_ms;
+  // Box-Muller
+  const double u1 = std::max(random_.NextDouble(), 1e-12);
+  const double u2 = random_.NextDouble();
+  const double normal =
+      std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+  return std::max(
+      0, static_cast<int>(std::lround(profile.latency_ms +
+                                      normal * profile.jitter_ms)));
+}
+
+void EdgeSimulator::Accept(const Listener& listener) {
+  for (;;) {
+    sockaddr_in peer = {};
+    socklen_t length = sizeof(peer);
+    const NativeSocket socket = ::accept(
+        listener.socket, reinterpret_cast<sockaddr*>(&peer), &length);
+    if (socket == kInvalidSocket) return;
+    SetNonBlocking(socket);
+    auto connection = std::make_unique<Connection>();
+    connection->socket = socket;
+    connection->profile = listener.profile;
+    connection->local_ip = listener.ip;
+    connection->peer_ip = ntohl(peer.sin_addr.s_addr);
+    connections_list_.push_back(std::move(connection));
+    connections_.fetch_add(1);
+  }
+}
+
+bool EdgeSimulator::HandleRequests(Connection* connection, int64_t now_us) {
+  if (connection->silent || connection->due_us >= 0) return true;
+  const size_t end = connection->input.find("\r\n\r\n");
+  if (end == std::string::npos) {
+    return connection->input.size() < kMaxRequestBytes;
+  }
+  const std::string head = connection->input.substr(0, end);
+  connection->input.erase(0, end + 4);
+  requests_.fetch_add(1);
+
+  const EdgeProfile& profile = *connection->profile;
+  if (profile.loss_rate > 0 && random_.NextDouble() < profile.loss_rate) {
+    connection->silent = true;
+    dropped_.fetch_add(1);
+    return true;
+  }
+
+  const size_t path_start = head.find(' ');
+  const size_t path_end = head.find(' ', path_start + 1);
+  const std::string path =
+      path_start == std::string::npos || path_end == std::string::npos
+          ? std::string()
+          : head.substr(path_start + 1, path_end - path_start - 1);
+  std::string connection_header = HeaderValue(head, "Connection");
+  std::transform(connection_header.begin(), connection_header.end(),
+                 connection_header.begin(),
+                 [](char c) { return static_cast<char>(std::tolower(c)); });
+  connection->close_after = connection_header == "close";
+
+  std::string body;
+  const char* status = "200 OK";
+  if (path == "/cdn-cgi/trace") {
+    std::string host = HeaderValue(head, "Host");
+    if (host.empty()) host = FormatIpv4(connection->local_ip);
+    const int64_t now =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    char ts[32];
+    std::snprintf(ts, sizeof(ts), "%lld.%03d",
+                  static_cast<long long>(now / 1000000),
+                  static_cast<int>(now % 1000000 / 1000));
+    body = "fl=" + std::to_string(connection->local_ip & 0xFFFF) + "f1\n" +
+           "h=" + host + "\nip=" + FormatIpv4(connection->peer_ip) +
+           "\nts=" + ts + "\nvisit_scheme=http\nuag=" +
+           HeaderValue(head, "User-Agent") + "\ncolo=" + profile.colo +
+           "\nsliver=none\nhttp=http/1.1\nloc=" + profile.loc +
+           "\ntls=off\nsni=off\nwarp=off\ngateway=off\nrbi=off\nkex=none\n";
+  } else {
+    // Cloudflare 拒绝直接以 IP 访问时的响应
+    status = "403 Forbidden";
+    body = "error code: 1003";
+  }
+  char ray[24];
+  std::snprintf(ray, sizeof(ray), "%016llx",
+                static_cast<unsigned long long>(random_.Next()));
+  connection->output = std::string("HTTP/1.1 ") + status +
+                       "\r\nServer: cloudflare\r\n"
+                       "Content-Type: text/plain; charset=UTF-8\r\n"
+                       "Content-Length: " + std::to_string(body.size()) +
+                       "\r\nConnection: " +
+                       (connection->close_after ? "close" : "keep-alive") +
+                       "\r\nCF-RAY: " + ray + "-" + profile.colo + "\r\n\r\n" +
+                       body;
+  connection->output_pos = 0;
+  connection->due_us = now_us + SampleLatencyMs(profile) * int64_t{1000};
+  return true;
+}
+
+void EdgeSimulator::Run() {
+  std::vector<pollfd> entries;
+  char buffer[4096];
+  while (!stopping_.load()) {
+    int64_t now_us = MonotonicMicros();
+    int timeout_ms = 20;
+    entries.clear();
+    for (const Listener& listener : listeners_) {
+      entries.push_back(pollfd{listener.socket, POLLIN, 0});
+    }
+    for (const auto& connection : connections_list_) {
+      short events = POLLIN;
+      if (connection->due_us >= 0) {
+        if (connection->due_us <= now_us) {
+          events |= POLLOUT;
+        } else {
+          timeout_ms = std::min<int>(
+              timeout_ms,
+              static_cast<int>((connection->due_us - now_us + 999) / 1000));
+        }
+      }
+      entries.push_back(pollfd{connection->socket, events, 0});
+    }
+    if (::poll(entries.data(), entries.size(), timeout_ms) < 0 &&
+        errno != EINTR) {
+      return;
+    }
+    now_us = MonotonicMicros();
+
+    const size_t listener_count = listeners_.size();
+    const size_t connection_count = connections_list_.size();
+    for (size_t i = 0; i < connection_count; ++i) {
+      Connection* connection = connections_list_[i].get();
+      const short revents = entries[listener_count + i].revents;
+      bool keep = true;
+      if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        const ssize_t n = ::recv(connection->socket, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+          connection->input.append(buffer, static_cast<size_t>(n));
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+          keep = false;
+        }
+      }
+      if (keep && connection->due_us >= 0 && connection->due_us <= now_us) {
+        const ssize_t n = ::send(
+            connection->socket, connection->output.data() +
+                                    connection->output_pos,
+            connection->output.size() - connection->output_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+          connection->output_pos += static_cast<size_t>(n);
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          keep = false;
+        }
+        if (keep && connection->output_pos == connection->output.size()) {
+          responses_.fetch_add(1);
+          connection->due_us = -1;
+          connection->output.clear();
+          if (connection->close_after) keep = false;
+        }
+      }
+      if (keep) keep = HandleRequests(connection, now_us);
+      if (!keep) {
+        CloseSocket(connection->socket);
+        connection->socket = kInvalidSocket;
+      }
+    }
+    connections_list_.erase(
+        std::remove_if(connections_list_.begin(), connections_list_.end(),
+                       [](const std::unique_ptr<Connection>& connection) {
+                         return connection->socket == kInvalidSocket;
+                       }),
+        connections_list_.end());
+
+    for (size_t i = 0; i < listener_count; ++i) {
+      if (entries[i].revents & POLLIN) Accept(listeners_[i]);
+    }
+  }
+}
+
+std::string EdgeSimulator::NetemScript(const std::string& device) const {
+  std::string script =
+      "#!/bin/sh\n"
+      "# 需要 root 和 sch_netem；撤销: tc qdisc del dev " + device + " root\n"
+      "set -e\n"
+      "tc qdisc del dev " + device + " root 2>/dev/null || true\n"
+      "tc qdisc add dev " + device + " root handle 1: htb default 1\n"
+      "tc class add dev " + device + " parent 1: classid 1:1 htb rate 100gbit\n";
+  char line[256];
+  std::vector<int> class_of(options_.profiles.size(), 0);
+  for (size_t i = 0; i < options_.profiles.size(); ++i) {
+    const EdgeProfile& profile = options_.profiles[i];
+    if (profile.behavior != EdgeProfile::Behavior::kAccept ||
+        (profile.latency_ms == 0 && profile.loss_rate == 0)) {
+      continue;
+    }
+    class_of[i] = 0x10 + static_cast<int>(i);
+    std::snprintf(line, sizeof(line),
+                  "tc class add dev %s parent 1: classid 1:%x htb rate 100gbit\n"
+                  "tc qdisc add dev %s parent 1:%x handle %x: netem delay %dms "
+                  "%dms distribution normal loss %.2f%%  # %s\n",
+                  device.c_str(), class_of[i], device.c_str(), class_of[i],
+                  class_of[i], profile.latency_ms, profile.jitter_ms,
+                  profile.loss_rate * 100, profile.name.c_str());
+    script += line;
+  }
+  // 只匹配发往模拟地址的包，延迟体现在 SYN 上，即 TCPing 的握手耗时
+  for (const Ipv4Range& range : options_.ranges) {
+    for (uint64_t ip = range.first; ip <= range.last; ++ip) {
+      const EdgeProfile& profile = ProfileFor(static_cast<uint32_t>(ip));
+      const int classid =
+          class_of[static_cast<size_t>(&profile - options_.profiles.data())];
+      if (classid == 0) continue;
+      std::snprintf(line, sizeof(line),
+                    "tc filter add dev %s parent 1: protocol ip prio 1 u32 "
+                    "match ip dst %s/32 flowid 1:%x\n",
+                    device.c_str(),
+                    FormatIpv4(static_cast<uint32_t>(ip)).c_str(), classid);
+      script += line;
+    }
+  }
+  return script;
+}
+
+}  // namespace testing
+}  // namespace cfvpn
@@ -0,0 +1,131 @@
+#ifndef NATIVE_TEST_EDGE_SIMULATOR_H_
+#define NATIVE_TEST_EDGE_SIMULATOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/cidr_sampler.h"
+#include "core/random.h"
+#include "core/socket_util.h"
+
+namespace cfvpn {
+namespace testing {
+
+// 一类模拟节点的行为
+struct EdgeProfile {
+  enum class Behavior : uint8_t {
+    kAccept,     // 正常握手并提供 /cdn-cgi/trace
+    kReset,      // 不监听，连接被 RST 拒绝
+    kBlackhole,  // 握手包被丢弃，连接超时
+  };
+
+  std::string name = "edge";
+  Behavior behavior = Behavior::kAccept;
+  // HTTP 响应延迟：均值为 latency_ms、标准差为 jitter_ms 的正态分布（截断到 0）
+  int latency_ms = 0;
+  int jitter_ms = 0;
+  // 请求被"丢弃"的概率：不回复，直到客户端超时关闭连接
+  double loss_rate = 0;
+  std::string colo = "NRT";
+  std::string loc = "JP";
+  // 未被 ranges 固定的地址按权重在各配置间确定性地分配
+  int weight = 1;
+  // 非空时这些地址固定使用本配置，且本配置不参与按权重分配
+  std::vector<Ipv4Range> ranges;
+};
+
+// 解析命令行中的配置描述，例如
+//   name=slow,latency=180,jitter=40,loss=0.1,colo=SJC,loc=US,weight=3
+//   name=dead,behavior=blackhole,range=127.1.0.128/25
+// 失败时返回 false，error 给出原因。
+bool ParseEdgeProfile(const std::string& text, EdgeProfile* out,
+                      std::string* error);
+
+struct EdgeSimulatorOptions {
+  std::vector<Ipv4Range> ranges;  // 需要模拟的地址，必须在 127.0.0.0/8 内
+  std::vector<uint16_t> ports;    // 每个地址监听的端口（扫描端口和 Trace 端口）
+  std::vector<EdgeProfile> profiles;  // 为空时全部使用默认的 EdgeProfile
+  uint64_t seed = 1;  // 决定地址到配置的分配以及延迟和丢包的随机序列
+};
+
+// 本机 Cloudflare 边缘模拟器。
+//
+// 在 127.0.0.0/8 的许多地址上按配置监听，用于在一台机器上可复现地测试
+// 扫描性能和提前结束逻辑，结果不随时段和运营商变化。
+//
+//   kAccept    回复与真实边缘格式相同的 /cdn-cgi/trace（含 colo、loc），
+//              其它路径返回 403（与直接用 IP 访问 Cloudflare 一致）；
+//              支持 keep-alive。
+//   kReset     不创建监听，内核以 RST 拒绝。
+//   kBlackhole 监听但 backlog 为 0 且接受队列已被自身的一条连接占满，
+//              后续 SYN 被内核丢弃，客户端连接超时。
+//
+// 用户态无法推迟回环上的 TCP 握手，因此 latency/jitter/loss 只作用于
+// HTTP 响应；TCPing 的握手延迟和丢包需要内核整形，见 NetemScript()。
+//
+// 所有连接在一个后台线程中用 poll() 处理。每个地址每个端口占用一个文件
+// 描述符，模拟大量地址时需要提高 RLIMIT_NOFILE。
+class EdgeSimulator {
+ public:
+  explicit EdgeSimulator(const EdgeSimulatorOptions& options);
+  ~EdgeSimulator();
+
+  EdgeSimulator(const EdgeSimulator&) = delete;
+  EdgeSimulator& operator=(const EdgeSimulator&) = delete;
+
+  // 绑定所有地址并启动后台线程。失败时返回 false，error 给出原因。
+  bool Start(std::string* error);
+  void Stop();
+
+  // 地址使用的配置，由 seed 和地址决定，与绑定顺序无关
+  const EdgeProfile& ProfileFor(uint32_t ip) const;
+
+  // 为每个有延迟或丢包的配置生成 tc（HTB + netem）脚本，让内核对发往
+  // 对应地址的包整形，从而在握手上体现延迟和丢包。需要 root 和 sch_netem。
+  std::string NetemScript(const std::string& device = "lo") const;
+
+  uint64_t connections() const { return connections_.load(); }
+  uint64_t requests() const { return requests_.load(); }
+  uint64_t responses() const { return responses_.load(); }
+  uint64_t dropped() const { return dropped_.load(); }
+  size_t listening_sockets() const { return listeners_.size(); }
+
+ private:
+  struct Listener {
+    NativeSocket socket;
+    uint32_t ip;
+    const EdgeProfile* profile;
+  };
+  struct Connection;
+
+  void Run();
+  void Accept(const Listener& listener);
+  // 处理已收到的完整请求头，返回 false 表示连接应关闭
+  bool HandleRequests(Connection* connection, int64_t now_us);
+  int SampleLatencyMs(const EdgeProfile& profile);
+
+  EdgeSimulatorOptions options_;
+  // 参与按权重分配的配置下标及其累计权重
+  std::vector<size_t> weighted_;
+  std::vector<uint64_t> cumulative_weights_;
+  std::vector<Listener> listeners_;
+  std::vector<NativeSocket> blackhole_fillers_;
+  std::vector<std::unique_ptr<Connection>> connections_list_;
+  Random random_;  // 仅在后台线程中使用
+
+  std::atomic<bool> stopping_{false};
+  std::atomic<uint64_t> connections_{0};
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> responses_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::thread worker_;
+};
+
+}  // namespace testing
+}  // namespace cfvpn
+
+#endif  // NATIVE_TEST_EDGE_SIMULATOR_H_
@@ -0,0 +1,180 @@
+#include "edge_simulator.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "core/http_probe_engine.h"
+#include "core/node_scanner.h"
+#include "core/tcping_engine.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace testing {
+namespace {
+
+constexpr uint32_t kBase = 0x7F4D0000;  // 127.77.0.0
+
+EdgeProfile Profile(const std::string& spec) {
+  EdgeProfile profile;
+  std::string error;
+  EXPECT_TRUE(ParseEdgeProfile(spec, &profile, &error)) << error;
+  return profile;
+}
+
+TEST(EdgeSimulatorTest, ParsesProfiles) {
+  const EdgeProfile profile = Profile(
+      "name=slow,latency=180,jitter=40,loss=0.25,colo=SJC,loc=US,weight=3,"
+      "range=127.1.0.0/24");
+  EXPECT_EQ(profile.name, "slow");
+  EXPECT_EQ(profile.behavior, EdgeProfile::Behavior::kAccept);
+  EXPECT_EQ(profile.latency_ms, 180);
+  EXPECT_EQ(profile.jitter_ms, 40);
+  EXPECT_DOUBLE_EQ(profile.loss_rate, 0.25);
+  EXPECT_EQ(profile.colo, "SJC");
+  EXPECT_EQ(profile.loc, "US");
+  EXPECT_EQ(profile.weight, 3);
+  ASSERT_EQ(profile.ranges.size(), 1u);
+  EXPECT_EQ(profile.ranges[0].first, 0x7F010000u);
+  EXPECT_EQ(Profile("behavior=blackhole").behavior,
+            EdgeProfile::Behavior::kBlackhole);
+  EXPECT_EQ(Profile("behavior=rst").behavior, EdgeProfile::Behavior::kReset);
+
+  EdgeProfile ignored;
+  std::string error;
+  EXPECT_FALSE(ParseEdgeProfile("latency", &ignored, &error));
+  EXPECT_FALSE(ParseEdgeProfile("loss=2", &ignored, &error));
+  EXPECT_FALSE(ParseEdgeProfile("behavior=drop", &ignored, &error));
+  EXPECT_FALSE(ParseEdgeProfile("speed=1", &ignored, &error));
+}
+
+TEST(EdgeSimulatorTest, AssignsProfilesDeterministically) {
+  EdgeSimulatorOptions options;
+  options.ranges = {{kBase, kBase + 1023}};
+  options.profiles = {Profile("name=good,weight=1"),
+                      Profile("name=bad,behavior=rst,weight=3"),
+                      Profile("name=pinned,range=127.77.0.0/30")};
+  options.seed = 7;
+  EdgeSimulator a(options);
+  EdgeSimulator b(options);
+  int good = 0;
+  for (uint32_t ip = kBase; ip < kBase + 1024; ++ip) {
+    const EdgeProfile& profile = a.ProfileFor(ip);
+    EXPECT_EQ(profile.name, b.ProfileFor(ip).name);
+    if (ip < kBase + 4) {
+      EXPECT_EQ(profile.name, "pinned");
+    } else if (profile.name == "good") {
+      ++good;
+    } else {
+      EXPECT_EQ(profile.name, "bad");
+    }
+  }
+  // 1:3 的权重
+  EXPECT_GT(good, 200);
+  EXPECT_LT(good, 320);
+}
+
+TEST(EdgeSimulatorTest, ServesTraceResetsAndBlackholes) {
+  const uint16_t port = UnusedLoopbackPort();
+  EdgeSimulatorOptions options;
+  options.ranges = {{kBase + 1, kBase + 3}};
+  options.ports = {port};
+  options.profiles = {
+      Profile("name=hkg,latency=60,colo=HKG,loc=HK,range=127.77.0.1/32"),
+      Profile("behavior=reset,range=127.77.0.2/32"),
+      Profile("behavior=blackhole,range=127.77.0.3/32")};
+  EdgeSimulator simulator(options);
+  std::string error;
+  ASSERT_TRUE(simulator.Start(&error)) << error;
+  EXPECT_EQ(simulator.listening_sockets(), 1u);
+
+  HttpProbeOptions http;
+  http.timeout_ms = 300;
+  HttpProbeEngine engine(http);
+  std::vector<HttpProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kBase + 1, port}, {kBase + 2, port},
+                          {kBase + 3, port}},
+                         &results));
+  ASSERT_EQ(results.size(), 3u);
+  EXPECT_EQ(results[0].status, 200);
+  EXPECT_EQ(results[0].received, 1);
+  EXPECT_GE(results[0].total_ms, 60);
+  EXPECT_STREQ(results[0].colo, "HKG");
+  EXPECT_STREQ(results[0].loc, "HK");
+  EXPECT_EQ(results[1].received, 0);
+  EXPECT_EQ(results[1].connect_ms, -1);  // RST
+  EXPECT_EQ(results[2].received, 0);
+  EXPECT_EQ(results[2].connect_ms, -1);  // 握手超时
+  EXPECT_EQ(simulator.responses(), 1u);
+}
+
+TEST(EdgeSimulatorTest, LossDropsRequests) {
+  const uint16_t port = UnusedLoopbackPort();
+  EdgeSimulatorOptions options;
+  options.ranges = {{kBase + 1, kBase + 1}};
+  options.ports = {port};
+  options.profiles = {Profile("loss=1")};
+  EdgeSimulator simulator(options);
+  std::string error;
+  ASSERT_TRUE(simulator.Start(&error)) << error;
+
+  HttpProbeOptions http;
+  http.timeout_ms = 200;
+  HttpProbeEngine engine(http);
+  std::vector<HttpProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kBase + 1, port}}, &results));
+  EXPECT_GE(results[0].connect_ms, 0);
+  EXPECT_EQ(results[0].received, 0);
+  EXPECT_EQ(simulator.dropped(), 1u);
+}
+
+// 与应用相同的扫描流程在模拟边缘上得到确定的提前结束原因
+TEST(EdgeSimulatorTest, DrivesScannerEarlyStop) {
+  const uint16_t port = UnusedLoopbackPort();
+  EdgeSimulatorOptions options;
+  options.ranges = {{kBase + 1, kBase + 254}};
+  options.ports = {port};
+  options.profiles = {Profile("name=good,colo=NRT,weight=1"),
+                      Profile("name=dead,behavior=reset,weight=1")};
+  EdgeSimulator simulator(options);
+  std::string error;
+  ASSERT_TRUE(simulator.Start(&error)) << error;
+
+  ScanOptions scan;
+  scan.ranges = options.ranges;
+  scan.sample_count = 200;
+  scan.seed = 3;
+  scan.port = port;
+  scan.trace_port = port;
+  scan.tcping.min_valid_latency_ms = 0;
+  scan.tcping.interval_ms = 0;
+  scan.tcping.max_inflight = 4;
+  scan.tcping.adaptive_inflight = false;
+  scan.tcping.stop_after_good = 5;
+  scan.tcping.failure_window = 0;
+  scan.result_count = 3;
+  NodeScanner scanner(scan);
+  std::vector<ScanResult> ranked;
+  ScanSummary summary;
+  ASSERT_TRUE(scanner.Run(&ranked, &summary));
+  EXPECT_EQ(summary.stop_reason, StopReason::kEnoughGood);
+  EXPECT_LT(summary.probed, summary.sampled);
+  ASSERT_EQ(ranked.size(), 3u);
+  for (const ScanResult& result : ranked) {
+    EXPECT_EQ(simulator.ProfileFor(result.ip).name, "good");
+    EXPECT_EQ(result.colo, "NRT");
+  }
+
+  // 没有模拟的 127.77.1.0/24 全部拒绝连接，因失败过多而结束
+  scan.ranges = {{kBase + 0x100 + 1, kBase + 0x100 + 254}};
+  scan.tcping.failure_window = 20;
+  NodeScanner dead_scanner(scan);
+  ASSERT_TRUE(dead_scanner.Run(&ranked, &summary));
+  EXPECT_EQ(summary.stop_reason, StopReason::kTooManyFailures);
+  EXPECT_TRUE(ranked.empty());
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace cfvpn
@@ -0,0 +1,118 @@
+// 进程看护测试中代替 v2ray 的子进程。
+//
+//   cfvpn_fake_v2ray [--delay MS] [--listen PORT]... [--no-banner]
+//                    [--stderr TEXT] [--tail TEXT] [--exit-after MS]
+//                    [--exit-code N] [--fail-until FILE N] [--ignore-term]
+//
+// 等待 --delay 后监听各端口，然后像 v2ray 一样打印 "... started"，
+// 之后一直运行，直到 --exit-after 到期或被信号结束。
+// --fail-until 在 FILE 中记录启动次数，前 N 次启动立即以退出码 3 退出。
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool Listen(int port) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  int reuse = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+             0 &&
+         ::listen(fd, 16) == 0;
+}
+
+// 读取并递增启动计数，返回本次是第几次启动（从 1 开始）
+int CountLaunch(const char* path) {
+  int count = 0;
+  if (FILE* file = std::fopen(path, "r")) {
+    if (std::fscanf(file, "%d", &count) != 1) count = 0;
+    std::fclose(file);
+  }
+  ++count;
+  if (FILE* file = std::fopen(path, "w")) {
+    std::fprintf(file, "%d\n", count);
+    std::fclose(file);
+  }
+  return count;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int delay_ms = 0;
+  int exit_after_ms = -1;
+  int exit_code = 0;
+  bool banner = true;
+  std::vector<int> ports;
+  std::string stderr_text;
+  std::string tail;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--delay" && has_value) {
+      delay_ms = std::atoi(argv[++i]);
+    } else if (arg == "--listen" && has_value) {
+      ports.push_back(std::atoi(argv[++i]));
+    } else if (arg == "--no-banner") {
+      banner = false;
+    } else if (arg == "--stderr" && has_value) {
+      stderr_text = argv[++i];
+    } else if (arg == "--tail" && has_value) {
+      tail = argv[++i];
+    } else if (arg == "--exit-after" && has_value) {
+      exit_after_ms = std::atoi(argv[++i]);
+    } else if (arg == "--exit-code" && has_value) {
+      exit_code = std::atoi(argv[++i]);
+    } else if (arg == "--fail-until" && i + 2 < argc) {
+      const char* path = argv[++i];
+      const int failures = std::atoi(argv[++i]);
+      if (CountLaunch(path) <= failures) {
+        std::fprintf(stderr, "panic: simulated crash\n");
+        return 3;
+      }
+    } else if (arg == "--ignore-term") {
+      ::signal(SIGTERM, SIG_IGN);
+    }
+  }
+
+  if (!stderr_text.empty()) {
+    std::fprintf(stderr, "%s\n", stderr_text.c_str());
+    std::fflush(stderr);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+  for (int port : ports) {
+    if (!Listen(port)) {
+      std::fprintf(stderr, "failed to listen on %d: %s\n", port,
+                   std::strerror(errno));
+      return 2;
+    }
+  }
+  std::printf("[Info] transport/internet/tcp: listening TCP\n");
+  if (banner) std::printf("[Warning] core: V2Ray 5.0.0 started\r\n");
+  std::fflush(stdout);
+
+  if (exit_after_ms >= 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(exit_after_ms));
+    std::printf("%s", tail.c_str());
+    std::fflush(stdout);
+    return exit_code;
+  }
+  for (;;) ::pause();
+}
@@ -0,0 +1,248 @@
+#include "core/full_scanner.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "edge_simulator.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+namespace fs = std::filesystem;
+
+// 6 个 /24，其中后两个没有模拟器监听；各段都比 /24 小，监听套接字很少
+constexpr char kScanRanges[] =
+    "127.88.0.0/30,127.88.1.8/30,127.88.2.0/31,127.88.3.5/32,"
+    "127.88.4.0/30,127.88.5.0/30";
+constexpr char kServedRanges[] =
+    "127.88.0.0/30,127.88.1.8/30,127.88.2.0/31,127.88.3.5/32";
+
+std::vector<Ipv4Range> Ranges(const char* text) {
+  std::vector<Ipv4Range> ranges;
+  EXPECT_EQ(ParseCidrList(text, &ranges), 0u);
+  return ranges;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+// 结果文件中每行的 IP（去掉表头）
+std::vector<std::string> CsvIps(const std::string& path) {
+  std::vector<std::string> ips;
+  std::istringstream lines(ReadFile(path));
+  std::string line;
+  std::getline(lines, line);
+  EXPECT_EQ(line, "ip,port,latency_ms,loss_rate,sent,received");
+  while (std::getline(lines, line)) {
+    ips.push_back(line.substr(0, line.find(',')));
+  }
+  return ips;
+}
+
+class FullScannerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = fs::path(::testing::TempDir()) /
+           (std::string("full_scan_") +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    fs::remove_all(dir_);
+    fs::create_directories(dir_);
+
+    port_ = testing::UnusedLoopbackPort();
+    testing::EdgeSimulatorOptions simulator_options;
+    simulator_options.ranges = Ranges(kServedRanges);
+    simulator_options.ports = {port_};
+    simulator_ = std::make_unique<testing::EdgeSimulator>(simulator_options);
+    std::string error;
+    ASSERT_TRUE(simulator_->Start(&error)) << error;
+  }
+
+  void TearDown() override {
+    simulator_.reset();
+    fs::remove_all(dir_);
+  }
+
+  std::string Path(const char* name) const { return (dir_ / name).string(); }
+
+  FullScanOptions Options() const {
+    FullScanOptions options;
+    options.ranges = Ranges(kScanRanges);
+    options.seed = 11;
+    options.port = port_;
+    options.tcping.attempts = 1;
+    options.tcping.min_valid_latency_ms = 0;
+    options.tcping.interval_ms = 0;
+    options.tcping.adaptive_inflight = false;
+    options.tcping.max_inflight = 8;
+    options.chunk_blocks = 2;
+    options.output_path = Path("scan.csv");
+    options.checkpoint_path = Path("scan.checkpoint");
+    return options;
+  }
+
+  fs::path dir_;
+  uint16_t port_ = 0;
+  std::unique_ptr<testing::EdgeSimulator> simulator_;
+};
+
+TEST_F(FullScannerTest, TestsEveryBlockOnce) {
+  FullScanOptions options = Options();
+  options.write_failures = true;
+  FullScanner scanner(options);
+  std::vector<uint64_t> progress;
+  std::string error;
+  ASSERT_TRUE(scanner.Run(&error, [&](uint64_t done, uint64_t total) {
+    EXPECT_EQ(total, 6u);
+    progress.push_back(done);
+  })) << error;
+
+  EXPECT_EQ(scanner.total_blocks(), 6u);
+  EXPECT_EQ(scanner.done_blocks(), 6u);
+  EXPECT_EQ(scanner.resumed_from(), 0u);
+  EXPECT_EQ(scanner.reachable(), 4u);
+  EXPECT_EQ(progress.size(), 6u);
+  EXPECT_EQ(progress.back(), 6u);
+
+  const std::vector<std::string> ips = CsvIps(options.output_path);
+  ASSERT_EQ(ips.size(), 6u);
+  std::set<uint32_t> blocks;
+  const Ipv4RangeIndex index(options.ranges);
+  for (const std::string& text : ips) {
+    uint32_t ip = 0;
+    ASSERT_TRUE(ParseIpv4(text.c_str(), &ip)) << text;
+    EXPECT_TRUE(index.Contains(ip)) << text;
+    EXPECT_NE(ip & 0xFF, 0u) << text;  // 段内有 .1 ~ .254 时不取 .0
+    blocks.insert(ip >> 8);
+  }
+  EXPECT_EQ(blocks.size(), 6u);
+  ASSERT_EQ(scanner.best().size(), 4u);
+  EXPECT_LE(scanner.best()[0].latency_ms, scanner.best()[3].latency_ms);
+
+  // 已完成的检查点：再次运行不做任何探测，但能从结果文件恢复最优节点
+  FullScanner again(options);
+  ASSERT_TRUE(again.Run(&error)) << error;
+  EXPECT_EQ(again.resumed_from(), 6u);
+  EXPECT_EQ(again.reachable(), 4u);
+  EXPECT_EQ(again.best().size(), 4u);
+  EXPECT_EQ(CsvIps(options.output_path).size(), 6u);
+}
+
+// 被取消后续扫：检查点之后写入的半行被截掉，最终结果与一次跑完相同
+TEST_F(FullScannerTest, ResumesFromCheckpoint) {
+  FullScanOptions reference_options = Options();
+  reference_options.output_path = Path("reference.csv");
+  reference_options.checkpoint_path.clear();
+  FullScanner reference(reference_options);
+  std::string error;
+  ASSERT_TRUE(reference.Run(&error)) << error;
+  const std::vector<std::string> expected =
+      CsvIps(reference_options.output_path);
+  ASSERT_EQ(expected.size(), 4u);
+
+  const FullScanOptions options = Options();
+  FullScanner first(options);
+  ASSERT_TRUE(first.Run(&error, [&](uint64_t done, uint64_t) {
+    if (done >= 3) first.Cancel();  // 第二批中途取消
+  })) << error;
+  EXPECT_TRUE(first.cancelled());
+  EXPECT_EQ(first.done_blocks(), 2u);
+  EXPECT_NE(ReadFile(options.checkpoint_path).find("\"position\":2"),
+            std::string::npos);
+
+  // 模拟进程在写检查点之前被杀死，结果文件多出半行
+  std::ofstream(options.output_path, std::ios::binary | std::ios::app)
+      << "127.88.9.9,1";
+
+  FullScanner second(options);
+  std::vector<uint64_t> progress;
+  ASSERT_TRUE(second.Run(&error, [&](uint64_t done, uint64_t) {
+    progress.push_back(done);
+  })) << error;
+  EXPECT_EQ(second.resumed_from(), 2u);
+  EXPECT_EQ(second.done_blocks(), 6u);
+  EXPECT_EQ(progress.size(), 4u);  // 只测剩下的 4 个 /24
+  EXPECT_EQ(second.reachable(), 4u);
+  EXPECT_EQ(CsvIps(options.output_path), expected);
+}
+
+TEST_F(FullScannerTest, ChangedParametersRestart) {
+  FullScanOptions options = Options();
+  FullScanner first(options);
+  std::string error;
+  ASSERT_TRUE(first.Run(&error)) << error;
+
+  options.seed = 12;  // 遍历顺序变了，旧检查点不能用
+  FullScanner reseeded(options);
+  ASSERT_TRUE(reseeded.Run(&error)) << error;
+  EXPECT_EQ(reseeded.resumed_from(), 0u);
+  EXPECT_EQ(CsvIps(options.output_path).size(), 4u);
+
+  options.restart = true;
+  FullScanner restarted(options);
+  ASSERT_TRUE(restarted.Run(&error)) << error;
+  EXPECT_EQ(restarted.resumed_from(), 0u);
+  EXPECT_EQ(CsvIps(options.output_path).size(), 4u);
+
+  options.output_path = (dir_ / "missing" / "scan.csv").string();
+  FullScanner broken(options);
+  EXPECT_FALSE(broken.Run(&error));
+  EXPECT_FALSE(error.empty());
+}
+
+TEST_F(FullScannerTest, CApiRunsToCompletion) {
+  const std::string output = Path("api.csv");
+  const std::string checkpoint = Path("api.checkpoint");
+  CfvpnFullScanOptions options = {};
+  options.ranges = kScanRanges;
+  options.output_path = output.c_str();
+  options.checkpoint_path = checkpoint.c_str();
+  options.seed = 3;
+  options.port = port_;
+  options.attempts = 1;
+  options.min_valid_latency_ms = 0;
+  options.max_inflight = 8;
+  options.keep_best = 2;
+  CfvpnFullScanJob* job = cfvpn_full_scan_start(&options);
+  ASSERT_NE(job, nullptr);
+
+  CfvpnFullScanStatus status = {};
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  do {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    cfvpn_full_scan_status(job, &status);
+  } while (status.state == CFVPN_FULL_SCAN_RUNNING &&
+           std::chrono::steady_clock::now() < deadline);
+  ASSERT_EQ(status.state, CFVPN_FULL_SCAN_COMPLETED);
+  EXPECT_EQ(status.total_blocks, 6);
+  EXPECT_EQ(status.done_blocks, 6);
+  char error[64];
+  EXPECT_EQ(cfvpn_full_scan_error(job, error, sizeof(error)), 0);
+
+  CfvpnProbeResult best[4];
+  ASSERT_EQ(cfvpn_full_scan_best(job, best, 4), 2);
+  EXPECT_EQ(best[0].port, port_);
+  EXPECT_EQ(best[0].ip >> 16, 0x7F58u);  // 127.88.x.x
+  cfvpn_full_scan_free(job);
+
+  options.output_path = nullptr;
+  EXPECT_EQ(cfvpn_full_scan_start(&options), nullptr);
+}
+
+}  // namespace
+}  // namespace cfvpn
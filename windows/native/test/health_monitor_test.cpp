@@ -0,0 +1,243 @@
+#include "core/health_monitor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+using testing::LoopbackServer;
+
+// 按端口号（即节点下标）返回预设的握手耗时，-1 表示失败
+struct FakeNetwork {
+  HealthMonitor::Prober prober() {
+    return [this](const ProbeTarget& target, int) {
+      return latency[target.port].load();
+    };
+  }
+
+  std::atomic<int32_t> latency[3] = {{20}, {40}, {60}};
+};
+
+std::vector<ProbeTarget> FakeNodes() {
+  return {{kLoopbackIp, 0}, {kLoopbackIp, 1}, {kLoopbackIp, 2}};
+}
+
+HealthMonitorOptions FastOptions() {
+  HealthMonitorOptions options;
+  options.cooldown_ms = 0;
+  options.seed = 1;
+  return options;
+}
+
+void ProbeAll(HealthMonitor* monitor, int rounds) {
+  for (int round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < 3; ++i) monitor->ProbeOnce(i);
+  }
+}
+
+TEST(NodeHealthTest, TracksLatencyJitterAndLoss) {
+  NodeHealth node;
+  EXPECT_TRUE(std::isinf(node.Score()));
+  node.Add(100, 0.5);
+  EXPECT_DOUBLE_EQ(node.latency_ms, 100);
+  EXPECT_DOUBLE_EQ(node.jitter_ms, 0);
+  node.Add(60, 0.5);
+  EXPECT_DOUBLE_EQ(node.latency_ms, 80);
+  EXPECT_DOUBLE_EQ(node.jitter_ms, 20);
+  EXPECT_DOUBLE_EQ(node.Score(), 100);
+
+  node.Add(-1, 0.5);
+  node.Add(-1, 0.5);
+  EXPECT_EQ(node.failure_streak, 2);
+  EXPECT_DOUBLE_EQ(node.loss_rate, 0.75);
+  // 失败不改变延迟，只放大得分
+  EXPECT_DOUBLE_EQ(node.latency_ms, 80);
+  EXPECT_DOUBLE_EQ(node.Score(), 80 * 4 + 20);
+  node.Add(60, 0.5);
+  EXPECT_EQ(node.failure_streak, 0);
+  EXPECT_EQ(node.samples, 5);
+}
+
+TEST(HealthMonitorTest, StaysOnHealthyNode) {
+  FakeNetwork network;
+  HealthMonitor monitor(FastOptions(), FakeNodes(), network.prober());
+  ProbeAll(&monitor, 10);
+  EXPECT_EQ(monitor.active(), 0u);
+  EXPECT_EQ(monitor.failovers(), 0);
+  for (const NodeHealth& node : monitor.Snapshot()) {
+    EXPECT_FALSE(node.degraded);
+    EXPECT_EQ(node.samples, 10);
+  }
+}
+
+TEST(HealthMonitorTest, FailsOverAfterSustainedDegradation) {
+  FakeNetwork network;
+  HealthMonitor monitor(FastOptions(), FakeNodes(), network.prober());
+  std::vector<std::pair<size_t, size_t>> switches;
+  monitor.set_failover_callback(
+      [&](size_t from, size_t to) { switches.push_back({from, to}); });
+  ProbeAll(&monitor, 4);
+
+  // 当前节点延迟升到阈值以上；EWMA 越过阈值后还需连续 degraded_checks 次
+  network.latency[0] = 900;
+  monitor.ProbeOnce(0);
+  EXPECT_EQ(monitor.active(), 0u);
+  for (int i = 0; i < 5 && monitor.active() == 0; ++i) monitor.ProbeOnce(0);
+  ASSERT_EQ(monitor.active(), 1u);  // 备用节点中得分最好的
+  ASSERT_EQ(switches.size(), 1u);
+  EXPECT_EQ(switches[0].first, 0u);
+  EXPECT_EQ(switches[0].second, 1u);
+  EXPECT_EQ(monitor.failovers(), 1);
+
+  // 探测原节点不会触发切换，只有当前节点参与判定
+  ProbeAll(&monitor, 3);
+  EXPECT_EQ(monitor.active(), 1u);
+}
+
+TEST(HealthMonitorTest, ConsecutiveFailuresSwitchImmediately) {
+  FakeNetwork network;
+  HealthMonitorOptions options = FastOptions();
+  options.degraded_checks = 100;
+  HealthMonitor monitor(options, FakeNodes(), network.prober());
+  ProbeAll(&monitor, 4);
+
+  network.latency[0] = -1;
+  network.latency[1] = -1;
+  for (int i = 0; i < options.max_failure_streak - 1; ++i) {
+    monitor.ProbeOnce(0);
+  }
+  EXPECT_EQ(monitor.active(), 0u);
+  monitor.ProbeOnce(1);
+  monitor.ProbeOnce(0);
+  // 最近失败过的备用节点不作为切换目标
+  EXPECT_EQ(monitor.active(), 2u);
+}
+
+TEST(HealthMonitorTest, RespectsMarginAndCooldown) {
+  FakeNetwork network;
+  HealthMonitorOptions options = FastOptions();
+  options.max_latency_ms = 50;
+  HealthMonitor monitor(options, FakeNodes(), network.prober());
+  network.latency[0] = 55;
+  network.latency[1] = 50;
+  network.latency[2] = 50;
+  ProbeAll(&monitor, 10);
+  // 当前节点超过阈值，但备用节点好得不够多
+  EXPECT_TRUE(monitor.Snapshot()[0].degraded);
+  EXPECT_EQ(monitor.active(), 0u);
+
+  network.latency[0] = -1;
+  for (int i = 0; i < options.max_failure_streak; ++i) monitor.ProbeOnce(0);
+  ASSERT_EQ(monitor.active(), 1u);
+
+  // 冷却期内即使新的当前节点失效也不再切换
+  HealthMonitorOptions cooled = options;
+  cooled.cooldown_ms = 60000;
+  HealthMonitor slow(cooled, FakeNodes(), network.prober());
+  network.latency[0] = 20;
+  ProbeAll(&slow, 4);
+  network.latency[0] = -1;
+  for (int i = 0; i < cooled.max_failure_streak; ++i) slow.ProbeOnce(0);
+  ASSERT_EQ(slow.active(), 1u);
+  network.latency[1] = -1;
+  for (int i = 0; i < cooled.max_failure_streak + 2; ++i) slow.ProbeOnce(1);
+  EXPECT_EQ(slow.active(), 1u);
+  EXPECT_EQ(slow.failovers(), 1);
+}
+
+TEST(HealthMonitorTest, TcpHandshakeMeasuresLoopback) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+  EXPECT_GE(HealthMonitor::TcpHandshake({kLoopbackIp, server.port()}, 1000), 0);
+  EXPECT_EQ(HealthMonitor::TcpHandshake(
+                {kLoopbackIp, testing::UnusedLoopbackPort()}, 1000),
+            -1);
+}
+
+TEST(HealthMonitorTest, FailsOverWhenActiveNodeGoesAway) {
+  auto primary = std::make_unique<LoopbackServer>();
+  LoopbackServer standby;
+  ASSERT_TRUE(primary->ok());
+  ASSERT_TRUE(standby.ok());
+
+  HealthMonitorOptions options;
+  options.active_interval_ms = 10;
+  options.standby_interval_ms = 20;
+  options.timeout_ms = 200;
+  options.seed = 1;
+  HealthMonitor monitor(options, {{kLoopbackIp, primary->port()},
+                                  {kLoopbackIp, standby.port()}});
+  std::atomic<int> switched{0};
+  monitor.set_failover_callback([&](size_t from, size_t to) {
+    if (from == 0 && to == 1) switched++;
+  });
+  monitor.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(monitor.active(), 0u);
+
+  primary.reset();
+  const int64_t deadline = MonotonicMicros() + 3 * 1000 * 1000;
+  while (switched.load() == 0 && MonotonicMicros() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  monitor.Stop();
+  EXPECT_EQ(switched.load(), 1);
+  EXPECT_EQ(monitor.active(), 1u);
+  const std::vector<NodeHealth> nodes = monitor.Snapshot();
+  EXPECT_GE(nodes[0].failure_streak, options.max_failure_streak);
+  EXPECT_GT(nodes[1].samples, 0);
+}
+
+TEST(NativeApiTest, HealthMonitorRoundTrip) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  CfvpnIpAddress addresses[2] = {};
+  const uint8_t loopback[4] = {127, 0, 0, 1};
+  for (CfvpnIpAddress& address : addresses) {
+    address.family = 4;
+    std::memcpy(address.bytes, loopback, sizeof(loopback));
+  }
+  CfvpnHealthOptions options = {};
+  options.active_interval_ms = 10;
+  options.standby_interval_ms = 10;
+  CfvpnHealthMonitor* monitor =
+      cfvpn_health_monitor_start(addresses, 2, server.port(), &options);
+  ASSERT_NE(monitor, nullptr);
+
+  CfvpnNodeHealth nodes[3] = {};
+  const int64_t deadline = MonotonicMicros() + 2 * 1000 * 1000;
+  do {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(cfvpn_health_monitor_snapshot(monitor, nodes, 3), 2);
+  } while ((nodes[0].samples < 2 || nodes[1].samples < 2) &&
+           MonotonicMicros() < deadline);
+  EXPECT_EQ(cfvpn_health_monitor_active(monitor), 0);
+  EXPECT_EQ(cfvpn_health_monitor_failovers(monitor), 0);
+  EXPECT_EQ(nodes[0].active, 1);
+  EXPECT_EQ(nodes[1].active, 0);
+  EXPECT_GE(nodes[0].latency_ms, 0);
+  EXPECT_EQ(nodes[0].failure_streak, 0);
+  EXPECT_EQ(nodes[0].degraded, 0);
+  cfvpn_health_monitor_free(monitor);
+
+  EXPECT_EQ(cfvpn_health_monitor_start(addresses, 0, server.port(), &options),
+            nullptr);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,247 @@
+#include "core/http_probe_engine.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+using testing::LoopbackServer;
+
+// 模拟 /cdn-cgi/trace 的回环服务器行为
+struct TraceServerOptions {
+  int status = 200;
+  bool close_after_response = false;
+  bool chunked = false;
+  int delay_ms = 0;  // 回复前的等待，用于制造超时
+};
+
+// 逐个读取请求并回复 trace 响应，返回处理的请求数
+int ServeTrace(NativeSocket client, const TraceServerOptions& options,
+               std::atomic<int>* requests) {
+  std::string pending;
+  char buffer[1024];
+  int served = 0;
+  for (;;) {
+    size_t end = pending.find("\r\n\r\n");
+    if (end == std::string::npos) {
+      ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        return served;
+      }
+      pending.append(buffer, static_cast<size_t>(n));
+      continue;
+    }
+    pending.erase(0, end + 4);
+    requests->fetch_add(1);
+    if (options.delay_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(options.delay_ms));
+    }
+
+    const std::string body =
+        "fl=1\nh=cloudflare.com\nip=127.0.0.1\ncolo=NRT\nloc=JP\ntls=off\n";
+    std::string response = "HTTP/1.1 " + std::to_string(options.status) +
+                           " Status\r\nContent-Type: text/plain\r\n";
+    if (options.close_after_response) {
+      response += "Connection: close\r\n";
+    }
+    if (options.chunked) {
+      char size[16];
+      std::snprintf(size, sizeof(size), "%zx", body.size());
+      response += "Transfer-Encoding: chunked\r\n\r\n" + std::string(size) +
+                  "\r\n" + body + "\r\n0\r\n\r\n";
+    } else {
+      response += "Content-Length: " + std::to_string(body.size()) +
+                  "\r\n\r\n" + body;
+    }
+    ::send(client, response.data(), response.size(), MSG_NOSIGNAL);
+    ++served;
+    if (options.close_after_response) {
+      return served;
+    }
+  }
+}
+
+HttpProbeOptions LoopbackOptions() {
+  HttpProbeOptions options;
+  options.requests = 3;
+  options.timeout_ms = 1000;
+  options.max_inflight = 32;
+  return options;
+}
+
+TEST(HttpProbeEngineTest, ReusesKeepAliveConnection) {
+  std::atomic<int> requests(0);
+  TraceServerOptions server_options;
+  LoopbackServer server([&](NativeSocket client) {
+    ServeTrace(client, server_options, &requests);
+  });
+  ASSERT_TRUE(server.ok());
+
+  HttpProbeEngine engine(LoopbackOptions());
+  std::vector<HttpProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()}}, &results));
+
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].status, 200);
+  EXPECT_EQ(results[0].sent, 3);
+  EXPECT_EQ(results[0].received, 3);
+  EXPECT_GE(results[0].connect_ms, 0);
+  EXPECT_GE(results[0].ttfb_ms, 0);
+  EXPECT_GE(results[0].total_ms, results[0].connect_ms);
+  EXPECT_STREQ(results[0].colo, "NRT");
+  EXPECT_STREQ(results[0].loc, "JP");
+  EXPECT_EQ(requests.load(), 3);
+  EXPECT_EQ(server.accepted(), 1);
+}
+
+TEST(HttpProbeEngineTest, ReconnectsWhenServerCloses) {
+  std::atomic<int> requests(0);
+  TraceServerOptions server_options;
+  server_options.close_after_response = true;
+  server_options.chunked = true;
+  LoopbackServer server([&](NativeSocket client) {
+    ServeTrace(client, server_options, &requests);
+  });
+  ASSERT_TRUE(server.ok());
+
+  HttpProbeEngine engine(LoopbackOptions());
+  std::vector<HttpProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()}}, &results));
+
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].received, 3);
+  EXPECT_STREQ(results[0].colo, "NRT");
+  EXPECT_EQ(server.accepted(), 3);
+}
+
+TEST(HttpProbeEngineTest, UnexpectedStatusIsFailure) {
+  std::atomic<int> requests(0);
+  TraceServerOptions server_options;
+  server_options.status = 403;
+  LoopbackServer server([&](NativeSocket client) {
+    ServeTrace(client, server_options, &requests);
+  });
+  ASSERT_TRUE(server.ok());
+
+  HttpProbeEngine engine(LoopbackOptions());
+  std::vector<HttpProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()}}, &results));
+
+  // 前两次都失败后放弃
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].status, 403);
+  EXPECT_EQ(results[0].sent, 2);
+  EXPECT_EQ(results[0].received, 0);
+  EXPECT_EQ(results[0].total_ms, -1);
+  EXPECT_EQ(results[0].ttfb_ms, -1);
+  // 失败的响应里也可能带有数据中心信息
+  EXPECT_STREQ(results[0].colo, "NRT");
+}
+
+TEST(HttpProbeEngineTest, SlowResponseTimesOut) {
+  std::atomic<int> requests(0);
+  TraceServerOptions server_options;
+  server_options.delay_ms = 300;
+  LoopbackServer server([&](NativeSocket client) {
+    ServeTrace(client, server_options, &requests);
+  });
+  ASSERT_TRUE(server.ok());
+
+  HttpProbeOptions options = LoopbackOptions();
+  options.timeout_ms = 100;
+  options.requests = 1;
+  HttpProbeEngine engine(options);
+  std::vector<HttpProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()}}, &results));
+
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].sent, 1);
+  EXPECT_EQ(results[0].received, 0);
+  EXPECT_GE(results[0].connect_ms, 0);
+  EXPECT_EQ(results[0].status, 0);
+}
+
+TEST(HttpProbeEngineTest, ProbesManyTargetsAndRefusedPorts) {
+  std::atomic<int> requests(0);
+  TraceServerOptions server_options;
+  LoopbackServer server([&](NativeSocket client) {
+    ServeTrace(client, server_options, &requests);
+  });
+  ASSERT_TRUE(server.ok());
+  const uint16_t closed_port = testing::UnusedLoopbackPort();
+
+  std::vector<ProbeTarget> targets;
+  for (int i = 0; i < 200; ++i) {
+    targets.push_back({kLoopbackIp, i % 4 == 3 ? closed_port : server.port()});
+  }
+  HttpProbeOptions options = LoopbackOptions();
+  options.requests = 2;
+  size_t callbacks = 0;
+  HttpProbeEngine engine(options);
+  std::vector<HttpProbeResult> results;
+  ASSERT_TRUE(engine.Run(
+      targets, &results,
+      [&callbacks](size_t, const HttpProbeResult&) { ++callbacks; }));
+
+  ASSERT_EQ(results.size(), targets.size());
+  EXPECT_EQ(callbacks, targets.size());
+  EXPECT_EQ(engine.completed(), targets.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].port, targets[i].port);
+    if (i % 4 == 3) {
+      EXPECT_EQ(results[i].received, 0) << i;
+      EXPECT_EQ(results[i].connect_ms, -1) << i;
+    } else {
+      EXPECT_EQ(results[i].received, 2) << i;
+    }
+  }
+}
+
+TEST(NativeApiTest, HttpProbeJobRoundTrip) {
+  std::atomic<int> requests(0);
+  TraceServerOptions server_options;
+  LoopbackServer server([&](NativeSocket client) {
+    ServeTrace(client, server_options, &requests);
+  });
+  ASSERT_TRUE(server.ok());
+
+  const uint32_t ips[] = {kLoopbackIp};
+  CfvpnHttpProbeOptions options = {1, 1000, 8, 200, nullptr, nullptr};
+  EXPECT_EQ(cfvpn_http_probe_start(nullptr, 1, server.port(), &options),
+            nullptr);
+  CfvpnHttpProbeJob* job =
+      cfvpn_http_probe_start(ips, 1, server.port(), &options);
+  ASSERT_NE(job, nullptr);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!cfvpn_http_probe_is_done(job) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_TRUE(cfvpn_http_probe_is_done(job));
+  EXPECT_EQ(cfvpn_http_probe_completed(job), 1);
+
+  CfvpnHttpProbeResult result;
+  ASSERT_EQ(cfvpn_http_probe_results(job, &result, 1), 1);
+  EXPECT_EQ(result.ip, kLoopbackIp);
+  EXPECT_EQ(result.status, 200);
+  EXPECT_EQ(result.received, 1);
+  EXPECT_STREQ(result.colo, "NRT");
+  EXPECT_STREQ(result.loc, "JP");
+  cfvpn_http_probe_free(job);
+}
+
+}  // namespace
+}  // namespace cfvpn
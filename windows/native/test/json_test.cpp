@@ -0,0 +1,81 @@
+#include "core/json.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace cfvpn {
+namespace {
+
+std::string RoundTrip(const std::string& text) {
+  JsonValue value;
+  std::string error;
+  EXPECT_TRUE(ParseJson(text, &value, &error)) << error;
+  std::string out;
+  AppendJson(value, &out);
+  return out;
+}
+
+TEST(JsonTest, ParsesAndSerializesCompactly) {
+  EXPECT_EQ(RoundTrip(R"( { "a" : [1, -2.5e3, true, false, null], "b": {} } )"),
+            R"({"a":[1,-2.5e3,true,false,null],"b":{}})");
+  // 成员保持原始顺序，数字保留原文
+  EXPECT_EQ(RoundTrip(R"({"z":1,"a":2,"m":0.10})"), R"({"z":1,"a":2,"m":0.10})");
+  EXPECT_EQ(RoundTrip("[]"), "[]");
+  EXPECT_EQ(RoundTrip("\"x\""), "\"x\"");
+}
+
+TEST(JsonTest, SkipsCommentsAndTrailingCommas) {
+  const std::string text = R"({
+    // 行注释 "不是字符串"
+    "url": "http://example.com/a//b", /* 块注释 */
+    "list": [1, 2, /* 中间 */ 3,],
+    "nested": {"k": "/* 保留 */",},
+  })";
+  EXPECT_EQ(RoundTrip(text),
+            R"({"url":"http://example.com/a//b","list":[1,2,3],)"
+            R"("nested":{"k":"/* 保留 */"}})");
+}
+
+TEST(JsonTest, HandlesEscapes) {
+  JsonValue value;
+  ASSERT_TRUE(ParseJson(R"("a\"b\\c\/d\n\t\u4e2d\ud83d\ude00\u0001")", &value,
+                        nullptr));
+  EXPECT_EQ(value.text, "a\"b\\c/d\n\t中\xF0\x9F\x98\x80\x01");
+  std::string out;
+  AppendJson(value, &out);
+  // 与 jsonEncode 一致：非 ASCII 原样输出，控制字符转义
+  EXPECT_EQ(out, R"("a\"b\\c/d\n\t中)" "\xF0\x9F\x98\x80" R"(\u0001")");
+}
+
+TEST(JsonTest, RejectsInvalidInput) {
+  JsonValue value;
+  std::string error;
+  for (const char* text :
+       {"", "{", "[1 2]", R"({"a" 1})", R"({a: 1})", "01x", "-", "1.",
+        "\"unterminated", "\"bad \\x escape\"", "/* open", "[1] 2", "tru",
+        "\"\\u12\"", "\"line\nbreak\""}) {
+    EXPECT_FALSE(ParseJson(text, &value, &error)) << text;
+    EXPECT_FALSE(error.empty());
+  }
+  std::string deep(100, '[');
+  deep += std::string(100, ']');
+  EXPECT_FALSE(ParseJson(deep, &value, &error));
+}
+
+TEST(JsonTest, FindsAndAddsMembers) {
+  JsonValue value;
+  ASSERT_TRUE(ParseJson(R"({"port": 7898, "name": "x"})", &value, nullptr));
+  ASSERT_NE(value.Find("port"), nullptr);
+  EXPECT_EQ(value.Find("port")->AsInt(), 7898);
+  EXPECT_EQ(value.Find("name")->AsInt(-1), -1);
+  EXPECT_EQ(value.Find("missing"), nullptr);
+  value.Member("added") = JsonValue::Number(5);
+  value.Member("name") = JsonValue::String("y");
+  std::string out;
+  AppendJson(value, &out);
+  EXPECT_EQ(out, R"({"port":7898,"name":"y","added":5})");
+}
+
+}  // namespace
+}  // namespace cfvpn
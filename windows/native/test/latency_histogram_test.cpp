@@ -0,0 +1,71 @@
+#include "core/latency_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace cfvpn {
+namespace {
+
+TEST(LatencyHistogramTest, BucketsAreContiguousWithBoundedError) {
+  EXPECT_EQ(LatencyHistogram::BucketFor(-5), 0);
+  EXPECT_EQ(LatencyHistogram::BucketFor(15), 15);
+  EXPECT_EQ(LatencyHistogram::BucketFor(16), 16);
+  EXPECT_EQ(LatencyHistogram::BucketFor(5000),
+            LatencyHistogram::kBuckets - 1);
+  for (int bucket = 0; bucket + 1 < LatencyHistogram::kBuckets; ++bucket) {
+    EXPECT_EQ(LatencyHistogram::BucketHigh(bucket),
+              LatencyHistogram::BucketLow(bucket + 1));
+  }
+  for (int32_t value = 0; value < 1024; ++value) {
+    const int bucket = LatencyHistogram::BucketFor(value);
+    ASSERT_GE(value, LatencyHistogram::BucketLow(bucket)) << value;
+    ASSERT_LT(value, LatencyHistogram::BucketHigh(bucket)) << value;
+    // 桶宽不超过下界的 1/8
+    EXPECT_LE((LatencyHistogram::BucketHigh(bucket) -
+               LatencyHistogram::BucketLow(bucket)) * 8,
+              std::max(8, LatencyHistogram::BucketLow(bucket)));
+  }
+}
+
+TEST(LatencyHistogramTest, PercentilesTrackSortedSamples) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.ValueAtPercentile(50), -1);
+
+  std::vector<int32_t> samples;
+  for (int32_t i = 1; i <= 100; ++i) samples.push_back(40 + i * 3);
+  for (int32_t sample : samples) histogram.Record(sample);
+  EXPECT_EQ(histogram.count(), 100);
+
+  const struct {
+    double percentile;
+    int32_t exact;
+  } cases[] = {{50, samples[49]}, {90, samples[89]}, {99, samples[98]}};
+  for (const auto& c : cases) {
+    const int32_t value = histogram.ValueAtPercentile(c.percentile);
+    EXPECT_LE(std::abs(value - c.exact), c.exact / 16 + 1) << c.percentile;
+  }
+  EXPECT_LE(histogram.ValueAtPercentile(0), histogram.ValueAtPercentile(100));
+
+  histogram.Clear();
+  EXPECT_EQ(histogram.count(), 0);
+}
+
+TEST(LatencyHistogramTest, TailShowsUpAtHighPercentiles) {
+  LatencyHistogram histogram;
+  for (int i = 0; i < 9; ++i) histogram.Record(50);
+  histogram.Record(400);
+  EXPECT_EQ(histogram.ValueAtPercentile(50), 50);
+  EXPECT_EQ(histogram.ValueAtPercentile(90), 50);
+  EXPECT_GE(histogram.ValueAtPercentile(99), 384);
+
+  // 计数饱和而不回绕
+  LatencyHistogram saturated;
+  for (int i = 0; i < 300; ++i) saturated.Record(1);
+  EXPECT_EQ(saturated.count(), 255);
+}
+
+}  // namespace
+}  // namespace cfvpn
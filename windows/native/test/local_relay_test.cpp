@@ -0,0 +1,447 @@
+#include "core/local_relay.h"
+
+#include <gtest/gtest.h>
+#include <poll.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+using testing::LoopbackServer;
+using testing::UnusedLoopbackPort;
+
+// 代替 v2ray 入站：原样回显，对端关闭写方向后退出
+void Echo(NativeSocket client) {
+  char buffer[16 * 1024];
+  for (;;) {
+    const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+    if (n <= 0) return;
+    if (::send(client, buffer, static_cast<size_t>(n), MSG_NOSIGNAL) != n) {
+      return;
+    }
+  }
+}
+
+// 读到 EOF 后回复 reply_bytes 个字节并关闭
+LoopbackServer::Handler Sink(size_t reply_bytes) {
+  return [reply_bytes](NativeSocket client) {
+    char buffer[64 * 1024];
+    while (::recv(client, buffer, sizeof(buffer), 0) > 0) {
+    }
+    const std::vector<char> reply(reply_bytes, 'r');
+    size_t sent = 0;
+    while (sent < reply.size()) {
+      const ssize_t n = ::send(client, reply.data() + sent,
+                               reply.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) return;
+      sent += static_cast<size_t>(n);
+    }
+  };
+}
+
+NativeSocket Connect(uint16_t port) {
+  NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, 0);
+  const sockaddr_in address = MakeSockaddrV4(kLoopbackIp, port);
+  if (::connect(socket, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    CloseSocket(socket);
+    return kInvalidSocket;
+  }
+  timeval timeout = {5, 0};
+  ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return socket;
+}
+
+bool SendAll(NativeSocket socket, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t n = ::send(socket, data.data() + sent, data.size() - sent,
+                             MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+std::string Receive(NativeSocket socket, size_t bytes) {
+  std::string data;
+  char buffer[16 * 1024];
+  while (data.size() < bytes) {
+    const ssize_t n = ::recv(socket, buffer,
+                             std::min(sizeof(buffer), bytes - data.size()), 0);
+    if (n <= 0) break;
+    data.append(buffer, static_cast<size_t>(n));
+  }
+  return data;
+}
+
+// 读到 EOF 为止，返回字节数；出错返回 -1
+int64_t ReceiveUntilClose(NativeSocket socket) {
+  int64_t total = 0;
+  char buffer[64 * 1024];
+  for (;;) {
+    const ssize_t n = ::recv(socket, buffer, sizeof(buffer), 0);
+    if (n == 0) return total;
+    if (n < 0) return -1;
+    total += n;
+  }
+}
+
+// 计数器在工作线程里更新，客户端收到数据时可能还没记完
+template <typename Predicate>
+bool WaitFor(Predicate predicate) {
+  for (int i = 0; i < 200; ++i) {
+    if (predicate()) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return predicate();
+}
+
+std::string Socks5Connect(uint8_t type, const std::string& address,
+                          uint16_t port) {
+  std::string data = {0x05, 0x01, 0x00};  // 方法协商
+  data += {0x05, 0x01, 0x00, static_cast<char>(type)};
+  if (type == 0x03) data.push_back(static_cast<char>(address.size()));
+  data += address;
+  data.push_back(static_cast<char>(port >> 8));
+  data.push_back(static_cast<char>(port & 0xFF));
+  return data;
+}
+
+TEST(SniffProxyDestinationTest, RecognizesHttpProxyRequests) {
+  std::string destination;
+  EXPECT_EQ(SniffProxyDestination("CONNECT Example.COM:8443 HTTP/1.1\r\n",
+                                  &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "example.com:8443");
+  EXPECT_EQ(SniffProxyDestination(
+                "GET http://user@host.test/a?b HTTP/1.1\r\nHost: x\r\n\r\n",
+                &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "host.test:80");
+  EXPECT_EQ(SniffProxyDestination("CONNECT [2001:db8::1]:443 HTTP/1.1\r\n",
+                                  &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "[2001:db8::1]:443");
+  EXPECT_EQ(SniffProxyDestination(
+                "GET / HTTP/1.1\r\nAccept: */*\r\nhost:  a.test:81 \r\n\r\n",
+                &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "a.test:81");
+
+  EXPECT_EQ(SniffProxyDestination("CONNECT a.test:443 HT", &destination),
+            SniffStatus::kNeedMore);
+  EXPECT_EQ(SniffProxyDestination("GET / HTTP/1.1\r\nAccept: */*\r\n",
+                                  &destination),
+            SniffStatus::kNeedMore);
+  EXPECT_EQ(SniffProxyDestination("GET / HTTP/1.1\r\n\r\n", &destination),
+            SniffStatus::kUnknown);
+  EXPECT_EQ(SniffProxyDestination("CONNECT a.test:0 HTTP/1.1\r\n",
+                                  &destination),
+            SniffStatus::kUnknown);
+  EXPECT_EQ(SniffProxyDestination(std::string("\x16\x03\x01", 3),
+                                  &destination),
+            SniffStatus::kUnknown);
+}
+
+TEST(SniffProxyDestinationTest, RecognizesSocks5Connect) {
+  std::string destination;
+  EXPECT_EQ(SniffProxyDestination(Socks5Connect(0x03, "Host.Test", 443),
+                                  &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "host.test:443");
+  EXPECT_EQ(SniffProxyDestination(
+                Socks5Connect(0x01, std::string("\x01\x02\x03\x04", 4), 80),
+                &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "1.2.3.4:80");
+  std::string v6(16, '\0');
+  v6[15] = 1;
+  EXPECT_EQ(SniffProxyDestination(Socks5Connect(0x04, v6, 53), &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "[::1]:53");
+
+  // 用户名/密码子协商位于方法协商和请求之间
+  std::string with_auth = {0x05, 0x01, 0x02, 0x01, 0x01, 'u', 0x02, 'p', 'w'};
+  with_auth += Socks5Connect(0x03, "auth.test", 8080).substr(3);
+  EXPECT_EQ(SniffProxyDestination(with_auth, &destination),
+            SniffStatus::kFound);
+  EXPECT_EQ(destination, "auth.test:8080");
+
+  const std::string full = Socks5Connect(0x03, "host.test", 443);
+  for (size_t length = 1; length < full.size(); ++length) {
+    EXPECT_EQ(SniffProxyDestination(full.substr(0, length), &destination),
+              SniffStatus::kNeedMore)
+        << length;
+  }
+  std::string udp = full;
+  udp[4] = 0x03;  // UDP ASSOCIATE
+  EXPECT_EQ(SniffProxyDestination(udp, &destination), SniffStatus::kUnknown);
+}
+
+TEST(LocalRelayTest, RelaysAndCountsPerDestination) {
+  LoopbackServer upstream(Echo);
+  ASSERT_TRUE(upstream.ok());
+  LocalRelayOptions options;
+  options.upstream_port = upstream.port();
+  LocalRelay relay(options);
+  std::string error;
+  ASSERT_TRUE(relay.Start(&error)) << error;
+
+  const std::string request = "CONNECT example.com:443 HTTP/1.1\r\n\r\n";
+  const std::string payload(100 * 1024, 'p');
+  NativeSocket client = Connect(relay.port());
+  ASSERT_NE(client, kInvalidSocket);
+  ASSERT_TRUE(SendAll(client, request));
+  ASSERT_EQ(Receive(client, request.size()), request);
+  ASSERT_TRUE(SendAll(client, payload));
+  ASSERT_EQ(Receive(client, payload.size()), payload);
+
+  const uint64_t total = request.size() + payload.size();
+  ASSERT_TRUE(WaitFor([&] {
+    const std::vector<RelayConnection> connections = relay.Connections();
+    return connections.size() == 1 && connections[0].bytes_down == total;
+  }));
+  const std::vector<RelayConnection> connections = relay.Connections();
+  EXPECT_EQ(connections[0].destination, "example.com:443");
+  EXPECT_EQ(connections[0].bytes_up, total);
+
+  std::vector<RelayTalker> talkers = relay.TopTalkers(0);
+  ASSERT_EQ(talkers.size(), 1u);
+  EXPECT_EQ(talkers[0].destination, "example.com:443");
+  EXPECT_EQ(talkers[0].bytes_up, total);
+  EXPECT_EQ(talkers[0].bytes_down, total);
+  EXPECT_EQ(talkers[0].connections, 1u);
+  EXPECT_EQ(talkers[0].active, 1u);
+
+  CloseSocket(client);
+  ASSERT_TRUE(WaitFor([&] { return relay.stats().active == 0; }));
+  EXPECT_TRUE(relay.Connections().empty());
+  talkers = relay.TopTalkers(0);
+  ASSERT_EQ(talkers.size(), 1u);
+  EXPECT_EQ(talkers[0].active, 0u);
+
+  const LocalRelayStats stats = relay.stats();
+  EXPECT_EQ(stats.accepted, 1u);
+  EXPECT_EQ(stats.bytes_up, total);
+  EXPECT_EQ(stats.bytes_down, total);
+#if defined(__linux__)
+  EXPECT_TRUE(relay.zero_copy());
+  // 下行全程、上行识别出目标之后都经 splice
+  EXPECT_GE(stats.zero_copy_bytes, total);
+#endif
+}
+
+TEST(LocalRelayTest, TransfersLargePayloadsWithHalfClose) {
+  constexpr size_t kUpload = 8 * 1024 * 1024;
+  constexpr size_t kDownload = 16 * 1024 * 1024;
+  for (bool zero_copy : {true, false}) {
+    SCOPED_TRACE(zero_copy ? "splice" : "copy");
+    LoopbackServer upstream(Sink(kDownload));
+    ASSERT_TRUE(upstream.ok());
+    LocalRelayOptions options;
+    options.upstream_port = upstream.port();
+    options.zero_copy = zero_copy;
+    LocalRelay relay(options);
+    std::string error;
+    ASSERT_TRUE(relay.Start(&error)) << error;
+
+    NativeSocket client = Connect(relay.port());
+    ASSERT_NE(client, kInvalidSocket);
+    const std::string header = Socks5Connect(0x03, "bulk.test", 443);
+    ASSERT_TRUE(SendAll(client, header));
+    ASSERT_TRUE(SendAll(client, std::string(kUpload, 'u')));
+    ::shutdown(client, SHUT_WR);
+    EXPECT_EQ(ReceiveUntilClose(client), static_cast<int64_t>(kDownload));
+    CloseSocket(client);
+
+    ASSERT_TRUE(WaitFor([&] { return relay.stats().active == 0; }));
+    const LocalRelayStats stats = relay.stats();
+    const std::vector<RelayTalker> talkers = relay.TopTalkers(1);
+    ASSERT_EQ(talkers.size(), 1u);
+    EXPECT_EQ(talkers[0].destination, "bulk.test:443");
+    EXPECT_EQ(talkers[0].bytes_down, kDownload);
+    EXPECT_EQ(stats.bytes_down, kDownload);
+    EXPECT_EQ(talkers[0].bytes_up, header.size() + kUpload);
+    EXPECT_EQ(stats.bytes_up, header.size() + kUpload);
+    if (!zero_copy) {
+      EXPECT_EQ(stats.zero_copy_bytes, 0u);
+    }
+  }
+}
+
+TEST(LocalRelayTest, RanksTalkersAndOverflowsToOther) {
+  LoopbackServer upstream(Echo);
+  ASSERT_TRUE(upstream.ok());
+  LocalRelayOptions options;
+  options.upstream_port = upstream.port();
+  options.max_destinations = 2;
+  LocalRelay relay(options);
+  std::string error;
+  ASSERT_TRUE(relay.Start(&error)) << error;
+
+  // a.test 两条连接共 3 KB，b.test 5 KB，c.test 和 d.test 超出容量
+  const struct {
+    const char* host;
+    size_t bytes;
+  } kRequests[] = {{"a.test", 1024}, {"b.test", 5 * 1024},
+                   {"a.test", 2 * 1024}, {"c.test", 512}, {"d.test", 256}};
+  for (const auto& item : kRequests) {
+    NativeSocket client = Connect(relay.port());
+    ASSERT_NE(client, kInvalidSocket);
+    const std::string request =
+        "GET http://" + std::string(item.host) + "/ HTTP/1.1\r\n\r\n";
+    const std::string data = request + std::string(item.bytes, 'x');
+    ASSERT_TRUE(SendAll(client, data));
+    ASSERT_EQ(Receive(client, data.size()).size(), data.size());
+    CloseSocket(client);
+  }
+  ASSERT_TRUE(WaitFor([&] { return relay.stats().active == 0; }));
+
+  const std::vector<RelayTalker> talkers = relay.TopTalkers(0);
+  ASSERT_EQ(talkers.size(), 3u);
+  EXPECT_EQ(talkers[0].destination, "b.test:80");
+  EXPECT_EQ(talkers[1].destination, "a.test:80");
+  EXPECT_EQ(talkers[1].connections, 2u);
+  EXPECT_EQ(talkers[2].destination, "other");
+  EXPECT_EQ(talkers[2].connections, 2u);
+  EXPECT_EQ(relay.TopTalkers(1).size(), 1u);
+}
+
+TEST(LocalRelayTest, UnrecognizedTrafficIsCountedAsUnknown) {
+  LoopbackServer upstream(Echo);
+  ASSERT_TRUE(upstream.ok());
+  LocalRelayOptions options;
+  options.upstream_port = upstream.port();
+  LocalRelay relay(options);
+  std::string error;
+  ASSERT_TRUE(relay.Start(&error)) << error;
+
+  NativeSocket client = Connect(relay.port());
+  ASSERT_NE(client, kInvalidSocket);
+  const std::string data = "\x16\x03\x01 not a proxy request";
+  ASSERT_TRUE(SendAll(client, data));
+  ASSERT_EQ(Receive(client, data.size()), data);
+  CloseSocket(client);
+  ASSERT_TRUE(WaitFor([&] { return relay.stats().active == 0; }));
+  const std::vector<RelayTalker> talkers = relay.TopTalkers(0);
+  ASSERT_EQ(talkers.size(), 1u);
+  EXPECT_EQ(talkers[0].destination, "unknown");
+  EXPECT_EQ(talkers[0].bytes_up, data.size());
+}
+
+TEST(LocalRelayTest, ClosesClientWhenUpstreamIsDown) {
+  LocalRelayOptions options;
+  options.upstream_port = UnusedLoopbackPort();
+  LocalRelay relay(options);
+  std::string error;
+  ASSERT_TRUE(relay.Start(&error)) << error;
+
+  NativeSocket client = Connect(relay.port());
+  ASSERT_NE(client, kInvalidSocket);
+  SendAll(client, "CONNECT a.test:443 HTTP/1.1\r\n\r\n");
+  char byte;
+  EXPECT_LE(::recv(client, &byte, 1, 0), 0);
+  CloseSocket(client);
+  ASSERT_TRUE(WaitFor([&] { return relay.stats().upstream_failures == 1; }));
+  EXPECT_TRUE(WaitFor([&] { return relay.stats().active == 0; }));
+}
+
+TEST(LocalRelayTest, RejectsConnectionsOverLimit) {
+  LoopbackServer upstream(Echo);
+  ASSERT_TRUE(upstream.ok());
+  LocalRelayOptions options;
+  options.upstream_port = upstream.port();
+  options.max_connections = 1;
+  LocalRelay relay(options);
+  std::string error;
+  ASSERT_TRUE(relay.Start(&error)) << error;
+
+  NativeSocket first = Connect(relay.port());
+  ASSERT_NE(first, kInvalidSocket);
+  ASSERT_TRUE(WaitFor([&] { return relay.stats().active == 1; }));
+  NativeSocket second = Connect(relay.port());
+  ASSERT_NE(second, kInvalidSocket);
+  char byte;
+  EXPECT_LE(::recv(second, &byte, 1, 0), 0);
+  EXPECT_TRUE(WaitFor([&] { return relay.stats().rejected == 1; }));
+
+  // 第一条连接不受影响
+  ASSERT_TRUE(SendAll(first, "ping"));
+  EXPECT_EQ(Receive(first, 4), "ping");
+  CloseSocket(first);
+  CloseSocket(second);
+}
+
+TEST(LocalRelayTest, StopClosesConnections) {
+  LoopbackServer upstream(Echo);
+  ASSERT_TRUE(upstream.ok());
+  LocalRelayOptions options;
+  options.upstream_port = upstream.port();
+  LocalRelay relay(options);
+  std::string error;
+  ASSERT_TRUE(relay.Start(&error)) << error;
+  EXPECT_FALSE(relay.Start(&error));
+
+  NativeSocket client = Connect(relay.port());
+  ASSERT_NE(client, kInvalidSocket);
+  ASSERT_TRUE(WaitFor([&] { return relay.stats().active == 1; }));
+  relay.Stop();
+  char byte;
+  EXPECT_LE(::recv(client, &byte, 1, 0), 0);
+  EXPECT_EQ(relay.stats().active, 0u);
+  CloseSocket(client);
+  EXPECT_EQ(Connect(relay.port()), kInvalidSocket);
+}
+
+TEST(NativeApiTest, RelayRoundTrip) {
+  char error[256] = {};
+  CfvpnRelayOptions options = {};
+  EXPECT_EQ(cfvpn_relay_start(&options, error, sizeof(error)), nullptr);
+  EXPECT_GT(std::strlen(error), 0u);
+
+  LoopbackServer upstream(Echo);
+  ASSERT_TRUE(upstream.ok());
+  options.upstream_port = upstream.port();
+  options.disable_zero_copy = 1;
+  CfvpnRelay* relay = cfvpn_relay_start(&options, error, sizeof(error));
+  ASSERT_NE(relay, nullptr) << error;
+  const int32_t port = cfvpn_relay_port(relay);
+  ASSERT_GT(port, 0);
+
+  NativeSocket client = Connect(static_cast<uint16_t>(port));
+  ASSERT_NE(client, kInvalidSocket);
+  const std::string request = "CONNECT api.test:443 HTTP/1.1\r\n\r\n";
+  ASSERT_TRUE(SendAll(client, request));
+  ASSERT_EQ(Receive(client, request.size()), request);
+  CloseSocket(client);
+
+  CfvpnRelayStats stats = {};
+  ASSERT_TRUE(WaitFor([&] {
+    cfvpn_relay_stats(relay, &stats);
+    return stats.accepted == 1 && stats.active == 0;
+  }));
+  EXPECT_EQ(stats.zero_copy, 0);
+  EXPECT_EQ(stats.bytes_down, static_cast<int64_t>(request.size()));
+
+  CfvpnRelayTalker talkers[4];
+  ASSERT_EQ(cfvpn_relay_top_talkers(relay, talkers, 4), 1);
+  EXPECT_STREQ(talkers[0].destination, "api.test:443");
+  EXPECT_EQ(talkers[0].bytes_up, static_cast<int64_t>(request.size()));
+  EXPECT_EQ(talkers[0].connections, 1);
+  EXPECT_EQ(cfvpn_relay_top_talkers(relay, talkers, 0), 0);
+  cfvpn_relay_free(relay);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,92 @@
+#include "loopback_server.h"
+
+#include <poll.h>
+
+namespace cfvpn {
+namespace testing {
+
+namespace {
+
+NativeSocket BindLoopback(uint16_t* port) {
+  NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (socket == kInvalidSocket) {
+    return kInvalidSocket;
+  }
+  int reuse = 1;
+  ::setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = MakeSockaddrV4(kLoopbackIp, 0);
+  socklen_t length = sizeof(address);
+  if (::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      ::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) !=
+          0) {
+    CloseSocket(socket);
+    return kInvalidSocket;
+  }
+  *port = ntohs(address.sin_port);
+  return socket;
+}
+
+}  // namespace
+
+LoopbackServer::LoopbackServer(Handler handler, int backlog,
+                               bool accept_connections)
+    : handler_(std::move(handler)), stopping_(false), accepted_(0) {
+  listener_ = BindLoopback(&port_);
+  if (listener_ == kInvalidSocket) {
+    return;
+  }
+  if (::listen(listener_, backlog) != 0) {
+    CloseSocket(listener_);
+    listener_ = kInvalidSocket;
+    return;
+  }
+  if (accept_connections) {
+    acceptor_ = std::thread(&LoopbackServer::AcceptLoop, this);
+  }
+}
+
+LoopbackServer::~LoopbackServer() {
+  stopping_.store(true);
+  if (acceptor_.joinable()) {
+    acceptor_.join();
+  }
+  std::lock_guard<std::mutex> lock(workers_mutex_);
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  CloseSocket(listener_);
+}
+
+void LoopbackServer::AcceptLoop() {
+  while (!stopping_.load()) {
+    pollfd entry = {listener_, POLLIN, 0};
+    if (::poll(&entry, 1, 20) <= 0) {
+      continue;
+    }
+    NativeSocket client = ::accept(listener_, nullptr, nullptr);
+    if (client == kInvalidSocket) {
+      continue;
+    }
+    accepted_.fetch_add(1);
+    if (!handler_) {
+      CloseSocket(client);
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(workers_mutex_);
+    workers_.emplace_back([this, client]() {
+      handler_(client);
+      CloseSocket(client);
+    });
+  }
+}
+
+uint16_t UnusedLoopbackPort() {
+  uint16_t port = 0;
+  NativeSocket socket = BindLoopback(&port);
+  CloseSocket(socket);
+  return port;
+}
+
+}  // namespace testing
+}  // namespace cfvpn
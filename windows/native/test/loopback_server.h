@@ -0,0 +1,56 @@
+#ifndef NATIVE_TEST_LOOPBACK_SERVER_H_
+#define NATIVE_TEST_LOOPBACK_SERVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/socket_util.h"
+
+namespace cfvpn {
+namespace testing {
+
+// 测试用回环 TCP 监听器，绑定 127.0.0.1 的随机端口。
+class LoopbackServer {
+ public:
+  // 处理一条已接受的连接，返回后连接被关闭（在独立线程中调用）
+  using Handler = std::function<void(NativeSocket client)>;
+
+  // accept_connections 为 false 时只监听不 accept，用于制造积压队列满的场景
+  explicit LoopbackServer(Handler handler = nullptr, int backlog = 4096,
+                          bool accept_connections = true);
+  ~LoopbackServer();
+
+  LoopbackServer(const LoopbackServer&) = delete;
+  LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+  bool ok() const { return listener_ != kInvalidSocket; }
+  uint16_t port() const { return port_; }
+  int accepted() const { return accepted_.load(); }
+
+ private:
+  void AcceptLoop();
+
+  Handler handler_;
+  NativeSocket listener_ = kInvalidSocket;
+  uint16_t port_ = 0;
+  std::atomic<bool> stopping_;
+  std::atomic<int> accepted_;
+  std::thread acceptor_;
+  std::mutex workers_mutex_;
+  std::vector<std::thread> workers_;
+};
+
+// 返回一个当前无人监听的回环端口（绑定后立即关闭）
+uint16_t UnusedLoopbackPort();
+
+// 127.0.0.1 的主机字节序表示
+constexpr uint32_t kLoopbackIp = 0x7F000001;
+
+}  // namespace testing
+}  // namespace cfvpn
+
+#endif  // NATIVE_TEST_LOOPBACK_SERVER_H_
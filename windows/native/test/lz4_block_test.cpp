@@ -0,0 +1,104 @@
+#include "core/lz4_block.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace cfvpn {
+namespace {
+
+std::string Compress(const std::string& data) {
+  std::string out;
+  Lz4Compress(reinterpret_cast<const uint8_t*>(data.data()), data.size(), &out);
+  return out;
+}
+
+bool Decompress(const std::string& compressed, size_t size, std::string* out) {
+  out->assign(size, '\0');
+  return Lz4Decompress(reinterpret_cast<const uint8_t*>(compressed.data()),
+                       compressed.size(),
+                       reinterpret_cast<uint8_t*>(&(*out)[0]), size);
+}
+
+void ExpectRoundTrip(const std::string& data) {
+  const std::string compressed = Compress(data);
+  std::string restored;
+  ASSERT_TRUE(Decompress(compressed, data.size(), &restored));
+  EXPECT_EQ(restored, data);
+}
+
+TEST(Lz4BlockTest, RoundTripsEmptyAndTinyInputs) {
+  ExpectRoundTrip("");
+  ExpectRoundTrip("a");
+  ExpectRoundTrip("abcdefghijkl");  // 不超过 12 字节时全部是字面量
+  ExpectRoundTrip("abcdefghijklm");
+}
+
+TEST(Lz4BlockTest, CompressesRepetitiveText) {
+  std::string data;
+  for (int i = 0; i < 200; ++i) {
+    data += "[INFO] 测试 IP: 104.16." + std::to_string(i) + ".1 延迟: 120ms\n";
+  }
+  const std::string compressed = Compress(data);
+  EXPECT_LT(compressed.size() * 4, data.size());
+  std::string restored;
+  ASSERT_TRUE(Decompress(compressed, data.size(), &restored));
+  EXPECT_EQ(restored, data);
+}
+
+TEST(Lz4BlockTest, HandlesOverlappingMatchesAndLongRuns) {
+  // offset 1 的长匹配（游程）和超过 15 的长度扩展字节
+  ExpectRoundTrip(std::string(100000, 'x'));
+  ExpectRoundTrip("ab" + std::string(1000, 'c') + "ab");
+  std::string pattern;
+  for (int i = 0; i < 5000; ++i) pattern += "xyz";
+  ExpectRoundTrip(pattern);
+}
+
+TEST(Lz4BlockTest, RoundTripsRandomData) {
+  std::mt19937 random(42);
+  for (size_t size : {13u, 255u, 4096u, 70000u}) {
+    std::string data(size, '\0');
+    // 随机字节中夹杂重复片段，覆盖超出 64KB 窗口的候选
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<char>(i % 97 < 40 ? random() & 0xFF : 'a' + i % 7);
+    }
+    ExpectRoundTrip(data);
+  }
+}
+
+TEST(Lz4BlockTest, RejectsCorruptInput) {
+  std::string data;
+  for (int i = 0; i < 50; ++i) data += "cloudflare edge " + std::to_string(i);
+  const std::string compressed = Compress(data);
+  std::string restored;
+
+  // 大小不符
+  EXPECT_FALSE(Decompress(compressed, data.size() - 1, &restored));
+  EXPECT_FALSE(Decompress(compressed, data.size() + 1, &restored));
+  // 截断
+  for (size_t cut : {size_t{1}, compressed.size() / 2, compressed.size() - 1}) {
+    EXPECT_FALSE(
+        Decompress(compressed.substr(0, cut), data.size(), &restored));
+  }
+  // 指向输出之前的偏移
+  const std::string bad_offset("\x14" "a" "\x05\x00", 4);
+  EXPECT_FALSE(Decompress(bad_offset, 5, &restored));
+  const std::string zero_offset("\x14" "a" "\x00\x00", 4);
+  EXPECT_FALSE(Decompress(zero_offset, 5, &restored));
+
+  // 随机翻转字节不能越界（由 sanitizer/长度检查保证），结果只能是失败或不同
+  std::mt19937 random(7);
+  for (int i = 0; i < 500; ++i) {
+    std::string corrupt = compressed;
+    corrupt[random() % corrupt.size()] ^= static_cast<char>(1 + random() % 255);
+    if (Decompress(corrupt, data.size(), &restored)) {
+      EXPECT_EQ(restored.size(), data.size());
+    }
+  }
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,271 @@
+#include "core/node_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "core/native_api.h"
+
+namespace cfvpn {
+namespace {
+
+constexpr int64_t kNow = 1700000000;
+
+class NodeCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = ::testing::TempDir() + "node_cache_" +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name() +
+            ".bin";
+    std::remove(path_.c_str());
+  }
+
+  void TearDown() override { std::remove(path_.c_str()); }
+
+  static NodeSample Success(uint32_t ip, int32_t latency_ms,
+                            float loss_rate = 0) {
+    NodeSample sample;
+    sample.ip = ip;
+    sample.latency_ms = latency_ms;
+    sample.loss_rate = loss_rate;
+    return sample;
+  }
+
+  static NodeSample Failure(uint32_t ip) {
+    NodeSample sample;
+    sample.ip = ip;
+    sample.loss_rate = 1.0f;
+    return sample;
+  }
+
+  // 直接修改文件中的一个字节，模拟写到一半时崩溃
+  void CorruptByte(size_t offset) {
+    std::fstream file(path_,
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    char byte = 0;
+    file.read(&byte, 1);
+    byte = static_cast<char>(byte ^ 0x5A);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(&byte, 1);
+  }
+
+  std::string path_;
+};
+
+TEST_F(NodeCacheTest, PersistsAcrossReopen) {
+  NodeCacheOptions options;
+  options.capacity = 16;
+  {
+    NodeCache cache;
+    ASSERT_TRUE(cache.Open(path_, options));
+    EXPECT_TRUE(cache.rebuilt());
+    NodeSample sample = Success(0x01020304, 120);
+    std::memcpy(sample.colo, "NRT", 4);
+    cache.Update(sample, kNow);
+  }
+
+  NodeCache cache;
+  ASSERT_TRUE(cache.Open(path_, options));
+  EXPECT_FALSE(cache.rebuilt());
+  EXPECT_EQ(cache.discarded(), 0u);
+  EXPECT_EQ(cache.size(), 1u);
+  NodeQuality quality;
+  ASSERT_TRUE(cache.Lookup(0x01020304, &quality));
+  EXPECT_FLOAT_EQ(quality.latency_ms, 120.0f);
+  EXPECT_EQ(quality.last_seen, kNow);
+  EXPECT_EQ(quality.samples, 1u);
+  EXPECT_STREQ(quality.colo, "NRT");
+}
+
+TEST_F(NodeCacheTest, SmoothsLatencyAndLoss) {
+  NodeCacheOptions options;
+  options.capacity = 16;
+  options.alpha = 0.5;
+  NodeCache cache;
+  ASSERT_TRUE(cache.Open(path_, options));
+
+  cache.Update(Success(7, 100), kNow);
+  cache.Update(Success(7, 200, 0.5f), kNow + 1);
+  NodeQuality quality;
+  ASSERT_TRUE(cache.Lookup(7, &quality));
+  EXPECT_FLOAT_EQ(quality.latency_ms, 150.0f);
+  EXPECT_FLOAT_EQ(quality.loss_rate, 0.25f);
+  EXPECT_EQ(quality.samples, 2u);
+
+  // 失败不影响延迟，但会拉高丢包率并累计连续失败
+  cache.Update(Failure(7), kNow + 2);
+  cache.Update(Failure(7), kNow + 3);
+  ASSERT_TRUE(cache.Lookup(7, &quality));
+  EXPECT_FLOAT_EQ(quality.latency_ms, 150.0f);
+  EXPECT_FLOAT_EQ(quality.loss_rate, 0.8125f);
+  EXPECT_EQ(quality.failure_streak, 2u);
+
+  cache.Update(Success(7, 150), kNow + 4);
+  ASSERT_TRUE(cache.Lookup(7, &quality));
+  EXPECT_EQ(quality.failure_streak, 0u);
+  EXPECT_EQ(quality.last_seen, kNow + 4);
+}
+
+TEST_F(NodeCacheTest, ColoOnlySampleKeepsQuality) {
+  NodeCacheOptions options;
+  options.capacity = 16;
+  NodeCache cache;
+  ASSERT_TRUE(cache.Open(path_, options));
+  cache.Update(Success(9, 80), kNow);
+
+  NodeSample trace;
+  trace.ip = 9;
+  trace.loss_rate = -1;
+  std::memcpy(trace.colo, "HKG", 4);
+  cache.Update(trace, kNow + 100);
+
+  NodeQuality quality;
+  ASSERT_TRUE(cache.Lookup(9, &quality));
+  EXPECT_FLOAT_EQ(quality.latency_ms, 80.0f);
+  EXPECT_EQ(quality.samples, 1u);
+  EXPECT_EQ(quality.last_seen, kNow);
+  EXPECT_STREQ(quality.colo, "HKG");
+}
+
+TEST_F(NodeCacheTest, BestSkipsStaleFailingAndUnprobedNodes) {
+  NodeCacheOptions options;
+  options.capacity = 16;
+  NodeCache cache;
+  ASSERT_TRUE(cache.Open(path_, options));
+
+  cache.Update(Success(1, 200), kNow);
+  cache.Update(Success(2, 100), kNow);
+  cache.Update(Success(3, 50, 0.2f), kNow);  // 丢包惩罚后为 250
+  cache.Update(Success(4, 10), kNow - 7200);  // 过期
+  cache.Update(Success(5, 10), kNow);
+  cache.Update(Failure(5), kNow);
+  cache.Update(Failure(5), kNow);             // 连续失败
+  NodeSample unprobed;
+  unprobed.ip = 6;
+  unprobed.loss_rate = -1;
+  std::memcpy(unprobed.colo, "LAX", 4);
+  cache.Update(unprobed, kNow);
+  cache.Update(Failure(7), kNow);
+  EXPECT_EQ(cache.size(), 5u);
+
+  NodeQuality best[8];
+  size_t count = cache.Best(kNow, 3600, 2, best, 8);
+  ASSERT_EQ(count, 3u);
+  EXPECT_EQ(best[0].ip, 2u);
+  EXPECT_EQ(best[1].ip, 1u);
+  EXPECT_EQ(best[2].ip, 3u);
+
+  EXPECT_EQ(cache.Best(kNow, 3600, 2, best, 1), 1u);
+  EXPECT_EQ(best[0].ip, 2u);
+}
+
+TEST_F(NodeCacheTest, EvictsLeastRecentlySeenWhenFull) {
+  NodeCacheOptions options;
+  options.capacity = 4;
+  NodeCache cache;
+  ASSERT_TRUE(cache.Open(path_, options));
+  for (uint32_t ip = 1; ip <= 4; ++ip) {
+    cache.Update(Success(ip, 100), kNow + ip);
+  }
+  cache.Update(Success(1, 100), kNow + 10);  // 1 刚刚被探测过
+  cache.Update(Success(5, 100), kNow + 11);
+
+  EXPECT_EQ(cache.size(), 4u);
+  NodeQuality quality;
+  EXPECT_TRUE(cache.Lookup(1, &quality));
+  EXPECT_FALSE(cache.Lookup(2, &quality));
+  EXPECT_TRUE(cache.Lookup(5, &quality));
+
+  std::ifstream file(path_, std::ios::binary | std::ios::ate);
+  EXPECT_EQ(static_cast<size_t>(file.tellg()), 64u + 32u * 4u);
+}
+
+TEST_F(NodeCacheTest, DiscardsTornRecord) {
+  NodeCacheOptions options;
+  options.capacity = 4;
+  {
+    NodeCache cache;
+    ASSERT_TRUE(cache.Open(path_, options));
+    // 空闲槽位从 0 开始分配
+    cache.Update(Success(11, 100), kNow);
+    cache.Update(Success(12, 100), kNow);
+  }
+  CorruptByte(64 + 32 + 12);  // 第二条记录的延迟字段
+
+  NodeCache cache;
+  ASSERT_TRUE(cache.Open(path_, options));
+  EXPECT_FALSE(cache.rebuilt());
+  EXPECT_EQ(cache.discarded(), 1u);
+  EXPECT_EQ(cache.size(), 1u);
+  NodeQuality quality;
+  EXPECT_TRUE(cache.Lookup(11, &quality));
+  EXPECT_FALSE(cache.Lookup(12, &quality));
+
+  // 被丢弃的槽位可以重新使用
+  cache.Update(Success(13, 100), kNow);
+  cache.Update(Success(14, 100), kNow);
+  cache.Update(Success(15, 100), kNow);
+  EXPECT_EQ(cache.size(), 4u);
+}
+
+TEST_F(NodeCacheTest, RebuildsOnHeaderMismatch) {
+  NodeCacheOptions options;
+  options.capacity = 4;
+  {
+    NodeCache cache;
+    ASSERT_TRUE(cache.Open(path_, options));
+    cache.Update(Success(1, 100), kNow);
+  }
+  CorruptByte(4);  // 版本号
+  {
+    NodeCache cache;
+    ASSERT_TRUE(cache.Open(path_, options));
+    EXPECT_TRUE(cache.rebuilt());
+    EXPECT_EQ(cache.size(), 0u);
+    cache.Update(Success(1, 100), kNow);
+  }
+
+  // 容量变化同样重建，文件大小随之调整
+  options.capacity = 8;
+  NodeCache cache;
+  ASSERT_TRUE(cache.Open(path_, options));
+  EXPECT_TRUE(cache.rebuilt());
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.capacity(), 8u);
+}
+
+TEST_F(NodeCacheTest, NativeApiRoundTrip) {
+  CfvpnNodeCache* cache = cfvpn_node_cache_open(path_.c_str(), 32);
+  ASSERT_NE(cache, nullptr);
+
+  CfvpnNodeSample samples[3] = {};
+  samples[0].ip = 0x0A000001;
+  samples[0].latency_ms = 90;
+  std::memcpy(samples[0].colo, "SIN", 4);
+  samples[1].ip = 0x0A000002;
+  samples[1].latency_ms = 60;
+  samples[2].ip = 0x0A000003;
+  samples[2].latency_ms = -1;
+  samples[2].loss_rate = 1.0f;
+  cfvpn_node_cache_update(cache, samples, 3, kNow);
+  // 从未成功过的节点不会进入缓存
+  EXPECT_EQ(cfvpn_node_cache_size(cache), 2);
+  cfvpn_node_cache_close(cache);
+
+  cache = cfvpn_node_cache_open(path_.c_str(), 32);
+  ASSERT_NE(cache, nullptr);
+  CfvpnNodeQuality best[4];
+  ASSERT_EQ(cfvpn_node_cache_best(cache, best, 4, kNow + 10, 3600, 1), 2);
+  EXPECT_EQ(best[0].ip, 0x0A000002u);
+  EXPECT_EQ(best[1].ip, 0x0A000001u);
+  EXPECT_STREQ(best[1].colo, "SIN");
+  EXPECT_EQ(best[1].samples, 1);
+  cfvpn_node_cache_close(cache);
+}
+
+}  // namespace
+}  // namespace cfvpn
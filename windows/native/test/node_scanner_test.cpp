@@ -0,0 +1,153 @@
+#include "core/node_scanner.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+using testing::LoopbackServer;
+
+// 按 keep-alive 逐个回复 /cdn-cgi/trace
+void ServeTrace(NativeSocket client) {
+  std::string pending;
+  char buffer[1024];
+  for (;;) {
+    const size_t end = pending.find("\r\n\r\n");
+    if (end == std::string::npos) {
+      const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+      if (n <= 0) return;
+      pending.append(buffer, static_cast<size_t>(n));
+      continue;
+    }
+    pending.erase(0, end + 4);
+    const std::string body = "fl=1\nip=127.0.0.1\ncolo=HKG\nloc=HK\n";
+    const std::string response =
+        "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) +
+        "\r\n\r\n" + body;
+    ::send(client, response.data(), response.size(), MSG_NOSIGNAL);
+  }
+}
+
+// 127.0.0.0/29：只有 127.0.0.1 上有监听，其余地址连接被拒绝
+ScanOptions LoopbackScan(uint16_t port, uint16_t trace_port) {
+  ScanOptions options;
+  options.ranges = {{kLoopbackIp - 1, kLoopbackIp + 6}};
+  options.sample_count = 8;
+  options.seed = 42;
+  options.port = port;
+  options.max_latency_ms = 500;
+  options.tcping.min_valid_latency_ms = 0;  // 回环延迟接近 0
+  options.tcping.interval_ms = 0;
+  options.trace_port = trace_port;
+  options.http.timeout_ms = 1000;
+  return options;
+}
+
+TEST(NodeScannerTest, DefaultsMatchApp) {
+  const ScanOptions options;
+  EXPECT_EQ(options.ranges.size(), 25u);
+  EXPECT_EQ(options.sample_count, 500);
+  EXPECT_EQ(options.port, 443);
+  EXPECT_EQ(options.trace_port, 80);
+  EXPECT_EQ(options.result_count, 5);
+  EXPECT_EQ(options.tcping.stop_after_good, 10);
+  EXPECT_TRUE(options.tcping.adaptive_inflight);
+}
+
+TEST(NodeScannerTest, RanksReachableNodesWithTrace) {
+  LoopbackServer tcp;
+  LoopbackServer trace(&ServeTrace);
+  ASSERT_TRUE(tcp.ok());
+  ASSERT_TRUE(trace.ok());
+
+  NodeScanner scanner(LoopbackScan(tcp.port(), trace.port()));
+  std::vector<ScanResult> ranked;
+  ScanSummary summary;
+  size_t tcping_progress = 0;
+  size_t trace_progress = 0;
+  ASSERT_TRUE(scanner.Run(&ranked, &summary,
+                          [&](ScanPhase phase, size_t done, size_t total) {
+                            EXPECT_LE(done, total);
+                            if (phase == ScanPhase::kTcping) {
+                              tcping_progress = done;
+                            } else {
+                              trace_progress = done;
+                            }
+                          }));
+
+  EXPECT_GE(summary.sampled, 2u);
+  EXPECT_EQ(summary.probed, summary.sampled);
+  EXPECT_EQ(tcping_progress, summary.sampled);
+  EXPECT_EQ(summary.reachable, 1u);
+  EXPECT_EQ(summary.traced, 1u);
+  EXPECT_EQ(trace_progress, 1u);
+  ASSERT_EQ(ranked.size(), 1u);
+  EXPECT_EQ(ranked[0].ip, kLoopbackIp);
+  EXPECT_EQ(ranked[0].port, tcp.port());
+  EXPECT_GE(ranked[0].latency_ms, 0);
+  EXPECT_FLOAT_EQ(ranked[0].loss_rate, 0.0f);
+  EXPECT_GE(ranked[0].trace_ms, 0);
+  EXPECT_LT(ranked[0].trace_ms, 9999);
+  EXPECT_EQ(ranked[0].colo, "HKG");
+  EXPECT_EQ(ranked[0].loc, "HK");
+}
+
+TEST(NodeScannerTest, FailedTraceKeepsNodeWithPenalty) {
+  LoopbackServer tcp;
+  ASSERT_TRUE(tcp.ok());
+  NodeScanner scanner(
+      LoopbackScan(tcp.port(), testing::UnusedLoopbackPort()));
+  std::vector<ScanResult> ranked;
+  ScanSummary summary;
+  ASSERT_TRUE(scanner.Run(&ranked, &summary));
+  ASSERT_EQ(ranked.size(), 1u);
+  EXPECT_EQ(ranked[0].trace_ms, 9999);
+  EXPECT_TRUE(ranked[0].colo.empty());
+}
+
+TEST(NodeScannerTest, TraceCanBeSkipped) {
+  LoopbackServer tcp;
+  ASSERT_TRUE(tcp.ok());
+  ScanOptions options = LoopbackScan(tcp.port(), 0);
+  options.trace = false;
+  NodeScanner scanner(options);
+  std::vector<ScanResult> ranked;
+  ScanSummary summary;
+  ASSERT_TRUE(scanner.Run(&ranked, &summary));
+  ASSERT_EQ(ranked.size(), 1u);
+  EXPECT_EQ(ranked[0].trace_ms, -1);
+  EXPECT_EQ(summary.traced, 0u);
+  EXPECT_EQ(summary.trace_us, 0);
+}
+
+TEST(NodeScannerTest, CancelledBeforeRunProbesNothing) {
+  LoopbackServer tcp;
+  ASSERT_TRUE(tcp.ok());
+  NodeScanner scanner(LoopbackScan(tcp.port(), 0));
+  scanner.Cancel();
+  std::vector<ScanResult> ranked;
+  ScanSummary summary;
+  ASSERT_TRUE(scanner.Run(&ranked, &summary));
+  EXPECT_TRUE(ranked.empty());
+  EXPECT_EQ(summary.probed, 0u);
+  EXPECT_EQ(summary.stop_reason, StopReason::kCancelled);
+}
+
+TEST(NodeScannerTest, EmptyRangesFail) {
+  ScanOptions options;
+  options.ranges.clear();
+  NodeScanner scanner(options);
+  std::vector<ScanResult> ranked;
+  ScanSummary summary;
+  EXPECT_FALSE(scanner.Run(&ranked, &summary));
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,311 @@
+#include "core/process_supervisor.h"
+
+#include <gtest/gtest.h>
+#include <signal.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::UnusedLoopbackPort;
+
+ChildProcessOptions FakeV2ray(std::vector<std::string> arguments) {
+  ChildProcessOptions options;
+  options.executable = CFVPN_FAKE_V2RAY_PATH;
+  options.arguments = std::move(arguments);
+  return options;
+}
+
+bool ProcessAlive(int64_t pid) {
+  return pid > 0 && ::kill(static_cast<pid_t>(pid), 0) == 0;
+}
+
+// 收集子进程的全部输出直到退出
+struct Collected {
+  std::string out;
+  std::string err;
+  ChildEvent last = ChildEvent::kTimeout;
+};
+
+Collected Drain(ChildProcess* child, int timeout_ms) {
+  Collected collected;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (std::chrono::steady_clock::now() < deadline) {
+    std::string chunk;
+    bool from_stderr = false;
+    collected.last = child->Wait(100, &chunk, &from_stderr);
+    if (collected.last == ChildEvent::kOutput) {
+      (from_stderr ? collected.err : collected.out) += chunk;
+    } else if (collected.last == ChildEvent::kExited) {
+      break;
+    }
+  }
+  return collected;
+}
+
+class OutputLog {
+ public:
+  ProcessSupervisor::OutputHandler handler() {
+    return [this](std::string_view line, bool from_stderr) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      lines_.push_back((from_stderr ? "E:" : "O:") + std::string(line));
+    };
+  }
+  std::vector<std::string> lines() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lines_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::string> lines_;
+};
+
+TEST(ChildProcessTest, StreamsBothPipesAndReportsExitCode) {
+  ChildProcess child;
+  std::string error;
+  ASSERT_TRUE(child.Spawn(FakeV2ray({"--stderr", "warning line", "--exit-after",
+                                     "0", "--exit-code", "7", "--tail",
+                                     "no newline"}),
+                          &error))
+      << error;
+  EXPECT_TRUE(child.running());
+  EXPECT_GT(child.pid(), 0);
+  const Collected collected = Drain(&child, 5000);
+  EXPECT_EQ(collected.last, ChildEvent::kExited);
+  EXPECT_EQ(collected.err, "warning line\n");
+  EXPECT_NE(collected.out.find("V2Ray 5.0.0 started"), std::string::npos);
+  EXPECT_NE(collected.out.find("no newline"), std::string::npos);
+  EXPECT_EQ(child.exit_code(), 7);
+  EXPECT_FALSE(child.running());
+  EXPECT_FALSE(ProcessAlive(child.pid()));
+}
+
+TEST(ChildProcessTest, KillReapsChildAndWakeupInterruptsWait) {
+  ChildProcess child;
+  std::string error;
+  ASSERT_TRUE(child.Spawn(FakeV2ray({"--ignore-term"}), &error)) << error;
+  Drain(&child, 300);
+
+  std::thread waker([&child] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    child.Wakeup();
+  });
+  std::string chunk;
+  bool from_stderr = false;
+  EXPECT_EQ(child.Wait(5000, &chunk, &from_stderr), ChildEvent::kWoken);
+  waker.join();
+
+  // 忽略 SIGTERM 的子进程只能被强制结束
+  child.Terminate();
+  EXPECT_EQ(child.Wait(200, &chunk, &from_stderr), ChildEvent::kTimeout);
+  child.Kill();
+  EXPECT_EQ(Drain(&child, 5000).last, ChildEvent::kExited);
+  EXPECT_EQ(child.exit_code(), 128 + SIGKILL);
+  EXPECT_FALSE(ProcessAlive(child.pid()));
+}
+
+TEST(ChildProcessTest, ReportsMissingExecutable) {
+  ChildProcess child;
+  ChildProcessOptions options;
+  options.executable = "/nonexistent/v2ray";
+  std::string error;
+  EXPECT_FALSE(child.Spawn(options, &error));
+  EXPECT_NE(error.find("/nonexistent/v2ray"), std::string::npos);
+  EXPECT_FALSE(child.running());
+}
+
+TEST(ProcessSupervisorTest, BecomesReadyWhenStartedLineAppears) {
+  const uint16_t socks = UnusedLoopbackPort();
+  const uint16_t http = UnusedLoopbackPort();
+  SupervisorOptions options;
+  options.process = FakeV2ray({"--delay", "150", "--listen",
+                               std::to_string(socks), "--listen",
+                               std::to_string(http)});
+  options.ready_ports = {socks, http};
+  options.fallback_probe_ms = 0;  // 只依赖输出中的就绪标记
+  OutputLog log;
+  ProcessSupervisor supervisor(options, log.handler());
+  ASSERT_TRUE(supervisor.Start());
+  EXPECT_FALSE(supervisor.Start());
+
+  ASSERT_TRUE(supervisor.WaitReady(5000));
+  const SupervisorStatus status = supervisor.status();
+  EXPECT_EQ(status.state, SupervisorState::kReady);
+  EXPECT_GT(status.pid, 0);
+  EXPECT_EQ(status.restarts, 0);
+  // 就绪耗时就是子进程自身的启动耗时，不再有固定的等待
+  EXPECT_GE(status.ready_latency_us, 150000);
+  EXPECT_LT(status.ready_latency_us, 1000000);
+  const std::vector<std::string> lines = log.lines();
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[1], "O:[Warning] core: V2Ray 5.0.0 started");
+
+  supervisor.Stop();
+  EXPECT_EQ(supervisor.status().state, SupervisorState::kStopped);
+  EXPECT_FALSE(ProcessAlive(status.pid));
+}
+
+TEST(ProcessSupervisorTest, FallsBackToProbingWithoutMarker) {
+  const uint16_t port = UnusedLoopbackPort();
+  SupervisorOptions options;
+  options.process =
+      FakeV2ray({"--no-banner", "--delay", "100", "--listen",
+                 std::to_string(port)});
+  options.ready_ports = {port};
+  options.fallback_probe_ms = 20;
+  ProcessSupervisor supervisor(options, nullptr);
+  ASSERT_TRUE(supervisor.Start());
+  EXPECT_TRUE(supervisor.WaitReady(5000));
+  EXPECT_LT(supervisor.status().ready_latency_us, 1000000);
+}
+
+TEST(ProcessSupervisorTest, RestartsAfterCrashWithBackoff) {
+  const std::string counter =
+      (std::filesystem::temp_directory_path() /
+       ("cfvpn_fake_v2ray_" + std::to_string(::getpid()) + ".count"))
+          .string();
+  std::filesystem::remove(counter);
+  const uint16_t port = UnusedLoopbackPort();
+  SupervisorOptions options;
+  options.process = FakeV2ray(
+      {"--fail-until", counter, "2", "--listen", std::to_string(port)});
+  options.ready_ports = {port};
+  options.backoff_initial_ms = 50;
+  OutputLog log;
+  ProcessSupervisor supervisor(options, log.handler());
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(supervisor.Start());
+  ASSERT_TRUE(supervisor.WaitReady(5000));
+  // 两次崩溃分别退避 50ms 和 100ms
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(150));
+  const SupervisorStatus status = supervisor.status();
+  EXPECT_EQ(status.restarts, 2);
+  EXPECT_EQ(status.last_exit_code, 3);
+  EXPECT_NE(status.last_error.find("3"), std::string::npos);
+  int crashes = 0;
+  for (const std::string& line : log.lines()) {
+    if (line == "E:panic: simulated crash") ++crashes;
+  }
+  EXPECT_EQ(crashes, 2);
+  supervisor.Stop();
+  std::filesystem::remove(counter);
+}
+
+TEST(ProcessSupervisorTest, GivesUpAfterRestartLimit) {
+  SupervisorOptions options;
+  options.process = FakeV2ray({"--exit-after", "20", "--exit-code", "5"});
+  options.max_restarts = 2;
+  options.backoff_initial_ms = 10;
+  ProcessSupervisor supervisor(options, nullptr);
+  ASSERT_TRUE(supervisor.Start());
+  ASSERT_TRUE(supervisor.WaitStopped(5000));
+  const SupervisorStatus status = supervisor.status();
+  EXPECT_EQ(status.state, SupervisorState::kFailed);
+  EXPECT_EQ(status.restarts, 2);
+  EXPECT_EQ(status.last_exit_code, 5);
+  EXPECT_EQ(status.pid, 0);
+  EXPECT_FALSE(supervisor.WaitReady(10));
+
+  // 失败后可以重新启动
+  ASSERT_TRUE(supervisor.Start());
+  supervisor.Stop();
+}
+
+TEST(ProcessSupervisorTest, TimesOutWhenPortNeverBinds) {
+  SupervisorOptions options;
+  options.process = FakeV2ray({});
+  options.ready_ports = {UnusedLoopbackPort()};
+  options.ready_timeout_ms = 300;
+  options.max_restarts = 0;
+  ProcessSupervisor supervisor(options, nullptr);
+  ASSERT_TRUE(supervisor.Start());
+  EXPECT_FALSE(supervisor.WaitReady(5000));
+  ASSERT_TRUE(supervisor.WaitStopped(5000));
+  const SupervisorStatus status = supervisor.status();
+  EXPECT_EQ(status.state, SupervisorState::kFailed);
+  EXPECT_NE(status.last_error.find("超时"), std::string::npos);
+  EXPECT_EQ(status.last_exit_code, 128 + SIGKILL);
+}
+
+TEST(ProcessSupervisorTest, StopEscalatesToKill) {
+  SupervisorOptions options;
+  options.process = FakeV2ray({"--ignore-term"});
+  options.stop_grace_ms = 100;
+  ProcessSupervisor supervisor(options, nullptr);
+  ASSERT_TRUE(supervisor.Start());
+  ASSERT_TRUE(supervisor.WaitReady(5000));
+  const int64_t pid = supervisor.status().pid;
+  ASSERT_TRUE(ProcessAlive(pid));
+
+  const auto start = std::chrono::steady_clock::now();
+  supervisor.RequestStop();
+  ASSERT_TRUE(supervisor.WaitStopped(5000));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+  EXPECT_EQ(supervisor.status().state, SupervisorState::kStopped);
+  EXPECT_EQ(supervisor.status().last_exit_code, 128 + SIGKILL);
+  EXPECT_FALSE(ProcessAlive(pid));
+}
+
+TEST(ProcessSupervisorTest, DestructorReapsRunningChild) {
+  int64_t pid = 0;
+  {
+    SupervisorOptions options;
+    options.process = FakeV2ray({});
+    ProcessSupervisor supervisor(options, nullptr);
+    ASSERT_TRUE(supervisor.Start());
+    ASSERT_TRUE(supervisor.WaitReady(5000));
+    pid = supervisor.status().pid;
+  }
+  EXPECT_FALSE(ProcessAlive(pid));
+}
+
+TEST(ProcessSupervisorTest, NativeApiPollsStateUntilStopped) {
+  const uint16_t port = UnusedLoopbackPort();
+  const std::string port_text = std::to_string(port);
+  const char* arguments[] = {"--listen", port_text.c_str()};
+  CfvpnSupervisorOptions options = {};
+  options.executable = CFVPN_FAKE_V2RAY_PATH;
+  options.arguments = arguments;
+  options.argument_count = 2;
+  options.ready_ports = &port;
+  options.ready_port_count = 1;
+  CfvpnSupervisor* supervisor = cfvpn_supervisor_start(&options);
+  ASSERT_NE(supervisor, nullptr);
+
+  // Dart 端按固定间隔轮询状态，不阻塞 UI 线程
+  auto wait_for = [supervisor](int32_t state) {
+    CfvpnSupervisorStatus status;
+    for (int i = 0; i < 500; ++i) {
+      cfvpn_supervisor_status(supervisor, &status);
+      if (status.state == state) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return status;
+  };
+  const CfvpnSupervisorStatus ready = wait_for(CFVPN_SUPERVISOR_READY);
+  EXPECT_EQ(ready.state, CFVPN_SUPERVISOR_READY);
+  EXPECT_GT(ready.pid, 0);
+  EXPECT_GT(ready.ready_latency_us, 0);
+  EXPECT_STREQ(ready.last_error, "");
+
+  cfvpn_supervisor_stop(supervisor);
+  EXPECT_EQ(wait_for(CFVPN_SUPERVISOR_STOPPED).state, CFVPN_SUPERVISOR_STOPPED);
+  EXPECT_FALSE(ProcessAlive(ready.pid));
+  cfvpn_supervisor_free(supervisor);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,310 @@
+#include "core/range_bandit.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/node_scanner.h"
+#include "edge_simulator.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+std::vector<Ipv4Range> Ranges(const char* text) {
+  std::vector<Ipv4Range> ranges;
+  EXPECT_EQ(ParseCidrList(text, &ranges), 0u);
+  return ranges;
+}
+
+RangeBanditOptions ArmsOf(int prefix, BanditPolicy policy) {
+  RangeBanditOptions options;
+  options.arm_prefix = prefix;
+  options.policy = policy;
+  return options;
+}
+
+// 合成的边缘：10.0.5.0/24 里 80% 是优质节点，其它 /24 只有 5%
+constexpr char kSyntheticRanges[] = "10.0.0.0/20";
+
+double SyntheticYield(uint32_t ip) {
+  return ((ip >> 8) & 0xF) == 5 ? 0.8 : 0.05;
+}
+
+// 按 bandit 分配、每批 batch 个，返回找到 wanted 个优质节点时的探测数
+size_t BanditProbesUntilGood(BanditPolicy policy, uint64_t seed,
+                             size_t wanted) {
+  RangeBandit bandit(Ranges(kSyntheticRanges), ArmsOf(24, policy), seed);
+  Random outcomes(seed * 7919);
+  uint32_t ips[8];
+  size_t probes = 0;
+  size_t good = 0;
+  for (;;) {
+    const size_t count = bandit.Next(8, ips);
+    if (count == 0) return probes;
+    for (size_t i = 0; i < count; ++i) {
+      if (good >= wanted) {
+        bandit.Release(ips[i]);
+        continue;
+      }
+      ++probes;
+      const bool is_good = outcomes.NextDouble() < SyntheticYield(ips[i]);
+      if (is_good) ++good;
+      bandit.Update(ips[i], is_good);
+    }
+    if (good >= wanted) return probes;
+  }
+}
+
+// 按 CidrSampler 的均匀采样顺序探测
+size_t UniformProbesUntilGood(uint64_t seed, size_t wanted) {
+  const Ipv4RangeIndex index(Ranges(kSyntheticRanges));
+  CidrSampler sampler(index);
+  std::vector<uint32_t> ips(4096);
+  ips.resize(sampler.Sample(ips.size(), seed, ips.data()));
+  Random outcomes(seed * 7919);
+  size_t good = 0;
+  for (size_t i = 0; i < ips.size(); ++i) {
+    if (outcomes.NextDouble() < SyntheticYield(ips[i]) && ++good >= wanted) {
+      return i + 1;
+    }
+  }
+  return ips.size();
+}
+
+TEST(RangeBanditTest, SplitsMergedRangesIntoArms) {
+  // 两个 /16 合并为一个 /15，再按 /16 切开；/30 单独成臂，与其重叠的
+  // /31 被合并；全是 .0/.255 的 /32 没有可用地址，不成臂
+  RangeBandit bandit(
+      Ranges("10.0.0.0/16,10.1.0.0/16,192.168.1.0/30,192.168.1.2/31,"
+             "172.16.0.0/32"),
+      ArmsOf(16, BanditPolicy::kThompson), 1);
+  ASSERT_EQ(bandit.arm_count(), 3u);
+  EXPECT_EQ(bandit.arm_range(0).first, 0x0A000000u);
+  EXPECT_EQ(bandit.arm_range(0).last, 0x0A00FFFFu);
+  EXPECT_EQ(bandit.arm_range(1).first, 0x0A010000u);
+  EXPECT_EQ(bandit.arm_range(2).first, 0xC0A80100u);
+  EXPECT_EQ(bandit.arm_range(2).last, 0xC0A80103u);
+  EXPECT_EQ(bandit.ArmOf(0x0A01ABCDu), 1);
+  EXPECT_EQ(bandit.ArmOf(0xC0A80104u), -1);
+  EXPECT_EQ(bandit.ArmOf(0xAC100000u), -1);
+}
+
+TEST(RangeBanditTest, NextReturnsUniqueHostsUntilExhausted) {
+  for (BanditPolicy policy : {BanditPolicy::kThompson, BanditPolicy::kUcb}) {
+    RangeBandit bandit(Ranges("10.0.0.0/23,10.9.9.0/30"),
+                       ArmsOf(24, policy), 3);
+    ASSERT_EQ(bandit.arm_count(), 3u);
+    std::vector<uint32_t> ips(1024);
+    ips.resize(bandit.Next(ips.size(), ips.data()));
+    // 两个 /24 各 254 个主机，/30 中去掉 .0 还有 3 个
+    EXPECT_EQ(ips.size(), 254u * 2 + 3);
+    const std::set<uint32_t> unique(ips.begin(), ips.end());
+    EXPECT_EQ(unique.size(), ips.size());
+    for (uint32_t ip : ips) {
+      EXPECT_GE(bandit.ArmOf(ip), 0);
+      EXPECT_NE(ip & 0xFF, 0u);
+      EXPECT_NE(ip & 0xFF, 255u);
+    }
+    uint32_t more;
+    EXPECT_EQ(bandit.Next(1, &more), 0u);
+  }
+}
+
+TEST(RangeBanditTest, UpdatesMoveThePosterior) {
+  RangeBandit bandit(Ranges("10.0.0.0/23"),
+                     ArmsOf(24, BanditPolicy::kThompson), 5);
+  EXPECT_DOUBLE_EQ(bandit.Mean(0), 0.5);
+  for (uint32_t host = 1; host <= 3; ++host) {
+    bandit.Update(0x0A000000u + host, true);
+  }
+  bandit.Update(0x0A000100u + 1, false);
+  EXPECT_DOUBLE_EQ(bandit.Mean(0), 4.0 / 5.0);
+  EXPECT_DOUBLE_EQ(bandit.Mean(1), 1.0 / 3.0);
+}
+
+TEST(RangeBanditTest, HistoryPriorsSteerTheFirstBatch) {
+  RangeBanditOptions options = ArmsOf(24, BanditPolicy::kThompson);
+  options.prior_weight = 1.0f;
+  options.max_prior = 8.0f;
+  RangeBandit bandit(Ranges(kSyntheticRanges), options, 9);
+  for (uint32_t block = 0; block < 16; ++block) {
+    // 每个臂 20 条历史，超过 max_prior 的部分按比例压缩
+    for (uint32_t host = 1; host <= 20; ++host) {
+      bandit.AddPrior(0x0A000000u | (block << 8) | host, block == 3);
+    }
+  }
+  bandit.AddPrior(0x0B000001u, true);  // 不在任何臂内，被忽略
+  EXPECT_DOUBLE_EQ(bandit.Mean(3), 9.0 / 10.0);
+  EXPECT_DOUBLE_EQ(bandit.Mean(0), 1.0 / 10.0);
+
+  uint32_t ips[16];
+  ASSERT_EQ(bandit.Next(16, ips), 16u);
+  int in_good_arm = 0;
+  for (uint32_t ip : ips) {
+    if (bandit.ArmOf(ip) == 3) ++in_good_arm;
+  }
+  EXPECT_GE(in_good_arm, 12);
+}
+
+TEST(RangeBanditTest, FindsGoodNodesWithFewerProbesThanUniform) {
+  constexpr size_t kWanted = 10;
+  size_t uniform = 0;
+  size_t thompson = 0;
+  size_t ucb = 0;
+  for (uint64_t seed = 1; seed <= 8; ++seed) {
+    uniform += UniformProbesUntilGood(seed, kWanted);
+    thompson += BanditProbesUntilGood(BanditPolicy::kThompson, seed, kWanted);
+    ucb += BanditProbesUntilGood(BanditPolicy::kUcb, seed, kWanted);
+  }
+  EXPECT_LT(thompson * 2, uniform)
+      << "thompson=" << thompson << " uniform=" << uniform;
+  EXPECT_LT(ucb * 3, uniform * 2) << "ucb=" << ucb << " uniform=" << uniform;
+}
+
+// 真实套接字上比较 NodeScanner 的两种采样方式：127.89.0.0/24 按 /26 分成
+// 4 个臂，只有 127.89.0.128/26 有模拟器监听，其余地址连接被拒绝
+class RangeBanditEdgeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    port_ = testing::UnusedLoopbackPort();
+    testing::EdgeSimulatorOptions options;
+    options.ranges = Ranges("127.89.0.128/26");
+    options.ports = {port_};
+    simulator_ = std::make_unique<testing::EdgeSimulator>(options);
+    std::string error;
+    ASSERT_TRUE(simulator_->Start(&error)) << error;
+  }
+
+  ScanOptions Options(ScanSampler sampler, uint64_t seed) const {
+    ScanOptions options;
+    options.ranges = Ranges("127.89.0.0/24");
+    options.sample_count = 240;
+    options.seed = seed;
+    options.port = port_;
+    options.max_latency_ms = 500;
+    options.trace = false;
+    options.result_count = 0;
+    options.sampler = sampler;
+    options.bandit.arm_prefix = 26;
+    options.bandit.batch = 8;
+    options.tcping.attempts = 1;
+    options.tcping.min_valid_latency_ms = 0;  // 回环延迟接近 0
+    options.tcping.interval_ms = 0;
+    options.tcping.adaptive_inflight = false;
+    options.tcping.max_inflight = 8;  // 与 batch 相同，两种方式并发一致
+    options.tcping.stop_after_good = 16;
+    options.tcping.failure_window = 0;
+    return options;
+  }
+
+  uint16_t port_ = 0;
+  std::unique_ptr<testing::EdgeSimulator> simulator_;
+};
+
+TEST_F(RangeBanditEdgeTest, BanditNeedsFewerProbesThanUniform) {
+  size_t uniform_probes = 0;
+  size_t bandit_probes = 0;
+  for (uint64_t seed = 1; seed <= 3; ++seed) {
+    for (ScanSampler sampler : {ScanSampler::kUniform, ScanSampler::kBandit}) {
+      NodeScanner scanner(Options(sampler, seed));
+      std::vector<ScanResult> ranked;
+      ScanSummary summary;
+      ASSERT_TRUE(scanner.Run(&ranked, &summary));
+      EXPECT_EQ(summary.stop_reason, StopReason::kEnoughGood);
+      EXPECT_GE(ranked.size(), 16u);
+      for (const ScanResult& result : ranked) {
+        EXPECT_EQ(result.ip & 0xFFFFFFC0u, 0x7F590080u);
+      }
+      (sampler == ScanSampler::kBandit ? bandit_probes : uniform_probes) +=
+          summary.probed;
+    }
+  }
+  EXPECT_LT(bandit_probes, uniform_probes)
+      << "bandit=" << bandit_probes << " uniform=" << uniform_probes;
+}
+
+TEST_F(RangeBanditEdgeTest, CancelledBeforeRunProbesNothing) {
+  NodeScanner scanner(Options(ScanSampler::kBandit, 1));
+  scanner.Cancel();
+  std::vector<ScanResult> ranked;
+  ScanSummary summary;
+  ASSERT_TRUE(scanner.Run(&ranked, &summary));
+  EXPECT_EQ(summary.probed, 0u);
+  EXPECT_EQ(summary.stop_reason, StopReason::kCancelled);
+}
+
+TEST_F(RangeBanditEdgeTest, NativeJobUsesHistoryPriors) {
+  // 缓存里只有监听段的成功记录，第一轮应集中在该段
+  const std::string path = ::testing::TempDir() + "bandit_history.bin";
+  std::remove(path.c_str());
+  CfvpnNodeCache* cache = cfvpn_node_cache_open(path.c_str(), 0);
+  ASSERT_NE(cache, nullptr);
+  const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  CfvpnNodeSample samples[20] = {};
+  for (uint32_t i = 0; i < 20; ++i) {
+    samples[i].ip = 0x7F590081u + i;
+    samples[i].latency_ms = 40;
+  }
+  cfvpn_node_cache_update(cache, samples, 20, now);
+
+  CfvpnTcpingOptions options = {};
+  options.attempts = 1;
+  options.timeout_ms = 500;
+  options.max_inflight = 8;
+  options.stop_after_good = 16;
+  options.good_latency_ms = 300;
+  options.good_loss_rate = 0.1f;
+  CfvpnBanditOptions bandit = {};
+  bandit.arm_prefix = 26;
+  bandit.batch = 8;
+  bandit.prior_weight = 1.0f;
+  bandit.history = cache;
+  bandit.seed = 3;
+  CfvpnTcpingJob* job =
+      cfvpn_bandit_tcping_start("127.89.0.0/24", 240, port_, &options, &bandit);
+  ASSERT_NE(job, nullptr);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!cfvpn_tcping_is_done(job) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_TRUE(cfvpn_tcping_is_done(job));
+  EXPECT_EQ(cfvpn_tcping_stop_reason(job), 1);
+
+  std::vector<CfvpnProbeResult> results(240);
+  const int32_t count = cfvpn_tcping_results(job, results.data(), 240);
+  ASSERT_GE(count, 16);
+  EXPECT_LE(cfvpn_tcping_completed(job), count);  // 最后一轮可能没探测完
+  int first_round_served = 0;
+  int good = 0;
+  for (int32_t i = 0; i < count; ++i) {
+    const bool served = (results[i].ip & 0xFFFFFFC0u) == 0x7F590080u;
+    if (i < 8 && served) ++first_round_served;
+    if (results[i].received > 0) {
+      EXPECT_TRUE(served);
+      ++good;
+    }
+  }
+  EXPECT_GE(first_round_served, 5);
+  EXPECT_EQ(good, 16);
+  cfvpn_tcping_free(job);
+  cfvpn_node_cache_close(cache);
+  std::remove(path.c_str());
+
+  EXPECT_EQ(cfvpn_bandit_tcping_start("not a cidr", 10, port_, &options,
+                                      nullptr),
+            nullptr);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,299 @@
+#include "core/share_link.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/native_api.h"
+
+namespace cfvpn {
+namespace {
+
+std::string Base64(const std::string& data) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < data.size(); i += 3) {
+    uint32_t x = static_cast<uint8_t>(data[i]) << 16;
+    if (i + 1 < data.size()) x |= static_cast<uint8_t>(data[i + 1]) << 8;
+    if (i + 2 < data.size()) x |= static_cast<uint8_t>(data[i + 2]);
+    out.push_back(kAlphabet[x >> 18 & 63]);
+    out.push_back(kAlphabet[x >> 12 & 63]);
+    out.push_back(i + 1 < data.size() ? kAlphabet[x >> 6 & 63] : '=');
+    out.push_back(i + 2 < data.size() ? kAlphabet[x & 63] : '=');
+  }
+  return out;
+}
+
+ShareLink Parse(const std::string& link) {
+  ShareLink out;
+  std::string error;
+  EXPECT_TRUE(ParseShareLink(link, &out, &error)) << link << ": " << error;
+  return out;
+}
+
+std::string ParseError(const std::string& link) {
+  ShareLink out;
+  std::string error;
+  EXPECT_FALSE(ParseShareLink(link, &out, &error)) << link;
+  return error;
+}
+
+const char kVmessJson[] =
+    R"({"v":"2","ps":"香港 01","add":"104.16.1.2","port":"8443",)"
+    R"("id":"b831381d-6324-4d53-ad4f-8cda48b30811","aid":0,"scy":"",)"
+    R"("net":"ws","type":"none","host":"a.example.com","path":"/ws","tls":"tls"})";
+
+TEST(ShareLinkTest, ParsesVmess) {
+  const ShareLink link = Parse("vmess://" + Base64(kVmessJson));
+  EXPECT_EQ(link.protocol, LinkProtocol::kVmess);
+  EXPECT_EQ(link.name, "香港 01");
+  EXPECT_EQ(link.address, "104.16.1.2");
+  EXPECT_EQ(link.port, 8443);
+  EXPECT_EQ(link.user_id, "b831381d-6324-4d53-ad4f-8cda48b30811");
+  EXPECT_EQ(link.method, "auto");
+  EXPECT_EQ(link.network, "ws");
+  EXPECT_EQ(link.security, "tls");
+  EXPECT_EQ(link.host, "a.example.com");
+  EXPECT_EQ(link.path, "/ws");
+  EXPECT_EQ(link.sni, "a.example.com");
+
+  // 端口为数字、去掉填充、无效端口回退到 443
+  std::string unpadded = Base64(
+      R"({"add":"h","port":2053,"id":"u","net":"tcp"})");
+  while (unpadded.back() == '=') unpadded.pop_back();
+  EXPECT_EQ(Parse("vmess://" + unpadded).port, 2053);
+  EXPECT_EQ(Parse("vmess://" + Base64(R"({"add":"h","port":"x","id":"u"})")).port,
+            443);
+}
+
+TEST(ShareLinkTest, ParsesVless) {
+  const ShareLink link = Parse(
+      "vless://b831381d-6324-4d53-ad4f-8cda48b30811@[2606:4700::1]:443"
+      "?encryption=none&security=tls&sni=edge.example.com&type=ws"
+      "&host=h.example.com&path=%2F%3Fed%3D2560#%E6%B5%8B%E8%AF%95+node");
+  EXPECT_EQ(link.protocol, LinkProtocol::kVless);
+  EXPECT_EQ(link.address, "2606:4700::1");
+  EXPECT_EQ(link.port, 443);
+  EXPECT_EQ(link.user_id, "b831381d-6324-4d53-ad4f-8cda48b30811");
+  EXPECT_EQ(link.method, "none");
+  EXPECT_EQ(link.network, "ws");
+  EXPECT_EQ(link.security, "tls");
+  EXPECT_EQ(link.host, "h.example.com");
+  EXPECT_EQ(link.path, "/?ed=2560");
+  EXPECT_EQ(link.sni, "edge.example.com");
+  EXPECT_EQ(link.name, "测试 node");
+
+  const ShareLink grpc =
+      Parse("VLESS://id@host.example?type=grpc&serviceName=svc&host=a,b");
+  EXPECT_EQ(grpc.port, 443);
+  EXPECT_EQ(grpc.network, "grpc");
+  EXPECT_EQ(grpc.path, "svc");
+  EXPECT_EQ(grpc.sni, "a");
+  EXPECT_EQ(grpc.security, "");
+}
+
+TEST(ShareLinkTest, ParsesTrojan) {
+  const ShareLink plain = Parse("trojan://p%40ss@1.2.3.4:8443#t");
+  EXPECT_EQ(plain.protocol, LinkProtocol::kTrojan);
+  EXPECT_EQ(plain.user_id, "p@ss");
+  EXPECT_EQ(plain.address, "1.2.3.4");
+  EXPECT_EQ(plain.port, 8443);
+  EXPECT_EQ(plain.network, "tcp");
+  EXPECT_EQ(plain.security, "tls");
+  EXPECT_EQ(plain.name, "t");
+
+  const ShareLink ws =
+      Parse("trojan://pw@example.com:443/?type=ws&path=/t&sni=s.example.com");
+  EXPECT_EQ(ws.network, "ws");
+  EXPECT_EQ(ws.path, "/t");
+  EXPECT_EQ(ws.security, "tls");
+  EXPECT_EQ(ws.sni, "s.example.com");
+}
+
+TEST(ShareLinkTest, ParsesShadowsocksForms) {
+  // SIP002，userinfo 为 base64
+  const ShareLink sip002 = Parse("ss://" + Base64("aes-256-gcm:pa:ss") +
+                                 "@192.0.2.1:8388#Example%20SS");
+  EXPECT_EQ(sip002.protocol, LinkProtocol::kShadowsocks);
+  EXPECT_EQ(sip002.method, "aes-256-gcm");
+  EXPECT_EQ(sip002.user_id, "pa:ss");
+  EXPECT_EQ(sip002.address, "192.0.2.1");
+  EXPECT_EQ(sip002.port, 8388);
+  EXPECT_EQ(sip002.name, "Example SS");
+  EXPECT_EQ(sip002.network, "tcp");
+
+  // SIP002，明文 userinfo
+  const ShareLink plain =
+      Parse("ss://2022-blake3-aes-128-gcm:key%3D@host.example:443");
+  EXPECT_EQ(plain.method, "2022-blake3-aes-128-gcm");
+  EXPECT_EQ(plain.user_id, "key=");
+
+  // 旧格式：整体 base64
+  const ShareLink legacy =
+      Parse("ss://" + Base64("chacha20-ietf-poly1305:pw@[::1]:1234") + "#old");
+  EXPECT_EQ(legacy.method, "chacha20-ietf-poly1305");
+  EXPECT_EQ(legacy.user_id, "pw");
+  EXPECT_EQ(legacy.address, "::1");
+  EXPECT_EQ(legacy.port, 1234);
+  EXPECT_EQ(legacy.name, "old");
+
+  // v2ray-plugin
+  const ShareLink plugin = Parse(
+      "ss://" + Base64("aes-128-gcm:pw") +
+      "@cdn.example.com:443/?plugin=v2ray-plugin%3Bmode%3Dwebsocket%3B"
+      "host%3Dws.example.com%3Bpath%3D%2Fss%3Btls#p");
+  EXPECT_EQ(plugin.network, "ws");
+  EXPECT_EQ(plugin.security, "tls");
+  EXPECT_EQ(plugin.host, "ws.example.com");
+  EXPECT_EQ(plugin.path, "/ss");
+  EXPECT_EQ(plugin.sni, "ws.example.com");
+}
+
+TEST(ShareLinkTest, ReportsMalformedLinks) {
+  EXPECT_EQ(ParseError("http://example.com"), "不支持的协议: http");
+  EXPECT_EQ(ParseError("not a link"), "不是分享链接");
+  EXPECT_EQ(ParseError("vmess://!!!"), "vmess 内容不是有效的 base64");
+  EXPECT_NE(ParseError("vmess://" + Base64("{\"add\":")).find("JSON"),
+            std::string::npos);
+  EXPECT_EQ(ParseError("vmess://" + Base64(R"({"id":"u"})")), "缺少服务器地址");
+  EXPECT_EQ(ParseError("vless://@host:443"), "缺少 UUID");
+  EXPECT_EQ(ParseError("vless://id@:443"), "缺少服务器地址");
+  EXPECT_EQ(ParseError("vless://id@host:70000"), "端口无效: 70000");
+  EXPECT_EQ(ParseError("trojan://pw@host:0"), "端口无效: 0");
+  EXPECT_EQ(ParseError("trojan://host:443"), "缺少密码");
+  EXPECT_EQ(ParseError("vless://id@[::1:443"), "IPv6 地址缺少 ']'");
+  EXPECT_EQ(ParseError("ss://" + Base64("nocolon") + "@h:1"),
+            "用户信息应为 method:password");
+  EXPECT_EQ(ParseError("ss://" + Base64("m:p")), "ss 内容缺少服务器地址");
+}
+
+TEST(ShareLinkTest, ParsesSubscriptionWithPerLineErrors) {
+  const std::string lines =
+      "vmess://" + Base64(kVmessJson) + "\r\n" +
+      "\n"
+      "vless://id@a.example.com:443#a\n"
+      "garbage\n"
+      "trojan://pw@b.example.com:443\n"
+      "ss://" + Base64("aes-128-gcm:pw") + "@c.example.com:8388\n"
+      "vless://id@:1\n";
+  for (const std::string& data : {lines, Base64(lines), "\xEF\xBB\xBF" + lines}) {
+    std::vector<ShareLink> links;
+    std::vector<LinkError> errors;
+    EXPECT_EQ(ParseSubscription(data, &links, &errors), 6);
+    ASSERT_EQ(links.size(), 4u);
+    EXPECT_EQ(links[0].line, 1);
+    EXPECT_EQ(links[1].address, "a.example.com");
+    EXPECT_EQ(links[1].line, 3);
+    EXPECT_EQ(links[3].protocol, LinkProtocol::kShadowsocks);
+    ASSERT_EQ(errors.size(), 2u);
+    EXPECT_EQ(errors[0].line, 4);
+    EXPECT_EQ(errors[1].line, 7);
+  }
+
+  std::vector<ShareLink> links;
+  std::vector<LinkError> errors;
+  EXPECT_EQ(ParseSubscription("Zm9vY", &links, &errors), 0);
+  ASSERT_EQ(errors.size(), 1u);
+  EXPECT_EQ(errors[0].line, 0);
+}
+
+TEST(ShareLinkTest, NativeApiExposesFlatRecords) {
+  const std::string data =
+      "trojan://pw@b.example.com:2083#名字\nbroken\n";
+  CfvpnLinkBatch* batch =
+      cfvpn_links_parse(data.data(), static_cast<int32_t>(data.size()));
+  ASSERT_EQ(cfvpn_links_count(batch), 1);
+  ASSERT_EQ(cfvpn_links_error_count(batch), 1);
+  const char* strings = cfvpn_links_strings(batch);
+  auto text = [strings](CfvpnStringRef ref) {
+    return std::string(strings + ref.offset, static_cast<size_t>(ref.length));
+  };
+  const CfvpnShareLink& record = cfvpn_links_records(batch)[0];
+  EXPECT_EQ(record.protocol, CFVPN_LINK_TROJAN);
+  EXPECT_EQ(record.port, 2083);
+  EXPECT_EQ(record.line, 1);
+  EXPECT_EQ(text(record.address), "b.example.com");
+  EXPECT_EQ(text(record.name), "名字");
+  EXPECT_EQ(text(record.user_id), "pw");
+  EXPECT_EQ(cfvpn_links_errors(batch)[0].line, 2);
+  EXPECT_EQ(text(cfvpn_links_errors(batch)[0].message), "不是分享链接");
+  EXPECT_LE(record.sni.offset + record.sni.length,
+            cfvpn_links_strings_size(batch));
+  cfvpn_links_free(batch);
+}
+
+// 对合法链接做随机变异（翻转、插入、删除、截断、拼接），检查不会崩溃或
+// 越界，且每个非空行恰好产生一条记录或一条错误
+TEST(ShareLinkFuzzTest, MutatedLinksNeverCrash) {
+  const std::vector<std::string> corpus = {
+      "vmess://" + Base64(kVmessJson),
+      "vless://id@[2606:4700::1]:443?type=ws&path=%2Fa&sni=s#n%20x",
+      "trojan://pw@1.2.3.4:8443?security=tls&type=grpc&serviceName=g#t",
+      "ss://" + Base64("aes-256-gcm:pw") + "@h.example:8388/?plugin=v2ray-plugin%3Bpath%3D%2Fp#s",
+      "ss://" + Base64("m:p@[::1]:1") + "#legacy",
+  };
+  const std::string alphabet = "%:@/?#&=[]+-_ \x01\xff" "AZaz09vmess://";
+  std::mt19937 random(20240601);
+  int parsed = 0;
+  for (int iteration = 0; iteration < 20000; ++iteration) {
+    std::string link = corpus[random() % corpus.size()];
+    const int mutations = 1 + static_cast<int>(random() % 4);
+    for (int m = 0; m < mutations && !link.empty(); ++m) {
+      const size_t at = random() % link.size();
+      switch (random() % 5) {
+        case 0:
+          link[at] = static_cast<char>(random());
+          break;
+        case 1:
+          link.insert(at, 1, alphabet[random() % alphabet.size()]);
+          break;
+        case 2:
+          link.erase(at, 1 + random() % 8);
+          break;
+        case 3:
+          link.resize(at);
+          break;
+        default:
+          link += corpus[random() % corpus.size()].substr(at % 20);
+          break;
+      }
+    }
+    ShareLink out;
+    std::string error;
+    if (ParseShareLink(link, &out, &error)) {
+      ++parsed;
+      EXPECT_FALSE(out.address.empty()) << link;
+      EXPECT_GT(out.port, 0);
+    } else {
+      EXPECT_FALSE(error.empty()) << link;
+    }
+
+    std::vector<ShareLink> links;
+    std::vector<LinkError> errors;
+    const std::string blob = link + "\n" + link;
+    const int lines = ParseSubscription(blob, &links, &errors);
+    if (lines > 0) {
+      EXPECT_EQ(static_cast<size_t>(lines), links.size() + errors.size());
+    }
+  }
+  // 变异后仍有相当一部分可以解析，说明覆盖到了各协议的深层逻辑
+  EXPECT_GT(parsed, 1000);
+}
+
+TEST(ShareLinkFuzzTest, RandomBytesNeverCrash) {
+  std::mt19937 random(99);
+  for (int iteration = 0; iteration < 5000; ++iteration) {
+    std::string data(random() % 200, '\0');
+    for (char& c : data) c = static_cast<char>(random());
+    if (iteration % 2 == 0) data = "vmess://" + Base64(data);
+    std::vector<ShareLink> links;
+    std::vector<LinkError> errors;
+    ParseSubscription(data, &links, &errors);
+  }
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,197 @@
+#include "core/startup_prewarm.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "core/native_api.h"
+
+namespace cfvpn {
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr char kTemplatePath[] = CFVPN_ASSETS_DIR "/js/v2ray_config.json";
+
+class StartupPrewarmTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = fs::path(::testing::TempDir()) /
+           (std::string("prewarm_") +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    fs::remove_all(dir_);
+    fs::create_directories(dir_);
+  }
+
+  void TearDown() override { fs::remove_all(dir_); }
+
+  std::string Path(const char* name) const { return (dir_ / name).string(); }
+
+  std::string WriteFile(const char* name, const std::string& content) {
+    const std::string path = Path(name);
+    std::ofstream(path, std::ios::binary) << content;
+    return path;
+  }
+
+  // 预先写入 count 个节点的缓存文件
+  std::string MakeNodeCache(int count) {
+    const std::string path = Path("node_cache.bin");
+    NodeCache cache;
+    EXPECT_TRUE(cache.Open(path, NodeCacheOptions()));
+    for (int i = 0; i < count; ++i) {
+      NodeSample sample;
+      sample.ip = 0x68100000u + static_cast<uint32_t>(i);
+      sample.latency_ms = 50 + i;
+      sample.loss_rate = 0;
+      cache.Update(sample, 1700000000);
+    }
+    cache.Flush();
+    return path;
+  }
+
+  PrewarmOptions FullOptions() {
+    PrewarmOptions options;
+    options.node_cache_path = MakeNodeCache(5);
+    options.config_template_path = kTemplatePath;
+    options.v2ray_path = CFVPN_FAKE_V2RAY_PATH;
+    options.geo_files = {WriteFile("geoip.dat", std::string(3000, 'i')),
+                         WriteFile("geosite.dat", std::string(5000, 's'))};
+    return options;
+  }
+
+  fs::path dir_;
+};
+
+TEST_F(StartupPrewarmTest, PreparesEverything) {
+  const PrewarmOptions options = FullOptions();
+  NodeCache cache;
+  V2rayConfigBuilder builder;
+  PrewarmReport report;
+  RunStartupPrewarm(options, &cache, &builder, &report);
+
+  EXPECT_TRUE(report.node_cache_opened);
+  EXPECT_EQ(report.node_cache_size, 5);
+  EXPECT_EQ(cache.size(), 5u);
+
+  EXPECT_TRUE(report.template_loaded) << report.template_error;
+  ASSERT_TRUE(builder.loaded());
+  V2rayConfigParams params;
+  params.server_ip = "104.16.1.1";
+  EXPECT_NE(builder.Build(params).find("104.16.1.1"), std::string::npos);
+
+  EXPECT_TRUE(report.v2ray.found);
+  EXPECT_TRUE(report.v2ray_executable);
+  EXPECT_EQ(report.v2ray.size,
+            static_cast<int64_t>(fs::file_size(CFVPN_FAKE_V2RAY_PATH)));
+  ASSERT_EQ(report.geo_files.size(), 2u);
+  EXPECT_TRUE(report.geo_files[0].found);
+  EXPECT_EQ(report.geo_files[1].size, 5000);
+  EXPECT_EQ(report.prefetched_bytes, report.v2ray.size + 3000 + 5000);
+  EXPECT_GE(report.total_us, report.files_us);
+}
+
+TEST_F(StartupPrewarmTest, ReportsMissingAndInvalidInputs) {
+  PrewarmOptions options;
+  options.config_template_path = WriteFile("bad.json", "{\"inbounds\": [");
+  options.v2ray_path = WriteFile("v2ray.exe", "not a binary");
+  options.geo_files = {Path("geoip.dat"), WriteFile("geosite.dat", "")};
+  NodeCache cache;
+  V2rayConfigBuilder builder;
+  PrewarmReport report;
+  RunStartupPrewarm(options, &cache, &builder, &report);
+
+  EXPECT_FALSE(report.node_cache_opened);
+  EXPECT_FALSE(cache.is_open());
+  EXPECT_FALSE(report.template_loaded);
+  EXPECT_FALSE(report.template_error.empty());
+  EXPECT_TRUE(report.v2ray.found);
+  EXPECT_FALSE(report.v2ray_executable);
+  ASSERT_EQ(report.geo_files.size(), 2u);
+  EXPECT_FALSE(report.geo_files[0].found);
+  EXPECT_FALSE(report.geo_files[1].found);  // 空文件
+}
+
+TEST_F(StartupPrewarmTest, MissingTemplateFile) {
+  PrewarmOptions options;
+  options.config_template_path = Path("missing.json");
+  V2rayConfigBuilder builder;
+  PrewarmReport report;
+  RunStartupPrewarm(options, nullptr, &builder, &report);
+  EXPECT_FALSE(report.template_loaded);
+  EXPECT_NE(report.template_error.find("missing.json"), std::string::npos);
+}
+
+TEST_F(StartupPrewarmTest, PrefetchCanBeDisabled) {
+  PrewarmOptions options = FullOptions();
+  options.prefetch_files = false;
+  PrewarmReport report;
+  RunStartupPrewarm(options, nullptr, nullptr, &report);
+  EXPECT_EQ(report.prefetched_bytes, 0);
+  EXPECT_TRUE(report.v2ray_executable);
+  // 没有提供目标对象的步骤被跳过
+  EXPECT_FALSE(report.node_cache_opened);
+  EXPECT_FALSE(report.template_loaded);
+  EXPECT_TRUE(report.template_error.empty());
+}
+
+// C API 的预热在进程内只执行一次，全部断言放在同一个测试中
+TEST_F(StartupPrewarmTest, CApiHandsResultsToCaller) {
+  const PrewarmOptions options = FullOptions();
+  const char* geo_files[] = {options.geo_files[0].c_str(),
+                             options.geo_files[1].c_str()};
+  CfvpnPrewarmOptions c_options = {};
+  c_options.node_cache_path = options.node_cache_path.c_str();
+  c_options.config_template_path = options.config_template_path.c_str();
+  c_options.v2ray_path = options.v2ray_path.c_str();
+  c_options.geo_files = geo_files;
+  c_options.geo_file_count = 2;
+
+  // 预热状态是进程级的，先复位以免受之前测试或重复运行的影响
+  ASSERT_EQ(cfvpn_prewarm_reset(), 1);
+  EXPECT_EQ(cfvpn_prewarm_status(0, nullptr), CFVPN_PREWARM_NOT_STARTED);
+  EXPECT_EQ(cfvpn_prewarm_take_node_cache(), nullptr);
+  ASSERT_EQ(cfvpn_prewarm_start(&c_options), 1);
+  EXPECT_EQ(cfvpn_prewarm_start(&c_options), 0);
+
+  CfvpnPrewarmStatus status;
+  ASSERT_EQ(cfvpn_prewarm_status(10000, &status), CFVPN_PREWARM_DONE);
+  EXPECT_EQ(status.state, CFVPN_PREWARM_DONE);
+  EXPECT_EQ(status.node_cache_size, 5);
+  EXPECT_EQ(status.template_loaded, 1);
+  EXPECT_EQ(status.v2ray_found, 1);
+  EXPECT_EQ(status.geo_missing, 0);
+  EXPECT_GT(status.total_us, 0);
+  EXPECT_STREQ(status.message, "");
+  EXPECT_EQ(cfvpn_prewarm_status(0, nullptr), CFVPN_PREWARM_DONE);
+
+  CfvpnNodeCache* cache = cfvpn_prewarm_take_node_cache();
+  ASSERT_NE(cache, nullptr);
+  EXPECT_EQ(cfvpn_node_cache_size(cache), 5);
+  EXPECT_EQ(cfvpn_prewarm_take_node_cache(), nullptr);
+  cfvpn_node_cache_close(cache);
+
+  CfvpnConfigBuilder* builder = cfvpn_prewarm_take_config_builder();
+  ASSERT_NE(builder, nullptr);
+  CfvpnV2rayConfigParams params = {};
+  params.server_ip = "104.16.2.2";
+  params.socks_port = 7898;
+  params.http_port = 7899;
+  int32_t length = 0;
+  const char* config = cfvpn_config_builder_build(builder, &params, &length);
+  EXPECT_NE(std::string(config, static_cast<size_t>(length)).find("104.16.2.2"),
+            std::string::npos);
+  EXPECT_EQ(cfvpn_prewarm_take_config_builder(), nullptr);
+  cfvpn_config_builder_free(builder);
+
+  // 复位后可以再次启动
+  ASSERT_EQ(cfvpn_prewarm_reset(), 1);
+  EXPECT_EQ(cfvpn_prewarm_status(0, nullptr), CFVPN_PREWARM_NOT_STARTED);
+  ASSERT_EQ(cfvpn_prewarm_start(&c_options), 1);
+  ASSERT_EQ(cfvpn_prewarm_status(10000, nullptr), CFVPN_PREWARM_DONE);
+  EXPECT_EQ(cfvpn_prewarm_reset(), 1);
+}
+
+}  // namespace
+}  // namespace cfvpn
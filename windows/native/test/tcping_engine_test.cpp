@@ -0,0 +1,427 @@
+#include "core/tcping_engine.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+using testing::LoopbackServer;
+
+// 回环延迟远低于 30ms，测试中关闭最小有效延迟过滤
+TcpingOptions LoopbackOptions() {
+  TcpingOptions options;
+  options.attempts = 3;
+  options.timeout_ms = 500;
+  options.min_valid_latency_ms = 0;
+  options.interval_ms = 1;
+  options.max_inflight = 256;
+  return options;
+}
+
+// 向不 accept 的监听器发起几次连接，把积压队列占满
+void FillBacklog(uint16_t port) {
+  TcpingOptions options = LoopbackOptions();
+  options.attempts = 1;
+  options.timeout_ms = 100;
+  std::vector<ProbeTarget> fill(4, ProbeTarget{kLoopbackIp, port});
+  std::vector<ProbeResult> ignored;
+  TcpingEngine(options).Run(fill, &ignored);
+}
+
+TEST(TcpingEngineTest, MeasuresReachableListener) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  TcpingEngine engine(LoopbackOptions());
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()}}, &results));
+
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].ip, kLoopbackIp);
+  EXPECT_EQ(results[0].port, server.port());
+  EXPECT_EQ(results[0].sent, 3);
+  EXPECT_EQ(results[0].received, 3);
+  EXPECT_FLOAT_EQ(results[0].loss_rate, 0.0f);
+  EXPECT_GE(results[0].latency_ms, 0);
+  EXPECT_LT(results[0].latency_ms, kFailedLatencyMs);
+  EXPECT_EQ(engine.completed(), 1u);
+}
+
+TEST(TcpingEngineTest, ReportsDistributionAndSkipsExtraSamplesWhenStable) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  TcpingOptions options = LoopbackOptions();
+  options.attempts = 4;
+  options.extra_attempts = 4;
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()},
+                          {kLoopbackIp, testing::UnusedLoopbackPort()}},
+                         &results));
+
+  // 回环延迟稳定在 0-1ms，抖动不超过平均值的比例，不追加样本
+  const ProbeResult& ok = results[0];
+  EXPECT_EQ(ok.sent, 4);
+  EXPECT_EQ(ok.received, 4);
+  EXPECT_LE(ok.p50_ms, ok.p90_ms);
+  EXPECT_LE(ok.p90_ms, ok.p99_ms);
+  EXPECT_LT(ok.p99_ms, 50);
+  EXPECT_GE(ok.jitter_ms, 0.0f);
+  EXPECT_FLOAT_EQ(ok.score, static_cast<float>(ok.latency_ms));
+
+  const ProbeResult& failed = results[1];
+  EXPECT_EQ(failed.sent, 2);
+  EXPECT_EQ(failed.p50_ms, kFailedLatencyMs);
+  EXPECT_EQ(failed.p99_ms, kFailedLatencyMs);
+  EXPECT_FLOAT_EQ(failed.jitter_ms, 0.0f);
+}
+
+TEST(TcpingEngineTest, TailAwareScoreSeparatesEqualAverages) {
+  ProbeResult steady = {};
+  steady.latency_ms = 100;
+  steady.p50_ms = 100;
+  steady.p90_ms = 104;
+  steady.p99_ms = 108;
+  steady.jitter_ms = 3;
+  ProbeResult spiky = steady;
+  spiky.p50_ms = 70;
+  spiky.p90_ms = 200;
+  spiky.p99_ms = 260;
+  spiky.jitter_ms = 80;
+
+  // 默认只看平均延迟，两者相同
+  EXPECT_FLOAT_EQ(LatencyScore(steady, LatencyScoreWeights()),
+                  LatencyScore(spiky, LatencyScoreWeights()));
+
+  LatencyScoreWeights tail;
+  tail.mean = 0;
+  tail.p50 = 1;
+  tail.p99 = 0.5f;
+  tail.jitter = 0.5f;
+  EXPECT_LT(LatencyScore(steady, tail), LatencyScore(spiky, tail));
+
+  LatencyScoreWeights lossy;
+  lossy.loss = 4;
+  steady.loss_rate = 0.25f;
+  EXPECT_FLOAT_EQ(LatencyScore(steady, lossy), 200.0f);
+}
+
+TEST(TcpingEngineTest, RefusedPortGivesUpAfterTwoFailures) {
+  const uint16_t port = testing::UnusedLoopbackPort();
+
+  TcpingEngine engine(LoopbackOptions());
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, port}}, &results));
+
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].sent, 2);
+  EXPECT_EQ(results[0].received, 0);
+  EXPECT_EQ(results[0].latency_ms, kFailedLatencyMs);
+  EXPECT_FLOAT_EQ(results[0].loss_rate, 1.0f);
+}
+
+TEST(TcpingEngineTest, FastConnectBelowMinimumCountsAsLoss) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  TcpingOptions options = LoopbackOptions();
+  options.min_valid_latency_ms = 30;
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()}}, &results));
+
+  // 连接成功但延迟过低，视为假连接：全部尝试都会进行，但没有有效样本
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].sent, 3);
+  EXPECT_EQ(results[0].received, 0);
+  EXPECT_EQ(results[0].latency_ms, kFailedLatencyMs);
+}
+
+TEST(TcpingEngineTest, KeepsThousandsOfProbesInFlight) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  TcpingOptions options = LoopbackOptions();
+  options.attempts = 1;
+  options.max_inflight = 1024;
+
+  std::vector<ProbeTarget> targets(3000, ProbeTarget{kLoopbackIp, server.port()});
+  size_t callbacks = 0;
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run(
+      targets, &results,
+      [&callbacks](size_t, const ProbeResult&) { ++callbacks; }));
+
+  ASSERT_EQ(results.size(), targets.size());
+  EXPECT_EQ(callbacks, targets.size());
+  size_t reachable = 0;
+  for (const ProbeResult& result : results) {
+    if (result.received == 1) {
+      ++reachable;
+    }
+  }
+  EXPECT_EQ(reachable, targets.size());
+}
+
+TEST(TcpingEngineTest, MixedTargetsKeepInputOrder) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+  const uint16_t closed_port = testing::UnusedLoopbackPort();
+
+  std::vector<ProbeTarget> targets;
+  for (int i = 0; i < 50; ++i) {
+    targets.push_back({kLoopbackIp, i % 2 == 0 ? server.port() : closed_port});
+  }
+  TcpingEngine engine(LoopbackOptions());
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run(targets, &results));
+
+  ASSERT_EQ(results.size(), targets.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].port, targets[i].port);
+    if (i % 2 == 0) {
+      EXPECT_EQ(results[i].received, 3) << i;
+    } else {
+      EXPECT_EQ(results[i].received, 0) << i;
+    }
+  }
+}
+
+TEST(TcpingEngineTest, CancelStopsRunPromptly) {
+  // 积压队列已满的监听器：连接既不成功也不失败，只能等待超时
+  LoopbackServer server(nullptr, 0, false);
+  ASSERT_TRUE(server.ok());
+  FillBacklog(server.port());
+
+  TcpingOptions options = LoopbackOptions();
+  options.timeout_ms = 2000;
+  options.max_inflight = 4;
+  std::vector<ProbeTarget> targets(200, ProbeTarget{kLoopbackIp, server.port()});
+
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  std::thread canceller([&engine]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    engine.Cancel();
+  });
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(engine.Run(targets, &results));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  canceller.join();
+
+  EXPECT_LT(elapsed, std::chrono::seconds(1));
+  EXPECT_EQ(engine.completed(), 0u);
+  ASSERT_EQ(results.size(), targets.size());
+  EXPECT_EQ(results.back().sent, 0);
+  EXPECT_EQ(results.back().latency_ms, kFailedLatencyMs);
+  EXPECT_FLOAT_EQ(results.back().loss_rate, 1.0f);
+}
+
+TEST(TcpingEngineTest, BacklogOverflowTimesOut) {
+  // 只监听不 accept，积压队列填满后新的 SYN 会被内核丢弃，连接只能超时
+  LoopbackServer server(nullptr, 0, false);
+  ASSERT_TRUE(server.ok());
+  FillBacklog(server.port());
+
+  TcpingOptions options = LoopbackOptions();
+  options.timeout_ms = 100;
+  options.attempts = 1;
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(engine.Run({{kLoopbackIp, server.port()}}, &results));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].received, 0);
+  EXPECT_GE(elapsed, std::chrono::milliseconds(90));
+}
+
+TEST(TcpingEngineTest, StopsAsSoonAsEnoughGoodNodes) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  TcpingOptions options = LoopbackOptions();
+  options.attempts = 1;
+  options.max_inflight = 8;
+  options.stop_after_good = 20;
+  options.good_latency_ms = kFailedLatencyMs;
+  options.good_loss_rate = 0.5f;
+  std::vector<ProbeTarget> targets(2000, ProbeTarget{kLoopbackIp, server.port()});
+
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run(targets, &results));
+
+  // 在每个目标完成时检查，而不是等一整批结束
+  EXPECT_EQ(engine.stop_reason(), StopReason::kEnoughGood);
+  EXPECT_EQ(engine.completed(), 20u);
+  ASSERT_EQ(results.size(), targets.size());
+  EXPECT_EQ(results.back().sent, 0);
+}
+
+TEST(TcpingEngineTest, StopsWhenRecentFailureRateIsHigh) {
+  const uint16_t port = testing::UnusedLoopbackPort();
+
+  TcpingOptions options = LoopbackOptions();
+  options.failure_window = 60;
+  options.failure_rate_threshold = 0.9f;
+  std::vector<ProbeTarget> targets(1000, ProbeTarget{kLoopbackIp, port});
+
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run(targets, &results));
+
+  EXPECT_EQ(engine.stop_reason(), StopReason::kTooManyFailures);
+  EXPECT_EQ(engine.completed(), 60u);
+}
+
+TEST(TcpingEngineTest, AdaptiveWindowGrowsOnHealthyTargets) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  TcpingOptions options = LoopbackOptions();
+  options.attempts = 1;
+  options.adaptive_inflight = true;
+  options.min_inflight = 4;
+  options.initial_inflight = 8;
+  options.max_inflight = 512;
+  std::vector<ProbeTarget> targets(1000, ProbeTarget{kLoopbackIp, server.port()});
+
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run(targets, &results));
+
+  EXPECT_EQ(engine.stop_reason(), StopReason::kCompleted);
+  EXPECT_EQ(engine.completed(), targets.size());
+  EXPECT_EQ(engine.inflight_limit(), 512);
+}
+
+TEST(TcpingEngineTest, AdaptiveWindowShrinksOnTimeouts) {
+  // 积压队列已满的监听器上连接全部超时
+  LoopbackServer server(nullptr, 0, false);
+  ASSERT_TRUE(server.ok());
+  FillBacklog(server.port());
+
+  TcpingOptions options = LoopbackOptions();
+  options.attempts = 1;
+  options.timeout_ms = 20;
+  options.adaptive_inflight = true;
+  options.min_inflight = 2;
+  options.initial_inflight = 32;
+  options.max_inflight = 64;
+  std::vector<ProbeTarget> targets(200, ProbeTarget{kLoopbackIp, server.port()});
+
+  TcpingEngine engine(options);
+  std::vector<ProbeResult> results;
+  ASSERT_TRUE(engine.Run(targets, &results));
+
+  EXPECT_EQ(engine.completed(), targets.size());
+  EXPECT_LT(engine.inflight_limit(), 32);
+}
+
+TEST(NativeApiTest, TcpingJobRoundTrip) {
+  LoopbackServer server;
+  ASSERT_TRUE(server.ok());
+
+  const uint32_t ips[] = {kLoopbackIp, kLoopbackIp};
+  CfvpnTcpingOptions options = {};
+  options.attempts = 2;
+  options.timeout_ms = 500;
+  options.interval_ms = 1;
+  options.max_inflight = 64;
+  EXPECT_EQ(cfvpn_tcping_start(nullptr, 2, server.port(), &options), nullptr);
+  EXPECT_EQ(cfvpn_tcping_start(ips, 0, server.port(), &options), nullptr);
+  CfvpnTcpingJob* job = cfvpn_tcping_start(ips, 2, server.port(), &options);
+  ASSERT_NE(job, nullptr);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!cfvpn_tcping_is_done(job) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_TRUE(cfvpn_tcping_is_done(job));
+  EXPECT_EQ(cfvpn_tcping_completed(job), 2);
+
+  CfvpnProbeResult results[2];
+  ASSERT_EQ(cfvpn_tcping_results(job, results, 2), 2);
+  EXPECT_EQ(results[0].ip, kLoopbackIp);
+  EXPECT_EQ(results[0].port, server.port());
+  EXPECT_EQ(results[0].sent, 2);
+  EXPECT_EQ(results[1].received, 2);
+  EXPECT_LE(results[0].p50_ms, results[0].p99_ms);
+  EXPECT_FLOAT_EQ(results[0].score,
+                  static_cast<float>(results[0].latency_ms));
+  EXPECT_EQ(cfvpn_tcping_stop_reason(job), 0);
+  EXPECT_EQ(cfvpn_tcping_inflight_limit(job), 64);
+  cfvpn_tcping_free(job);
+}
+
+// 混合 IPv4/IPv6 目标，IPv6 监听 ::1；没有 IPv6 回环的环境跳过
+TEST(NativeApiTest, TcpingAddressesReachIpv6Loopback) {
+  InitSocketLibrary();
+  NativeSocket listener = ::socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+  sockaddr_storage bound;
+  const int bound_length = MakeSockaddr(IpAddress{Uint128::Make(0, 1), true},
+                                        0, &bound);
+  if (listener == kInvalidSocket ||
+      ::bind(listener, reinterpret_cast<sockaddr*>(&bound), bound_length) !=
+          0 ||
+      ::listen(listener, 64) != 0) {
+    if (listener != kInvalidSocket) CloseSocket(listener);
+    GTEST_SKIP() << "IPv6 回环不可用";
+  }
+  socklen_t length = sizeof(bound);
+  ::getsockname(listener, reinterpret_cast<sockaddr*>(&bound), &length);
+  const uint16_t port =
+      ntohs(reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port);
+
+  // 第三个 IPv4 目标在该端口上无人监听，只检查结果按下标对应
+  CfvpnIpAddress addresses[3] = {};
+  addresses[0].family = 6;
+  addresses[0].bytes[15] = 1;  // ::1
+  addresses[1].family = 6;
+  addresses[1].bytes[0] = 0x01;  // 100::/64 是丢弃前缀，连接失败
+  addresses[2].family = 4;
+  IpAddressBytes(IpAddress::V4(kLoopbackIp), addresses[2].bytes);
+  CfvpnTcpingOptions options = {};
+  options.attempts = 2;
+  options.timeout_ms = 300;
+  options.interval_ms = 1;
+  options.max_inflight = 16;
+  EXPECT_EQ(cfvpn_tcping_start_addresses(nullptr, 3, port, &options), nullptr);
+  EXPECT_EQ(cfvpn_tcping_start_addresses(addresses, 0, port, &options),
+            nullptr);
+  CfvpnTcpingJob* job =
+      cfvpn_tcping_start_addresses(addresses, 3, port, &options);
+  ASSERT_NE(job, nullptr);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!cfvpn_tcping_is_done(job) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_TRUE(cfvpn_tcping_is_done(job));
+  CfvpnProbeResult results[3];
+  ASSERT_EQ(cfvpn_tcping_results(job, results, 3), 3);
+  EXPECT_EQ(results[0].ip, 0u);
+  EXPECT_EQ(results[0].port, port);
+  EXPECT_EQ(results[0].received, 2);
+  EXPECT_EQ(results[1].received, 0);
+  EXPECT_EQ(results[2].ip, kLoopbackIp);
+  cfvpn_tcping_free(job);
+  CloseSocket(listener);
+}
+
+}  // namespace
+}  // namespace cfvpn
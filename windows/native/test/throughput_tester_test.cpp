@@ -0,0 +1,251 @@
+#include "core/throughput_tester.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+using testing::LoopbackServer;
+
+// 代替 speed.cloudflare.com/__down 的回环服务器行为
+struct BulkServerOptions {
+  int status = 200;
+  // 每条连接的发送速率（字节/秒），0 表示不限速
+  int64_t rate = 0;
+  // 前 slow_ms 毫秒内使用 slow_rate，模拟拥塞窗口的爬升
+  int slow_ms = 0;
+  int64_t slow_rate = 0;
+};
+
+// 读完请求头后按 ?bytes=N 发送响应体（缺省时一直发送），对端关闭时返回
+void ServeBulk(NativeSocket client, const BulkServerOptions& options) {
+  std::string head;
+  char buffer[1024];
+  while (head.find("\r\n\r\n") == std::string::npos) {
+    const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+    if (n <= 0) return;
+    head.append(buffer, static_cast<size_t>(n));
+  }
+  int64_t remaining = INT64_MAX;
+  const size_t bytes = head.find("bytes=");
+  if (bytes != std::string::npos) {
+    remaining = std::atoll(head.c_str() + bytes + 6);
+  }
+  std::string response = "HTTP/1.1 " + std::to_string(options.status) +
+                         " Status\r\nConnection: close\r\n";
+  if (remaining != INT64_MAX) {
+    response += "Content-Length: " + std::to_string(remaining) + "\r\n";
+  }
+  response += "\r\n";
+  if (::send(client, response.data(), response.size(), MSG_NOSIGNAL) < 0 ||
+      options.status != 200) {
+    return;
+  }
+
+  // 每 5ms 发送一份，限速时按目标速率折算
+  const std::vector<char> chunk(64 * 1024, 'x');
+  const auto start = std::chrono::steady_clock::now();
+  while (remaining > 0) {
+    const int64_t elapsed_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    const int64_t rate =
+        elapsed_ms < options.slow_ms ? options.slow_rate : options.rate;
+    size_t length = chunk.size();
+    if (rate > 0) {
+      length = static_cast<size_t>(std::min<int64_t>(
+          static_cast<int64_t>(chunk.size()), rate / 200));
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    length = static_cast<size_t>(
+        std::min<int64_t>(static_cast<int64_t>(length), remaining));
+    const ssize_t n = ::send(client, chunk.data(), length, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    remaining -= n;
+  }
+}
+
+ThroughputOptions LoopbackOptions() {
+  ThroughputOptions options;
+  options.connections = 2;
+  options.duration_ms = 1000;
+  options.connect_timeout_ms = 1000;
+  options.sample_interval_ms = 100;
+  options.host = "";
+  options.path = "/__down";
+  return options;
+}
+
+TEST(ThroughputTesterTest, MeasuresPacedDownload) {
+  BulkServerOptions server_options;
+  server_options.rate = 2 * 1000 * 1000;  // 每条连接 16 Mbps
+  LoopbackServer server(
+      [&](NativeSocket client) { ServeBulk(client, server_options); });
+  ASSERT_TRUE(server.ok());
+
+  ThroughputTester tester(LoopbackOptions());
+  ThroughputResult result;
+  ASSERT_TRUE(tester.Run({kLoopbackIp, server.port()}, &result));
+
+  EXPECT_EQ(result.connected, 2);
+  EXPECT_EQ(result.failed, 0);
+  EXPECT_EQ(result.status, 200);
+  EXPECT_GE(result.connect_ms, 0);
+  EXPECT_GE(result.ttfb_ms, 0);
+  EXPECT_GE(result.ramp_up_ms, 0);
+  EXPECT_EQ(tester.bytes(), result.bytes);
+  EXPECT_GE(result.samples_mbps.size(), 8u);
+  // 两条连接共 32 Mbps；sleep 的误差只会让实际速率偏低
+  EXPECT_GT(result.sustained_mbps, 16.0);
+  EXPECT_LT(result.sustained_mbps, 40.0);
+  EXPECT_GE(result.peak_mbps, result.sustained_mbps);
+}
+
+TEST(ThroughputTesterTest, DetectsRampUp) {
+  BulkServerOptions server_options;
+  server_options.slow_ms = 400;
+  server_options.slow_rate = 200 * 1000;
+  server_options.rate = 4 * 1000 * 1000;
+  LoopbackServer server(
+      [&](NativeSocket client) { ServeBulk(client, server_options); });
+  ASSERT_TRUE(server.ok());
+
+  ThroughputOptions options = LoopbackOptions();
+  options.duration_ms = 1500;
+  ThroughputTester tester(options);
+  ThroughputResult result;
+  ASSERT_TRUE(tester.Run({kLoopbackIp, server.port()}, &result));
+
+  EXPECT_GE(result.ramp_up_ms, 300);
+  EXPECT_LE(result.ramp_up_ms, 700);
+  // 爬升阶段不计入稳定吞吐
+  const double average = static_cast<double>(result.bytes) * 8.0 /
+                         (result.elapsed_ms * 1000.0);
+  EXPECT_GT(result.sustained_mbps, average);
+}
+
+TEST(ThroughputTesterTest, ReconnectsWhenPayloadEnds) {
+  LoopbackServer server(
+      [](NativeSocket client) { ServeBulk(client, BulkServerOptions()); });
+  ASSERT_TRUE(server.ok());
+
+  ThroughputOptions options = LoopbackOptions();
+  options.duration_ms = 300;
+  options.path = "/__down?bytes=65536";
+  ThroughputTester tester(options);
+  ThroughputResult result;
+  ASSERT_TRUE(tester.Run({kLoopbackIp, server.port()}, &result));
+
+  EXPECT_GT(result.connected, 2);
+  EXPECT_EQ(result.failed, 0);
+  EXPECT_GE(result.bytes, int64_t{65536} * (result.connected - 2));
+}
+
+TEST(ThroughputTesterTest, CancelStopsEarly) {
+  LoopbackServer server(
+      [](NativeSocket client) { ServeBulk(client, BulkServerOptions()); });
+  ASSERT_TRUE(server.ok());
+
+  ThroughputOptions options = LoopbackOptions();
+  options.duration_ms = 10000;
+  ThroughputTester tester(options);
+  std::thread canceller([&]() {
+    while (tester.bytes() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    tester.Cancel();
+  });
+  const int64_t start = MonotonicMicros();
+  ThroughputResult result;
+  ASSERT_TRUE(tester.Run({kLoopbackIp, server.port()}, &result));
+  canceller.join();
+
+  EXPECT_TRUE(tester.cancelled());
+  EXPECT_LT(MonotonicMicros() - start, 3 * 1000 * 1000);
+  EXPECT_GT(result.bytes, 0);
+  EXPECT_GT(result.sustained_mbps, 0);
+}
+
+TEST(ThroughputTesterTest, RefusedAndRejectedConnectionsFail) {
+  ThroughputOptions options = LoopbackOptions();
+  options.duration_ms = 5000;
+  ThroughputTester refused(options);
+  ThroughputResult result;
+  const int64_t start = MonotonicMicros();
+  ASSERT_TRUE(refused.Run(
+      {kLoopbackIp, testing::UnusedLoopbackPort()}, &result));
+  // 全部连接失败时不等到时长结束
+  EXPECT_LT(MonotonicMicros() - start, 1000 * 1000);
+  EXPECT_EQ(result.connected, 0);
+  EXPECT_EQ(result.failed, 2);
+  EXPECT_EQ(result.bytes, 0);
+  EXPECT_EQ(result.ttfb_ms, -1);
+
+  BulkServerOptions server_options;
+  server_options.status = 403;
+  LoopbackServer server(
+      [&](NativeSocket client) { ServeBulk(client, server_options); });
+  ASSERT_TRUE(server.ok());
+  ThroughputTester rejected(options);
+  ASSERT_TRUE(rejected.Run({kLoopbackIp, server.port()}, &result));
+  EXPECT_EQ(result.status, 403);
+  EXPECT_EQ(result.connected, 0);
+  EXPECT_EQ(result.failed, 2);
+  EXPECT_GE(result.ttfb_ms, 0);
+}
+
+TEST(NativeApiTest, ThroughputJobRoundTrip) {
+  LoopbackServer server(
+      [](NativeSocket client) { ServeBulk(client, BulkServerOptions()); });
+  ASSERT_TRUE(server.ok());
+
+  CfvpnIpAddress address = {};
+  address.family = 4;
+  const uint8_t loopback[4] = {127, 0, 0, 1};
+  std::memcpy(address.bytes, loopback, sizeof(loopback));
+  CfvpnThroughputOptions options = {};
+  options.connections = 3;
+  options.duration_ms = 300;
+  options.host = "";
+  options.path = "/__down";
+  CfvpnThroughputJob* job =
+      cfvpn_throughput_start(&address, server.port(), &options);
+  ASSERT_NE(job, nullptr);
+
+  CfvpnThroughputResult result = {};
+  EXPECT_EQ(cfvpn_throughput_result(job, &result), -1);
+  while (cfvpn_throughput_is_done(job) == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_EQ(cfvpn_throughput_result(job, &result), 0);
+  EXPECT_EQ(result.connected, 3);
+  EXPECT_EQ(result.status, 200);
+  EXPECT_EQ(result.bytes, cfvpn_throughput_bytes(job));
+  EXPECT_GT(result.sustained_mbps, 0);
+  ASSERT_GT(result.sample_count, 0);
+  std::vector<double> samples(static_cast<size_t>(result.sample_count));
+  EXPECT_EQ(cfvpn_throughput_samples(job, samples.data(), result.sample_count),
+            result.sample_count);
+  cfvpn_throughput_free(job);
+
+  EXPECT_EQ(cfvpn_throughput_start(nullptr, server.port(), &options), nullptr);
+}
+
+}  // namespace
+}  // namespace cfvpn
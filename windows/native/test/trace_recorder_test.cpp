@@ -0,0 +1,258 @@
+#include "core/trace_recorder.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/json.h"
+#include "core/native_api.h"
+
+namespace cfvpn {
+namespace {
+
+JsonValue ParseTrace(const std::string& json) {
+  JsonValue root;
+  std::string error;
+  EXPECT_TRUE(ParseJson(json, &root, &error)) << error << "\n" << json;
+  return root;
+}
+
+const JsonValue& Events(const JsonValue& root) {
+  static const JsonValue kEmpty;
+  const JsonValue* events = root.Find("traceEvents");
+  EXPECT_NE(events, nullptr);
+  EXPECT_TRUE(events != nullptr && events->is_array());
+  return events != nullptr ? *events : kEmpty;
+}
+
+std::string Text(const JsonValue& event, const char* key) {
+  const JsonValue* value = event.Find(key);
+  return value != nullptr && value->is_string() ? value->text : "";
+}
+
+int64_t Int(const JsonValue& event, const char* key) {
+  const JsonValue* value = event.Find(key);
+  return value != nullptr ? value->AsInt(-1) : -1;
+}
+
+TEST(TraceRecorderTest, EmptyRecorderIsValidJson) {
+  TraceRecorder recorder;
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  EXPECT_TRUE(Events(root).items.empty());
+  ASSERT_NE(root.Find("displayTimeUnit"), nullptr);
+  EXPECT_EQ(root.Find("displayTimeUnit")->text, "ms");
+}
+
+TEST(TraceRecorderTest, CompleteEventsAreSortedByStart) {
+  TraceRecorder recorder;
+  recorder.AddComplete("second", "startup", 300, 50);
+  recorder.AddComplete("first", "startup", 100, 500);
+  recorder.AddComplete("inner", "plugins", 120, 10);
+
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  const auto& events = Events(root).items;
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(Text(events[0], "name"), "first");
+  EXPECT_EQ(Text(events[1], "name"), "inner");
+  EXPECT_EQ(Text(events[2], "name"), "second");
+  EXPECT_EQ(Text(events[1], "cat"), "plugins");
+  EXPECT_EQ(Text(events[0], "ph"), "X");
+  EXPECT_EQ(Int(events[0], "ts"), 100);
+  EXPECT_EQ(Int(events[0], "dur"), 500);
+  EXPECT_GT(Int(events[0], "pid"), 0);
+  EXPECT_EQ(Int(events[0], "tid"), 1);
+}
+
+TEST(TraceRecorderTest, NegativeStartShiftsTimeline) {
+  // 例如 runner 把进程创建到 wWinMain 之间的加载时间记为负起点
+  TraceRecorder recorder;
+  recorder.AddComplete("loader", "startup", -2000, 2000);
+  recorder.AddComplete("main", "startup", 0, 100);
+
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  const auto& events = Events(root).items;
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(Int(events[0], "ts"), 0);
+  EXPECT_EQ(Int(events[1], "ts"), 2000);
+}
+
+TEST(TraceRecorderTest, InstantEventsUseThreadScope) {
+  TraceRecorder recorder;
+  recorder.AddInstant("first_frame", "startup");
+
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  const auto& events = Events(root).items;
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(Text(events[0], "ph"), "i");
+  EXPECT_EQ(Text(events[0], "s"), "t");
+  EXPECT_EQ(events[0].Find("dur"), nullptr);
+}
+
+TEST(TraceRecorderTest, ThreadsGetOwnBuffersAndNames) {
+  TraceRecorder recorder;
+  recorder.SetThreadName("main");
+  recorder.AddComplete("on_main", "startup", 0, 1);
+
+  constexpr int kThreads = 4;
+  constexpr int kEventsPerThread = 200;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&recorder, t] {
+      recorder.SetThreadName("worker " + std::to_string(t));
+      for (int i = 0; i < kEventsPerThread; ++i) {
+        const int64_t start = recorder.NowUs();
+        recorder.AddComplete("work", "bench", start, recorder.NowUs() - start);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(recorder.event_count(), 1u + kThreads * kEventsPerThread);
+  EXPECT_EQ(recorder.dropped(), 0);
+
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  std::map<int64_t, int> per_thread;
+  std::set<std::string> names;
+  int64_t previous_ts = -1;
+  for (const JsonValue& event : Events(root).items) {
+    if (Text(event, "ph") == "M") {
+      const JsonValue* args = event.Find("args");
+      ASSERT_NE(args, nullptr);
+      names.insert(Text(*args, "name"));
+      continue;
+    }
+    EXPECT_GE(Int(event, "ts"), previous_ts);
+    previous_ts = Int(event, "ts");
+    ++per_thread[Int(event, "tid")];
+  }
+  EXPECT_EQ(per_thread.size(), 1u + kThreads);
+  for (const auto& [tid, count] : per_thread) {
+    if (tid != 1) {
+      EXPECT_EQ(count, kEventsPerThread) << tid;
+    }
+  }
+  EXPECT_EQ(names.size(), 1u + kThreads);
+  EXPECT_EQ(names.count("main"), 1u);
+  EXPECT_EQ(names.count("worker 3"), 1u);
+}
+
+TEST(TraceRecorderTest, FullBufferDropsAndCounts) {
+  TraceRecorder recorder(8);
+  for (int i = 0; i < 20; ++i) recorder.AddComplete("x", "c", i, 1);
+  EXPECT_EQ(recorder.event_count(), 8u);
+  EXPECT_EQ(recorder.dropped(), 12);
+
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  EXPECT_EQ(Events(root).items.size(), 8u);
+  const JsonValue* other = root.Find("otherData");
+  ASSERT_NE(other, nullptr);
+  EXPECT_EQ(Int(*other, "dropped"), 12);
+}
+
+TEST(TraceRecorderTest, RecordersAreIndependentOnSameThread) {
+  TraceRecorder first;
+  TraceRecorder second;
+  first.AddComplete("a", "c", 0, 1);
+  second.AddComplete("b", "c", 0, 1);
+  first.AddComplete("c", "c", 1, 1);
+  EXPECT_EQ(first.event_count(), 2u);
+  EXPECT_EQ(second.event_count(), 1u);
+}
+
+TEST(TraceRecorderTest, InternReturnsStableCopies) {
+  TraceRecorder recorder;
+  std::string name = "dart: windowManager";
+  const char* interned = recorder.Intern(name);
+  name.assign("overwritten");
+  EXPECT_STREQ(interned, "dart: windowManager");
+  EXPECT_EQ(recorder.Intern("dart: windowManager"), interned);
+
+  recorder.AddComplete(interned, recorder.Intern("dart \"init\""), 0, 5);
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  ASSERT_EQ(Events(root).items.size(), 1u);
+  EXPECT_EQ(Text(Events(root).items[0], "cat"), "dart \"init\"");
+}
+
+TEST(TraceRecorderTest, ScopeRecordsDuration) {
+  TraceRecorder& recorder = TraceRecorder::Global();
+  const size_t before = recorder.event_count();
+  {
+    CFVPN_TRACE_SCOPE("TraceRecorderTest.scope");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(recorder.event_count(), before + 1);
+
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  bool found = false;
+  for (const JsonValue& event : Events(root).items) {
+    if (Text(event, "name") != "TraceRecorderTest.scope") continue;
+    found = true;
+    EXPECT_EQ(Text(event, "cat"), "startup");
+    EXPECT_GE(Int(event, "dur"), 4000);
+  }
+  EXPECT_TRUE(found);
+}
+
+TEST(TraceRecorderTest, ClearDropsEventsButKeepsThreadNames) {
+  TraceRecorder recorder(2);
+  recorder.SetThreadName("main");
+  for (int i = 0; i < 3; ++i) recorder.AddInstant("tick", "test");
+  EXPECT_EQ(recorder.dropped(), 1);
+
+  recorder.Clear();
+  EXPECT_EQ(recorder.event_count(), 0u);
+  EXPECT_EQ(recorder.dropped(), 0);
+  recorder.AddInstant("after", "test");
+  const JsonValue root = ParseTrace(recorder.ToJson());
+  const auto& events = Events(root).items;
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(Text(events[0], "ph"), "M");
+  EXPECT_EQ(Text(events[1], "name"), "after");
+}
+
+TEST(TraceRecorderTest, CApiAddsSpansAndDumps) {
+  // 全局记录器在进程内共享，先清掉其他测试（或上一轮重复）留下的事件
+  cfvpn_trace_clear();
+  const int64_t start = cfvpn_trace_now_us();
+  cfvpn_trace_add_span("dart: init", nullptr, start, 1234);
+  cfvpn_trace_instant("dart: first frame", "dart");
+
+  const std::string path = ::testing::TempDir() + "cfvpn_trace_test.json";
+  std::remove(path.c_str());
+  const int32_t written = cfvpn_trace_dump(path.c_str());
+  EXPECT_EQ(written, 2);
+  EXPECT_EQ(cfvpn_trace_dump(nullptr), -1);
+
+  std::ifstream file(path, std::ios::binary);
+  ASSERT_TRUE(file.is_open());
+  const std::string json((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  const JsonValue root = ParseTrace(json);
+  // 其他线程（如预热）设置过的线程名以元数据事件输出，不计入返回值
+  int32_t recorded = 0;
+  bool span = false;
+  bool instant = false;
+  for (const JsonValue& event : Events(root).items) {
+    if (Text(event, "ph") != "M") ++recorded;
+    if (Text(event, "name") == "dart: init") {
+      span = true;
+      EXPECT_EQ(Text(event, "cat"), "dart");
+      EXPECT_EQ(Int(event, "dur"), 1234);
+    }
+    if (Text(event, "name") == "dart: first frame") instant = true;
+  }
+  EXPECT_EQ(recorded, written);
+  EXPECT_TRUE(span);
+  EXPECT_TRUE(instant);
+  std::remove(path.c_str());
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,163 @@
+#include "core/trace_response_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+namespace cfvpn {
+namespace {
+
+using Status = TraceResponseParser::Status;
+
+const char kTraceBody[] =
+    "fl=29f123\nh=cloudflare.com\nip=203.0.113.7\nts=1700000000.123\n"
+    "visit_scheme=http\nuag=Mozilla/5.0\ncolo=NRT\nsliver=none\nhttp=http/1.1\n"
+    "loc=JP\ntls=off\nsni=off\nwarp=off\ngateway=off\nrbi=off\nkex=none\n";
+
+// 整段喂给解析器，返回最终状态
+Status FeedAll(TraceResponseParser* parser, const std::string& data,
+               size_t* consumed = nullptr) {
+  size_t used = 0;
+  Status status = parser->Feed(data.data(), data.size(), &used);
+  if (consumed != nullptr) {
+    *consumed = used;
+  }
+  return status;
+}
+
+std::string WithContentLength(const std::string& body,
+                              const std::string& extra_headers = "") {
+  return "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n" + extra_headers +
+         "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+TEST(TraceResponseParserTest, ParsesContentLengthResponse) {
+  TraceResponseParser parser;
+  const std::string response = WithContentLength(kTraceBody);
+  size_t consumed = 0;
+  ASSERT_EQ(FeedAll(&parser, response, &consumed), Status::kDone);
+  EXPECT_EQ(consumed, response.size());
+  EXPECT_EQ(parser.status_code(), 200);
+  EXPECT_TRUE(parser.keep_alive());
+  EXPECT_STREQ(parser.colo(), "NRT");
+  EXPECT_STREQ(parser.loc(), "JP");
+}
+
+TEST(TraceResponseParserTest, HandlesByteByByteChunkedResponse) {
+  // 数据块边界故意切在字段中间
+  const std::string body = kTraceBody;
+  const std::string response =
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n" +
+      std::string("7\r\n") + body.substr(0, 7) + "\r\n" + "a0\r\n" +
+      body.substr(7, 160) + "\r\n" +
+      [&body]() {
+        char size[16];
+        std::snprintf(size, sizeof(size), "%zx\r\n", body.size() - 167);
+        return std::string(size);
+      }() +
+      body.substr(167) + "\r\n0\r\n\r\n";
+
+  TraceResponseParser parser;
+  Status status = Status::kNeedMore;
+  for (size_t i = 0; i < response.size(); ++i) {
+    size_t consumed = 0;
+    status = parser.Feed(response.data() + i, 1, &consumed);
+    ASSERT_EQ(consumed, 1u) << i;
+    if (i + 1 < response.size()) {
+      ASSERT_EQ(status, Status::kNeedMore) << i;
+    }
+  }
+  EXPECT_EQ(status, Status::kDone);
+  EXPECT_STREQ(parser.colo(), "NRT");
+  EXPECT_STREQ(parser.loc(), "JP");
+}
+
+TEST(TraceResponseParserTest, BodyUntilCloseFinishesOnEof) {
+  TraceResponseParser parser;
+  const std::string response =
+      std::string("HTTP/1.1 200 OK\r\nServer: cloudflare\r\n\r\n") +
+      "colo=SJC\nloc=US";  // 最后一行没有换行
+  EXPECT_EQ(FeedAll(&parser, response), Status::kNeedMore);
+  EXPECT_EQ(parser.FeedEof(), Status::kDone);
+  EXPECT_FALSE(parser.keep_alive());
+  EXPECT_STREQ(parser.colo(), "SJC");
+  EXPECT_STREQ(parser.loc(), "US");
+}
+
+TEST(TraceResponseParserTest, StopsAtResponseBoundary) {
+  // 同一次读取里有两个响应：只消费第一个，Reset 后解析第二个
+  const std::string first = WithContentLength("colo=HKG\n");
+  const std::string second = WithContentLength("colo=LAX\n");
+  const std::string data = first + second;
+
+  TraceResponseParser parser;
+  size_t consumed = 0;
+  ASSERT_EQ(FeedAll(&parser, data, &consumed), Status::kDone);
+  EXPECT_EQ(consumed, first.size());
+  EXPECT_STREQ(parser.colo(), "HKG");
+
+  parser.Reset();
+  size_t rest = 0;
+  ASSERT_EQ(parser.Feed(data.data() + consumed, data.size() - consumed, &rest),
+            Status::kDone);
+  EXPECT_EQ(rest, second.size());
+  EXPECT_STREQ(parser.colo(), "LAX");
+}
+
+TEST(TraceResponseParserTest, ConnectionHeadersControlKeepAlive) {
+  TraceResponseParser parser;
+  ASSERT_EQ(FeedAll(&parser, WithContentLength("x", "Connection: Close\r\n")),
+            Status::kDone);
+  EXPECT_FALSE(parser.keep_alive());
+
+  parser.Reset();
+  ASSERT_EQ(FeedAll(&parser,
+                    "HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n"),
+            Status::kDone);
+  EXPECT_FALSE(parser.keep_alive());
+
+  parser.Reset();
+  ASSERT_EQ(FeedAll(&parser,
+                    "HTTP/1.0 200 OK\r\nconnection: keep-alive\r\n"
+                    "content-length: 0\r\n\r\n"),
+            Status::kDone);
+  EXPECT_TRUE(parser.keep_alive());
+}
+
+TEST(TraceResponseParserTest, SkipsInterimAndReportsStatus) {
+  TraceResponseParser parser;
+  ASSERT_EQ(FeedAll(&parser,
+                    "HTTP/1.1 100 Continue\r\n\r\n"
+                    "HTTP/1.1 403 Forbidden\r\nContent-Length: 5\r\n\r\nnope\n"),
+            Status::kDone);
+  EXPECT_EQ(parser.status_code(), 403);
+  EXPECT_STREQ(parser.colo(), "");
+}
+
+TEST(TraceResponseParserTest, ToleratesVeryLongHeaderLines) {
+  const std::string cookie(5000, 'c');
+  TraceResponseParser parser;
+  ASSERT_EQ(FeedAll(&parser, WithContentLength("colo=AMS\n",
+                                               "Set-Cookie: " + cookie + "\r\n")),
+            Status::kDone);
+  EXPECT_STREQ(parser.colo(), "AMS");
+}
+
+TEST(TraceResponseParserTest, RejectsMalformedResponses) {
+  TraceResponseParser parser;
+  EXPECT_EQ(FeedAll(&parser, "SSH-2.0-OpenSSH\r\n"), Status::kError);
+
+  parser.Reset();
+  EXPECT_EQ(FeedAll(&parser,
+                    "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n"),
+            Status::kError);
+
+  parser.Reset();
+  EXPECT_EQ(FeedAll(&parser, "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nab"),
+            Status::kNeedMore);
+  EXPECT_EQ(parser.FeedEof(), Status::kError);
+}
+
+}  // namespace
+}  // namespace cfvpn
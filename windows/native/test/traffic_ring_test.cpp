@@ -0,0 +1,195 @@
+#include "core/traffic_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "core/traffic_sampler.h"
+
+namespace cfvpn {
+namespace {
+
+constexpr int64_t kStartMs = 1700000000000;
+
+TrafficSample MakeSample(int64_t index, int interval_ms) {
+  TrafficSample sample;
+  sample.time_ms = kStartMs + index * interval_ms;
+  sample.up_bytes = index * 10;
+  sample.down_bytes = index * 100;
+  return sample;
+}
+
+TEST(TrafficRingTest, DefaultLayoutCoversRetention) {
+  TrafficRing ring(TrafficRingOptions{});
+  const TrafficRingHeader* header = ring.header();
+  EXPECT_EQ(header->magic, kTrafficRingMagic);
+  EXPECT_EQ(header->tier_count, kTrafficTierCount);
+  // 250ms 保留 1 小时，5 秒保留 1 天，1 分钟保留 7 天
+  EXPECT_EQ(header->tiers[0].capacity, 14400);
+  EXPECT_EQ(header->tiers[0].interval_ms, 250);
+  EXPECT_EQ(header->tiers[1].capacity, 17280);
+  EXPECT_EQ(header->tiers[2].capacity, 10080);
+
+  int64_t offset = sizeof(TrafficRingHeader);
+  for (int i = 0; i < kTrafficTierCount; ++i) {
+    EXPECT_EQ(header->tiers[i].samples_offset, offset);
+    EXPECT_EQ(header->tiers[i].write_count.load(), 0);
+    offset += header->tiers[i].capacity *
+              static_cast<int64_t>(sizeof(TrafficSample));
+  }
+  EXPECT_EQ(ring.size_bytes(), static_cast<size_t>(offset));
+
+  TrafficSample latest;
+  EXPECT_FALSE(ring.Latest(&latest));
+}
+
+TEST(TrafficRingTest, ReadsSamplesSinceTime) {
+  TrafficRing ring(TrafficRingOptions{});
+  for (int64_t i = 0; i < 20; ++i) ring.Append(MakeSample(i, 250));
+
+  std::vector<TrafficSample> samples;
+  ring.Read(0, kStartMs + 15 * 250, &samples);
+  ASSERT_EQ(samples.size(), 5u);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(samples[i].time_ms, kStartMs + (15 + i) * 250);
+    EXPECT_EQ(samples[i].down_bytes, static_cast<int64_t>((15 + i) * 100));
+  }
+
+  TrafficSample latest;
+  ASSERT_TRUE(ring.Latest(&latest));
+  EXPECT_EQ(latest.up_bytes, 190);
+}
+
+TEST(TrafficRingTest, WrapsAroundKeepingNewest) {
+  TrafficRingOptions options;
+  options.sample_interval_ms = 100;
+  options.full_resolution_seconds = 1;  // 容量 10
+  TrafficRing ring(options);
+  ASSERT_EQ(ring.header()->tiers[0].capacity, 10);
+  for (int64_t i = 0; i < 25; ++i) ring.Append(MakeSample(i, 100));
+
+  // 最旧的槽位是生产者下一个要写的位置，读者保守地丢弃它
+  std::vector<TrafficSample> samples;
+  ring.Read(0, 0, &samples);
+  ASSERT_EQ(samples.size(), 9u);
+  EXPECT_EQ(samples.front().time_ms, kStartMs + 16 * 100);
+  EXPECT_EQ(samples.back().time_ms, kStartMs + 24 * 100);
+}
+
+TEST(TrafficRingTest, DownsamplesOnIntervalBoundaries) {
+  TrafficRingOptions options;
+  options.sample_interval_ms = 250;
+  options.medium_interval_ms = 1000;
+  options.coarse_interval_ms = 5000;
+  TrafficRing ring(options);
+  // kStartMs 是 5 秒的整数倍，共 10 秒
+  for (int64_t i = 0; i <= 40; ++i) ring.Append(MakeSample(i, 250));
+
+  std::vector<TrafficSample> medium;
+  ring.Read(1, 0, &medium);
+  ASSERT_EQ(medium.size(), 11u);
+  for (size_t i = 0; i < medium.size(); ++i) {
+    EXPECT_EQ(medium[i].time_ms, kStartMs + static_cast<int64_t>(i) * 1000);
+    // 降采样层保存的是当时的累计值
+    EXPECT_EQ(medium[i].up_bytes, static_cast<int64_t>(i) * 40);
+  }
+
+  std::vector<TrafficSample> coarse;
+  ring.Read(2, 0, &coarse);
+  ASSERT_EQ(coarse.size(), 3u);
+  EXPECT_EQ(coarse[2].time_ms, kStartMs + 10000);
+}
+
+TEST(TrafficRingTest, ConcurrentReaderNeverSeesTornSamples) {
+  TrafficRingOptions options;
+  options.sample_interval_ms = 1;
+  options.full_resolution_seconds = 1;  // 容量 1000，频繁回绕
+  TrafficRing ring(options);
+
+  std::atomic<bool> done(false);
+  std::thread producer([&] {
+    for (int64_t i = 0; i < 200000; ++i) ring.Append(MakeSample(i, 1));
+    done = true;
+  });
+
+  std::vector<TrafficSample> samples;
+  int reads = 0;
+  while (!done || reads == 0) {
+    samples.clear();
+    ring.Read(0, 0, &samples);
+    for (size_t i = 0; i < samples.size(); ++i) {
+      const int64_t index = samples[i].time_ms - kStartMs;
+      ASSERT_EQ(samples[i].up_bytes, index * 10);
+      ASSERT_EQ(samples[i].down_bytes, index * 100);
+      if (i > 0) {
+        ASSERT_EQ(samples[i].time_ms, samples[i - 1].time_ms + 1);
+      }
+    }
+    ++reads;
+  }
+  producer.join();
+}
+
+TEST(TrafficSamplerTest, AccumulatesAcrossCounterReset) {
+  // v2ray 计数器：100 -> 300 -> 重启后 50 -> 80，失败一次
+  const std::vector<int64_t> counters = {100, 300, -1, 50, 80};
+  size_t next = 0;
+  TrafficSampler sampler(TrafficRingOptions{},
+                         [&](int64_t* up, int64_t* down) {
+                           const int64_t value = counters[next++];
+                           if (value < 0) return false;
+                           *up = value;
+                           *down = value * 2;
+                           return true;
+                         });
+  for (size_t i = 0; i < counters.size(); ++i) {
+    sampler.SampleOnce(kStartMs + static_cast<int64_t>(i) * 250);
+  }
+  EXPECT_EQ(sampler.failures(), 1);
+
+  std::vector<TrafficSample> samples;
+  sampler.ring().Read(0, 0, &samples);
+  ASSERT_EQ(samples.size(), 4u);
+  EXPECT_EQ(samples[0].up_bytes, 100);
+  EXPECT_EQ(samples[1].up_bytes, 300);
+  EXPECT_EQ(samples[2].up_bytes, 350);
+  EXPECT_EQ(samples[3].up_bytes, 380);
+  EXPECT_EQ(samples[3].down_bytes, 760);
+  EXPECT_EQ(samples[3].time_ms, kStartMs + 4 * 250);
+}
+
+TEST(TrafficSamplerTest, BackgroundThreadSamplesUntilStopped) {
+  TrafficRingOptions options;
+  options.sample_interval_ms = 10;
+  std::atomic<int64_t> bytes(0);
+  TrafficSampler sampler(options, [&](int64_t* up, int64_t* down) {
+    *up = bytes.fetch_add(1000);
+    *down = 0;
+    return true;
+  });
+  sampler.Start();
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sampler.ring().header()->tiers[0].write_count.load() < 5 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  sampler.Stop();
+
+  const int64_t written = sampler.ring().header()->tiers[0].write_count.load();
+  EXPECT_GE(written, 5);
+  TrafficSample latest;
+  ASSERT_TRUE(sampler.ring().Latest(&latest));
+  EXPECT_EQ(latest.up_bytes, (written - 1) * 1000);
+
+  // 停止后不再写入
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(sampler.ring().header()->tiers[0].write_count.load(), written);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,152 @@
+#include "core/v2ray_config.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "core/json.h"
+
+namespace cfvpn {
+namespace {
+
+std::string ReadTemplate() {
+  std::ifstream file(CFVPN_ASSETS_DIR "/js/v2ray_config.json",
+                     std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+JsonValue* FindTagged(JsonValue* list, const char* tag) {
+  for (JsonValue& item : list->items) {
+    const JsonValue* field = item.Find("tag");
+    if (field != nullptr && field->text == tag) return &item;
+  }
+  return nullptr;
+}
+
+// 按 V2RayService._generateConfigMap 的步骤直接修改完整的文档，
+// 作为增量生成结果的对照
+std::string GenerateReference(const std::string& text,
+                              const V2rayConfigParams& params) {
+  JsonValue root;
+  EXPECT_TRUE(ParseJson(text, &root, nullptr));
+  FindTagged(root.Find("inbounds"), "socks")->Member("port") =
+      JsonValue::Number(params.socks_port);
+  FindTagged(root.Find("inbounds"), "http")->Member("port") =
+      JsonValue::Number(params.http_port);
+
+  JsonValue* proxy = FindTagged(root.Find("outbounds"), "proxy");
+  JsonValue& server = proxy->Find("settings")->Find("vnext")->items[0];
+  server.Member("address") = JsonValue::String(params.server_ip);
+  if (server.Member("port").AsInt(0) <= 0) {
+    server.Member("port") = JsonValue::Number(params.server_port);
+  }
+  if (!params.user_id.empty()) {
+    server.Find("users")->items[0].Member("id") =
+        JsonValue::String(params.user_id);
+  }
+  JsonValue* stream = proxy->Find("streamSettings");
+  std::string name = params.server_name;
+  if (name.empty()) name = stream->Find("tlsSettings")->Find("serverName")->text;
+  stream->Find("tlsSettings")->Member("serverName") = JsonValue::String(name);
+  stream->Find("wsSettings")->Find("headers")->Member("Host") =
+      JsonValue::String(name);
+
+  if (params.global_proxy) {
+    JsonValue& rules = *root.Find("routing")->Find("rules");
+    JsonValue kept;
+    kept.type = JsonValue::Type::kArray;
+    for (const JsonValue& rule : rules.items) {
+      const JsonValue* inbound = rule.Find("inboundTag");
+      if (inbound != nullptr && inbound->is_array() &&
+          !inbound->items.empty() && inbound->items[0].text == "api") {
+        kept.items.push_back(rule);
+      }
+    }
+    JsonValue global;
+    global.type = JsonValue::Type::kObject;
+    global.Member("type") = JsonValue::String("field");
+    global.Member("port") = JsonValue::String("0-65535");
+    global.Member("outboundTag") = JsonValue::String("proxy");
+    kept.items.push_back(global);
+    rules = kept;
+  }
+  std::string out;
+  AppendJson(root, &out);
+  return out;
+}
+
+TEST(V2rayConfigBuilderTest, MatchesFullRegenerationOfBundledTemplate) {
+  const std::string text = ReadTemplate();
+  ASSERT_FALSE(text.empty());
+  V2rayConfigBuilder builder;
+  std::string error;
+  ASSERT_TRUE(builder.LoadTemplate(text, &error)) << error;
+  EXPECT_EQ(builder.template_server_port(), 80);
+  EXPECT_EQ(builder.default_server_name(), "pagesvless.jeseelim.workers.dev");
+
+  V2rayConfigParams params;
+  params.server_ip = "104.16.1.2";
+  EXPECT_EQ(builder.Build(params), GenerateReference(text, params));
+
+  params.server_ip = "172.64.0.9";
+  params.server_name = "edge.example.com";
+  params.user_id = "00000000-1111-2222-3333-444444444444";
+  params.socks_port = 17898;
+  params.http_port = 17899;
+  params.global_proxy = true;
+  const std::string global = builder.Build(params);
+  EXPECT_EQ(global, GenerateReference(text, params));
+  EXPECT_NE(global.find(R"({"type":"field","port":"0-65535","outboundTag":"proxy"}])"),
+            std::string::npos);
+
+  // 切回智能分流，之前的值不残留
+  params.global_proxy = false;
+  params.user_id.clear();
+  params.server_name = "a\"b";
+  EXPECT_EQ(builder.Build(params), GenerateReference(text, params));
+
+  // 输出是合法 JSON
+  JsonValue parsed;
+  EXPECT_TRUE(ParseJson(builder.Build(params), &parsed, &error)) << error;
+}
+
+TEST(V2rayConfigBuilderTest, FillsMissingFieldsLikeTheDartGenerator) {
+  V2rayConfigBuilder builder;
+  ASSERT_TRUE(builder.LoadTemplate(R"({
+    "inbounds": [{"tag": "socks"}, {"tag": "other", "port": 1}],
+    "outbounds": [{
+      "tag": "proxy",
+      "settings": {"vnext": [{"port": 0, "users": [{"id": "old"}]}]},
+      "streamSettings": {"tlsSettings": {}}
+    }],
+  })", nullptr));
+  EXPECT_EQ(builder.template_server_port(), 0);
+  EXPECT_EQ(builder.default_server_name(), kDefaultV2rayServerName);
+
+  V2rayConfigParams params;
+  params.server_ip = "1.2.3.4";
+  params.server_port = 8443;
+  params.socks_port = 1080;
+  EXPECT_EQ(builder.Build(params),
+            R"({"inbounds":[{"tag":"socks","port":1080},{"tag":"other","port":1}],)"
+            R"("outbounds":[{"tag":"proxy","settings":{"vnext":[{"port":8443,)"
+            R"("users":[{"id":"old"}],"address":"1.2.3.4"}]},)"
+            R"("streamSettings":{"tlsSettings":{"serverName":"pages-vless-a9f.pages.dev"}}}]})");
+}
+
+TEST(V2rayConfigBuilderTest, RejectsInvalidTemplates) {
+  V2rayConfigBuilder builder;
+  std::string error;
+  EXPECT_FALSE(builder.LoadTemplate("{\"a\": }", &error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_FALSE(builder.LoadTemplate("[1, 2]", &error));
+  EXPECT_FALSE(builder.loaded());
+  EXPECT_TRUE(builder.Build(V2rayConfigParams()).empty());
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,431 @@
+#include "core/v2ray_stats_client.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/native_api.h"
+#include "core/socket_util.h"
+#include "loopback_server.h"
+
+namespace cfvpn {
+namespace {
+
+using testing::kLoopbackIp;
+using testing::LoopbackServer;
+
+constexpr char kQueryStatsPath[] =
+    "/v2ray.core.app.stats.command.StatsService/QueryStats";
+
+// 模拟 v2ray api 入站的行为
+struct StatsServerOptions {
+  std::vector<StatsCounter> stats;
+  bool fail_calls = false;           // 以 trailers-only 响应返回错误
+  bool close_after_response = false;  // 每次响应后断开，模拟 v2ray 重启
+  bool send_ping = false;            // 响应前先发 PING
+  size_t data_chunk = 16384;         // DATA 帧最大负载
+};
+
+struct StatsServerState {
+  std::atomic<int> requests{0};
+  std::atomic<int> bad_requests{0};
+  std::atomic<int> window_violations{0};
+  std::atomic<int> pings_acked{0};
+  std::mutex mutex;
+  std::vector<StatsCounter> stats;  // 当前计数，reset 会清零
+};
+
+bool RecvExact(NativeSocket socket, uint8_t* out, size_t size) {
+  size_t received = 0;
+  while (received < size) {
+    ssize_t n = ::recv(socket, reinterpret_cast<char*>(out) + received,
+                       size - received, 0);
+    if (n <= 0) {
+      return false;
+    }
+    received += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+void SendFrame(NativeSocket socket, uint8_t type, uint8_t flags,
+               uint32_t stream_id, const std::string& payload) {
+  std::string frame;
+  frame.push_back(static_cast<char>(payload.size() >> 16));
+  frame.push_back(static_cast<char>(payload.size() >> 8));
+  frame.push_back(static_cast<char>(payload.size()));
+  frame.push_back(static_cast<char>(type));
+  frame.push_back(static_cast<char>(flags));
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    frame.push_back(static_cast<char>(stream_id >> shift));
+  }
+  frame += payload;
+  ::send(socket, frame.data(), frame.size(), MSG_NOSIGNAL);
+}
+
+uint32_t ReadUint32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) |
+         (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+// 不使用 Huffman 的字面量头，名称不在静态表中
+std::string LiteralHeader(const std::string& name, const std::string& value) {
+  std::string out(1, '\0');
+  out.push_back(static_cast<char>(name.size()));
+  out += name;
+  out.push_back(static_cast<char>(value.size()));
+  out += value;
+  return out;
+}
+
+void ServeStats(NativeSocket client, const StatsServerOptions& options,
+                StatsServerState* state) {
+  uint8_t preface[24];
+  if (!RecvExact(client, preface, sizeof(preface)) ||
+      std::memcmp(preface, "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n", 24) != 0) {
+    state->bad_requests.fetch_add(1);
+    return;
+  }
+  SendFrame(client, 0x4, 0, 0, "");  // SETTINGS
+
+  int64_t connection_window = 65535;
+  int64_t initial_stream_window = 65535;
+  int64_t stream_window = 0;
+  std::string body;
+  bool path_ok = false;
+  for (;;) {
+    uint8_t header[9];
+    if (!RecvExact(client, header, sizeof(header))) {
+      return;
+    }
+    const size_t length = (static_cast<size_t>(header[0]) << 16) |
+                          (static_cast<size_t>(header[1]) << 8) | header[2];
+    const uint8_t type = header[3];
+    const uint8_t flags = header[4];
+    const uint32_t stream_id = ReadUint32(header + 5) & 0x7FFFFFFFu;
+    std::vector<uint8_t> payload(length);
+    if (length > 0 && !RecvExact(client, payload.data(), length)) {
+      return;
+    }
+
+    if (type == 0x4 && (flags & 0x1) == 0) {  // SETTINGS
+      for (size_t i = 0; i + 6 <= length; i += 6) {
+        if (payload[i] == 0 && payload[i + 1] == 0x4) {
+          initial_stream_window = ReadUint32(&payload[i + 2]);
+        }
+      }
+      SendFrame(client, 0x4, 0x1, 0, "");
+    } else if (type == 0x8) {  // WINDOW_UPDATE
+      const uint32_t increment = ReadUint32(payload.data());
+      (stream_id == 0 ? connection_window : stream_window) += increment;
+    } else if (type == 0x6 && (flags & 0x1) != 0) {  // PING ACK
+      state->pings_acked.fetch_add(1);
+    } else if (type == 0x1) {  // HEADERS
+      std::string block(payload.begin(), payload.end());
+      path_ok = block.find(kQueryStatsPath) != std::string::npos &&
+                block.find("application/grpc") != std::string::npos;
+      stream_window = initial_stream_window;
+      body.clear();
+    } else if (type == 0x0) {  // DATA
+      body.append(payload.begin(), payload.end());
+      if ((flags & 0x1) == 0) {
+        continue;
+      }
+      std::string pattern;
+      bool reset = false;
+      if (!path_ok || body.size() < 5 ||
+          !DecodeQueryStatsRequest(
+              reinterpret_cast<const uint8_t*>(body.data()) + 5,
+              body.size() - 5, &pattern, &reset)) {
+        state->bad_requests.fetch_add(1);
+        return;
+      }
+      state->requests.fetch_add(1);
+      if (options.send_ping) {
+        SendFrame(client, 0x6, 0, 0, "12345678");
+      }
+
+      std::string status = std::string(1, static_cast<char>(0x88));
+      if (options.fail_calls) {
+        SendFrame(client, 0x1, 0x5, stream_id,
+                  status + LiteralHeader("grpc-status", "12"));
+      } else {
+        std::vector<StatsCounter> matched;
+        {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          for (StatsCounter& counter : state->stats) {
+            if (counter.name.find(pattern) != std::string::npos) {
+              matched.push_back(counter);
+              if (reset) {
+                counter.value = 0;
+              }
+            }
+          }
+        }
+        std::string message = EncodeQueryStatsResponse(matched);
+        std::string grpc(1, '\0');
+        for (int shift = 24; shift >= 0; shift -= 8) {
+          grpc.push_back(static_cast<char>(message.size() >> shift));
+        }
+        grpc += message;
+
+        SendFrame(client, 0x1, 0x4, stream_id,
+                  status + LiteralHeader("content-type", "application/grpc"));
+        for (size_t offset = 0; offset < grpc.size();
+             offset += options.data_chunk) {
+          std::string chunk = grpc.substr(offset, options.data_chunk);
+          connection_window -= static_cast<int64_t>(chunk.size());
+          stream_window -= static_cast<int64_t>(chunk.size());
+          if (connection_window < 0 || stream_window < 0) {
+            state->window_violations.fetch_add(1);
+          }
+          SendFrame(client, 0x0, 0, stream_id, chunk);
+        }
+        SendFrame(client, 0x1, 0x5, stream_id,
+                  LiteralHeader("grpc-status", "0"));
+      }
+      if (options.close_after_response) {
+        // 优雅关闭：直接 close 而接收缓冲里还有未读数据（例如 SETTINGS ACK）
+        // 会发出 RST，可能让客户端丢掉尚未读取的响应
+        ::shutdown(client, SHUT_WR);
+        char drain[256];
+        while (::recv(client, drain, sizeof(drain), 0) > 0) {
+        }
+        return;
+      }
+    }
+  }
+}
+
+V2rayStatsOptions ClientOptions(uint16_t port) {
+  V2rayStatsOptions options;
+  options.ip = kLoopbackIp;
+  options.port = port;
+  options.timeout_ms = 2000;
+  return options;
+}
+
+std::vector<StatsCounter> TrafficCounters() {
+  return {
+      {"inbound>>>api>>>traffic>>>uplink", 12},
+      {"outbound>>>proxy>>>traffic>>>uplink", 1234567},
+      {"outbound>>>proxy>>>traffic>>>downlink", 9876543210LL},
+      {"outbound>>>proxy3>>>traffic>>>downlink", 42},
+      {"outbound>>>direct>>>traffic>>>downlink", 0},
+  };
+}
+
+int64_t ValueOf(const std::vector<StatsCounter>& stats,
+                const std::string& name) {
+  for (const StatsCounter& counter : stats) {
+    if (counter.name == name) {
+      return counter.value;
+    }
+  }
+  return -1;
+}
+
+TEST(V2rayStatsClientTest, ProtobufRoundTrip) {
+  std::string request = EncodeQueryStatsRequest("outbound>>>", true);
+  std::string pattern;
+  bool reset = false;
+  ASSERT_TRUE(DecodeQueryStatsRequest(
+      reinterpret_cast<const uint8_t*>(request.data()), request.size(),
+      &pattern, &reset));
+  EXPECT_EQ(pattern, "outbound>>>");
+  EXPECT_TRUE(reset);
+
+  std::string response = EncodeQueryStatsResponse(TrafficCounters());
+  std::vector<StatsCounter> decoded;
+  ASSERT_TRUE(DecodeQueryStatsResponse(
+      reinterpret_cast<const uint8_t*>(response.data()), response.size(),
+      &decoded));
+  ASSERT_EQ(decoded.size(), 5u);
+  EXPECT_EQ(ValueOf(decoded, "outbound>>>proxy>>>traffic>>>downlink"),
+            9876543210LL);
+  EXPECT_EQ(ValueOf(decoded, "outbound>>>direct>>>traffic>>>downlink"), 0);
+
+  // 截断的消息应当被拒绝
+  decoded.clear();
+  EXPECT_FALSE(DecodeQueryStatsResponse(
+      reinterpret_cast<const uint8_t*>(response.data()), response.size() - 3,
+      &decoded));
+}
+
+TEST(V2rayStatsClientTest, QueriesOverOnePersistentConnection) {
+  StatsServerOptions server_options;
+  StatsServerState state;
+  state.stats = TrafficCounters();
+  LoopbackServer server([&](NativeSocket client) {
+    ServeStats(client, server_options, &state);
+  });
+  ASSERT_TRUE(server.ok());
+
+  V2rayStatsClient client(ClientOptions(server.port()));
+  std::vector<StatsCounter> stats;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(client.QueryStats("outbound>>>proxy>>>", false, &stats))
+        << client.last_error();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(ValueOf(stats, "outbound>>>proxy>>>traffic>>>uplink"), 1234567);
+    EXPECT_EQ(ValueOf(stats, "outbound>>>proxy>>>traffic>>>downlink"),
+              9876543210LL);
+  }
+
+  ASSERT_TRUE(client.QueryStats("", false, &stats));
+  EXPECT_EQ(stats.size(), 5u);
+  EXPECT_EQ(client.connections(), 1);
+  EXPECT_EQ(server.accepted(), 1);
+  EXPECT_EQ(state.requests.load(), 6);
+  EXPECT_EQ(state.bad_requests.load(), 0);
+}
+
+TEST(V2rayStatsClientTest, ResetClearsCounters) {
+  StatsServerOptions server_options;
+  StatsServerState state;
+  state.stats = TrafficCounters();
+  LoopbackServer server([&](NativeSocket client) {
+    ServeStats(client, server_options, &state);
+  });
+  ASSERT_TRUE(server.ok());
+
+  V2rayStatsClient client(ClientOptions(server.port()));
+  std::vector<StatsCounter> stats;
+  ASSERT_TRUE(client.QueryStats("proxy>>>traffic>>>uplink", true, &stats));
+  EXPECT_EQ(ValueOf(stats, "outbound>>>proxy>>>traffic>>>uplink"), 1234567);
+  ASSERT_TRUE(client.QueryStats("proxy>>>traffic>>>uplink", false, &stats));
+  EXPECT_EQ(ValueOf(stats, "outbound>>>proxy>>>traffic>>>uplink"), 0);
+}
+
+TEST(V2rayStatsClientTest, ReconnectsAfterServerCloses) {
+  StatsServerOptions server_options;
+  server_options.close_after_response = true;
+  StatsServerState state;
+  state.stats = TrafficCounters();
+  LoopbackServer server([&](NativeSocket client) {
+    ServeStats(client, server_options, &state);
+  });
+  ASSERT_TRUE(server.ok());
+
+  V2rayStatsClient client(ClientOptions(server.port()));
+  std::vector<StatsCounter> stats;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(client.QueryStats("", false, &stats)) << client.last_error();
+    EXPECT_EQ(stats.size(), 5u);
+  }
+  EXPECT_EQ(client.connections(), 3);
+  EXPECT_EQ(state.requests.load(), 3);
+}
+
+TEST(V2rayStatsClientTest, LargeResponsesRespectFlowControl) {
+  StatsServerOptions server_options;
+  server_options.data_chunk = 7000;
+  StatsServerState state;
+  for (int i = 0; i < 3000; ++i) {
+    state.stats.push_back(
+        {"user>>>user" + std::to_string(i) + "@example.com>>>traffic>>>uplink",
+         i});
+  }
+  LoopbackServer server([&](NativeSocket client) {
+    ServeStats(client, server_options, &state);
+  });
+  ASSERT_TRUE(server.ok());
+
+  // 每次响应约 170KB，累计远超默认的 64KB 连接窗口
+  V2rayStatsClient client(ClientOptions(server.port()));
+  std::vector<StatsCounter> stats;
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_TRUE(client.QueryStats("", false, &stats)) << client.last_error();
+    ASSERT_EQ(stats.size(), 3000u);
+    EXPECT_EQ(stats[2999].value, 2999);
+  }
+  EXPECT_EQ(state.window_violations.load(), 0);
+  EXPECT_EQ(client.connections(), 1);
+}
+
+TEST(V2rayStatsClientTest, AnswersPingsAndJoinsSplitFrames) {
+  StatsServerOptions server_options;
+  server_options.send_ping = true;
+  server_options.data_chunk = 7;
+  StatsServerState state;
+  state.stats = TrafficCounters();
+  LoopbackServer server([&](NativeSocket client) {
+    ServeStats(client, server_options, &state);
+  });
+  ASSERT_TRUE(server.ok());
+
+  V2rayStatsClient client(ClientOptions(server.port()));
+  std::vector<StatsCounter> stats;
+  ASSERT_TRUE(client.QueryStats("", false, &stats)) << client.last_error();
+  EXPECT_EQ(stats.size(), 5u);
+  // PING ACK 在下一次查询之前被服务器读到
+  ASSERT_TRUE(client.QueryStats("", false, &stats));
+  EXPECT_GE(state.pings_acked.load(), 1);
+}
+
+TEST(V2rayStatsClientTest, CallErrorKeepsConnection) {
+  StatsServerOptions server_options;
+  server_options.fail_calls = true;
+  StatsServerState state;
+  LoopbackServer server([&](NativeSocket client) {
+    ServeStats(client, server_options, &state);
+  });
+  ASSERT_TRUE(server.ok());
+
+  V2rayStatsClient client(ClientOptions(server.port()));
+  std::vector<StatsCounter> stats;
+  EXPECT_FALSE(client.QueryStats("", false, &stats));
+  EXPECT_FALSE(client.last_error().empty());
+  EXPECT_TRUE(client.connected());
+  EXPECT_FALSE(client.QueryStats("", false, &stats));
+  EXPECT_EQ(client.connections(), 1);
+  EXPECT_EQ(state.requests.load(), 2);
+}
+
+TEST(V2rayStatsClientTest, FailsFastWhenNothingListens) {
+  V2rayStatsClient client(ClientOptions(testing::UnusedLoopbackPort()));
+  std::vector<StatsCounter> stats;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(client.QueryStats("", false, &stats));
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(1000));
+  EXPECT_FALSE(client.connected());
+  EXPECT_FALSE(client.last_error().empty());
+}
+
+TEST(NativeApiTest, StatsClientRoundTrip) {
+  StatsServerOptions server_options;
+  StatsServerState state;
+  state.stats = TrafficCounters();
+  LoopbackServer server([&](NativeSocket client) {
+    ServeStats(client, server_options, &state);
+  });
+  ASSERT_TRUE(server.ok());
+
+  CfvpnStatsClient* client = cfvpn_stats_client_create(server.port(), 1000);
+  ASSERT_NE(client, nullptr);
+  CfvpnStatsCounter counters[1];
+  // 容量不足时返回总数，只写入前 capacity 个
+  EXPECT_EQ(cfvpn_stats_query(client, "outbound>>>proxy>>>", 0, counters, 1),
+            2);
+  EXPECT_STREQ(counters[0].name, "outbound>>>proxy>>>traffic>>>uplink");
+  EXPECT_EQ(counters[0].value, 1234567);
+  cfvpn_stats_client_free(client);
+
+  client = cfvpn_stats_client_create(testing::UnusedLoopbackPort(), 200);
+  EXPECT_EQ(cfvpn_stats_query(client, "", 0, counters, 1), -1);
+  char error[64];
+  EXPECT_GT(cfvpn_stats_last_error(client, error, sizeof(error)), 0);
+  EXPECT_NE(std::strstr(error, "connect"), nullptr);
+  cfvpn_stats_client_free(client);
+}
+
+}  // namespace
+}  // namespace cfvpn
@@ -0,0 +1,184 @@
+// cfvpn_logcat：把二进制日志段（*.clog）解码为与文本日志相同格式的行，
+// 支持按 tag、级别、文本或正则过滤。
+//
+//   cfvpn_logcat [选项] <文件或目录>...
+//
+// 目录参数展开为其中所有 .clog 文件，按文件名（即时间）排序。
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "core/binary_log.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+const char* const kLevelNames[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+struct Filter {
+  std::set<std::string> tags;
+  int min_level = 0;
+  std::string fixed;
+  bool use_regex = false;
+  std::regex regex;
+};
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "用法: cfvpn_logcat [选项] <文件或目录>...\n"
+      "  -t, --tag TAG      只输出该 tag 的记录（可重复）\n"
+      "  -l, --level LEVEL  最低级别：DEBUG、INFO、WARN、ERROR\n"
+      "  -F, --fixed TEXT   只输出包含 TEXT 的消息\n"
+      "  -e, --grep REGEX   只输出匹配正则（ECMAScript）的消息\n"
+      "      --stats        不输出记录，只统计每个文件的记录数和压缩率\n");
+}
+
+int ParseLevel(const char* name) {
+  for (int i = 0; i < 4; ++i) {
+    if (std::strcmp(name, kLevelNames[i]) == 0) return i;
+  }
+  return -1;
+}
+
+// 与文本日志相同的本地时间格式
+std::string FormatTime(int64_t time_us) {
+  const std::time_t seconds = static_cast<std::time_t>(time_us / 1000000);
+  std::tm tm = {};
+#if defined(_WIN32)
+  ::localtime_s(&tm, &seconds);
+#else
+  ::localtime_r(&seconds, &tm);
+#endif
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+  char stamp[48];
+  std::snprintf(stamp, sizeof(stamp), "%s.%06d", date,
+                static_cast<int>(time_us % 1000000));
+  return stamp;
+}
+
+bool Matches(const Filter& filter, const cfvpn::BinaryLogEntry& entry) {
+  if (entry.level < filter.min_level) return false;
+  if (!filter.tags.empty() && filter.tags.count(entry.tag) == 0) return false;
+  if (!filter.fixed.empty() &&
+      entry.message.find(filter.fixed) == std::string::npos) {
+    return false;
+  }
+  return !filter.use_regex || std::regex_search(entry.message, filter.regex);
+}
+
+std::vector<std::string> ExpandInputs(const std::vector<std::string>& inputs) {
+  std::vector<std::string> files;
+  for (const std::string& input : inputs) {
+    std::error_code error;
+    if (!fs::is_directory(input, error)) {
+      files.push_back(input);
+      continue;
+    }
+    std::vector<std::string> segments;
+    for (const auto& entry : fs::directory_iterator(input, error)) {
+      if (entry.path().extension() == cfvpn::kBinaryLogExtension) {
+        segments.push_back(entry.path().string());
+      }
+    }
+    std::sort(segments.begin(), segments.end());
+    files.insert(files.end(), segments.begin(), segments.end());
+  }
+  return files;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Filter filter;
+  bool stats = false;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if ((arg == "-t" || arg == "--tag") && has_value) {
+      filter.tags.insert(argv[++i]);
+    } else if ((arg == "-l" || arg == "--level") && has_value) {
+      filter.min_level = ParseLevel(argv[++i]);
+      if (filter.min_level < 0) {
+        std::fprintf(stderr, "未知的级别: %s\n", argv[i]);
+        return 2;
+      }
+    } else if ((arg == "-F" || arg == "--fixed") && has_value) {
+      filter.fixed = argv[++i];
+    } else if ((arg == "-e" || arg == "--grep") && has_value) {
+      filter.use_regex = true;
+      filter.regex = std::regex(argv[++i], std::regex::ECMAScript |
+                                                std::regex::optimize);
+    } else if (arg == "--stats") {
+      stats = true;
+    } else if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else if (!arg.empty() && arg[0] == '-') {
+      PrintUsage();
+      return 2;
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+  if (inputs.empty()) {
+    PrintUsage();
+    return 2;
+  }
+
+  int status = 0;
+  std::string line;
+  for (const std::string& path : ExpandInputs(inputs)) {
+    cfvpn::BinaryLogReader reader;
+    if (!reader.Open(path)) {
+      std::fprintf(stderr, "%s: 不是有效的二进制日志\n", path.c_str());
+      status = 1;
+      continue;
+    }
+    int64_t records = 0;
+    int64_t matched = 0;
+    int64_t text_bytes = 0;  // 同样内容写成文本日志的大小
+    cfvpn::BinaryLogEntry entry;
+    while (reader.Next(&entry)) {
+      ++records;
+      const char* level = kLevelNames[entry.level < 4 ? entry.level : 1];
+      line = "[" + FormatTime(entry.time_us) + "] [" + level + "] ";
+      text_bytes += static_cast<int64_t>(line.size() + entry.message.size() + 1);
+      if (!Matches(filter, entry)) continue;
+      ++matched;
+      if (stats) continue;
+      line += "[" + entry.tag + "] ";
+      line += entry.message;
+      line.push_back('\n');
+      std::fwrite(line.data(), 1, line.size(), stdout);
+    }
+    if (reader.truncated()) {
+      std::fprintf(stderr, "%s: 在第 %lld 条记录后遇到截断或损坏的块\n",
+                   path.c_str(), static_cast<long long>(records));
+      status = 1;
+    }
+    if (stats) {
+      std::error_code error;
+      const auto size = fs::file_size(path, error);
+      std::printf("%s: %lld 条记录（匹配 %lld），%llu 字节，文本约 %lld 字节，"
+                  "压缩比 %.1fx\n",
+                  path.c_str(), static_cast<long long>(records),
+                  static_cast<long long>(matched),
+                  static_cast<unsigned long long>(size),
+                  static_cast<long long>(text_bytes),
+                  size > 0 ? static_cast<double>(text_bytes) / size : 0.0);
+    }
+  }
+  return status;
+}
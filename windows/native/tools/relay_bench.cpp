@@ -0,0 +1,311 @@
+// cfvpn_relay_bench：比较经本地中继和直连回环代理入站的吞吐与往返延迟，
+// 用来衡量中继（splice 和拷贝两种路径）带来的开销。
+//
+//   cfvpn_relay_bench [选项]
+//
+// 进程内起两个回环服务代替 v2ray 入站：一个读完代理请求头后发送指定
+// 字节数（下载吞吐），一个原样回显（1 字节往返延迟）。每种方式依次
+// 测量，结果以表格输出到 stdout。
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/tcp.h>
+#include <poll.h>
+
+#include "core/local_relay.h"
+#include "core/socket_util.h"
+
+namespace {
+
+constexpr uint32_t kLoopbackIp = 0x7F000001;
+constexpr char kRequest[] = "CONNECT bench.test:443 HTTP/1.1\r\n\r\n";
+
+struct BenchOptions {
+  int64_t bytes = 1024LL * 1024 * 1024;  // 每种方式的下载总量
+  int connections = 4;
+  int rounds = 20000;                    // 往返次数
+  size_t buffer_bytes = 64 * 1024;
+};
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "用法: cfvpn_relay_bench [选项]\n"
+      "  -b, --bytes MB         每种方式的下载总量，默认 1024\n"
+      "  -c, --connections N    并行连接数，默认 4\n"
+      "  -r, --rounds N         1 字节往返次数，默认 20000\n"
+      "      --buffer KB        中继每个方向的缓冲，默认 64\n");
+}
+
+void SetNoDelay(cfvpn::NativeSocket socket) {
+  int no_delay = 1;
+  ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+}
+
+bool SendAll(cfvpn::NativeSocket socket, const char* data, size_t length) {
+  while (length > 0) {
+    const ssize_t n = ::send(socket, data, length, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    data += n;
+    length -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// 回环上的简易服务：每条连接一个线程，handler 返回后关闭连接
+class Server {
+ public:
+  using Handler = void (*)(cfvpn::NativeSocket client, int64_t argument);
+
+  Server(Handler handler, int64_t argument)
+      : handler_(handler), argument_(argument) {
+    listener_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = cfvpn::MakeSockaddrV4(kLoopbackIp, 0);
+    socklen_t length = sizeof(address);
+    if (::bind(listener_, reinterpret_cast<sockaddr*>(&address),
+               sizeof(address)) != 0 ||
+        ::listen(listener_, 128) != 0 ||
+        ::getsockname(listener_, reinterpret_cast<sockaddr*>(&address),
+                      &length) != 0) {
+      cfvpn::CloseSocket(listener_);
+      listener_ = cfvpn::kInvalidSocket;
+      return;
+    }
+    port_ = ntohs(address.sin_port);
+    acceptor_ = std::thread(&Server::AcceptLoop, this);
+  }
+
+  ~Server() {
+    stopping_.store(true);
+    if (acceptor_.joinable()) acceptor_.join();
+    for (std::thread& worker : workers_) worker.join();
+    cfvpn::CloseSocket(listener_);
+  }
+
+  bool ok() const { return listener_ != cfvpn::kInvalidSocket; }
+  uint16_t port() const { return port_; }
+
+ private:
+  void AcceptLoop() {
+    while (!stopping_.load()) {
+      pollfd entry = {listener_, POLLIN, 0};
+      if (::poll(&entry, 1, 20) <= 0) continue;
+      cfvpn::NativeSocket client = ::accept(listener_, nullptr, nullptr);
+      if (client == cfvpn::kInvalidSocket) continue;
+      SetNoDelay(client);
+      workers_.emplace_back([this, client]() {
+        handler_(client, argument_);
+        cfvpn::CloseSocket(client);
+      });
+    }
+  }
+
+  Handler handler_;
+  int64_t argument_;
+  cfvpn::NativeSocket listener_ = cfvpn::kInvalidSocket;
+  uint16_t port_ = 0;
+  std::atomic<bool> stopping_{false};
+  std::thread acceptor_;
+  std::vector<std::thread> workers_;
+};
+
+// 读完请求头后发送 bytes 个字节
+void ServeDownload(cfvpn::NativeSocket client, int64_t bytes) {
+  std::string head;
+  char buffer[1024];
+  while (head.find("\r\n\r\n") == std::string::npos) {
+    const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+    if (n <= 0) return;
+    head.append(buffer, static_cast<size_t>(n));
+  }
+  const std::vector<char> chunk(256 * 1024, 'x');
+  while (bytes > 0) {
+    const size_t length =
+        static_cast<size_t>(std::min<int64_t>(bytes, chunk.size()));
+    if (!SendAll(client, chunk.data(), length)) return;
+    bytes -= static_cast<int64_t>(length);
+  }
+}
+
+void ServeEcho(cfvpn::NativeSocket client, int64_t) {
+  char buffer[4096];
+  for (;;) {
+    const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+    if (n <= 0 || !SendAll(client, buffer, static_cast<size_t>(n))) return;
+  }
+}
+
+cfvpn::NativeSocket Connect(uint16_t port) {
+  cfvpn::NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, 0);
+  const sockaddr_in address = cfvpn::MakeSockaddrV4(kLoopbackIp, port);
+  if (::connect(socket, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    cfvpn::CloseSocket(socket);
+    return cfvpn::kInvalidSocket;
+  }
+  SetNoDelay(socket);
+  return socket;
+}
+
+// 并行下载，返回 MiB/s；失败返回 -1
+double MeasureThroughput(uint16_t port, const BenchOptions& options) {
+  const int64_t per_connection = options.bytes / options.connections;
+  std::atomic<int64_t> received{0};
+  std::atomic<bool> failed{false};
+  const int64_t start_us = cfvpn::MonotonicMicros();
+  std::vector<std::thread> clients;
+  for (int i = 0; i < options.connections; ++i) {
+    clients.emplace_back([&]() {
+      cfvpn::NativeSocket socket = Connect(port);
+      if (socket == cfvpn::kInvalidSocket ||
+          !SendAll(socket, kRequest, sizeof(kRequest) - 1)) {
+        failed.store(true);
+        cfvpn::CloseSocket(socket);
+        return;
+      }
+      std::vector<char> buffer(256 * 1024);
+      int64_t total = 0;
+      for (;;) {
+        const ssize_t n = ::recv(socket, buffer.data(), buffer.size(), 0);
+        if (n <= 0) break;
+        total += n;
+      }
+      if (total != per_connection) failed.store(true);
+      received.fetch_add(total);
+      cfvpn::CloseSocket(socket);
+    });
+  }
+  for (std::thread& client : clients) client.join();
+  const double seconds =
+      static_cast<double>(cfvpn::MonotonicMicros() - start_us) / 1e6;
+  if (failed.load() || seconds <= 0) return -1;
+  return static_cast<double>(received.load()) / (1024.0 * 1024.0) / seconds;
+}
+
+// 单连接 1 字节往返，按升序写出每次的微秒数
+bool MeasureRoundTrips(uint16_t port, int rounds, std::vector<int64_t>* out) {
+  cfvpn::NativeSocket socket = Connect(port);
+  if (socket == cfvpn::kInvalidSocket) return false;
+  bool ok = SendAll(socket, kRequest, sizeof(kRequest) - 1);
+  std::string echoed;
+  char buffer[256];
+  while (ok && echoed.size() < sizeof(kRequest) - 1) {
+    const ssize_t n = ::recv(socket, buffer, sizeof(buffer), 0);
+    ok = n > 0;
+    if (ok) echoed.append(buffer, static_cast<size_t>(n));
+  }
+  out->clear();
+  for (int i = 0; ok && i < rounds; ++i) {
+    const char byte = 'p';
+    const int64_t start_us = cfvpn::MonotonicMicros();
+    ok = SendAll(socket, &byte, 1) && ::recv(socket, buffer, 1, 0) == 1;
+    out->push_back(cfvpn::MonotonicMicros() - start_us);
+  }
+  cfvpn::CloseSocket(socket);
+  std::sort(out->begin(), out->end());
+  return ok && !out->empty();
+}
+
+int64_t Percentile(const std::vector<int64_t>& sorted, double fraction) {
+  const size_t index = static_cast<size_t>(
+      fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+struct Mode {
+  const char* name;
+  bool relay;
+  bool zero_copy;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if ((arg == "-b" || arg == "--bytes") && has_value) {
+      options.bytes = std::atoll(argv[++i]) * 1024 * 1024;
+    } else if ((arg == "-c" || arg == "--connections") && has_value) {
+      options.connections = std::atoi(argv[++i]);
+    } else if ((arg == "-r" || arg == "--rounds") && has_value) {
+      options.rounds = std::atoi(argv[++i]);
+    } else if (arg == "--buffer" && has_value) {
+      options.buffer_bytes = static_cast<size_t>(std::atoi(argv[++i])) * 1024;
+    } else if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (options.bytes <= 0 || options.connections <= 0 || options.rounds <= 0) {
+    std::fprintf(stderr, "参数必须大于 0\n");
+    return 2;
+  }
+  options.bytes -= options.bytes % options.connections;
+
+  Server download(ServeDownload, options.bytes / options.connections);
+  Server echo(ServeEcho, 0);
+  if (!download.ok() || !echo.ok()) {
+    std::fprintf(stderr, "无法监听回环端口\n");
+    return 1;
+  }
+
+  const Mode kModes[] = {
+      {"direct", false, false},
+      {"relay-splice", true, true},
+      {"relay-copy", true, false},
+  };
+  std::printf("%-14s %12s %10s %10s %10s\n", "mode", "MiB/s", "rtt_p50",
+              "rtt_p99", "rtt_max");
+  for (const Mode& mode : kModes) {
+    uint16_t download_port = download.port();
+    uint16_t echo_port = echo.port();
+    std::unique_ptr<cfvpn::LocalRelay> download_relay;
+    std::unique_ptr<cfvpn::LocalRelay> echo_relay;
+    if (mode.relay) {
+      cfvpn::LocalRelayOptions relay_options;
+      relay_options.buffer_bytes = options.buffer_bytes;
+      relay_options.zero_copy = mode.zero_copy;
+      relay_options.upstream_port = download.port();
+      download_relay = std::make_unique<cfvpn::LocalRelay>(relay_options);
+      relay_options.upstream_port = echo.port();
+      echo_relay = std::make_unique<cfvpn::LocalRelay>(relay_options);
+      std::string error;
+      if (!download_relay->Start(&error) || !echo_relay->Start(&error)) {
+        std::fprintf(stderr, "中继启动失败: %s\n", error.c_str());
+        return 1;
+      }
+      if (mode.zero_copy && !download_relay->zero_copy()) {
+        std::printf("%-14s %12s\n", mode.name, "n/a");
+        continue;
+      }
+      download_port = download_relay->port();
+      echo_port = echo_relay->port();
+    }
+    const double throughput = MeasureThroughput(download_port, options);
+    std::vector<int64_t> rtts;
+    if (throughput < 0 ||
+        !MeasureRoundTrips(echo_port, options.rounds, &rtts)) {
+      std::fprintf(stderr, "%s 测量失败\n", mode.name);
+      return 1;
+    }
+    std::printf("%-14s %12.1f %8lldus %8lldus %8lldus\n", mode.name,
+                throughput, static_cast<long long>(Percentile(rtts, 0.5)),
+                static_cast<long long>(Percentile(rtts, 0.99)),
+                static_cast<long long>(rtts.back()));
+    std::fflush(stdout);
+  }
+  return 0;
+}
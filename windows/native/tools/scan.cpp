@@ -0,0 +1,457 @@
+// cfvpn_scan：不需要 Flutter 界面的节点扫描，流程与应用中的"测试节点"
+// 相同（CIDR 采样 -> TCPing -> Trace -> 排序），结果以 JSON 或 CSV 输出
+// 到 stdout，进度输出到 stderr。可选地用最优节点生成 v2ray 配置。
+//
+//   cfvpn_scan [选项]
+//
+// 适合在无界面的 Linux 机器或 CI 上比较扫描参数，也可以直接用
+// perf record -g cfvpn_scan ... 分析扫描热点。
+//
+// --full 模式改为对每个 /24 各测一个地址，结果逐批追加到 --output，
+// 中断后用相同参数再次运行会从 --checkpoint 记录的位置继续。
+//
+// --sampler thompson/ucb 改为按段的优质节点比例分轮分配采样预算，
+// 配合 cfvpn_edge_sim 可以和默认的均匀采样比较找到同样多优质节点
+// 所需的探测数（输出中的 probed）。
+
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/cidr_sampler.h"
+#include "core/full_scanner.h"
+#include "core/json.h"
+#include "core/node_cache.h"
+#include "core/node_scanner.h"
+#include "core/socket_util.h"
+#include "core/v2ray_config.h"
+
+namespace {
+
+// --history 只取最近 7 天探测过的节点作为先验
+constexpr int64_t kHistoryMaxAgeSeconds = 7 * 24 * 3600;
+
+cfvpn::NodeScanner* g_scanner = nullptr;
+cfvpn::FullScanner* g_full_scanner = nullptr;
+
+void HandleInterrupt(int) {
+  if (g_scanner != nullptr) g_scanner->Cancel();
+  if (g_full_scanner != nullptr) g_full_scanner->Cancel();
+}
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "用法: cfvpn_scan [选项]\n"
+      "扫描:\n"
+      "      --ranges LIST        逗号分隔的 CIDR，默认 Cloudflare 全部网段\n"
+      "      --ranges-file PATH   从文件读取 CIDR（每行一个，# 开头为注释）\n"
+      "  -n, --count N            采样 IP 数，默认 500\n"
+      "      --top N              输出的节点数，0 表示全部，默认 5\n"
+      "      --max-latency MS     最大延迟（也是 TCPing 超时），默认 300\n"
+      "      --min-valid-latency MS  低于此延迟视为无效，默认 30\n"
+      "  -p, --port PORT          TCPing 端口，默认 443\n"
+      "      --seed N             采样种子，默认按时间\n"
+      "      --inflight N         TCPing 最大并发，默认 1024\n"
+      "      --no-early-stop      探测全部采样，不在找到足够节点后提前结束\n"
+      "      --no-trace           跳过 /cdn-cgi/trace 测速\n"
+      "      --trace-port PORT    Trace 端口，默认 80\n"
+      "采样:\n"
+      "      --sampler NAME       uniform（默认）、thompson 或 ucb\n"
+      "      --arm-prefix N       bandit 每个臂的前缀长度，默认 16\n"
+      "      --batch N            bandit 每轮探测的地址数，默认 32\n"
+      "      --history PATH       节点缓存文件，作为 bandit 的先验\n"
+      "全量扫描:\n"
+      "      --full               每个 /24 测一个地址（忽略 -n 和 Trace）\n"
+      "      --output PATH        CSV 结果文件，--full 时必需\n"
+      "      --checkpoint PATH    检查点文件，默认 <output>.checkpoint\n"
+      "      --chunk N            每批 /24 数（检查点间隔），默认 1024\n"
+      "      --restart            忽略已有检查点，从头开始\n"
+      "输出:\n"
+      "  -f, --format FORMAT      json（默认）或 csv\n"
+      "  -q, --quiet              不输出进度\n"
+      "      --write-config PATH  用第一个节点生成 v2ray 配置\n"
+      "      --template PATH      配置模板，默认 assets/js/v2ray_config.json\n"
+      "      --server-name NAME   TLS serverName / Host\n"
+      "      --uuid UUID          VLESS 用户 ID\n"
+      "      --socks-port PORT    默认 7898\n"
+      "      --http-port PORT     默认 7899\n"
+      "      --global             全局代理模式\n");
+}
+
+bool ReadFile(const std::string& path, std::string* out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::ostringstream buffer;
+  buffer << file.rdbuf();
+  *out = buffer.str();
+  return true;
+}
+
+// 去掉 # 注释后交给 ParseCidrList，返回无效项的数量
+size_t ParseRangesText(const std::string& text,
+                       std::vector<cfvpn::Ipv4Range>* out) {
+  std::string stripped;
+  stripped.reserve(text.size());
+  bool comment = false;
+  for (char c : text) {
+    if (c == '#') comment = true;
+    if (c == '\n') comment = false;
+    stripped.push_back(comment ? ' ' : c);
+  }
+  return cfvpn::ParseCidrList(stripped.c_str(), out);
+}
+
+// 读出节点缓存中最近探测过的全部节点
+bool LoadHistory(const std::string& path,
+                 std::vector<cfvpn::NodeQuality>* out) {
+  cfvpn::NodeCache cache;
+  if (!cache.Open(path, cfvpn::NodeCacheOptions())) return false;
+  out->resize(cache.size());
+  out->resize(cache.Best(static_cast<int64_t>(std::time(nullptr)),
+                         kHistoryMaxAgeSeconds, UINT32_MAX, out->data(),
+                         out->size()));
+  cache.Close();
+  return true;
+}
+
+const char* StopReasonName(cfvpn::StopReason reason) {
+  switch (reason) {
+    case cfvpn::StopReason::kCompleted:
+      return "completed";
+    case cfvpn::StopReason::kEnoughGood:
+      return "enough_good";
+    case cfvpn::StopReason::kTooManyFailures:
+      return "too_many_failures";
+    case cfvpn::StopReason::kCancelled:
+      return "cancelled";
+  }
+  return "unknown";
+}
+
+std::string ToJson(const std::vector<cfvpn::ScanResult>& ranked,
+                   const cfvpn::ScanSummary& summary) {
+  char number[160];
+  std::string out = "{\"summary\":{";
+  std::snprintf(number, sizeof(number),
+                "\"sampled\":%zu,\"probed\":%zu,\"reachable\":%zu,"
+                "\"traced\":%zu,\"stop_reason\":",
+                summary.sampled, summary.probed, summary.reachable,
+                summary.traced);
+  out += number;
+  cfvpn::AppendJsonString(StopReasonName(summary.stop_reason), &out);
+  std::snprintf(number, sizeof(number),
+                ",\"sample_us\":%lld,\"tcping_us\":%lld,\"trace_us\":%lld},",
+                static_cast<long long>(summary.sample_us),
+                static_cast<long long>(summary.tcping_us),
+                static_cast<long long>(summary.trace_us));
+  out += number;
+  out += "\"results\":[";
+  for (size_t i = 0; i < ranked.size(); ++i) {
+    const cfvpn::ScanResult& result = ranked[i];
+    if (i > 0) out.push_back(',');
+    std::snprintf(number, sizeof(number), "{\"rank\":%zu,\"ip\":", i + 1);
+    out += number;
+    cfvpn::AppendJsonString(cfvpn::FormatIpv4(result.ip), &out);
+    std::snprintf(number, sizeof(number),
+                  ",\"port\":%u,\"latency_ms\":%d,\"loss_rate\":%.3f,"
+                  "\"trace_ms\":%d,\"colo\":",
+                  result.port, result.latency_ms, result.loss_rate,
+                  result.trace_ms);
+    out += number;
+    cfvpn::AppendJsonString(result.colo, &out);
+    out += ",\"loc\":";
+    cfvpn::AppendJsonString(result.loc, &out);
+    out.push_back('}');
+  }
+  out += "]}\n";
+  return out;
+}
+
+std::string ToCsv(const std::vector<cfvpn::ScanResult>& ranked) {
+  std::string out = "rank,ip,port,latency_ms,loss_rate,trace_ms,colo,loc\n";
+  char line[160];
+  for (size_t i = 0; i < ranked.size(); ++i) {
+    const cfvpn::ScanResult& result = ranked[i];
+    // colo 和 loc 只含字母，不需要转义
+    std::snprintf(line, sizeof(line), "%zu,%s,%u,%d,%.3f,%d,%s,%s\n", i + 1,
+                  cfvpn::FormatIpv4(result.ip).c_str(), result.port,
+                  result.latency_ms, result.loss_rate, result.trace_ms,
+                  result.colo.c_str(), result.loc.c_str());
+    out += line;
+  }
+  return out;
+}
+
+bool WriteConfig(const std::string& template_path,
+                 const cfvpn::V2rayConfigParams& params,
+                 const std::string& path) {
+  std::string text;
+  if (!ReadFile(template_path, &text)) {
+    std::fprintf(stderr, "无法读取模板 %s\n", template_path.c_str());
+    return false;
+  }
+  cfvpn::V2rayConfigBuilder builder;
+  std::string error;
+  if (!builder.LoadTemplate(text, &error)) {
+    std::fprintf(stderr, "模板无效: %s\n", error.c_str());
+    return false;
+  }
+  const std::string& config = builder.Build(params);
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(config.data(), static_cast<std::streamsize>(config.size()));
+  if (!file) {
+    std::fprintf(stderr, "无法写入 %s\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// 全量扫描：进度输出到 stderr，最优节点按 --format 输出到 stdout
+int RunFullScan(const cfvpn::ScanOptions& scan_options, bool seed_set,
+                cfvpn::FullScanOptions options, bool csv, bool quiet) {
+  if (options.output_path.empty()) {
+    std::fprintf(stderr, "--full 需要 --output\n");
+    return 2;
+  }
+  if (options.checkpoint_path.empty()) {
+    options.checkpoint_path = options.output_path + ".checkpoint";
+  }
+  options.ranges = scan_options.ranges;
+  // 续扫要求种子不变，未指定时用固定的默认种子而不是时间
+  if (seed_set) options.seed = scan_options.seed;
+  options.port = scan_options.port;
+  options.max_latency_ms = scan_options.max_latency_ms;
+  options.tcping.min_valid_latency_ms =
+      scan_options.tcping.min_valid_latency_ms;
+  options.tcping.max_inflight = scan_options.tcping.max_inflight;
+
+  cfvpn::FullScanner scanner(options);
+  g_full_scanner = &scanner;
+  std::signal(SIGINT, &HandleInterrupt);
+  std::signal(SIGTERM, &HandleInterrupt);
+
+  uint64_t last_permille = 1001;
+  auto progress = [&](uint64_t done, uint64_t total) {
+    const uint64_t permille = done * 1000 / total;
+    if (permille == last_permille) return;
+    last_permille = permille;
+    std::fprintf(stderr, "\r/24 %llu/%llu (%.1f%%)",
+                 static_cast<unsigned long long>(done),
+                 static_cast<unsigned long long>(total), permille / 10.0);
+    std::fflush(stderr);
+  };
+  std::string error;
+  const bool ok = scanner.Run(
+      &error, quiet ? cfvpn::FullScanner::ProgressCallback() : progress);
+  g_full_scanner = nullptr;
+  if (!quiet) std::fprintf(stderr, "\n");
+  if (!ok) {
+    std::fprintf(stderr, "扫描失败: %s\n", error.c_str());
+    return 1;
+  }
+  if (!quiet) {
+    std::fprintf(stderr, "%s：/24 %llu/%llu（从 %llu 续扫），可用 %llu\n",
+                 scanner.cancelled() ? "已中断" : "完成",
+                 static_cast<unsigned long long>(scanner.done_blocks()),
+                 static_cast<unsigned long long>(scanner.total_blocks()),
+                 static_cast<unsigned long long>(scanner.resumed_from()),
+                 static_cast<unsigned long long>(scanner.reachable()));
+  }
+
+  std::vector<cfvpn::ScanResult> ranked;
+  for (const cfvpn::FullScanNode& node : scanner.best()) {
+    cfvpn::ScanResult result;
+    result.ip = node.ip;
+    result.port = options.port;
+    result.latency_ms = node.latency_ms;
+    result.loss_rate = node.loss_rate;
+    ranked.push_back(result);
+  }
+  cfvpn::ScanSummary summary;
+  summary.probed = static_cast<size_t>(scanner.done_blocks());
+  summary.reachable = static_cast<size_t>(scanner.reachable());
+  const std::string output = csv ? ToCsv(ranked) : ToJson(ranked, summary);
+  std::fwrite(output.data(), 1, output.size(), stdout);
+  // 被中断时返回 130，便于脚本区分后再次运行续扫
+  if (scanner.cancelled()) return 130;
+  return ranked.empty() ? 1 : 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  cfvpn::ScanOptions options;
+  bool csv = false;
+  bool quiet = false;
+  std::string config_path;
+  std::string template_path = CFVPN_ASSETS_DIR "/js/v2ray_config.json";
+  cfvpn::V2rayConfigParams params;
+  bool full = false;
+  bool seed_set = false;
+  cfvpn::FullScanOptions full_options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if ((arg == "--ranges" || arg == "--ranges-file") && has_value) {
+      std::string text = argv[++i];
+      if (arg == "--ranges-file" && !ReadFile(argv[i], &text)) {
+        std::fprintf(stderr, "无法读取 %s\n", argv[i]);
+        return 2;
+      }
+      options.ranges.clear();
+      const size_t invalid = ParseRangesText(text, &options.ranges);
+      if (invalid > 0 || options.ranges.empty()) {
+        std::fprintf(stderr, "无效的 CIDR 列表: %s\n", argv[i]);
+        return 2;
+      }
+    } else if ((arg == "-n" || arg == "--count") && has_value) {
+      options.sample_count = std::atoi(argv[++i]);
+    } else if (arg == "--top" && has_value) {
+      options.result_count = std::atoi(argv[++i]);
+    } else if (arg == "--max-latency" && has_value) {
+      options.max_latency_ms = std::atoi(argv[++i]);
+    } else if (arg == "--min-valid-latency" && has_value) {
+      options.tcping.min_valid_latency_ms = std::atoi(argv[++i]);
+    } else if ((arg == "-p" || arg == "--port") && has_value) {
+      options.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+    } else if (arg == "--seed" && has_value) {
+      options.seed = std::strtoull(argv[++i], nullptr, 10);
+      seed_set = true;
+    } else if (arg == "--inflight" && has_value) {
+      options.tcping.max_inflight = std::atoi(argv[++i]);
+    } else if (arg == "--no-early-stop") {
+      options.tcping.stop_after_good = 0;
+      options.tcping.failure_window = 0;
+    } else if (arg == "--no-trace") {
+      options.trace = false;
+    } else if (arg == "--trace-port" && has_value) {
+      options.trace_port = static_cast<uint16_t>(std::atoi(argv[++i]));
+    } else if (arg == "--sampler" && has_value) {
+      const std::string name = argv[++i];
+      if (name == "uniform") {
+        options.sampler = cfvpn::ScanSampler::kUniform;
+      } else if (name == "thompson" || name == "ucb") {
+        options.sampler = cfvpn::ScanSampler::kBandit;
+        options.bandit.policy = name == "ucb" ? cfvpn::BanditPolicy::kUcb
+                                              : cfvpn::BanditPolicy::kThompson;
+      } else {
+        std::fprintf(stderr, "未知的采样方式: %s\n", name.c_str());
+        return 2;
+      }
+    } else if (arg == "--arm-prefix" && has_value) {
+      options.bandit.arm_prefix = std::atoi(argv[++i]);
+    } else if (arg == "--batch" && has_value) {
+      options.bandit.batch = std::atoi(argv[++i]);
+    } else if (arg == "--history" && has_value) {
+      if (!LoadHistory(argv[++i], &options.history)) {
+        std::fprintf(stderr, "无法打开节点缓存 %s\n", argv[i]);
+        return 2;
+      }
+    } else if (arg == "--full") {
+      full = true;
+    } else if (arg == "--output" && has_value) {
+      full_options.output_path = argv[++i];
+    } else if (arg == "--checkpoint" && has_value) {
+      full_options.checkpoint_path = argv[++i];
+    } else if (arg == "--chunk" && has_value) {
+      full_options.chunk_blocks = std::atoi(argv[++i]);
+    } else if (arg == "--restart") {
+      full_options.restart = true;
+    } else if ((arg == "-f" || arg == "--format") && has_value) {
+      const std::string format = argv[++i];
+      if (format != "json" && format != "csv") {
+        std::fprintf(stderr, "未知的格式: %s\n", format.c_str());
+        return 2;
+      }
+      csv = format == "csv";
+    } else if (arg == "-q" || arg == "--quiet") {
+      quiet = true;
+    } else if (arg == "--write-config" && has_value) {
+      config_path = argv[++i];
+    } else if (arg == "--template" && has_value) {
+      template_path = argv[++i];
+    } else if (arg == "--server-name" && has_value) {
+      params.server_name = argv[++i];
+    } else if (arg == "--uuid" && has_value) {
+      params.user_id = argv[++i];
+    } else if (arg == "--socks-port" && has_value) {
+      params.socks_port = std::atoi(argv[++i]);
+    } else if (arg == "--http-port" && has_value) {
+      params.http_port = std::atoi(argv[++i]);
+    } else if (arg == "--global") {
+      params.global_proxy = true;
+    } else if (arg == "-h" || arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (full) {
+    return RunFullScan(options, seed_set, full_options, csv, quiet);
+  }
+  if (options.sample_count <= 0) {
+    std::fprintf(stderr, "采样数必须大于 0\n");
+    return 2;
+  }
+
+  cfvpn::NodeScanner scanner(options);
+  g_scanner = &scanner;
+  std::signal(SIGINT, &HandleInterrupt);
+  std::signal(SIGTERM, &HandleInterrupt);
+
+  // 进度每 1% 刷新一次，避免终端输出成为瓶颈
+  size_t last_percent = 101;
+  cfvpn::ScanPhase last_phase = cfvpn::ScanPhase::kTcping;
+  auto progress = [&](cfvpn::ScanPhase phase, size_t done, size_t total) {
+    const size_t percent = done * 100 / total;
+    if (percent == last_percent && phase == last_phase) return;
+    last_percent = percent;
+    last_phase = phase;
+    std::fprintf(stderr, "\r%s %zu/%zu",
+                 phase == cfvpn::ScanPhase::kTcping ? "TCPing" : "Trace ",
+                 done, total);
+    std::fflush(stderr);
+  };
+  std::vector<cfvpn::ScanResult> ranked;
+  cfvpn::ScanSummary summary;
+  const bool ok = scanner.Run(
+      &ranked, &summary,
+      quiet ? cfvpn::NodeScanner::ProgressCallback() : progress);
+  g_scanner = nullptr;
+  if (!quiet) std::fprintf(stderr, "\n");
+  if (!ok) {
+    std::fprintf(stderr, "扫描失败\n");
+    return 1;
+  }
+  if (!quiet) {
+    std::fprintf(stderr,
+                 "采样 %zu，探测 %zu，可用 %zu（%s），"
+                 "耗时 %.1f ms + %.1f ms + %.1f ms\n",
+                 summary.sampled, summary.probed, summary.reachable,
+                 StopReasonName(summary.stop_reason),
+                 summary.sample_us / 1000.0, summary.tcping_us / 1000.0,
+                 summary.trace_us / 1000.0);
+  }
+
+  const std::string output = csv ? ToCsv(ranked) : ToJson(ranked, summary);
+  std::fwrite(output.data(), 1, output.size(), stdout);
+
+  if (!config_path.empty()) {
+    if (ranked.empty()) {
+      std::fprintf(stderr, "没有可用节点，未生成配置\n");
+      return 1;
+    }
+    params.server_ip = cfvpn::FormatIpv4(ranked[0].ip);
+    if (!WriteConfig(template_path, params, config_path)) return 1;
+  }
+  return ranked.empty() ? 1 : 0;
+}
@@ -2,6 +2,7 @@
 
 #include <optional>
 
+#include "core/trace_recorder.h"
 #include "flutter/generated_plugin_registrant.h"
 
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
@@ -18,16 +19,25 @@ bool FlutterWindow::OnCreate() {
 
   // The size here must match the window dimensions to avoid unnecessary surface
   // creation / destruction in the startup path.
-  flutter_controller_ = std::make_unique<flutter::FlutterViewController>(
-      frame.right - frame.left, frame.bottom - frame.top, project_);
+  {
+    CFVPN_TRACE_SCOPE("FlutterViewController");
+    flutter_controller_ = std::make_unique<flutter::FlutterViewController>(
+        frame.right - frame.left, frame.bottom - frame.top, project_);
+  }
   // Ensure that basic setup of the controller was successful.
   if (!flutter_controller_->engine() || !flutter_controller_->view()) {
     return false;
   }
-  RegisterPlugins(flutter_controller_->engine());
+  {
+    CFVPN_TRACE_SCOPE("RegisterPlugins");
+    RegisterPlugins(flutter_controller_->engine());
+  }
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
 
   flutter_controller_->engine()->SetNextFrameCallback([&]() {
+    // Time from wWinMain (the trace origin) to the first rendered frame.
+    cfvpn::TraceRecorder& trace = cfvpn::TraceRecorder::Global();
+    trace.AddComplete("FirstFrame", "startup", 0, trace.NowUs());
     this->Show();
   });
 
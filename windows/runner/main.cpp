@@ -6,13 +6,91 @@
 #include <flutter/flutter_view_controller.h>
 #include <windows.h>
 
+#include <string>
+
+#include "core/native_api.h"
+#include "core/trace_recorder.h"
 #include "flutter_window.h"
 #include "utils.h"
 
+namespace {
+
+// Records the time between process creation and wWinMain (loader, DLL
+// imports, CRT init) as a span that starts before the trace origin.
+void TraceProcessStart(cfvpn::TraceRecorder& trace) {
+  FILETIME creation, exit_time, kernel, user, now;
+  if (!::GetProcessTimes(::GetCurrentProcess(), &creation, &exit_time,
+                         &kernel, &user)) {
+    return;
+  }
+  ::GetSystemTimePreciseAsFileTime(&now);
+  ULARGE_INTEGER created_at, now_at;
+  created_at.LowPart = creation.dwLowDateTime;
+  created_at.HighPart = creation.dwHighDateTime;
+  now_at.LowPart = now.dwLowDateTime;
+  now_at.HighPart = now.dwHighDateTime;
+  if (now_at.QuadPart < created_at.QuadPart) return;
+  const int64_t elapsed_us =
+      static_cast<int64_t>((now_at.QuadPart - created_at.QuadPart) / 10);
+  const int64_t now_us = trace.NowUs();
+  trace.AddComplete("ProcessStart", "startup", now_us - elapsed_us,
+                    elapsed_us);
+}
+
+// Starts the native pre-engine init thread: it maps the node cache,
+// pre-parses the v2ray config template and checks the v2ray binary and geo
+// files while the Flutter engine boots. Dart adopts the results over FFI.
+void StartPrewarm() {
+  wchar_t module_path[MAX_PATH];
+  const DWORD length = ::GetModuleFileNameW(nullptr, module_path, MAX_PATH);
+  if (length == 0 || length >= MAX_PATH) return;
+  std::wstring directory(module_path, length);
+  directory.resize(directory.find_last_of(L"\\/") + 1);
+  const std::string base = Utf8FromUtf16(directory.c_str());
+  if (base.empty()) return;
+
+  const std::string node_cache = base + "node_cache.bin";
+  const std::string config_template =
+      base + "data\\flutter_assets\\assets\\js\\v2ray_config.json";
+  const std::string v2ray = base + "v2ray\\v2ray.exe";
+  const std::string geoip = base + "v2ray\\geoip.dat";
+  const std::string geosite = base + "v2ray\\geosite.dat";
+  const char* geo_files[] = {geoip.c_str(), geosite.c_str()};
+
+  CfvpnPrewarmOptions options = {};
+  options.node_cache_path = node_cache.c_str();
+  options.config_template_path = config_template.c_str();
+  options.v2ray_path = v2ray.c_str();
+  options.geo_files = geo_files;
+  options.geo_file_count = 2;
+  cfvpn_prewarm_start(&options);
+}
+
+// Writes the startup trace when CFVPN_TRACE_FILE names an output path.
+void DumpTraceIfRequested() {
+  wchar_t path[MAX_PATH];
+  const DWORD length =
+      ::GetEnvironmentVariableW(L"CFVPN_TRACE_FILE", path, MAX_PATH);
+  if (length == 0 || length >= MAX_PATH) return;
+  cfvpn::TraceRecorder::Global().WriteJson(Utf8FromUtf16(path));
+}
+
+}  // namespace
+
 int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
                       _In_ wchar_t *command_line, _In_ int show_command) {
-  HANDLE hMutex = CreateMutex(NULL, TRUE, L"Global\\CFVPNMutex");
-  if (GetLastError() == ERROR_ALREADY_EXISTS) {
+  cfvpn::TraceRecorder& trace = cfvpn::TraceRecorder::Global();
+  trace.SetThreadName("platform");
+  TraceProcessStart(trace);
+
+  HANDLE hMutex;
+  bool already_running;
+  {
+    CFVPN_TRACE_SCOPE("CreateMutex");
+    hMutex = CreateMutex(NULL, TRUE, L"Global\\CFVPNMutex");
+    already_running = GetLastError() == ERROR_ALREADY_EXISTS;
+  }
+  if (already_running) {
     HWND hwnd = FindWindow(L"FLUTTER_RUNNER_WIN32_WINDOW", L"Proxy App");
     if (hwnd != NULL) {
       if (IsIconic(hwnd)) {
@@ -24,11 +102,16 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
     return EXIT_SUCCESS;
   }
 
+  StartPrewarm();
+
   if (!::AttachConsole(ATTACH_PARENT_PROCESS) && ::IsDebuggerPresent()) {
     CreateAndAttachConsole();
   }
 
-  ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+  {
+    CFVPN_TRACE_SCOPE("CoInitializeEx");
+    ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+  }
 
   flutter::DartProject project(L"data");
 
@@ -40,7 +123,14 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
   FlutterWindow window(project);
   Win32Window::Point origin(10, 10);
   Win32Window::Size size(1280, 720);
-  if (!window.Create(L"Proxy App", origin, size)) {
+  bool created;
+  {
+    // Includes FlutterWindow::OnCreate: engine start and plugin registration.
+    CFVPN_TRACE_SCOPE("Window::Create");
+    created = window.Create(L"Proxy App", origin, size);
+  }
+  if (!created) {
+    DumpTraceIfRequested();
     CloseHandle(hMutex);
     return EXIT_FAILURE;
   }
@@ -52,6 +142,7 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
     ::DispatchMessage(&msg);
   }
 
+  DumpTraceIfRequested();
   CloseHandle(hMutex);
   ::CoUninitialize();
   return EXIT_SUCCESS;